@@ -30,7 +30,7 @@ subject to the following restrictions:
 
 #include "Bullet3Common/b3AlignedObjectArray.h"
 
-#include "b3ThreadSupportInterface.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
 
 
 typedef void (*b3PosixThreadFunc)(void* userPtr,void* lsMemory);
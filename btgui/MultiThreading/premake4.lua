@@ -17,9 +17,7 @@
 	
 	
 	files {
-		"b3ThreadSupportInterface.cpp",
-		"main.cpp",
-		"b3ThreadSupportInterface.h"
+		"main.cpp"
 	}
 	if os.is("Windows") then
 
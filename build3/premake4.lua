@@ -118,7 +118,9 @@ if not _OPTIONS["ios"] then
 		include "../test/OpenCL/BasicInitialize"
 		include "../test/OpenCL/KernelLaunch"--	
 --		include "../test/OpenCL/BroadphaseCollision"
---		include "../test/OpenCL/NarrowphaseCollision"
+		include "../test/OpenCL/NarrowphaseCollision"
+		include "../test/OpenCL/RigidBody"
+		include "../test/OpenCL/Raycast"
 		include "../test/OpenCL/ParallelPrimitives"
 		include "../test/OpenCL/RadixSortBenchmark"
 		include "../test/OpenCL/BitonicSort"
@@ -142,6 +144,7 @@ if not _OPTIONS["ios"] then
 
 		
 --		include "../test/b3DynamicBvhBroadphase"
+		include "../test/b3PgsJacobiSolver"
 		
 	if _OPTIONS["enet"] then
 		include "../btgui/enet"
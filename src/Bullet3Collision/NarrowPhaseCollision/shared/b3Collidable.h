@@ -15,6 +15,8 @@ enum b3ShapeTypes
 	SHAPE_CONCAVE_TRIMESH=5,
 	SHAPE_COMPOUND_OF_CONVEX_HULLS=6,
 	SHAPE_SPHERE=7,
+	SHAPE_BOX=8,
+	SHAPE_CAPSULE=9,
 	MAX_NUM_SHAPE_TYPES,
 };
 
@@ -0,0 +1,23 @@
+#ifndef B3_CONTACT_MANIFOLD_CACHE_DATA_H
+#define B3_CONTACT_MANIFOLD_CACHE_DATA_H
+
+#include "Bullet3Common/shared/b3Float4.h"
+
+typedef struct b3ContactManifoldCacheData b3ContactManifoldCacheData_t;
+
+///convex-convex manifold as generated by the clipping stage, stored in the local frames of both bodies
+///so it can be re-projected while the relative transform of the pair stays (almost) the same
+struct b3ContactManifoldCacheData
+{
+	b3Float4	m_relPos;//position of B in the frame of A when the manifold was clipped
+	b3Float4	m_relOrn;//orientation of B in the frame of A
+	b3Float4	m_localNormalOnA;//w: number of points
+	b3Float4	m_localPointsA[4];
+	b3Float4	m_localPointsB[4];
+	int			m_bodyA;
+	int			m_bodyB;
+	int			m_unused0;
+	int			m_unused1;
+};
+
+#endif //B3_CONTACT_MANIFOLD_CACHE_DATA_H
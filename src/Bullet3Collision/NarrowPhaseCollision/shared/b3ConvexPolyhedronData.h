@@ -31,7 +31,12 @@ B3_ATTRIBUTE_ALIGNED16(struct) b3ConvexPolyhedronData
 	int m_vertexOffset;
 	int	m_uniqueEdgesOffset;
 	int	m_numUniqueEdges;
-	int m_unused;
+	int m_vertexAdjacencyOffset;//-1 if the hull has no vertex adjacency
+
+	int m_edgeOffset;
+	int m_numEdges;
+	int m_unused0;
+	int m_unused1;
 };
 
 #endif //B3_CONVEX_POLYHEDRON_DATA_H
@@ -0,0 +1,78 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_CPU_FEATURES_H
+#define B3_CPU_FEATURES_H
+
+#include "b3Scalar.h"
+
+///B3_AVX2_TARGET marks functions that use AVX2 intrinsics, so they can be compiled without enabling AVX2 for the whole file.
+///Only call such functions after b3CpuHasAvx2() returned true.
+#if defined (_MSC_VER) && (_MSC_VER >= 1700) && (defined (_M_X64) || defined (_M_IX86))
+	#include <intrin.h>
+	#include <immintrin.h>
+	#define B3_HAS_AVX2_TARGET
+	#define B3_AVX2_TARGET
+#elif (defined (__GNUC__) || defined (__clang__)) && (defined (__x86_64__) || defined (__i386__))
+	#include <cpuid.h>
+	#include <immintrin.h>
+	#define B3_HAS_AVX2_TARGET
+	#define B3_AVX2_TARGET __attribute__ ((target ("avx2")))
+#endif
+
+///returns true when both the cpu and the operating system (YMM register state) support AVX2
+inline bool	b3CpuHasAvx2()
+{
+#if defined (B3_HAS_AVX2_TARGET)
+	unsigned int regs[4] = {0,0,0,0};
+#ifdef _MSC_VER
+	__cpuid((int*)regs,0);
+	if (regs[0]<7)
+		return false;
+	__cpuid((int*)regs,1);
+#else
+	__cpuid(0,regs[0],regs[1],regs[2],regs[3]);
+	if (regs[0]<7)
+		return false;
+	__cpuid(1,regs[0],regs[1],regs[2],regs[3]);
+#endif
+	//OSXSAVE and AVX
+	const unsigned int osxsaveAvx = (1u<<27) | (1u<<28);
+	if ((regs[2] & osxsaveAvx) != osxsaveAvx)
+		return false;
+
+	//the OS needs to save the XMM and YMM registers on context switches
+#ifdef _MSC_VER
+	unsigned long long xcr0 = _xgetbv(0);
+#else
+	unsigned int xcr0Lo,xcr0Hi;
+	__asm__ __volatile__ ("xgetbv" : "=a" (xcr0Lo), "=d" (xcr0Hi) : "c" (0));
+	unsigned long long xcr0 = ((unsigned long long)xcr0Hi<<32) | xcr0Lo;
+#endif
+	if ((xcr0 & 6) != 6)
+		return false;
+
+#ifdef _MSC_VER
+	__cpuidex((int*)regs,7,0);
+#else
+	__cpuid_count(7,0,regs[0],regs[1],regs[2],regs[3]);
+#endif
+	return (regs[1] & (1u<<5))!=0;
+#else
+	return false;
+#endif
+}
+
+#endif //B3_CPU_FEATURES_H
@@ -65,6 +65,32 @@ public:
 		return static_cast<int>(totalsize - usedsize);
 	}
 
+	///grows the stack so a block of size bytes fits, only while no block is in use. The stack never shrinks,
+	///so a frame arena that is reserved for each step only allocates when the steps grow
+	inline void		reserve(unsigned int size)
+	{
+		b3Assert(usedsize==0);
+		if (usedsize==0 && size>=totalsize)
+			create(2*size);
+	}
+	///bytes used by a block holding one array of count elements, see allocateArray
+	template <typename T>
+	static unsigned int	getBlockSize(int count)
+	{
+		return sizeof(b3Block)+getArraySize<T>(count);
+	}
+	template <typename T>
+	static unsigned int	getArraySize(int count)
+	{
+		return (unsigned int)((sizeof(T)*count+15)&~15);
+	}
+	///the elements are not constructed, the size is rounded up to 16 bytes so the next array stays aligned
+	template <typename T>
+	T*	allocateArray(int count)
+	{
+		return (T*)allocate(getArraySize<T>(count));
+	}
+
 	unsigned char*			allocate(unsigned int size)
 	{
 		const unsigned int	nus(usedsize+size);
@@ -20,3 +20,13 @@ b3ThreadSupportInterface::~b3ThreadSupportInterface()
 
 }
 
+void	b3ThreadTaskFunc(void* userPtr,void* lsMemory)
+{
+	b3ThreadTask* task = (b3ThreadTask*)userPtr;
+	task->run(lsMemory);
+}
+
+void*	b3ThreadTaskLocalStoreFunc()
+{
+	return 0;
+}
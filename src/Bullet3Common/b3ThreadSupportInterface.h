@@ -86,5 +86,18 @@ public:
 
 };
 
+///b3ThreadTask is a generic unit of work for a b3ThreadSupportInterface constructed with b3ThreadTaskFunc and b3ThreadTaskLocalStoreFunc.
+///Pass the task as uiArgument0 of sendRequest, so the library can schedule its own work on threads owned by the application.
+class b3ThreadTask
+{
+public:
+	virtual ~b3ThreadTask() {}
+
+	virtual void	run(void* lsMemory)=0;
+};
+
+void	b3ThreadTaskFunc(void* userPtr,void* lsMemory);
+void*	b3ThreadTaskLocalStoreFunc();
+
 #endif //B3_THREAD_SUPPORT_INTERFACE_H
 
@@ -29,7 +29,10 @@ enum	b3SolverMode
 	B3_SOLVER_CACHE_FRIENDLY = 128,
 	B3_SOLVER_SIMD = 256,
 	B3_SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS = 512,
-	B3_SOLVER_ALLOW_ZERO_LENGTH_FRICTION_DIRECTIONS = 1024
+	B3_SOLVER_ALLOW_ZERO_LENGTH_FRICTION_DIRECTIONS = 1024,
+	B3_SOLVER_SIMD_ROW_BLOCKS = 2048,///PGS only, solves graph colored batches of rows in SIMD blocks, see b3SolverRowBlocks
+	B3_SOLVER_BLOCK_CONTACT_NORMALS = 4096,///sequential iterations only, solves the normal rows of each manifold together, see b3ContactBlockSolver.h
+	B3_SOLVER_JACOBI_NNCG = 8192///Jacobi only, nonsmooth nonlinear conjugate gradient step after each iteration, see b3PgsJacobiSolver::applyNncgStep
 };
 
 struct b3ContactSolverInfoData
@@ -58,6 +61,10 @@ struct b3ContactSolverInfoData
 	int			m_minimumSolverBatchSize;
 	b3Scalar	m_maxGyroscopicForce;
 	b3Scalar	m_singleAxisRollingFrictionThreshold;
+	b3Scalar	m_residualThreshold;//stop iterating once the largest delta impulse of an iteration is below this value, 0 disables the early exit
+	int			m_minNumIterations;//iterations solved before the residual threshold is checked, m_numIterations is the maximum
+	b3Scalar	m_jointCacheAngularThreshold;//reuse the rows of a joint until one of its bodies rotated more than this angle (radians) since they were built, 0 disables the cache
+	b3Scalar	m_splitImpulseResidualThreshold;//like m_residualThreshold, for the push impulses of the split impulse iterations
 
 
 };
@@ -91,6 +98,10 @@ struct b3ContactSolverInfo : public b3ContactSolverInfoData
 		m_minimumSolverBatchSize = 128; //try to combine islands until the amount of constraints reaches this limit
 		m_maxGyroscopicForce = 100.f; ///only used to clamp forces for bodies that have their B3_ENABLE_GYROPSCOPIC_FORCE flag set (using b3RigidBody::setFlag)
 		m_singleAxisRollingFrictionThreshold = 1e30f;///if the velocity is above this threshold, it will use a single constraint row (axis), otherwise 3 rows.
+		m_residualThreshold = b3Scalar(0.);
+		m_minNumIterations = 1;
+		m_jointCacheAngularThreshold = b3Scalar(0.);
+		m_splitImpulseResidualThreshold = b3Scalar(0.);
 	}
 };
 
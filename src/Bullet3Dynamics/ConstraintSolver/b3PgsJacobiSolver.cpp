@@ -25,6 +25,7 @@ subject to the following restrictions:
 #include "b3TypedConstraint.h"
 #include <new>
 #include "Bullet3Common/b3StackAlloc.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
 
 //#include "b3SolverBody.h"
 //#include "b3SolverConstraint.h"
@@ -35,6 +36,7 @@ subject to the following restrictions:
 
 
 #include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
+#include "Bullet3Dynamics/shared/b3ContactBlockSolver.h"
 
 static b3Transform	getWorldTransform(b3RigidBodyCL* rb)
 {
@@ -143,13 +145,34 @@ int	getNumContacts(b3Contact4* contact)
 
 b3PgsJacobiSolver::b3PgsJacobiSolver(bool usePgs)
 :m_btSeed2(0),m_usePgs(usePgs),
-m_numSplitImpulseRecoveries(0)
+m_numSplitImpulseRecoveries(0),
+m_contactRowsColored(false),
+m_threadSupport(0),
+m_barrier(0),
+m_stackAlloc(0),
+m_useRowBlocks(false),
+m_numIslands(0)
 {
 
 }
 
 b3PgsJacobiSolver::~b3PgsJacobiSolver()
 {
+	setThreadSupport(0);
+}
+
+void	b3PgsJacobiSolver::setThreadSupport(b3ThreadSupportInterface* threadSupport)
+{
+	if (m_barrier)
+	{
+		m_threadSupport->deleteBarrier(m_barrier);
+		m_barrier = 0;
+	}
+	m_threadSupport = threadSupport;
+	if (m_threadSupport)
+	{
+		m_barrier = m_threadSupport->createBarrier();
+	}
 }
 
 void	b3PgsJacobiSolver::solveContacts(int numBodies, b3RigidBodyCL* bodies, b3InertiaCL* inertias, int numContacts, b3Contact4* contacts, int numConstraints, b3TypedConstraint** constraints)
@@ -217,132 +240,240 @@ static inline __m128 b3SimdDot3( __m128 vec0, __m128 vec1 )
 #endif//USE_SIMD
 
 // Project Gauss Seidel or the equivalent Sequential Impulse
-void b3PgsJacobiSolver::resolveSingleConstraintRowGenericSIMD(b3SolverBody& body1,b3SolverBody& body2,const b3SolverConstraint& c)
+b3Scalar b3PgsJacobiSolver::resolveSingleConstraintRowGenericSIMD(b3SolverBody& body1,b3SolverBody& body2,b3SolverConstraintHot& c, b3Scalar lowerLimit, b3Scalar upperLimit)
 {
 #ifdef USE_SIMD
 	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
-	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
-	__m128	upperLimit1 = _mm_set1_ps(c.m_upperLimit);
-	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.m_rhs), _mm_mul_ps(_mm_set1_ps(c.m_appliedImpulse),_mm_set1_ps(c.m_cfm)));
+	__m128	lowerLimit1 = _mm_set1_ps(lowerLimit);
+	__m128	upperLimit1 = _mm_set1_ps(upperLimit);
+	__m128	jacDiagABInv = _mm_set1_ps(c.getJacDiagABInv());
+	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.getRhs()), _mm_mul_ps(cpAppliedImp,_mm_set1_ps(c.getCfm())));
 	__m128 deltaVel1Dotn	=	_mm_add_ps(b3SimdDot3(c.m_contactNormal.mVec128,body1.internalGetDeltaLinearVelocity().mVec128), b3SimdDot3(c.m_relpos1CrossNormal.mVec128,body1.internalGetDeltaAngularVelocity().mVec128));
 	__m128 deltaVel2Dotn	=	_mm_sub_ps(b3SimdDot3(c.m_relpos2CrossNormal.mVec128,body2.internalGetDeltaAngularVelocity().mVec128),b3SimdDot3((c.m_contactNormal).mVec128,body2.internalGetDeltaLinearVelocity().mVec128));
-	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
-	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,jacDiagABInv));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,jacDiagABInv));
 	b3SimdScalar sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
 	b3SimdScalar resultLowerLess,resultUpperLess;
 	resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
 	resultUpperLess = _mm_cmplt_ps(sum,upperLimit1);
 	__m128 lowMinApplied = _mm_sub_ps(lowerLimit1,cpAppliedImp);
 	deltaImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowMinApplied), _mm_andnot_ps(resultLowerLess, deltaImpulse) );
-	c.m_appliedImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowerLimit1), _mm_andnot_ps(resultLowerLess, sum) );
+	__m128 appliedImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowerLimit1), _mm_andnot_ps(resultLowerLess, sum) );
 	__m128 upperMinApplied = _mm_sub_ps(upperLimit1,cpAppliedImp);
 	deltaImpulse = _mm_or_ps( _mm_and_ps(resultUpperLess, deltaImpulse), _mm_andnot_ps(resultUpperLess, upperMinApplied) );
-	c.m_appliedImpulse = _mm_or_ps( _mm_and_ps(resultUpperLess, c.m_appliedImpulse), _mm_andnot_ps(resultUpperLess, upperLimit1) );
-	__m128	linearComponentA = _mm_mul_ps(c.m_contactNormal.mVec128,body1.internalGetInvMass().mVec128);
-	__m128	linearComponentB = _mm_mul_ps((c.m_contactNormal).mVec128,body2.internalGetInvMass().mVec128);
+	appliedImpulse = _mm_or_ps( _mm_and_ps(resultUpperLess, appliedImpulse), _mm_andnot_ps(resultUpperLess, upperLimit1) );
+	c.m_appliedImpulse = _mm_cvtss_f32(appliedImpulse);
+	__m128	contactNormal = b3SolverRowXyz(c.m_contactNormal).mVec128;
+	__m128	linearComponentA = _mm_mul_ps(contactNormal,body1.internalGetInvMass().mVec128);
+	__m128	linearComponentB = _mm_mul_ps(contactNormal,body2.internalGetInvMass().mVec128);
 	__m128 impulseMagnitude = deltaImpulse;
 	body1.internalGetDeltaLinearVelocity().mVec128 = _mm_add_ps(body1.internalGetDeltaLinearVelocity().mVec128,_mm_mul_ps(linearComponentA,impulseMagnitude));
-	body1.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body1.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
+	body1.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body1.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(b3SolverRowXyz(c.m_angularComponentA).mVec128,impulseMagnitude));
 	body2.internalGetDeltaLinearVelocity().mVec128 = _mm_sub_ps(body2.internalGetDeltaLinearVelocity().mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
-	body2.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body2.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
+	body2.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body2.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(b3SolverRowXyz(c.m_angularComponentB).mVec128,impulseMagnitude));
+	return _mm_cvtss_f32(deltaImpulse);
 #else
-	resolveSingleConstraintRowGeneric(body1,body2,c);
+	return resolveSingleConstraintRowGeneric(body1,body2,c,lowerLimit,upperLimit);
 #endif
 }
 
 // Project Gauss Seidel or the equivalent Sequential Impulse
- void b3PgsJacobiSolver::resolveSingleConstraintRowGeneric(b3SolverBody& body1,b3SolverBody& body2,const b3SolverConstraint& c)
+ b3Scalar b3PgsJacobiSolver::resolveSingleConstraintRowGeneric(b3SolverBody& body1,b3SolverBody& body2,b3SolverConstraintHot& c, b3Scalar lowerLimit, b3Scalar upperLimit)
 {
-	b3Scalar deltaImpulse = c.m_rhs-b3Scalar(c.m_appliedImpulse)*c.m_cfm;
+	b3Scalar deltaImpulse = c.getRhs()-c.m_appliedImpulse*c.getCfm();
 	const b3Scalar deltaVel1Dotn	=	c.m_contactNormal.dot(body1.internalGetDeltaLinearVelocity()) 	+ c.m_relpos1CrossNormal.dot(body1.internalGetDeltaAngularVelocity());
 	const b3Scalar deltaVel2Dotn	=	-c.m_contactNormal.dot(body2.internalGetDeltaLinearVelocity()) + c.m_relpos2CrossNormal.dot(body2.internalGetDeltaAngularVelocity());
 
 //	const b3Scalar delta_rel_vel	=	deltaVel1Dotn-deltaVel2Dotn;
-	deltaImpulse	-=	deltaVel1Dotn*c.m_jacDiagABInv;
-	deltaImpulse	-=	deltaVel2Dotn*c.m_jacDiagABInv;
+	deltaImpulse	-=	deltaVel1Dotn*c.getJacDiagABInv();
+	deltaImpulse	-=	deltaVel2Dotn*c.getJacDiagABInv();
 
-	const b3Scalar sum = b3Scalar(c.m_appliedImpulse) + deltaImpulse;
-	if (sum < c.m_lowerLimit)
+	const b3Scalar sum = c.m_appliedImpulse + deltaImpulse;
+	if (sum < lowerLimit)
 	{
-		deltaImpulse = c.m_lowerLimit-c.m_appliedImpulse;
-		c.m_appliedImpulse = c.m_lowerLimit;
+		deltaImpulse = lowerLimit-c.m_appliedImpulse;
+		c.m_appliedImpulse = lowerLimit;
 	}
-	else if (sum > c.m_upperLimit) 
+	else if (sum > upperLimit) 
 	{
-		deltaImpulse = c.m_upperLimit-c.m_appliedImpulse;
-		c.m_appliedImpulse = c.m_upperLimit;
+		deltaImpulse = upperLimit-c.m_appliedImpulse;
+		c.m_appliedImpulse = upperLimit;
 	}
 	else
 	{
 		c.m_appliedImpulse = sum;
 	}
 
-	body1.internalApplyImpulse(c.m_contactNormal*body1.internalGetInvMass(),c.m_angularComponentA,deltaImpulse);
-	body2.internalApplyImpulse(-c.m_contactNormal*body2.internalGetInvMass(),c.m_angularComponentB,deltaImpulse);
+	const b3Vector3 contactNormal = b3SolverRowXyz(c.m_contactNormal);
+	body1.internalApplyImpulse(contactNormal*body1.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentA),deltaImpulse);
+	body2.internalApplyImpulse(-contactNormal*body2.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentB),deltaImpulse);
+	return deltaImpulse;
 }
 
- void b3PgsJacobiSolver::resolveSingleConstraintRowLowerLimitSIMD(b3SolverBody& body1,b3SolverBody& body2,const b3SolverConstraint& c)
+ b3Scalar b3PgsJacobiSolver::resolveSingleConstraintRowLowerLimitSIMD(b3SolverBody& body1,b3SolverBody& body2,b3SolverConstraintHot& c)
 {
 #ifdef USE_SIMD
 	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
-	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
-	__m128	upperLimit1 = _mm_set1_ps(c.m_upperLimit);
-	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.m_rhs), _mm_mul_ps(_mm_set1_ps(c.m_appliedImpulse),_mm_set1_ps(c.m_cfm)));
+	__m128	lowerLimit1 = _mm_set1_ps(c.getLowerLimit());
+	__m128	jacDiagABInv = _mm_set1_ps(c.getJacDiagABInv());
+	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.getRhs()), _mm_mul_ps(cpAppliedImp,_mm_set1_ps(c.getCfm())));
 	__m128 deltaVel1Dotn	=	_mm_add_ps(b3SimdDot3(c.m_contactNormal.mVec128,body1.internalGetDeltaLinearVelocity().mVec128), b3SimdDot3(c.m_relpos1CrossNormal.mVec128,body1.internalGetDeltaAngularVelocity().mVec128));
 	__m128 deltaVel2Dotn	=	_mm_sub_ps(b3SimdDot3(c.m_relpos2CrossNormal.mVec128,body2.internalGetDeltaAngularVelocity().mVec128),b3SimdDot3((c.m_contactNormal).mVec128,body2.internalGetDeltaLinearVelocity().mVec128));
-	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
-	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,jacDiagABInv));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,jacDiagABInv));
 	b3SimdScalar sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
-	b3SimdScalar resultLowerLess,resultUpperLess;
+	b3SimdScalar resultLowerLess;
 	resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
-	resultUpperLess = _mm_cmplt_ps(sum,upperLimit1);
 	__m128 lowMinApplied = _mm_sub_ps(lowerLimit1,cpAppliedImp);
 	deltaImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowMinApplied), _mm_andnot_ps(resultLowerLess, deltaImpulse) );
-	c.m_appliedImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowerLimit1), _mm_andnot_ps(resultLowerLess, sum) );
-	__m128	linearComponentA = _mm_mul_ps(c.m_contactNormal.mVec128,body1.internalGetInvMass().mVec128);
-	__m128	linearComponentB = _mm_mul_ps((c.m_contactNormal).mVec128,body2.internalGetInvMass().mVec128);
+	c.m_appliedImpulse = _mm_cvtss_f32(_mm_or_ps( _mm_and_ps(resultLowerLess, lowerLimit1), _mm_andnot_ps(resultLowerLess, sum) ));
+	__m128	contactNormal = b3SolverRowXyz(c.m_contactNormal).mVec128;
+	__m128	linearComponentA = _mm_mul_ps(contactNormal,body1.internalGetInvMass().mVec128);
+	__m128	linearComponentB = _mm_mul_ps(contactNormal,body2.internalGetInvMass().mVec128);
 	__m128 impulseMagnitude = deltaImpulse;
 	body1.internalGetDeltaLinearVelocity().mVec128 = _mm_add_ps(body1.internalGetDeltaLinearVelocity().mVec128,_mm_mul_ps(linearComponentA,impulseMagnitude));
-	body1.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body1.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
+	body1.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body1.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(b3SolverRowXyz(c.m_angularComponentA).mVec128,impulseMagnitude));
 	body2.internalGetDeltaLinearVelocity().mVec128 = _mm_sub_ps(body2.internalGetDeltaLinearVelocity().mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
-	body2.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body2.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
+	body2.internalGetDeltaAngularVelocity().mVec128 = _mm_add_ps(body2.internalGetDeltaAngularVelocity().mVec128 ,_mm_mul_ps(b3SolverRowXyz(c.m_angularComponentB).mVec128,impulseMagnitude));
+	return _mm_cvtss_f32(deltaImpulse);
 #else
-	resolveSingleConstraintRowLowerLimit(body1,body2,c);
+	return resolveSingleConstraintRowLowerLimit(body1,body2,c);
 #endif
 }
 
 // Project Gauss Seidel or the equivalent Sequential Impulse
- void b3PgsJacobiSolver::resolveSingleConstraintRowLowerLimit(b3SolverBody& body1,b3SolverBody& body2,const b3SolverConstraint& c)
+ b3Scalar b3PgsJacobiSolver::resolveSingleConstraintRowLowerLimit(b3SolverBody& body1,b3SolverBody& body2,b3SolverConstraintHot& c)
 {
-	b3Scalar deltaImpulse = c.m_rhs-b3Scalar(c.m_appliedImpulse)*c.m_cfm;
+	b3Scalar deltaImpulse = c.getRhs()-c.m_appliedImpulse*c.getCfm();
 	const b3Scalar deltaVel1Dotn	=	c.m_contactNormal.dot(body1.internalGetDeltaLinearVelocity()) 	+ c.m_relpos1CrossNormal.dot(body1.internalGetDeltaAngularVelocity());
 	const b3Scalar deltaVel2Dotn	=	-c.m_contactNormal.dot(body2.internalGetDeltaLinearVelocity()) + c.m_relpos2CrossNormal.dot(body2.internalGetDeltaAngularVelocity());
 
-	deltaImpulse	-=	deltaVel1Dotn*c.m_jacDiagABInv;
-	deltaImpulse	-=	deltaVel2Dotn*c.m_jacDiagABInv;
-	const b3Scalar sum = b3Scalar(c.m_appliedImpulse) + deltaImpulse;
-	if (sum < c.m_lowerLimit)
+	deltaImpulse	-=	deltaVel1Dotn*c.getJacDiagABInv();
+	deltaImpulse	-=	deltaVel2Dotn*c.getJacDiagABInv();
+	const b3Scalar sum = c.m_appliedImpulse + deltaImpulse;
+	const b3Scalar lowerLimit = c.getLowerLimit();
+	if (sum < lowerLimit)
 	{
-		deltaImpulse = c.m_lowerLimit-c.m_appliedImpulse;
-		c.m_appliedImpulse = c.m_lowerLimit;
+		deltaImpulse = lowerLimit-c.m_appliedImpulse;
+		c.m_appliedImpulse = lowerLimit;
 	}
 	else
 	{
 		c.m_appliedImpulse = sum;
 	}
-	body1.internalApplyImpulse(c.m_contactNormal*body1.internalGetInvMass(),c.m_angularComponentA,deltaImpulse);
-	body2.internalApplyImpulse(-c.m_contactNormal*body2.internalGetInvMass(),c.m_angularComponentB,deltaImpulse);
+	const b3Vector3 contactNormal = b3SolverRowXyz(c.m_contactNormal);
+	body1.internalApplyImpulse(contactNormal*body1.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentA),deltaImpulse);
+	body2.internalApplyImpulse(-contactNormal*body2.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentB),deltaImpulse);
+	return deltaImpulse;
+}
+void b3PgsJacobiSolver::solveContactManifoldBlock(int begin, int end, b3SolverResidual& residual)
+{
+	b3HotConstraintArray& rows = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT];
+	int n = end-begin;
+	bool useBlock = (n>1) && (n<=B3_CONTACT_BLOCK_MAX_POINTS);
+	for (int i=0;useBlock && i<n;i++)
+	{
+		if (rows[begin+i].getJacDiagABInv()==b3Scalar(0))
+			useBlock = false;
+	}
+
+	float A[16];
+	float b[4];
+	float lambda[4];
+	if (useBlock)
+	{
+		//all rows of a manifold share the same pair of solver bodies
+		const b3SolverConstraintHot& c0 = rows[begin];
+		b3SolverBody& body1 = m_tmpSolverBodyPool[c0.m_solverBodyIdA];
+		b3SolverBody& body2 = m_tmpSolverBodyPool[c0.m_solverBodyIdB];
+		const b3Vector3 linearFactorA = body1.internalGetInvMass()*body1.m_linearFactor;
+		const b3Vector3 linearFactorB = body2.internalGetInvMass()*body2.m_linearFactor;
+
+		for (int i=0;i<n;i++)
+		{
+			const b3SolverConstraintHot& ci = rows[begin+i];
+			//the row update is deltaImpulse = -jacDiagABInv*w, with w the velocity error including the cfm term
+			b3Scalar relVel = ci.m_contactNormal.dot(body1.internalGetDeltaLinearVelocity()) + ci.m_relpos1CrossNormal.dot(body1.internalGetDeltaAngularVelocity())
+				- ci.m_contactNormal.dot(body2.internalGetDeltaLinearVelocity()) + ci.m_relpos2CrossNormal.dot(body2.internalGetDeltaAngularVelocity());
+			b3Scalar invJacDiag = b3Scalar(1)/ci.getJacDiagABInv();
+			b3Scalar w = relVel + (ci.getCfm()*ci.m_appliedImpulse - ci.getRhs())*invJacDiag;
+
+			for (int j=0;j<n;j++)
+			{
+				const b3SolverConstraintHot& cj = rows[begin+j];
+				b3Scalar a = ci.m_contactNormal.dot(cj.m_contactNormal*linearFactorA) + ci.m_relpos1CrossNormal.dot(cj.m_angularComponentA*body1.m_angularFactor)
+					+ ci.m_contactNormal.dot(cj.m_contactNormal*linearFactorB) + ci.m_relpos2CrossNormal.dot(cj.m_angularComponentB*body2.m_angularFactor);
+				if (i==j)
+					a += ci.getCfm()*invJacDiag;
+				A[i*4+j] = float(a);
+			}
+			b[i] = float(w);
+		}
+		//shift to lambda-lowerLimit >= 0, the lower limit of contact rows is usually 0
+		for (int i=0;i<n;i++)
+		{
+			for (int j=0;j<n;j++)
+			{
+				const b3SolverConstraintHot& cj = rows[begin+j];
+				b[i] -= A[i*4+j]*float(cj.m_appliedImpulse-cj.getLowerLimit());
+			}
+		}
+		useBlock = b3SolveContactBlockLcp(A,b,n,lambda)!=0;
+	}
+
+	if (!useBlock)
+	{
+		for (int i=begin;i<end;i++)
+		{
+			b3SolverConstraintHot& c = rows[i];
+			residual.addRow(resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[c.m_solverBodyIdA],m_tmpSolverBodyPool[c.m_solverBodyIdB],c));
+		}
+		return;
+	}
+
+	for (int i=0;i<n;i++)
+	{
+		b3SolverConstraintHot& c = rows[begin+i];
+		b3SolverBody& body1 = m_tmpSolverBodyPool[c.m_solverBodyIdA];
+		b3SolverBody& body2 = m_tmpSolverBodyPool[c.m_solverBodyIdB];
+		b3Scalar appliedImpulse = c.getLowerLimit()+b3Scalar(lambda[i]);
+		b3Scalar deltaImpulse = appliedImpulse-c.m_appliedImpulse;
+		c.m_appliedImpulse = appliedImpulse;
+		const b3Vector3 contactNormal = b3SolverRowXyz(c.m_contactNormal);
+		body1.internalApplyImpulse(contactNormal*body1.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentA),deltaImpulse);
+		body2.internalApplyImpulse(-contactNormal*body2.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentB),deltaImpulse);
+		residual.addRow(deltaImpulse);
+	}
+}
+
+void b3PgsJacobiSolver::solveContactManifoldBlocks(b3SolverResidual& residual)
+{
+	b3HotConstraintArray& rows = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT];
+	int numManifolds = m_contactManifoldOffsets.size()-1;
+	//the offsets are only valid for the rows of the last setup
+	if (numManifolds<0 || m_contactManifoldOffsets[numManifolds]!=rows.size())
+	{
+		for (int j=0;j<rows.size();j++)
+		{
+			b3SolverConstraintHot& c = rows[j];
+			residual.addRow(resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[c.m_solverBodyIdA],m_tmpSolverBodyPool[c.m_solverBodyIdB],c));
+		}
+		return;
+	}
+	for (int i=0;i<numManifolds;i++)
+	{
+		solveContactManifoldBlock(m_contactManifoldOffsets[i],m_contactManifoldOffsets[i+1],residual);
+	}
 }
 
 
-void	b3PgsJacobiSolver::resolveSplitPenetrationImpulseCacheFriendly(
+b3Scalar	b3PgsJacobiSolver::resolveSplitPenetrationImpulseCacheFriendly(
         b3SolverBody& body1,
         b3SolverBody& body2,
         const b3SolverConstraint& c)
 {
 		if (c.m_rhsPenetration)
         {
-			m_numSplitImpulseRecoveries++;
 			b3Scalar deltaImpulse = c.m_rhsPenetration-b3Scalar(c.m_appliedPushImpulse)*c.m_cfm;
 			const b3Scalar deltaVel1Dotn	=	c.m_contactNormal.dot(body1.internalGetPushVelocity()) 	+ c.m_relpos1CrossNormal.dot(body1.internalGetTurnVelocity());
 			const b3Scalar deltaVel2Dotn	=	-c.m_contactNormal.dot(body2.internalGetPushVelocity()) + c.m_relpos2CrossNormal.dot(body2.internalGetTurnVelocity());
@@ -361,16 +492,16 @@ void	b3PgsJacobiSolver::resolveSplitPenetrationImpulseCacheFriendly(
 			}
 			body1.internalApplyPushImpulse(c.m_contactNormal*body1.internalGetInvMass(),c.m_angularComponentA,deltaImpulse);
 			body2.internalApplyPushImpulse(-c.m_contactNormal*body2.internalGetInvMass(),c.m_angularComponentB,deltaImpulse);
+			return deltaImpulse;
         }
+		return b3Scalar(0);
 }
 
- void b3PgsJacobiSolver::resolveSplitPenetrationSIMD(b3SolverBody& body1,b3SolverBody& body2,const b3SolverConstraint& c)
+ b3Scalar b3PgsJacobiSolver::resolveSplitPenetrationSIMD(b3SolverBody& body1,b3SolverBody& body2,const b3SolverConstraint& c)
 {
 #ifdef USE_SIMD
 	if (!c.m_rhsPenetration)
-		return;
-
-	m_numSplitImpulseRecoveries++;
+		return b3Scalar(0);
 
 	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedPushImpulse);
 	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
@@ -394,8 +525,9 @@ void	b3PgsJacobiSolver::resolveSplitPenetrationImpulseCacheFriendly(
 	body1.internalGetTurnVelocity().mVec128 = _mm_add_ps(body1.internalGetTurnVelocity().mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
 	body2.internalGetPushVelocity().mVec128 = _mm_sub_ps(body2.internalGetPushVelocity().mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
 	body2.internalGetTurnVelocity().mVec128 = _mm_add_ps(body2.internalGetTurnVelocity().mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
+	return _mm_cvtss_f32(deltaImpulse);
 #else
-	resolveSplitPenetrationImpulseCacheFriendly(body1,body2,c);
+	return resolveSplitPenetrationImpulseCacheFriendly(body1,body2,c);
 #endif
 }
 
@@ -450,7 +582,8 @@ void	b3PgsJacobiSolver::initSolverBody(int bodyIndex, b3SolverBody* solverBody,
 	if (rb)
 	{
 		solverBody->m_worldTransform = getWorldTransform(rb);
-		solverBody->internalSetInvMass(b3MakeVector3(rb->getInvMass(),rb->getInvMass(),rb->getInvMass()));
+		b3Scalar invMass = rb->getInvMass()*getSplitMassFactor(*rb,bodyIndex);
+		solverBody->internalSetInvMass(b3MakeVector3(invMass,invMass,invMass));
 		solverBody->m_originalBodyIndex = bodyIndex;
 		solverBody->m_angularFactor = b3MakeVector3(1,1,1);
 		solverBody->m_linearFactor = b3MakeVector3(1,1,1);
@@ -506,6 +639,8 @@ void b3PgsJacobiSolver::setupFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaC
 
 	solverConstraint.m_appliedImpulse = 0.f;
 	solverConstraint.m_appliedPushImpulse = 0.f;
+	//the rows are filled in place, no field may keep a value of an earlier step
+	solverConstraint.m_rhsPenetration = 0.f;
 
 	{
 		b3Vector3 ftorqueAxis1 = rel_pos1.cross(solverConstraint.m_contactNormal);
@@ -535,20 +670,12 @@ void b3PgsJacobiSolver::setupFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaC
 			denom1 = body1->getInvMass() + normalAxis.dot(vec);
 		}
 
-		b3Scalar denom;
-		if (m_usePgs)
-		{
-			scaledDenom = denom = relaxation/(denom0+denom1);
-		} else
-		{
-			denom = relaxation/(denom0+denom1);
-			b3Scalar countA = body0->getInvMass() ? b3Scalar(m_bodyCount[solverBodyA.m_originalBodyIndex]): 1.f;
-			b3Scalar countB = body1->getInvMass() ? b3Scalar(m_bodyCount[solverBodyB.m_originalBodyIndex]): 1.f;
-
-			scaledDenom = relaxation/(denom0*countA+denom1*countB);
-		}
-
-		solverConstraint.m_jacDiagABInv = denom;
+		b3Scalar countA = getSplitMassFactor(*body0,solverBodyA.m_originalBodyIndex);
+		b3Scalar countB = getSplitMassFactor(*body1,solverBodyB.m_originalBodyIndex);
+		scaledDenom = relaxation/(denom0*countA+denom1*countB);
+		solverConstraint.m_jacDiagABInv = scaledDenom;
+		solverConstraint.m_angularComponentA *= countA;
+		solverConstraint.m_angularComponentB *= countB;
 	}
 
 	{
@@ -565,7 +692,7 @@ void b3PgsJacobiSolver::setupFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaC
 //		b3Scalar positionalError = 0.f;
 
 		b3SimdScalar velocityError =  desiredVelocity - rel_vel;
-		b3SimdScalar	velocityImpulse = velocityError * b3SimdScalar(scaledDenom);//solverConstraint.m_jacDiagABInv);
+		b3SimdScalar	velocityImpulse = velocityError * b3SimdScalar(scaledDenom);
 		solverConstraint.m_rhs = velocityImpulse;
 		solverConstraint.m_cfm = cfmSlip;
 		solverConstraint.m_lowerLimit = 0;
@@ -574,9 +701,9 @@ void b3PgsJacobiSolver::setupFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaC
 	}
 }
 
-b3SolverConstraint&	b3PgsJacobiSolver::addFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias, const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity, b3Scalar cfmSlip)
+b3SolverConstraint&	b3PgsJacobiSolver::addFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias,int row,const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity, b3Scalar cfmSlip)
 {
-	b3SolverConstraint& solverConstraint = m_tmpSolverContactFrictionConstraintPool.expandNonInitializing();
+	b3SolverConstraint& solverConstraint = m_tmpSolverContactFrictionConstraintPool[row];
 	solverConstraint.m_frictionIndex = frictionIndex;
 	setupFrictionConstraint(bodies,inertias,solverConstraint, normalAxis, solverBodyIdA, solverBodyIdB, cp, rel_pos1, rel_pos2, 
 							colObj0, colObj1, relaxation, desiredVelocity, cfmSlip);
@@ -608,6 +735,7 @@ void b3PgsJacobiSolver::setupRollingFrictionConstraint(b3RigidBodyCL* bodies,b3I
 
 	solverConstraint.m_appliedImpulse = 0.f;
 	solverConstraint.m_appliedPushImpulse = 0.f;
+	solverConstraint.m_rhsPenetration = 0.f;
 
 	{
 		b3Vector3 ftorqueAxis1 = -normalAxis1;
@@ -624,10 +752,14 @@ void b3PgsJacobiSolver::setupRollingFrictionConstraint(b3RigidBodyCL* bodies,b3I
 	{
 		b3Vector3 iMJaA = body0?getInvInertiaTensorWorld(&inertias[solverBodyA.m_originalBodyIndex])*solverConstraint.m_relpos1CrossNormal:b3MakeVector3(0,0,0);
 		b3Vector3 iMJaB = body1?getInvInertiaTensorWorld(&inertias[solverBodyB.m_originalBodyIndex])*solverConstraint.m_relpos2CrossNormal:b3MakeVector3(0,0,0);
+		b3Scalar countA = getSplitMassFactor(*body0,solverBodyA.m_originalBodyIndex);
+		b3Scalar countB = getSplitMassFactor(*body1,solverBodyB.m_originalBodyIndex);
 		b3Scalar sum = 0;
-		sum += iMJaA.dot(solverConstraint.m_relpos1CrossNormal);
-		sum += iMJaB.dot(solverConstraint.m_relpos2CrossNormal);
+		sum += iMJaA.dot(solverConstraint.m_relpos1CrossNormal)*countA;
+		sum += iMJaB.dot(solverConstraint.m_relpos2CrossNormal)*countB;
 		solverConstraint.m_jacDiagABInv = b3Scalar(1.)/sum;
+		solverConstraint.m_angularComponentA *= countA;
+		solverConstraint.m_angularComponentB *= countB;
 	}
 
 	{
@@ -660,9 +792,9 @@ void b3PgsJacobiSolver::setupRollingFrictionConstraint(b3RigidBodyCL* bodies,b3I
 
 
 
-b3SolverConstraint&	b3PgsJacobiSolver::addRollingFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias,const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity, b3Scalar cfmSlip)
+b3SolverConstraint&	b3PgsJacobiSolver::addRollingFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias,int row,const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity, b3Scalar cfmSlip)
 {
-	b3SolverConstraint& solverConstraint = m_tmpSolverContactRollingFrictionConstraintPool.expandNonInitializing();
+	b3SolverConstraint& solverConstraint = m_tmpSolverContactRollingFrictionConstraintPool[row];
 	solverConstraint.m_frictionIndex = frictionIndex;
 	setupRollingFrictionConstraint(bodies,inertias,solverConstraint, normalAxis, solverBodyIdA, solverBodyIdB, cp, rel_pos1, rel_pos2, 
 							colObj0, colObj1, relaxation, desiredVelocity, cfmSlip);
@@ -670,20 +802,24 @@ b3SolverConstraint&	b3PgsJacobiSolver::addRollingFrictionConstraint(b3RigidBodyC
 }
 
 
-int	b3PgsJacobiSolver::getOrInitSolverBody(int bodyIndex, b3RigidBodyCL* bodies,b3InertiaCL* inertias)
+b3Scalar	b3PgsJacobiSolver::getSplitMassFactor(const b3RigidBodyCL& body, int bodyIndex) const
 {
-	//b3Assert(bodyIndex< m_tmpSolverBodyPool.size());
+	if (m_usePgs || body.getInvMass()==0.f)
+		return 1.f;
+	return b3Scalar(m_bodyCount[bodyIndex]);
+}
 
+///the solver bodies are initialized later, in parallel, see B3_SETUP_SOLVER_BODIES
+int	b3PgsJacobiSolver::assignSolverBody(int bodyIndex, b3RigidBodyCL* bodies)
+{
 	b3RigidBodyCL& body = bodies[bodyIndex];
 	int curIndex = -1;
 	if (m_usePgs || body.getInvMass()==0.f)
 	{
 		if (m_bodyCount[bodyIndex]<0)
 		{
-			curIndex = m_tmpSolverBodyPool.size();
-			b3SolverBody& solverBody = m_tmpSolverBodyPool.expand();
-			initSolverBody(bodyIndex,&solverBody,&body);
-			solverBody.m_originalBodyIndex = bodyIndex;
+			curIndex = m_solverBodyOriginalIndices.size();
+			m_solverBodyOriginalIndices.push_back(bodyIndex);
 			m_bodyCount[bodyIndex] = curIndex;
 		} else
 		{
@@ -691,12 +827,11 @@ int	b3PgsJacobiSolver::getOrInitSolverBody(int bodyIndex, b3RigidBodyCL* bodies,
 		}
 	} else
 	{
+		//Jacobi: each manifold gets its own copy of a dynamic body
 		b3Assert(m_bodyCount[bodyIndex]>0);
 		m_bodyCountCheck[bodyIndex]++;
-		curIndex = m_tmpSolverBodyPool.size();
-		b3SolverBody& solverBody = m_tmpSolverBodyPool.expand();
-		initSolverBody(bodyIndex,&solverBody,&body);
-		solverBody.m_originalBodyIndex = bodyIndex;
+		curIndex = m_solverBodyOriginalIndices.size();
+		m_solverBodyOriginalIndices.push_back(bodyIndex);
 	}
 
 	b3Assert(curIndex>=0);
@@ -756,19 +891,13 @@ void b3PgsJacobiSolver::setupContactConstraint(b3RigidBodyCL* bodies, b3InertiaC
 #endif //COMPUTE_IMPULSE_DENOM		
 
 					
-					b3Scalar denom;
-					if (m_usePgs)
-					{
-						scaledDenom = denom = relaxation/(denom0+denom1);
-					} else
-					{
-						denom = relaxation/(denom0+denom1);
-
-						b3Scalar countA = rb0->m_invMass? b3Scalar(m_bodyCount[bodyA->m_originalBodyIndex]) : 1.f;
-						b3Scalar countB = rb1->m_invMass? b3Scalar(m_bodyCount[bodyB->m_originalBodyIndex]) : 1.f;
-						scaledDenom = relaxation/(denom0*countA+denom1*countB);
-					}
-					solverConstraint.m_jacDiagABInv = denom;
+					//the copies of a split body have a scaled inverse mass and inertia, the averaging undoes the scale
+					b3Scalar countA = getSplitMassFactor(*rb0,bodyA->m_originalBodyIndex);
+					b3Scalar countB = getSplitMassFactor(*rb1,bodyB->m_originalBodyIndex);
+					scaledDenom = relaxation/(denom0*countA+denom1*countB);
+					solverConstraint.m_jacDiagABInv = scaledDenom;
+					solverConstraint.m_angularComponentA *= countA;
+					solverConstraint.m_angularComponentB *= countB;
 				}
 
 				solverConstraint.m_contactNormal = cp.m_normalWorldOnB;
@@ -804,11 +933,8 @@ void b3PgsJacobiSolver::setupContactConstraint(b3RigidBodyCL* bodies, b3InertiaC
 				///warm starting (or zero if disabled)
 				if (infoGlobal.m_solverMode & B3_SOLVER_USE_WARMSTARTING)
 				{
+					//applied to the solver bodies by applyWarmstartImpulses
 					solverConstraint.m_appliedImpulse = cp.m_appliedImpulse * infoGlobal.m_warmstartingFactor;
-					if (rb0)
-						bodyA->internalApplyImpulse(solverConstraint.m_contactNormal*bodyA->internalGetInvMass(),solverConstraint.m_angularComponentA,solverConstraint.m_appliedImpulse);
-					if (rb1)
-						bodyB->internalApplyImpulse(solverConstraint.m_contactNormal*bodyB->internalGetInvMass(),-solverConstraint.m_angularComponentB,-(b3Scalar)solverConstraint.m_appliedImpulse);
 				} else
 				{
 					solverConstraint.m_appliedImpulse = 0.f;
@@ -843,8 +969,8 @@ void b3PgsJacobiSolver::setupContactConstraint(b3RigidBodyCL* bodies, b3InertiaC
 						positionalError = -penetration * erp/infoGlobal.m_timeStep;
 					}
 
-					b3Scalar  penetrationImpulse = positionalError*scaledDenom;//solverConstraint.m_jacDiagABInv;
-					b3Scalar velocityImpulse = velocityError *scaledDenom;//solverConstraint.m_jacDiagABInv;
+					b3Scalar  penetrationImpulse = positionalError*solverConstraint.m_jacDiagABInv;
+					b3Scalar velocityImpulse = velocityError *solverConstraint.m_jacDiagABInv;
 
 					if (!infoGlobal.m_splitImpulse || (penetration > infoGlobal.m_splitImpulsePenetrationThreshold))
 					{
@@ -875,19 +1001,12 @@ void b3PgsJacobiSolver::setFrictionConstraintImpulse( b3RigidBodyCL* bodies, b3I
 																 b3ContactPoint& cp, const b3ContactSolverInfo& infoGlobal)
 {
 
-	b3SolverBody* bodyA = &m_tmpSolverBodyPool[solverBodyIdA];
-	b3SolverBody* bodyB = &m_tmpSolverBodyPool[solverBodyIdB];
-
-
+	//the impulses are applied to the solver bodies by applyWarmstartImpulses
 	{
 		b3SolverConstraint& frictionConstraint1 = m_tmpSolverContactFrictionConstraintPool[solverConstraint.m_frictionIndex];
 		if (infoGlobal.m_solverMode & B3_SOLVER_USE_WARMSTARTING)
 		{
 			frictionConstraint1.m_appliedImpulse = cp.m_appliedImpulseLateral1 * infoGlobal.m_warmstartingFactor;
-			if (bodies[bodyA->m_originalBodyIndex].m_invMass)
-				bodyA->internalApplyImpulse(frictionConstraint1.m_contactNormal*bodies[bodyA->m_originalBodyIndex].m_invMass,frictionConstraint1.m_angularComponentA,frictionConstraint1.m_appliedImpulse);
-			if (bodies[bodyB->m_originalBodyIndex].m_invMass)
-				bodyB->internalApplyImpulse(frictionConstraint1.m_contactNormal*bodies[bodyB->m_originalBodyIndex].m_invMass,-frictionConstraint1.m_angularComponentB,-(b3Scalar)frictionConstraint1.m_appliedImpulse);
 		} else
 		{
 			frictionConstraint1.m_appliedImpulse = 0.f;
@@ -900,10 +1019,6 @@ void b3PgsJacobiSolver::setFrictionConstraintImpulse( b3RigidBodyCL* bodies, b3I
 		if (infoGlobal.m_solverMode & B3_SOLVER_USE_WARMSTARTING)
 		{
 			frictionConstraint2.m_appliedImpulse = cp.m_appliedImpulseLateral2  * infoGlobal.m_warmstartingFactor;
-			if (bodies[bodyA->m_originalBodyIndex].m_invMass)
-				bodyA->internalApplyImpulse(frictionConstraint2.m_contactNormal*bodies[bodyA->m_originalBodyIndex].m_invMass,frictionConstraint2.m_angularComponentA,frictionConstraint2.m_appliedImpulse);
-			if (bodies[bodyB->m_originalBodyIndex].m_invMass)
-				bodyB->internalApplyImpulse(frictionConstraint2.m_contactNormal*bodies[bodyB->m_originalBodyIndex].m_invMass,-frictionConstraint2.m_angularComponentB,-(b3Scalar)frictionConstraint2.m_appliedImpulse);
 		} else
 		{
 			frictionConstraint2.m_appliedImpulse = 0.f;
@@ -914,13 +1029,80 @@ void b3PgsJacobiSolver::setFrictionConstraintImpulse( b3RigidBodyCL* bodies, b3I
 
 
 
-void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inertias,b3Contact4* manifold,const b3ContactSolverInfo& infoGlobal)
+///the rolling friction of a contact acts around the relative angular velocity, or around the normal and two tangents when it is small
+static int	b3GetRollingFrictionAxes(b3Vector3 relAngVel, const b3Vector3& normal, b3Scalar singleAxisThreshold, b3Vector3* axes)
+{
+	int numAxes = 0;
+	if (relAngVel.length()>singleAxisThreshold)
+	{
+		relAngVel.normalize();
+		if (relAngVel.length()>0.001)
+			axes[numAxes++] = relAngVel;
+	} else
+	{
+		axes[numAxes++] = normal;
+		b3Vector3 axis0,axis1;
+		b3PlaneSpace1(normal,axis0,axis1);
+		if (axis0.length()>0.001)
+			axes[numAxes++] = axis0;
+		if (axis1.length()>0.001)
+			axes[numAxes++] = axis1;
+	}
+	return numAxes;
+}
+
+///first setup pass, stores the number of rows of the manifold in the offset arrays, mirrors convertContact
+void	b3PgsJacobiSolver::countContactRows(b3Contact4* manifold, int manifoldIndex, const b3ContactSolverInfo& infoGlobal)
+{
+	int numContactRows = 0;
+	int numFrictionRows = 0;
+	int numRollingFrictionRows = 0;
+
+	const b3SolverBody& solverBodyA = m_tmpSolverBodyPool[m_manifoldSolverBodyIds[2*manifoldIndex]];
+	const b3SolverBody& solverBodyB = m_tmpSolverBodyPool[m_manifoldSolverBodyIds[2*manifoldIndex+1]];
+	if (!solverBodyA.m_invMass.isZero() || !solverBodyB.m_invMass.isZero())
+	{
+		int numFrictionDirections = (infoGlobal.m_solverMode & B3_SOLVER_USE_2_FRICTION_DIRECTIONS)? 2 : 1;
+		b3Vector3 angVelA,angVelB;
+		solverBodyA.getAngularVelocity(angVelA);
+		solverBodyB.getAngularVelocity(angVelB);
+		b3Vector3 relAngVel = angVelB-angVelA;
+		int rollingFriction=1;
+		int numContacts = getNumContacts(manifold);
+		for (int j=0;j<numContacts;j++)
+		{
+			b3ContactPoint cp;
+			getContactPoint(manifold,j,cp);
+			if (cp.getDistance() <= getContactProcessingThreshold(manifold))
+			{
+				numContactRows++;
+				numFrictionRows += numFrictionDirections;
+				if ((cp.m_combinedRollingFriction>0.f) && (rollingFriction>0))
+				{
+					rollingFriction--;
+					b3Vector3 axes[3];
+					numRollingFrictionRows += b3GetRollingFrictionAxes(relAngVel,cp.m_normalWorldOnB,infoGlobal.m_singleAxisRollingFrictionThreshold,axes);
+				}
+			}
+		}
+	}
+
+	m_contactManifoldOffsets[manifoldIndex] = numContactRows;
+	m_frictionManifoldOffsets[manifoldIndex] = numFrictionRows;
+	m_rollingFrictionManifoldOffsets[manifoldIndex] = numRollingFrictionRows;
+}
+
+///second setup pass, fills the rows of the manifold at the offsets of the first pass
+void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inertias,b3Contact4* manifold,int manifoldIndex,const b3ContactSolverInfo& infoGlobal)
 {
 	b3RigidBodyCL* colObj0=0,*colObj1=0;
 
 	
-	int solverBodyIdA = getOrInitSolverBody(manifold->getBodyA(),bodies,inertias);
-	int solverBodyIdB = getOrInitSolverBody(manifold->getBodyB(),bodies,inertias);
+	int solverBodyIdA = m_manifoldSolverBodyIds[2*manifoldIndex];
+	int solverBodyIdB = m_manifoldSolverBodyIds[2*manifoldIndex+1];
+	int contactRow = m_contactManifoldOffsets[manifoldIndex];
+	int frictionRow = m_frictionManifoldOffsets[manifoldIndex];
+	int rollingFrictionRow = m_rollingFrictionManifoldOffsets[manifoldIndex];
 
 //	b3RigidBody* bodyA = b3RigidBody::upcast(colObj0);
 //	b3RigidBody* bodyB = b3RigidBody::upcast(colObj1);
@@ -950,14 +1132,15 @@ void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inert
 			b3Scalar rel_vel;
 			b3Vector3 vel;
 
-			int frictionIndex = m_tmpSolverContactConstraintPool.size();
-			b3SolverConstraint& solverConstraint = m_tmpSolverContactConstraintPool.expandNonInitializing();
+			int frictionIndex = contactRow++;
+			b3SolverConstraint& solverConstraint = m_tmpSolverContactConstraintPool[frictionIndex];
 //			b3RigidBody* rb0 = b3RigidBody::upcast(colObj0);
 //			b3RigidBody* rb1 = b3RigidBody::upcast(colObj1);
 			solverConstraint.m_solverBodyIdA = solverBodyIdA;
 			solverConstraint.m_solverBodyIdB = solverBodyIdB;
 
-			solverConstraint.m_originalContactPoint = &cp;
+			//cp is a temporary, there is no persistent contact point to write the impulses back to
+			solverConstraint.m_originalContactPoint = 0;
 
 			setupContactConstraint(bodies,inertias,solverConstraint, solverBodyIdA, solverBodyIdB, cp, infoGlobal, vel, rel_vel, relaxation, rel_pos1, rel_pos2);
 
@@ -966,7 +1149,7 @@ void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inert
 
 			/////setup the friction constraints
 
-			solverConstraint.m_frictionIndex = m_tmpSolverContactFrictionConstraintPool.size();
+			solverConstraint.m_frictionIndex = frictionRow;
 
 			b3Vector3 angVelA,angVelB;
 			solverBodyA->getAngularVelocity(angVelA);
@@ -977,23 +1160,10 @@ void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inert
 			{
 				//only a single rollingFriction per manifold
 				rollingFriction--;
-				if (relAngVel.length()>infoGlobal.m_singleAxisRollingFrictionThreshold)
-				{
-					relAngVel.normalize();
-					if (relAngVel.length()>0.001)
-						addRollingFrictionConstraint(bodies,inertias,relAngVel,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
-
-				} else
-				{
-					addRollingFrictionConstraint(bodies,inertias,cp.m_normalWorldOnB,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
-					b3Vector3 axis0,axis1;
-					b3PlaneSpace1(cp.m_normalWorldOnB,axis0,axis1);
-					if (axis0.length()>0.001)
-						addRollingFrictionConstraint(bodies,inertias,axis0,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
-					if (axis1.length()>0.001)
-						addRollingFrictionConstraint(bodies,inertias,axis1,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
-		
-				}
+				b3Vector3 axes[3];
+				int numAxes = b3GetRollingFrictionAxes(relAngVel,cp.m_normalWorldOnB,infoGlobal.m_singleAxisRollingFrictionThreshold,axes);
+				for (int a=0;a<numAxes;a++)
+					addRollingFrictionConstraint(bodies,inertias,rollingFrictionRow++,axes[a],solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
 			}
 
 			///Bullet has several options to set the friction directions
@@ -1022,11 +1192,11 @@ void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inert
 					{
 						cp.m_lateralFrictionDir2 = cp.m_lateralFrictionDir1.cross(cp.m_normalWorldOnB);
 						cp.m_lateralFrictionDir2.normalize();//??
-						addFrictionConstraint(bodies,inertias,cp.m_lateralFrictionDir2,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
+						addFrictionConstraint(bodies,inertias,frictionRow++,cp.m_lateralFrictionDir2,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
 
 					}
 
-					addFrictionConstraint(bodies,inertias,cp.m_lateralFrictionDir1,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
+					addFrictionConstraint(bodies,inertias,frictionRow++,cp.m_lateralFrictionDir1,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
 
 				} else
 				{
@@ -1034,10 +1204,10 @@ void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inert
 
 					if ((infoGlobal.m_solverMode & B3_SOLVER_USE_2_FRICTION_DIRECTIONS))
 					{
-						addFrictionConstraint(bodies,inertias,cp.m_lateralFrictionDir2,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
+						addFrictionConstraint(bodies,inertias,frictionRow++,cp.m_lateralFrictionDir2,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
 					}
 
-					addFrictionConstraint(bodies,inertias,cp.m_lateralFrictionDir1,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
+					addFrictionConstraint(bodies,inertias,frictionRow++,cp.m_lateralFrictionDir1,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation);
 
 					if ((infoGlobal.m_solverMode & B3_SOLVER_USE_2_FRICTION_DIRECTIONS) && (infoGlobal.m_solverMode & B3_SOLVER_DISABLE_VELOCITY_DEPENDENT_FRICTION_DIRECTION))
 					{
@@ -1047,10 +1217,10 @@ void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inert
 
 			} else
 			{
-				addFrictionConstraint(bodies,inertias,cp.m_lateralFrictionDir1,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation,cp.m_contactMotion1, cp.m_contactCFM1);
+				addFrictionConstraint(bodies,inertias,frictionRow++,cp.m_lateralFrictionDir1,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation,cp.m_contactMotion1, cp.m_contactCFM1);
 
 				if ((infoGlobal.m_solverMode & B3_SOLVER_USE_2_FRICTION_DIRECTIONS))
-					addFrictionConstraint(bodies,inertias,cp.m_lateralFrictionDir2,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation, cp.m_contactMotion2, cp.m_contactCFM2);
+					addFrictionConstraint(bodies,inertias,frictionRow++,cp.m_lateralFrictionDir2,solverBodyIdA,solverBodyIdB,frictionIndex,cp,rel_pos1,rel_pos2,colObj0,colObj1, relaxation, cp.m_contactMotion2, cp.m_contactCFM2);
 
 				setFrictionConstraintImpulse( bodies,inertias,solverConstraint, solverBodyIdA, solverBodyIdB, cp, infoGlobal);
 			}
@@ -1058,6 +1228,385 @@ void	b3PgsJacobiSolver::convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inert
 
 			
 
+		}
+	}
+
+	b3Assert(contactRow==m_contactManifoldOffsets[manifoldIndex+1]);
+	b3Assert(frictionRow==m_frictionManifoldOffsets[manifoldIndex+1]);
+	b3Assert(rollingFrictionRow==m_rollingFrictionManifoldOffsets[manifoldIndex+1]);
+}
+
+void	b3PgsJacobiSolver::applyWarmstartImpulses()
+{
+	b3ConstraintArray* pools[2] = {&m_tmpSolverContactConstraintPool,&m_tmpSolverContactFrictionConstraintPool};
+	for (int p=0;p<2;p++)
+	{
+		const b3ConstraintArray& rows = *pools[p];
+		for (int j=0;j<rows.size();j++)
+		{
+			const b3SolverConstraint& c = rows[j];
+			b3Scalar impulse = c.m_appliedImpulse;
+			if (impulse==b3Scalar(0))
+				continue;
+			b3SolverBody& body1 = m_tmpSolverBodyPool[c.m_solverBodyIdA];
+			b3SolverBody& body2 = m_tmpSolverBodyPool[c.m_solverBodyIdB];
+			body1.internalApplyImpulse(c.m_contactNormal*body1.internalGetInvMass(),c.m_angularComponentA,impulse);
+			body2.internalApplyImpulse(-c.m_contactNormal*body2.internalGetInvMass(),c.m_angularComponentB,impulse);
+		}
+	}
+}
+
+///the rows are reused while both bodies rotate less than the threshold, rows with finite bounds (limits, motors, impulse clamps) depend on the state and are never cached
+bool	b3PgsJacobiSolver::canReuseJointRows(const b3CachedJointRows& cache, const b3TypedConstraint* constraint, int numRows, const b3RigidBodyCL* bodies, b3Scalar cosHalfThreshold, const b3ContactSolverInfo& infoGlobal) const
+{
+	if (cache.m_constraint!=constraint || cache.m_numRows!=numRows)
+		return false;
+	if (cache.m_bodyA!=constraint->getRigidBodyA() || cache.m_bodyB!=constraint->getRigidBodyB())
+		return false;
+	if (cache.m_timeStep!=infoGlobal.m_timeStep || cache.m_erp!=infoGlobal.m_erp || cache.m_globalCfm!=infoGlobal.m_globalCfm || cache.m_globalDamping!=infoGlobal.m_damping)
+		return false;
+
+	//the dot product of two orientations is the cosine of half the rotation between them
+	return b3Fabs(bodies[cache.m_bodyA].m_quat.dot(cache.m_orientationA))>=cosHalfThreshold
+		&& b3Fabs(bodies[cache.m_bodyB].m_quat.dot(cache.m_orientationB))>=cosHalfThreshold;
+}
+
+///copies the cached rows, the position error is moved by the body displacements since the rows were built, to first order
+void	b3PgsJacobiSolver::reuseJointRows(const b3CachedJointRows& cache, b3SolverConstraint* rows, const b3RigidBodyCL* bodies, const b3ContactSolverInfo& infoGlobal) const
+{
+	const b3RigidBodyCL& rbA = bodies[cache.m_bodyA];
+	const b3RigidBodyCL& rbB = bodies[cache.m_bodyB];
+	b3Vector3 deltaPosA = rbA.m_pos-cache.m_positionA;
+	b3Vector3 deltaPosB = rbB.m_pos-cache.m_positionB;
+
+	//small angle rotation vectors, 2*sin(angle/2)*axis
+	b3Quaternion rotationA = rbA.m_quat*cache.m_orientationA.inverse();
+	b3Quaternion rotationB = rbB.m_quat*cache.m_orientationB.inverse();
+	b3Scalar signA = rotationA.getW()<0.f? b3Scalar(-2.) : b3Scalar(2.);
+	b3Scalar signB = rotationB.getW()<0.f? b3Scalar(-2.) : b3Scalar(2.);
+	b3Vector3 deltaAngA = b3MakeVector3(rotationA.getX(),rotationA.getY(),rotationA.getZ())*signA;
+	b3Vector3 deltaAngB = b3MakeVector3(rotationB.getX(),rotationB.getY(),rotationB.getZ())*signB;
+
+	//J*v = rhs makes the position error decay, so the error drops by k*J*displacement.
+	//Constraints with their own erp are estimated with the global one.
+	b3Scalar k = cache.m_erp/cache.m_timeStep;
+	for (int j=0;j<cache.m_numRows;j++)
+	{
+		const b3CachedJointRow& cachedRow = cache.m_rows[j];
+		b3SolverConstraint& row = rows[j];
+		row.m_contactNormal = cachedRow.m_contactNormal;
+		row.m_relpos1CrossNormal = cachedRow.m_relpos1CrossNormal;
+		row.m_relpos2CrossNormal = cachedRow.m_relpos2CrossNormal;
+		row.m_angularComponentA = cachedRow.m_angularComponentA;
+		row.m_angularComponentB = cachedRow.m_angularComponentB;
+		row.m_appliedPushImpulse = 0.f;
+		row.m_appliedImpulse = 0.f;
+		row.m_friction = 0.f;
+		row.m_jacDiagABInv = cachedRow.m_jacDiagABInv;
+		row.m_cfm = cachedRow.m_cfm;
+		row.m_lowerLimit = -B3_INFINITY;
+		row.m_upperLimit = B3_INFINITY;
+		row.m_rhsPenetration = 0.f;
+		row.m_originalContactPoint = (void*)cache.m_constraint;
+		row.m_frictionIndex = 0;
+
+		b3Scalar displacement = cachedRow.m_contactNormal.dot(deltaPosA-deltaPosB)
+			+ cachedRow.m_relpos1CrossNormal.dot(deltaAngA)
+			+ cachedRow.m_relpos2CrossNormal.dot(deltaAngB);
+		row.m_rhs = cachedRow.m_positionError-k*displacement;
+	}
+}
+
+void	b3PgsJacobiSolver::storeJointRows(b3CachedJointRows& cache, const b3TypedConstraint* constraint, const b3SolverConstraint* rows, int numRows, b3Scalar damping, const b3RigidBodyCL* bodies, const b3ContactSolverInfo& infoGlobal) const
+{
+	cache.m_constraint = 0;
+	if (numRows>B3_MAX_CACHED_JOINT_ROWS)
+		return;
+	for (int j=0;j<numRows;j++)
+	{
+		if (rows[j].m_lowerLimit>-B3_INFINITY || rows[j].m_upperLimit<B3_INFINITY)
+			return;
+	}
+	for (int j=0;j<numRows;j++)
+	{
+		b3CachedJointRow& cachedRow = cache.m_rows[j];
+		cachedRow.m_contactNormal = rows[j].m_contactNormal;
+		cachedRow.m_relpos1CrossNormal = rows[j].m_relpos1CrossNormal;
+		cachedRow.m_relpos2CrossNormal = rows[j].m_relpos2CrossNormal;
+		cachedRow.m_angularComponentA = rows[j].m_angularComponentA;
+		cachedRow.m_angularComponentB = rows[j].m_angularComponentB;
+		cachedRow.m_jacDiagABInv = rows[j].m_jacDiagABInv;
+		cachedRow.m_positionError = rows[j].m_rhs;
+		cachedRow.m_cfm = rows[j].m_cfm;
+	}
+	cache.m_constraint = constraint;
+	cache.m_numRows = numRows;
+	cache.m_bodyA = constraint->getRigidBodyA();
+	cache.m_bodyB = constraint->getRigidBodyB();
+	cache.m_orientationA = bodies[cache.m_bodyA].m_quat;
+	cache.m_orientationB = bodies[cache.m_bodyB].m_quat;
+	cache.m_positionA = bodies[cache.m_bodyA].m_pos;
+	cache.m_positionB = bodies[cache.m_bodyB].m_pos;
+	cache.m_timeStep = infoGlobal.m_timeStep;
+	cache.m_erp = infoGlobal.m_erp;
+	cache.m_globalCfm = infoGlobal.m_globalCfm;
+	cache.m_globalDamping = infoGlobal.m_damping;
+	cache.m_damping = damping;
+}
+
+///fills the rows of joint i, at the offset counted by the first setup pass
+void	b3PgsJacobiSolver::convertJoint(b3RigidBodyCL* bodies, b3InertiaCL* inertias, b3TypedConstraint** constraints, int i, const b3ContactSolverInfo& infoGlobal)
+{
+	const b3TypedConstraint::b3ConstraintInfo1& info1 = m_tmpConstraintSizesPool[i];
+	if (!info1.m_numConstraintRows)
+		return;
+
+	b3SolverConstraint* currentConstraintRow = &m_tmpSolverNonContactConstraintPool[m_jointRowOffsets[i]];
+	b3TypedConstraint* constraint = constraints[i];
+
+	b3RigidBodyCL& rbA = bodies[ constraint->getRigidBodyA()];
+	b3RigidBodyCL& rbB = bodies[ constraint->getRigidBodyB()];
+
+	int solverBodyIdA = m_jointSolverBodyIds[2*i];
+	int solverBodyIdB = m_jointSolverBodyIds[2*i+1];
+
+	int overrideNumSolverIterations = constraint->getOverrideNumSolverIterations() > 0 ? constraint->getOverrideNumSolverIterations() : infoGlobal.m_numIterations;
+
+	b3CachedJointRows* cache = i<m_jointRowCache.size()? &m_jointRowCache[i] : 0;
+	b3Scalar cosHalfThreshold = cache? b3Cos(b3Scalar(0.5)*infoGlobal.m_jointCacheAngularThreshold) : b3Scalar(1.);
+	b3Scalar damping;
+	int j;
+	if (cache && canReuseJointRows(*cache,constraint,info1.m_numConstraintRows,bodies,cosHalfThreshold,infoGlobal))
+	{
+		reuseJointRows(*cache,currentConstraintRow,bodies,infoGlobal);
+		damping = cache->m_damping;
+		for ( j=0;j<info1.m_numConstraintRows;j++)
+		{
+			currentConstraintRow[j].m_solverBodyIdA = solverBodyIdA;
+			currentConstraintRow[j].m_solverBodyIdB = solverBodyIdB;
+			currentConstraintRow[j].m_overrideNumSolverIterations = overrideNumSolverIterations;
+		}
+	} else
+	{
+		for ( j=0;j<info1.m_numConstraintRows;j++)
+		{
+			memset(&currentConstraintRow[j],0,sizeof(b3SolverConstraint));
+			currentConstraintRow[j].m_lowerLimit = -B3_INFINITY;
+			currentConstraintRow[j].m_upperLimit = B3_INFINITY;
+			currentConstraintRow[j].m_appliedImpulse = 0.f;
+			currentConstraintRow[j].m_appliedPushImpulse = 0.f;
+			currentConstraintRow[j].m_solverBodyIdA = solverBodyIdA;
+			currentConstraintRow[j].m_solverBodyIdB = solverBodyIdB;
+			currentConstraintRow[j].m_overrideNumSolverIterations = overrideNumSolverIterations;
+		}
+
+		b3TypedConstraint::b3ConstraintInfo2 info2;
+		info2.fps = 1.f/infoGlobal.m_timeStep;
+		info2.erp = infoGlobal.m_erp;
+		info2.m_J1linearAxis = currentConstraintRow->m_contactNormal;
+		info2.m_J1angularAxis = currentConstraintRow->m_relpos1CrossNormal;
+		info2.m_J2linearAxis = 0;
+		info2.m_J2angularAxis = currentConstraintRow->m_relpos2CrossNormal;
+		info2.rowskip = sizeof(b3SolverConstraint)/sizeof(b3Scalar);//check this
+		///the size of b3SolverConstraint needs be a multiple of b3Scalar
+		b3Assert(info2.rowskip*sizeof(b3Scalar)== sizeof(b3SolverConstraint));
+		info2.m_constraintError = &currentConstraintRow->m_rhs;
+		currentConstraintRow->m_cfm = infoGlobal.m_globalCfm;
+		info2.m_damping = infoGlobal.m_damping;
+		info2.cfm = &currentConstraintRow->m_cfm;
+		info2.m_lowerLimit = &currentConstraintRow->m_lowerLimit;
+		info2.m_upperLimit = &currentConstraintRow->m_upperLimit;
+		info2.m_numIterations = infoGlobal.m_numIterations;
+		constraint->getInfo2(&info2,bodies);
+		damping = info2.m_damping;
+
+		for ( j=0;j<info1.m_numConstraintRows;j++)
+		{
+			b3SolverConstraint& solverConstraint = currentConstraintRow[j];
+			solverConstraint.m_originalContactPoint = constraint;
+				
+			b3Matrix3x3& invInertiaWorldA= inertias[constraint->getRigidBodyA()].m_invInertiaWorld;
+			{
+
+				//b3Vector3 angularFactorA(1,1,1);
+				const b3Vector3& ftorqueAxis1 = solverConstraint.m_relpos1CrossNormal;
+				solverConstraint.m_angularComponentA = invInertiaWorldA*ftorqueAxis1;//*angularFactorA;
+			}
+			
+			b3Matrix3x3& invInertiaWorldB= inertias[constraint->getRigidBodyB()].m_invInertiaWorld;
+			{
+
+				const b3Vector3& ftorqueAxis2 = solverConstraint.m_relpos2CrossNormal;
+				solverConstraint.m_angularComponentB = invInertiaWorldB*ftorqueAxis2;//*constraint->getRigidBodyB().getAngularFactor();
+			}
+
+			{
+				//it is ok to use solverConstraint.m_contactNormal instead of -solverConstraint.m_contactNormal
+				//because it gets multiplied iMJlB
+				b3Vector3 iMJlA = solverConstraint.m_contactNormal*rbA.getInvMass();
+				b3Vector3 iMJaA = invInertiaWorldA*solverConstraint.m_relpos1CrossNormal;
+				b3Vector3 iMJlB = solverConstraint.m_contactNormal*rbB.getInvMass();//sign of normal?
+				b3Vector3 iMJaB = invInertiaWorldB*solverConstraint.m_relpos2CrossNormal;
+
+				b3Scalar sum = iMJlA.dot(solverConstraint.m_contactNormal);
+				sum += iMJaA.dot(solverConstraint.m_relpos1CrossNormal);
+				sum += iMJlB.dot(solverConstraint.m_contactNormal);
+				sum += iMJaB.dot(solverConstraint.m_relpos2CrossNormal);
+				b3Scalar fsum = b3Fabs(sum);
+				b3Assert(fsum > B3_EPSILON);
+				solverConstraint.m_jacDiagABInv = fsum>B3_EPSILON?b3Scalar(1.)/sum : 0.f;
+			}
+		}
+
+		if (cache)
+			storeJointRows(*cache,constraint,currentConstraintRow,info1.m_numConstraintRows,damping,bodies,infoGlobal);
+	}
+
+	///finalize the constraint setup
+	for ( j=0;j<info1.m_numConstraintRows;j++)
+	{
+		b3SolverConstraint& solverConstraint = currentConstraintRow[j];
+
+		if (solverConstraint.m_upperLimit>=constraint->getBreakingImpulseThreshold())
+		{
+			solverConstraint.m_upperLimit = constraint->getBreakingImpulseThreshold();
+		}
+
+		if (solverConstraint.m_lowerLimit<=-constraint->getBreakingImpulseThreshold())
+		{
+			solverConstraint.m_lowerLimit = -constraint->getBreakingImpulseThreshold();
+		}
+
+		if (!m_usePgs)
+		{
+			//mass splitting, like the contact rows. The cached rows keep the unsplit values, the copy counts change between steps
+			b3Scalar countA = getSplitMassFactor(rbA,constraint->getRigidBodyA());
+			b3Scalar countB = getSplitMassFactor(rbB,constraint->getRigidBodyB());
+			b3Scalar linear = solverConstraint.m_contactNormal.dot(solverConstraint.m_contactNormal);
+			b3Scalar sumA = linear*rbA.getInvMass()+solverConstraint.m_angularComponentA.dot(solverConstraint.m_relpos1CrossNormal);
+			b3Scalar sumB = linear*rbB.getInvMass()+solverConstraint.m_angularComponentB.dot(solverConstraint.m_relpos2CrossNormal);
+			b3Scalar scaledSum = sumA*countA+sumB*countB;
+			solverConstraint.m_jacDiagABInv = b3Fabs(scaledSum)>B3_EPSILON? b3Scalar(1.)/scaledSum : 0.f;
+			solverConstraint.m_angularComponentA *= countA;
+			solverConstraint.m_angularComponentB *= countB;
+		}
+
+		///fix rhs
+		///todo: add force/torque accelerators
+		{
+			b3Scalar rel_vel;
+			b3Scalar vel1Dotn = solverConstraint.m_contactNormal.dot(rbA.m_linVel) + solverConstraint.m_relpos1CrossNormal.dot(rbA.m_angVel);
+			b3Scalar vel2Dotn = -solverConstraint.m_contactNormal.dot(rbB.m_linVel) + solverConstraint.m_relpos2CrossNormal.dot(rbB.m_angVel);
+
+			rel_vel = vel1Dotn+vel2Dotn;
+
+			b3Scalar restitution = 0.f;
+			b3Scalar positionalError = solverConstraint.m_rhs;//already filled in by getConstraintInfo2
+			b3Scalar	velocityError = restitution - rel_vel * damping;
+			b3Scalar	penetrationImpulse = positionalError*solverConstraint.m_jacDiagABInv;
+			b3Scalar	velocityImpulse = velocityError *solverConstraint.m_jacDiagABInv;
+			solverConstraint.m_rhs = penetrationImpulse+velocityImpulse;
+			solverConstraint.m_appliedImpulse = 0.f;
+
+		}
+	}
+}
+
+struct b3SolverSetupTask : public b3ThreadTask
+{
+	b3PgsJacobiSolver*	m_solver;
+	const b3PgsJacobiSolver::b3SetupContext*	m_context;
+	int	m_stage;
+	int	m_begin;
+	int	m_end;
+
+	virtual void	run(void* lsMemory)
+	{
+		m_solver->runSetupStage(*m_context,m_stage,m_begin,m_end);
+	}
+};
+
+///below this number of items per task the setup stages run on the calling thread
+#define B3_MIN_SETUP_ITEMS_PER_TASK 64
+
+void	b3PgsJacobiSolver::runSetupInParallel(const b3SetupContext& context, int stage, int numItems)
+{
+	int numTasks = m_threadSupport? m_threadSupport->getNumTasks() : 1;
+	numTasks = b3Min(numTasks,numItems/B3_MIN_SETUP_ITEMS_PER_TASK);
+	if (numTasks<2)
+	{
+		runSetupStage(context,stage,0,numItems);
+		return;
+	}
+
+	int itemsPerTask = (numItems+numTasks-1)/numTasks;
+	m_stackAlloc.reserve(b3StackAlloc::getBlockSize<b3SolverSetupTask>(numTasks));
+	b3Block* block = m_stackAlloc.beginBlock();
+	b3SolverSetupTask* tasks = m_stackAlloc.allocateArray<b3SolverSetupTask>(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		new (&tasks[t]) b3SolverSetupTask();
+		tasks[t].m_solver = this;
+		tasks[t].m_context = &context;
+		tasks[t].m_stage = stage;
+		tasks[t].m_begin = b3Min(t*itemsPerTask,numItems);
+		tasks[t].m_end = b3Min(tasks[t].m_begin+itemsPerTask,numItems);
+		m_threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+	}
+	for (int t=0;t<numTasks;t++)
+	{
+		int arg0,arg1;
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+	for (int t=0;t<numTasks;t++)
+		tasks[t].~b3SolverSetupTask();
+	m_stackAlloc.endBlock(block);
+}
+
+void	b3PgsJacobiSolver::runSetupStage(const b3SetupContext& context, int stage, int begin, int end)
+{
+	const b3ContactSolverInfo& infoGlobal = *context.m_infoGlobal;
+	for (int i=begin;i<end;i++)
+	{
+		switch (stage)
+		{
+		case B3_SETUP_JOINT_SIZES:
+			{
+				b3TypedConstraint* constraint = context.m_constraints[i];
+				constraint->internalSetAppliedImpulse(0.0f);
+				b3TypedConstraint::b3ConstraintInfo1& info1 = m_tmpConstraintSizesPool[i];
+				b3JointFeedback* fb = constraint->getJointFeedback();
+				if (fb)
+				{
+					fb->m_appliedForceBodyA.setZero();
+					fb->m_appliedTorqueBodyA.setZero();
+					fb->m_appliedForceBodyB.setZero();
+					fb->m_appliedTorqueBodyB.setZero();
+				}
+				if (constraint->isEnabled())
+				{
+					constraint->getInfo1(&info1,context.m_bodies);
+				} else
+				{
+					info1.m_numConstraintRows = 0;
+					info1.nub = 0;
+				}
+				break;
+			}
+		case B3_SETUP_SOLVER_BODIES:
+			{
+				int bodyIndex = m_solverBodyOriginalIndices[i];
+				initSolverBody(bodyIndex,&m_tmpSolverBodyPool[i],&context.m_bodies[bodyIndex]);
+				break;
+			}
+		case B3_SETUP_CONTACT_SIZES:
+			countContactRows(&context.m_manifolds[i],i,infoGlobal);
+			break;
+		case B3_SETUP_JOINT_ROWS:
+			convertJoint(context.m_bodies,context.m_inertias,context.m_constraints,i,infoGlobal);
+			break;
+		default:
+			convertContact(context.m_bodies,context.m_inertias,&context.m_manifolds[i],i,infoGlobal);
 		}
 	}
 }
@@ -1084,10 +1633,22 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlySetup(b3RigidBodyCL* bodies,
 	m_deltaAngularVelocities.resize(0);
 	m_deltaAngularVelocities.resize(numBodies,b3MakeVector3(0,0,0));
 	
-	int totalBodies = 0;
+	b3SetupContext ctx;
+	ctx.m_bodies = bodies;
+	ctx.m_inertias = inertias;
+	ctx.m_manifolds = manifoldPtr;
+	ctx.m_constraints = constraints;
+	ctx.m_infoGlobal = &infoGlobal;
+
+	//first pass: the rows of each joint and manifold are counted, their offsets are the prefix sums
+	m_tmpConstraintSizesPool.resizeNoInitialize(numConstraints);
+	runSetupInParallel(ctx,B3_SETUP_JOINT_SIZES,numConstraints);
 
 	for (int i=0;i<numConstraints;i++)
 	{
+		//joints without rows get no solver bodies
+		if (!m_tmpConstraintSizesPool[i].m_numConstraintRows)
+			continue;
 		int bodyIndexA = constraints[i]->getRigidBodyA();
 		int bodyIndexB = constraints[i]->getRigidBodyB();
 		if (m_usePgs)
@@ -1096,8 +1657,16 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlySetup(b3RigidBodyCL* bodies,
 			m_bodyCount[bodyIndexB]=-1;
 		} else
 		{
-			//didn't implement joints with Jacobi version yet
-			b3Assert(0);
+			//Jacobi: like a manifold, each joint gets its own copy of a dynamic body
+			if (bodies[bodyIndexA].getInvMass())
+				m_bodyCount[bodyIndexA]++;
+			else
+				m_bodyCount[bodyIndexA]=-1;
+
+			if (bodies[bodyIndexB].getInvMass())
+				m_bodyCount[bodyIndexB]++;
+			else
+				m_bodyCount[bodyIndexB]=-1;
 		}
 
 	}
@@ -1129,218 +1698,77 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlySetup(b3RigidBodyCL* bodies,
 	}
 
 
-	
-	if (1)
+	//the solver bodies are assigned serially, in the order of the joints and manifolds
+	m_solverBodyOriginalIndices.resize(0);
+	m_jointSolverBodyIds.resizeNoInitialize(2*numConstraints);
+	m_jointRowOffsets.resizeNoInitialize(numConstraints+1);
+	int totalNumRows = 0;
+	for (int i=0;i<numConstraints;i++)
 	{
-		int j;
-		for (j=0;j<numConstraints;j++)
+		m_jointRowOffsets[i] = totalNumRows;
+		m_jointSolverBodyIds[2*i] = m_jointSolverBodyIds[2*i+1] = -1;
+		int numRows = m_tmpConstraintSizesPool[i].m_numConstraintRows;
+		if (numRows)
 		{
-			b3TypedConstraint* constraint = constraints[j];
-			
-			constraint->internalSetAppliedImpulse(0.0f);
+			m_jointSolverBodyIds[2*i] = assignSolverBody(constraints[i]->getRigidBodyA(),bodies);
+			m_jointSolverBodyIds[2*i+1] = assignSolverBody(constraints[i]->getRigidBodyB(),bodies);
+			int overrideNumSolverIterations = constraints[i]->getOverrideNumSolverIterations() > 0 ? constraints[i]->getOverrideNumSolverIterations() : infoGlobal.m_numIterations;
+			if (overrideNumSolverIterations>m_maxOverrideNumSolverIterations)
+				m_maxOverrideNumSolverIterations = overrideNumSolverIterations;
 		}
+		totalNumRows += numRows;
 	}
+	m_jointRowOffsets[numConstraints] = totalNumRows;
 
-	//b3RigidBody* rb0=0,*rb1=0;
-	//if (1)
+	m_manifoldSolverBodyIds.resizeNoInitialize(2*numManifolds);
+	for (int i=0;i<numManifolds;i++)
 	{
-		{
+		m_manifoldSolverBodyIds[2*i] = assignSolverBody(manifoldPtr[i].getBodyA(),bodies);
+		m_manifoldSolverBodyIds[2*i+1] = assignSolverBody(manifoldPtr[i].getBodyB(),bodies);
+	}
+	m_tmpSolverBodyPool.resizeNoInitialize(m_solverBodyOriginalIndices.size());
+	runSetupInParallel(ctx,B3_SETUP_SOLVER_BODIES,m_tmpSolverBodyPool.size());
+
+	m_contactManifoldOffsets.resizeNoInitialize(numManifolds+1);
+	m_frictionManifoldOffsets.resizeNoInitialize(numManifolds+1);
+	m_rollingFrictionManifoldOffsets.resizeNoInitialize(numManifolds+1);
+	runSetupInParallel(ctx,B3_SETUP_CONTACT_SIZES,numManifolds);
+	int numContactRows = 0;
+	int numFrictionRows = 0;
+	int numRollingFrictionRows = 0;
+	for (int i=0;i<numManifolds;i++)
+	{
+		int contactRows = m_contactManifoldOffsets[i];
+		int frictionRows = m_frictionManifoldOffsets[i];
+		int rollingFrictionRows = m_rollingFrictionManifoldOffsets[i];
+		m_contactManifoldOffsets[i] = numContactRows;
+		m_frictionManifoldOffsets[i] = numFrictionRows;
+		m_rollingFrictionManifoldOffsets[i] = numRollingFrictionRows;
+		numContactRows += contactRows;
+		numFrictionRows += frictionRows;
+		numRollingFrictionRows += rollingFrictionRows;
+	}
+	m_contactManifoldOffsets[numManifolds] = numContactRows;
+	m_frictionManifoldOffsets[numManifolds] = numFrictionRows;
+	m_rollingFrictionManifoldOffsets[numManifolds] = numRollingFrictionRows;
+
+	//second pass: each joint and manifold fills its own rows in place
+	m_tmpSolverNonContactConstraintPool.resizeNoInitialize(totalNumRows);
+	m_tmpSolverContactConstraintPool.resizeNoInitialize(numContactRows);
+	m_tmpSolverContactFrictionConstraintPool.resizeNoInitialize(numFrictionRows);
+	m_tmpSolverContactRollingFrictionConstraintPool.resizeNoInitialize(numRollingFrictionRows);
+#ifndef DISABLE_JOINTS
+	if (infoGlobal.m_jointCacheAngularThreshold>b3Scalar(0.))
+		m_jointRowCache.resize(numConstraints);
+	else
+		m_jointRowCache.clear();
+	runSetupInParallel(ctx,B3_SETUP_JOINT_ROWS,numConstraints);
+#endif //DISABLE_JOINTS
+	runSetupInParallel(ctx,B3_SETUP_CONTACT_ROWS,numManifolds);
 
-			int totalNumRows = 0;
-			int i;
-			
-			m_tmpConstraintSizesPool.resizeNoInitialize(numConstraints);
-			//calculate the total number of contraint rows
-			for (i=0;i<numConstraints;i++)
-			{
-				b3TypedConstraint::b3ConstraintInfo1& info1 = m_tmpConstraintSizesPool[i];
-				b3JointFeedback* fb = constraints[i]->getJointFeedback();
-				if (fb)
-				{
-					fb->m_appliedForceBodyA.setZero();
-					fb->m_appliedTorqueBodyA.setZero();
-					fb->m_appliedForceBodyB.setZero();
-					fb->m_appliedTorqueBodyB.setZero();
-				}
-
-				if (constraints[i]->isEnabled())
-				{
-				}
-				if (constraints[i]->isEnabled())
-				{
-					constraints[i]->getInfo1(&info1,bodies);
-				} else
-				{
-					info1.m_numConstraintRows = 0;
-					info1.nub = 0;
-				}
-				totalNumRows += info1.m_numConstraintRows;
-			}
-			m_tmpSolverNonContactConstraintPool.resizeNoInitialize(totalNumRows);
-
-			
-#ifndef DISABLE_JOINTS
-			///setup the b3SolverConstraints
-			int currentRow = 0;
-
-			for (i=0;i<numConstraints;i++)
-			{
-				const b3TypedConstraint::b3ConstraintInfo1& info1 = m_tmpConstraintSizesPool[i];
-				
-				if (info1.m_numConstraintRows)
-				{
-					b3Assert(currentRow<totalNumRows);
-
-					b3SolverConstraint* currentConstraintRow = &m_tmpSolverNonContactConstraintPool[currentRow];
-					b3TypedConstraint* constraint = constraints[i];
-
-					b3RigidBodyCL& rbA = bodies[ constraint->getRigidBodyA()];
-					//b3RigidBody& rbA = constraint->getRigidBodyA();
-	//				b3RigidBody& rbB = constraint->getRigidBodyB();
-					b3RigidBodyCL& rbB = bodies[ constraint->getRigidBodyB()];
-
-                    int solverBodyIdA = getOrInitSolverBody(constraint->getRigidBodyA(),bodies,inertias);
-                    int solverBodyIdB = getOrInitSolverBody(constraint->getRigidBodyB(),bodies,inertias);
-
-                    b3SolverBody* bodyAPtr = &m_tmpSolverBodyPool[solverBodyIdA];
-                    b3SolverBody* bodyBPtr = &m_tmpSolverBodyPool[solverBodyIdB];
-
-
-
-
-					int overrideNumSolverIterations = constraint->getOverrideNumSolverIterations() > 0 ? constraint->getOverrideNumSolverIterations() : infoGlobal.m_numIterations;
-					if (overrideNumSolverIterations>m_maxOverrideNumSolverIterations)
-						m_maxOverrideNumSolverIterations = overrideNumSolverIterations;
-
-
-					int j;
-					for ( j=0;j<info1.m_numConstraintRows;j++)
-					{
-						memset(&currentConstraintRow[j],0,sizeof(b3SolverConstraint));
-						currentConstraintRow[j].m_lowerLimit = -B3_INFINITY;
-						currentConstraintRow[j].m_upperLimit = B3_INFINITY;
-						currentConstraintRow[j].m_appliedImpulse = 0.f;
-						currentConstraintRow[j].m_appliedPushImpulse = 0.f;
-						currentConstraintRow[j].m_solverBodyIdA = solverBodyIdA;
-						currentConstraintRow[j].m_solverBodyIdB = solverBodyIdB;
-						currentConstraintRow[j].m_overrideNumSolverIterations = overrideNumSolverIterations;
-					}
-
-					bodyAPtr->internalGetDeltaLinearVelocity().setValue(0.f,0.f,0.f);
-					bodyAPtr->internalGetDeltaAngularVelocity().setValue(0.f,0.f,0.f);
-					bodyAPtr->internalGetPushVelocity().setValue(0.f,0.f,0.f);
-					bodyAPtr->internalGetTurnVelocity().setValue(0.f,0.f,0.f);
-					bodyBPtr->internalGetDeltaLinearVelocity().setValue(0.f,0.f,0.f);
-					bodyBPtr->internalGetDeltaAngularVelocity().setValue(0.f,0.f,0.f);
-					bodyBPtr->internalGetPushVelocity().setValue(0.f,0.f,0.f);
-					bodyBPtr->internalGetTurnVelocity().setValue(0.f,0.f,0.f);
-
-
-					b3TypedConstraint::b3ConstraintInfo2 info2;
-					info2.fps = 1.f/infoGlobal.m_timeStep;
-					info2.erp = infoGlobal.m_erp;
-					info2.m_J1linearAxis = currentConstraintRow->m_contactNormal;
-					info2.m_J1angularAxis = currentConstraintRow->m_relpos1CrossNormal;
-					info2.m_J2linearAxis = 0;
-					info2.m_J2angularAxis = currentConstraintRow->m_relpos2CrossNormal;
-					info2.rowskip = sizeof(b3SolverConstraint)/sizeof(b3Scalar);//check this
-					///the size of b3SolverConstraint needs be a multiple of b3Scalar
-		            b3Assert(info2.rowskip*sizeof(b3Scalar)== sizeof(b3SolverConstraint));
-					info2.m_constraintError = &currentConstraintRow->m_rhs;
-					currentConstraintRow->m_cfm = infoGlobal.m_globalCfm;
-					info2.m_damping = infoGlobal.m_damping;
-					info2.cfm = &currentConstraintRow->m_cfm;
-					info2.m_lowerLimit = &currentConstraintRow->m_lowerLimit;
-					info2.m_upperLimit = &currentConstraintRow->m_upperLimit;
-					info2.m_numIterations = infoGlobal.m_numIterations;
-					constraints[i]->getInfo2(&info2,bodies);
-
-					///finalize the constraint setup
-					for ( j=0;j<info1.m_numConstraintRows;j++)
-					{
-						b3SolverConstraint& solverConstraint = currentConstraintRow[j];
-
-						if (solverConstraint.m_upperLimit>=constraints[i]->getBreakingImpulseThreshold())
-						{
-							solverConstraint.m_upperLimit = constraints[i]->getBreakingImpulseThreshold();
-						}
-
-						if (solverConstraint.m_lowerLimit<=-constraints[i]->getBreakingImpulseThreshold())
-						{
-							solverConstraint.m_lowerLimit = -constraints[i]->getBreakingImpulseThreshold();
-						}
-
-						solverConstraint.m_originalContactPoint = constraint;
-							
-						b3Matrix3x3& invInertiaWorldA= inertias[constraint->getRigidBodyA()].m_invInertiaWorld;
-						{
-
-							//b3Vector3 angularFactorA(1,1,1);
-							const b3Vector3& ftorqueAxis1 = solverConstraint.m_relpos1CrossNormal;
-							solverConstraint.m_angularComponentA = invInertiaWorldA*ftorqueAxis1;//*angularFactorA;
-						}
-						
-						b3Matrix3x3& invInertiaWorldB= inertias[constraint->getRigidBodyB()].m_invInertiaWorld;
-						{
-
-							const b3Vector3& ftorqueAxis2 = solverConstraint.m_relpos2CrossNormal;
-							solverConstraint.m_angularComponentB = invInertiaWorldB*ftorqueAxis2;//*constraint->getRigidBodyB().getAngularFactor();
-						}
-
-						{
-							//it is ok to use solverConstraint.m_contactNormal instead of -solverConstraint.m_contactNormal
-							//because it gets multiplied iMJlB
-							b3Vector3 iMJlA = solverConstraint.m_contactNormal*rbA.getInvMass();
-							b3Vector3 iMJaA = invInertiaWorldA*solverConstraint.m_relpos1CrossNormal;
-							b3Vector3 iMJlB = solverConstraint.m_contactNormal*rbB.getInvMass();//sign of normal?
-							b3Vector3 iMJaB = invInertiaWorldB*solverConstraint.m_relpos2CrossNormal;
-
-							b3Scalar sum = iMJlA.dot(solverConstraint.m_contactNormal);
-							sum += iMJaA.dot(solverConstraint.m_relpos1CrossNormal);
-							sum += iMJlB.dot(solverConstraint.m_contactNormal);
-							sum += iMJaB.dot(solverConstraint.m_relpos2CrossNormal);
-							b3Scalar fsum = b3Fabs(sum);
-							b3Assert(fsum > B3_EPSILON);
-							solverConstraint.m_jacDiagABInv = fsum>B3_EPSILON?b3Scalar(1.)/sum : 0.f;
-						}
-
-
-						///fix rhs
-						///todo: add force/torque accelerators
-						{
-							b3Scalar rel_vel;
-							b3Scalar vel1Dotn = solverConstraint.m_contactNormal.dot(rbA.m_linVel) + solverConstraint.m_relpos1CrossNormal.dot(rbA.m_angVel);
-							b3Scalar vel2Dotn = -solverConstraint.m_contactNormal.dot(rbB.m_linVel) + solverConstraint.m_relpos2CrossNormal.dot(rbB.m_angVel);
-
-							rel_vel = vel1Dotn+vel2Dotn;
-
-							b3Scalar restitution = 0.f;
-							b3Scalar positionalError = solverConstraint.m_rhs;//already filled in by getConstraintInfo2
-							b3Scalar	velocityError = restitution - rel_vel * info2.m_damping;
-							b3Scalar	penetrationImpulse = positionalError*solverConstraint.m_jacDiagABInv;
-							b3Scalar	velocityImpulse = velocityError *solverConstraint.m_jacDiagABInv;
-							solverConstraint.m_rhs = penetrationImpulse+velocityImpulse;
-							solverConstraint.m_appliedImpulse = 0.f;
-
-						}
-					}
-				}
-				currentRow+=m_tmpConstraintSizesPool[i].m_numConstraintRows;
-			}
-#endif //DISABLE_JOINTS
-		}
-
-
-		{
-			int i;
-
-			for (i=0;i<numManifolds;i++)
-			{
-				b3Contact4& manifold = manifoldPtr[i];
-				convertContact(bodies,inertias,&manifold,infoGlobal);
-			}
-		}
-	}
+	//manifolds share solver bodies, so the warm starting impulses are applied afterwards
+	if (infoGlobal.m_solverMode & B3_SOLVER_USE_WARMSTARTING)
+		applyWarmstartImpulses();
 
 //	b3ContactSolverInfo info = infoGlobal;
 
@@ -1373,6 +1801,11 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlySetup(b3RigidBodyCL* bodies,
 		}
 	}
 
+	if (m_usePgs)
+		buildIslands(numBodies,infoGlobal);
+	else
+		buildSplitBodies(numBodies);
+
 	return 0.f;
 
 }
@@ -1380,10 +1813,17 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlySetup(b3RigidBodyCL* bodies,
 
 b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint** constraints,int numConstraints,const b3ContactSolverInfo& infoGlobal)
 {
+	b3SolverResidual& residual = m_iterationResidual;
+	residual.reset();
 
-	int numNonContactPool = m_tmpSolverNonContactConstraintPool.size();
-	int numConstraintPool = m_tmpSolverContactConstraintPool.size();
-	int numFrictionPool = m_tmpSolverContactFrictionConstraintPool.size();
+	b3HotConstraintArray& nonContactRows = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_NON_CONTACT];
+	b3HotConstraintArray& contactRows = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT];
+	b3HotConstraintArray& frictionRows = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION];
+	b3HotConstraintArray& rollingFrictionRows = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_ROLLING_FRICTION];
+
+	int numNonContactPool = nonContactRows.size();
+	int numConstraintPool = contactRows.size();
+	int numFrictionPool = frictionRows.size();
 	
 	if (infoGlobal.m_solverMode & B3_SOLVER_RANDMIZE_ORDER)
 	{
@@ -1420,11 +1860,11 @@ b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint
 	if (infoGlobal.m_solverMode & B3_SOLVER_SIMD)
 	{
 		///solve all joint constraints, using SIMD, if available
-		for (int j=0;j<m_tmpSolverNonContactConstraintPool.size();j++)
+		for (int j=0;j<numNonContactPool;j++)
 		{
-			b3SolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[m_orderNonContactConstraintPool[j]];
+			b3SolverConstraintHot& constraint = nonContactRows[m_orderNonContactConstraintPool[j]];
 			if (iteration < constraint.m_overrideNumSolverIterations)
-				resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[constraint.m_solverBodyIdA],m_tmpSolverBodyPool[constraint.m_solverBodyIdB],constraint);
+				residual.addRow(resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[constraint.m_solverBodyIdA],m_tmpSolverBodyPool[constraint.m_solverBodyIdB],constraint,constraint.getLowerLimit(),constraint.getUpperLimit()));
 		}
 
 		if (iteration< infoGlobal.m_numIterations)
@@ -1433,7 +1873,7 @@ b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint
 			///solve all contact constraints using SIMD, if available
 			if (infoGlobal.m_solverMode & B3_SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
 			{
-				int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
+				int numPoolConstraints = numConstraintPool;
 				int multiplier = (infoGlobal.m_solverMode & B3_SOLVER_USE_2_FRICTION_DIRECTIONS)? 2 : 1;
 
 				for (int c=0;c<numPoolConstraints;c++)
@@ -1441,8 +1881,8 @@ b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint
 					b3Scalar totalImpulse =0;
 
 					{
-						const b3SolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[c]];
-						resolveSingleConstraintRowLowerLimitSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
+						b3SolverConstraintHot& solveManifold = contactRows[m_orderTmpConstraintPool[c]];
+						residual.addRow(resolveSingleConstraintRowLowerLimitSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold));
 						totalImpulse = solveManifold.m_appliedImpulse;
 					}
 					bool applyFriction = true;
@@ -1450,28 +1890,24 @@ b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint
 					{
 						{
 
-							b3SolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[c*multiplier]];
+							b3SolverConstraintHot& solveManifold = frictionRows[m_orderFrictionConstraintPool[c*multiplier]];
 
 							if (totalImpulse>b3Scalar(0))
 							{
-								solveManifold.m_lowerLimit = -(solveManifold.m_friction*totalImpulse);
-								solveManifold.m_upperLimit = solveManifold.m_friction*totalImpulse;
-
-								resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
+								b3Scalar frictionMagnitude = solveManifold.getFriction()*totalImpulse;
+								residual.addRow(resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold,-frictionMagnitude,frictionMagnitude));
 							}
 						}
 
 						if (infoGlobal.m_solverMode & B3_SOLVER_USE_2_FRICTION_DIRECTIONS)
 						{
 
-							b3SolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[c*multiplier+1]];
+							b3SolverConstraintHot& solveManifold = frictionRows[m_orderFrictionConstraintPool[c*multiplier+1]];
 				
 							if (totalImpulse>b3Scalar(0))
 							{
-								solveManifold.m_lowerLimit = -(solveManifold.m_friction*totalImpulse);
-								solveManifold.m_upperLimit = solveManifold.m_friction*totalImpulse;
-
-								resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
+								b3Scalar frictionMagnitude = solveManifold.getFriction()*totalImpulse;
+								residual.addRow(resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold,-frictionMagnitude,frictionMagnitude));
 							}
 						}
 					}
@@ -1481,14 +1917,20 @@ b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint
 			else//B3_SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS
 			{
 				//solve the friction constraints after all contact constraints, don't interleave them
-				int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
+				int numPoolConstraints = numConstraintPool;
 				int j;
 
-				for (j=0;j<numPoolConstraints;j++)
+				if (infoGlobal.m_solverMode & B3_SOLVER_BLOCK_CONTACT_NORMALS)
 				{
-					const b3SolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
-					resolveSingleConstraintRowLowerLimitSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
+					solveContactManifoldBlocks(residual);
+				} else
+				{
+					for (j=0;j<numPoolConstraints;j++)
+					{
+						b3SolverConstraintHot& solveManifold = contactRows[m_orderTmpConstraintPool[j]];
+						residual.addRow(resolveSingleConstraintRowLowerLimitSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold));
 
+					}
 				}
 
 				if (!m_usePgs)
@@ -1497,38 +1939,34 @@ b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint
 
 				///solve all friction constraints, using SIMD, if available
 
-				int numFrictionPoolConstraints = m_tmpSolverContactFrictionConstraintPool.size();
+				int numFrictionPoolConstraints = numFrictionPool;
 				for (j=0;j<numFrictionPoolConstraints;j++)
 				{
-					b3SolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[j]];
-					b3Scalar totalImpulse = m_tmpSolverContactConstraintPool[solveManifold.m_frictionIndex].m_appliedImpulse;
+					b3SolverConstraintHot& solveManifold = frictionRows[m_orderFrictionConstraintPool[j]];
+					b3Scalar totalImpulse = contactRows[solveManifold.m_frictionIndex].m_appliedImpulse;
 
 					if (totalImpulse>b3Scalar(0))
 					{
-						solveManifold.m_lowerLimit = -(solveManifold.m_friction*totalImpulse);
-						solveManifold.m_upperLimit = solveManifold.m_friction*totalImpulse;
-
-						resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
+						b3Scalar frictionMagnitude = solveManifold.getFriction()*totalImpulse;
+						residual.addRow(resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold,-frictionMagnitude,frictionMagnitude));
 					}
 				}
 
 				
-				int numRollingFrictionPoolConstraints = m_tmpSolverContactRollingFrictionConstraintPool.size();
+				int numRollingFrictionPoolConstraints = rollingFrictionRows.size();
 				for (j=0;j<numRollingFrictionPoolConstraints;j++)
 				{
 
-					b3SolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[j];
-					b3Scalar totalImpulse = m_tmpSolverContactConstraintPool[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
+					b3SolverConstraintHot& rollingFrictionConstraint = rollingFrictionRows[j];
+					b3Scalar totalImpulse = contactRows[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
 					if (totalImpulse>b3Scalar(0))
 					{
-						b3Scalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction*totalImpulse;
-						if (rollingFrictionMagnitude>rollingFrictionConstraint.m_friction)
-							rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
+						b3Scalar rollingFrictionMagnitude = rollingFrictionConstraint.getFriction()*totalImpulse;
+						if (rollingFrictionMagnitude>rollingFrictionConstraint.getFriction())
+							rollingFrictionMagnitude = rollingFrictionConstraint.getFriction();
 
-						rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
-						rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
 
-						resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA],m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB],rollingFrictionConstraint);
+						residual.addRow(resolveSingleConstraintRowGenericSIMD(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA],m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB],rollingFrictionConstraint,-rollingFrictionMagnitude,rollingFrictionMagnitude));
 					}
 				}
 				
@@ -1539,100 +1977,121 @@ b3Scalar b3PgsJacobiSolver::solveSingleIteration(int iteration,b3TypedConstraint
 	{
 		//non-SIMD version
 		///solve all joint constraints
-		for (int j=0;j<m_tmpSolverNonContactConstraintPool.size();j++)
+		for (int j=0;j<numNonContactPool;j++)
 		{
-			b3SolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[m_orderNonContactConstraintPool[j]];
+			b3SolverConstraintHot& constraint = nonContactRows[m_orderNonContactConstraintPool[j]];
 			if (iteration < constraint.m_overrideNumSolverIterations)
-				resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[constraint.m_solverBodyIdA],m_tmpSolverBodyPool[constraint.m_solverBodyIdB],constraint);
+				residual.addRow(resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[constraint.m_solverBodyIdA],m_tmpSolverBodyPool[constraint.m_solverBodyIdB],constraint,constraint.getLowerLimit(),constraint.getUpperLimit()));
 		}
 
 		if (iteration< infoGlobal.m_numIterations)
 		{
 
 			///solve all contact constraints
-			int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
-			for (int j=0;j<numPoolConstraints;j++)
+			int numPoolConstraints = numConstraintPool;
+			if (infoGlobal.m_solverMode & B3_SOLVER_BLOCK_CONTACT_NORMALS)
+			{
+				solveContactManifoldBlocks(residual);
+			} else
 			{
-				const b3SolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
-				resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
+				for (int j=0;j<numPoolConstraints;j++)
+				{
+					b3SolverConstraintHot& solveManifold = contactRows[m_orderTmpConstraintPool[j]];
+					residual.addRow(resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold));
+				}
 			}
 			///solve all friction constraints
-			int numFrictionPoolConstraints = m_tmpSolverContactFrictionConstraintPool.size();
+			int numFrictionPoolConstraints = numFrictionPool;
 			for (int j=0;j<numFrictionPoolConstraints;j++)
 			{
-				b3SolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[j]];
-				b3Scalar totalImpulse = m_tmpSolverContactConstraintPool[solveManifold.m_frictionIndex].m_appliedImpulse;
+				b3SolverConstraintHot& solveManifold = frictionRows[m_orderFrictionConstraintPool[j]];
+				b3Scalar totalImpulse = contactRows[solveManifold.m_frictionIndex].m_appliedImpulse;
 
 				if (totalImpulse>b3Scalar(0))
 				{
-					solveManifold.m_lowerLimit = -(solveManifold.m_friction*totalImpulse);
-					solveManifold.m_upperLimit = solveManifold.m_friction*totalImpulse;
-
-					resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
+					b3Scalar frictionMagnitude = solveManifold.getFriction()*totalImpulse;
+					residual.addRow(resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold,-frictionMagnitude,frictionMagnitude));
 				}
 			}
 
-			int numRollingFrictionPoolConstraints = m_tmpSolverContactRollingFrictionConstraintPool.size();
+			int numRollingFrictionPoolConstraints = rollingFrictionRows.size();
 			for (int j=0;j<numRollingFrictionPoolConstraints;j++)
 			{
-				b3SolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[j];
-				b3Scalar totalImpulse = m_tmpSolverContactConstraintPool[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
+				b3SolverConstraintHot& rollingFrictionConstraint = rollingFrictionRows[j];
+				b3Scalar totalImpulse = contactRows[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
 				if (totalImpulse>b3Scalar(0))
 				{
-					b3Scalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction*totalImpulse;
-					if (rollingFrictionMagnitude>rollingFrictionConstraint.m_friction)
-						rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
+					b3Scalar rollingFrictionMagnitude = rollingFrictionConstraint.getFriction()*totalImpulse;
+					if (rollingFrictionMagnitude>rollingFrictionConstraint.getFriction())
+						rollingFrictionMagnitude = rollingFrictionConstraint.getFriction();
 
-					rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
-					rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
 
-					resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA],m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB],rollingFrictionConstraint);
+					residual.addRow(resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA],m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB],rollingFrictionConstraint,-rollingFrictionMagnitude,rollingFrictionMagnitude));
 				}
 			}
 		}
 	}
-	return 0.f;
+	return residual.m_maxDeltaImpulse;
 }
 
 
+///the largest push impulse change is below the split impulse threshold after at least m_minNumIterations iterations
+static bool	b3SplitImpulseConverged(int iteration, const b3SolverResidual& residual, const b3ContactSolverInfo& infoGlobal)
+{
+	return infoGlobal.m_splitImpulseResidualThreshold>b3Scalar(0) && iteration+1>=infoGlobal.m_minNumIterations && residual.m_maxDeltaImpulse<infoGlobal.m_splitImpulseResidualThreshold;
+}
+
 void b3PgsJacobiSolver::solveGroupCacheFriendlySplitImpulseIterations(b3TypedConstraint** constraints,int numConstraints,const b3ContactSolverInfo& infoGlobal)
 {
-	int iteration;
-	if (infoGlobal.m_splitImpulse)
-	{
-		if (infoGlobal.m_solverMode & B3_SOLVER_SIMD)
-		{
-			for ( iteration = 0;iteration<infoGlobal.m_numIterations;iteration++)
-			{
-				{
-					int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
-					int j;
-					for (j=0;j<numPoolConstraints;j++)
-					{
-						const b3SolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
+	m_splitImpulseIterationStats.reset();
+	m_contactRowsColored = false;
+	if (!infoGlobal.m_splitImpulse)
+		return;
 
-						resolveSplitPenetrationSIMD(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
-					}
-				}
-			}
-		}
-		else
+	if (canSolveSplitImpulseIterationsInParallel(infoGlobal))
+	{
+		solveSplitImpulseIterationsInParallel(infoGlobal);
+	} else
+	{
+		b3SolverBody fixedBody;
+		initSolverBody(-1,&fixedBody,0);
+		bool useSimd = (infoGlobal.m_solverMode & B3_SOLVER_SIMD)!=0;
+		int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
+		for (int iteration = 0;iteration<infoGlobal.m_numIterations;iteration++)
 		{
-			for ( iteration = 0;iteration<infoGlobal.m_numIterations;iteration++)
+			b3SolverResidual residual;
+			solveSplitImpulseRows(m_orderTmpConstraintPool,0,numPoolConstraints,useSimd,fixedBody,residual);
+			if (!m_usePgs)
+				averagePushVelocities();
+			m_splitImpulseIterationStats.m_residuals.push_back(residual);
+			m_splitImpulseIterationStats.m_numIterations = iteration+1;
+			if (b3SplitImpulseConverged(iteration,residual,infoGlobal))
 			{
-				{
-					int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
-					int j;
-					for (j=0;j<numPoolConstraints;j++)
-					{
-						const b3SolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
-
-						resolveSplitPenetrationImpulseCacheFriendly(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA],m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB],solveManifold);
-					}
-				}
+				m_splitImpulseIterationStats.m_converged = true;
+				break;
 			}
 		}
 	}
+
+	m_numSplitImpulseRecoveries = 0;
+	for (int i=0;i<m_splitImpulseIterationStats.m_residuals.size();i++)
+		m_numSplitImpulseRecoveries += m_splitImpulseIterationStats.m_residuals[i].m_numRows;
+}
+
+///the largest delta impulse is below the threshold after at least m_minNumIterations iterations
+static bool	b3ResidualConverged(int iteration, const b3SolverResidual& residual, const b3ContactSolverInfo& infoGlobal)
+{
+	return infoGlobal.m_residualThreshold>b3Scalar(0) && iteration+1>=infoGlobal.m_minNumIterations && residual.m_maxDeltaImpulse<infoGlobal.m_residualThreshold;
+}
+
+///the squared impulse change of an iteration is the squared length of its Jacobi step (each row is solved once).
+///The NNCG direction restarts (beta 0) when the step grows
+static b3Scalar	b3NncgBeta(b3Scalar deltaSq, b3Scalar prevDeltaSq)
+{
+	if (prevDeltaSq<=b3Scalar(0))
+		return b3Scalar(0);
+	b3Scalar beta = deltaSq/prevDeltaSq;
+	return beta>b3Scalar(1)? b3Scalar(0) : beta;
 }
 
 b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlyIterations(b3TypedConstraint** constraints,int numConstraints,const b3ContactSolverInfo& infoGlobal)
@@ -1644,10 +2103,51 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlyIterations(b3TypedConstraint*
 		solveGroupCacheFriendlySplitImpulseIterations(constraints,numConstraints,infoGlobal);
 
 		int maxIterations = m_maxOverrideNumSolverIterations > infoGlobal.m_numIterations? m_maxOverrideNumSolverIterations : infoGlobal.m_numIterations;
+		m_iterationStats.reset();
+
+		if (canSolveIterationsInParallel(infoGlobal))
+		{
+			//the row blocks pack their own copy of the rows
+			bool useRowBlocks = (infoGlobal.m_solverMode & B3_SOLVER_SIMD_ROW_BLOCKS)!=0;
+			if (!useRowBlocks)
+				packHotRows();
+			bool useIslands = !useRowBlocks && assignIslandBatchesToTasks(m_threadSupport->getNumTasks());
+			if (useIslands)
+				solveIslandsInParallel(infoGlobal);
+			else
+				solveIterationsInParallel(maxIterations,infoGlobal);
+			if (!useRowBlocks)
+				writeBackHotRows();
+			return 0.f;
+		}
+
+		packHotRows();
+		if (canSolveJacobiIterationsInParallel(infoGlobal))
+		{
+			solveJacobiIterationsInParallel(maxIterations,infoGlobal);
+			writeBackHotRows();
+			return 0.f;
+		}
+
+		bool useNncg = !m_usePgs && (infoGlobal.m_solverMode & B3_SOLVER_JACOBI_NNCG);
+		b3SolverBody fixedBody;
+		b3Scalar prevDeltaSq = 0.f;
+		if (useNncg)
+		{
+			initSolverBody(-1,&fixedBody,0);
+			initNncg();
+		}
 
 		for ( int iteration = 0 ; iteration< maxIterations ; iteration++)
 		//for ( int iteration = maxIterations-1  ; iteration >= 0;iteration--)
 		{			
+			//no step after the last contact iteration, there is no sweep left to use it
+			bool nncgIteration = useNncg && iteration+1<infoGlobal.m_numIterations;
+			if (nncgIteration)
+			{
+				for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+					storeNncgStartImpulses(pool,0,m_hotRowPools[pool].size());
+			}
 			
 			solveSingleIteration(iteration, constraints,numConstraints,infoGlobal);
 
@@ -1656,51 +2156,1211 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlyIterations(b3TypedConstraint*
 			{
 				averageVelocities();
 			}
+
+			m_iterationStats.m_residuals.push_back(m_iterationResidual);
+			m_iterationStats.m_numIterations = iteration+1;
+			if (b3ResidualConverged(iteration,m_iterationResidual,infoGlobal))
+			{
+				m_iterationStats.m_converged = true;
+				break;
+			}
+
+			if (nncgIteration)
+			{
+				for (int i=0;i<m_nncgChunkDeltaSq.size();i++)
+					m_nncgChunkDeltaSq[i] = computeNncgChunkDeltaSq(i);
+				b3Scalar deltaSq = getNncgDeltaSq();
+				b3Scalar beta = b3NncgBeta(deltaSq,prevDeltaSq);
+				prevDeltaSq = deltaSq;
+				for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+					applyNncgStep(pool,0,m_hotRowPools[pool].size(),beta,fixedBody);
+				if (beta>b3Scalar(0))
+					averageVelocities();
+			}
 		}
-		
+		writeBackHotRows();
 	}
 	return 0.f;
 }
 
-void	b3PgsJacobiSolver::averageVelocities()
+///greedy graph coloring, similar to b3GpuBatchingPgsSolver::sortConstraintByBatch3 but on solver body indices.
+///Static bodies are never written to, so they don't cause conflicts
+int	b3PgsJacobiSolver::sortConstraintRowsByBatch(const b3ConstraintArray& rows, b3AlignedObjectArray<int>& order, b3AlignedObjectArray<int>& batchOffsets)
 {
-	B3_PROFILE("averaging");
-	//average the velocities
-	int numBodies = m_bodyCount.size();
+	B3_PROFILE("sortConstraintRowsByBatch");
 
-	m_deltaLinearVelocities.resize(0);
-	m_deltaLinearVelocities.resize(numBodies,b3MakeVector3(0,0,0));
-	m_deltaAngularVelocities.resize(0);
-	m_deltaAngularVelocities.resize(numBodies,b3MakeVector3(0,0,0));
+	int numRows = rows.size();
+	order.resizeNoInitialize(numRows);
+	for (int i=0;i<numRows;i++)
+		order[i] = i;
 
-	for (int i=0;i<m_tmpSolverBodyPool.size();i++)
+	m_bodyBatchStamp.resize(0);
+	m_bodyBatchStamp.resize(m_tmpSolverBodyPool.size(),-1);
+
+	batchOffsets.resize(0);
+	int numBatchedRows = 0;
+	int batchIdx = 0;
+	while (numBatchedRows<numRows)
 	{
-		if (!m_tmpSolverBodyPool[i].m_invMass.isZero())
+		batchOffsets.push_back(numBatchedRows);
+		for (int i=numBatchedRows;i<numRows;i++)
 		{
-			int orgBodyIndex = m_tmpSolverBodyPool[i].m_originalBodyIndex;
-			m_deltaLinearVelocities[orgBodyIndex]+=m_tmpSolverBodyPool[i].getDeltaLinearVelocity();
-			m_deltaAngularVelocities[orgBodyIndex]+=m_tmpSolverBodyPool[i].getDeltaAngularVelocity();
+			const b3SolverConstraint& row = rows[order[i]];
+			int bodyA = row.m_solverBodyIdA;
+			int bodyB = row.m_solverBodyIdB;
+			bool aIsStatic = m_tmpSolverBodyPool[bodyA].m_invMass.isZero();
+			bool bIsStatic = m_tmpSolverBodyPool[bodyB].m_invMass.isZero();
+			if (!aIsStatic && m_bodyBatchStamp[bodyA]==batchIdx)
+				continue;
+			if (!bIsStatic && m_bodyBatchStamp[bodyB]==batchIdx)
+				continue;
+			if (!aIsStatic)
+				m_bodyBatchStamp[bodyA] = batchIdx;
+			if (!bIsStatic)
+				m_bodyBatchStamp[bodyB] = batchIdx;
+			b3Swap(order[i],order[numBatchedRows]);
+			numBatchedRows++;
 		}
+		batchIdx++;
 	}
-				
-	for (int i=0;i<m_tmpSolverBodyPool.size();i++)
+	batchOffsets.push_back(numRows);
+	return batchIdx;
+}
+
+bool	b3PgsJacobiSolver::canSolveIterationsInParallel(const b3ContactSolverInfo& infoGlobal) const
+{
+	if (!m_usePgs)
+		return false;
+	//the row blocks use the colored batches, also without threads
+	bool hasTasks = m_threadSupport && m_threadSupport->getNumTasks()>1;
+	if (!hasTasks && !(infoGlobal.m_solverMode & B3_SOLVER_SIMD_ROW_BLOCKS))
+		return false;
+	if (infoGlobal.m_solverMode & B3_SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
+		return false;
+	return (m_tmpSolverContactConstraintPool.size()+m_tmpSolverNonContactConstraintPool.size())>0;
+}
+
+struct b3PgsIterationsTask : public b3ThreadTask
+{
+	b3PgsJacobiSolver*	m_solver;
+	const b3ContactSolverInfo*	m_infoGlobal;
+	int	m_taskIndex;
+	int	m_numTasks;
+	int	m_maxIterations;
+
+	virtual void	run(void* lsMemory)
+	{
+		m_solver->solveBatchedIterations(m_taskIndex,m_numTasks,m_maxIterations,*m_infoGlobal);
+	}
+};
+
+void	b3PgsJacobiSolver::solveIterationsInParallel(int maxIterations, const b3ContactSolverInfo& infoGlobal)
+{
+	B3_PROFILE("solveIterationsInParallel");
+	{
+		B3_PROFILE("color constraint rows");
+		sortConstraintRowsByBatch(m_tmpSolverNonContactConstraintPool,m_orderNonContactConstraintPool,m_nonContactBatchOffsets);
+		//the parallel split impulse iterations already colored the contact rows of this step
+		if (m_contactRowsColored)
+		{
+			m_orderTmpConstraintPool.copyFromArray(m_orderSplitImpulseContactPool);
+			m_contactBatchOffsets.copyFromArray(m_splitImpulseBatchOffsets);
+		} else
+		{
+			sortConstraintRowsByBatch(m_tmpSolverContactConstraintPool,m_orderTmpConstraintPool,m_contactBatchOffsets);
+		}
+		sortConstraintRowsByBatch(m_tmpSolverContactFrictionConstraintPool,m_orderFrictionConstraintPool,m_frictionBatchOffsets);
+		sortConstraintRowsByBatch(m_tmpSolverContactRollingFrictionConstraintPool,m_orderRollingFrictionConstraintPool,m_rollingFrictionBatchOffsets);
+	}
+
+	b3ConstraintArray* pools[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS] = {&m_tmpSolverNonContactConstraintPool,&m_tmpSolverContactConstraintPool,
+		&m_tmpSolverContactFrictionConstraintPool,&m_tmpSolverContactRollingFrictionConstraintPool};
+	m_useRowBlocks = (infoGlobal.m_solverMode & B3_SOLVER_SIMD_ROW_BLOCKS)!=0;
+	if (m_useRowBlocks)
+	{
+		const b3AlignedObjectArray<int>* orders[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS] = {&m_orderNonContactConstraintPool,&m_orderTmpConstraintPool,
+			&m_orderFrictionConstraintPool,&m_orderRollingFrictionConstraintPool};
+		const b3AlignedObjectArray<int>* batchOffsets[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS] = {&m_nonContactBatchOffsets,&m_contactBatchOffsets,
+			&m_frictionBatchOffsets,&m_rollingFrictionBatchOffsets};
+		m_rowBlocks.build(m_tmpSolverBodyPool,pools,orders,batchOffsets);
+	}
+
+	int numTasks = m_threadSupport? m_threadSupport->getNumTasks() : 1;
+	m_taskResiduals.resize(numTasks*maxIterations);
+	m_taskNumIterations.resize(numTasks);
+	m_taskConverged.resize(numTasks);
+	if (numTasks<2)
+	{
+		solveBatchedIterations(0,1,maxIterations,infoGlobal);
+	} else
+	{
+		m_stackAlloc.reserve(b3StackAlloc::getBlockSize<b3PgsIterationsTask>(numTasks));
+		b3Block* block = m_stackAlloc.beginBlock();
+		b3PgsIterationsTask* tasks = m_stackAlloc.allocateArray<b3PgsIterationsTask>(numTasks);
+		for (int t=0;t<numTasks;t++)
+		{
+			new (&tasks[t]) b3PgsIterationsTask();
+			tasks[t].m_solver = this;
+			tasks[t].m_infoGlobal = &infoGlobal;
+			tasks[t].m_taskIndex = t;
+			tasks[t].m_numTasks = numTasks;
+			tasks[t].m_maxIterations = maxIterations;
+			m_threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+		}
+		for (int t=0;t<numTasks;t++)
+		{
+			int arg0,arg1;
+			m_threadSupport->waitForResponse(&arg0,&arg1);
+		}
+		for (int t=0;t<numTasks;t++)
+			tasks[t].~b3PgsIterationsTask();
+		m_stackAlloc.endBlock(block);
+	}
+	mergeTaskResiduals(numTasks,maxIterations,m_iterationStats);
+
+	if (m_useRowBlocks)
+	{
+		m_rowBlocks.writeBack(m_tmpSolverBodyPool,pools);
+		m_useRowBlocks = false;
+	}
+}
+
+static void	b3GetBatchTaskRange(const b3AlignedObjectArray<int>& batchOffsets, int batch, int taskIndex, int numTasks, int& begin, int& end)
+{
+	int batchBegin = batchOffsets[batch];
+	int batchEnd = batchOffsets[batch+1];
+	int rowsPerTask = (batchEnd-batchBegin+numTasks-1)/numTasks;
+	begin = b3Min(batchBegin+taskIndex*rowsPerTask,batchEnd);
+	end = b3Min(begin+rowsPerTask,batchEnd);
+}
+
+inline b3SolverBody&	b3PgsJacobiSolver::getTaskSolverBody(int solverBodyId, b3SolverBody& fixedBody)
+{
+	return m_tmpSolverBodyPool[solverBodyId].m_invMass.isZero()? fixedBody : m_tmpSolverBodyPool[solverBodyId];
+}
+
+void	b3PgsJacobiSolver::solveNonContactRows(int begin, int end, int iteration, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual)
+{
+	for (int j=begin;j<end;j++)
 	{
-		int orgBodyIndex = m_tmpSolverBodyPool[i].m_originalBodyIndex;
+		b3SolverConstraintHot& constraint = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_NON_CONTACT][m_orderNonContactConstraintPool[j]];
+		if (iteration < constraint.m_overrideNumSolverIterations)
+		{
+			b3SolverBody& bodyA = getTaskSolverBody(constraint.m_solverBodyIdA,fixedBody);
+			b3SolverBody& bodyB = getTaskSolverBody(constraint.m_solverBodyIdB,fixedBody);
+			if (useSimd)
+				residual.addRow(resolveSingleConstraintRowGenericSIMD(bodyA,bodyB,constraint,constraint.getLowerLimit(),constraint.getUpperLimit()));
+			else
+				residual.addRow(resolveSingleConstraintRowGeneric(bodyA,bodyB,constraint,constraint.getLowerLimit(),constraint.getUpperLimit()));
+		}
+	}
+}
 
+void	b3PgsJacobiSolver::solveContactRows(int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual)
+{
+	for (int j=begin;j<end;j++)
+	{
+		b3SolverConstraintHot& solveManifold = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT][m_orderTmpConstraintPool[j]];
+		b3SolverBody& bodyA = getTaskSolverBody(solveManifold.m_solverBodyIdA,fixedBody);
+		b3SolverBody& bodyB = getTaskSolverBody(solveManifold.m_solverBodyIdB,fixedBody);
+		if (useSimd)
+			residual.addRow(resolveSingleConstraintRowLowerLimitSIMD(bodyA,bodyB,solveManifold));
+		else
+			residual.addRow(resolveSingleConstraintRowLowerLimit(bodyA,bodyB,solveManifold));
+	}
+}
+
+void	b3PgsJacobiSolver::solveSplitImpulseRows(const b3AlignedObjectArray<int>& order, int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual)
+{
+	for (int j=begin;j<end;j++)
+	{
+		const b3SolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[order[j]];
+		if (!solveManifold.m_rhsPenetration)
+			continue;
+		b3SolverBody& bodyA = getTaskSolverBody(solveManifold.m_solverBodyIdA,fixedBody);
+		b3SolverBody& bodyB = getTaskSolverBody(solveManifold.m_solverBodyIdB,fixedBody);
+		if (useSimd)
+			residual.addRow(resolveSplitPenetrationSIMD(bodyA,bodyB,solveManifold));
+		else
+			residual.addRow(resolveSplitPenetrationImpulseCacheFriendly(bodyA,bodyB,solveManifold));
+	}
+}
+
+void	b3PgsJacobiSolver::solveFrictionRows(int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual)
+{
+	for (int j=begin;j<end;j++)
+	{
+		b3SolverConstraintHot& solveManifold = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION][m_orderFrictionConstraintPool[j]];
+		b3Scalar totalImpulse = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT][solveManifold.m_frictionIndex].m_appliedImpulse;
+		if (totalImpulse>b3Scalar(0))
+		{
+			b3Scalar frictionMagnitude = solveManifold.getFriction()*totalImpulse;
+			b3SolverBody& bodyA = getTaskSolverBody(solveManifold.m_solverBodyIdA,fixedBody);
+			b3SolverBody& bodyB = getTaskSolverBody(solveManifold.m_solverBodyIdB,fixedBody);
+			if (useSimd)
+				residual.addRow(resolveSingleConstraintRowGenericSIMD(bodyA,bodyB,solveManifold,-frictionMagnitude,frictionMagnitude));
+			else
+				residual.addRow(resolveSingleConstraintRowGeneric(bodyA,bodyB,solveManifold,-frictionMagnitude,frictionMagnitude));
+		}
+	}
+}
+
+void	b3PgsJacobiSolver::solveRollingFrictionRows(int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual)
+{
+	for (int j=begin;j<end;j++)
+	{
+		b3SolverConstraintHot& rollingFrictionConstraint = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_ROLLING_FRICTION][m_orderRollingFrictionConstraintPool[j]];
+		b3Scalar totalImpulse = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT][rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
+		if (totalImpulse>b3Scalar(0))
+		{
+			b3Scalar rollingFrictionMagnitude = rollingFrictionConstraint.getFriction()*totalImpulse;
+			if (rollingFrictionMagnitude>rollingFrictionConstraint.getFriction())
+				rollingFrictionMagnitude = rollingFrictionConstraint.getFriction();
+
+			b3SolverBody& bodyA = getTaskSolverBody(rollingFrictionConstraint.m_solverBodyIdA,fixedBody);
+			b3SolverBody& bodyB = getTaskSolverBody(rollingFrictionConstraint.m_solverBodyIdB,fixedBody);
+			if (useSimd)
+				residual.addRow(resolveSingleConstraintRowGenericSIMD(bodyA,bodyB,rollingFrictionConstraint,-rollingFrictionMagnitude,rollingFrictionMagnitude));
+			else
+				residual.addRow(resolveSingleConstraintRowGeneric(bodyA,bodyB,rollingFrictionConstraint,-rollingFrictionMagnitude,rollingFrictionMagnitude));
+		}
+	}
+}
+
+void	b3PgsJacobiSolver::solveBatchedIterations(int taskIndex, int numTasks, int maxIterations, const b3ContactSolverInfo& infoGlobal)
+{
+	//each task applies the (zero) impulses on static bodies to its own fixed body, the shared static solver bodies are read-only
+	b3SolverBody fixedBody;
+	initSolverBody(-1,&fixedBody,0);
+	bool useSimd = (infoGlobal.m_solverMode & B3_SOLVER_SIMD)!=0;
+
+	//indexed by b3SolverRowBlocks::b3RowBlockPool, the task ranges are rows or row blocks
+	const b3AlignedObjectArray<int>* batchOffsets[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS] = 
+		{&m_nonContactBatchOffsets,&m_contactBatchOffsets,&m_frictionBatchOffsets,&m_rollingFrictionBatchOffsets};
+	if (m_useRowBlocks)
+	{
+		for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+			batchOffsets[pool] = &m_rowBlocks.getBatchBlockOffsets(pool);
+	}
+
+	b3SolverResidual* taskResiduals = maxIterations? &m_taskResiduals[taskIndex*maxIterations] : 0;
+	m_taskNumIterations[taskIndex] = 0;
+	m_taskConverged[taskIndex] = 0;
+
+	for (int iteration=0;iteration<maxIterations;iteration++)
+	{
+		b3SolverResidual& residual = taskResiduals[iteration];
+		residual.reset();
+		m_taskNumIterations[taskIndex] = iteration+1;
+
+		//only the non-contact rows can run more than m_numIterations
+		int numPools = (iteration < infoGlobal.m_numIterations)? b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS : 1;
+		for (int pool=0;pool<numPools;pool++)
+		{
+			int numBatches = batchOffsets[pool]->size()-1;
+			for (int b=0;b<numBatches;b++)
+			{
+				int begin,end;
+				b3GetBatchTaskRange(*batchOffsets[pool],b,taskIndex,numTasks,begin,end);
+				if (m_useRowBlocks)
+				{
+					m_rowBlocks.solveBlocks(pool,begin,end,iteration,residual);
+				} else
+				{
+					switch (pool)
+					{
+					case b3SolverRowBlocks::B3_ROW_BLOCKS_NON_CONTACT:
+						solveNonContactRows(begin,end,iteration,useSimd,fixedBody,residual);
+						break;
+					case b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT:
+						solveContactRows(begin,end,useSimd,fixedBody,residual);
+						break;
+					case b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION:
+						solveFrictionRows(begin,end,useSimd,fixedBody,residual);
+						break;
+					default:
+						solveRollingFrictionRows(begin,end,useSimd,fixedBody,residual);
+					}
+				}
+				if (numTasks>1)
+					m_barrier->sync();
+			}
+		}
+
+		if (infoGlobal.m_residualThreshold>b3Scalar(0) && iteration+1>=infoGlobal.m_minNumIterations)
+		{
+			//all partial residuals of this iteration are written, every task merges them in the same order and stops at the same iteration
+			if (numTasks>1)
+				m_barrier->sync();
+			b3SolverResidual iterationResidual;
+			for (int t=0;t<numTasks;t++)
+				iterationResidual.merge(m_taskResiduals[t*maxIterations+iteration]);
+			if (b3ResidualConverged(iteration,iterationResidual,infoGlobal))
+			{
+				m_taskConverged[taskIndex] = 1;
+				break;
+			}
+		}
+	}
+}
+
+void	b3PgsJacobiSolver::mergeTaskResiduals(int numTasks, int maxIterations, b3SolverIterationStats& stats)
+{
+	int numIterations = 0;
+	bool converged = true;
+	for (int t=0;t<numTasks;t++)
+	{
+		numIterations = b3Max(numIterations,m_taskNumIterations[t]);
+		converged = converged && m_taskConverged[t];
+	}
+	stats.m_numIterations = numIterations;
+	stats.m_converged = converged;
+	stats.m_residuals.resize(numIterations);
+	for (int i=0;i<numIterations;i++)
+	{
+		b3SolverResidual& residual = stats.m_residuals[i];
+		residual.reset();
+		//the iterations a task didn't run were reset before the task started
+		for (int t=0;t<numTasks;t++)
+		{
+			if (i<m_taskNumIterations[t])
+				residual.merge(m_taskResiduals[t*maxIterations+i]);
+		}
+	}
+}
+
+bool	b3PgsJacobiSolver::canSolveSplitImpulseIterationsInParallel(const b3ContactSolverInfo& infoGlobal) const
+{
+	//the push impulses only need the colored contact rows, the PGS velocity solve may still run serially
+	if (!m_usePgs || !m_threadSupport || m_threadSupport->getNumTasks()<2)
+		return false;
+	return m_tmpSolverContactConstraintPool.size()>0;
+}
+
+struct b3SplitImpulseIterationsTask : public b3ThreadTask
+{
+	b3PgsJacobiSolver*	m_solver;
+	const b3ContactSolverInfo*	m_infoGlobal;
+	int	m_taskIndex;
+	int	m_numTasks;
+
+	virtual void	run(void* lsMemory)
+	{
+		m_solver->solveSplitImpulseBatches(m_taskIndex,m_numTasks,*m_infoGlobal);
+	}
+};
+
+void	b3PgsJacobiSolver::solveSplitImpulseIterationsInParallel(const b3ContactSolverInfo& infoGlobal)
+{
+	B3_PROFILE("solveSplitImpulseIterationsInParallel");
+	{
+		B3_PROFILE("color contact rows");
+		//own order, m_orderTmpConstraintPool may hold the island order of the velocity solve
+		sortConstraintRowsByBatch(m_tmpSolverContactConstraintPool,m_orderSplitImpulseContactPool,m_splitImpulseBatchOffsets);
+		m_contactRowsColored = true;
+	}
+
+	int numTasks = m_threadSupport->getNumTasks();
+	int maxIterations = infoGlobal.m_numIterations;
+	m_taskResiduals.resize(numTasks*maxIterations);
+	m_taskNumIterations.resize(numTasks);
+	m_taskConverged.resize(numTasks);
+
+	m_stackAlloc.reserve(b3StackAlloc::getBlockSize<b3SplitImpulseIterationsTask>(numTasks));
+	b3Block* block = m_stackAlloc.beginBlock();
+	b3SplitImpulseIterationsTask* tasks = m_stackAlloc.allocateArray<b3SplitImpulseIterationsTask>(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		new (&tasks[t]) b3SplitImpulseIterationsTask();
+		tasks[t].m_solver = this;
+		tasks[t].m_infoGlobal = &infoGlobal;
+		tasks[t].m_taskIndex = t;
+		tasks[t].m_numTasks = numTasks;
+		m_threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+	}
+	for (int t=0;t<numTasks;t++)
+	{
+		int arg0,arg1;
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+	for (int t=0;t<numTasks;t++)
+		tasks[t].~b3SplitImpulseIterationsTask();
+	m_stackAlloc.endBlock(block);
+	mergeTaskResiduals(numTasks,maxIterations,m_splitImpulseIterationStats);
+}
+
+void	b3PgsJacobiSolver::solveSplitImpulseBatches(int taskIndex, int numTasks, const b3ContactSolverInfo& infoGlobal)
+{
+	//the shared static solver bodies stay read-only, see solveBatchedIterations
+	b3SolverBody fixedBody;
+	initSolverBody(-1,&fixedBody,0);
+	bool useSimd = (infoGlobal.m_solverMode & B3_SOLVER_SIMD)!=0;
+
+	int maxIterations = infoGlobal.m_numIterations;
+	b3SolverResidual* taskResiduals = maxIterations? &m_taskResiduals[taskIndex*maxIterations] : 0;
+	m_taskNumIterations[taskIndex] = 0;
+	m_taskConverged[taskIndex] = 0;
+	int numBatches = m_splitImpulseBatchOffsets.size()-1;
+
+	for (int iteration=0;iteration<maxIterations;iteration++)
+	{
+		b3SolverResidual& residual = taskResiduals[iteration];
+		residual.reset();
+		m_taskNumIterations[taskIndex] = iteration+1;
+
+		for (int b=0;b<numBatches;b++)
+		{
+			int begin,end;
+			b3GetBatchTaskRange(m_splitImpulseBatchOffsets,b,taskIndex,numTasks,begin,end);
+			solveSplitImpulseRows(m_orderSplitImpulseContactPool,begin,end,useSimd,fixedBody,residual);
+			m_barrier->sync();
+		}
+
+		if (infoGlobal.m_splitImpulseResidualThreshold>b3Scalar(0) && iteration+1>=infoGlobal.m_minNumIterations)
+		{
+			//all tasks merge the same partial residuals, so they stop at the same iteration
+			b3SolverResidual iterationResidual;
+			for (int t=0;t<numTasks;t++)
+				iterationResidual.merge(m_taskResiduals[t*maxIterations+iteration]);
+			if (b3SplitImpulseConverged(iteration,iterationResidual,infoGlobal))
+			{
+				m_taskConverged[taskIndex] = 1;
+				break;
+			}
+			//the residuals of this iteration are read before any task resets the ones of the next iteration
+			m_barrier->sync();
+		}
+	}
+}
+
+b3ConstraintArray&	b3PgsJacobiSolver::getRowPool(int pool)
+{
+	switch (pool)
+	{
+	case b3SolverRowBlocks::B3_ROW_BLOCKS_NON_CONTACT:
+		return m_tmpSolverNonContactConstraintPool;
+	case b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT:
+		return m_tmpSolverContactConstraintPool;
+	case b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION:
+		return m_tmpSolverContactFrictionConstraintPool;
+	default:
+		return m_tmpSolverContactRollingFrictionConstraintPool;
+	}
+}
+
+void	b3PgsJacobiSolver::packHotRows()
+{
+	B3_PROFILE("packHotRows");
+	for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+	{
+		const b3ConstraintArray& rows = getRowPool(pool);
+		b3HotConstraintArray& hotRows = m_hotRowPools[pool];
+		bool frictionRows = pool==b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION || pool==b3SolverRowBlocks::B3_ROW_BLOCKS_ROLLING_FRICTION;
+		hotRows.resizeNoInitialize(rows.size());
+		for (int j=0;j<rows.size();j++)
+			hotRows[j].pack(rows[j],frictionRows);
+	}
+}
+
+void	b3PgsJacobiSolver::writeBackHotRows()
+{
+	//the finish only needs the applied impulses, for the warm starting and the joint feedback
+	for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+	{
+		b3ConstraintArray& rows = getRowPool(pool);
+		const b3HotConstraintArray& hotRows = m_hotRowPools[pool];
+		for (int j=0;j<rows.size();j++)
+			rows[j].m_appliedImpulse = hotRows[j].m_appliedImpulse;
+	}
+}
+
+///rows per partial sum of the NNCG beta, the serial and the threaded iterations use the same chunks
+#define B3_NNCG_CHUNK_SIZE 256
+
+void	b3PgsJacobiSolver::initNncg()
+{
+	int numRows = 0;
+	for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+	{
+		m_nncgRowOffsets[pool] = numRows;
+		numRows += getRowPool(pool).size();
+	}
+	m_nncgRowOffsets[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS] = numRows;
+	m_nncgStartImpulses.resizeNoInitialize(numRows);
+	m_nncgDirections.resize(0);
+	m_nncgDirections.resize(numRows,b3Scalar(0));
+	m_nncgChunkDeltaSq.resizeNoInitialize((numRows+B3_NNCG_CHUNK_SIZE-1)/B3_NNCG_CHUNK_SIZE);
+}
+
+///sum of (lambda-lambdaStart)^2 over the rows of a chunk, the rows of all pools are numbered like m_nncgStartImpulses
+b3Scalar	b3PgsJacobiSolver::computeNncgChunkDeltaSq(int chunk) const
+{
+	int chunkBegin = chunk*B3_NNCG_CHUNK_SIZE;
+	int chunkEnd = b3Min(chunkBegin+B3_NNCG_CHUNK_SIZE,m_nncgRowOffsets[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS]);
+	b3Scalar deltaSq = 0.f;
+	for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+	{
+		const b3HotConstraintArray& rows = m_hotRowPools[pool];
+		int rowOffset = m_nncgRowOffsets[pool];
+		int begin = b3Max(chunkBegin,rowOffset);
+		int end = b3Min(chunkEnd,m_nncgRowOffsets[pool+1]);
+		for (int i=begin;i<end;i++)
+		{
+			b3Scalar deltaImpulse = rows[i-rowOffset].m_appliedImpulse-m_nncgStartImpulses[i];
+			deltaSq += deltaImpulse*deltaImpulse;
+		}
+	}
+	return deltaSq;
+}
+
+b3Scalar	b3PgsJacobiSolver::getNncgDeltaSq() const
+{
+	b3Scalar deltaSq = 0.f;
+	for (int i=0;i<m_nncgChunkDeltaSq.size();i++)
+		deltaSq += m_nncgChunkDeltaSq[i];
+	return deltaSq;
+}
+
+void	b3PgsJacobiSolver::storeNncgStartImpulses(int pool, int begin, int end)
+{
+	const b3HotConstraintArray& rows = m_hotRowPools[pool];
+	int rowOffset = m_nncgRowOffsets[pool];
+	for (int j=begin;j<end;j++)
+		m_nncgStartImpulses[rowOffset+j] = rows[j].m_appliedImpulse;
+}
+
+///NNCG step of the rows [begin,end) of a pool after a Jacobi iteration: the impulses move further along the direction of the previous
+///steps, lambda += beta*p, and the direction becomes p = beta*p + (lambda-lambdaStart).
+///The new impulses are projected onto the row limits, the friction rows onto the cone of the already stepped contact rows
+void	b3PgsJacobiSolver::applyNncgStep(int pool, int begin, int end, b3Scalar beta, b3SolverBody& fixedBody)
+{
+	b3HotConstraintArray& rows = m_hotRowPools[pool];
+	const b3HotConstraintArray& contactRows = m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT];
+	bool frictionPool = (pool==b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION || pool==b3SolverRowBlocks::B3_ROW_BLOCKS_ROLLING_FRICTION);
+	int rowOffset = m_nncgRowOffsets[pool];
+	for (int j=begin;j<end;j++)
+	{
+		b3SolverConstraintHot& c = rows[j];
+		b3Scalar& direction = m_nncgDirections[rowOffset+j];
+		b3Scalar deltaImpulse = beta*direction;
+		direction = deltaImpulse + (c.m_appliedImpulse-m_nncgStartImpulses[rowOffset+j]);
+		if (deltaImpulse==b3Scalar(0))
+			continue;
+
+		b3Scalar lowerLimit,upperLimit;
+		if (frictionPool)
+		{
+			upperLimit = b3Max(c.getFriction()*contactRows[c.m_frictionIndex].m_appliedImpulse,b3Scalar(0));
+			if (pool==b3SolverRowBlocks::B3_ROW_BLOCKS_ROLLING_FRICTION && upperLimit>c.getFriction())
+				upperLimit = c.getFriction();
+			lowerLimit = -upperLimit;
+		} else
+		{
+			lowerLimit = c.getLowerLimit();
+			upperLimit = c.getUpperLimit();
+		}
+		b3Scalar impulse = b3Min(b3Max(c.m_appliedImpulse+deltaImpulse,lowerLimit),upperLimit);
+		deltaImpulse = impulse-c.m_appliedImpulse;
+		if (deltaImpulse==b3Scalar(0))
+			continue;
+
+		c.m_appliedImpulse = impulse;
+		b3SolverBody& body1 = getTaskSolverBody(c.m_solverBodyIdA,fixedBody);
+		b3SolverBody& body2 = getTaskSolverBody(c.m_solverBodyIdB,fixedBody);
+		const b3Vector3 contactNormal = b3SolverRowXyz(c.m_contactNormal);
+		body1.internalApplyImpulse(contactNormal*body1.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentA),deltaImpulse);
+		body2.internalApplyImpulse(-contactNormal*body2.internalGetInvMass(),b3SolverRowXyz(c.m_angularComponentB),deltaImpulse);
+	}
+}
+
+bool	b3PgsJacobiSolver::canSolveJacobiIterationsInParallel(const b3ContactSolverInfo& infoGlobal) const
+{
+	if (m_usePgs || !m_threadSupport || m_threadSupport->getNumTasks()<2)
+		return false;
+	if (infoGlobal.m_solverMode & B3_SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
+		return false;
+	//the tasks own whole joints and manifolds, each with its own solver body copies
+	int numJoints = m_jointRowOffsets.size()-1;
+	int numManifolds = m_contactManifoldOffsets.size()-1;
+	if (m_jointRowOffsets[numJoints]!=m_tmpSolverNonContactConstraintPool.size())
+		return false;
+	if (m_contactManifoldOffsets[numManifolds]!=m_tmpSolverContactConstraintPool.size())
+		return false;
+	return (m_tmpSolverNonContactConstraintPool.size()+m_tmpSolverContactConstraintPool.size())>0;
+}
+
+///splits the items with row offsets itemRowOffsets over the tasks, whole items and about the same number of rows per task
+static void	b3SplitItemsOverTasks(const b3AlignedObjectArray<int>& itemRowOffsets, int numTasks, b3AlignedObjectArray<int>& taskItemOffsets)
+{
+	int numItems = itemRowOffsets.size()-1;
+	int numRows = itemRowOffsets[numItems];
+	taskItemOffsets.resize(numTasks+1);
+	int item = 0;
+	for (int t=0;t<numTasks;t++)
+	{
+		taskItemOffsets[t] = item;
+		int taskRowEnd = int((long long)numRows*(t+1)/numTasks);
+		while (item<numItems && itemRowOffsets[item+1]<=taskRowEnd)
+			item++;
+	}
+	taskItemOffsets[numTasks] = numItems;
+}
+
+struct b3JacobiIterationsTask : public b3ThreadTask
+{
+	b3PgsJacobiSolver*	m_solver;
+	const b3ContactSolverInfo*	m_infoGlobal;
+	int	m_taskIndex;
+	int	m_numTasks;
+	int	m_maxIterations;
+
+	virtual void	run(void* lsMemory)
+	{
+		m_solver->solveJacobiIterations(m_taskIndex,m_numTasks,m_maxIterations,*m_infoGlobal);
+	}
+};
+
+void	b3PgsJacobiSolver::solveJacobiIterationsInParallel(int maxIterations, const b3ContactSolverInfo& infoGlobal)
+{
+	B3_PROFILE("solveJacobiIterationsInParallel");
+
+	int numTasks = m_threadSupport->getNumTasks();
+	int numManifolds = m_contactManifoldOffsets.size()-1;
+	int numContactRows = m_contactManifoldOffsets[numManifolds];
+
+	b3SplitItemsOverTasks(m_jointRowOffsets,numTasks,m_taskJointOffsets);
+	b3SplitItemsOverTasks(m_contactManifoldOffsets,numTasks,m_taskManifoldOffsets);
+
+	//the rows of each joint and manifold are solved in pool order
+	for (int i=0;i<m_orderNonContactConstraintPool.size();i++)
+		m_orderNonContactConstraintPool[i] = i;
+	for (int i=0;i<numContactRows;i++)
+		m_orderTmpConstraintPool[i] = i;
+	for (int i=0;i<m_orderFrictionConstraintPool.size();i++)
+		m_orderFrictionConstraintPool[i] = i;
+	m_orderRollingFrictionConstraintPool.resizeNoInitialize(m_tmpSolverContactRollingFrictionConstraintPool.size());
+	for (int i=0;i<m_orderRollingFrictionConstraintPool.size();i++)
+		m_orderRollingFrictionConstraintPool[i] = i;
+
+	if (infoGlobal.m_solverMode & B3_SOLVER_JACOBI_NNCG)
+		initNncg();
+
+	m_taskResiduals.resize(numTasks*maxIterations);
+	m_taskNumIterations.resize(numTasks);
+	m_taskConverged.resize(numTasks);
+
+	m_stackAlloc.reserve(b3StackAlloc::getBlockSize<b3JacobiIterationsTask>(numTasks));
+	b3Block* block = m_stackAlloc.beginBlock();
+	b3JacobiIterationsTask* tasks = m_stackAlloc.allocateArray<b3JacobiIterationsTask>(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		new (&tasks[t]) b3JacobiIterationsTask();
+		tasks[t].m_solver = this;
+		tasks[t].m_infoGlobal = &infoGlobal;
+		tasks[t].m_taskIndex = t;
+		tasks[t].m_numTasks = numTasks;
+		tasks[t].m_maxIterations = maxIterations;
+		m_threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+	}
+	for (int t=0;t<numTasks;t++)
+	{
+		int arg0,arg1;
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+	for (int t=0;t<numTasks;t++)
+		tasks[t].~b3JacobiIterationsTask();
+	m_stackAlloc.endBlock(block);
+	mergeTaskResiduals(numTasks,maxIterations,m_iterationStats);
+}
+
+void	b3PgsJacobiSolver::solveJacobiIterations(int taskIndex, int numTasks, int maxIterations, const b3ContactSolverInfo& infoGlobal)
+{
+	//the shared static solver bodies stay read-only, see solveBatchedIterations
+	b3SolverBody fixedBody;
+	initSolverBody(-1,&fixedBody,0);
+	bool useSimd = (infoGlobal.m_solverMode & B3_SOLVER_SIMD)!=0;
+	bool useNncg = (infoGlobal.m_solverMode & B3_SOLVER_JACOBI_NNCG)!=0;
+
+	//the rows of the joints and manifolds of this task only touch their own solver body copies
+	int manifoldBegin = m_taskManifoldOffsets[taskIndex];
+	int manifoldEnd = m_taskManifoldOffsets[taskIndex+1];
+	const b3AlignedObjectArray<int>* manifoldOffsets[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS] = 
+		{0,&m_contactManifoldOffsets,&m_frictionManifoldOffsets,&m_rollingFrictionManifoldOffsets};
+	int rowBegin[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS];
+	int rowEnd[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS];
+	rowBegin[0] = m_jointRowOffsets[m_taskJointOffsets[taskIndex]];
+	rowEnd[0] = m_jointRowOffsets[m_taskJointOffsets[taskIndex+1]];
+	for (int pool=1;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+	{
+		rowBegin[pool] = (*manifoldOffsets[pool])[manifoldBegin];
+		rowEnd[pool] = (*manifoldOffsets[pool])[manifoldEnd];
+	}
+
+	//the averaging is split over the original bodies
+	int numBodies = m_splitBodyOffsets.size()-1;
+	int bodiesPerTask = (numBodies+numTasks-1)/numTasks;
+	int bodyBegin = b3Min(taskIndex*bodiesPerTask,numBodies);
+	int bodyEnd = b3Min(bodyBegin+bodiesPerTask,numBodies);
+
+	b3SolverResidual* taskResiduals = maxIterations? &m_taskResiduals[taskIndex*maxIterations] : 0;
+	m_taskNumIterations[taskIndex] = 0;
+	m_taskConverged[taskIndex] = 0;
+	b3Scalar prevDeltaSq = 0.f;
+
+	for (int iteration=0;iteration<maxIterations;iteration++)
+	{
+		b3SolverResidual& residual = taskResiduals[iteration];
+		residual.reset();
+		m_taskNumIterations[taskIndex] = iteration+1;
+
+		bool solveContacts = iteration<infoGlobal.m_numIterations;
+		bool nncgIteration = useNncg && iteration+1<infoGlobal.m_numIterations;
+		if (nncgIteration)
+		{
+			for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+				storeNncgStartImpulses(pool,rowBegin[pool],rowEnd[pool]);
+		}
+		solveNonContactRows(rowBegin[b3SolverRowBlocks::B3_ROW_BLOCKS_NON_CONTACT],rowEnd[b3SolverRowBlocks::B3_ROW_BLOCKS_NON_CONTACT],iteration,useSimd,fixedBody,residual);
+		if (solveContacts)
+		{
+			solveContactRows(rowBegin[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT],rowEnd[b3SolverRowBlocks::B3_ROW_BLOCKS_CONTACT],useSimd,fixedBody,residual);
+			if (useSimd)
+			{
+				//like the serial SIMD iterations, the friction rows see the averaged normal impulses
+				m_barrier->sync();
+				averageSplitBodyVelocities(bodyBegin,bodyEnd);
+				m_barrier->sync();
+			}
+			solveFrictionRows(rowBegin[b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION],rowEnd[b3SolverRowBlocks::B3_ROW_BLOCKS_FRICTION],useSimd,fixedBody,residual);
+			solveRollingFrictionRows(rowBegin[b3SolverRowBlocks::B3_ROW_BLOCKS_ROLLING_FRICTION],rowEnd[b3SolverRowBlocks::B3_ROW_BLOCKS_ROLLING_FRICTION],useSimd,fixedBody,residual);
+		}
+		m_barrier->sync();
+		averageSplitBodyVelocities(bodyBegin,bodyEnd);
+		m_barrier->sync();
+
+		//every task merges the partial residuals in the same order, so all agree on the early exit
+		b3SolverResidual iterationResidual;
+		for (int t=0;t<numTasks;t++)
+			iterationResidual.merge(m_taskResiduals[t*maxIterations+iteration]);
+		if (b3ResidualConverged(iteration,iterationResidual,infoGlobal))
+		{
+			m_taskConverged[taskIndex] = 1;
+			break;
+		}
+
+		if (nncgIteration)
+		{
+			//beta comes from the same chunk sums as in the serial iterations, so the threads match them bitwise
+			int numChunks = m_nncgChunkDeltaSq.size();
+			int chunksPerTask = (numChunks+numTasks-1)/numTasks;
+			int chunkEnd = b3Min((taskIndex+1)*chunksPerTask,numChunks);
+			for (int i=taskIndex*chunksPerTask;i<chunkEnd;i++)
+				m_nncgChunkDeltaSq[i] = computeNncgChunkDeltaSq(i);
+			m_barrier->sync();
+			b3Scalar deltaSq = getNncgDeltaSq();
+			b3Scalar beta = b3NncgBeta(deltaSq,prevDeltaSq);
+			prevDeltaSq = deltaSq;
+			for (int pool=0;pool<b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS;pool++)
+				applyNncgStep(pool,rowBegin[pool],rowEnd[pool],beta,fixedBody);
+			if (beta>b3Scalar(0))
+			{
+				m_barrier->sync();
+				averageSplitBodyVelocities(bodyBegin,bodyEnd);
+				m_barrier->sync();
+			}
+		}
+	}
+}
+
+static int	b3FindIslandRoot(b3AlignedObjectArray<int>& unionFind, int x)
+{
+	while (unionFind[x]!=x)
+	{
+		//path halving
+		unionFind[x] = unionFind[unionFind[x]];
+		x = unionFind[x];
+	}
+	return x;
+}
+
+void	b3PgsJacobiSolver::uniteIslands(const b3ConstraintArray& rows)
+{
+	for (int i=0;i<rows.size();i++)
+	{
+		int bodyA = rows[i].m_solverBodyIdA;
+		int bodyB = rows[i].m_solverBodyIdB;
+		if (m_tmpSolverBodyPool[bodyA].m_invMass.isZero() || m_tmpSolverBodyPool[bodyB].m_invMass.isZero())
+			continue;
+		int rootA = b3FindIslandRoot(m_islandUnionFind,bodyA);
+		int rootB = b3FindIslandRoot(m_islandUnionFind,bodyB);
+		//the smallest solver body index is the root, so island indices follow the solver body order
+		if (rootA<rootB)
+			m_islandUnionFind[rootB] = rootA;
+		else if (rootB<rootA)
+			m_islandUnionFind[rootA] = rootB;
+	}
+}
+
+int	b3PgsJacobiSolver::getRowIsland(const b3SolverConstraint& row) const
+{
+	int island = m_solverBodyIslandIds[row.m_solverBodyIdA];
+	if (island<0)
+		island = m_solverBodyIslandIds[row.m_solverBodyIdB];
+	//rows between two static bodies don't change any velocity, keep them in the first island
+	return island<0? 0 : island;
+}
+
+void	b3PgsJacobiSolver::sortRowsByIslandBatch(const b3ConstraintArray& rows, b3AlignedObjectArray<int>& order, b3AlignedObjectArray<int>& batchOffsets, int numBatches)
+{
+	int numRows = rows.size();
+	batchOffsets.resize(0);
+	batchOffsets.resize(numBatches+1,0);
+	for (int i=0;i<numRows;i++)
+		batchOffsets[m_islandBatchIds[getRowIsland(rows[i])]+1]++;
+	for (int b=0;b<numBatches;b++)
+		batchOffsets[b+1] += batchOffsets[b];
+
+	//stable counting sort, keeps the row order within an island
+	m_bodyBatchStamp.resize(0);
+	m_bodyBatchStamp.resize(numBatches,0);
+	order.resizeNoInitialize(numRows);
+	for (int i=0;i<numRows;i++)
+	{
+		int batch = m_islandBatchIds[getRowIsland(rows[i])];
+		order[batchOffsets[batch]+m_bodyBatchStamp[batch]++] = i;
+	}
+}
+
+///union-find over the dynamic solver bodies, static bodies don't connect islands.
+///The islands are merged into island batches of at least m_minimumSolverBatchSize rows, each batch is solved as a single task
+int	b3PgsJacobiSolver::buildIslands(int numBodies, const b3ContactSolverInfo& infoGlobal)
+{
+	B3_PROFILE("buildIslands");
+	int numSolverBodies = m_tmpSolverBodyPool.size();
+	m_islandUnionFind.resizeNoInitialize(numSolverBodies);
+	for (int i=0;i<numSolverBodies;i++)
+		m_islandUnionFind[i] = i;
+
+	//friction rows share the bodies of their contact row
+	uniteIslands(m_tmpSolverNonContactConstraintPool);
+	uniteIslands(m_tmpSolverContactConstraintPool);
+
+	m_numIslands = 0;
+	m_solverBodyIslandIds.resizeNoInitialize(numSolverBodies);
+	m_bodyIslandIds.resize(0);
+	m_bodyIslandIds.resize(numBodies,-1);
+	for (int i=0;i<numSolverBodies;i++)
+	{
+		if (m_tmpSolverBodyPool[i].m_invMass.isZero())
+		{
+			m_solverBodyIslandIds[i] = -1;
+			continue;
+		}
+		int root = b3FindIslandRoot(m_islandUnionFind,i);
+		m_solverBodyIslandIds[i] = (root==i)? m_numIslands++ : m_solverBodyIslandIds[root];
+		m_bodyIslandIds[m_tmpSolverBodyPool[i].m_originalBodyIndex] = m_solverBodyIslandIds[i];
+	}
+	if (!m_numIslands)
+		m_numIslands = 1;
+
+	//number of rows and iterations of each island
+	b3AlignedObjectArray<int>& islandRows = m_islandBatchIds;
+	islandRows.resize(0);
+	islandRows.resize(m_numIslands,0);
+	m_islandIterations.resize(0);
+	m_islandIterations.resize(m_numIslands,infoGlobal.m_numIterations);
+	for (int i=0;i<m_tmpSolverNonContactConstraintPool.size();i++)
+	{
+		const b3SolverConstraint& row = m_tmpSolverNonContactConstraintPool[i];
+		int island = getRowIsland(row);
+		islandRows[island]++;
+		if (row.m_overrideNumSolverIterations>m_islandIterations[island])
+			m_islandIterations[island] = row.m_overrideNumSolverIterations;
+	}
+	for (int i=0;i<m_tmpSolverContactConstraintPool.size();i++)
+		islandRows[getRowIsland(m_tmpSolverContactConstraintPool[i])]++;
+	for (int i=0;i<m_tmpSolverContactFrictionConstraintPool.size();i++)
+		islandRows[getRowIsland(m_tmpSolverContactFrictionConstraintPool[i])]++;
+
+	//merge consecutive small islands
+	m_islandBatchWork.resize(0);
+	m_islandBatchIterations.resize(0);
+	int batchRows = 0;
+	int batchIterations = 0;
+	for (int island=0;island<m_numIslands;island++)
+	{
+		int rows = islandRows[island];
+		islandRows[island] = m_islandBatchIterations.size();
+		batchRows += rows;
+		batchIterations = b3Max(batchIterations,m_islandIterations[island]);
+		if (batchRows>=infoGlobal.m_minimumSolverBatchSize || island==m_numIslands-1)
+		{
+			m_islandBatchWork.push_back(batchRows*batchIterations);
+			m_islandBatchIterations.push_back(batchIterations);
+			batchRows = 0;
+			batchIterations = 0;
+		}
+	}
+	//islandRows aliases m_islandBatchIds, which now maps each island to its batch
+	int numBatches = m_islandBatchIterations.size();
+
+	sortRowsByIslandBatch(m_tmpSolverNonContactConstraintPool,m_orderNonContactConstraintPool,m_nonContactIslandOffsets,numBatches);
+	sortRowsByIslandBatch(m_tmpSolverContactConstraintPool,m_orderTmpConstraintPool,m_contactIslandOffsets,numBatches);
+	sortRowsByIslandBatch(m_tmpSolverContactFrictionConstraintPool,m_orderFrictionConstraintPool,m_frictionIslandOffsets,numBatches);
+	sortRowsByIslandBatch(m_tmpSolverContactRollingFrictionConstraintPool,m_orderRollingFrictionConstraintPool,m_rollingFrictionIslandOffsets,numBatches);
+
+	return m_numIslands;
+}
+
+struct b3IslandBatchWorkPredicate
+{
+	const int* m_work;
+
+	bool operator() ( int a, int b ) const
+	{
+		return (m_work[a]>m_work[b]) || (m_work[a]==m_work[b] && a<b);
+	}
+};
+
+///longest-processing-time-first assignment of the island batches to the tasks.
+///returns false when the largest task would get more than twice its share, the colored batches balance better in that case
+bool	b3PgsJacobiSolver::assignIslandBatchesToTasks(int numTasks)
+{
+	int numBatches = m_islandBatchIterations.size();
+	if (numBatches<2)
+		return false;
+
+	m_stackAlloc.reserve(sizeof(b3Block)+2*b3StackAlloc::getArraySize<int>(numBatches)+b3StackAlloc::getArraySize<int>(numTasks));
+	b3Block* block = m_stackAlloc.beginBlock();
+	b3AlignedObjectArray<int> sortedBatches;
+	sortedBatches.initializeFromBuffer(m_stackAlloc.allocateArray<int>(numBatches),numBatches,numBatches);
+	b3AlignedObjectArray<int> taskWork;
+	taskWork.initializeFromBuffer(m_stackAlloc.allocateArray<int>(numTasks),numTasks,numTasks);
+	b3AlignedObjectArray<int> batchTasks;
+	batchTasks.initializeFromBuffer(m_stackAlloc.allocateArray<int>(numBatches),numBatches,numBatches);
+	int totalWork = 0;
+	for (int b=0;b<numBatches;b++)
+	{
+		sortedBatches[b] = b;
+		totalWork += m_islandBatchWork[b];
+	}
+	b3IslandBatchWorkPredicate predicate;
+	predicate.m_work = &m_islandBatchWork[0];
+	sortedBatches.quickSort(predicate);
+
+	for (int t=0;t<numTasks;t++)
+		taskWork[t] = 0;
+	int maxTaskWork = 0;
+	for (int i=0;i<numBatches;i++)
+	{
+		int task = 0;
+		for (int t=1;t<numTasks;t++)
+		{
+			if (taskWork[t]<taskWork[task])
+				task = t;
+		}
+		batchTasks[sortedBatches[i]] = task;
+		taskWork[task] += m_islandBatchWork[sortedBatches[i]];
+		maxTaskWork = b3Max(maxTaskWork,taskWork[task]);
+	}
+	if (maxTaskWork*numTasks > 2*totalWork)
+	{
+		m_stackAlloc.endBlock(block);
+		return false;
+	}
+
+	m_taskIslandBatchOffsets.resize(0);
+	m_taskIslandBatchOffsets.resize(numTasks+1,0);
+	for (int b=0;b<numBatches;b++)
+		m_taskIslandBatchOffsets[batchTasks[b]+1]++;
+	for (int t=0;t<numTasks;t++)
+		m_taskIslandBatchOffsets[t+1] += m_taskIslandBatchOffsets[t];
+	for (int t=0;t<numTasks;t++)
+		taskWork[t] = 0;
+	m_taskIslandBatches.resizeNoInitialize(numBatches);
+	for (int b=0;b<numBatches;b++)
+	{
+		int task = batchTasks[b];
+		m_taskIslandBatches[m_taskIslandBatchOffsets[task]+taskWork[task]++] = b;
+	}
+	m_stackAlloc.endBlock(block);
+	return true;
+}
+
+struct b3PgsIslandsTask : public b3ThreadTask
+{
+	b3PgsJacobiSolver*	m_solver;
+	const b3ContactSolverInfo*	m_infoGlobal;
+	int	m_taskIndex;
+
+	virtual void	run(void* lsMemory)
+	{
+		m_solver->solveIslandBatches(m_taskIndex,*m_infoGlobal);
+	}
+};
+
+void	b3PgsJacobiSolver::solveIslandsInParallel(const b3ContactSolverInfo& infoGlobal)
+{
+	B3_PROFILE("solveIslandsInParallel");
+	int numTasks = m_threadSupport->getNumTasks();
+	int maxIterations = getMaxIslandBatchIterations();
+	m_taskResiduals.resize(numTasks*maxIterations);
+	m_taskNumIterations.resize(numTasks);
+	m_taskConverged.resize(numTasks);
+	m_stackAlloc.reserve(b3StackAlloc::getBlockSize<b3PgsIslandsTask>(numTasks));
+	b3Block* block = m_stackAlloc.beginBlock();
+	b3PgsIslandsTask* tasks = m_stackAlloc.allocateArray<b3PgsIslandsTask>(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		new (&tasks[t]) b3PgsIslandsTask();
+		tasks[t].m_solver = this;
+		tasks[t].m_infoGlobal = &infoGlobal;
+		tasks[t].m_taskIndex = t;
+		m_threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+	}
+	for (int t=0;t<numTasks;t++)
+	{
+		int arg0,arg1;
+		m_threadSupport->waitForResponse(&arg0,&arg1);
+	}
+	for (int t=0;t<numTasks;t++)
+		tasks[t].~b3PgsIslandsTask();
+	m_stackAlloc.endBlock(block);
+	mergeTaskResiduals(numTasks,maxIterations,m_iterationStats);
+}
+
+int	b3PgsJacobiSolver::getMaxIslandBatchIterations() const
+{
+	int maxIterations = 0;
+	for (int b=0;b<m_islandBatchIterations.size();b++)
+		maxIterations = b3Max(maxIterations,m_islandBatchIterations[b]);
+	return maxIterations;
+}
+
+void	b3PgsJacobiSolver::solveIslandBatches(int taskIndex, const b3ContactSolverInfo& infoGlobal)
+{
+	b3SolverBody fixedBody;
+	initSolverBody(-1,&fixedBody,0);
+	bool useSimd = (infoGlobal.m_solverMode & B3_SOLVER_SIMD)!=0;
+
+	int maxIterations = m_taskResiduals.size()/m_taskNumIterations.size();
+	b3SolverResidual* taskResiduals = maxIterations? &m_taskResiduals[taskIndex*maxIterations] : 0;
+	for (int i=0;i<maxIterations;i++)
+		taskResiduals[i].reset();
+	int taskNumIterations = 0;
+	bool taskConverged = true;
+
+	for (int i=m_taskIslandBatchOffsets[taskIndex];i<m_taskIslandBatchOffsets[taskIndex+1];i++)
+	{
+		int batch = m_taskIslandBatches[i];
+		int numIterations = m_islandBatchIterations[batch];
+		bool converged = false;
+		int iteration;
+		for (iteration=0;iteration<numIterations && !converged;iteration++)
+		{
+			//each island batch stops on its own residual
+			b3SolverResidual residual;
+			solveNonContactRows(m_nonContactIslandOffsets[batch],m_nonContactIslandOffsets[batch+1],iteration,useSimd,fixedBody,residual);
+			if (iteration<infoGlobal.m_numIterations)
+			{
+				solveContactRows(m_contactIslandOffsets[batch],m_contactIslandOffsets[batch+1],useSimd,fixedBody,residual);
+				solveFrictionRows(m_frictionIslandOffsets[batch],m_frictionIslandOffsets[batch+1],useSimd,fixedBody,residual);
+				solveRollingFrictionRows(m_rollingFrictionIslandOffsets[batch],m_rollingFrictionIslandOffsets[batch+1],useSimd,fixedBody,residual);
+			}
+			taskResiduals[iteration].merge(residual);
+			converged = b3ResidualConverged(iteration,residual,infoGlobal);
+		}
+		taskNumIterations = b3Max(taskNumIterations,iteration);
+		taskConverged = taskConverged && converged;
+	}
+	m_taskNumIterations[taskIndex] = taskNumIterations;
+	m_taskConverged[taskIndex] = taskConverged? 1 : 0;
+}
+
+void	b3PgsJacobiSolver::buildSplitBodies(int numBodies)
+{
+	//counting sort of the dynamic solver bodies by original body, in pool order
+	m_splitBodyOffsets.resize(0);
+	m_splitBodyOffsets.resize(numBodies+1,0);
+	for (int i=0;i<m_tmpSolverBodyPool.size();i++)
+	{
+		if (!m_tmpSolverBodyPool[i].m_invMass.isZero())
+			m_splitBodyOffsets[m_tmpSolverBodyPool[i].m_originalBodyIndex]++;
+	}
+	for (int i=1;i<=numBodies;i++)
+		m_splitBodyOffsets[i] += m_splitBodyOffsets[i-1];
+	m_splitBodies.resizeNoInitialize(m_splitBodyOffsets[numBodies]);
+	for (int i=m_tmpSolverBodyPool.size()-1;i>=0;i--)
+	{
 		if (!m_tmpSolverBodyPool[i].m_invMass.isZero())
+			m_splitBodies[--m_splitBodyOffsets[m_tmpSolverBodyPool[i].m_originalBodyIndex]] = i;
+	}
+}
+
+void	b3PgsJacobiSolver::averageSplitBodyVelocities(int bodyBegin, int bodyEnd)
+{
+	for (int orgBodyIndex=bodyBegin;orgBodyIndex<bodyEnd;orgBodyIndex++)
+	{
+		int begin = m_splitBodyOffsets[orgBodyIndex];
+		int end = m_splitBodyOffsets[orgBodyIndex+1];
+		if (begin==end)
+			continue;
+
+		b3Assert(m_bodyCount[orgBodyIndex] == m_bodyCountCheck[orgBodyIndex]);
+		b3Assert(m_bodyCount[orgBodyIndex] == end-begin);
+
+		b3Vector3 deltaLinearVelocity = b3MakeVector3(0,0,0);
+		b3Vector3 deltaAngularVelocity = b3MakeVector3(0,0,0);
+		for (int i=begin;i<end;i++)
+		{
+			deltaLinearVelocity += m_tmpSolverBodyPool[m_splitBodies[i]].getDeltaLinearVelocity();
+			deltaAngularVelocity += m_tmpSolverBodyPool[m_splitBodies[i]].getDeltaAngularVelocity();
+		}
+
+		//the sums are also used by solveGroupCacheFriendlyFinish
+		m_deltaLinearVelocities[orgBodyIndex] = deltaLinearVelocity;
+		m_deltaAngularVelocities[orgBodyIndex] = deltaAngularVelocity;
+
+		b3Scalar factor = 1.f/b3Scalar(end-begin);
+		for (int i=begin;i<end;i++)
 		{
-						
-			b3Assert(m_bodyCount[orgBodyIndex] == m_bodyCountCheck[orgBodyIndex]);
-						
-			b3Scalar factor = 1.f/b3Scalar(m_bodyCount[orgBodyIndex]);
-						
+			m_tmpSolverBodyPool[m_splitBodies[i]].m_deltaLinearVelocity = deltaLinearVelocity*factor;
+			m_tmpSolverBodyPool[m_splitBodies[i]].m_deltaAngularVelocity = deltaAngularVelocity*factor;
+		}
+	}
+}
 
-			m_tmpSolverBodyPool[i].m_deltaLinearVelocity = m_deltaLinearVelocities[orgBodyIndex]*factor;
-			m_tmpSolverBodyPool[i].m_deltaAngularVelocity = m_deltaAngularVelocities[orgBodyIndex]*factor;
+void	b3PgsJacobiSolver::averagePushVelocities()
+{
+	for (int orgBodyIndex=0;orgBodyIndex<m_splitBodyOffsets.size()-1;orgBodyIndex++)
+	{
+		int begin = m_splitBodyOffsets[orgBodyIndex];
+		int end = m_splitBodyOffsets[orgBodyIndex+1];
+		if (begin==end)
+			continue;
+
+		b3Vector3 pushVelocity = b3MakeVector3(0,0,0);
+		b3Vector3 turnVelocity = b3MakeVector3(0,0,0);
+		for (int i=begin;i<end;i++)
+		{
+			pushVelocity += m_tmpSolverBodyPool[m_splitBodies[i]].internalGetPushVelocity();
+			turnVelocity += m_tmpSolverBodyPool[m_splitBodies[i]].internalGetTurnVelocity();
+		}
+		b3Scalar factor = 1.f/b3Scalar(end-begin);
+		for (int i=begin;i<end;i++)
+		{
+			m_tmpSolverBodyPool[m_splitBodies[i]].internalGetPushVelocity() = pushVelocity*factor;
+			m_tmpSolverBodyPool[m_splitBodies[i]].internalGetTurnVelocity() = turnVelocity*factor;
 		}
 	}
 }
 
+void	b3PgsJacobiSolver::averageVelocities()
+{
+	B3_PROFILE("averaging");
+	averageSplitBodyVelocities(0,m_splitBodyOffsets.size()-1);
+}
+
 b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlyFinish(b3RigidBodyCL* bodies,b3InertiaCL* inertias,int numBodies,const b3ContactSolverInfo& infoGlobal)
 {
 	B3_PROFILE("solveGroupCacheFriendlyFinish");
@@ -1713,7 +3373,8 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlyFinish(b3RigidBodyCL* bodies,
 		{
 			const b3SolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[j];
 			b3ContactPoint* pt = (b3ContactPoint*) solveManifold.m_originalContactPoint;
-			b3Assert(pt);
+			if (!pt)
+				continue;
 			pt->m_appliedImpulse = solveManifold.m_appliedImpulse;
 		//	float f = m_tmpSolverContactFrictionConstraintPool[solveManifold.m_frictionIndex].m_appliedImpulse;
 			//	printf("pt->m_appliedImpulseLateral1 = %f\n", f);
@@ -1771,8 +3432,9 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlyFinish(b3RigidBodyCL* bodies,
 				{
 					body->m_linVel = m_tmpSolverBodyPool[i].m_linearVelocity;
 					body->m_angVel = m_tmpSolverBodyPool[i].m_angularVelocity;
-				} else
+				} else if (m_splitBodies[m_splitBodyOffsets[bodyIndex]]==i)
 				{
+					//the averaged change is added once, by the first copy of the body
 					b3Scalar factor = 1.f/b3Scalar(m_bodyCount[bodyIndex]);
 
 					b3Vector3 deltaLinVel = m_deltaLinearVelocities[bodyIndex]*factor;
@@ -1811,4 +3473,5 @@ b3Scalar b3PgsJacobiSolver::solveGroupCacheFriendlyFinish(b3RigidBodyCL* bodies,
 void	b3PgsJacobiSolver::reset()
 {
 	m_btSeed2 = 0;
+	m_jointRowCache.clear();
 }
\ No newline at end of file
@@ -7,15 +7,63 @@ struct b3ContactPoint;
 
 
 class b3Dispatcher;
+class b3ThreadSupportInterface;
+class b3Barrier;
 
 #include "b3TypedConstraint.h"
 #include "b3ContactSolverInfo.h"
 #include "b3SolverBody.h"
 #include "b3SolverConstraint.h"
+#include "b3SolverRowBlocks.h"
+#include "b3SolverIterationStats.h"
+#include "Bullet3Common/b3StackAlloc.h"
 
 struct b3RigidBodyCL;
 struct b3InertiaCL;
 
+#define B3_MAX_CACHED_JOINT_ROWS 6
+
+///row of a joint after getInfo2, with its inverse inertia terms, the bounds of cached rows are always infinite
+B3_ATTRIBUTE_ALIGNED16(struct) b3CachedJointRow
+{
+	b3Vector3	m_contactNormal;
+	b3Vector3	m_relpos1CrossNormal;
+	b3Vector3	m_relpos2CrossNormal;
+	b3Vector3	m_angularComponentA;
+	b3Vector3	m_angularComponentB;
+	b3Scalar	m_jacDiagABInv;
+	b3Scalar	m_positionError;
+	b3Scalar	m_cfm;
+	b3Scalar	m_unused;
+};
+
+///rows of a joint, reused while its bodies rotate less than b3ContactSolverInfo::m_jointCacheAngularThreshold.
+///The body transforms are the ones the rows were built with.
+B3_ATTRIBUTE_ALIGNED16(struct) b3CachedJointRows
+{
+	b3CachedJointRow	m_rows[B3_MAX_CACHED_JOINT_ROWS];
+	b3Quaternion		m_orientationA;
+	b3Quaternion		m_orientationB;
+	b3Vector3			m_positionA;
+	b3Vector3			m_positionB;
+	const b3TypedConstraint*	m_constraint;
+	int					m_bodyA;
+	int					m_bodyB;
+	int					m_numRows;
+	b3Scalar			m_timeStep;
+	b3Scalar			m_erp;
+	b3Scalar			m_globalCfm;
+	b3Scalar			m_globalDamping;
+	///damping of the joint, getInfo2 can override the global one
+	b3Scalar			m_damping;
+
+	b3CachedJointRows()
+		:m_constraint(0),
+		m_numRows(0)
+	{
+	}
+};
+
 class b3PgsJacobiSolver
 {
 
@@ -25,6 +73,9 @@ protected:
 	b3ConstraintArray			m_tmpSolverNonContactConstraintPool;
 	b3ConstraintArray			m_tmpSolverContactFrictionConstraintPool;
 	b3ConstraintArray			m_tmpSolverContactRollingFrictionConstraintPool;
+	///iteration part of the rows of each pool, indexed like the pools and by b3SolverRowBlocks::b3RowBlockPool.
+	///The iterations only touch these, the setup and finish use the full rows, see packHotRows
+	b3HotConstraintArray		m_hotRowPools[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS];
 
 	b3AlignedObjectArray<int>	m_orderTmpConstraintPool;
 	b3AlignedObjectArray<int>	m_orderNonContactConstraintPool;
@@ -33,16 +84,98 @@ protected:
 	
 	b3AlignedObjectArray<int>		m_bodyCount;
 	b3AlignedObjectArray<int>		m_bodyCountCheck;
+
+	///setup: original body of each solver body, solver bodies and first row of each joint, solver bodies of each manifold
+	b3AlignedObjectArray<int>		m_solverBodyOriginalIndices;
+	b3AlignedObjectArray<int>		m_jointSolverBodyIds;
+	b3AlignedObjectArray<int>		m_jointRowOffsets;
+	b3AlignedObjectArray<int>		m_manifoldSolverBodyIds;
+	///rows of each joint of the last steps, indexed like the constraints, empty when the joint cache is disabled
+	b3AlignedObjectArray<b3CachedJointRows>	m_jointRowCache;
 	
 	b3AlignedObjectArray<b3Vector3>	m_deltaLinearVelocities;
 	b3AlignedObjectArray<b3Vector3>	m_deltaAngularVelocities;
 
 	bool						m_usePgs;
 	void						averageVelocities();
+	///averages the velocities of the solver body copies of the original bodies [bodyBegin,bodyEnd)
+	void						averageSplitBodyVelocities(int bodyBegin, int bodyEnd);
+	///averages the push and turn velocities of the solver body copies, for the split impulse
+	void						averagePushVelocities();
+	void						buildSplitBodies(int numBodies);
+
+	///Jacobi only, the solver body copies of each original body are m_splitBodies[m_splitBodyOffsets[i]..m_splitBodyOffsets[i+1])
+	b3AlignedObjectArray<int>	m_splitBodyOffsets;
+	b3AlignedObjectArray<int>	m_splitBodies;
 
 	int							m_maxOverrideNumSolverIterations;
 
 	int							m_numSplitImpulseRecoveries;
+	///set when the parallel split impulse iterations colored the contact rows of this step, the colored velocity solve reuses the batches
+	bool						m_contactRowsColored;
+
+	///when set, the PGS iterations run on these threads, see setThreadSupport
+	b3ThreadSupportInterface*	m_threadSupport;
+	b3Barrier*					m_barrier;
+	///per-step scratch of the calling thread (task arrays, island assignment), each user reserves it before its block
+	b3StackAlloc				m_stackAlloc;
+
+	///the rows of each pool are colored into batches without a shared dynamic body, in the order of the m_order*Pool arrays
+	b3AlignedObjectArray<int>	m_nonContactBatchOffsets;
+	b3AlignedObjectArray<int>	m_contactBatchOffsets;
+	b3AlignedObjectArray<int>	m_frictionBatchOffsets;
+	b3AlignedObjectArray<int>	m_orderRollingFrictionConstraintPool;
+	b3AlignedObjectArray<int>	m_rollingFrictionBatchOffsets;
+	b3AlignedObjectArray<int>	m_bodyBatchStamp;
+	///colored contact rows of the parallel split impulse iterations
+	b3AlignedObjectArray<int>	m_orderSplitImpulseContactPool;
+	b3AlignedObjectArray<int>	m_splitImpulseBatchOffsets;
+
+	///start of the normal rows of each manifold in m_tmpSolverContactConstraintPool, with a final entry for the end
+	b3AlignedObjectArray<int>	m_contactManifoldOffsets;
+	b3AlignedObjectArray<int>	m_frictionManifoldOffsets;
+	b3AlignedObjectArray<int>	m_rollingFrictionManifoldOffsets;
+	///first joint and first manifold of each task of the parallel Jacobi iterations, with a final entry for the end
+	b3AlignedObjectArray<int>	m_taskJointOffsets;
+	b3AlignedObjectArray<int>	m_taskManifoldOffsets;
+
+	///state of B3_SOLVER_JACOBI_NNCG, the rows of all pools in b3SolverRowBlocks::b3RowBlockPool order
+	int							m_nncgRowOffsets[b3SolverRowBlocks::B3_ROW_BLOCKS_NUM_POOLS+1];
+	b3AlignedObjectArray<b3Scalar>	m_nncgStartImpulses;
+	b3AlignedObjectArray<b3Scalar>	m_nncgDirections;
+	///squared impulse change of each B3_NNCG_CHUNK_SIZE rows, summed in chunk order so that beta doesn't depend on the tasks
+	b3AlignedObjectArray<b3Scalar>	m_nncgChunkDeltaSq;
+
+	///SIMD copy of the colored rows, used with B3_SOLVER_SIMD_ROW_BLOCKS
+	b3SolverRowBlocks			m_rowBlocks;
+	bool						m_useRowBlocks;
+
+	///simulation islands of the last PGS step, rows connect dynamic bodies, static bodies don't join islands
+	int							m_numIslands;
+	b3AlignedObjectArray<int>	m_islandUnionFind;
+	b3AlignedObjectArray<int>	m_solverBodyIslandIds;
+	b3AlignedObjectArray<int>	m_bodyIslandIds;
+	b3AlignedObjectArray<int>	m_islandIterations;
+
+	///small islands are merged into island batches, the rows of each pool are sorted by island batch
+	b3AlignedObjectArray<int>	m_islandBatchIds;
+	b3AlignedObjectArray<int>	m_islandBatchIterations;
+	b3AlignedObjectArray<int>	m_islandBatchWork;
+	b3AlignedObjectArray<int>	m_nonContactIslandOffsets;
+	b3AlignedObjectArray<int>	m_contactIslandOffsets;
+	b3AlignedObjectArray<int>	m_frictionIslandOffsets;
+	b3AlignedObjectArray<int>	m_rollingFrictionIslandOffsets;
+	b3AlignedObjectArray<int>	m_taskIslandBatches;
+	b3AlignedObjectArray<int>	m_taskIslandBatchOffsets;
+
+	///residual of the iteration solved by solveSingleIteration
+	b3SolverResidual			m_iterationResidual;
+	///residuals of the parallel iterations, maxIterations entries per task
+	b3AlignedObjectArray<b3SolverResidual>	m_taskResiduals;
+	b3AlignedObjectArray<int>	m_taskNumIterations;
+	b3AlignedObjectArray<int>	m_taskConverged;
+	b3SolverIterationStats		m_iterationStats;
+	b3SolverIterationStats		m_splitImpulseIterationStats;
 
 	b3Scalar	getContactProcessingThreshold(b3Contact4* contact)
 	{
@@ -58,8 +191,8 @@ protected:
 									b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, 
 									b3Scalar desiredVelocity=0., b3Scalar cfmSlip=0.);
 
-	b3SolverConstraint&	addFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias,const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity=0., b3Scalar cfmSlip=0.);
-	b3SolverConstraint&	addRollingFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias,const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity=0, b3Scalar cfmSlip=0.f);
+	b3SolverConstraint&	addFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias,int row,const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity=0., b3Scalar cfmSlip=0.);
+	b3SolverConstraint&	addRollingFrictionConstraint(b3RigidBodyCL* bodies,b3InertiaCL* inertias,int row,const b3Vector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,b3ContactPoint& cp,const b3Vector3& rel_pos1,const b3Vector3& rel_pos2,b3RigidBodyCL* colObj0,b3RigidBodyCL* colObj1, b3Scalar relaxation, b3Scalar desiredVelocity=0, b3Scalar cfmSlip=0.f);
 
 
 	void setupContactConstraint(b3RigidBodyCL* bodies, b3InertiaCL* inertias,
@@ -76,28 +209,39 @@ protected:
 	
 	b3Scalar restitutionCurve(b3Scalar rel_vel, b3Scalar restitution);
 
-	void	convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inertias,b3Contact4* manifold,const b3ContactSolverInfo& infoGlobal);
+	void	countContactRows(b3Contact4* manifold, int manifoldIndex, const b3ContactSolverInfo& infoGlobal);
+	void	convertContact(b3RigidBodyCL* bodies, b3InertiaCL* inertias,b3Contact4* manifold,int manifoldIndex,const b3ContactSolverInfo& infoGlobal);
+	void	convertJoint(b3RigidBodyCL* bodies, b3InertiaCL* inertias, b3TypedConstraint** constraints, int i, const b3ContactSolverInfo& infoGlobal);
+	bool	canReuseJointRows(const b3CachedJointRows& cache, const b3TypedConstraint* constraint, int numRows, const b3RigidBodyCL* bodies, b3Scalar cosHalfThreshold, const b3ContactSolverInfo& infoGlobal) const;
+	void	reuseJointRows(const b3CachedJointRows& cache, b3SolverConstraint* rows, const b3RigidBodyCL* bodies, const b3ContactSolverInfo& infoGlobal) const;
+	void	storeJointRows(b3CachedJointRows& cache, const b3TypedConstraint* constraint, const b3SolverConstraint* rows, int numRows, b3Scalar damping, const b3RigidBodyCL* bodies, const b3ContactSolverInfo& infoGlobal) const;
+	void	applyWarmstartImpulses();
 
 
-	void	resolveSplitPenetrationSIMD(
+	b3Scalar	resolveSplitPenetrationSIMD(
      b3SolverBody& bodyA,b3SolverBody& bodyB,
         const b3SolverConstraint& contactConstraint);
 
-	void	resolveSplitPenetrationImpulseCacheFriendly(
+	b3Scalar	resolveSplitPenetrationImpulseCacheFriendly(
        b3SolverBody& bodyA,b3SolverBody& bodyB,
         const b3SolverConstraint& contactConstraint);
 
 	//internal method
-	int		getOrInitSolverBody(int bodyIndex, b3RigidBodyCL* bodies,b3InertiaCL* inertias);
+	int		assignSolverBody(int bodyIndex, b3RigidBodyCL* bodies);
+	///Jacobi mass splitting: each of the n copies of a dynamic body has n times its inverse mass and inertia, otherwise 1
+	b3Scalar	getSplitMassFactor(const b3RigidBodyCL& body, int bodyIndex) const;
 	void	initSolverBody(int bodyIndex, b3SolverBody* solverBody, b3RigidBodyCL* collisionObject);
 
-	void	resolveSingleConstraintRowGeneric(b3SolverBody& bodyA,b3SolverBody& bodyB,const b3SolverConstraint& contactConstraint);
+	b3Scalar	resolveSingleConstraintRowGeneric(b3SolverBody& bodyA,b3SolverBody& bodyB,b3SolverConstraintHot& contactConstraint, b3Scalar lowerLimit, b3Scalar upperLimit);
 
-	void	resolveSingleConstraintRowGenericSIMD(b3SolverBody& bodyA,b3SolverBody& bodyB,const b3SolverConstraint& contactConstraint);
+	b3Scalar	resolveSingleConstraintRowGenericSIMD(b3SolverBody& bodyA,b3SolverBody& bodyB,b3SolverConstraintHot& contactConstraint, b3Scalar lowerLimit, b3Scalar upperLimit);
 	
-	void	resolveSingleConstraintRowLowerLimit(b3SolverBody& bodyA,b3SolverBody& bodyB,const b3SolverConstraint& contactConstraint);
+	b3Scalar	resolveSingleConstraintRowLowerLimit(b3SolverBody& bodyA,b3SolverBody& bodyB,b3SolverConstraintHot& contactConstraint);
 	
-	void	resolveSingleConstraintRowLowerLimitSIMD(b3SolverBody& bodyA,b3SolverBody& bodyB,const b3SolverConstraint& contactConstraint);
+	b3Scalar	resolveSingleConstraintRowLowerLimitSIMD(b3SolverBody& bodyA,b3SolverBody& bodyB,b3SolverConstraintHot& contactConstraint);
+	///solves the normal rows [begin,end) of one manifold together, see B3_SOLVER_BLOCK_CONTACT_NORMALS
+	void	solveContactManifoldBlock(int begin, int end, b3SolverResidual& residual);
+	void	solveContactManifoldBlocks(b3SolverResidual& residual);
 		
 protected:
 
@@ -106,8 +250,44 @@ protected:
 
 	virtual b3Scalar solveGroupCacheFriendlyIterations(b3TypedConstraint** constraints,int numConstraints,const b3ContactSolverInfo& infoGlobal);
 	virtual void solveGroupCacheFriendlySplitImpulseIterations(b3TypedConstraint** constraints,int numConstraints,const b3ContactSolverInfo& infoGlobal);
+	///returns the largest delta impulse of the iteration, see m_iterationResidual
 	b3Scalar solveSingleIteration(int iteration, b3TypedConstraint** constraints,int numConstraints,const b3ContactSolverInfo& infoGlobal);
 
+	int		sortConstraintRowsByBatch(const b3ConstraintArray& rows, b3AlignedObjectArray<int>& order, b3AlignedObjectArray<int>& batchOffsets);
+	bool	canSolveIterationsInParallel(const b3ContactSolverInfo& infoGlobal) const;
+	void	solveIterationsInParallel(int maxIterations, const b3ContactSolverInfo& infoGlobal);
+
+	int		buildIslands(int numBodies, const b3ContactSolverInfo& infoGlobal);
+	void	uniteIslands(const b3ConstraintArray& rows);
+	int		getRowIsland(const b3SolverConstraint& row) const;
+	void	sortRowsByIslandBatch(const b3ConstraintArray& rows, b3AlignedObjectArray<int>& order, b3AlignedObjectArray<int>& batchOffsets, int numBatches);
+	bool	assignIslandBatchesToTasks(int numTasks);
+	int		getMaxIslandBatchIterations() const;
+	void	solveIslandsInParallel(const b3ContactSolverInfo& infoGlobal);
+
+	b3SolverBody&	getTaskSolverBody(int solverBodyId, b3SolverBody& fixedBody);
+	void	solveNonContactRows(int begin, int end, int iteration, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual);
+	void	solveContactRows(int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual);
+	void	solveFrictionRows(int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual);
+	void	solveRollingFrictionRows(int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual);
+	void	solveSplitImpulseRows(const b3AlignedObjectArray<int>& order, int begin, int end, bool useSimd, b3SolverBody& fixedBody, b3SolverResidual& residual);
+	void	mergeTaskResiduals(int numTasks, int maxIterations, b3SolverIterationStats& stats);
+	bool	canSolveSplitImpulseIterationsInParallel(const b3ContactSolverInfo& infoGlobal) const;
+	void	solveSplitImpulseIterationsInParallel(const b3ContactSolverInfo& infoGlobal);
+
+	///copies the iteration part of the rows into m_hotRowPools, writeBackHotRows copies the applied impulses back
+	void	packHotRows();
+	void	writeBackHotRows();
+
+	b3ConstraintArray&	getRowPool(int pool);
+	void	initNncg();
+	void	storeNncgStartImpulses(int pool, int begin, int end);
+	void	applyNncgStep(int pool, int begin, int end, b3Scalar beta, b3SolverBody& fixedBody);
+	b3Scalar	computeNncgChunkDeltaSq(int chunk) const;
+	b3Scalar	getNncgDeltaSq() const;
+	bool	canSolveJacobiIterationsInParallel(const b3ContactSolverInfo& infoGlobal) const;
+	void	solveJacobiIterationsInParallel(int maxIterations, const b3ContactSolverInfo& infoGlobal);
+
 
 	virtual b3Scalar solveGroupCacheFriendlyFinish(b3RigidBodyCL* bodies, b3InertiaCL* inertias,int numBodies,const b3ContactSolverInfo& infoGlobal);
 
@@ -131,6 +311,75 @@ public:
 
 	int b3RandInt2 (int n);
 
+	///run the PGS iterations on the threads of threadSupport, which need to be created with b3ThreadTaskFunc and b3ThreadTaskLocalStoreFunc.
+	///When the simulation islands balance over the tasks, each task solves whole islands without synchronization.
+	///Otherwise the rows are colored into batches that share no dynamic body, a barrier separates the batches.
+	///B3_SOLVER_RANDMIZE_ORDER and B3_SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS are ignored in this mode. Pass 0 to go back to the serial solver.
+	///The Jacobi solver splits the joints and manifolds over the tasks, a barrier separates the row updates from the averaging of the body copies.
+	///With B3_SOLVER_SIMD_ROW_BLOCKS the colored batches are always used, and solved 8 (AVX2) or 4 (SSE) rows at a time, with or without threads.
+	///The PGS split impulse iterations run on the colored contact batches, also when the velocity iterations solve whole islands.
+	void	setThreadSupport(b3ThreadSupportInterface* threadSupport);
+
+	b3ThreadSupportInterface*	getThreadSupport()
+	{
+		return m_threadSupport;
+	}
+
+	///internal method, solves the rows of task taskIndex in all batches, called by each worker thread
+	void	solveBatchedIterations(int taskIndex, int numTasks, int maxIterations, const b3ContactSolverInfo& infoGlobal);
+	///internal method, split impulse iterations of the rows of task taskIndex in the colored contact batches
+	void	solveSplitImpulseBatches(int taskIndex, int numTasks, const b3ContactSolverInfo& infoGlobal);
+	///internal method, solves the island batches assigned to task taskIndex, each with its own iteration count
+	void	solveIslandBatches(int taskIndex, const b3ContactSolverInfo& infoGlobal);
+	///arguments of solveGroupCacheFriendlySetup, shared by its parallel stages
+	struct b3SetupContext
+	{
+		b3RigidBodyCL*		m_bodies;
+		b3InertiaCL*		m_inertias;
+		b3Contact4*			m_manifolds;
+		b3TypedConstraint**	m_constraints;
+		const b3ContactSolverInfo*	m_infoGlobal;
+	};
+	///the setup counts the rows of each joint and manifold, then fills them in place, each stage runs in parallel over its items
+	enum b3SetupStage
+	{
+		B3_SETUP_JOINT_SIZES=0,
+		B3_SETUP_SOLVER_BODIES,
+		B3_SETUP_CONTACT_SIZES,
+		B3_SETUP_JOINT_ROWS,
+		B3_SETUP_CONTACT_ROWS
+	};
+	void	runSetupInParallel(const b3SetupContext& context, int stage, int numItems);
+	///internal method, runs the items [begin,end) of a setup stage, called by each worker thread
+	void	runSetupStage(const b3SetupContext& context, int stage, int begin, int end);
+
+	///internal method, Jacobi iterations of the joints and manifolds and the body averaging of task taskIndex
+	void	solveJacobiIterations(int taskIndex, int numTasks, int maxIterations, const b3ContactSolverInfo& infoGlobal);
+
+	///number of simulation islands found in the last PGS step
+	int		getNumIslands() const
+	{
+		return m_numIslands;
+	}
+	///island index of each body of the last PGS step, -1 for static bodies and bodies without constraints or contacts
+	const b3AlignedObjectArray<int>&	getBodyIslandIds() const
+	{
+		return m_bodyIslandIds;
+	}
+
+	///residual of each iteration of the last step. The iterations stop early when infoGlobal.m_residualThreshold is set,
+	///with islands each island batch stops on its own residual
+	const b3SolverIterationStats&	getIterationStats() const
+	{
+		return m_iterationStats;
+	}
+	///push impulse change of each split impulse iteration of the last step, with infoGlobal.m_splitImpulseResidualThreshold as early exit.
+	///With threads the split impulse iterations run on the colored contact batches
+	const b3SolverIterationStats&	getSplitImpulseIterationStats() const
+	{
+		return m_splitImpulseIterationStats;
+	}
+
 	void	setRandSeed(unsigned long seed)
 	{
 		m_btSeed2 = seed;
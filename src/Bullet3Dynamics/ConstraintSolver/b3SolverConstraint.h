@@ -27,6 +27,7 @@ struct b3RigidBody;
 
 
 ///1D constraint along a normal axis between bodyA and bodyB. It can be combined to solve contact and friction constraints.
+///The setup and the split impulse use the full row, the iterations a packed b3SolverConstraintHot copy.
 B3_ATTRIBUTE_ALIGNED16 (struct)	b3SolverConstraint
 {
 	B3_DECLARE_ALIGNED_ALLOCATOR();
@@ -73,6 +74,90 @@ B3_ATTRIBUTE_ALIGNED16 (struct)	b3SolverConstraint
 
 typedef b3AlignedObjectArray<b3SolverConstraint>	b3ConstraintArray;
 
+///xyz of a b3SolverConstraintHot vector, without the scalar stored in w
+B3_FORCE_INLINE b3Vector3	b3SolverRowXyz(const b3Vector3& v)
+{
+#if defined(B3_USE_SSE_IN_API) && defined (B3_USE_SSE)
+	return b3MakeVector3(_mm_and_ps(v.mVec128,b3vFFF0fMask));
+#else
+	return b3MakeVector3(v.getX(),v.getY(),v.getZ());
+#endif
+}
+
+///the part of a b3SolverConstraint used by the iterations, 96 bytes instead of 176.
+///The scalars are stored in the w components of the Jacobian vectors, the dot products ignore them,
+///use b3SolverRowXyz before applying the linear and angular components.
+///Friction and rolling friction rows store their friction coefficient in place of the upper limit,
+///their limits follow the impulse of their contact row.
+B3_ATTRIBUTE_ALIGNED16 (struct)	b3SolverConstraintHot
+{
+	B3_DECLARE_ALIGNED_ALLOCATOR();
+
+	b3Vector3		m_contactNormal;//w: jacDiagABInv
+	b3Vector3		m_relpos1CrossNormal;//w: rhs
+	b3Vector3		m_relpos2CrossNormal;//w: cfm
+	b3Vector3		m_angularComponentA;//w: lower limit
+	b3Vector3		m_angularComponentB;//w: upper limit or friction
+
+	b3Scalar		m_appliedImpulse;
+	int				m_solverBodyIdA;
+	int				m_solverBodyIdB;
+	union
+	{
+		int			m_frictionIndex;//friction and rolling friction rows
+		int			m_overrideNumSolverIterations;//non-contact rows
+	};
+
+	b3Scalar	getJacDiagABInv() const
+	{
+		return m_contactNormal.getW();
+	}
+	b3Scalar	getRhs() const
+	{
+		return m_relpos1CrossNormal.getW();
+	}
+	b3Scalar	getCfm() const
+	{
+		return m_relpos2CrossNormal.getW();
+	}
+	b3Scalar	getLowerLimit() const
+	{
+		return m_angularComponentA.getW();
+	}
+	b3Scalar	getUpperLimit() const
+	{
+		return m_angularComponentB.getW();
+	}
+	b3Scalar	getFriction() const
+	{
+		return m_angularComponentB.getW();
+	}
+
+	///copies the iteration part of row, friction rows (and rolling friction rows) keep m_friction and m_frictionIndex
+	void	pack(const b3SolverConstraint& row, bool frictionRow)
+	{
+		m_contactNormal = row.m_contactNormal;
+		m_contactNormal.setW(row.m_jacDiagABInv);
+		m_relpos1CrossNormal = row.m_relpos1CrossNormal;
+		m_relpos1CrossNormal.setW(row.m_rhs);
+		m_relpos2CrossNormal = row.m_relpos2CrossNormal;
+		m_relpos2CrossNormal.setW(row.m_cfm);
+		m_angularComponentA = row.m_angularComponentA;
+		m_angularComponentA.setW(row.m_lowerLimit);
+		m_angularComponentB = row.m_angularComponentB;
+		m_angularComponentB.setW(frictionRow? row.m_friction : row.m_upperLimit);
+		m_appliedImpulse = row.m_appliedImpulse;
+		m_solverBodyIdA = row.m_solverBodyIdA;
+		m_solverBodyIdB = row.m_solverBodyIdB;
+		if (frictionRow)
+			m_frictionIndex = row.m_frictionIndex;
+		else
+			m_overrideNumSolverIterations = row.m_overrideNumSolverIterations;
+	}
+};
+
+typedef b3AlignedObjectArray<b3SolverConstraintHot>	b3HotConstraintArray;
+
 
 #endif //B3_SOLVER_CONSTRAINT_H
 
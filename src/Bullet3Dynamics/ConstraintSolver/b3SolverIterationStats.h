@@ -0,0 +1,87 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SOLVER_ITERATION_STATS_H
+#define B3_SOLVER_ITERATION_STATS_H
+
+#include "Bullet3Common/b3Scalar.h"
+#include "Bullet3Common/b3AlignedObjectArray.h"
+
+///change of the applied impulses of the rows solved during one solver iteration
+struct b3SolverResidual
+{
+	b3Scalar	m_maxDeltaImpulse;
+	b3Scalar	m_sumSquaredDeltaImpulse;
+	int			m_numRows;
+
+	b3SolverResidual()
+	{
+		reset();
+	}
+
+	void	reset()
+	{
+		m_maxDeltaImpulse = b3Scalar(0);
+		m_sumSquaredDeltaImpulse = b3Scalar(0);
+		m_numRows = 0;
+	}
+
+	void	addRow(b3Scalar deltaImpulse)
+	{
+		b3Scalar absDeltaImpulse = b3Fabs(deltaImpulse);
+		if (absDeltaImpulse>m_maxDeltaImpulse)
+			m_maxDeltaImpulse = absDeltaImpulse;
+		m_sumSquaredDeltaImpulse += deltaImpulse*deltaImpulse;
+		m_numRows++;
+	}
+
+	void	merge(const b3SolverResidual& other)
+	{
+		if (other.m_maxDeltaImpulse>m_maxDeltaImpulse)
+			m_maxDeltaImpulse = other.m_maxDeltaImpulse;
+		m_sumSquaredDeltaImpulse += other.m_sumSquaredDeltaImpulse;
+		m_numRows += other.m_numRows;
+	}
+
+	b3Scalar	getRmsDeltaImpulse() const
+	{
+		return m_numRows? b3Sqrt(m_sumSquaredDeltaImpulse/b3Scalar(m_numRows)) : b3Scalar(0);
+	}
+};
+
+///convergence of the iterations of the last solver step
+struct b3SolverIterationStats
+{
+	///largest number of iterations run, the islands of the parallel PGS solver can stop at different iterations
+	int		m_numIterations;
+	///true when the residual fell below the threshold before the maximum number of iterations
+	bool	m_converged;
+	///residual of each iteration, merged over all rows, islands and threads
+	b3AlignedObjectArray<b3SolverResidual>	m_residuals;
+
+	b3SolverIterationStats()
+	{
+		reset();
+	}
+
+	void	reset()
+	{
+		m_numIterations = 0;
+		m_converged = false;
+		m_residuals.resize(0);
+	}
+};
+
+#endif //B3_SOLVER_ITERATION_STATS_H
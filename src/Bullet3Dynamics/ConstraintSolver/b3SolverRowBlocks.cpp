@@ -0,0 +1,480 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b3SolverRowBlocks.h"
+#include "Bullet3Common/b3CpuFeatures.h"
+
+b3SolverRowBlocks::b3SolverRowBlocks()
+:m_width(getSimdWidth()),
+m_numBlocks(0),
+m_staticBodyOffset(0)
+{
+}
+
+int	b3SolverRowBlocks::getSimdWidth()
+{
+#if defined (USE_SIMD) && defined (B3_HAS_AVX2_TARGET)
+	static int width = b3CpuHasAvx2()? 8 : 4;
+	return width;
+#else
+	return 4;
+#endif
+}
+
+void	b3SolverRowBlocks::setWidth(int width)
+{
+	b3Assert(width==4 || width==8);
+	//solveBlocksAvx2 needs AVX2 support of the cpu, not just of the compiler
+	if (width==8 && getSimdWidth()!=8)
+		width = 4;
+	m_width = width;
+}
+
+void	b3SolverRowBlocks::build(const b3AlignedObjectArray<b3SolverBody>& bodies, const b3ConstraintArray* const* pools,
+				const b3AlignedObjectArray<int>* const* orders, const b3AlignedObjectArray<int>* const* batchOffsets)
+{
+	B3_PROFILE("b3SolverRowBlocks::build");
+
+	int numBlocks = 0;
+	for (int pool=0;pool<B3_ROW_BLOCKS_NUM_POOLS;pool++)
+	{
+		const b3AlignedObjectArray<int>& offsets = *batchOffsets[pool];
+		for (int b=0;b<offsets.size()-1;b++)
+			numBlocks += (offsets[b+1]-offsets[b]+m_width-1)/m_width;
+	}
+
+	int numBodies = bodies.size();
+	m_staticBodyOffset = numBodies*8;
+	m_deltaVelocities.resizeNoInitialize(numBodies*8+8);
+	for (int i=0;i<numBodies;i++)
+	{
+		float* vel = &m_deltaVelocities[i*8];
+		const b3Vector3& lin = bodies[i].m_deltaLinearVelocity;
+		const b3Vector3& ang = bodies[i].m_deltaAngularVelocity;
+		vel[0] = lin.getX(); vel[1] = lin.getY(); vel[2] = lin.getZ();
+		vel[3] = ang.getX(); vel[4] = ang.getY(); vel[5] = ang.getZ();
+		vel[6] = 0.f; vel[7] = 0.f;
+	}
+	for (int k=0;k<8;k++)
+		m_deltaVelocities[m_staticBodyOffset+k] = 0.f;
+
+	m_data.resize(0);
+	m_data.resize(m_width+numBlocks*B3_ROW_NUM_FIELDS*m_width,0.f);
+	m_bodyOffsets.resize(0);
+	m_bodyOffsets.resize(numBlocks*2*m_width,m_staticBodyOffset);
+	m_contactImpulseIndices.resize(0);
+	m_contactImpulseIndices.resize(numBlocks*m_width,0);
+	m_rows.resize(0);
+	m_rows.resize(numBlocks*m_width,-1);
+	m_contactRowImpulseIndices.resize(0);
+	m_contactRowImpulseIndices.resize(pools[B3_ROW_BLOCKS_CONTACT]->size(),0);
+
+	//the contact rows are packed before the friction rows, which refer to their applied impulse
+	m_numBlocks = 0;
+	for (int pool=0;pool<B3_ROW_BLOCKS_NUM_POOLS;pool++)
+		packPool(pool,bodies,*pools[pool],*orders[pool],*batchOffsets[pool]);
+	b3Assert(m_numBlocks==numBlocks);
+}
+
+void	b3SolverRowBlocks::packPool(int pool, const b3AlignedObjectArray<b3SolverBody>& bodies, const b3ConstraintArray& rows,
+				const b3AlignedObjectArray<int>& order, const b3AlignedObjectArray<int>& batchOffsets)
+{
+	const int blockSize = B3_ROW_NUM_FIELDS*m_width;
+	b3AlignedObjectArray<int>& blockOffsets = m_batchBlockOffsets[pool];
+	blockOffsets.resize(0);
+	for (int b=0;b<batchOffsets.size()-1;b++)
+	{
+		blockOffsets.push_back(m_numBlocks);
+		for (int first=batchOffsets[b];first<batchOffsets[b+1];first+=m_width)
+		{
+			int block = m_numBlocks++;
+			float* d = &m_data[m_width+block*blockSize];
+			int numLanes = b3Min(m_width,batchOffsets[b+1]-first);
+			for (int lane=0;lane<numLanes;lane++)
+			{
+				int row = order[first+lane];
+				const b3SolverConstraint& c = rows[row];
+				const b3SolverBody& bodyA = bodies[c.m_solverBodyIdA];
+				const b3SolverBody& bodyB = bodies[c.m_solverBodyIdB];
+				b3Vector3 linA = c.m_contactNormal*bodyA.m_invMass;
+				b3Vector3 linB = c.m_contactNormal*bodyB.m_invMass;
+				const b3Vector3* vecs[7] = {&c.m_contactNormal,&c.m_relpos1CrossNormal,&c.m_relpos2CrossNormal,&linA,&linB,&c.m_angularComponentA,&c.m_angularComponentB};
+				for (int v=0;v<7;v++)
+				{
+					d[(B3_ROW_NORMAL_X+v*3)*m_width+lane] = vecs[v]->getX();
+					d[(B3_ROW_NORMAL_Y+v*3)*m_width+lane] = vecs[v]->getY();
+					d[(B3_ROW_NORMAL_Z+v*3)*m_width+lane] = vecs[v]->getZ();
+				}
+				d[B3_ROW_JAC_DIAG_AB_INV*m_width+lane] = c.m_jacDiagABInv;
+				d[B3_ROW_RHS*m_width+lane] = c.m_rhs;
+				d[B3_ROW_CFM*m_width+lane] = c.m_cfm;
+				d[B3_ROW_LOWER_LIMIT*m_width+lane] = c.m_lowerLimit;
+				//contact rows only have a lower limit
+				d[B3_ROW_UPPER_LIMIT*m_width+lane] = (pool==B3_ROW_BLOCKS_CONTACT)? B3_LARGE_FLOAT : c.m_upperLimit;
+				d[B3_ROW_APPLIED_IMPULSE*m_width+lane] = c.m_appliedImpulse;
+				d[B3_ROW_FRICTION*m_width+lane] = c.m_friction;
+				d[B3_ROW_NUM_ITERATIONS*m_width+lane] = float(c.m_overrideNumSolverIterations);
+
+				int* offsets = &m_bodyOffsets[block*2*m_width];
+				offsets[lane] = bodyA.m_invMass.isZero()? m_staticBodyOffset : c.m_solverBodyIdA*8;
+				offsets[m_width+lane] = bodyB.m_invMass.isZero()? m_staticBodyOffset : c.m_solverBodyIdB*8;
+				m_rows[block*m_width+lane] = row;
+
+				int appliedImpulseIndex = m_width+block*blockSize+B3_ROW_APPLIED_IMPULSE*m_width+lane;
+				if (pool==B3_ROW_BLOCKS_CONTACT)
+					m_contactRowImpulseIndices[row] = appliedImpulseIndex;
+				if (pool==B3_ROW_BLOCKS_FRICTION || pool==B3_ROW_BLOCKS_ROLLING_FRICTION)
+					m_contactImpulseIndices[block*m_width+lane] = m_contactRowImpulseIndices[c.m_frictionIndex];
+			}
+		}
+	}
+	blockOffsets.push_back(m_numBlocks);
+}
+
+void	b3SolverRowBlocks::solveBlocks(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual)
+{
+#ifdef USE_SIMD
+	if (m_width==8)
+	{
+		solveBlocksAvx2(pool,beginBlock,endBlock,iteration,residual);
+		return;
+	}
+	solveBlocksSse(pool,beginBlock,endBlock,iteration,residual);
+#else
+	solveBlocksScalar(pool,beginBlock,endBlock,iteration,residual);
+#endif
+}
+
+static inline int	b3CountLaneBits(int mask)
+{
+	int count = 0;
+	for (;mask;mask &= mask-1)
+		count++;
+	return count;
+}
+
+void	b3SolverRowBlocks::solveBlocksScalar(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual)
+{
+	const int blockSize = B3_ROW_NUM_FIELDS*m_width;
+	float* vel = &m_deltaVelocities[0];
+	for (int block=beginBlock;block<endBlock;block++)
+	{
+		float* d = &m_data[m_width+block*blockSize];
+		const int* offsets = &m_bodyOffsets[block*2*m_width];
+		for (int lane=0;lane<m_width;lane++)
+		{
+			if (m_rows[block*m_width+lane]<0)
+				continue;
+#define B3_ROW_FIELD(f) d[(f)*m_width+lane]
+			float lower = B3_ROW_FIELD(B3_ROW_LOWER_LIMIT);
+			float upper = B3_ROW_FIELD(B3_ROW_UPPER_LIMIT);
+			if (pool==B3_ROW_BLOCKS_NON_CONTACT && !(float(iteration)<B3_ROW_FIELD(B3_ROW_NUM_ITERATIONS)))
+				continue;
+			if (pool==B3_ROW_BLOCKS_FRICTION || pool==B3_ROW_BLOCKS_ROLLING_FRICTION)
+			{
+				float totalImpulse = m_data[m_contactImpulseIndices[block*m_width+lane]];
+				if (!(totalImpulse>0.f))
+					continue;
+				float friction = B3_ROW_FIELD(B3_ROW_FRICTION);
+				upper = friction*totalImpulse;
+				if (pool==B3_ROW_BLOCKS_ROLLING_FRICTION && upper>friction)
+					upper = friction;
+				lower = -upper;
+			}
+			float* velA = vel+offsets[lane];
+			float* velB = vel+offsets[m_width+lane];
+			float deltaVel1Dotn = B3_ROW_FIELD(B3_ROW_NORMAL_X)*velA[0]+B3_ROW_FIELD(B3_ROW_NORMAL_Y)*velA[1]+B3_ROW_FIELD(B3_ROW_NORMAL_Z)*velA[2]
+				+B3_ROW_FIELD(B3_ROW_RELPOS1_CROSS_NORMAL_X)*velA[3]+B3_ROW_FIELD(B3_ROW_RELPOS1_CROSS_NORMAL_Y)*velA[4]+B3_ROW_FIELD(B3_ROW_RELPOS1_CROSS_NORMAL_Z)*velA[5];
+			float deltaVel2Dotn = B3_ROW_FIELD(B3_ROW_RELPOS2_CROSS_NORMAL_X)*velB[3]+B3_ROW_FIELD(B3_ROW_RELPOS2_CROSS_NORMAL_Y)*velB[4]+B3_ROW_FIELD(B3_ROW_RELPOS2_CROSS_NORMAL_Z)*velB[5]
+				-(B3_ROW_FIELD(B3_ROW_NORMAL_X)*velB[0]+B3_ROW_FIELD(B3_ROW_NORMAL_Y)*velB[1]+B3_ROW_FIELD(B3_ROW_NORMAL_Z)*velB[2]);
+			float appliedImpulse = B3_ROW_FIELD(B3_ROW_APPLIED_IMPULSE);
+			float jacDiagABInv = B3_ROW_FIELD(B3_ROW_JAC_DIAG_AB_INV);
+			float deltaImpulse = B3_ROW_FIELD(B3_ROW_RHS)-appliedImpulse*B3_ROW_FIELD(B3_ROW_CFM)-deltaVel1Dotn*jacDiagABInv-deltaVel2Dotn*jacDiagABInv;
+			float sum = b3Min(b3Max(appliedImpulse+deltaImpulse,lower),upper);
+			deltaImpulse = sum-appliedImpulse;
+			B3_ROW_FIELD(B3_ROW_APPLIED_IMPULSE) = sum;
+			residual.addRow(deltaImpulse);
+
+			if (offsets[lane]!=m_staticBodyOffset)
+			{
+				for (int k=0;k<3;k++)
+				{
+					velA[k] += B3_ROW_FIELD(B3_ROW_LINEAR_A_X+k)*deltaImpulse;
+					velA[3+k] += B3_ROW_FIELD(B3_ROW_ANGULAR_A_X+k)*deltaImpulse;
+				}
+			}
+			if (offsets[m_width+lane]!=m_staticBodyOffset)
+			{
+				for (int k=0;k<3;k++)
+				{
+					velB[k] -= B3_ROW_FIELD(B3_ROW_LINEAR_B_X+k)*deltaImpulse;
+					velB[3+k] += B3_ROW_FIELD(B3_ROW_ANGULAR_B_X+k)*deltaImpulse;
+				}
+			}
+#undef B3_ROW_FIELD
+		}
+	}
+}
+
+void	b3SolverRowBlocks::solveBlocksSse(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual)
+{
+#ifdef USE_SIMD
+	b3Assert(m_width==4);
+	const int blockSize = B3_ROW_NUM_FIELDS*4;
+	float* vel = &m_deltaVelocities[0];
+	const __m128 iterationVec = _mm_set1_ps(float(iteration));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 maxDeltaImpulse = zero;
+	__m128 sumSquaredDeltaImpulse = zero;
+	int numRows = 0;
+	B3_ATTRIBUTE_ALIGNED16(float result[12][4]);
+
+	for (int block=beginBlock;block<endBlock;block++)
+	{
+		float* d = &m_data[4+block*blockSize];
+		const int* offsetsA = &m_bodyOffsets[block*8];
+		const int* offsetsB = offsetsA+4;
+#define B3_ROW_FIELD4(f) _mm_load_ps(d+(f)*4)
+#define B3_GATHER4(offsets,k) _mm_setr_ps(vel[offsets[0]+(k)],vel[offsets[1]+(k)],vel[offsets[2]+(k)],vel[offsets[3]+(k)])
+		__m128 linA[3],angA[3],linB[3],angB[3];
+		for (int k=0;k<3;k++)
+		{
+			linA[k] = B3_GATHER4(offsetsA,k);
+			angA[k] = B3_GATHER4(offsetsA,3+k);
+			linB[k] = B3_GATHER4(offsetsB,k);
+			angB[k] = B3_GATHER4(offsetsB,3+k);
+		}
+		__m128 deltaVel1Dotn = _mm_setzero_ps();
+		__m128 deltaVel2Dotn = _mm_setzero_ps();
+		for (int k=0;k<3;k++)
+		{
+			__m128 normal = B3_ROW_FIELD4(B3_ROW_NORMAL_X+k);
+			deltaVel1Dotn = _mm_add_ps(deltaVel1Dotn,_mm_add_ps(_mm_mul_ps(normal,linA[k]),_mm_mul_ps(B3_ROW_FIELD4(B3_ROW_RELPOS1_CROSS_NORMAL_X+k),angA[k])));
+			deltaVel2Dotn = _mm_add_ps(deltaVel2Dotn,_mm_sub_ps(_mm_mul_ps(B3_ROW_FIELD4(B3_ROW_RELPOS2_CROSS_NORMAL_X+k),angB[k]),_mm_mul_ps(normal,linB[k])));
+		}
+		__m128 appliedImpulse = B3_ROW_FIELD4(B3_ROW_APPLIED_IMPULSE);
+		__m128 jacDiagABInv = B3_ROW_FIELD4(B3_ROW_JAC_DIAG_AB_INV);
+		__m128 deltaImpulse = _mm_sub_ps(B3_ROW_FIELD4(B3_ROW_RHS),_mm_mul_ps(appliedImpulse,B3_ROW_FIELD4(B3_ROW_CFM)));
+		deltaImpulse = _mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,jacDiagABInv));
+		deltaImpulse = _mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,jacDiagABInv));
+
+		//padding lanes have no row, as in solveBlocksScalar
+		__m128 hasRow = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)&m_rows[block*4]),_mm_set1_epi32(-1)));
+		__m128 lower,upper;
+		__m128 active = hasRow;
+		if (pool==B3_ROW_BLOCKS_FRICTION || pool==B3_ROW_BLOCKS_ROLLING_FRICTION)
+		{
+			const int* impulseIndices = &m_contactImpulseIndices[block*4];
+			__m128 totalImpulse = _mm_setr_ps(m_data[impulseIndices[0]],m_data[impulseIndices[1]],m_data[impulseIndices[2]],m_data[impulseIndices[3]]);
+			__m128 friction = B3_ROW_FIELD4(B3_ROW_FRICTION);
+			upper = _mm_mul_ps(friction,totalImpulse);
+			if (pool==B3_ROW_BLOCKS_ROLLING_FRICTION)
+				upper = _mm_min_ps(upper,friction);
+			lower = _mm_sub_ps(zero,upper);
+			active = _mm_and_ps(active,_mm_cmpgt_ps(totalImpulse,zero));
+		} else
+		{
+			lower = B3_ROW_FIELD4(B3_ROW_LOWER_LIMIT);
+			upper = B3_ROW_FIELD4(B3_ROW_UPPER_LIMIT);
+			if (pool==B3_ROW_BLOCKS_NON_CONTACT)
+				active = _mm_and_ps(active,_mm_cmplt_ps(iterationVec,B3_ROW_FIELD4(B3_ROW_NUM_ITERATIONS)));
+		}
+		__m128 sum = _mm_min_ps(_mm_max_ps(_mm_add_ps(appliedImpulse,deltaImpulse),lower),upper);
+		deltaImpulse = _mm_and_ps(active,_mm_sub_ps(sum,appliedImpulse));
+		_mm_store_ps(d+B3_ROW_APPLIED_IMPULSE*4,_mm_add_ps(appliedImpulse,deltaImpulse));
+		maxDeltaImpulse = _mm_max_ps(maxDeltaImpulse,_mm_and_ps(deltaImpulse,absMask));
+		sumSquaredDeltaImpulse = _mm_add_ps(sumSquaredDeltaImpulse,_mm_mul_ps(deltaImpulse,deltaImpulse));
+		numRows += b3CountLaneBits(_mm_movemask_ps(active));
+
+		for (int k=0;k<3;k++)
+		{
+			_mm_store_ps(result[k],_mm_add_ps(linA[k],_mm_mul_ps(B3_ROW_FIELD4(B3_ROW_LINEAR_A_X+k),deltaImpulse)));
+			_mm_store_ps(result[3+k],_mm_add_ps(angA[k],_mm_mul_ps(B3_ROW_FIELD4(B3_ROW_ANGULAR_A_X+k),deltaImpulse)));
+			_mm_store_ps(result[6+k],_mm_sub_ps(linB[k],_mm_mul_ps(B3_ROW_FIELD4(B3_ROW_LINEAR_B_X+k),deltaImpulse)));
+			_mm_store_ps(result[9+k],_mm_add_ps(angB[k],_mm_mul_ps(B3_ROW_FIELD4(B3_ROW_ANGULAR_B_X+k),deltaImpulse)));
+		}
+		//there is no scatter instruction, the lanes never share a dynamic body
+		for (int lane=0;lane<4;lane++)
+		{
+			if (offsetsA[lane]!=m_staticBodyOffset)
+			{
+				for (int k=0;k<6;k++)
+					vel[offsetsA[lane]+k] = result[k][lane];
+			}
+			if (offsetsB[lane]!=m_staticBodyOffset)
+			{
+				for (int k=0;k<6;k++)
+					vel[offsetsB[lane]+k] = result[6+k][lane];
+			}
+		}
+#undef B3_GATHER4
+#undef B3_ROW_FIELD4
+	}
+	_mm_store_ps(result[0],maxDeltaImpulse);
+	_mm_store_ps(result[1],sumSquaredDeltaImpulse);
+	b3SolverResidual blocksResidual;
+	blocksResidual.m_maxDeltaImpulse = b3Max(b3Max(result[0][0],result[0][1]),b3Max(result[0][2],result[0][3]));
+	blocksResidual.m_sumSquaredDeltaImpulse = (result[1][0]+result[1][1])+(result[1][2]+result[1][3]);
+	blocksResidual.m_numRows = numRows;
+	residual.merge(blocksResidual);
+#else
+	solveBlocksScalar(pool,beginBlock,endBlock,iteration,residual);
+#endif
+}
+
+#if defined (USE_SIMD) && defined (B3_HAS_AVX2_TARGET)
+B3_AVX2_TARGET void	b3SolverRowBlocks::solveBlocksAvx2(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual)
+{
+	b3Assert(m_width==8);
+	const int blockSize = B3_ROW_NUM_FIELDS*8;
+	float* vel = &m_deltaVelocities[0];
+	const __m256 iterationVec = _mm256_set1_ps(float(iteration));
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 maxDeltaImpulse = zero;
+	__m256 sumSquaredDeltaImpulse = zero;
+	int numRows = 0;
+	B3_ATTRIBUTE_ALIGNED16(float result[12][8]);
+
+	for (int block=beginBlock;block<endBlock;block++)
+	{
+		//m_data is only 16 byte aligned
+		float* d = &m_data[8+block*blockSize];
+		const int* offsetsA = &m_bodyOffsets[block*16];
+		const int* offsetsB = offsetsA+8;
+		__m256i indicesA = _mm256_loadu_si256((const __m256i*)offsetsA);
+		__m256i indicesB = _mm256_loadu_si256((const __m256i*)offsetsB);
+#define B3_ROW_FIELD8(f) _mm256_loadu_ps(d+(f)*8)
+		__m256 linA[3],angA[3],linB[3],angB[3];
+		for (int k=0;k<3;k++)
+		{
+			linA[k] = _mm256_i32gather_ps(vel+k,indicesA,4);
+			angA[k] = _mm256_i32gather_ps(vel+3+k,indicesA,4);
+			linB[k] = _mm256_i32gather_ps(vel+k,indicesB,4);
+			angB[k] = _mm256_i32gather_ps(vel+3+k,indicesB,4);
+		}
+		__m256 deltaVel1Dotn = _mm256_setzero_ps();
+		__m256 deltaVel2Dotn = _mm256_setzero_ps();
+		for (int k=0;k<3;k++)
+		{
+			__m256 normal = B3_ROW_FIELD8(B3_ROW_NORMAL_X+k);
+			deltaVel1Dotn = _mm256_add_ps(deltaVel1Dotn,_mm256_add_ps(_mm256_mul_ps(normal,linA[k]),_mm256_mul_ps(B3_ROW_FIELD8(B3_ROW_RELPOS1_CROSS_NORMAL_X+k),angA[k])));
+			deltaVel2Dotn = _mm256_add_ps(deltaVel2Dotn,_mm256_sub_ps(_mm256_mul_ps(B3_ROW_FIELD8(B3_ROW_RELPOS2_CROSS_NORMAL_X+k),angB[k]),_mm256_mul_ps(normal,linB[k])));
+		}
+		__m256 appliedImpulse = B3_ROW_FIELD8(B3_ROW_APPLIED_IMPULSE);
+		__m256 jacDiagABInv = B3_ROW_FIELD8(B3_ROW_JAC_DIAG_AB_INV);
+		__m256 deltaImpulse = _mm256_sub_ps(B3_ROW_FIELD8(B3_ROW_RHS),_mm256_mul_ps(appliedImpulse,B3_ROW_FIELD8(B3_ROW_CFM)));
+		deltaImpulse = _mm256_sub_ps(deltaImpulse,_mm256_mul_ps(deltaVel1Dotn,jacDiagABInv));
+		deltaImpulse = _mm256_sub_ps(deltaImpulse,_mm256_mul_ps(deltaVel2Dotn,jacDiagABInv));
+
+		//padding lanes have no row, as in solveBlocksScalar
+		__m256 hasRow = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)&m_rows[block*8]),_mm256_set1_epi32(-1)));
+		__m256 lower,upper;
+		__m256 active = hasRow;
+		if (pool==B3_ROW_BLOCKS_FRICTION || pool==B3_ROW_BLOCKS_ROLLING_FRICTION)
+		{
+			__m256i impulseIndices = _mm256_loadu_si256((const __m256i*)&m_contactImpulseIndices[block*8]);
+			__m256 totalImpulse = _mm256_i32gather_ps(&m_data[0],impulseIndices,4);
+			__m256 friction = B3_ROW_FIELD8(B3_ROW_FRICTION);
+			upper = _mm256_mul_ps(friction,totalImpulse);
+			if (pool==B3_ROW_BLOCKS_ROLLING_FRICTION)
+				upper = _mm256_min_ps(upper,friction);
+			lower = _mm256_sub_ps(zero,upper);
+			active = _mm256_and_ps(active,_mm256_cmp_ps(totalImpulse,zero,_CMP_GT_OQ));
+		} else
+		{
+			lower = B3_ROW_FIELD8(B3_ROW_LOWER_LIMIT);
+			upper = B3_ROW_FIELD8(B3_ROW_UPPER_LIMIT);
+			if (pool==B3_ROW_BLOCKS_NON_CONTACT)
+				active = _mm256_and_ps(active,_mm256_cmp_ps(iterationVec,B3_ROW_FIELD8(B3_ROW_NUM_ITERATIONS),_CMP_LT_OQ));
+		}
+		__m256 sum = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(appliedImpulse,deltaImpulse),lower),upper);
+		deltaImpulse = _mm256_and_ps(active,_mm256_sub_ps(sum,appliedImpulse));
+		_mm256_storeu_ps(d+B3_ROW_APPLIED_IMPULSE*8,_mm256_add_ps(appliedImpulse,deltaImpulse));
+		maxDeltaImpulse = _mm256_max_ps(maxDeltaImpulse,_mm256_and_ps(deltaImpulse,absMask));
+		sumSquaredDeltaImpulse = _mm256_add_ps(sumSquaredDeltaImpulse,_mm256_mul_ps(deltaImpulse,deltaImpulse));
+		numRows += b3CountLaneBits(_mm256_movemask_ps(active));
+
+		for (int k=0;k<3;k++)
+		{
+			_mm256_storeu_ps(result[k],_mm256_add_ps(linA[k],_mm256_mul_ps(B3_ROW_FIELD8(B3_ROW_LINEAR_A_X+k),deltaImpulse)));
+			_mm256_storeu_ps(result[3+k],_mm256_add_ps(angA[k],_mm256_mul_ps(B3_ROW_FIELD8(B3_ROW_ANGULAR_A_X+k),deltaImpulse)));
+			_mm256_storeu_ps(result[6+k],_mm256_sub_ps(linB[k],_mm256_mul_ps(B3_ROW_FIELD8(B3_ROW_LINEAR_B_X+k),deltaImpulse)));
+			_mm256_storeu_ps(result[9+k],_mm256_add_ps(angB[k],_mm256_mul_ps(B3_ROW_FIELD8(B3_ROW_ANGULAR_B_X+k),deltaImpulse)));
+		}
+		//AVX2 has no scatter instruction, the lanes never share a dynamic body
+		for (int lane=0;lane<8;lane++)
+		{
+			if (offsetsA[lane]!=m_staticBodyOffset)
+			{
+				for (int k=0;k<6;k++)
+					vel[offsetsA[lane]+k] = result[k][lane];
+			}
+			if (offsetsB[lane]!=m_staticBodyOffset)
+			{
+				for (int k=0;k<6;k++)
+					vel[offsetsB[lane]+k] = result[6+k][lane];
+			}
+		}
+#undef B3_ROW_FIELD8
+	}
+	_mm256_storeu_ps(result[0],maxDeltaImpulse);
+	_mm256_storeu_ps(result[1],sumSquaredDeltaImpulse);
+	b3SolverResidual blocksResidual;
+	for (int lane=0;lane<8;lane++)
+	{
+		blocksResidual.m_maxDeltaImpulse = b3Max(blocksResidual.m_maxDeltaImpulse,result[0][lane]);
+		blocksResidual.m_sumSquaredDeltaImpulse += result[1][lane];
+	}
+	blocksResidual.m_numRows = numRows;
+	residual.merge(blocksResidual);
+}
+#else
+void	b3SolverRowBlocks::solveBlocksAvx2(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual)
+{
+	solveBlocksScalar(pool,beginBlock,endBlock,iteration,residual);
+}
+#endif
+
+void	b3SolverRowBlocks::writeBack(b3AlignedObjectArray<b3SolverBody>& bodies, b3ConstraintArray* const* pools) const
+{
+	B3_PROFILE("b3SolverRowBlocks::writeBack");
+	const int blockSize = B3_ROW_NUM_FIELDS*m_width;
+	for (int pool=0;pool<B3_ROW_BLOCKS_NUM_POOLS;pool++)
+	{
+		b3ConstraintArray& rows = *pools[pool];
+		const b3AlignedObjectArray<int>& blockOffsets = m_batchBlockOffsets[pool];
+		for (int block=blockOffsets[0];block<blockOffsets[blockOffsets.size()-1];block++)
+		{
+			const float* appliedImpulses = &m_data[m_width+block*blockSize+B3_ROW_APPLIED_IMPULSE*m_width];
+			for (int lane=0;lane<m_width;lane++)
+			{
+				int row = m_rows[block*m_width+lane];
+				if (row>=0)
+					rows[row].m_appliedImpulse = appliedImpulses[lane];
+			}
+		}
+	}
+
+	for (int i=0;i<bodies.size();i++)
+	{
+		if (bodies[i].m_invMass.isZero())
+			continue;
+		const float* vel = &m_deltaVelocities[i*8];
+		bodies[i].m_deltaLinearVelocity.setValue(vel[0],vel[1],vel[2]);
+		bodies[i].m_deltaAngularVelocity.setValue(vel[3],vel[4],vel[5]);
+	}
+}
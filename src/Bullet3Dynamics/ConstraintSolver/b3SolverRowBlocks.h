@@ -0,0 +1,123 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SOLVER_ROW_BLOCKS_H
+#define B3_SOLVER_ROW_BLOCKS_H
+
+#include "b3SolverBody.h"
+#include "b3SolverConstraint.h"
+#include "b3SolverIterationStats.h"
+
+///b3SolverRowBlocks packs the rows of each color batch into structure-of-arrays blocks of getWidth() rows.
+///Rows in a batch share no dynamic body, so a block is solved with one SIMD lane per row:
+///8 lanes with AVX2 when the cpu supports it, 4 lanes with SSE otherwise.
+///While the blocks are solved the delta velocities of the solver bodies live in a compact copy, see writeBack.
+class b3SolverRowBlocks
+{
+public:
+
+	enum b3RowBlockPool
+	{
+		B3_ROW_BLOCKS_NON_CONTACT=0,
+		B3_ROW_BLOCKS_CONTACT,
+		B3_ROW_BLOCKS_FRICTION,
+		B3_ROW_BLOCKS_ROLLING_FRICTION,
+		B3_ROW_BLOCKS_NUM_POOLS
+	};
+
+	enum b3RowBlockField
+	{
+		B3_ROW_NORMAL_X=0,B3_ROW_NORMAL_Y,B3_ROW_NORMAL_Z,
+		B3_ROW_RELPOS1_CROSS_NORMAL_X,B3_ROW_RELPOS1_CROSS_NORMAL_Y,B3_ROW_RELPOS1_CROSS_NORMAL_Z,
+		B3_ROW_RELPOS2_CROSS_NORMAL_X,B3_ROW_RELPOS2_CROSS_NORMAL_Y,B3_ROW_RELPOS2_CROSS_NORMAL_Z,
+		B3_ROW_LINEAR_A_X,B3_ROW_LINEAR_A_Y,B3_ROW_LINEAR_A_Z,//contact normal times the inverse mass of body A
+		B3_ROW_LINEAR_B_X,B3_ROW_LINEAR_B_Y,B3_ROW_LINEAR_B_Z,
+		B3_ROW_ANGULAR_A_X,B3_ROW_ANGULAR_A_Y,B3_ROW_ANGULAR_A_Z,
+		B3_ROW_ANGULAR_B_X,B3_ROW_ANGULAR_B_Y,B3_ROW_ANGULAR_B_Z,
+		B3_ROW_JAC_DIAG_AB_INV,
+		B3_ROW_RHS,
+		B3_ROW_CFM,
+		B3_ROW_LOWER_LIMIT,
+		B3_ROW_UPPER_LIMIT,
+		B3_ROW_APPLIED_IMPULSE,
+		B3_ROW_FRICTION,
+		B3_ROW_NUM_ITERATIONS,//m_overrideNumSolverIterations of non-contact rows
+		B3_ROW_NUM_FIELDS
+	};
+
+protected:
+
+	int		m_width;
+
+	///B3_ROW_NUM_FIELDS*m_width floats per block, preceded by m_width zeros used by the padding lanes
+	b3AlignedObjectArray<float>	m_data;
+	///2*m_width offsets into m_deltaVelocities per block, body A lanes first
+	b3AlignedObjectArray<int>	m_bodyOffsets;
+	///m_width indices into m_data per block, the applied impulse of the contact row of a friction row
+	b3AlignedObjectArray<int>	m_contactImpulseIndices;
+	///m_width pool rows per block, -1 for padding lanes
+	b3AlignedObjectArray<int>	m_rows;
+	///absolute block indices, the blocks of the pools are stored one after the other
+	b3AlignedObjectArray<int>	m_batchBlockOffsets[B3_ROW_BLOCKS_NUM_POOLS];
+	int		m_numBlocks;
+
+	///m_data index of the applied impulse of each contact row
+	b3AlignedObjectArray<int>	m_contactRowImpulseIndices;
+
+	///8 floats per solver body (linear and angular delta velocity), plus a zero slot shared by all static bodies
+	b3AlignedObjectArray<float>	m_deltaVelocities;
+	int		m_staticBodyOffset;
+
+	void	packPool(int pool, const b3AlignedObjectArray<b3SolverBody>& bodies, const b3ConstraintArray& rows,
+					const b3AlignedObjectArray<int>& order, const b3AlignedObjectArray<int>& batchOffsets);
+
+	void	solveBlocksSse(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual);
+	void	solveBlocksAvx2(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual);
+	void	solveBlocksScalar(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual);
+
+public:
+
+	b3SolverRowBlocks();
+
+	///8 when the cpu supports AVX2, 4 otherwise
+	static int	getSimdWidth();
+
+	int		getWidth() const
+	{
+		return m_width;
+	}
+
+	///only valid before build, 8 falls back to 4 when getSimdWidth is 4
+	void	setWidth(int width);
+
+	///pools, orders and batchOffsets are indexed by b3RowBlockPool, batchOffsets are the color batches of the order arrays
+	void	build(const b3AlignedObjectArray<b3SolverBody>& bodies, const b3ConstraintArray* const* pools,
+				const b3AlignedObjectArray<int>* const* orders, const b3AlignedObjectArray<int>* const* batchOffsets);
+
+	///block range of each color batch of a pool
+	const b3AlignedObjectArray<int>&	getBatchBlockOffsets(int pool) const
+	{
+		return m_batchBlockOffsets[pool];
+	}
+
+	///solves the blocks [beginBlock,endBlock) of a pool, the blocks of a color batch can be solved concurrently.
+	///The delta impulses of the solved rows are added to residual, padding lanes and skipped rows are not counted
+	void	solveBlocks(int pool, int beginBlock, int endBlock, int iteration, b3SolverResidual& residual);
+
+	///copies the applied impulses back into the rows and the delta velocities into the solver bodies
+	void	writeBack(b3AlignedObjectArray<b3SolverBody>& bodies, b3ConstraintArray* const* pools) const;
+};
+
+#endif //B3_SOLVER_ROW_BLOCKS_H
@@ -0,0 +1,108 @@
+#ifndef B3_CONTACT_BLOCK_SOLVER_H
+#define B3_CONTACT_BLOCK_SOLVER_H
+
+///block solver for the normal impulses of a contact manifold with up to 4 points, shared by the host and OpenCL solvers
+///A is the 4x4 (row major) effective mass matrix of the points, the relative normal velocity is w = A*lambda + b
+///it finds lambda >= 0 with w >= 0 and lambda[i]*w[i] = 0 by enumerating the active sets, the most active points first
+
+#define B3_CONTACT_BLOCK_MAX_POINTS 4
+///relative regularization of the diagonal, 4 coplanar points only have 3 independent normal rows
+#define B3_CONTACT_BLOCK_REGULARIZATION 1e-4f
+#define B3_CONTACT_BLOCK_TOLERANCE 1e-5f
+
+inline int b3ContactBlockCountBits(int mask)
+{
+	int count = 0;
+	for (int i=0;i<B3_CONTACT_BLOCK_MAX_POINTS;i++)
+	{
+		if (mask&(1<<i))
+			count++;
+	}
+	return count;
+}
+
+///solves the points in activeMask as equalities, returns 0 when the solution violates lambda >= 0 or w >= 0
+inline int b3SolveContactBlockSubset(const float* A, const float* b, int n, int activeMask, float* lambda)
+{
+	float M[16];
+	float r[4];
+	float y[4];
+	int idx[4];
+	int k = 0;
+	for (int i=0;i<n;i++)
+	{
+		if (activeMask&(1<<i))
+			idx[k++] = i;
+	}
+
+	for (int i=0;i<k;i++)
+	{
+		for (int j=0;j<k;j++)
+			M[i*4+j] = A[idx[i]*4+idx[j]];
+		M[i*4+i] *= 1.f+B3_CONTACT_BLOCK_REGULARIZATION;
+		r[i] = -b[idx[i]];
+	}
+
+	//Gaussian elimination without pivoting, the matrix is symmetric and (after regularization) positive definite
+	for (int p=0;p<k;p++)
+	{
+		float pivot = M[p*4+p];
+		if (pivot <= B3_CONTACT_BLOCK_TOLERANCE*A[idx[p]*4+idx[p]])
+			return 0;
+		float invPivot = 1.f/pivot;
+		for (int i=p+1;i<k;i++)
+		{
+			float f = M[i*4+p]*invPivot;
+			for (int j=p;j<k;j++)
+				M[i*4+j] -= f*M[p*4+j];
+			r[i] -= f*r[p];
+		}
+	}
+	for (int i=k-1;i>=0;i--)
+	{
+		float s = r[i];
+		for (int j=i+1;j<k;j++)
+			s -= M[i*4+j]*y[j];
+		y[i] = s/M[i*4+i];
+		if (y[i] < 0.f)
+			return 0;
+	}
+
+	//the separating points must not approach
+	for (int j=0;j<n;j++)
+	{
+		if (activeMask&(1<<j))
+			continue;
+		float w = b[j];
+		for (int i=0;i<k;i++)
+			w += A[j*4+idx[i]]*y[i];
+		float absB = b[j] < 0.f ? -b[j] : b[j];
+		if (w < -B3_CONTACT_BLOCK_TOLERANCE*(1.f+absB))
+			return 0;
+	}
+
+	for (int i=0;i<n;i++)
+		lambda[i] = 0.f;
+	for (int i=0;i<k;i++)
+		lambda[idx[i]] = y[i];
+	return 1;
+}
+
+///returns 0 when no active set satisfies the conditions, the caller should solve the points one by one instead
+inline int b3SolveContactBlockLcp(const float* A, const float* b, int n, float* lambda)
+{
+	int numMasks = 1<<n;
+	for (int numActive=n;numActive>=0;numActive--)
+	{
+		for (int mask=numMasks-1;mask>=0;mask--)
+		{
+			if (b3ContactBlockCountBits(mask)!=numActive)
+				continue;
+			if (b3SolveContactBlockSubset(A,b,n,mask,lambda))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+#endif //B3_CONTACT_BLOCK_SOLVER_H
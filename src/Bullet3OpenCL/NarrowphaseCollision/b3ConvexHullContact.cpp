@@ -32,6 +32,7 @@ int b3g_actualSATPairTests=0;
 #include <string.h>//memcpy
 #include "b3ConvexPolyhedronCL.h"
 #include "Bullet3OpenCL/NarrowphaseCollision/b3ContactCache.h"
+#include "Bullet3OpenCL/NarrowphaseCollision/b3SpherePairBatch.h"
 #include "Bullet3Geometry/b3AabbUtil.h"
 
 typedef b3AlignedObjectArray<b3Vector3> b3VertexArray;
@@ -40,6 +41,8 @@ typedef b3AlignedObjectArray<b3Vector3> b3VertexArray;
 #include <float.h> //for FLT_MAX
 #include "Bullet3OpenCL/Initialize/b3OpenCLUtils.h"
 #include "Bullet3OpenCL/ParallelPrimitives/b3LauncherCL.h"
+#include "Bullet3OpenCL/ParallelPrimitives/b3BoundSearchCL.h"
+#include "Bullet3OpenCL/ParallelPrimitives/b3FillCL.h"
 //#include "AdlQuaternion.h"
 
 #include "kernels/satKernels.h"
@@ -80,9 +83,33 @@ m_numConcavePairsOut(m_context, m_queue),
 m_gpuCompoundPairs(m_context, m_queue),
 m_gpuCompoundSepNormals(m_context, m_queue),
 m_gpuHasCompoundSepNormals(m_context, m_queue),
-m_numCompoundPairsOut(m_context, m_queue)
+m_numCompoundPairsOut(m_context, m_queue),
+m_pairTypeSortData(m_context, m_queue),
+m_sortedPairs(m_context, m_queue),
+m_pairTypeBinCountsGPU(m_context, m_queue),
+m_spherePairsA(m_context, m_queue),
+m_spherePairsB(m_context, m_queue),
+m_spherePairBodies(m_context, m_queue),
+m_currentManifoldCache(0),
+m_manifoldCacheSource(m_context, m_queue),
+m_manifoldCacheLinearThreshold(0.f),
+m_manifoldCacheAngularThreshold(0.f),
+m_numManifoldCacheLookups(0),
+m_numManifoldCacheHits(0)
 {
 	m_totalContactsOut.push_back(0);
+	for (int i=0;i<2;i++)
+	{
+		m_cachedManifolds[i] = new b3OpenCLArray<b3ContactManifoldCacheData>(m_context,m_queue);
+		m_cachedManifoldKeys[i] = new b3OpenCLArray<b3SortData>(m_context,m_queue);
+	}
+	m_pairTypeBinCountsGPU.resize(B3_NUM_PAIR_BINS);
+	for (int i=0;i<B3_NUM_PAIR_BINS;i++)
+		m_pairTypeBinCounts[i] = 0;
+
+	m_sort32 = new b3RadixSort32CL(m_context,m_device,m_queue);
+	m_search = new b3BoundSearchCL(m_context,m_device,m_queue,B3_NUM_PAIR_BINS);
+	m_fill = new b3FillCL(m_context,m_device,m_queue);
 	
 	cl_int errNum=0;
 
@@ -148,6 +175,12 @@ m_numCompoundPairsOut(m_context, m_queue)
         m_newContactReductionKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,srcClip,
                             "newContactReductionKernel",&errNum,satClipContactsProg);
 		b3Assert(errNum==CL_SUCCESS);
+
+		m_findCachedManifoldsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,srcClip, "findCachedManifoldsKernel",&errNum,satClipContactsProg);
+		b3Assert(errNum==CL_SUCCESS);
+
+		m_storeCachedManifoldsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,srcClip, "storeCachedManifoldsKernel",&errNum,satClipContactsProg);
+		b3Assert(errNum==CL_SUCCESS);
 	}
    else
 	{
@@ -158,6 +191,8 @@ m_numCompoundPairsOut(m_context, m_queue)
         m_clipFacesAndContactReductionKernel = 0;
 		m_clipHullHullConcaveConvexKernel = 0;
 		m_extractManifoldAndAddContactKernel = 0;
+		m_findCachedManifoldsKernel = 0;
+		m_storeCachedManifoldsKernel = 0;
 	}
 
 	 if (1)
@@ -186,6 +221,30 @@ m_numCompoundPairsOut(m_context, m_queue)
 		m_processCompoundPairsPrimitivesKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,primitiveContactsSrc, "processCompoundPairsPrimitivesKernel",&errNum,primitiveContactsProg,"");
 		b3Assert(errNum==CL_SUCCESS);
 		b3Assert(m_processCompoundPairsPrimitivesKernel);
+
+		m_computePairTypeBinsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,primitiveContactsSrc, "computePairTypeBinsKernel",&errNum,primitiveContactsProg,"");
+		b3Assert(errNum==CL_SUCCESS);
+		b3Assert(m_computePairTypeBinsKernel);
+
+		m_gatherPairsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,primitiveContactsSrc, "gatherPairsKernel",&errNum,primitiveContactsProg,"");
+		b3Assert(errNum==CL_SUCCESS);
+		b3Assert(m_gatherPairsKernel);
+
+		m_scatterPairsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,primitiveContactsSrc, "scatterPairsKernel",&errNum,primitiveContactsProg,"");
+		b3Assert(errNum==CL_SUCCESS);
+		b3Assert(m_scatterPairsKernel);
+
+		m_gatherSpherePairsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,primitiveContactsSrc, "gatherSpherePairsKernel",&errNum,primitiveContactsProg,"");
+		b3Assert(errNum==CL_SUCCESS);
+		b3Assert(m_gatherSpherePairsKernel);
+
+		m_sphereSphereContactsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,primitiveContactsSrc, "sphereSphereContactsKernel",&errNum,primitiveContactsProg,"");
+		b3Assert(errNum==CL_SUCCESS);
+		b3Assert(m_sphereSphereContactsKernel);
+
+		m_spherePlaneContactsKernel = b3OpenCLUtils::compileCLKernelFromString(m_context, m_device,primitiveContactsSrc, "spherePlaneContactsKernel",&errNum,primitiveContactsProg,"");
+		b3Assert(errNum==CL_SUCCESS);
+		b3Assert(m_spherePlaneContactsKernel);
 		 
 	 }
 	
@@ -223,6 +282,33 @@ GpuSatCollision::~GpuSatCollision()
 	if (m_processCompoundPairsPrimitivesKernel)
 		clReleaseKernel(m_processCompoundPairsPrimitivesKernel);
 
+	if (m_computePairTypeBinsKernel)
+		clReleaseKernel(m_computePairTypeBinsKernel);
+	if (m_gatherPairsKernel)
+		clReleaseKernel(m_gatherPairsKernel);
+	if (m_scatterPairsKernel)
+		clReleaseKernel(m_scatterPairsKernel);
+	if (m_gatherSpherePairsKernel)
+		clReleaseKernel(m_gatherSpherePairsKernel);
+	if (m_sphereSphereContactsKernel)
+		clReleaseKernel(m_sphereSphereContactsKernel);
+	if (m_spherePlaneContactsKernel)
+		clReleaseKernel(m_spherePlaneContactsKernel);
+
+	if (m_findCachedManifoldsKernel)
+		clReleaseKernel(m_findCachedManifoldsKernel);
+	if (m_storeCachedManifoldsKernel)
+		clReleaseKernel(m_storeCachedManifoldsKernel);
+	for (int i=0;i<2;i++)
+	{
+		delete m_cachedManifolds[i];
+		delete m_cachedManifoldKeys[i];
+	}
+
+	delete m_sort32;
+	delete m_search;
+	delete m_fill;
+
 	if (m_clipHullHullKernel)
 		clReleaseKernel(m_clipHullHullKernel);
 	if (m_clipCompoundsHullHullKernel)
@@ -433,7 +519,34 @@ int extractManifoldSequentialGlobal( const float4* p, int nPoints, const float4&
 #define MAX_VERTS 1024
 
 
-inline void project(const b3ConvexPolyhedronData& hull,  const float4& pos, const b3Quaternion& orn, const float4& dir, const b3AlignedObjectArray<b3Vector3>& vertices, b3Scalar& min, b3Scalar& max)
+//see supportHillClimb in sat.cl
+inline b3Scalar supportHillClimb(const b3ConvexPolyhedronData& hull, const float4& localDir, const b3AlignedObjectArray<b3Vector3>& vertices, const int* vertexAdjacency)
+{
+	int rowStarts = hull.m_vertexAdjacencyOffset;
+	int v = 0;
+	b3Scalar best = dot3F4((float4&)vertices[hull.m_vertexOffset],localDir);
+	bool improved = true;
+	while (improved)
+	{
+		improved = false;
+		int begin = vertexAdjacency[rowStarts+v];
+		int end = vertexAdjacency[rowStarts+v+1];
+		for (int n=begin;n<end;n++)
+		{
+			int w = vertexAdjacency[n];
+			b3Scalar dp = dot3F4((float4&)vertices[hull.m_vertexOffset+w],localDir);
+			if (dp>best)
+			{
+				best = dp;
+				v = w;
+				improved = true;
+			}
+		}
+	}
+	return best;
+}
+
+inline void project(const b3ConvexPolyhedronData& hull,  const float4& pos, const b3Quaternion& orn, const float4& dir, const b3AlignedObjectArray<b3Vector3>& vertices, b3Scalar& min, b3Scalar& max, const int* vertexAdjacency=0)
 {
 	min = FLT_MAX;
 	max = -FLT_MAX;
@@ -443,15 +556,22 @@ inline void project(const b3ConvexPolyhedronData& hull,  const float4& pos, cons
 
 	b3Scalar offset = dot3F4(pos,dir);
 
-	for(int i=0;i<numVerts;i++)
+	if (vertexAdjacency && hull.m_vertexAdjacencyOffset>=0)
+	{
+		max = supportHillClimb(hull,localDir,vertices,vertexAdjacency);
+		min = -supportHillClimb(hull,-localDir,vertices,vertexAdjacency);
+	} else
 	{
-		//b3Vector3 pt = trans * vertices[m_vertexOffset+i];
-		//b3Scalar dp = pt.dot(dir);
-		b3Vector3 vertex = vertices[hull.m_vertexOffset+i];
-		b3Scalar dp = dot3F4((float4&)vertices[hull.m_vertexOffset+i],localDir);
-		//b3Assert(dp==dpL);
-		if(dp < min)	min = dp;
-		if(dp > max)	max = dp;
+		for(int i=0;i<numVerts;i++)
+		{
+			//b3Vector3 pt = trans * vertices[m_vertexOffset+i];
+			//b3Scalar dp = pt.dot(dir);
+			b3Vector3 vertex = vertices[hull.m_vertexOffset+i];
+			b3Scalar dp = dot3F4((float4&)vertices[hull.m_vertexOffset+i],localDir);
+			//b3Assert(dp==dpL);
+			if(dp < min)	min = dp;
+			if(dp > max)	max = dp;
+		}
 	}
 	if(min>max)
 	{
@@ -467,12 +587,12 @@ inline void project(const b3ConvexPolyhedronData& hull,  const float4& pos, cons
 static bool TestSepAxis(const b3ConvexPolyhedronData& hullA, const b3ConvexPolyhedronData& hullB, 
 	const float4& posA,const b3Quaternion& ornA,
 	const float4& posB,const b3Quaternion& ornB,
-	const float4& sep_axis, const b3AlignedObjectArray<b3Vector3>& verticesA,const b3AlignedObjectArray<b3Vector3>& verticesB,b3Scalar& depth)
+	const float4& sep_axis, const b3AlignedObjectArray<b3Vector3>& verticesA,const b3AlignedObjectArray<b3Vector3>& verticesB,b3Scalar& depth, const int* vertexAdjacency=0)
 {
 	b3Scalar Min0,Max0;
 	b3Scalar Min1,Max1;
-	project(hullA,posA,ornA,sep_axis,verticesA, Min0, Max0);
-	project(hullB,posB,ornB, sep_axis,verticesB, Min1, Max1);
+	project(hullA,posA,ornA,sep_axis,verticesA, Min0, Max0, vertexAdjacency);
+	project(hullB,posB,ornB, sep_axis,verticesB, Min1, Max1, vertexAdjacency);
 
 	if(Max0<Min1 || Max1<Min0)
 		return false;
@@ -491,6 +611,76 @@ inline bool IsAlmostZero(const b3Vector3& v)
 	return true;
 }
 
+//see isMinkowskiFace in sat.cl
+inline bool isMinkowskiFace(const b3Vector3& a, const b3Vector3& b, const b3Vector3& bxa, const b3Vector3& c, const b3Vector3& d, const b3Vector3& dxc)
+{
+	b3Scalar cba = c.dot(bxa);
+	b3Scalar dba = d.dot(bxa);
+	b3Scalar adc = a.dot(dxc);
+	b3Scalar bdc = b.dot(dxc);
+	return cba*dba<0.f && adc*bdc<0.f && cba*bdc>0.f;
+}
+
+//edge-edge axes of the Minkowski faces only, see findSeparatingAxisEdgeEdgeGaussMap in sat.cl
+static bool findSeparatingAxisEdgeEdgeGaussMap(const b3ConvexPolyhedronData& hullA, const b3ConvexPolyhedronData& hullB, 
+	const float4& posA,
+	const b3Quaternion& ornA,
+	const float4& posB,
+	const b3Quaternion& ornB,
+	const float4& deltaC2,
+	const b3AlignedObjectArray<b3Vector3>& verticesA,
+	const b3AlignedObjectArray<b3GpuFace>& facesA,
+	const b3AlignedObjectArray<b3Vector3>& verticesB,
+	const b3AlignedObjectArray<b3GpuFace>& facesB,
+	const int* vertexAdjacency,
+	const b3Int4* hullEdges,
+	b3Scalar& dmin,
+	b3Vector3& sep)
+{
+	b3Matrix3x3 basisA(ornA);
+	b3Matrix3x3 basisBinA = basisA.transpose()*b3Matrix3x3(ornB);
+
+	for(int e1=0;e1<hullB.m_numEdges;e1++)
+	{
+		const b3Int4& edgeB = hullEdges[hullB.m_edgeOffset+e1];
+		b3Vector3 c = -(basisBinA*(const b3Vector3&)facesB[hullB.m_faceOffset+edgeB.z].m_plane);
+		b3Vector3 d = -(basisBinA*(const b3Vector3&)facesB[hullB.m_faceOffset+edgeB.w].m_plane);
+		b3Vector3 dxc = d.cross(c);
+		b3Vector3 edge1 = basisBinA*(verticesB[hullB.m_vertexOffset+edgeB.y]-verticesB[hullB.m_vertexOffset+edgeB.x]);
+
+		for(int e0=0;e0<hullA.m_numEdges;e0++)
+		{
+			const b3Int4& edgeA = hullEdges[hullA.m_edgeOffset+e0];
+			b3Vector3 a = (const b3Vector3&)facesA[hullA.m_faceOffset+edgeA.z].m_plane;
+			b3Vector3 b = (const b3Vector3&)facesA[hullA.m_faceOffset+edgeA.w].m_plane;
+			a.w = 0.f;
+			b.w = 0.f;
+			if (!isMinkowskiFace(a,b,b.cross(a),c,d,dxc))
+				continue;
+
+			b3Vector3 edge0 = verticesA[hullA.m_vertexOffset+edgeA.y]-verticesA[hullA.m_vertexOffset+edgeA.x];
+			b3Vector3 crossje = edge0.cross(edge1);
+			if (crossje.length2() < 0.005f*0.005f*edge0.length2()*edge1.length2())
+				continue;
+
+			crossje = basisA*crossje;
+			crossje.normalize();
+			if (dot3F4(deltaC2,(float4&)crossje)<0)
+				crossje*=-1.f;
+
+			b3Scalar dist;
+			if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,(float4&)crossje, verticesA,verticesB,dist,vertexAdjacency))
+				return false;
+
+			if(dist<dmin)
+			{
+				dmin = dist;
+				sep = crossje;
+			}
+		}
+	}
+	return true;
+}
 
 static bool findSeparatingAxis(	const b3ConvexPolyhedronData& hullA, const b3ConvexPolyhedronData& hullB, 
 	const float4& posA1,
@@ -506,7 +696,9 @@ static bool findSeparatingAxis(	const b3ConvexPolyhedronData& hullA, const b3Con
 	const b3AlignedObjectArray<b3GpuFace>& facesB,
 	const b3AlignedObjectArray<int>& indicesB,
 
-	b3Vector3& sep)
+	b3Vector3& sep,
+	const int* vertexAdjacency=0,
+	const b3Int4* hullEdges=0)
 {
 	B3_PROFILE("findSeparatingAxis");
 
@@ -546,7 +738,7 @@ static bool findSeparatingAxis(	const b3ConvexPolyhedronData& hullA, const b3Con
 
 		
 		b3Scalar d;
-		if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,faceANormalWS, verticesA, verticesB,d))
+		if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,faceANormalWS, verticesA, verticesB,d,vertexAdjacency))
 			return false;
 
 		if(d<dmin)
@@ -576,7 +768,7 @@ static bool findSeparatingAxis(	const b3ConvexPolyhedronData& hullA, const b3Con
 #endif
 
 		b3Scalar d;
-		if(!TestSepAxis(hullA, hullB,posA,ornA,posB,ornB,WorldNormal,verticesA,verticesB,d))
+		if(!TestSepAxis(hullA, hullB,posA,ornA,posB,ornB,WorldNormal,verticesA,verticesB,d,vertexAdjacency))
 			return false;
 
 		if(d<dmin)
@@ -588,6 +780,15 @@ static bool findSeparatingAxis(	const b3ConvexPolyhedronData& hullA, const b3Con
 
 	b3Vector3 edgeAstart,edgeAend,edgeBstart,edgeBend;
 
+	if (hullEdges && hullA.m_numEdges && hullB.m_numEdges)
+	{
+		if (!findSeparatingAxisEdgeEdgeGaussMap(hullA,hullB,posA,ornA,posB,ornB,deltaC2,verticesA,facesA,verticesB,facesB,vertexAdjacency,hullEdges,dmin,sep))
+			return false;
+		if((dot3F4(-deltaC2,(float4&)sep))>0.0f)
+			sep = -sep;
+		return true;
+	}
+
 	int curEdgeEdge = 0;
 	// Test edges
 	for(int e0=0;e0<hullA.m_numUniqueEdges;e0++)
@@ -619,7 +820,7 @@ static bool findSeparatingAxis(	const b3ConvexPolyhedronData& hullA, const b3Con
 #endif
 
 				b3Scalar dist;
-				if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,crossje, verticesA,verticesB,dist))
+				if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,crossje, verticesA,verticesB,dist,vertexAdjacency))
 					return false;
 
 				if(dist<dmin)
@@ -1774,6 +1975,8 @@ __kernel void   processCompoundPairsKernel( __global const b3Int4* gpuCompoundPa
 										__global const b3AlignedObjectArray<b3Float4>& uniqueEdges,
 										__global const b3AlignedObjectArray<b3GpuFace>& faces,
 										__global const b3AlignedObjectArray<int>& indices,
+										__global const int* vertexAdjacency,
+										__global const b3Int4* hullEdges,
 										__global b3Aabb* aabbs,
 										__global const b3GpuChildShape* gpuChildShapes,
 										__global b3AlignedObjectArray<b3Float4>& gpuCompoundSepNormalsOut,
@@ -1856,7 +2059,7 @@ __kernel void   processCompoundPairsKernel( __global const b3Int4* gpuCompoundPa
 		const float4 DeltaC2 = c0 - c1;
 		float4 sepNormal = make_float4(1,0,0,0);
 //		bool sepA = findSeparatingAxis(	convexShapes[shapeIndexA], convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,&sepNormal,&dmin);
-		bool sepA = findSeparatingAxis(	convexShapes[shapeIndexA], convexShapes[shapeIndexB],posA,ornA,posB,ornB,vertices,uniqueEdges,faces,indices,vertices,uniqueEdges,faces,indices,sepNormal);//,&dmin);
+		bool sepA = findSeparatingAxis(	convexShapes[shapeIndexA], convexShapes[shapeIndexB],posA,ornA,posB,ornB,vertices,uniqueEdges,faces,indices,vertices,uniqueEdges,faces,indices,sepNormal,vertexAdjacency,hullEdges);//,&dmin);
 	
 		hasSeparatingAxis = 4;
 		if (!sepA)
@@ -1864,7 +2067,7 @@ __kernel void   processCompoundPairsKernel( __global const b3Int4* gpuCompoundPa
 			hasSeparatingAxis = 0;
 		} else
 		{
-			bool sepB = findSeparatingAxis(	convexShapes[shapeIndexB],convexShapes[shapeIndexA],posB,ornB,posA,ornA,vertices,uniqueEdges,faces,indices,vertices,uniqueEdges,faces,indices,sepNormal);//,&dmin);
+			bool sepB = findSeparatingAxis(	convexShapes[shapeIndexB],convexShapes[shapeIndexA],posB,ornB,posA,ornA,vertices,uniqueEdges,faces,indices,vertices,uniqueEdges,faces,indices,sepNormal,vertexAdjacency,hullEdges);//,&dmin);
 
 			if (!sepB)
 			{
@@ -2033,6 +2236,8 @@ void computeContactCompoundCompound(int pairIndex,
 																const b3AlignedObjectArray<b3Vector3>& hostUniqueEdges,
 																const b3AlignedObjectArray<int>& convexIndices,
 																const b3AlignedObjectArray<b3GpuFace>& faces,
+																const b3AlignedObjectArray<int>& vertexAdjacency,
+																const b3AlignedObjectArray<b3Int4>& hullEdges,
 																
 																b3Contact4* globalContactsOut,
 																int& nGlobalContactsOut,
@@ -2085,7 +2290,8 @@ void computeContactCompoundCompound(int pairIndex,
 	for (int i=0;i<numCompoundPairsOut;i++)
 	{
 
-		processCompoundPairsKernel(&cpuCompoundPairsOut[0],rigidBodies,collidables,convexShapes,convexVertices,hostUniqueEdges,faces,convexIndices,0,cpuChildShapes,
+		processCompoundPairsKernel(&cpuCompoundPairsOut[0],rigidBodies,collidables,convexShapes,convexVertices,hostUniqueEdges,faces,convexIndices,
+			vertexAdjacency.size()? &vertexAdjacency[0] : 0, hullEdges.size()? &hullEdges[0] : 0,0,cpuChildShapes,
 			cpuCompoundSepNormalsOut,cpuHasCompoundSepNormalsOut,numCompoundPairsOut,i);
 	}
 
@@ -2491,6 +2697,650 @@ void	computeContactSphereConvex(int pairIndex,
 
 
 
+///box and capsule dimensions live in the face array, see b3GpuNarrowPhase::registerBoxShape/registerCapsuleShape
+static int appendPrimitiveContact(int pairIndex, int bodyIndexA, int bodyIndexB,
+								const b3RigidBodyCL* rigidBodies,
+								const b3Vector3& normalOnB, const b3Vector3* pointsOnB, int numPoints,
+								b3Contact4* globalContactsOut,
+								int& nGlobalContactsOut,
+								int maxContactCapacity)
+{
+	if (nGlobalContactsOut < maxContactCapacity)
+	{
+		int dstIdx=nGlobalContactsOut;
+		nGlobalContactsOut++;
+
+		b3Contact4* c = &globalContactsOut[dstIdx];
+		c->m_worldNormalOnB = normalOnB;
+		c->setFrictionCoeff(0.7);
+		c->setRestituitionCoeff(0.f);
+
+		c->m_batchIdx = pairIndex;
+		c->m_bodyAPtrAndSignBit = rigidBodies[bodyIndexA].m_invMass==0?-bodyIndexA:bodyIndexA;
+		c->m_bodyBPtrAndSignBit = rigidBodies[bodyIndexB].m_invMass==0?-bodyIndexB:bodyIndexB;
+		c->m_childIndexA = -1;
+		c->m_childIndexB = -1;
+		for (int i=0;i<numPoints;i++)
+			c->m_worldPosB[i] = pointsOnB[i];
+		c->m_worldNormalOnB.w = (b3Scalar)numPoints;
+		return dstIdx;
+	}
+	return -1;
+}
+
+//world space segment of a capsule, a sphere is treated as a capsule with a zero length segment
+static void getCapsuleSegment(const b3Collidable& col, const b3GpuFace* faces, const b3Vector3& pos, const b3Quaternion& orn,
+							b3Vector3& p0, b3Vector3& p1, float& radius)
+{
+	radius = col.m_radius;
+	p0 = pos;
+	p1 = pos;
+	if (col.m_shapeType==SHAPE_CAPSULE)
+	{
+		const b3Vector3& axis = faces[col.m_shapeIndex].m_plane;
+		b3Vector3 halfAxis = b3QuatRotate(orn,b3MakeVector3(axis.x,axis.y,axis.z))*axis.w;
+		p0 = pos-halfAxis;
+		p1 = pos+halfAxis;
+	}
+	p0.w = 0.f;
+	p1.w = 0.f;
+}
+
+//closest points between segments p1-q1 and p2-q2, see Ericson, Real-Time Collision Detection, 5.1.9
+static void closestPtSegmentSegment(const b3Vector3& p1, const b3Vector3& q1, const b3Vector3& p2, const b3Vector3& q2, float& sOut, float& tOut)
+{
+	b3Vector3 d1 = q1-p1;
+	b3Vector3 d2 = q2-p2;
+	b3Vector3 r = p1-p2;
+	float a = d1.dot(d1);
+	float e = d2.dot(d2);
+	float f = d2.dot(r);
+	float s = 0.f;
+	float t = 0.f;
+	if (a<=FLT_EPSILON && e<=FLT_EPSILON)
+	{
+		sOut = 0.f;
+		tOut = 0.f;
+		return;
+	}
+	if (a<=FLT_EPSILON)
+	{
+		t = b3Clamped(f/e,0.f,1.f);
+	} else
+	{
+		float c = d1.dot(r);
+		if (e<=FLT_EPSILON)
+		{
+			s = b3Clamped(-c/a,0.f,1.f);
+		} else
+		{
+			float b = d1.dot(d2);
+			float denom = a*e-b*b;
+			if (denom>FLT_EPSILON)
+				s = b3Clamped((b*f-c*e)/denom,0.f,1.f);
+			t = (b*s+f)/e;
+			if (t<0.f)
+			{
+				t = 0.f;
+				s = b3Clamped(-c/a,0.f,1.f);
+			} else if (t>1.f)
+			{
+				t = 1.f;
+				s = b3Clamped((b-c)/a,0.f,1.f);
+			}
+		}
+	}
+	sOut = s;
+	tOut = t;
+}
+
+//signed distance from a point in box space to the box surface, negative inside
+static float pointBoxDistance(const b3Vector3& p, const b3Vector3& halfExtents, b3Vector3& closestOut, b3Vector3& normalOut)
+{
+	b3Vector3 closest;
+	for (int k=0;k<3;k++)
+		closest[k] = b3Clamped(p[k],-halfExtents[k],halfExtents[k]);
+	closest.w = 0.f;
+	b3Vector3 diff = p-closest;
+	float lenSqr = diff.dot(diff);
+	if (lenSqr>FLT_EPSILON*FLT_EPSILON)
+	{
+		float len = b3Sqrt(lenSqr);
+		closestOut = closest;
+		normalOut = diff/len;
+		return len;
+	}
+
+	//inside, push out through the nearest face
+	int axis = 0;
+	float depth = halfExtents[0]-b3Fabs(p[0]);
+	for (int k=1;k<3;k++)
+	{
+		float d = halfExtents[k]-b3Fabs(p[k]);
+		if (d<depth)
+		{
+			depth = d;
+			axis = k;
+		}
+	}
+	normalOut.setValue(0,0,0);
+	normalOut[axis] = p[axis]<0.f? -1.f : 1.f;
+	closestOut = p;
+	closestOut[axis] = normalOut[axis]*halfExtents[axis];
+	return -depth;
+}
+
+void computeContactCapsuleCapsule(int pairIndex,
+								int bodyIndexA, int bodyIndexB, 
+								int collidableIndexA, int collidableIndexB, 
+								const b3RigidBodyCL* rigidBodies, 
+								const b3Collidable* collidables,
+								const b3GpuFace* faces,
+								b3Contact4* globalContactsOut,
+								int& nGlobalContactsOut,
+								int maxContactCapacity)
+{
+	b3Vector3 a0,a1,b0,b1;
+	float radiusA,radiusB;
+	getCapsuleSegment(collidables[collidableIndexA],faces,rigidBodies[bodyIndexA].m_pos,rigidBodies[bodyIndexA].m_quat,a0,a1,radiusA);
+	getCapsuleSegment(collidables[collidableIndexB],faces,rigidBodies[bodyIndexB].m_pos,rigidBodies[bodyIndexB].m_quat,b0,b1,radiusB);
+
+	b3Vector3 dA = a1-a0;
+	b3Vector3 dB = b1-b0;
+	float lenSqrA = dA.dot(dA);
+	float lenSqrB = dB.dot(dB);
+
+	//parameters along segment B of the points to test
+	float tB[2];
+	int numTests = 0;
+
+	b3Vector3 c = dA.cross(dB);
+	if (lenSqrA>FLT_EPSILON && lenSqrB>FLT_EPSILON && c.dot(c)<=1e-6f*lenSqrA*lenSqrB)
+	{
+		//(nearly) parallel segments touch along a line, use both ends of the overlap so the capsules can rest on each other
+		float t0 = (a0-b0).dot(dB)/lenSqrB;
+		float t1 = (a1-b0).dot(dB)/lenSqrB;
+		float tMin = b3Max(b3Min(t0,t1),0.f);
+		float tMax = b3Min(b3Max(t0,t1),1.f);
+		if (tMin<tMax)
+		{
+			tB[0] = tMin;
+			tB[1] = tMax;
+			numTests = 2;
+		}
+	}
+
+	if (numTests==0)
+	{
+		float s,t;
+		closestPtSegmentSegment(a0,a1,b0,b1,s,t);
+		tB[0] = t;
+		numTests = 1;
+	}
+
+	b3Vector3 pointsOnB[2];
+	int numPoints = 0;
+	b3Vector3 normalOnB = b3MakeVector3(1,0,0);
+
+	for (int i=0;i<numTests;i++)
+	{
+		b3Vector3 pB = b0+dB*tB[i];
+		float s = 0.f;
+		if (lenSqrA>FLT_EPSILON)
+			s = b3Clamped((pB-a0).dot(dA)/lenSqrA,0.f,1.f);
+		b3Vector3 pA = a0+dA*s;
+		b3Vector3 diff = pA-pB;
+		float len = diff.length();
+		float dist = len-(radiusA+radiusB);
+		if (dist<=0.f)
+		{
+			if (numPoints==0 && len>0.00001f)
+				normalOnB = diff/len;
+			b3Vector3 contactPosB = pB+normalOnB*radiusB;
+			contactPosB.w = dist;
+			pointsOnB[numPoints++] = contactPosB;
+		}
+	}
+
+	if (numPoints)
+	{
+		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numPoints,
+			globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+	}
+}
+
+void computeContactCapsuleBox(int pairIndex,
+								int bodyIndexA, int bodyIndexB, 
+								int collidableIndexA, int collidableIndexB, 
+								const b3RigidBodyCL* rigidBodies, 
+								const b3Collidable* collidables,
+								const b3GpuFace* faces,
+								b3Contact4* globalContactsOut,
+								int& nGlobalContactsOut,
+								int maxContactCapacity)
+{
+	b3Vector3 a0,a1;
+	float radius;
+	getCapsuleSegment(collidables[collidableIndexA],faces,rigidBodies[bodyIndexA].m_pos,rigidBodies[bodyIndexA].m_quat,a0,a1,radius);
+
+	b3Transform boxTrans;
+	boxTrans.setIdentity();
+	boxTrans.setOrigin(rigidBodies[bodyIndexB].m_pos);
+	boxTrans.setRotation(rigidBodies[bodyIndexB].m_quat);
+	b3Transform boxInv = boxTrans.inverse();
+	const b3Vector3& h = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;
+	b3Vector3 halfExtents = b3MakeVector3(h.x,h.y,h.z);
+
+	b3Vector3 p0 = boxInv(a0);
+	b3Vector3 p1 = boxInv(a1);
+	b3Vector3 seg = p1-p0;
+
+	//candidate parameters along the segment: end points, center and the closest points to the 12 box edges
+	float candidates[15];
+	int numCandidates = 0;
+	candidates[numCandidates++] = 0.f;
+	bool isSegment = seg.dot(seg)>FLT_EPSILON;
+	if (isSegment)
+	{
+		candidates[numCandidates++] = 1.f;
+		candidates[numCandidates++] = 0.5f;
+		for (int i=0;i<4;i++)
+		{
+			float su = (i&1)? 1.f : -1.f;
+			float sv = (i&2)? 1.f : -1.f;
+			float s,t;
+			closestPtSegmentSegment(p0,p1,b3MakeVector3(-h.x,su*h.y,sv*h.z),b3MakeVector3(h.x,su*h.y,sv*h.z),s,t);
+			candidates[numCandidates++] = s;
+			closestPtSegmentSegment(p0,p1,b3MakeVector3(su*h.x,-h.y,sv*h.z),b3MakeVector3(su*h.x,h.y,sv*h.z),s,t);
+			candidates[numCandidates++] = s;
+			closestPtSegmentSegment(p0,p1,b3MakeVector3(su*h.x,sv*h.y,-h.z),b3MakeVector3(su*h.x,sv*h.y,h.z),s,t);
+			candidates[numCandidates++] = s;
+		}
+	}
+
+	float bestDist = FLT_MAX;
+	float bestT = 0.f;
+	b3Vector3 bestClosest;
+	b3Vector3 bestNormal;
+	//extremes of the touching part of the segment, so a capsule lying on a face gets two points
+	float tMin = FLT_MAX;
+	float tMax = -FLT_MAX;
+	for (int i=0;i<numCandidates;i++)
+	{
+		b3Vector3 closest,normal;
+		float dist = pointBoxDistance(p0+seg*candidates[i],halfExtents,closest,normal);
+		if (dist<bestDist)
+		{
+			bestDist = dist;
+			bestT = candidates[i];
+			bestClosest = closest;
+			bestNormal = normal;
+		}
+		if (dist<=radius)
+		{
+			tMin = b3Min(tMin,candidates[i]);
+			tMax = b3Max(tMax,candidates[i]);
+		}
+	}
+
+	if (bestDist>radius)
+		return;
+
+	b3Vector3 pointsOnB[3];
+	int numPoints = 0;
+	pointsOnB[numPoints] = boxTrans(bestClosest);
+	pointsOnB[numPoints++].w = bestDist-radius;
+
+	if (isSegment)
+	{
+		float extremes[2] = {tMin,tMax};
+		for (int e=0;e<2;e++)
+		{
+			float t = extremes[e];
+			if (b3Fabs(t-bestT)>0.01f && (e==0 || b3Fabs(tMax-tMin)>0.01f))
+			{
+				b3Vector3 closest,normal;
+				float dist = pointBoxDistance(p0+seg*t,halfExtents,closest,normal);
+				pointsOnB[numPoints] = boxTrans(closest);
+				pointsOnB[numPoints++].w = dist-radius;
+			}
+		}
+	}
+
+	b3Vector3 normalOnB = boxTrans.getBasis()*bestNormal;
+	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numPoints,
+		globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+}
+
+static float boxBoxAxisOverlap(const b3Vector3& axis, const b3Vector3& delta, const b3Vector3* axesA, const b3Vector3& halfA, const b3Vector3* axesB, const b3Vector3& halfB)
+{
+	float rA = halfA[0]*b3Fabs(axis.dot(axesA[0]))+halfA[1]*b3Fabs(axis.dot(axesA[1]))+halfA[2]*b3Fabs(axis.dot(axesA[2]));
+	float rB = halfB[0]*b3Fabs(axis.dot(axesB[0]))+halfB[1]*b3Fabs(axis.dot(axesB[1]))+halfB[2]*b3Fabs(axis.dot(axesB[2]));
+	return rA+rB-b3Fabs(delta.dot(axis));
+}
+
+//keeps the part of the polygon with dot(planeNormal,p)<=planeConstant
+static int clipPolygonAgainstPlane(const b3Vector3* pIn, int numIn, const b3Vector3& planeNormal, float planeConstant, b3Vector3* pOut)
+{
+	int numOut = 0;
+	if (numIn<1)
+		return 0;
+	b3Vector3 prev = pIn[numIn-1];
+	float prevDist = planeNormal.dot(prev)-planeConstant;
+	for (int i=0;i<numIn;i++)
+	{
+		b3Vector3 cur = pIn[i];
+		float curDist = planeNormal.dot(cur)-planeConstant;
+		if ((curDist<=0.f) != (prevDist<=0.f))
+		{
+			pOut[numOut++] = prev+(cur-prev)*(prevDist/(prevDist-curDist));
+		}
+		if (curDist<=0.f)
+		{
+			pOut[numOut++] = cur;
+		}
+		prev = cur;
+		prevDist = curDist;
+	}
+	return numOut;
+}
+
+#define MAX_BOX_BOX_CLIP_POINTS 8
+
+//15 axis separating axis test, followed by reference face clipping or an edge-edge closest point
+void computeContactBoxBox(int pairIndex,
+							int bodyIndexA, int bodyIndexB, 
+							int collidableIndexA, int collidableIndexB, 
+							const b3RigidBodyCL* rigidBodies, 
+							const b3Collidable* collidables,
+							const b3GpuFace* faces,
+							b3Contact4* globalContactsOut,
+							int& nGlobalContactsOut,
+							int maxContactCapacity)
+{
+	b3Vector3 posA = rigidBodies[bodyIndexA].m_pos;
+	b3Vector3 posB = rigidBodies[bodyIndexB].m_pos;
+	b3Matrix3x3 basisA(rigidBodies[bodyIndexA].m_quat);
+	b3Matrix3x3 basisB(rigidBodies[bodyIndexB].m_quat);
+	const b3Vector3& extentsA = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;
+	const b3Vector3& extentsB = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;
+	b3Vector3 hA = b3MakeVector3(extentsA.x,extentsA.y,extentsA.z);
+	b3Vector3 hB = b3MakeVector3(extentsB.x,extentsB.y,extentsB.z);
+
+	b3Vector3 axesA[3];
+	b3Vector3 axesB[3];
+	for (int i=0;i<3;i++)
+	{
+		axesA[i] = basisA.getColumn(i);
+		axesB[i] = basisB.getColumn(i);
+	}
+
+	b3Vector3 delta = posB-posA;
+	float bestOverlap = FLT_MAX;
+	b3Vector3 bestAxis = b3MakeVector3(0,0,0);
+	int bestType = -1;
+
+	//face axes of A (0..2) and B (3..5)
+	for (int i=0;i<6;i++)
+	{
+		b3Vector3 axis = i<3? axesA[i] : axesB[i-3];
+		float overlap = boxBoxAxisOverlap(axis,delta,axesA,hA,axesB,hB);
+		if (overlap<0.f)
+			return;
+		if (overlap<bestOverlap)
+		{
+			bestOverlap = overlap;
+			bestAxis = axis;
+			bestType = i;
+		}
+	}
+
+	//edge-edge axes (6..14), only taken when clearly better than a face to keep resting contacts stable
+	for (int i=0;i<3;i++)
+	{
+		for (int j=0;j<3;j++)
+		{
+			b3Vector3 axis = axesA[i].cross(axesB[j]);
+			float lenSqr = axis.dot(axis);
+			if (lenSqr<1e-6f)
+				continue;
+			axis *= 1.f/b3Sqrt(lenSqr);
+			float overlap = boxBoxAxisOverlap(axis,delta,axesA,hA,axesB,hB);
+			if (overlap<0.f)
+				return;
+			if (overlap<0.95f*bestOverlap)
+			{
+				bestOverlap = overlap;
+				bestAxis = axis;
+				bestType = 6+i*3+j;
+			}
+		}
+	}
+
+	//make the axis point from A to B
+	if (delta.dot(bestAxis)<0.f)
+		bestAxis = -bestAxis;
+	b3Vector3 normalOnB = -bestAxis;
+
+	if (bestType>=6)
+	{
+		int i = (bestType-6)/3;
+		int j = (bestType-6)%3;
+		b3Vector3 edgeA = posA;
+		b3Vector3 edgeB = posB;
+		for (int k=0;k<3;k++)
+		{
+			if (k!=i)
+				edgeA += axesA[k]*(axesA[k].dot(bestAxis)>0.f? hA[k] : -hA[k]);
+			if (k!=j)
+				edgeB += axesB[k]*(axesB[k].dot(bestAxis)>0.f? -hB[k] : hB[k]);
+		}
+		//closest points between the two edge lines
+		b3Vector3 r = edgeA-edgeB;
+		float dAB = axesA[i].dot(axesB[j]);
+		float e = axesA[i].dot(r);
+		float f = axesB[j].dot(r);
+		float denom = 1.f-dAB*dAB;
+		float s = denom>FLT_EPSILON? (dAB*f-e)/denom : 0.f;
+		s = b3Clamped(s,-hA[i],hA[i]);
+		float t = b3Clamped(f+s*dAB,-hB[j],hB[j]);
+		b3Vector3 pointOnB = edgeB+axesB[j]*t;
+		pointOnB.w = -bestOverlap;
+		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,&pointOnB,1,
+			globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+		return;
+	}
+
+	bool refIsA = bestType<3;
+	int refFace = refIsA? bestType : bestType-3;
+	//reference face normal, pointing towards the incident box
+	b3Vector3 refNormal = refIsA? bestAxis : -bestAxis;
+	const b3Vector3& refPos = refIsA? posA : posB;
+	const b3Vector3& incPos = refIsA? posB : posA;
+	const b3Vector3* refAxes = refIsA? axesA : axesB;
+	const b3Vector3* incAxes = refIsA? axesB : axesA;
+	const b3Vector3& refH = refIsA? hA : hB;
+	const b3Vector3& incH = refIsA? hB : hA;
+
+	//incident face is the face most anti-parallel to the reference normal
+	int incFace = 0;
+	float maxAbsDot = -1.f;
+	for (int k=0;k<3;k++)
+	{
+		float absDot = b3Fabs(incAxes[k].dot(refNormal));
+		if (absDot>maxAbsDot)
+		{
+			maxAbsDot = absDot;
+			incFace = k;
+		}
+	}
+	b3Vector3 incNormal = incAxes[incFace].dot(refNormal)>0.f? -incAxes[incFace] : incAxes[incFace];
+	b3Vector3 incCenter = incPos+incNormal*incH[incFace];
+	int u = (incFace+1)%3;
+	int v = (incFace+2)%3;
+	b3Vector3 incU = incAxes[u]*incH[u];
+	b3Vector3 incV = incAxes[v]*incH[v];
+
+	b3Vector3 clipA[MAX_BOX_BOX_CLIP_POINTS];
+	b3Vector3 clipB[MAX_BOX_BOX_CLIP_POINTS];
+	clipA[0] = incCenter+incU+incV;
+	clipA[1] = incCenter-incU+incV;
+	clipA[2] = incCenter-incU-incV;
+	clipA[3] = incCenter+incU-incV;
+	int numPoints = 4;
+
+	//clip the incident face against the side planes of the reference face
+	int ru = (refFace+1)%3;
+	int rv = (refFace+2)%3;
+	float offsetU = refAxes[ru].dot(refPos);
+	float offsetV = refAxes[rv].dot(refPos);
+	numPoints = clipPolygonAgainstPlane(clipA,numPoints,refAxes[ru],offsetU+refH[ru],clipB);
+	numPoints = clipPolygonAgainstPlane(clipB,numPoints,-refAxes[ru],-offsetU+refH[ru],clipA);
+	numPoints = clipPolygonAgainstPlane(clipA,numPoints,refAxes[rv],offsetV+refH[rv],clipB);
+	numPoints = clipPolygonAgainstPlane(clipB,numPoints,-refAxes[rv],-offsetV+refH[rv],clipA);
+
+	b3Vector3 refCenter = refPos+refNormal*refH[refFace];
+	b3Vector3 contactPoints[MAX_BOX_BOX_CLIP_POINTS];
+	int numContacts = 0;
+	for (int k=0;k<numPoints;k++)
+	{
+		float depth = refNormal.dot(clipA[k]-refCenter);
+		if (depth<=0.f)
+		{
+			//contact points are reported on B
+			b3Vector3 pointOnB = refIsA? clipA[k] : clipA[k]-refNormal*depth;
+			pointOnB.w = depth;
+			contactPoints[numContacts++] = pointOnB;
+		}
+	}
+
+	if (numContacts==0)
+		return;
+
+	b3Int4 contactIdx;
+	contactIdx.s[0] = 0;
+	contactIdx.s[1] = 1;
+	contactIdx.s[2] = 2;
+	contactIdx.s[3] = 3;
+	int numReducedPoints = numContacts;
+	if (numContacts>4)
+	{
+		numReducedPoints = extractManifoldSequentialGlobal(contactPoints,numContacts,normalOnB,&contactIdx);
+	}
+	b3Vector3 pointsOnB[4];
+	for (int k=0;k<numReducedPoints;k++)
+		pointsOnB[k] = contactPoints[contactIdx.s[k]];
+	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numReducedPoints,
+		globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+}
+
+void computeContactPlaneBox(int pairIndex,
+							int bodyIndexA, int bodyIndexB, 
+							int collidableIndexA, int collidableIndexB, 
+							const b3RigidBodyCL* rigidBodies, 
+							const b3Collidable* collidables,
+							const b3GpuFace* faces,
+							b3Contact4* globalContactsOut,
+							int& nGlobalContactsOut,
+							int maxContactCapacity)
+{
+	b3Vector3 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;
+	b3Vector3 planeNormal = b3MakeVector3(planeEq.x,planeEq.y,planeEq.z);
+	float planeConstant = planeEq.w;
+	const b3Vector3& h = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;
+
+	b3Transform planeTransform;
+	planeTransform.setIdentity();
+	planeTransform.setOrigin(rigidBodies[bodyIndexA].m_pos);
+	planeTransform.setRotation(rigidBodies[bodyIndexA].m_quat);
+	b3Transform boxTransform;
+	boxTransform.setIdentity();
+	boxTransform.setOrigin(rigidBodies[bodyIndexB].m_pos);
+	boxTransform.setRotation(rigidBodies[bodyIndexB].m_quat);
+	b3Transform boxInPlane = planeTransform.inverse()*boxTransform;
+
+	b3Vector3 contactPoints[8];
+	int numPoints = 0;
+	for (int i=0;i<8;i++)
+	{
+		b3Vector3 vtx = b3MakeVector3((i&1)? h.x : -h.x,
+									(i&2)? h.y : -h.y,
+									(i&4)? h.z : -h.z);
+		float dist = planeNormal.dot(boxInPlane(vtx))-planeConstant;
+		if (dist<0.f)
+		{
+			b3Vector3 vtxWorld = boxTransform(vtx);
+			vtxWorld.w = dist;
+			contactPoints[numPoints++] = vtxWorld;
+		}
+	}
+
+	if (numPoints==0)
+		return;
+
+	b3Vector3 normalOnB = -(planeTransform.getBasis()*planeNormal);
+	b3Int4 contactIdx;
+	contactIdx.s[0] = 0;
+	contactIdx.s[1] = 1;
+	contactIdx.s[2] = 2;
+	contactIdx.s[3] = 3;
+	int numReducedPoints = numPoints;
+	if (numPoints>4)
+	{
+		numReducedPoints = extractManifoldSequentialGlobal(contactPoints,numPoints,normalOnB,&contactIdx);
+	}
+	b3Vector3 pointsOnB[4];
+	for (int k=0;k<numReducedPoints;k++)
+		pointsOnB[k] = contactPoints[contactIdx.s[k]];
+	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numReducedPoints,
+		globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+}
+
+void computeContactPlaneCapsule(int pairIndex,
+								int bodyIndexA, int bodyIndexB, 
+								int collidableIndexA, int collidableIndexB, 
+								const b3RigidBodyCL* rigidBodies, 
+								const b3Collidable* collidables,
+								const b3GpuFace* faces,
+								b3Contact4* globalContactsOut,
+								int& nGlobalContactsOut,
+								int maxContactCapacity)
+{
+	b3Vector3 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;
+	b3Vector3 planeNormal = b3MakeVector3(planeEq.x,planeEq.y,planeEq.z);
+	float planeConstant = planeEq.w;
+	b3Transform planeTransform;
+	planeTransform.setIdentity();
+	planeTransform.setOrigin(rigidBodies[bodyIndexA].m_pos);
+	planeTransform.setRotation(rigidBodies[bodyIndexA].m_quat);
+	b3Transform planeInv = planeTransform.inverse();
+	b3Vector3 planeNormalWorld = planeTransform.getBasis()*planeNormal;
+
+	b3Vector3 ends[2];
+	float radius;
+	getCapsuleSegment(collidables[collidableIndexB],faces,rigidBodies[bodyIndexB].m_pos,rigidBodies[bodyIndexB].m_quat,ends[0],ends[1],radius);
+
+	b3Vector3 pointsOnB[2];
+	int numPoints = 0;
+	for (int i=0;i<2;i++)
+	{
+		float dist = planeNormal.dot(planeInv(ends[i]))-planeConstant-radius;
+		if (dist<0.f)
+		{
+			b3Vector3 pointOnB = ends[i]-planeNormalWorld*radius;
+			pointOnB.w = dist;
+			pointsOnB[numPoints++] = pointOnB;
+		}
+	}
+
+	if (numPoints)
+	{
+		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,-planeNormalWorld,pointsOnB,numPoints,
+			globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+	}
+}
+
+
 #include "b3GjkPairDetector.h"
 #include "b3GjkEpa.h"
 #include "b3VoronoiSimplexSolver.h"
@@ -2734,6 +3584,8 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 			const b3OpenCLArray<b3Vector3>& gpuUniqueEdges,
 			const b3OpenCLArray<b3GpuFace>& gpuFaces,
 			const b3OpenCLArray<int>& gpuIndices,
+			const b3OpenCLArray<int>& gpuVertexAdjacency,
+			const b3OpenCLArray<b3Int4>& gpuHullEdges,
 			const b3OpenCLArray<b3Collidable>& gpuCollidables,
 			const b3OpenCLArray<b3GpuChildShape>& gpuChildShapes,
 
@@ -2759,6 +3611,8 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 	if (!nPairs)
 		return;
 
+	b3OpenCLArray<b3Int4>* unsortedPairs = pairs;
+	int binStart[B3_NUM_PAIR_BINS+1];
 
 
 #ifdef CHECK_ON_HOST
@@ -2799,6 +3653,10 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 	gpuFaces.copyToHost(hostFaces);
 	b3AlignedObjectArray<int> hostIndices;
 	gpuIndices.copyToHost(hostIndices);
+	b3AlignedObjectArray<int> hostVertexAdjacency;
+	gpuVertexAdjacency.copyToHost(hostVertexAdjacency);
+	b3AlignedObjectArray<b3Int4> hostHullEdges;
+	gpuHullEdges.copyToHost(hostHullEdges);
 	b3AlignedObjectArray<b3Collidable> hostCollidables;
 	gpuCollidables.copyToHost(hostCollidables);
 	
@@ -2823,6 +3681,34 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 
 	hostContacts.resize(maxContactCapacity);
 
+	{
+		//sphere-sphere and sphere-plane pairs are processed in batches
+		b3AlignedObjectArray<int> sphereSpherePairs;
+		b3AlignedObjectArray<int> spherePlanePairs;
+		for (int i=0;i<nPairs;i++)
+		{
+			int shapeTypeA = hostCollidables[hostBodyBuf[hostPairs[i].x].m_collidableIdx].m_shapeType;
+			int shapeTypeB = hostCollidables[hostBodyBuf[hostPairs[i].y].m_collidableIdx].m_shapeType;
+			if (shapeTypeA==SHAPE_SPHERE && shapeTypeB==SHAPE_SPHERE)
+				sphereSpherePairs.push_back(i);
+			if ((shapeTypeA==SHAPE_SPHERE && shapeTypeB==SHAPE_PLANE) || (shapeTypeA==SHAPE_PLANE && shapeTypeB==SHAPE_SPHERE))
+				spherePlanePairs.push_back(i);
+		}
+		b3SpherePairBatch batch;
+		if (sphereSpherePairs.size())
+		{
+			batch.gatherSphereSpherePairs(&hostPairs[0],&sphereSpherePairs[0],sphereSpherePairs.size(),&hostBodyBuf[0],&hostCollidables[0]);
+			nContacts = batch.computeSphereSphereContacts(&hostContacts[0],nContacts,maxContactCapacity);
+		}
+		if (spherePlanePairs.size())
+		{
+			batch.gatherSpherePlanePairs(&hostPairs[0],&spherePlanePairs[0],spherePlanePairs.size(),&hostBodyBuf[0],&hostCollidables[0],&hostFaces[0]);
+			nContacts = batch.computeSpherePlaneContacts(&hostContacts[0],nContacts,maxContactCapacity);
+		}
+		if (nContacts > maxContactCapacity)
+			nContacts = maxContactCapacity;
+	}
+
 	for (int i=0;i<nPairs;i++)
 	{
 		int bodyIndexA = hostPairs[i].x;
@@ -2868,7 +3754,7 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 			hostCollidables[collidableIndexB].m_shapeType == SHAPE_COMPOUND_OF_CONVEX_HULLS)
 		{
 			computeContactCompoundCompound(i,bodyIndexB,bodyIndexA,collidableIndexB,collidableIndexA,&hostBodyBuf[0],
-			&hostCollidables[0],&hostConvexData[0],&cpuChildShapes[0], hostAabbsWorldSpace,hostAabbsLocalSpace,hostVertices,hostUniqueEdges,hostIndices,hostFaces,&hostContacts[0],
+			&hostCollidables[0],&hostConvexData[0],&cpuChildShapes[0], hostAabbsWorldSpace,hostAabbsLocalSpace,hostVertices,hostUniqueEdges,hostIndices,hostFaces,hostVertexAdjacency,hostHullEdges,&hostContacts[0],
 			nContacts,maxContactCapacity,treeNodesCPU,subTreesCPU,bvhInfoCPU);	
 //			printf("convex-plane\n");
 			
@@ -2893,6 +3779,58 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 			
 		}
 
+		int shapeTypeA = hostCollidables[collidableIndexA].m_shapeType;
+		int shapeTypeB = hostCollidables[collidableIndexB].m_shapeType;
+
+		if (shapeTypeA == SHAPE_BOX && shapeTypeB == SHAPE_BOX)
+		{
+			computeContactBoxBox(i,bodyIndexA,bodyIndexB,collidableIndexA,collidableIndexB,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
+		if ((shapeTypeA == SHAPE_CAPSULE || shapeTypeA == SHAPE_SPHERE) && shapeTypeB == SHAPE_BOX)
+		{
+			computeContactCapsuleBox(i,bodyIndexA,bodyIndexB,collidableIndexA,collidableIndexB,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
+		if (shapeTypeA == SHAPE_BOX && (shapeTypeB == SHAPE_CAPSULE || shapeTypeB == SHAPE_SPHERE))
+		{
+			computeContactCapsuleBox(i,bodyIndexB,bodyIndexA,collidableIndexB,collidableIndexA,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
+		if ((shapeTypeA == SHAPE_CAPSULE && (shapeTypeB == SHAPE_CAPSULE || shapeTypeB == SHAPE_SPHERE)) ||
+			(shapeTypeA == SHAPE_SPHERE && shapeTypeB == SHAPE_CAPSULE))
+		{
+			computeContactCapsuleCapsule(i,bodyIndexA,bodyIndexB,collidableIndexA,collidableIndexB,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
+		if (shapeTypeA == SHAPE_PLANE && shapeTypeB == SHAPE_BOX)
+		{
+			computeContactPlaneBox(i,bodyIndexA,bodyIndexB,collidableIndexA,collidableIndexB,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
+		if (shapeTypeA == SHAPE_BOX && shapeTypeB == SHAPE_PLANE)
+		{
+			computeContactPlaneBox(i,bodyIndexB,bodyIndexA,collidableIndexB,collidableIndexA,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
+		if (shapeTypeA == SHAPE_PLANE && shapeTypeB == SHAPE_CAPSULE)
+		{
+			computeContactPlaneCapsule(i,bodyIndexA,bodyIndexB,collidableIndexA,collidableIndexB,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
+		if (shapeTypeA == SHAPE_CAPSULE && shapeTypeB == SHAPE_PLANE)
+		{
+			computeContactPlaneCapsule(i,bodyIndexB,bodyIndexA,collidableIndexB,collidableIndexA,&hostBodyBuf[0],
+				&hostCollidables[0],&hostFaces[0],&hostContacts[0],nContacts,maxContactCapacity);
+		}
+
 		if (hostCollidables[collidableIndexA].m_shapeType == SHAPE_CONVEX_HULL &&
 			hostCollidables[collidableIndexB].m_shapeType == SHAPE_CONVEX_HULL)
 		{
@@ -2931,10 +3869,84 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 	return;
 #else
 
+	sortPairsByType(unsortedPairs,nPairs,bodyBuf,gpuCollidables,binStart);
+	pairs = &m_sortedPairs;
+
+	if (m_pairTypeBinCounts[B3_PAIR_BIN_UNSUPPORTED_BOX_CAPSULE])
 	{
-		if (nPairs)
+		b3Warning("%d box or capsule pairs against a convex hull, compound or trimesh get no contacts, register a convex hull shape instead\n",
+			m_pairTypeBinCounts[B3_PAIR_BIN_UNSUPPORTED_BOX_CAPSULE]);
+	}
+
+	m_totalContactsOut.copyFromHostPointer(&nContacts,1,0,true);
+
+	{
+		int numSphereSpherePairs = m_pairTypeBinCounts[B3_PAIR_BIN_SPHERE_SPHERE];
+		int numSpherePairs = binStart[B3_PAIR_BIN_CONVEX_PLANE]-binStart[B3_PAIR_BIN_SPHERE_SPHERE];
+		if (numSpherePairs)
+		{
+			B3_PROFILE("spherePairsKernels");
+			m_spherePairsA.resize(numSpherePairs);
+			m_spherePairsB.resize(numSpherePairs);
+			m_spherePairBodies.resize(numSpherePairs);
+			{
+				b3BufferInfoCL bInfo[] = {
+					b3BufferInfoCL( pairs->getBufferCL(), true ), 
+					b3BufferInfoCL( bodyBuf->getBufferCL(),true), 
+					b3BufferInfoCL( gpuCollidables.getBufferCL(),true), 
+					b3BufferInfoCL( gpuFaces.getBufferCL(),true),
+					b3BufferInfoCL( m_spherePairsA.getBufferCL()),
+					b3BufferInfoCL( m_spherePairsB.getBufferCL()),
+					b3BufferInfoCL( m_spherePairBodies.getBufferCL())
+				};
+				b3LauncherCL launcher(m_queue, m_gatherSpherePairsKernel);
+				launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+				launcher.setConst( numSpherePairs );
+				launcher.setConst( binStart[B3_PAIR_BIN_SPHERE_SPHERE] );
+				launcher.launch1D( numSpherePairs);
+			}
+
+			b3BufferInfoCL bInfo[] = {
+				b3BufferInfoCL( m_spherePairsA.getBufferCL(), true ), 
+				b3BufferInfoCL( m_spherePairsB.getBufferCL(), true ), 
+				b3BufferInfoCL( m_spherePairBodies.getBufferCL(), true ), 
+				b3BufferInfoCL( contactOut->getBufferCL()),
+				b3BufferInfoCL( m_totalContactsOut.getBufferCL())	
+			};
+			if (numSphereSpherePairs)
+			{
+				b3LauncherCL launcher(m_queue, m_sphereSphereContactsKernel);
+				launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+				launcher.setConst( numSphereSpherePairs );
+				launcher.setConst( 0 );
+				launcher.setConst( binStart[B3_PAIR_BIN_SPHERE_SPHERE] );
+				launcher.setConst( maxContactCapacity );
+				launcher.launch1D( numSphereSpherePairs);
+			}
+			if (numSpherePairs>numSphereSpherePairs)
+			{
+				b3LauncherCL launcher(m_queue, m_spherePlaneContactsKernel);
+				launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+				launcher.setConst( numSpherePairs );
+				launcher.setConst( numSphereSpherePairs );
+				launcher.setConst( binStart[B3_PAIR_BIN_SPHERE_SPHERE] );
+				launcher.setConst( maxContactCapacity );
+				launcher.launch1D( numSpherePairs-numSphereSpherePairs);
+			}
+			clFinish(m_queue);
+			nContacts = m_totalContactsOut.at(0);
+			if (nContacts > maxContactCapacity)
+			{
+				b3Error("Exceeded contact capacity (%d/%d)\n",nContacts,maxContactCapacity);
+				nContacts = maxContactCapacity;
+				m_totalContactsOut.copyFromHostPointer(&nContacts,1,0,true);
+			}
+			contactOut->resize(nContacts);
+		}
+
+		int numPrimitivePairs = binStart[B3_PAIR_BIN_CONVEX_CONVEX]-binStart[B3_PAIR_BIN_CONVEX_PLANE];
+		if (numPrimitivePairs)
 		{
-			m_totalContactsOut.copyFromHostPointer(&nContacts,1,0,true);
 
 			B3_PROFILE("primitiveContactsKernel");
 			b3BufferInfoCL bInfo[] = {
@@ -2952,9 +3964,10 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 			
 			b3LauncherCL launcher(m_queue, m_primitiveContactsKernel);
 			launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
-			launcher.setConst( nPairs  );
+			launcher.setConst( binStart[B3_PAIR_BIN_CONVEX_CONVEX]  );
 			launcher.setConst(maxContactCapacity);
-			int num = nPairs;
+			launcher.setConst( binStart[B3_PAIR_BIN_CONVEX_PLANE] );
+			int num = numPrimitivePairs;
 			launcher.launch1D( num);
 			clFinish(m_queue);
 		
@@ -2972,6 +3985,8 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 	
 	m_sepNormals.resize(nPairs);
 	m_hasSeparatingNormals.resize(nPairs);
+	//only the convex-convex bin runs the separating axis test, the clipping stages skip the other pairs
+	m_fill->execute(m_hasSeparatingNormals,0,nPairs);
 	
 	int concaveCapacity=maxTriConvexPairCapacity;
 	m_concaveSepNormals.resize(concaveCapacity);
@@ -2995,11 +4010,77 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 	bool findSeparatingAxisOnGpu = true;//false;
 	int numConcavePairs =0;
 
+	bool useManifoldCache = m_findCachedManifoldsKernel && m_storeCachedManifoldsKernel &&
+		(m_manifoldCacheLinearThreshold>0.f) && (m_manifoldCacheAngularThreshold>0.f);
+	//contacts re-projected from the manifold cache and contacts clipped in this call
+	int reusedContactsStart = 0;
+	int reusedContactsEnd = 0;
+	int clippedContactsStart = 0;
+	int clippedContactsEnd = 0;
+	m_numManifoldCacheLookups = 0;
+	m_numManifoldCacheHits = 0;
+	if (!useManifoldCache)
+	{
+		m_cachedManifolds[m_currentManifoldCache]->resize(0);
+		m_cachedManifoldKeys[m_currentManifoldCache]->resize(0);
+	}
+
 	{
 		clFinish(m_queue);
 		if (findSeparatingAxisOnGpu)
 		{
 		
+			int numConvexPairs = m_pairTypeBinCounts[B3_PAIR_BIN_CONVEX_CONVEX];
+			if (numConvexPairs && useManifoldCache)
+			{
+				B3_PROFILE("findCachedManifoldsKernel");
+				m_manifoldCacheSource.resize(nPairs);
+				nContacts = m_totalContactsOut.at(0);
+				reusedContactsStart = nContacts;
+				m_numManifoldCacheLookups = numConvexPairs;
+
+				b3OpenCLArray<b3ContactManifoldCacheData>* cachedManifolds = m_cachedManifolds[m_currentManifoldCache];
+				b3OpenCLArray<b3SortData>* cachedKeys = m_cachedManifoldKeys[m_currentManifoldCache];
+				int numCachedManifolds = cachedManifolds->size();
+				if (numCachedManifolds)
+				{
+					b3BufferInfoCL bInfo[] = { 
+						b3BufferInfoCL( pairs->getBufferCL()), 
+						b3BufferInfoCL( bodyBuf->getBufferCL(),true), 
+						b3BufferInfoCL( cachedManifolds->getBufferCL(),true),
+						b3BufferInfoCL( cachedKeys->getBufferCL(),true)
+					};
+					b3LauncherCL launcher(m_queue, m_findCachedManifoldsKernel);
+					launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+					launcher.setConst( numCachedManifolds );
+					launcher.setBuffer( m_manifoldCacheSource.getBufferCL());
+					launcher.setBuffer( m_hasSeparatingNormals.getBufferCL());
+					launcher.setBuffer( contactOut->getBufferCL());
+					launcher.setBuffer( m_totalContactsOut.getBufferCL());
+					launcher.setConst( maxContactCapacity );
+					launcher.setConst( m_manifoldCacheLinearThreshold );
+					float cosHalfAngularThreshold = b3Cos(0.5f*m_manifoldCacheAngularThreshold);
+					float contactBreakingThreshold = 0.02f;//maxDist of clipHullHullKernel
+					launcher.setConst( cosHalfAngularThreshold );
+					launcher.setConst( contactBreakingThreshold );
+					launcher.setConst( binStart[B3_PAIR_BIN_CONVEX_CONVEX+1]  );
+					launcher.setConst( binStart[B3_PAIR_BIN_CONVEX_CONVEX] );
+					launcher.launch1D( numConvexPairs);
+					clFinish(m_queue);
+
+					nContacts = m_totalContactsOut.at(0);
+					if (nContacts > maxContactCapacity)
+					{
+						b3Error("Error: contacts exceeds capacity (%d/%d)\n", nContacts, maxContactCapacity);
+						nContacts = maxContactCapacity;
+						m_totalContactsOut.copyFromHostPointer(&nContacts,1,0,true);
+					}
+				}
+				reusedContactsEnd = nContacts;
+				m_numManifoldCacheHits = reusedContactsEnd-reusedContactsStart;
+			}
+
+			if (numConvexPairs)
 			{
 				B3_PROFILE("findSeparatingAxisKernel");
 				b3BufferInfoCL bInfo[] = { 
@@ -3011,6 +4092,8 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 					b3BufferInfoCL( gpuUniqueEdges.getBufferCL(),true),
 					b3BufferInfoCL( gpuFaces.getBufferCL(),true),
 					b3BufferInfoCL( gpuIndices.getBufferCL(),true),
+					b3BufferInfoCL( gpuVertexAdjacency.getBufferCL(),true),
+					b3BufferInfoCL( gpuHullEdges.getBufferCL(),true),
 					b3BufferInfoCL( clAabbsWorldSpace.getBufferCL(),true),
 					b3BufferInfoCL( m_sepNormals.getBufferCL()),
 					b3BufferInfoCL( m_hasSeparatingNormals.getBufferCL())
@@ -3018,9 +4101,10 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 
 				b3LauncherCL launcher(m_queue, m_findSeparatingAxisKernel);
 				launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
-				launcher.setConst( nPairs  );
+				launcher.setConst( binStart[B3_PAIR_BIN_CONVEX_CONVEX+1]  );
+				launcher.setConst( binStart[B3_PAIR_BIN_CONVEX_CONVEX] );
 
-				int num = nPairs;
+				int num = numConvexPairs;
 				launcher.launch1D( num);
 				clFinish(m_queue);
 			}
@@ -3032,7 +4116,8 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 				
 				{
 				
-					if (treeNodesGPU->size() && treeNodesGPU->size())
+					int numConcaveBinPairs = binStart[B3_PAIR_BIN_CONCAVE+1]-binStart[B3_PAIR_BIN_CONCAVE_COMPOUND];
+					if (treeNodesGPU->size() && numConcaveBinPairs)
 					{
 						B3_PROFILE("m_bvhTraversalKernel");
 						
@@ -3050,9 +4135,10 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 						launcher.setBuffer( treeNodesGPU->getBufferCL());
 						launcher.setBuffer( bvhInfo->getBufferCL());
 						
-						launcher.setConst( nPairs  );
+						launcher.setConst( binStart[B3_PAIR_BIN_CONCAVE+1]  );
 						launcher.setConst( maxTriConvexPairCapacity);
-						int num = nPairs;
+						launcher.setConst( binStart[B3_PAIR_BIN_CONCAVE_COMPOUND] );
+						int num = numConcaveBinPairs;
 						launcher.launch1D( num);
 						clFinish(m_queue);
 						numConcavePairs = m_numConcavePairsOut.at(0);
@@ -3078,6 +4164,7 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 								b3BufferInfoCL( gpuUniqueEdges.getBufferCL(),true),
 								b3BufferInfoCL( gpuFaces.getBufferCL(),true),
 								b3BufferInfoCL( gpuIndices.getBufferCL(),true),
+								b3BufferInfoCL( gpuVertexAdjacency.getBufferCL(),true),
 								b3BufferInfoCL( gpuChildShapes.getBufferCL(),true),
 								b3BufferInfoCL( clAabbsWorldSpace.getBufferCL(),true),
 								b3BufferInfoCL( m_concaveSepNormals.getBufferCL())
@@ -3105,36 +4192,41 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 			
 			numCompoundPairs = m_numCompoundPairsOut.at(0);
 			bool useGpuFindCompoundPairs=true;
+			int numCompoundBinPairs = binStart[B3_PAIR_BIN_CONCAVE_COMPOUND+1]-binStart[B3_PAIR_BIN_COMPOUND];
 			if (useGpuFindCompoundPairs)
 			{
-				B3_PROFILE("findCompoundPairsKernel");
-				b3BufferInfoCL bInfo[] = 
-				{ 
-					b3BufferInfoCL( pairs->getBufferCL(), true ), 
-					b3BufferInfoCL( bodyBuf->getBufferCL(),true), 
-					b3BufferInfoCL( gpuCollidables.getBufferCL(),true), 
-					b3BufferInfoCL( convexData.getBufferCL(),true),
-					b3BufferInfoCL( gpuVertices.getBufferCL(),true),
-					b3BufferInfoCL( gpuUniqueEdges.getBufferCL(),true),
-					b3BufferInfoCL( gpuFaces.getBufferCL(),true),
-					b3BufferInfoCL( gpuIndices.getBufferCL(),true),
-					b3BufferInfoCL( clAabbsLocalSpace.getBufferCL(),true),
-					b3BufferInfoCL( gpuChildShapes.getBufferCL(),true),
-					b3BufferInfoCL( m_gpuCompoundPairs.getBufferCL()),
-					b3BufferInfoCL( m_numCompoundPairsOut.getBufferCL()),
-					b3BufferInfoCL(subTreesGPU->getBufferCL()),
-					b3BufferInfoCL(treeNodesGPU->getBufferCL()),
-					b3BufferInfoCL(bvhInfo->getBufferCL())
-				};
-
-				b3LauncherCL launcher(m_queue, m_findCompoundPairsKernel);
-				launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
-				launcher.setConst( nPairs  );
-				launcher.setConst( compoundPairCapacity);
-
-				int num = nPairs;
-				launcher.launch1D( num);
-				clFinish(m_queue);
+				if (numCompoundBinPairs)
+				{
+					B3_PROFILE("findCompoundPairsKernel");
+					b3BufferInfoCL bInfo[] = 
+					{ 
+						b3BufferInfoCL( pairs->getBufferCL(), true ), 
+						b3BufferInfoCL( bodyBuf->getBufferCL(),true), 
+						b3BufferInfoCL( gpuCollidables.getBufferCL(),true), 
+						b3BufferInfoCL( convexData.getBufferCL(),true),
+						b3BufferInfoCL( gpuVertices.getBufferCL(),true),
+						b3BufferInfoCL( gpuUniqueEdges.getBufferCL(),true),
+						b3BufferInfoCL( gpuFaces.getBufferCL(),true),
+						b3BufferInfoCL( gpuIndices.getBufferCL(),true),
+						b3BufferInfoCL( clAabbsLocalSpace.getBufferCL(),true),
+						b3BufferInfoCL( gpuChildShapes.getBufferCL(),true),
+						b3BufferInfoCL( m_gpuCompoundPairs.getBufferCL()),
+						b3BufferInfoCL( m_numCompoundPairsOut.getBufferCL()),
+						b3BufferInfoCL(subTreesGPU->getBufferCL()),
+						b3BufferInfoCL(treeNodesGPU->getBufferCL()),
+						b3BufferInfoCL(bvhInfo->getBufferCL())
+					};
+
+					b3LauncherCL launcher(m_queue, m_findCompoundPairsKernel);
+					launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+					launcher.setConst( binStart[B3_PAIR_BIN_CONCAVE_COMPOUND+1]  );
+					launcher.setConst( compoundPairCapacity);
+					launcher.setConst( binStart[B3_PAIR_BIN_COMPOUND] );
+
+					int num = numCompoundBinPairs;
+					launcher.launch1D( num);
+					clFinish(m_queue);
+				}
 
 				numCompoundPairs = m_numCompoundPairsOut.at(0);
 				//printf("numCompoundPairs =%d\n",numCompoundPairs );
@@ -3291,6 +4383,8 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 					b3BufferInfoCL( gpuUniqueEdges.getBufferCL(),true),
 					b3BufferInfoCL( gpuFaces.getBufferCL(),true),
 					b3BufferInfoCL( gpuIndices.getBufferCL(),true),
+					b3BufferInfoCL( gpuVertexAdjacency.getBufferCL(),true),
+					b3BufferInfoCL( gpuHullEdges.getBufferCL(),true),
 					b3BufferInfoCL( clAabbsWorldSpace.getBufferCL(),true),
 					b3BufferInfoCL( gpuChildShapes.getBufferCL(),true),
 					b3BufferInfoCL( m_gpuCompoundSepNormals.getBufferCL()),
@@ -3431,6 +4525,7 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 
 
 			
+            clippedContactsStart = nContacts;
             int vertexFaceCapacity = 64;
             
             
@@ -3556,7 +4651,13 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
                         launcher.launch1D( num);
                     }
                     nContacts = m_totalContactsOut.at(0);
+                    if (nContacts > maxContactCapacity)
+                    {
+                        b3Error("Exceeded contact capacity (%d/%d)\n",nContacts,maxContactCapacity);
+                        nContacts = maxContactCapacity;
+                    }
                     contactOut->resize(nContacts);
+                    clippedContactsEnd = nContacts;
                     
 //                    b3Contact4 pt = contactOut->at(0);
                     
@@ -3569,6 +4670,7 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 	 
 		if (nPairs)
 		{
+			clippedContactsStart = nContacts;
 			b3BufferInfoCL bInfo[] = {
 				b3BufferInfoCL( pairs->getBufferCL(), true ), 
 				b3BufferInfoCL( bodyBuf->getBufferCL(),true), 
@@ -3599,6 +4701,7 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 				nContacts = maxContactCapacity;
 			}
 			contactOut->resize(nContacts);
+			clippedContactsEnd = nContacts;
 		}
 
 		int nCompoundsPairs = m_gpuCompoundPairs.size();
@@ -3642,4 +4745,111 @@ void GpuSatCollision::computeConvexConvexContactsGPUSAT( b3OpenCLArray<b3Int4>*
 		}
 
 	}
+
+	if (useManifoldCache)
+	{
+		B3_PROFILE("storeCachedManifoldsKernel");
+		int numReused = reusedContactsEnd-reusedContactsStart;
+		int numClipped = clippedContactsEnd-clippedContactsStart;
+		int numManifolds = numReused+numClipped;
+		b3OpenCLArray<b3ContactManifoldCacheData>* cachedManifolds = m_cachedManifolds[m_currentManifoldCache];
+		b3OpenCLArray<b3ContactManifoldCacheData>* newManifolds = m_cachedManifolds[1-m_currentManifoldCache];
+		b3OpenCLArray<b3SortData>* newKeys = m_cachedManifoldKeys[1-m_currentManifoldCache];
+		newManifolds->resize(numManifolds);
+		newKeys->resize(numManifolds);
+
+		for (int reused=1;reused>=0;reused--)
+		{
+			int firstContact = reused? reusedContactsStart : clippedContactsStart;
+			int numContacts = reused? numReused : numClipped;
+			if (!numContacts)
+				continue;
+			b3BufferInfoCL bInfo[] = {
+				b3BufferInfoCL( contactOut->getBufferCL(), true ),
+				b3BufferInfoCL( bodyBuf->getBufferCL(), true ),
+				b3BufferInfoCL( cachedManifolds->getBufferCL(), true ),
+				b3BufferInfoCL( m_manifoldCacheSource.getBufferCL(), true ),
+				b3BufferInfoCL( newManifolds->getBufferCL()),
+				b3BufferInfoCL( newKeys->getBufferCL())
+			};
+			b3LauncherCL launcher(m_queue, m_storeCachedManifoldsKernel);
+			launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+			launcher.setConst( firstContact );
+			launcher.setConst( numContacts );
+			launcher.setConst( reused? 0 : numReused );
+			launcher.setConst( reused );
+			launcher.launch1D( numContacts);
+		}
+		if (numManifolds)
+			m_sort32->execute(*newKeys,32);
+		clFinish(m_queue);
+		m_currentManifoldCache = 1-m_currentManifoldCache;
+	}
+
+	{
+		//the kernels cache contact indices in the z and w components of the sorted pairs
+		B3_PROFILE("scatterPairsKernel");
+		b3BufferInfoCL bInfo[] = {
+			b3BufferInfoCL( m_sortedPairs.getBufferCL(), true ),
+			b3BufferInfoCL( m_pairTypeSortData.getBufferCL(), true ),
+			b3BufferInfoCL( unsortedPairs->getBufferCL())
+		};
+		b3LauncherCL launcher(m_queue, m_scatterPairsKernel);
+		launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+		launcher.setConst( nPairs );
+		launcher.launch1D( nPairs);
+		clFinish(m_queue);
+	}
+}
+
+void GpuSatCollision::sortPairsByType(const b3OpenCLArray<b3Int4>* pairs, int nPairs,
+			const b3OpenCLArray<b3RigidBodyCL>* bodyBuf,
+			const b3OpenCLArray<b3Collidable>& gpuCollidables,
+			int* binStart)
+{
+	B3_PROFILE("sortPairsByType");
+	b3Assert(nPairs>0);
+
+	m_pairTypeSortData.resize(nPairs);
+	m_sortedPairs.resize(nPairs);
+
+	{
+		b3BufferInfoCL bInfo[] = {
+			b3BufferInfoCL( pairs->getBufferCL(), true ),
+			b3BufferInfoCL( bodyBuf->getBufferCL(),true),
+			b3BufferInfoCL( gpuCollidables.getBufferCL(),true),
+			b3BufferInfoCL( m_pairTypeSortData.getBufferCL())
+		};
+		b3LauncherCL launcher(m_queue, m_computePairTypeBinsKernel);
+		launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+		launcher.setConst( nPairs );
+		launcher.launch1D( nPairs);
+	}
+
+	//all bin indices fit in 4 bits, so this is a single counting sort pass
+	m_sort32->execute(m_pairTypeSortData,4);
+	m_search->execute(m_pairTypeSortData,nPairs,m_pairTypeBinCountsGPU,B3_NUM_PAIR_BINS,b3BoundSearchCL::COUNT);
+
+	{
+		b3BufferInfoCL bInfo[] = {
+			b3BufferInfoCL( pairs->getBufferCL(), true ),
+			b3BufferInfoCL( m_pairTypeSortData.getBufferCL(), true ),
+			b3BufferInfoCL( m_sortedPairs.getBufferCL())
+		};
+		b3LauncherCL launcher(m_queue, m_gatherPairsKernel);
+		launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+		launcher.setConst( nPairs );
+		launcher.launch1D( nPairs);
+	}
+
+	b3AlignedObjectArray<unsigned int> binCounts;
+	m_pairTypeBinCountsGPU.copyToHost(binCounts);
+
+	binStart[0] = 0;
+	for (int i=0;i<B3_NUM_PAIR_BINS;i++)
+	{
+		m_pairTypeBinCounts[i] = binCounts[i];
+		binStart[i+1] = binStart[i]+binCounts[i];
+	}
+	b3Assert(binStart[B3_NUM_PAIR_BINS]==nPairs);
 }
@@ -3,12 +3,14 @@
 #define _CONVEX_HULL_CONTACT_H
 
 #include "Bullet3OpenCL/ParallelPrimitives/b3OpenCLArray.h"
+#include "Bullet3OpenCL/ParallelPrimitives/b3RadixSort32CL.h"
 #include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
 #include "Bullet3Common/b3AlignedObjectArray.h"
 #include "b3ConvexUtility.h"
 #include "b3ConvexPolyhedronCL.h"
 #include "Bullet3Collision/NarrowPhaseCollision/shared/b3Collidable.h"
 #include "Bullet3Collision/NarrowPhaseCollision/b3Contact4.h"
+#include "Bullet3Collision/NarrowPhaseCollision/shared/b3ContactManifoldCacheData.h"
 #include "Bullet3Common/shared/b3Int2.h"
 #include "Bullet3Common/shared/b3Int4.h"
 #include "b3OptimizedBvh.h"
@@ -18,7 +20,23 @@
 //#include "../../dynamics/basic_demo/Stubs/ChNarrowPhase.h"
 
 
-
+///broadphase pairs are binned by shape type pair, so each narrowphase kernel only sees the pairs it handles
+///the bin order matters: the compound and concave ranges overlap in B3_PAIR_BIN_CONCAVE_COMPOUND
+///keep in sync with the PAIR_BIN_* defines in kernels/primitiveContacts.cl
+enum b3PairTypeBin
+{
+	B3_PAIR_BIN_SPHERE_SPHERE=0,
+	B3_PAIR_BIN_SPHERE_PLANE,
+	B3_PAIR_BIN_CONVEX_PLANE,
+	B3_PAIR_BIN_PRIMITIVE,//other sphere/box/capsule/convex/plane combinations
+	B3_PAIR_BIN_CONVEX_CONVEX,
+	B3_PAIR_BIN_COMPOUND,
+	B3_PAIR_BIN_CONCAVE_COMPOUND,
+	B3_PAIR_BIN_CONCAVE,
+	B3_PAIR_BIN_UNSUPPORTED,
+	B3_PAIR_BIN_UNSUPPORTED_BOX_CAPSULE,//box or capsule against a convex hull, compound or trimesh, gives a warning
+	B3_NUM_PAIR_BINS
+};
 
 struct GpuSatCollision
 {
@@ -45,6 +63,18 @@ struct GpuSatCollision
 	cl_kernel				m_findConcaveSphereContactsKernel;
 
 	cl_kernel				m_processCompoundPairsPrimitivesKernel;
+
+	cl_kernel				m_computePairTypeBinsKernel;
+	cl_kernel				m_gatherPairsKernel;
+	cl_kernel				m_scatterPairsKernel;
+	cl_kernel				m_gatherSpherePairsKernel;
+	cl_kernel				m_sphereSphereContactsKernel;
+	cl_kernel				m_spherePlaneContactsKernel;
+	cl_kernel				m_findCachedManifoldsKernel;
+	cl_kernel				m_storeCachedManifoldsKernel;
+	class b3RadixSort32CL*	m_sort32;
+	class b3BoundSearchCL*	m_search;
+	class b3FillCL*			m_fill;
     
 
 	b3OpenCLArray<int>		m_totalContactsOut;
@@ -57,6 +87,32 @@ struct GpuSatCollision
 	b3OpenCLArray<b3Vector3> m_gpuCompoundSepNormals;
 	b3OpenCLArray<int>		m_gpuHasCompoundSepNormals;
 	b3OpenCLArray<int>		m_numCompoundPairsOut;
+
+	b3OpenCLArray<b3SortData>	m_pairTypeSortData;
+	b3OpenCLArray<b3Int4>	m_sortedPairs;
+	b3OpenCLArray<unsigned int>	m_pairTypeBinCountsGPU;
+	int						m_pairTypeBinCounts[B3_NUM_PAIR_BINS];
+
+	//structure-of-arrays copy of the sphere-sphere and sphere-plane bins
+	b3OpenCLArray<b3Vector3>	m_spherePairsA;
+	b3OpenCLArray<b3Vector3>	m_spherePairsB;
+	b3OpenCLArray<b3Int2>	m_spherePairBodies;
+
+	//convex-convex manifolds of the previous frame, sorted on body pair in m_cachedManifoldKeys
+	//the caches are double buffered, m_currentManifoldCache holds the manifolds of the previous frame
+	b3OpenCLArray<b3ContactManifoldCacheData>*	m_cachedManifolds[2];
+	b3OpenCLArray<b3SortData>*	m_cachedManifoldKeys[2];
+	int						m_currentManifoldCache;
+	b3OpenCLArray<int>		m_manifoldCacheSource;//per pair, index of the reused manifold or -1
+
+	//a convex-convex manifold is reused while the relative transform of the pair changed less than these thresholds
+	//since it was clipped, zero disables the cache
+	float					m_manifoldCacheLinearThreshold;
+	float					m_manifoldCacheAngularThreshold;
+
+	//statistics of the last computeConvexConvexContactsGPUSAT call
+	int						m_numManifoldCacheLookups;
+	int						m_numManifoldCacheHits;
 	
 
 	GpuSatCollision(cl_context ctx,cl_device_id device, cl_command_queue  q );
@@ -74,6 +130,8 @@ struct GpuSatCollision
 			const b3OpenCLArray<b3Vector3>& uniqueEdges,
 			const b3OpenCLArray<b3GpuFace>& faces,
 			const b3OpenCLArray<int>& indices,
+			const b3OpenCLArray<int>& vertexAdjacency,
+			const b3OpenCLArray<b3Int4>& hullEdges,
 			const b3OpenCLArray<b3Collidable>& gpuCollidables,
 			const b3OpenCLArray<b3GpuChildShape>& gpuChildShapes,
 
@@ -95,6 +153,12 @@ struct GpuSatCollision
 			int& numTriConvexPairsOut
 			);
 
+	///bins the pairs by shape type pair into m_sortedPairs, binStart receives B3_NUM_PAIR_BINS+1 offsets
+	void sortPairsByType(const b3OpenCLArray<b3Int4>* pairs, int nPairs,
+			const b3OpenCLArray<b3RigidBodyCL>* bodyBuf,
+			const b3OpenCLArray<b3Collidable>& gpuCollidables,
+			int* binStart);
+
 
 };
 
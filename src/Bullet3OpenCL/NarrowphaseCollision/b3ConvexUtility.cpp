@@ -518,3 +518,94 @@ void	b3ConvexUtility::initialize()
 	}
 #endif
 }
+
+
+bool	b3ConvexUtility::computeVertexAdjacency(b3AlignedObjectArray<int>& adjacency, b3AlignedObjectArray<b3Int4>& edges) const
+{
+	adjacency.resize(0);
+	edges.resize(0);
+
+	int numVertices = m_vertices.size();
+	//b3InternalVertexPair stores short indices
+	if (numVertices==0 || numVertices>32767)
+		return false;
+
+	b3HashMap<b3InternalVertexPair,int> edgeMap;
+	for(int i=0;i<m_faces.size();i++)
+	{
+		int numIndices = m_faces[i].m_indices.size();
+		for(int j=0;j<numIndices;j++)
+		{
+			int v0 = m_faces[i].m_indices[j];
+			int v1 = m_faces[i].m_indices[(j+1)%numIndices];
+			if (v0==v1)
+				continue;
+			b3InternalVertexPair vp(v0,v1);
+			int* edgeIndex = edgeMap.find(vp);
+			if (edgeIndex)
+			{
+				//an edge shared by more than two faces
+				if (edges[*edgeIndex].w>=0)
+					return false;
+				edges[*edgeIndex].w = i;
+			} else
+			{
+				edgeMap.insert(vp,edges.size());
+				edges.push_back(b3MakeInt4(vp.m_v0,vp.m_v1,i,-1));
+			}
+		}
+	}
+
+	for (int e=0;e<edges.size();e++)
+	{
+		//open hull, the Gauss map needs two faces per edge
+		if (edges[e].w<0)
+		{
+			edges.resize(0);
+			return false;
+		}
+	}
+
+	//all vertices sharing a face are neighbours, so merged faces that are not exactly planar
+	//don't leave local maxima for hill climbing
+	b3AlignedObjectArray<b3AlignedObjectArray<int> > neighbours;
+	neighbours.resize(numVertices);
+	int numNeighbours = 0;
+	for(int i=0;i<m_faces.size();i++)
+	{
+		int numIndices = m_faces[i].m_indices.size();
+		for(int j=0;j<numIndices;j++)
+		{
+			int v0 = m_faces[i].m_indices[j];
+			for(int k=0;k<numIndices;k++)
+			{
+				int v1 = m_faces[i].m_indices[k];
+				if (v0!=v1 && neighbours[v0].findLinearSearch(v1)==neighbours[v0].size())
+				{
+					neighbours[v0].push_back(v1);
+					numNeighbours++;
+				}
+			}
+		}
+	}
+
+	adjacency.resize(numVertices+1+numNeighbours);
+	int start = numVertices+1;
+	for (int v=0;v<numVertices;v++)
+	{
+		//vertices that are not on any face can't be reached by hill climbing
+		if (neighbours[v].size()==0)
+		{
+			edges.resize(0);
+			adjacency.resize(0);
+			return false;
+		}
+		adjacency[v] = start;
+		for (int n=0;n<neighbours[v].size();n++)
+		{
+			adjacency[start++] = neighbours[v][n];
+		}
+	}
+	adjacency[numVertices] = start;
+	return true;
+}
@@ -21,6 +21,7 @@ subject to the following restrictions:
 #include "Bullet3Common/b3Transform.h"
 
 #include "b3ConvexPolyhedronCL.h"
+#include "Bullet3Common/shared/b3Int4.h"
 
 
 struct b3MyFace
@@ -55,6 +56,10 @@ B3_ATTRIBUTE_ALIGNED16(class) b3ConvexUtility
 	void	initialize();
 	bool testContainment() const;
 
+	///vertex adjacency in compressed rows (numVertices+1 row starts followed by the neighbour lists)
+	///and the face edges as (v0,v1,face0,face1). Returns false if the hull is not a closed 2-manifold.
+	bool	computeVertexAdjacency(b3AlignedObjectArray<int>& adjacency, b3AlignedObjectArray<b3Int4>& edges) const;
+
 
 
 };
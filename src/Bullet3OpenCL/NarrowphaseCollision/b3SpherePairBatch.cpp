@@ -0,0 +1,280 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b3SpherePairBatch.h"
+#include "Bullet3Common/b3Quaternion.h"
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+static inline int b3SignedBodyIndex(const b3RigidBodyCL* bodies, int bodyIndex)
+{
+	return bodies[bodyIndex].m_invMass==0? -bodyIndex : bodyIndex;
+}
+
+static inline void b3WriteSphereContact(b3Contact4* contactsOut, int& numContacts, int maxContactCapacity,
+										int pairIndex, int bodyA, int bodyB,
+										float nx, float ny, float nz,
+										float px, float py, float pz, float dist)
+{
+	int dstIdx = numContacts++;
+	if (dstIdx < maxContactCapacity)
+	{
+		b3Contact4* c = &contactsOut[dstIdx];
+		c->m_worldNormalOnB.setValue(nx,ny,nz);
+		c->m_restituitionCoeffCmp = (unsigned short)(0.f*0xffff);
+		c->m_frictionCoeffCmp = (unsigned short)(0.7f*0xffff);
+		c->m_batchIdx = pairIndex;
+		c->m_bodyAPtrAndSignBit = bodyA;
+		c->m_bodyBPtrAndSignBit = bodyB;
+		c->m_worldPosB[0].setValue(px,py,pz);
+		c->m_worldPosB[0].w = dist;
+		c->m_childIndexA = -1;
+		c->m_childIndexB = -1;
+		b3Contact4Data_setNumPoints(c,1);
+	}
+}
+
+void b3SpherePairBatch::resize(int numPairs)
+{
+	m_ax.resize(numPairs);
+	m_ay.resize(numPairs);
+	m_az.resize(numPairs);
+	m_aw.resize(numPairs);
+	m_bx.resize(numPairs);
+	m_by.resize(numPairs);
+	m_bz.resize(numPairs);
+	m_br.resize(numPairs);
+	m_bodyA.resize(numPairs);
+	m_bodyB.resize(numPairs);
+	m_pairIndex.resize(numPairs);
+}
+
+void b3SpherePairBatch::gatherSphereSpherePairs(const b3Int4* pairs, const int* pairIndices, int numPairs,
+												const b3RigidBodyCL* bodies, const b3Collidable* collidables)
+{
+	resize(numPairs);
+	for (int i=0;i<numPairs;i++)
+	{
+		int pairIndex = pairIndices[i];
+		int bodyIndexA = pairs[pairIndex].x;
+		int bodyIndexB = pairs[pairIndex].y;
+		const b3RigidBodyCL& bodyA = bodies[bodyIndexA];
+		const b3RigidBodyCL& bodyB = bodies[bodyIndexB];
+
+		m_ax[i] = bodyA.m_pos.x;
+		m_ay[i] = bodyA.m_pos.y;
+		m_az[i] = bodyA.m_pos.z;
+		m_aw[i] = collidables[bodyA.m_collidableIdx].m_radius;
+		m_bx[i] = bodyB.m_pos.x;
+		m_by[i] = bodyB.m_pos.y;
+		m_bz[i] = bodyB.m_pos.z;
+		m_br[i] = collidables[bodyB.m_collidableIdx].m_radius;
+		m_bodyA[i] = b3SignedBodyIndex(bodies,bodyIndexA);
+		m_bodyB[i] = b3SignedBodyIndex(bodies,bodyIndexB);
+		m_pairIndex[i] = pairIndex;
+	}
+}
+
+void b3SpherePairBatch::gatherSpherePlanePairs(const b3Int4* pairs, const int* pairIndices, int numPairs,
+											   const b3RigidBodyCL* bodies, const b3Collidable* collidables, const b3GpuFace* faces)
+{
+	resize(numPairs);
+	for (int i=0;i<numPairs;i++)
+	{
+		int pairIndex = pairIndices[i];
+		int bodyIndexPlane = pairs[pairIndex].x;
+		int bodyIndexSphere = pairs[pairIndex].y;
+		if (collidables[bodies[bodyIndexPlane].m_collidableIdx].m_shapeType!=SHAPE_PLANE)
+			b3Swap(bodyIndexPlane,bodyIndexSphere);
+
+		const b3RigidBodyCL& plane = bodies[bodyIndexPlane];
+		const b3RigidBodyCL& sphere = bodies[bodyIndexSphere];
+		const b3Vector3& planeEq = faces[collidables[plane.m_collidableIdx].m_shapeIndex].m_plane;
+
+		//move the plane to world space, so the contact test is a single dot product
+		b3Vector3 localNormal = b3MakeVector3(planeEq.x,planeEq.y,planeEq.z);
+		b3Vector3 normal = b3QuatRotate(plane.m_quat,localNormal);
+		m_ax[i] = normal.x;
+		m_ay[i] = normal.y;
+		m_az[i] = normal.z;
+		m_aw[i] = planeEq.w + normal.dot(plane.m_pos);
+		m_bx[i] = sphere.m_pos.x;
+		m_by[i] = sphere.m_pos.y;
+		m_bz[i] = sphere.m_pos.z;
+		m_br[i] = collidables[sphere.m_collidableIdx].m_radius;
+		m_bodyA[i] = b3SignedBodyIndex(bodies,bodyIndexPlane);
+		m_bodyB[i] = b3SignedBodyIndex(bodies,bodyIndexSphere);
+		m_pairIndex[i] = pairIndex;
+	}
+}
+
+int b3SpherePairBatch::computeSphereSphereContacts(b3Contact4* contactsOut, int numContacts, int maxContactCapacity) const
+{
+	int numPairs = size();
+	int i=0;
+
+#if defined (__AVX__)
+	B3_ATTRIBUTE_ALIGNED16(float) len[8];
+	for (;i+8<=numPairs;i+=8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&m_ax[i]),_mm256_loadu_ps(&m_bx[i]));
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&m_ay[i]),_mm256_loadu_ps(&m_by[i]));
+		__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&m_az[i]),_mm256_loadu_ps(&m_bz[i]));
+		__m256 radiusSum = _mm256_add_ps(_mm256_loadu_ps(&m_aw[i]),_mm256_loadu_ps(&m_br[i]));
+		__m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx,dx),_mm256_mul_ps(dy,dy)),_mm256_mul_ps(dz,dz));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(len2,_mm256_mul_ps(radiusSum,radiusSum),_CMP_LE_OQ));
+		if (!mask)
+			continue;
+		_mm256_storeu_ps(len,_mm256_sqrt_ps(len2));
+		for (int j=0;j<8;j++)
+		{
+			if (mask&(1<<j))
+			{
+				int k = i+j;
+				float nx=1.f,ny=0.f,nz=0.f;
+				if (len[j] > 0.00001f)
+				{
+					float invLen = 1.f/len[j];
+					nx = (m_ax[k]-m_bx[k])*invLen;
+					ny = (m_ay[k]-m_by[k])*invLen;
+					nz = (m_az[k]-m_bz[k])*invLen;
+				}
+				b3WriteSphereContact(contactsOut,numContacts,maxContactCapacity,m_pairIndex[k],m_bodyA[k],m_bodyB[k],nx,ny,nz,
+					m_bx[k]+nx*m_br[k],m_by[k]+ny*m_br[k],m_bz[k]+nz*m_br[k],len[j]-(m_aw[k]+m_br[k]));
+			}
+		}
+	}
+#elif defined (B3_USE_SSE)
+	B3_ATTRIBUTE_ALIGNED16(float) len[4];
+	for (;i+4<=numPairs;i+=4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&m_ax[i]),_mm_loadu_ps(&m_bx[i]));
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&m_ay[i]),_mm_loadu_ps(&m_by[i]));
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(&m_az[i]),_mm_loadu_ps(&m_bz[i]));
+		__m128 radiusSum = _mm_add_ps(_mm_loadu_ps(&m_aw[i]),_mm_loadu_ps(&m_br[i]));
+		__m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,dx),_mm_mul_ps(dy,dy)),_mm_mul_ps(dz,dz));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(len2,_mm_mul_ps(radiusSum,radiusSum)));
+		if (!mask)
+			continue;
+		_mm_store_ps(len,_mm_sqrt_ps(len2));
+		for (int j=0;j<4;j++)
+		{
+			if (mask&(1<<j))
+			{
+				int k = i+j;
+				float nx=1.f,ny=0.f,nz=0.f;
+				if (len[j] > 0.00001f)
+				{
+					float invLen = 1.f/len[j];
+					nx = (m_ax[k]-m_bx[k])*invLen;
+					ny = (m_ay[k]-m_by[k])*invLen;
+					nz = (m_az[k]-m_bz[k])*invLen;
+				}
+				b3WriteSphereContact(contactsOut,numContacts,maxContactCapacity,m_pairIndex[k],m_bodyA[k],m_bodyB[k],nx,ny,nz,
+					m_bx[k]+nx*m_br[k],m_by[k]+ny*m_br[k],m_bz[k]+nz*m_br[k],len[j]-(m_aw[k]+m_br[k]));
+			}
+		}
+	}
+#endif
+
+	//remainder, or everything without SIMD
+	for (;i<numPairs;i++)
+	{
+		float dx = m_ax[i]-m_bx[i];
+		float dy = m_ay[i]-m_by[i];
+		float dz = m_az[i]-m_bz[i];
+		float radiusSum = m_aw[i]+m_br[i];
+		float len2 = dx*dx+dy*dy+dz*dz;
+		if (len2 > radiusSum*radiusSum)
+			continue;
+		float len = b3Sqrt(len2);
+		float nx=1.f,ny=0.f,nz=0.f;
+		if (len > 0.00001f)
+		{
+			nx = dx/len;
+			ny = dy/len;
+			nz = dz/len;
+		}
+		b3WriteSphereContact(contactsOut,numContacts,maxContactCapacity,m_pairIndex[i],m_bodyA[i],m_bodyB[i],nx,ny,nz,
+			m_bx[i]+nx*m_br[i],m_by[i]+ny*m_br[i],m_bz[i]+nz*m_br[i],len-radiusSum);
+	}
+	return numContacts;
+}
+
+int b3SpherePairBatch::computeSpherePlaneContacts(b3Contact4* contactsOut, int numContacts, int maxContactCapacity) const
+{
+	int numPairs = size();
+	int i=0;
+
+#if defined (__AVX__)
+	B3_ATTRIBUTE_ALIGNED16(float) dist[8];
+	for (;i+8<=numPairs;i+=8)
+	{
+		__m256 d = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_loadu_ps(&m_ax[i]),_mm256_loadu_ps(&m_bx[i])),
+			_mm256_mul_ps(_mm256_loadu_ps(&m_ay[i]),_mm256_loadu_ps(&m_by[i]))),
+			_mm256_mul_ps(_mm256_loadu_ps(&m_az[i]),_mm256_loadu_ps(&m_bz[i])));
+		d = _mm256_sub_ps(d,_mm256_add_ps(_mm256_loadu_ps(&m_aw[i]),_mm256_loadu_ps(&m_br[i])));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(d,_mm256_setzero_ps(),_CMP_LT_OQ));
+		if (!mask)
+			continue;
+		_mm256_storeu_ps(dist,d);
+		for (int j=0;j<8;j++)
+		{
+			if (mask&(1<<j))
+			{
+				int k = i+j;
+				b3WriteSphereContact(contactsOut,numContacts,maxContactCapacity,m_pairIndex[k],m_bodyA[k],m_bodyB[k],-m_ax[k],-m_ay[k],-m_az[k],
+					m_bx[k]-m_ax[k]*m_br[k],m_by[k]-m_ay[k]*m_br[k],m_bz[k]-m_az[k]*m_br[k],dist[j]);
+			}
+		}
+	}
+#elif defined (B3_USE_SSE)
+	B3_ATTRIBUTE_ALIGNED16(float) dist[4];
+	for (;i+4<=numPairs;i+=4)
+	{
+		__m128 d = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_loadu_ps(&m_ax[i]),_mm_loadu_ps(&m_bx[i])),
+			_mm_mul_ps(_mm_loadu_ps(&m_ay[i]),_mm_loadu_ps(&m_by[i]))),
+			_mm_mul_ps(_mm_loadu_ps(&m_az[i]),_mm_loadu_ps(&m_bz[i])));
+		d = _mm_sub_ps(d,_mm_add_ps(_mm_loadu_ps(&m_aw[i]),_mm_loadu_ps(&m_br[i])));
+		int mask = _mm_movemask_ps(_mm_cmplt_ps(d,_mm_setzero_ps()));
+		if (!mask)
+			continue;
+		_mm_store_ps(dist,d);
+		for (int j=0;j<4;j++)
+		{
+			if (mask&(1<<j))
+			{
+				int k = i+j;
+				b3WriteSphereContact(contactsOut,numContacts,maxContactCapacity,m_pairIndex[k],m_bodyA[k],m_bodyB[k],-m_ax[k],-m_ay[k],-m_az[k],
+					m_bx[k]-m_ax[k]*m_br[k],m_by[k]-m_ay[k]*m_br[k],m_bz[k]-m_az[k]*m_br[k],dist[j]);
+			}
+		}
+	}
+#endif
+
+	for (;i<numPairs;i++)
+	{
+		float d = m_ax[i]*m_bx[i]+m_ay[i]*m_by[i]+m_az[i]*m_bz[i] - (m_aw[i]+m_br[i]);
+		if (d >= 0.f)
+			continue;
+		b3WriteSphereContact(contactsOut,numContacts,maxContactCapacity,m_pairIndex[i],m_bodyA[i],m_bodyB[i],-m_ax[i],-m_ay[i],-m_az[i],
+			m_bx[i]-m_ax[i]*m_br[i],m_by[i]-m_ay[i]*m_br[i],m_bz[i]-m_az[i]*m_br[i],d);
+	}
+	return numContacts;
+}
@@ -0,0 +1,70 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SPHERE_PAIR_BATCH_H
+#define B3_SPHERE_PAIR_BATCH_H
+
+#include "Bullet3Common/b3AlignedObjectArray.h"
+#include "Bullet3Common/shared/b3Int4.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3Contact4.h"
+#include "Bullet3Collision/NarrowPhaseCollision/shared/b3Collidable.h"
+#include "Bullet3Collision/NarrowPhaseCollision/shared/b3ConvexPolyhedronData.h"
+
+///b3SpherePairBatch gathers sphere-sphere or sphere-plane pairs into structure-of-arrays form.
+///The contact computation then only streams positions and radii, and tests 8 (AVX) or 4 (SSE) pairs at a time.
+///The generated contacts match those of primitiveContactsKernel: one point per pair, the plane is always body A.
+class b3SpherePairBatch
+{
+public:
+
+	///center and radius of sphere A, or the world space plane normal and constant for sphere-plane pairs
+	b3AlignedObjectArray<float>	m_ax;
+	b3AlignedObjectArray<float>	m_ay;
+	b3AlignedObjectArray<float>	m_az;
+	b3AlignedObjectArray<float>	m_aw;
+
+	///center and radius of sphere B
+	b3AlignedObjectArray<float>	m_bx;
+	b3AlignedObjectArray<float>	m_by;
+	b3AlignedObjectArray<float>	m_bz;
+	b3AlignedObjectArray<float>	m_br;
+
+	///body indices, negative for static bodies (see b3Contact4Data::m_bodyAPtrAndSignBit)
+	b3AlignedObjectArray<int>	m_bodyA;
+	b3AlignedObjectArray<int>	m_bodyB;
+	b3AlignedObjectArray<int>	m_pairIndex;
+
+	int		size() const
+	{
+		return m_pairIndex.size();
+	}
+
+	void	resize(int numPairs);
+
+	///pairIndices selects the sphere-sphere pairs out of pairs
+	void	gatherSphereSpherePairs(const b3Int4* pairs, const int* pairIndices, int numPairs,
+									const b3RigidBodyCL* bodies, const b3Collidable* collidables);
+
+	///pairIndices selects the sphere-plane or plane-sphere pairs out of pairs
+	void	gatherSpherePlanePairs(const b3Int4* pairs, const int* pairIndices, int numPairs,
+									const b3RigidBodyCL* bodies, const b3Collidable* collidables, const b3GpuFace* faces);
+
+	///both return the updated contact count, which can exceed maxContactCapacity like the GPU append counter
+	int		computeSphereSphereContacts(b3Contact4* contactsOut, int numContacts, int maxContactCapacity) const;
+	int		computeSpherePlaneContacts(b3Contact4* contactsOut, int numContacts, int maxContactCapacity) const;
+};
+
+#endif //B3_SPHERE_PAIR_BATCH_H
@@ -202,9 +202,10 @@ __kernel void   bvhTraversalKernel( __global const int4* pairs,
 									__global const btQuantizedBvhNode* quantizedNodesRoot,
 									__global const b3BvhInfo* bvhInfos,
 									int numPairs,
-									int maxNumConcavePairsCapacity)
+									int maxNumConcavePairsCapacity,
+									int pairOffset)
 {
-	int id = get_global_id(0);
+	int id = get_global_id(0)+pairOffset;
 	if (id>=numPairs)
 		return;
 	
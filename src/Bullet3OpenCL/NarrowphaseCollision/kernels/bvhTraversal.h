@@ -180,9 +180,10 @@ static const char* bvhTraversalKernelCL= \
 "									__global const btQuantizedBvhNode* quantizedNodesRoot,\n"
 "									__global const b3BvhInfo* bvhInfos,\n"
 "									int numPairs,\n"
-"									int maxNumConcavePairsCapacity)\n"
+"									int maxNumConcavePairsCapacity,\n"
+"									int pairOffset)\n"
 "{\n"
-"	int id = get_global_id(0);\n"
+"	int id = get_global_id(0)+pairOffset;\n"
 "	if (id>=numPairs)\n"
 "		return;\n"
 "	\n"
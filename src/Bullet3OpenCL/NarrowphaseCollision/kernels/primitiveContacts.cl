@@ -5,6 +5,20 @@
 #define SHAPE_CONCAVE_TRIMESH 5
 #define SHAPE_COMPOUND_OF_CONVEX_HULLS 6
 #define SHAPE_SPHERE 7
+#define SHAPE_BOX 8
+#define SHAPE_CAPSULE 9
+
+//must match b3PairTypeBin in b3ConvexHullContact.h
+#define PAIR_BIN_SPHERE_SPHERE 0
+#define PAIR_BIN_SPHERE_PLANE 1
+#define PAIR_BIN_CONVEX_PLANE 2
+#define PAIR_BIN_PRIMITIVE 3
+#define PAIR_BIN_CONVEX_CONVEX 4
+#define PAIR_BIN_COMPOUND 5
+#define PAIR_BIN_CONCAVE_COMPOUND 6
+#define PAIR_BIN_CONCAVE 7
+#define PAIR_BIN_UNSUPPORTED 8
+#define PAIR_BIN_UNSUPPORTED_BOX_CAPSULE 9
 
 
 #pragma OPENCL EXTENSION cl_amd_printf : enable
@@ -108,7 +122,12 @@ typedef struct
 	int m_vertexOffset;
 	int	m_uniqueEdgesOffset;
 	int	m_numUniqueEdges;
-	int m_unused;
+	int m_vertexAdjacencyOffset;
+
+	int m_edgeOffset;
+	int m_numEdges;
+	int m_unused0;
+	int m_unused1;
 
 } ConvexPolyhedronCL;
 
@@ -790,6 +809,676 @@ void	computeContactPlaneSphere(int pairIndex,
 }
 
 
+///box and capsule dimensions live in the face array, see b3GpuNarrowPhase::registerBoxShape/registerCapsuleShape
+///SHAPE_BOX: m_plane.xyz are the half extents
+///SHAPE_CAPSULE: m_plane.xyz is the unit local axis, m_plane.w the half height of the segment, m_radius the radius
+#define MAX_BOX_BOX_CLIP_POINTS 8
+
+int appendPrimitiveContact(int pairIndex, int bodyIndexA, int bodyIndexB,
+							__global const BodyData* rigidBodies, 
+							float4 normalOnB, const float4* pointsOnB, int numPoints,
+							__global struct b3Contact4Data* restrict globalContactsOut,
+							counter32_t nGlobalContactsOut,
+							int maxContactCapacity)
+{
+	int dstIdx;
+	AppendInc( nGlobalContactsOut, dstIdx );
+	
+	if (dstIdx < maxContactCapacity)
+	{
+		__global struct b3Contact4Data* c = &globalContactsOut[dstIdx];
+		c->m_worldNormalOnB = normalOnB;
+		c->m_restituitionCoeffCmp = (0.f*0xffff);c->m_frictionCoeffCmp = (0.7f*0xffff);
+		c->m_batchIdx = pairIndex;
+		c->m_bodyAPtrAndSignBit = rigidBodies[bodyIndexA].m_invMass==0?-bodyIndexA:bodyIndexA;
+		c->m_bodyBPtrAndSignBit = rigidBodies[bodyIndexB].m_invMass==0?-bodyIndexB:bodyIndexB;
+		c->m_childIndexA = -1;
+		c->m_childIndexB = -1;
+		for (int i=0;i<numPoints;i++)
+			c->m_worldPosB[i] = pointsOnB[i];
+		GET_NPOINTS(*c) = numPoints;
+		return dstIdx;
+	}
+	return -1;
+}
+
+//world space segment of a capsule, a sphere is treated as a capsule with a zero length segment
+void getCapsuleSegment(int collidableIndex, __global const btCollidableGpu* collidables, __global const btGpuFace* faces,
+						float4 pos, Quaternion orn, float4* p0, float4* p1, float* radius)
+{
+	*radius = collidables[collidableIndex].m_radius;
+	*p0 = pos;
+	*p1 = pos;
+	if (collidables[collidableIndex].m_shapeType==SHAPE_CAPSULE)
+	{
+		float4 axis = faces[collidables[collidableIndex].m_shapeIndex].m_plane;
+		float halfHeight = axis.w;
+		axis.w = 0.f;
+		float4 halfAxis = qtRotate(orn,axis)*halfHeight;
+		*p0 = pos-halfAxis;
+		*p1 = pos+halfAxis;
+	}
+	p0->w = 0.f;
+	p1->w = 0.f;
+}
+
+//closest points between segments p1-q1 and p2-q2, see Ericson, Real-Time Collision Detection, 5.1.9
+void closestPtSegmentSegment(float4 p1, float4 q1, float4 p2, float4 q2, float* sOut, float* tOut)
+{
+	float4 d1 = q1-p1;
+	float4 d2 = q2-p2;
+	float4 r = p1-p2;
+	float a = dot3F4(d1,d1);
+	float e = dot3F4(d2,d2);
+	float f = dot3F4(d2,r);
+	float s = 0.f;
+	float t = 0.f;
+	if (a<=FLT_EPSILON && e<=FLT_EPSILON)
+	{
+		*sOut = 0.f;
+		*tOut = 0.f;
+		return;
+	}
+	if (a<=FLT_EPSILON)
+	{
+		t = clamp(f/e,0.f,1.f);
+	} else
+	{
+		float c = dot3F4(d1,r);
+		if (e<=FLT_EPSILON)
+		{
+			s = clamp(-c/a,0.f,1.f);
+		} else
+		{
+			float b = dot3F4(d1,d2);
+			float denom = a*e-b*b;
+			if (denom>FLT_EPSILON)
+				s = clamp((b*f-c*e)/denom,0.f,1.f);
+			t = (b*s+f)/e;
+			if (t<0.f)
+			{
+				t = 0.f;
+				s = clamp(-c/a,0.f,1.f);
+			} else if (t>1.f)
+			{
+				t = 1.f;
+				s = clamp((b-c)/a,0.f,1.f);
+			}
+		}
+	}
+	*sOut = s;
+	*tOut = t;
+}
+
+//signed distance from a point in box space to the box surface, negative inside
+float pointBoxDistance(float4 p, float4 halfExtents, float4* closestOut, float4* normalOut)
+{
+	p.w = 0.f;
+	halfExtents.w = 0.f;
+	float4 closest = clamp(p,-halfExtents,halfExtents);
+	float4 diff = p-closest;
+	float lenSqr = dot3F4(diff,diff);
+	if (lenSqr>FLT_EPSILON*FLT_EPSILON)
+	{
+		float len = sqrt(lenSqr);
+		*closestOut = closest;
+		*normalOut = diff/len;
+		return len;
+	}
+
+	//inside, push out through the nearest face
+	float4 d = halfExtents-fabs(p);
+	float4 normal = make_float4(0.f,0.f,0.f,0.f);
+	float depth;
+	closest = p;
+	if (d.x<=d.y && d.x<=d.z)
+	{
+		normal.x = p.x<0.f? -1.f : 1.f;
+		closest.x = normal.x*halfExtents.x;
+		depth = d.x;
+	} else if (d.y<=d.z)
+	{
+		normal.y = p.y<0.f? -1.f : 1.f;
+		closest.y = normal.y*halfExtents.y;
+		depth = d.y;
+	} else
+	{
+		normal.z = p.z<0.f? -1.f : 1.f;
+		closest.z = normal.z*halfExtents.z;
+		depth = d.z;
+	}
+	*closestOut = closest;
+	*normalOut = normal;
+	return -depth;
+}
+
+void computeContactCapsuleCapsule(int pairIndex,
+									int bodyIndexA, int bodyIndexB, 
+									int collidableIndexA, int collidableIndexB, 
+									__global const BodyData* rigidBodies, 
+									__global const btCollidableGpu* collidables,
+									__global const btGpuFace* faces,
+									__global struct b3Contact4Data* restrict globalContactsOut,
+									counter32_t nGlobalContactsOut,
+									int maxContactCapacity)
+{
+	float4 a0,a1,b0,b1;
+	float radiusA,radiusB;
+	getCapsuleSegment(collidableIndexA,collidables,faces,rigidBodies[bodyIndexA].m_pos,rigidBodies[bodyIndexA].m_quat,&a0,&a1,&radiusA);
+	getCapsuleSegment(collidableIndexB,collidables,faces,rigidBodies[bodyIndexB].m_pos,rigidBodies[bodyIndexB].m_quat,&b0,&b1,&radiusB);
+
+	float4 dA = a1-a0;
+	float4 dB = b1-b0;
+	float lenSqrA = dot3F4(dA,dA);
+	float lenSqrB = dot3F4(dB,dB);
+
+	//parameters along segment B of the points to test
+	float tB[2];
+	int numTests = 0;
+
+	float4 c = cross3(dA,dB);
+	if (lenSqrA>FLT_EPSILON && lenSqrB>FLT_EPSILON && dot3F4(c,c)<=1e-6f*lenSqrA*lenSqrB)
+	{
+		//(nearly) parallel segments touch along a line, use both ends of the overlap so the capsules can rest on each other
+		float t0 = dot3F4(a0-b0,dB)/lenSqrB;
+		float t1 = dot3F4(a1-b0,dB)/lenSqrB;
+		float tMin = max(min(t0,t1),0.f);
+		float tMax = min(max(t0,t1),1.f);
+		if (tMin<tMax)
+		{
+			tB[0] = tMin;
+			tB[1] = tMax;
+			numTests = 2;
+		}
+	}
+
+	if (numTests==0)
+	{
+		float s,t;
+		closestPtSegmentSegment(a0,a1,b0,b1,&s,&t);
+		tB[0] = t;
+		numTests = 1;
+	}
+
+	float4 pointsOnB[2];
+	int numPoints = 0;
+	float4 normalOnB = make_float4(1.f,0.f,0.f,0.f);
+
+	for (int i=0;i<numTests;i++)
+	{
+		float4 pB = b0+dB*tB[i];
+		float s = 0.f;
+		if (lenSqrA>FLT_EPSILON)
+			s = clamp(dot3F4(pB-a0,dA)/lenSqrA,0.f,1.f);
+		float4 pA = a0+dA*s;
+		float4 diff = pA-pB;
+		float len = length(diff);
+		float dist = len-(radiusA+radiusB);
+		if (dist<=0.f)
+		{
+			if (numPoints==0 && len>0.00001f)
+				normalOnB = diff/len;
+			float4 contactPosB = pB+normalOnB*radiusB;
+			contactPosB.w = dist;
+			pointsOnB[numPoints++] = contactPosB;
+		}
+	}
+
+	if (numPoints)
+	{
+		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numPoints,
+			globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+	}
+}
+
+void computeContactCapsuleBox(int pairIndex,
+								int bodyIndexA, int bodyIndexB, 
+								int collidableIndexA, int collidableIndexB, 
+								__global const BodyData* rigidBodies, 
+								__global const btCollidableGpu* collidables,
+								__global const btGpuFace* faces,
+								__global struct b3Contact4Data* restrict globalContactsOut,
+								counter32_t nGlobalContactsOut,
+								int maxContactCapacity)
+{
+	float4 a0,a1;
+	float radius;
+	getCapsuleSegment(collidableIndexA,collidables,faces,rigidBodies[bodyIndexA].m_pos,rigidBodies[bodyIndexA].m_quat,&a0,&a1,&radius);
+
+	float4 posB = rigidBodies[bodyIndexB].m_pos;
+	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;
+	float4 halfExtents = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;
+	halfExtents.w = 0.f;
+
+	float4 invPosB;Quaternion invOrnB;
+	trInverse(posB,ornB,&invPosB,&invOrnB);
+	float4 p0 = transform(&a0,&invPosB,&invOrnB);
+	float4 p1 = transform(&a1,&invPosB,&invOrnB);
+	p0.w = 0.f;
+	p1.w = 0.f;
+	float4 seg = p1-p0;
+
+	//candidate parameters along the segment: end points, center and the closest points to the 12 box edges
+	float candidates[15];
+	int numCandidates = 0;
+	candidates[numCandidates++] = 0.f;
+	bool isSegment = dot3F4(seg,seg)>FLT_EPSILON;
+	if (isSegment)
+	{
+		candidates[numCandidates++] = 1.f;
+		candidates[numCandidates++] = 0.5f;
+		float4 h = halfExtents;
+		for (int i=0;i<4;i++)
+		{
+			float su = (i&1)? 1.f : -1.f;
+			float sv = (i&2)? 1.f : -1.f;
+			float s,t;
+			closestPtSegmentSegment(p0,p1,make_float4(-h.x,su*h.y,sv*h.z,0.f),make_float4(h.x,su*h.y,sv*h.z,0.f),&s,&t);
+			candidates[numCandidates++] = s;
+			closestPtSegmentSegment(p0,p1,make_float4(su*h.x,-h.y,sv*h.z,0.f),make_float4(su*h.x,h.y,sv*h.z,0.f),&s,&t);
+			candidates[numCandidates++] = s;
+			closestPtSegmentSegment(p0,p1,make_float4(su*h.x,sv*h.y,-h.z,0.f),make_float4(su*h.x,sv*h.y,h.z,0.f),&s,&t);
+			candidates[numCandidates++] = s;
+		}
+	}
+
+	float bestDist = FLT_MAX;
+	float bestT = 0.f;
+	float4 bestClosest;
+	float4 bestNormal;
+	//extremes of the touching part of the segment, so a capsule lying on a face gets two points
+	float tMin = FLT_MAX;
+	float tMax = -FLT_MAX;
+	for (int i=0;i<numCandidates;i++)
+	{
+		float4 closest,normal;
+		float dist = pointBoxDistance(p0+seg*candidates[i],halfExtents,&closest,&normal);
+		if (dist<bestDist)
+		{
+			bestDist = dist;
+			bestT = candidates[i];
+			bestClosest = closest;
+			bestNormal = normal;
+		}
+		if (dist<=radius)
+		{
+			tMin = min(tMin,candidates[i]);
+			tMax = max(tMax,candidates[i]);
+		}
+	}
+
+	if (bestDist>radius)
+		return;
+
+	float4 pointsOnB[3];
+	int numPoints = 0;
+	pointsOnB[numPoints] = transform(&bestClosest,&posB,&ornB);
+	pointsOnB[numPoints++].w = bestDist-radius;
+
+	if (isSegment)
+	{
+		float extremes[2] = {tMin,tMax};
+		for (int e=0;e<2;e++)
+		{
+			float t = extremes[e];
+			if (fabs(t-bestT)>0.01f && (e==0 || fabs(tMax-tMin)>0.01f))
+			{
+				float4 closest,normal;
+				float dist = pointBoxDistance(p0+seg*t,halfExtents,&closest,&normal);
+				pointsOnB[numPoints] = transform(&closest,&posB,&ornB);
+				pointsOnB[numPoints++].w = dist-radius;
+			}
+		}
+	}
+
+	float4 normalOnB = qtRotate(ornB,bestNormal);
+	normalOnB.w = 0.f;
+	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numPoints,
+		globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+}
+
+float boxBoxAxisOverlap(float4 axis, float4 delta, const float4* axesA, const float* halfA, const float4* axesB, const float* halfB)
+{
+	float rA = halfA[0]*fabs(dot3F4(axis,axesA[0]))+halfA[1]*fabs(dot3F4(axis,axesA[1]))+halfA[2]*fabs(dot3F4(axis,axesA[2]));
+	float rB = halfB[0]*fabs(dot3F4(axis,axesB[0]))+halfB[1]*fabs(dot3F4(axis,axesB[1]))+halfB[2]*fabs(dot3F4(axis,axesB[2]));
+	return rA+rB-fabs(dot3F4(delta,axis));
+}
+
+//keeps the part of the polygon with dot(planeNormal,p)<=planeConstant
+int clipPolygonAgainstPlane(const float4* pIn, int numIn, float4 planeNormal, float planeConstant, float4* pOut)
+{
+	int numOut = 0;
+	if (numIn<1)
+		return 0;
+	float4 prev = pIn[numIn-1];
+	float prevDist = dot3F4(planeNormal,prev)-planeConstant;
+	for (int i=0;i<numIn;i++)
+	{
+		float4 cur = pIn[i];
+		float curDist = dot3F4(planeNormal,cur)-planeConstant;
+		if ((curDist<=0.f) != (prevDist<=0.f))
+		{
+			pOut[numOut++] = prev+(cur-prev)*(prevDist/(prevDist-curDist));
+		}
+		if (curDist<=0.f)
+		{
+			pOut[numOut++] = cur;
+		}
+		prev = cur;
+		prevDist = curDist;
+	}
+	return numOut;
+}
+
+//15 axis separating axis test, followed by reference face clipping or an edge-edge closest point
+void computeContactBoxBox(int pairIndex,
+							int bodyIndexA, int bodyIndexB, 
+							int collidableIndexA, int collidableIndexB, 
+							__global const BodyData* rigidBodies, 
+							__global const btCollidableGpu* collidables,
+							__global const btGpuFace* faces,
+							__global struct b3Contact4Data* restrict globalContactsOut,
+							counter32_t nGlobalContactsOut,
+							int maxContactCapacity)
+{
+	float4 posA = rigidBodies[bodyIndexA].m_pos;
+	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;
+	float4 posB = rigidBodies[bodyIndexB].m_pos;
+	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;
+	posA.w = 0.f;
+	posB.w = 0.f;
+	float4 extentsA = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;
+	float4 extentsB = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;
+	float hA[3] = {extentsA.x,extentsA.y,extentsA.z};
+	float hB[3] = {extentsB.x,extentsB.y,extentsB.z};
+
+	float4 axesA[3];
+	float4 axesB[3];
+	axesA[0] = qtRotate(ornA,make_float4(1.f,0.f,0.f,0.f));
+	axesA[1] = qtRotate(ornA,make_float4(0.f,1.f,0.f,0.f));
+	axesA[2] = qtRotate(ornA,make_float4(0.f,0.f,1.f,0.f));
+	axesB[0] = qtRotate(ornB,make_float4(1.f,0.f,0.f,0.f));
+	axesB[1] = qtRotate(ornB,make_float4(0.f,1.f,0.f,0.f));
+	axesB[2] = qtRotate(ornB,make_float4(0.f,0.f,1.f,0.f));
+	for (int i=0;i<3;i++)
+	{
+		axesA[i].w = 0.f;
+		axesB[i].w = 0.f;
+	}
+
+	float4 delta = posB-posA;
+	float bestOverlap = FLT_MAX;
+	float4 bestAxis = make_float4(0.f,0.f,0.f,0.f);
+	int bestType = -1;
+
+	//face axes of A (0..2) and B (3..5)
+	for (int i=0;i<6;i++)
+	{
+		float4 axis = i<3? axesA[i] : axesB[i-3];
+		float overlap = boxBoxAxisOverlap(axis,delta,axesA,hA,axesB,hB);
+		if (overlap<0.f)
+			return;
+		if (overlap<bestOverlap)
+		{
+			bestOverlap = overlap;
+			bestAxis = axis;
+			bestType = i;
+		}
+	}
+
+	//edge-edge axes (6..14), only taken when clearly better than a face to keep resting contacts stable
+	for (int i=0;i<3;i++)
+	{
+		for (int j=0;j<3;j++)
+		{
+			float4 axis = cross3(axesA[i],axesB[j]);
+			float lenSqr = dot3F4(axis,axis);
+			if (lenSqr<1e-6f)
+				continue;
+			axis *= 1.f/sqrt(lenSqr);
+			float overlap = boxBoxAxisOverlap(axis,delta,axesA,hA,axesB,hB);
+			if (overlap<0.f)
+				return;
+			if (overlap<0.95f*bestOverlap)
+			{
+				bestOverlap = overlap;
+				bestAxis = axis;
+				bestType = 6+i*3+j;
+			}
+		}
+	}
+
+	//make the axis point from A to B
+	if (dot3F4(delta,bestAxis)<0.f)
+		bestAxis = -bestAxis;
+	float4 normalOnB = -bestAxis;
+
+	if (bestType>=6)
+	{
+		int i = (bestType-6)/3;
+		int j = (bestType-6)%3;
+		float4 edgeA = posA;
+		float4 edgeB = posB;
+		for (int k=0;k<3;k++)
+		{
+			if (k!=i)
+				edgeA += axesA[k]*(dot3F4(axesA[k],bestAxis)>0.f? hA[k] : -hA[k]);
+			if (k!=j)
+				edgeB += axesB[k]*(dot3F4(axesB[k],bestAxis)>0.f? -hB[k] : hB[k]);
+		}
+		//closest points between the two edge lines
+		float4 r = edgeA-edgeB;
+		float dAB = dot3F4(axesA[i],axesB[j]);
+		float e = dot3F4(axesA[i],r);
+		float f = dot3F4(axesB[j],r);
+		float denom = 1.f-dAB*dAB;
+		float s = denom>FLT_EPSILON? (dAB*f-e)/denom : 0.f;
+		s = clamp(s,-hA[i],hA[i]);
+		float t = clamp(f+s*dAB,-hB[j],hB[j]);
+		float4 pointOnB = edgeB+axesB[j]*t;
+		pointOnB.w = -bestOverlap;
+		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,&pointOnB,1,
+			globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+		return;
+	}
+
+	bool refIsA = bestType<3;
+	int refFace = refIsA? bestType : bestType-3;
+	//reference face normal, pointing towards the incident box
+	float4 refNormal = refIsA? bestAxis : -bestAxis;
+	float4 refPos = refIsA? posA : posB;
+	float4 incPos = refIsA? posB : posA;
+	float4 refAxes[3];
+	float4 incAxes[3];
+	float refH[3];
+	float incH[3];
+	for (int k=0;k<3;k++)
+	{
+		refAxes[k] = refIsA? axesA[k] : axesB[k];
+		incAxes[k] = refIsA? axesB[k] : axesA[k];
+		refH[k] = refIsA? hA[k] : hB[k];
+		incH[k] = refIsA? hB[k] : hA[k];
+	}
+
+	//incident face is the face most anti-parallel to the reference normal
+	int incFace = 0;
+	float maxAbsDot = -1.f;
+	for (int k=0;k<3;k++)
+	{
+		float absDot = fabs(dot3F4(incAxes[k],refNormal));
+		if (absDot>maxAbsDot)
+		{
+			maxAbsDot = absDot;
+			incFace = k;
+		}
+	}
+	float4 incNormal = dot3F4(incAxes[incFace],refNormal)>0.f? -incAxes[incFace] : incAxes[incFace];
+	float4 incCenter = incPos+incNormal*incH[incFace];
+	int u = (incFace+1)%3;
+	int v = (incFace+2)%3;
+	float4 incU = incAxes[u]*incH[u];
+	float4 incV = incAxes[v]*incH[v];
+
+	float4 clipA[MAX_BOX_BOX_CLIP_POINTS];
+	float4 clipB[MAX_BOX_BOX_CLIP_POINTS];
+	clipA[0] = incCenter+incU+incV;
+	clipA[1] = incCenter-incU+incV;
+	clipA[2] = incCenter-incU-incV;
+	clipA[3] = incCenter+incU-incV;
+	int numPoints = 4;
+
+	//clip the incident face against the side planes of the reference face
+	int ru = (refFace+1)%3;
+	int rv = (refFace+2)%3;
+	float offsetU = dot3F4(refAxes[ru],refPos);
+	float offsetV = dot3F4(refAxes[rv],refPos);
+	numPoints = clipPolygonAgainstPlane(clipA,numPoints,refAxes[ru],offsetU+refH[ru],clipB);
+	numPoints = clipPolygonAgainstPlane(clipB,numPoints,-refAxes[ru],-offsetU+refH[ru],clipA);
+	numPoints = clipPolygonAgainstPlane(clipA,numPoints,refAxes[rv],offsetV+refH[rv],clipB);
+	numPoints = clipPolygonAgainstPlane(clipB,numPoints,-refAxes[rv],-offsetV+refH[rv],clipA);
+
+	float4 refCenter = refPos+refNormal*refH[refFace];
+	float4 contactPoints[MAX_BOX_BOX_CLIP_POINTS];
+	int numContacts = 0;
+	for (int k=0;k<numPoints;k++)
+	{
+		float depth = dot3F4(refNormal,clipA[k]-refCenter);
+		if (depth<=0.f)
+		{
+			//contact points are reported on B
+			float4 pointOnB = refIsA? clipA[k] : clipA[k]-refNormal*depth;
+			pointOnB.w = depth;
+			contactPoints[numContacts++] = pointOnB;
+		}
+	}
+
+	if (numContacts==0)
+		return;
+
+	int4 contactIdx = make_int4(0,1,2,3);
+	int numReducedPoints = numContacts;
+	if (numContacts>4)
+	{
+		numReducedPoints = extractManifoldSequential(contactPoints,numContacts,normalOnB,&contactIdx);
+	}
+	float4 pointsOnB[4];
+	pointsOnB[0] = contactPoints[contactIdx.x];
+	pointsOnB[1] = contactPoints[contactIdx.y];
+	pointsOnB[2] = contactPoints[contactIdx.z];
+	pointsOnB[3] = contactPoints[contactIdx.w];
+	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numReducedPoints,
+		globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+}
+
+void computeContactPlaneBox(int pairIndex,
+							int bodyIndexA, int bodyIndexB, 
+							int collidableIndexA, int collidableIndexB, 
+							__global const BodyData* rigidBodies, 
+							__global const btCollidableGpu* collidables,
+							__global const btGpuFace* faces,
+							__global struct b3Contact4Data* restrict globalContactsOut,
+							counter32_t nGlobalContactsOut,
+							int maxContactCapacity)
+{
+	float4 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;
+	float4 planeNormal = make_float4(planeEq.x,planeEq.y,planeEq.z,0.f);
+	float planeConstant = planeEq.w;
+	float4 halfExtents = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;
+	float4 posA = rigidBodies[bodyIndexA].m_pos;
+	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;
+	float4 posB = rigidBodies[bodyIndexB].m_pos;
+	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;
+
+	float4 boxInPlanePos; Quaternion boxInPlaneOrn;
+	{
+		float4 invPosA;Quaternion invOrnA;
+		trInverse(posA,ornA,&invPosA,&invOrnA);
+		trMul(invPosA,invOrnA,posB,ornB,&boxInPlanePos,&boxInPlaneOrn);
+	}
+
+	float4 contactPoints[8];
+	int numPoints = 0;
+	for (int i=0;i<8;i++)
+	{
+		float4 vtx = make_float4((i&1)? halfExtents.x : -halfExtents.x,
+								(i&2)? halfExtents.y : -halfExtents.y,
+								(i&4)? halfExtents.z : -halfExtents.z,0.f);
+		float4 vtxInPlane = transform(&vtx,&boxInPlanePos,&boxInPlaneOrn);
+		float dist = dot3F4(planeNormal,vtxInPlane)-planeConstant;
+		if (dist<0.f)
+		{
+			float4 vtxWorld = transform(&vtx,&posB,&ornB);
+			vtxWorld.w = dist;
+			contactPoints[numPoints++] = vtxWorld;
+		}
+	}
+
+	if (numPoints==0)
+		return;
+
+	float4 normalOnB = -qtRotate(ornA,planeNormal);
+	normalOnB.w = 0.f;
+	int4 contactIdx = make_int4(0,1,2,3);
+	int numReducedPoints = numPoints;
+	if (numPoints>4)
+	{
+		numReducedPoints = extractManifoldSequential(contactPoints,numPoints,normalOnB,&contactIdx);
+	}
+	float4 pointsOnB[4];
+	pointsOnB[0] = contactPoints[contactIdx.x];
+	pointsOnB[1] = contactPoints[contactIdx.y];
+	pointsOnB[2] = contactPoints[contactIdx.z];
+	pointsOnB[3] = contactPoints[contactIdx.w];
+	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numReducedPoints,
+		globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+}
+
+void computeContactPlaneCapsule(int pairIndex,
+								int bodyIndexA, int bodyIndexB, 
+								int collidableIndexA, int collidableIndexB, 
+								__global const BodyData* rigidBodies, 
+								__global const btCollidableGpu* collidables,
+								__global const btGpuFace* faces,
+								__global struct b3Contact4Data* restrict globalContactsOut,
+								counter32_t nGlobalContactsOut,
+								int maxContactCapacity)
+{
+	float4 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;
+	float4 planeNormal = make_float4(planeEq.x,planeEq.y,planeEq.z,0.f);
+	float planeConstant = planeEq.w;
+	float4 posA = rigidBodies[bodyIndexA].m_pos;
+	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;
+	float4 planeNormalWorld = qtRotate(ornA,planeNormal);
+	planeNormalWorld.w = 0.f;
+	float4 invPosA;Quaternion invOrnA;
+	trInverse(posA,ornA,&invPosA,&invOrnA);
+
+	float4 ends[2];
+	float radius;
+	getCapsuleSegment(collidableIndexB,collidables,faces,rigidBodies[bodyIndexB].m_pos,rigidBodies[bodyIndexB].m_quat,&ends[0],&ends[1],&radius);
+
+	float4 pointsOnB[2];
+	int numPoints = 0;
+	for (int i=0;i<2;i++)
+	{
+		float4 endInPlane = transform(&ends[i],&invPosA,&invOrnA);
+		float dist = dot3F4(planeNormal,endInPlane)-planeConstant-radius;
+		if (dist<0.f)
+		{
+			float4 pointOnB = ends[i]-planeNormalWorld*radius;
+			pointOnB.w = dist;
+			pointsOnB[numPoints++] = pointOnB;
+		}
+	}
+
+	if (numPoints)
+	{
+		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,-planeNormalWorld,pointsOnB,numPoints,
+			globalContactsOut,nGlobalContactsOut,maxContactCapacity);
+	}
+}
+
+
 __kernel void   primitiveContactsKernel( __global int4* pairs, 
 																					__global const BodyData* rigidBodies, 
 																					__global const btCollidableGpu* collidables,
@@ -800,10 +1489,10 @@ __kernel void   primitiveContactsKernel( __global int4* pairs,
 																					__global const int* indices,
 																					__global struct b3Contact4Data* restrict globalContactsOut,
 																					counter32_t nGlobalContactsOut,
-																					int numPairs, int maxContactCapacity)
+																					int numPairs, int maxContactCapacity, int pairOffset)
 {
 
-	int i = get_global_id(0);
+	int i = get_global_id(0)+pairOffset;
 	int pairIndex = i;
 	
 	float4 worldVertsB1[64];
@@ -971,6 +1660,66 @@ __kernel void   primitiveContactsKernel( __global int4* pairs,
 			return;
 		}//SHAPE_SPHERE SHAPE_SPHERE
 
+		int shapeTypeA = collidables[collidableIndexA].m_shapeType;
+		int shapeTypeB = collidables[collidableIndexB].m_shapeType;
+
+		if (shapeTypeA == SHAPE_BOX && shapeTypeB == SHAPE_BOX)
+		{
+			computeContactBoxBox(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
+		if ((shapeTypeA == SHAPE_CAPSULE || shapeTypeA == SHAPE_SPHERE) && shapeTypeB == SHAPE_BOX)
+		{
+			computeContactCapsuleBox(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
+		if (shapeTypeA == SHAPE_BOX && (shapeTypeB == SHAPE_CAPSULE || shapeTypeB == SHAPE_SPHERE))
+		{
+			computeContactCapsuleBox(pairIndex, bodyIndexB, bodyIndexA, collidableIndexB, collidableIndexA, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
+		if ((shapeTypeA == SHAPE_CAPSULE && (shapeTypeB == SHAPE_CAPSULE || shapeTypeB == SHAPE_SPHERE)) ||
+			(shapeTypeA == SHAPE_SPHERE && shapeTypeB == SHAPE_CAPSULE))
+		{
+			computeContactCapsuleCapsule(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
+		if (shapeTypeA == SHAPE_PLANE && shapeTypeB == SHAPE_BOX)
+		{
+			computeContactPlaneBox(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
+		if (shapeTypeA == SHAPE_BOX && shapeTypeB == SHAPE_PLANE)
+		{
+			computeContactPlaneBox(pairIndex, bodyIndexB, bodyIndexA, collidableIndexB, collidableIndexA, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
+		if (shapeTypeA == SHAPE_PLANE && shapeTypeB == SHAPE_CAPSULE)
+		{
+			computeContactPlaneCapsule(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
+		if (shapeTypeA == SHAPE_CAPSULE && shapeTypeB == SHAPE_PLANE)
+		{
+			computeContactPlaneCapsule(pairIndex, bodyIndexB, bodyIndexA, collidableIndexB, collidableIndexA, 
+																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);
+			return;
+		}
+
 	}//	if (i<numPairs)
 
 }
@@ -1371,4 +2120,192 @@ __kernel void   findConcaveSphereContactsKernel( __global int4* concavePairs,
 
 		return;
 	}
-}
\ No newline at end of file
+}
+
+
+int computePairTypeBin(int shapeTypeA, int shapeTypeB)
+{
+	//boxes and capsules have no hull data for the SAT, compound and concave kernels
+	bool boxCapsuleA = shapeTypeA==SHAPE_BOX || shapeTypeA==SHAPE_CAPSULE;
+	bool boxCapsuleB = shapeTypeB==SHAPE_BOX || shapeTypeB==SHAPE_CAPSULE;
+	bool hullDataA = shapeTypeA==SHAPE_CONVEX_HULL || shapeTypeA==SHAPE_COMPOUND_OF_CONVEX_HULLS || shapeTypeA==SHAPE_CONCAVE_TRIMESH;
+	bool hullDataB = shapeTypeB==SHAPE_CONVEX_HULL || shapeTypeB==SHAPE_COMPOUND_OF_CONVEX_HULLS || shapeTypeB==SHAPE_CONCAVE_TRIMESH;
+	if ((boxCapsuleA && hullDataB) || (boxCapsuleB && hullDataA))
+		return PAIR_BIN_UNSUPPORTED_BOX_CAPSULE;
+	if (shapeTypeA==SHAPE_CONCAVE_TRIMESH)
+	{
+		if (shapeTypeB==SHAPE_COMPOUND_OF_CONVEX_HULLS)
+			return PAIR_BIN_CONCAVE_COMPOUND;
+		if (shapeTypeB==SHAPE_CONVEX_HULL || shapeTypeB==SHAPE_SPHERE)
+			return PAIR_BIN_CONCAVE;
+		return PAIR_BIN_UNSUPPORTED;
+	}
+	if (shapeTypeA==SHAPE_COMPOUND_OF_CONVEX_HULLS || shapeTypeB==SHAPE_COMPOUND_OF_CONVEX_HULLS)
+		return PAIR_BIN_COMPOUND;
+	if (shapeTypeA==SHAPE_CONVEX_HULL && shapeTypeB==SHAPE_CONVEX_HULL)
+		return PAIR_BIN_CONVEX_CONVEX;
+	if (shapeTypeA==SHAPE_SPHERE && shapeTypeB==SHAPE_SPHERE)
+		return PAIR_BIN_SPHERE_SPHERE;
+	if ((shapeTypeA==SHAPE_SPHERE && shapeTypeB==SHAPE_PLANE) || (shapeTypeA==SHAPE_PLANE && shapeTypeB==SHAPE_SPHERE))
+		return PAIR_BIN_SPHERE_PLANE;
+	if ((shapeTypeA==SHAPE_CONVEX_HULL && shapeTypeB==SHAPE_PLANE) || (shapeTypeA==SHAPE_PLANE && shapeTypeB==SHAPE_CONVEX_HULL))
+		return PAIR_BIN_CONVEX_PLANE;
+	if (shapeTypeA==SHAPE_PLANE && shapeTypeB==SHAPE_PLANE)
+		return PAIR_BIN_UNSUPPORTED;
+	if (shapeTypeA==SHAPE_CONCAVE_TRIMESH || shapeTypeB==SHAPE_CONCAVE_TRIMESH)
+		return PAIR_BIN_UNSUPPORTED;
+	return PAIR_BIN_PRIMITIVE;
+}
+
+///key is the shape type pair bin, value is the original pair index
+__kernel void   computePairTypeBinsKernel( __global const int4* pairs, 
+											__global const BodyData* rigidBodies, 
+											__global const btCollidableGpu* collidables,
+											__global int2* sortDataOut,
+											int numPairs)
+{
+	int i = get_global_id(0);
+	if (i>=numPairs)
+		return;
+
+	int collidableIndexA = rigidBodies[pairs[i].x].m_collidableIdx;
+	int collidableIndexB = rigidBodies[pairs[i].y].m_collidableIdx;
+	int2 sortData;
+	sortData.x = computePairTypeBin(collidables[collidableIndexA].m_shapeType,collidables[collidableIndexB].m_shapeType);
+	sortData.y = i;
+	sortDataOut[i] = sortData;
+}
+
+__kernel void   gatherPairsKernel( __global const int4* pairsIn, __global const int2* sortData, __global int4* pairsOut, int numPairs)
+{
+	int i = get_global_id(0);
+	if (i<numPairs)
+		pairsOut[i] = pairsIn[sortData[i].y];
+}
+
+///write back the cached contact indices (z,w) to the unsorted pair array
+__kernel void   scatterPairsKernel( __global const int4* sortedPairs, __global const int2* sortData, __global int4* pairsOut, int numPairs)
+{
+	int i = get_global_id(0);
+	if (i<numPairs)
+		pairsOut[sortData[i].y] = sortedPairs[i];
+}
+
+
+///gathers the sphere-sphere and sphere-plane bins into structure-of-arrays form,
+///so the contact kernels below only read positions and radii and don't touch bodies or collidables
+///sphereA holds the center and radius of sphere A, or the world space plane (normal, constant) for sphere-plane pairs
+__kernel void   gatherSpherePairsKernel( __global const int4* pairs, 
+										__global const BodyData* rigidBodies, 
+										__global const btCollidableGpu* collidables,
+										__global const btGpuFace* faces,
+										__global float4* sphereA,
+										__global float4* sphereB,
+										__global int2* signedBodies,
+										int numPairs, int pairOffset)
+{
+	int i = get_global_id(0);
+	if (i>=numPairs)
+		return;
+
+	int bodyIndexA = pairs[i+pairOffset].x;
+	int bodyIndexB = pairs[i+pairOffset].y;
+	if (collidables[rigidBodies[bodyIndexB].m_collidableIdx].m_shapeType==SHAPE_PLANE)
+	{
+		int tmp = bodyIndexA;
+		bodyIndexA = bodyIndexB;
+		bodyIndexB = tmp;
+	}
+	int collidableIndexA = rigidBodies[bodyIndexA].m_collidableIdx;
+	int collidableIndexB = rigidBodies[bodyIndexB].m_collidableIdx;
+	
+	float4 a = rigidBodies[bodyIndexA].m_pos;
+	a.w = collidables[collidableIndexA].m_radius;
+	if (collidables[collidableIndexA].m_shapeType==SHAPE_PLANE)
+	{
+		float4 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;
+		float4 normal = qtRotate(rigidBodies[bodyIndexA].m_quat,make_float4(planeEq.x,planeEq.y,planeEq.z,0.f));
+		a = normal;
+		a.w = planeEq.w + dot3F4(normal,rigidBodies[bodyIndexA].m_pos);
+	}
+	float4 b = rigidBodies[bodyIndexB].m_pos;
+	b.w = collidables[collidableIndexB].m_radius;
+
+	sphereA[i] = a;
+	sphereB[i] = b;
+	signedBodies[i] = make_int2(rigidBodies[bodyIndexA].m_invMass==0?-bodyIndexA:bodyIndexA,
+								rigidBodies[bodyIndexB].m_invMass==0?-bodyIndexB:bodyIndexB);
+}
+
+void writeSphereContact(__global struct b3Contact4Data* restrict globalContactsOut, counter32_t nGlobalContactsOut, int maxContactCapacity,
+						int pairIndex, int2 bodies, float4 normalOnB, float4 pointOnB)
+{
+	int dstIdx;
+	AppendInc( nGlobalContactsOut, dstIdx );
+	if (dstIdx < maxContactCapacity)
+	{
+		__global struct b3Contact4Data* c = &globalContactsOut[dstIdx];
+		c->m_worldNormalOnB = normalOnB;
+		c->m_restituitionCoeffCmp = (0.f*0xffff);c->m_frictionCoeffCmp = (0.7f*0xffff);
+		c->m_batchIdx = pairIndex;
+		c->m_bodyAPtrAndSignBit = bodies.x;
+		c->m_bodyBPtrAndSignBit = bodies.y;
+		c->m_worldPosB[0] = pointOnB;
+		c->m_childIndexA = -1;
+		c->m_childIndexB = -1;
+		GET_NPOINTS(*c) = 1;
+	}
+}
+
+///i runs over the gathered arrays, starting at firstPair, the pair index is pairOffset+i
+__kernel void   sphereSphereContactsKernel( __global const float4* sphereA,
+											__global const float4* sphereB,
+											__global const int2* signedBodies,
+											__global struct b3Contact4Data* restrict globalContactsOut,
+											counter32_t nGlobalContactsOut,
+											int numPairs, int firstPair, int pairOffset, int maxContactCapacity)
+{
+	int i = get_global_id(0)+firstPair;
+	if (i>=numPairs)
+		return;
+
+	float4 a = sphereA[i];
+	float4 b = sphereB[i];
+	float radiusSum = a.w+b.w;
+	float4 diff = make_float4(a.x-b.x,a.y-b.y,a.z-b.z,0.f);
+	float len = length(diff);
+	if (len > radiusSum)
+		return;
+
+	float4 normalOnSurfaceB = make_float4(1.f,0.f,0.f,0.f);
+	if (len > 0.00001)
+	{
+		normalOnSurfaceB = diff / len;
+	}
+	float4 contactPosB = make_float4(b.x,b.y,b.z,0.f) + normalOnSurfaceB*b.w;
+	contactPosB.w = len - radiusSum;
+	writeSphereContact(globalContactsOut,nGlobalContactsOut,maxContactCapacity,pairOffset+i,signedBodies[i],normalOnSurfaceB,contactPosB);
+}
+
+__kernel void   spherePlaneContactsKernel( __global const float4* sphereA,
+											__global const float4* sphereB,
+											__global const int2* signedBodies,
+											__global struct b3Contact4Data* restrict globalContactsOut,
+											counter32_t nGlobalContactsOut,
+											int numPairs, int firstPair, int pairOffset, int maxContactCapacity)
+{
+	int i = get_global_id(0)+firstPair;
+	if (i>=numPairs)
+		return;
+
+	float4 plane = sphereA[i];
+	float4 b = sphereB[i];
+	float4 planeNormal = make_float4(plane.x,plane.y,plane.z,0.f);
+	float distance = plane.x*b.x+plane.y*b.y+plane.z*b.z - (plane.w+b.w);
+	if (distance >= 0.f)
+		return;
+
+	float4 pOnB = make_float4(b.x,b.y,b.z,0.f) - planeNormal*b.w;
+	pOnB.w = distance;
+	writeSphereContact(globalContactsOut,nGlobalContactsOut,maxContactCapacity,pairOffset+i,signedBodies[i],-planeNormal,pOnB);
+}
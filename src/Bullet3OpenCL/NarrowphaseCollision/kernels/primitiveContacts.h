@@ -65,6 +65,19 @@ static const char* primitiveContactsKernelsCL= \
 "#define SHAPE_CONCAVE_TRIMESH 5\n"
 "#define SHAPE_COMPOUND_OF_CONVEX_HULLS 6\n"
 "#define SHAPE_SPHERE 7\n"
+"#define SHAPE_BOX 8\n"
+"#define SHAPE_CAPSULE 9\n"
+"//must match b3PairTypeBin in b3ConvexHullContact.h\n"
+"#define PAIR_BIN_SPHERE_SPHERE 0\n"
+"#define PAIR_BIN_SPHERE_PLANE 1\n"
+"#define PAIR_BIN_CONVEX_PLANE 2\n"
+"#define PAIR_BIN_PRIMITIVE 3\n"
+"#define PAIR_BIN_CONVEX_CONVEX 4\n"
+"#define PAIR_BIN_COMPOUND 5\n"
+"#define PAIR_BIN_CONCAVE_COMPOUND 6\n"
+"#define PAIR_BIN_CONCAVE 7\n"
+"#define PAIR_BIN_UNSUPPORTED 8\n"
+"#define PAIR_BIN_UNSUPPORTED_BOX_CAPSULE 9\n"
 "#pragma OPENCL EXTENSION cl_amd_printf : enable\n"
 "#pragma OPENCL EXTENSION cl_khr_local_int32_base_atomics : enable\n"
 "#pragma OPENCL EXTENSION cl_khr_global_int32_base_atomics : enable\n"
@@ -151,7 +164,11 @@ static const char* primitiveContactsKernelsCL= \
 "	int m_vertexOffset;\n"
 "	int	m_uniqueEdgesOffset;\n"
 "	int	m_numUniqueEdges;\n"
-"	int m_unused;\n"
+"	int m_vertexAdjacencyOffset;\n"
+"	int m_edgeOffset;\n"
+"	int m_numEdges;\n"
+"	int m_unused0;\n"
+"	int m_unused1;\n"
 "} ConvexPolyhedronCL;\n"
 "typedef struct\n"
 "{\n"
@@ -743,6 +760,627 @@ static const char* primitiveContactsKernelsCL= \
 "		}//if (dstIdx < numPairs)\n"
 "	}//if (hasCollision)\n"
 "}\n"
+"///box and capsule dimensions live in the face array, see b3GpuNarrowPhase::registerBoxShape/registerCapsuleShape\n"
+"///SHAPE_BOX: m_plane.xyz are the half extents\n"
+"///SHAPE_CAPSULE: m_plane.xyz is the unit local axis, m_plane.w the half height of the segment, m_radius the radius\n"
+"#define MAX_BOX_BOX_CLIP_POINTS 8\n"
+"int appendPrimitiveContact(int pairIndex, int bodyIndexA, int bodyIndexB,\n"
+"							__global const BodyData* rigidBodies, \n"
+"							float4 normalOnB, const float4* pointsOnB, int numPoints,\n"
+"							__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"							counter32_t nGlobalContactsOut,\n"
+"							int maxContactCapacity)\n"
+"{\n"
+"	int dstIdx;\n"
+"	AppendInc( nGlobalContactsOut, dstIdx );\n"
+"	\n"
+"	if (dstIdx < maxContactCapacity)\n"
+"	{\n"
+"		__global struct b3Contact4Data* c = &globalContactsOut[dstIdx];\n"
+"		c->m_worldNormalOnB = normalOnB;\n"
+"		c->m_restituitionCoeffCmp = (0.f*0xffff);c->m_frictionCoeffCmp = (0.7f*0xffff);\n"
+"		c->m_batchIdx = pairIndex;\n"
+"		c->m_bodyAPtrAndSignBit = rigidBodies[bodyIndexA].m_invMass==0?-bodyIndexA:bodyIndexA;\n"
+"		c->m_bodyBPtrAndSignBit = rigidBodies[bodyIndexB].m_invMass==0?-bodyIndexB:bodyIndexB;\n"
+"		c->m_childIndexA = -1;\n"
+"		c->m_childIndexB = -1;\n"
+"		for (int i=0;i<numPoints;i++)\n"
+"			c->m_worldPosB[i] = pointsOnB[i];\n"
+"		GET_NPOINTS(*c) = numPoints;\n"
+"		return dstIdx;\n"
+"	}\n"
+"	return -1;\n"
+"}\n"
+"//world space segment of a capsule, a sphere is treated as a capsule with a zero length segment\n"
+"void getCapsuleSegment(int collidableIndex, __global const btCollidableGpu* collidables, __global const btGpuFace* faces,\n"
+"						float4 pos, Quaternion orn, float4* p0, float4* p1, float* radius)\n"
+"{\n"
+"	*radius = collidables[collidableIndex].m_radius;\n"
+"	*p0 = pos;\n"
+"	*p1 = pos;\n"
+"	if (collidables[collidableIndex].m_shapeType==SHAPE_CAPSULE)\n"
+"	{\n"
+"		float4 axis = faces[collidables[collidableIndex].m_shapeIndex].m_plane;\n"
+"		float halfHeight = axis.w;\n"
+"		axis.w = 0.f;\n"
+"		float4 halfAxis = qtRotate(orn,axis)*halfHeight;\n"
+"		*p0 = pos-halfAxis;\n"
+"		*p1 = pos+halfAxis;\n"
+"	}\n"
+"	p0->w = 0.f;\n"
+"	p1->w = 0.f;\n"
+"}\n"
+"//closest points between segments p1-q1 and p2-q2, see Ericson, Real-Time Collision Detection, 5.1.9\n"
+"void closestPtSegmentSegment(float4 p1, float4 q1, float4 p2, float4 q2, float* sOut, float* tOut)\n"
+"{\n"
+"	float4 d1 = q1-p1;\n"
+"	float4 d2 = q2-p2;\n"
+"	float4 r = p1-p2;\n"
+"	float a = dot3F4(d1,d1);\n"
+"	float e = dot3F4(d2,d2);\n"
+"	float f = dot3F4(d2,r);\n"
+"	float s = 0.f;\n"
+"	float t = 0.f;\n"
+"	if (a<=FLT_EPSILON && e<=FLT_EPSILON)\n"
+"	{\n"
+"		*sOut = 0.f;\n"
+"		*tOut = 0.f;\n"
+"		return;\n"
+"	}\n"
+"	if (a<=FLT_EPSILON)\n"
+"	{\n"
+"		t = clamp(f/e,0.f,1.f);\n"
+"	} else\n"
+"	{\n"
+"		float c = dot3F4(d1,r);\n"
+"		if (e<=FLT_EPSILON)\n"
+"		{\n"
+"			s = clamp(-c/a,0.f,1.f);\n"
+"		} else\n"
+"		{\n"
+"			float b = dot3F4(d1,d2);\n"
+"			float denom = a*e-b*b;\n"
+"			if (denom>FLT_EPSILON)\n"
+"				s = clamp((b*f-c*e)/denom,0.f,1.f);\n"
+"			t = (b*s+f)/e;\n"
+"			if (t<0.f)\n"
+"			{\n"
+"				t = 0.f;\n"
+"				s = clamp(-c/a,0.f,1.f);\n"
+"			} else if (t>1.f)\n"
+"			{\n"
+"				t = 1.f;\n"
+"				s = clamp((b-c)/a,0.f,1.f);\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"	*sOut = s;\n"
+"	*tOut = t;\n"
+"}\n"
+"//signed distance from a point in box space to the box surface, negative inside\n"
+"float pointBoxDistance(float4 p, float4 halfExtents, float4* closestOut, float4* normalOut)\n"
+"{\n"
+"	p.w = 0.f;\n"
+"	halfExtents.w = 0.f;\n"
+"	float4 closest = clamp(p,-halfExtents,halfExtents);\n"
+"	float4 diff = p-closest;\n"
+"	float lenSqr = dot3F4(diff,diff);\n"
+"	if (lenSqr>FLT_EPSILON*FLT_EPSILON)\n"
+"	{\n"
+"		float len = sqrt(lenSqr);\n"
+"		*closestOut = closest;\n"
+"		*normalOut = diff/len;\n"
+"		return len;\n"
+"	}\n"
+"	//inside, push out through the nearest face\n"
+"	float4 d = halfExtents-fabs(p);\n"
+"	float4 normal = make_float4(0.f,0.f,0.f,0.f);\n"
+"	float depth;\n"
+"	closest = p;\n"
+"	if (d.x<=d.y && d.x<=d.z)\n"
+"	{\n"
+"		normal.x = p.x<0.f? -1.f : 1.f;\n"
+"		closest.x = normal.x*halfExtents.x;\n"
+"		depth = d.x;\n"
+"	} else if (d.y<=d.z)\n"
+"	{\n"
+"		normal.y = p.y<0.f? -1.f : 1.f;\n"
+"		closest.y = normal.y*halfExtents.y;\n"
+"		depth = d.y;\n"
+"	} else\n"
+"	{\n"
+"		normal.z = p.z<0.f? -1.f : 1.f;\n"
+"		closest.z = normal.z*halfExtents.z;\n"
+"		depth = d.z;\n"
+"	}\n"
+"	*closestOut = closest;\n"
+"	*normalOut = normal;\n"
+"	return -depth;\n"
+"}\n"
+"void computeContactCapsuleCapsule(int pairIndex,\n"
+"									int bodyIndexA, int bodyIndexB, \n"
+"									int collidableIndexA, int collidableIndexB, \n"
+"									__global const BodyData* rigidBodies, \n"
+"									__global const btCollidableGpu* collidables,\n"
+"									__global const btGpuFace* faces,\n"
+"									__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"									counter32_t nGlobalContactsOut,\n"
+"									int maxContactCapacity)\n"
+"{\n"
+"	float4 a0,a1,b0,b1;\n"
+"	float radiusA,radiusB;\n"
+"	getCapsuleSegment(collidableIndexA,collidables,faces,rigidBodies[bodyIndexA].m_pos,rigidBodies[bodyIndexA].m_quat,&a0,&a1,&radiusA);\n"
+"	getCapsuleSegment(collidableIndexB,collidables,faces,rigidBodies[bodyIndexB].m_pos,rigidBodies[bodyIndexB].m_quat,&b0,&b1,&radiusB);\n"
+"	float4 dA = a1-a0;\n"
+"	float4 dB = b1-b0;\n"
+"	float lenSqrA = dot3F4(dA,dA);\n"
+"	float lenSqrB = dot3F4(dB,dB);\n"
+"	//parameters along segment B of the points to test\n"
+"	float tB[2];\n"
+"	int numTests = 0;\n"
+"	float4 c = cross3(dA,dB);\n"
+"	if (lenSqrA>FLT_EPSILON && lenSqrB>FLT_EPSILON && dot3F4(c,c)<=1e-6f*lenSqrA*lenSqrB)\n"
+"	{\n"
+"		//(nearly) parallel segments touch along a line, use both ends of the overlap so the capsules can rest on each other\n"
+"		float t0 = dot3F4(a0-b0,dB)/lenSqrB;\n"
+"		float t1 = dot3F4(a1-b0,dB)/lenSqrB;\n"
+"		float tMin = max(min(t0,t1),0.f);\n"
+"		float tMax = min(max(t0,t1),1.f);\n"
+"		if (tMin<tMax)\n"
+"		{\n"
+"			tB[0] = tMin;\n"
+"			tB[1] = tMax;\n"
+"			numTests = 2;\n"
+"		}\n"
+"	}\n"
+"	if (numTests==0)\n"
+"	{\n"
+"		float s,t;\n"
+"		closestPtSegmentSegment(a0,a1,b0,b1,&s,&t);\n"
+"		tB[0] = t;\n"
+"		numTests = 1;\n"
+"	}\n"
+"	float4 pointsOnB[2];\n"
+"	int numPoints = 0;\n"
+"	float4 normalOnB = make_float4(1.f,0.f,0.f,0.f);\n"
+"	for (int i=0;i<numTests;i++)\n"
+"	{\n"
+"		float4 pB = b0+dB*tB[i];\n"
+"		float s = 0.f;\n"
+"		if (lenSqrA>FLT_EPSILON)\n"
+"			s = clamp(dot3F4(pB-a0,dA)/lenSqrA,0.f,1.f);\n"
+"		float4 pA = a0+dA*s;\n"
+"		float4 diff = pA-pB;\n"
+"		float len = length(diff);\n"
+"		float dist = len-(radiusA+radiusB);\n"
+"		if (dist<=0.f)\n"
+"		{\n"
+"			if (numPoints==0 && len>0.00001f)\n"
+"				normalOnB = diff/len;\n"
+"			float4 contactPosB = pB+normalOnB*radiusB;\n"
+"			contactPosB.w = dist;\n"
+"			pointsOnB[numPoints++] = contactPosB;\n"
+"		}\n"
+"	}\n"
+"	if (numPoints)\n"
+"	{\n"
+"		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numPoints,\n"
+"			globalContactsOut,nGlobalContactsOut,maxContactCapacity);\n"
+"	}\n"
+"}\n"
+"void computeContactCapsuleBox(int pairIndex,\n"
+"								int bodyIndexA, int bodyIndexB, \n"
+"								int collidableIndexA, int collidableIndexB, \n"
+"								__global const BodyData* rigidBodies, \n"
+"								__global const btCollidableGpu* collidables,\n"
+"								__global const btGpuFace* faces,\n"
+"								__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"								counter32_t nGlobalContactsOut,\n"
+"								int maxContactCapacity)\n"
+"{\n"
+"	float4 a0,a1;\n"
+"	float radius;\n"
+"	getCapsuleSegment(collidableIndexA,collidables,faces,rigidBodies[bodyIndexA].m_pos,rigidBodies[bodyIndexA].m_quat,&a0,&a1,&radius);\n"
+"	float4 posB = rigidBodies[bodyIndexB].m_pos;\n"
+"	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;\n"
+"	float4 halfExtents = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;\n"
+"	halfExtents.w = 0.f;\n"
+"	float4 invPosB;Quaternion invOrnB;\n"
+"	trInverse(posB,ornB,&invPosB,&invOrnB);\n"
+"	float4 p0 = transform(&a0,&invPosB,&invOrnB);\n"
+"	float4 p1 = transform(&a1,&invPosB,&invOrnB);\n"
+"	p0.w = 0.f;\n"
+"	p1.w = 0.f;\n"
+"	float4 seg = p1-p0;\n"
+"	//candidate parameters along the segment: end points, center and the closest points to the 12 box edges\n"
+"	float candidates[15];\n"
+"	int numCandidates = 0;\n"
+"	candidates[numCandidates++] = 0.f;\n"
+"	bool isSegment = dot3F4(seg,seg)>FLT_EPSILON;\n"
+"	if (isSegment)\n"
+"	{\n"
+"		candidates[numCandidates++] = 1.f;\n"
+"		candidates[numCandidates++] = 0.5f;\n"
+"		float4 h = halfExtents;\n"
+"		for (int i=0;i<4;i++)\n"
+"		{\n"
+"			float su = (i&1)? 1.f : -1.f;\n"
+"			float sv = (i&2)? 1.f : -1.f;\n"
+"			float s,t;\n"
+"			closestPtSegmentSegment(p0,p1,make_float4(-h.x,su*h.y,sv*h.z,0.f),make_float4(h.x,su*h.y,sv*h.z,0.f),&s,&t);\n"
+"			candidates[numCandidates++] = s;\n"
+"			closestPtSegmentSegment(p0,p1,make_float4(su*h.x,-h.y,sv*h.z,0.f),make_float4(su*h.x,h.y,sv*h.z,0.f),&s,&t);\n"
+"			candidates[numCandidates++] = s;\n"
+"			closestPtSegmentSegment(p0,p1,make_float4(su*h.x,sv*h.y,-h.z,0.f),make_float4(su*h.x,sv*h.y,h.z,0.f),&s,&t);\n"
+"			candidates[numCandidates++] = s;\n"
+"		}\n"
+"	}\n"
+"	float bestDist = FLT_MAX;\n"
+"	float bestT = 0.f;\n"
+"	float4 bestClosest;\n"
+"	float4 bestNormal;\n"
+"	//extremes of the touching part of the segment, so a capsule lying on a face gets two points\n"
+"	float tMin = FLT_MAX;\n"
+"	float tMax = -FLT_MAX;\n"
+"	for (int i=0;i<numCandidates;i++)\n"
+"	{\n"
+"		float4 closest,normal;\n"
+"		float dist = pointBoxDistance(p0+seg*candidates[i],halfExtents,&closest,&normal);\n"
+"		if (dist<bestDist)\n"
+"		{\n"
+"			bestDist = dist;\n"
+"			bestT = candidates[i];\n"
+"			bestClosest = closest;\n"
+"			bestNormal = normal;\n"
+"		}\n"
+"		if (dist<=radius)\n"
+"		{\n"
+"			tMin = min(tMin,candidates[i]);\n"
+"			tMax = max(tMax,candidates[i]);\n"
+"		}\n"
+"	}\n"
+"	if (bestDist>radius)\n"
+"		return;\n"
+"	float4 pointsOnB[3];\n"
+"	int numPoints = 0;\n"
+"	pointsOnB[numPoints] = transform(&bestClosest,&posB,&ornB);\n"
+"	pointsOnB[numPoints++].w = bestDist-radius;\n"
+"	if (isSegment)\n"
+"	{\n"
+"		float extremes[2] = {tMin,tMax};\n"
+"		for (int e=0;e<2;e++)\n"
+"		{\n"
+"			float t = extremes[e];\n"
+"			if (fabs(t-bestT)>0.01f && (e==0 || fabs(tMax-tMin)>0.01f))\n"
+"			{\n"
+"				float4 closest,normal;\n"
+"				float dist = pointBoxDistance(p0+seg*t,halfExtents,&closest,&normal);\n"
+"				pointsOnB[numPoints] = transform(&closest,&posB,&ornB);\n"
+"				pointsOnB[numPoints++].w = dist-radius;\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"	float4 normalOnB = qtRotate(ornB,bestNormal);\n"
+"	normalOnB.w = 0.f;\n"
+"	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numPoints,\n"
+"		globalContactsOut,nGlobalContactsOut,maxContactCapacity);\n"
+"}\n"
+"float boxBoxAxisOverlap(float4 axis, float4 delta, const float4* axesA, const float* halfA, const float4* axesB, const float* halfB)\n"
+"{\n"
+"	float rA = halfA[0]*fabs(dot3F4(axis,axesA[0]))+halfA[1]*fabs(dot3F4(axis,axesA[1]))+halfA[2]*fabs(dot3F4(axis,axesA[2]));\n"
+"	float rB = halfB[0]*fabs(dot3F4(axis,axesB[0]))+halfB[1]*fabs(dot3F4(axis,axesB[1]))+halfB[2]*fabs(dot3F4(axis,axesB[2]));\n"
+"	return rA+rB-fabs(dot3F4(delta,axis));\n"
+"}\n"
+"//keeps the part of the polygon with dot(planeNormal,p)<=planeConstant\n"
+"int clipPolygonAgainstPlane(const float4* pIn, int numIn, float4 planeNormal, float planeConstant, float4* pOut)\n"
+"{\n"
+"	int numOut = 0;\n"
+"	if (numIn<1)\n"
+"		return 0;\n"
+"	float4 prev = pIn[numIn-1];\n"
+"	float prevDist = dot3F4(planeNormal,prev)-planeConstant;\n"
+"	for (int i=0;i<numIn;i++)\n"
+"	{\n"
+"		float4 cur = pIn[i];\n"
+"		float curDist = dot3F4(planeNormal,cur)-planeConstant;\n"
+"		if ((curDist<=0.f) != (prevDist<=0.f))\n"
+"		{\n"
+"			pOut[numOut++] = prev+(cur-prev)*(prevDist/(prevDist-curDist));\n"
+"		}\n"
+"		if (curDist<=0.f)\n"
+"		{\n"
+"			pOut[numOut++] = cur;\n"
+"		}\n"
+"		prev = cur;\n"
+"		prevDist = curDist;\n"
+"	}\n"
+"	return numOut;\n"
+"}\n"
+"//15 axis separating axis test, followed by reference face clipping or an edge-edge closest point\n"
+"void computeContactBoxBox(int pairIndex,\n"
+"							int bodyIndexA, int bodyIndexB, \n"
+"							int collidableIndexA, int collidableIndexB, \n"
+"							__global const BodyData* rigidBodies, \n"
+"							__global const btCollidableGpu* collidables,\n"
+"							__global const btGpuFace* faces,\n"
+"							__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"							counter32_t nGlobalContactsOut,\n"
+"							int maxContactCapacity)\n"
+"{\n"
+"	float4 posA = rigidBodies[bodyIndexA].m_pos;\n"
+"	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;\n"
+"	float4 posB = rigidBodies[bodyIndexB].m_pos;\n"
+"	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;\n"
+"	posA.w = 0.f;\n"
+"	posB.w = 0.f;\n"
+"	float4 extentsA = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;\n"
+"	float4 extentsB = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;\n"
+"	float hA[3] = {extentsA.x,extentsA.y,extentsA.z};\n"
+"	float hB[3] = {extentsB.x,extentsB.y,extentsB.z};\n"
+"	float4 axesA[3];\n"
+"	float4 axesB[3];\n"
+"	axesA[0] = qtRotate(ornA,make_float4(1.f,0.f,0.f,0.f));\n"
+"	axesA[1] = qtRotate(ornA,make_float4(0.f,1.f,0.f,0.f));\n"
+"	axesA[2] = qtRotate(ornA,make_float4(0.f,0.f,1.f,0.f));\n"
+"	axesB[0] = qtRotate(ornB,make_float4(1.f,0.f,0.f,0.f));\n"
+"	axesB[1] = qtRotate(ornB,make_float4(0.f,1.f,0.f,0.f));\n"
+"	axesB[2] = qtRotate(ornB,make_float4(0.f,0.f,1.f,0.f));\n"
+"	for (int i=0;i<3;i++)\n"
+"	{\n"
+"		axesA[i].w = 0.f;\n"
+"		axesB[i].w = 0.f;\n"
+"	}\n"
+"	float4 delta = posB-posA;\n"
+"	float bestOverlap = FLT_MAX;\n"
+"	float4 bestAxis = make_float4(0.f,0.f,0.f,0.f);\n"
+"	int bestType = -1;\n"
+"	//face axes of A (0..2) and B (3..5)\n"
+"	for (int i=0;i<6;i++)\n"
+"	{\n"
+"		float4 axis = i<3? axesA[i] : axesB[i-3];\n"
+"		float overlap = boxBoxAxisOverlap(axis,delta,axesA,hA,axesB,hB);\n"
+"		if (overlap<0.f)\n"
+"			return;\n"
+"		if (overlap<bestOverlap)\n"
+"		{\n"
+"			bestOverlap = overlap;\n"
+"			bestAxis = axis;\n"
+"			bestType = i;\n"
+"		}\n"
+"	}\n"
+"	//edge-edge axes (6..14), only taken when clearly better than a face to keep resting contacts stable\n"
+"	for (int i=0;i<3;i++)\n"
+"	{\n"
+"		for (int j=0;j<3;j++)\n"
+"		{\n"
+"			float4 axis = cross3(axesA[i],axesB[j]);\n"
+"			float lenSqr = dot3F4(axis,axis);\n"
+"			if (lenSqr<1e-6f)\n"
+"				continue;\n"
+"			axis *= 1.f/sqrt(lenSqr);\n"
+"			float overlap = boxBoxAxisOverlap(axis,delta,axesA,hA,axesB,hB);\n"
+"			if (overlap<0.f)\n"
+"				return;\n"
+"			if (overlap<0.95f*bestOverlap)\n"
+"			{\n"
+"				bestOverlap = overlap;\n"
+"				bestAxis = axis;\n"
+"				bestType = 6+i*3+j;\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"	//make the axis point from A to B\n"
+"	if (dot3F4(delta,bestAxis)<0.f)\n"
+"		bestAxis = -bestAxis;\n"
+"	float4 normalOnB = -bestAxis;\n"
+"	if (bestType>=6)\n"
+"	{\n"
+"		int i = (bestType-6)/3;\n"
+"		int j = (bestType-6)%3;\n"
+"		float4 edgeA = posA;\n"
+"		float4 edgeB = posB;\n"
+"		for (int k=0;k<3;k++)\n"
+"		{\n"
+"			if (k!=i)\n"
+"				edgeA += axesA[k]*(dot3F4(axesA[k],bestAxis)>0.f? hA[k] : -hA[k]);\n"
+"			if (k!=j)\n"
+"				edgeB += axesB[k]*(dot3F4(axesB[k],bestAxis)>0.f? -hB[k] : hB[k]);\n"
+"		}\n"
+"		//closest points between the two edge lines\n"
+"		float4 r = edgeA-edgeB;\n"
+"		float dAB = dot3F4(axesA[i],axesB[j]);\n"
+"		float e = dot3F4(axesA[i],r);\n"
+"		float f = dot3F4(axesB[j],r);\n"
+"		float denom = 1.f-dAB*dAB;\n"
+"		float s = denom>FLT_EPSILON? (dAB*f-e)/denom : 0.f;\n"
+"		s = clamp(s,-hA[i],hA[i]);\n"
+"		float t = clamp(f+s*dAB,-hB[j],hB[j]);\n"
+"		float4 pointOnB = edgeB+axesB[j]*t;\n"
+"		pointOnB.w = -bestOverlap;\n"
+"		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,&pointOnB,1,\n"
+"			globalContactsOut,nGlobalContactsOut,maxContactCapacity);\n"
+"		return;\n"
+"	}\n"
+"	bool refIsA = bestType<3;\n"
+"	int refFace = refIsA? bestType : bestType-3;\n"
+"	//reference face normal, pointing towards the incident box\n"
+"	float4 refNormal = refIsA? bestAxis : -bestAxis;\n"
+"	float4 refPos = refIsA? posA : posB;\n"
+"	float4 incPos = refIsA? posB : posA;\n"
+"	float4 refAxes[3];\n"
+"	float4 incAxes[3];\n"
+"	float refH[3];\n"
+"	float incH[3];\n"
+"	for (int k=0;k<3;k++)\n"
+"	{\n"
+"		refAxes[k] = refIsA? axesA[k] : axesB[k];\n"
+"		incAxes[k] = refIsA? axesB[k] : axesA[k];\n"
+"		refH[k] = refIsA? hA[k] : hB[k];\n"
+"		incH[k] = refIsA? hB[k] : hA[k];\n"
+"	}\n"
+"	//incident face is the face most anti-parallel to the reference normal\n"
+"	int incFace = 0;\n"
+"	float maxAbsDot = -1.f;\n"
+"	for (int k=0;k<3;k++)\n"
+"	{\n"
+"		float absDot = fabs(dot3F4(incAxes[k],refNormal));\n"
+"		if (absDot>maxAbsDot)\n"
+"		{\n"
+"			maxAbsDot = absDot;\n"
+"			incFace = k;\n"
+"		}\n"
+"	}\n"
+"	float4 incNormal = dot3F4(incAxes[incFace],refNormal)>0.f? -incAxes[incFace] : incAxes[incFace];\n"
+"	float4 incCenter = incPos+incNormal*incH[incFace];\n"
+"	int u = (incFace+1)%3;\n"
+"	int v = (incFace+2)%3;\n"
+"	float4 incU = incAxes[u]*incH[u];\n"
+"	float4 incV = incAxes[v]*incH[v];\n"
+"	float4 clipA[MAX_BOX_BOX_CLIP_POINTS];\n"
+"	float4 clipB[MAX_BOX_BOX_CLIP_POINTS];\n"
+"	clipA[0] = incCenter+incU+incV;\n"
+"	clipA[1] = incCenter-incU+incV;\n"
+"	clipA[2] = incCenter-incU-incV;\n"
+"	clipA[3] = incCenter+incU-incV;\n"
+"	int numPoints = 4;\n"
+"	//clip the incident face against the side planes of the reference face\n"
+"	int ru = (refFace+1)%3;\n"
+"	int rv = (refFace+2)%3;\n"
+"	float offsetU = dot3F4(refAxes[ru],refPos);\n"
+"	float offsetV = dot3F4(refAxes[rv],refPos);\n"
+"	numPoints = clipPolygonAgainstPlane(clipA,numPoints,refAxes[ru],offsetU+refH[ru],clipB);\n"
+"	numPoints = clipPolygonAgainstPlane(clipB,numPoints,-refAxes[ru],-offsetU+refH[ru],clipA);\n"
+"	numPoints = clipPolygonAgainstPlane(clipA,numPoints,refAxes[rv],offsetV+refH[rv],clipB);\n"
+"	numPoints = clipPolygonAgainstPlane(clipB,numPoints,-refAxes[rv],-offsetV+refH[rv],clipA);\n"
+"	float4 refCenter = refPos+refNormal*refH[refFace];\n"
+"	float4 contactPoints[MAX_BOX_BOX_CLIP_POINTS];\n"
+"	int numContacts = 0;\n"
+"	for (int k=0;k<numPoints;k++)\n"
+"	{\n"
+"		float depth = dot3F4(refNormal,clipA[k]-refCenter);\n"
+"		if (depth<=0.f)\n"
+"		{\n"
+"			//contact points are reported on B\n"
+"			float4 pointOnB = refIsA? clipA[k] : clipA[k]-refNormal*depth;\n"
+"			pointOnB.w = depth;\n"
+"			contactPoints[numContacts++] = pointOnB;\n"
+"		}\n"
+"	}\n"
+"	if (numContacts==0)\n"
+"		return;\n"
+"	int4 contactIdx = make_int4(0,1,2,3);\n"
+"	int numReducedPoints = numContacts;\n"
+"	if (numContacts>4)\n"
+"	{\n"
+"		numReducedPoints = extractManifoldSequential(contactPoints,numContacts,normalOnB,&contactIdx);\n"
+"	}\n"
+"	float4 pointsOnB[4];\n"
+"	pointsOnB[0] = contactPoints[contactIdx.x];\n"
+"	pointsOnB[1] = contactPoints[contactIdx.y];\n"
+"	pointsOnB[2] = contactPoints[contactIdx.z];\n"
+"	pointsOnB[3] = contactPoints[contactIdx.w];\n"
+"	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numReducedPoints,\n"
+"		globalContactsOut,nGlobalContactsOut,maxContactCapacity);\n"
+"}\n"
+"void computeContactPlaneBox(int pairIndex,\n"
+"							int bodyIndexA, int bodyIndexB, \n"
+"							int collidableIndexA, int collidableIndexB, \n"
+"							__global const BodyData* rigidBodies, \n"
+"							__global const btCollidableGpu* collidables,\n"
+"							__global const btGpuFace* faces,\n"
+"							__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"							counter32_t nGlobalContactsOut,\n"
+"							int maxContactCapacity)\n"
+"{\n"
+"	float4 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;\n"
+"	float4 planeNormal = make_float4(planeEq.x,planeEq.y,planeEq.z,0.f);\n"
+"	float planeConstant = planeEq.w;\n"
+"	float4 halfExtents = faces[collidables[collidableIndexB].m_shapeIndex].m_plane;\n"
+"	float4 posA = rigidBodies[bodyIndexA].m_pos;\n"
+"	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;\n"
+"	float4 posB = rigidBodies[bodyIndexB].m_pos;\n"
+"	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;\n"
+"	float4 boxInPlanePos; Quaternion boxInPlaneOrn;\n"
+"	{\n"
+"		float4 invPosA;Quaternion invOrnA;\n"
+"		trInverse(posA,ornA,&invPosA,&invOrnA);\n"
+"		trMul(invPosA,invOrnA,posB,ornB,&boxInPlanePos,&boxInPlaneOrn);\n"
+"	}\n"
+"	float4 contactPoints[8];\n"
+"	int numPoints = 0;\n"
+"	for (int i=0;i<8;i++)\n"
+"	{\n"
+"		float4 vtx = make_float4((i&1)? halfExtents.x : -halfExtents.x,\n"
+"								(i&2)? halfExtents.y : -halfExtents.y,\n"
+"								(i&4)? halfExtents.z : -halfExtents.z,0.f);\n"
+"		float4 vtxInPlane = transform(&vtx,&boxInPlanePos,&boxInPlaneOrn);\n"
+"		float dist = dot3F4(planeNormal,vtxInPlane)-planeConstant;\n"
+"		if (dist<0.f)\n"
+"		{\n"
+"			float4 vtxWorld = transform(&vtx,&posB,&ornB);\n"
+"			vtxWorld.w = dist;\n"
+"			contactPoints[numPoints++] = vtxWorld;\n"
+"		}\n"
+"	}\n"
+"	if (numPoints==0)\n"
+"		return;\n"
+"	float4 normalOnB = -qtRotate(ornA,planeNormal);\n"
+"	normalOnB.w = 0.f;\n"
+"	int4 contactIdx = make_int4(0,1,2,3);\n"
+"	int numReducedPoints = numPoints;\n"
+"	if (numPoints>4)\n"
+"	{\n"
+"		numReducedPoints = extractManifoldSequential(contactPoints,numPoints,normalOnB,&contactIdx);\n"
+"	}\n"
+"	float4 pointsOnB[4];\n"
+"	pointsOnB[0] = contactPoints[contactIdx.x];\n"
+"	pointsOnB[1] = contactPoints[contactIdx.y];\n"
+"	pointsOnB[2] = contactPoints[contactIdx.z];\n"
+"	pointsOnB[3] = contactPoints[contactIdx.w];\n"
+"	appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,normalOnB,pointsOnB,numReducedPoints,\n"
+"		globalContactsOut,nGlobalContactsOut,maxContactCapacity);\n"
+"}\n"
+"void computeContactPlaneCapsule(int pairIndex,\n"
+"								int bodyIndexA, int bodyIndexB, \n"
+"								int collidableIndexA, int collidableIndexB, \n"
+"								__global const BodyData* rigidBodies, \n"
+"								__global const btCollidableGpu* collidables,\n"
+"								__global const btGpuFace* faces,\n"
+"								__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"								counter32_t nGlobalContactsOut,\n"
+"								int maxContactCapacity)\n"
+"{\n"
+"	float4 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;\n"
+"	float4 planeNormal = make_float4(planeEq.x,planeEq.y,planeEq.z,0.f);\n"
+"	float planeConstant = planeEq.w;\n"
+"	float4 posA = rigidBodies[bodyIndexA].m_pos;\n"
+"	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;\n"
+"	float4 planeNormalWorld = qtRotate(ornA,planeNormal);\n"
+"	planeNormalWorld.w = 0.f;\n"
+"	float4 invPosA;Quaternion invOrnA;\n"
+"	trInverse(posA,ornA,&invPosA,&invOrnA);\n"
+"	float4 ends[2];\n"
+"	float radius;\n"
+"	getCapsuleSegment(collidableIndexB,collidables,faces,rigidBodies[bodyIndexB].m_pos,rigidBodies[bodyIndexB].m_quat,&ends[0],&ends[1],&radius);\n"
+"	float4 pointsOnB[2];\n"
+"	int numPoints = 0;\n"
+"	for (int i=0;i<2;i++)\n"
+"	{\n"
+"		float4 endInPlane = transform(&ends[i],&invPosA,&invOrnA);\n"
+"		float dist = dot3F4(planeNormal,endInPlane)-planeConstant-radius;\n"
+"		if (dist<0.f)\n"
+"		{\n"
+"			float4 pointOnB = ends[i]-planeNormalWorld*radius;\n"
+"			pointOnB.w = dist;\n"
+"			pointsOnB[numPoints++] = pointOnB;\n"
+"		}\n"
+"	}\n"
+"	if (numPoints)\n"
+"	{\n"
+"		appendPrimitiveContact(pairIndex,bodyIndexA,bodyIndexB,rigidBodies,-planeNormalWorld,pointsOnB,numPoints,\n"
+"			globalContactsOut,nGlobalContactsOut,maxContactCapacity);\n"
+"	}\n"
+"}\n"
 "__kernel void   primitiveContactsKernel( __global int4* pairs, \n"
 "																					__global const BodyData* rigidBodies, \n"
 "																					__global const btCollidableGpu* collidables,\n"
@@ -753,9 +1391,9 @@ static const char* primitiveContactsKernelsCL= \
 "																					__global const int* indices,\n"
 "																					__global struct b3Contact4Data* restrict globalContactsOut,\n"
 "																					counter32_t nGlobalContactsOut,\n"
-"																					int numPairs, int maxContactCapacity)\n"
+"																					int numPairs, int maxContactCapacity, int pairOffset)\n"
 "{\n"
-"	int i = get_global_id(0);\n"
+"	int i = get_global_id(0)+pairOffset;\n"
 "	int pairIndex = i;\n"
 "	\n"
 "	float4 worldVertsB1[64];\n"
@@ -896,6 +1534,57 @@ static const char* primitiveContactsKernelsCL= \
 "			}//if ( len <= (radiusA+radiusB))\n"
 "			return;\n"
 "		}//SHAPE_SPHERE SHAPE_SPHERE\n"
+"		int shapeTypeA = collidables[collidableIndexA].m_shapeType;\n"
+"		int shapeTypeB = collidables[collidableIndexB].m_shapeType;\n"
+"		if (shapeTypeA == SHAPE_BOX && shapeTypeB == SHAPE_BOX)\n"
+"		{\n"
+"			computeContactBoxBox(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
+"		if ((shapeTypeA == SHAPE_CAPSULE || shapeTypeA == SHAPE_SPHERE) && shapeTypeB == SHAPE_BOX)\n"
+"		{\n"
+"			computeContactCapsuleBox(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
+"		if (shapeTypeA == SHAPE_BOX && (shapeTypeB == SHAPE_CAPSULE || shapeTypeB == SHAPE_SPHERE))\n"
+"		{\n"
+"			computeContactCapsuleBox(pairIndex, bodyIndexB, bodyIndexA, collidableIndexB, collidableIndexA, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
+"		if ((shapeTypeA == SHAPE_CAPSULE && (shapeTypeB == SHAPE_CAPSULE || shapeTypeB == SHAPE_SPHERE)) ||\n"
+"			(shapeTypeA == SHAPE_SPHERE && shapeTypeB == SHAPE_CAPSULE))\n"
+"		{\n"
+"			computeContactCapsuleCapsule(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
+"		if (shapeTypeA == SHAPE_PLANE && shapeTypeB == SHAPE_BOX)\n"
+"		{\n"
+"			computeContactPlaneBox(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
+"		if (shapeTypeA == SHAPE_BOX && shapeTypeB == SHAPE_PLANE)\n"
+"		{\n"
+"			computeContactPlaneBox(pairIndex, bodyIndexB, bodyIndexA, collidableIndexB, collidableIndexA, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
+"		if (shapeTypeA == SHAPE_PLANE && shapeTypeB == SHAPE_CAPSULE)\n"
+"		{\n"
+"			computeContactPlaneCapsule(pairIndex, bodyIndexA, bodyIndexB, collidableIndexA, collidableIndexB, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
+"		if (shapeTypeA == SHAPE_CAPSULE && shapeTypeB == SHAPE_PLANE)\n"
+"		{\n"
+"			computeContactPlaneCapsule(pairIndex, bodyIndexB, bodyIndexA, collidableIndexB, collidableIndexA, \n"
+"																rigidBodies,collidables,faces,globalContactsOut, nGlobalContactsOut,maxContactCapacity);\n"
+"			return;\n"
+"		}\n"
 "	}//	if (i<numPairs)\n"
 "}\n"
 "// work-in-progress\n"
@@ -1242,4 +1931,175 @@ static const char* primitiveContactsKernelsCL= \
 "		return;\n"
 "	}\n"
 "}\n"
+"int computePairTypeBin(int shapeTypeA, int shapeTypeB)\n"
+"{\n"
+"	//boxes and capsules have no hull data for the SAT, compound and concave kernels\n"
+"	bool boxCapsuleA = shapeTypeA==SHAPE_BOX || shapeTypeA==SHAPE_CAPSULE;\n"
+"	bool boxCapsuleB = shapeTypeB==SHAPE_BOX || shapeTypeB==SHAPE_CAPSULE;\n"
+"	bool hullDataA = shapeTypeA==SHAPE_CONVEX_HULL || shapeTypeA==SHAPE_COMPOUND_OF_CONVEX_HULLS || shapeTypeA==SHAPE_CONCAVE_TRIMESH;\n"
+"	bool hullDataB = shapeTypeB==SHAPE_CONVEX_HULL || shapeTypeB==SHAPE_COMPOUND_OF_CONVEX_HULLS || shapeTypeB==SHAPE_CONCAVE_TRIMESH;\n"
+"	if ((boxCapsuleA && hullDataB) || (boxCapsuleB && hullDataA))\n"
+"		return PAIR_BIN_UNSUPPORTED_BOX_CAPSULE;\n"
+"	if (shapeTypeA==SHAPE_CONCAVE_TRIMESH)\n"
+"	{\n"
+"		if (shapeTypeB==SHAPE_COMPOUND_OF_CONVEX_HULLS)\n"
+"			return PAIR_BIN_CONCAVE_COMPOUND;\n"
+"		if (shapeTypeB==SHAPE_CONVEX_HULL || shapeTypeB==SHAPE_SPHERE)\n"
+"			return PAIR_BIN_CONCAVE;\n"
+"		return PAIR_BIN_UNSUPPORTED;\n"
+"	}\n"
+"	if (shapeTypeA==SHAPE_COMPOUND_OF_CONVEX_HULLS || shapeTypeB==SHAPE_COMPOUND_OF_CONVEX_HULLS)\n"
+"		return PAIR_BIN_COMPOUND;\n"
+"	if (shapeTypeA==SHAPE_CONVEX_HULL && shapeTypeB==SHAPE_CONVEX_HULL)\n"
+"		return PAIR_BIN_CONVEX_CONVEX;\n"
+"	if (shapeTypeA==SHAPE_SPHERE && shapeTypeB==SHAPE_SPHERE)\n"
+"		return PAIR_BIN_SPHERE_SPHERE;\n"
+"	if ((shapeTypeA==SHAPE_SPHERE && shapeTypeB==SHAPE_PLANE) || (shapeTypeA==SHAPE_PLANE && shapeTypeB==SHAPE_SPHERE))\n"
+"		return PAIR_BIN_SPHERE_PLANE;\n"
+"	if ((shapeTypeA==SHAPE_CONVEX_HULL && shapeTypeB==SHAPE_PLANE) || (shapeTypeA==SHAPE_PLANE && shapeTypeB==SHAPE_CONVEX_HULL))\n"
+"		return PAIR_BIN_CONVEX_PLANE;\n"
+"	if (shapeTypeA==SHAPE_PLANE && shapeTypeB==SHAPE_PLANE)\n"
+"		return PAIR_BIN_UNSUPPORTED;\n"
+"	if (shapeTypeA==SHAPE_CONCAVE_TRIMESH || shapeTypeB==SHAPE_CONCAVE_TRIMESH)\n"
+"		return PAIR_BIN_UNSUPPORTED;\n"
+"	return PAIR_BIN_PRIMITIVE;\n"
+"}\n"
+"///key is the shape type pair bin, value is the original pair index\n"
+"__kernel void   computePairTypeBinsKernel( __global const int4* pairs, \n"
+"											__global const BodyData* rigidBodies, \n"
+"											__global const btCollidableGpu* collidables,\n"
+"											__global int2* sortDataOut,\n"
+"											int numPairs)\n"
+"{\n"
+"	int i = get_global_id(0);\n"
+"	if (i>=numPairs)\n"
+"		return;\n"
+"	int collidableIndexA = rigidBodies[pairs[i].x].m_collidableIdx;\n"
+"	int collidableIndexB = rigidBodies[pairs[i].y].m_collidableIdx;\n"
+"	int2 sortData;\n"
+"	sortData.x = computePairTypeBin(collidables[collidableIndexA].m_shapeType,collidables[collidableIndexB].m_shapeType);\n"
+"	sortData.y = i;\n"
+"	sortDataOut[i] = sortData;\n"
+"}\n"
+"__kernel void   gatherPairsKernel( __global const int4* pairsIn, __global const int2* sortData, __global int4* pairsOut, int numPairs)\n"
+"{\n"
+"	int i = get_global_id(0);\n"
+"	if (i<numPairs)\n"
+"		pairsOut[i] = pairsIn[sortData[i].y];\n"
+"}\n"
+"///write back the cached contact indices (z,w) to the unsorted pair array\n"
+"__kernel void   scatterPairsKernel( __global const int4* sortedPairs, __global const int2* sortData, __global int4* pairsOut, int numPairs)\n"
+"{\n"
+"	int i = get_global_id(0);\n"
+"	if (i<numPairs)\n"
+"		pairsOut[sortData[i].y] = sortedPairs[i];\n"
+"}\n"
+"///gathers the sphere-sphere and sphere-plane bins into structure-of-arrays form,\n"
+"///so the contact kernels below only read positions and radii and don't touch bodies or collidables\n"
+"///sphereA holds the center and radius of sphere A, or the world space plane (normal, constant) for sphere-plane pairs\n"
+"__kernel void   gatherSpherePairsKernel( __global const int4* pairs, \n"
+"										__global const BodyData* rigidBodies, \n"
+"										__global const btCollidableGpu* collidables,\n"
+"										__global const btGpuFace* faces,\n"
+"										__global float4* sphereA,\n"
+"										__global float4* sphereB,\n"
+"										__global int2* signedBodies,\n"
+"										int numPairs, int pairOffset)\n"
+"{\n"
+"	int i = get_global_id(0);\n"
+"	if (i>=numPairs)\n"
+"		return;\n"
+"	int bodyIndexA = pairs[i+pairOffset].x;\n"
+"	int bodyIndexB = pairs[i+pairOffset].y;\n"
+"	if (collidables[rigidBodies[bodyIndexB].m_collidableIdx].m_shapeType==SHAPE_PLANE)\n"
+"	{\n"
+"		int tmp = bodyIndexA;\n"
+"		bodyIndexA = bodyIndexB;\n"
+"		bodyIndexB = tmp;\n"
+"	}\n"
+"	int collidableIndexA = rigidBodies[bodyIndexA].m_collidableIdx;\n"
+"	int collidableIndexB = rigidBodies[bodyIndexB].m_collidableIdx;\n"
+"	\n"
+"	float4 a = rigidBodies[bodyIndexA].m_pos;\n"
+"	a.w = collidables[collidableIndexA].m_radius;\n"
+"	if (collidables[collidableIndexA].m_shapeType==SHAPE_PLANE)\n"
+"	{\n"
+"		float4 planeEq = faces[collidables[collidableIndexA].m_shapeIndex].m_plane;\n"
+"		float4 normal = qtRotate(rigidBodies[bodyIndexA].m_quat,make_float4(planeEq.x,planeEq.y,planeEq.z,0.f));\n"
+"		a = normal;\n"
+"		a.w = planeEq.w + dot3F4(normal,rigidBodies[bodyIndexA].m_pos);\n"
+"	}\n"
+"	float4 b = rigidBodies[bodyIndexB].m_pos;\n"
+"	b.w = collidables[collidableIndexB].m_radius;\n"
+"	sphereA[i] = a;\n"
+"	sphereB[i] = b;\n"
+"	signedBodies[i] = make_int2(rigidBodies[bodyIndexA].m_invMass==0?-bodyIndexA:bodyIndexA,\n"
+"								rigidBodies[bodyIndexB].m_invMass==0?-bodyIndexB:bodyIndexB);\n"
+"}\n"
+"void writeSphereContact(__global struct b3Contact4Data* restrict globalContactsOut, counter32_t nGlobalContactsOut, int maxContactCapacity,\n"
+"						int pairIndex, int2 bodies, float4 normalOnB, float4 pointOnB)\n"
+"{\n"
+"	int dstIdx;\n"
+"	AppendInc( nGlobalContactsOut, dstIdx );\n"
+"	if (dstIdx < maxContactCapacity)\n"
+"	{\n"
+"		__global struct b3Contact4Data* c = &globalContactsOut[dstIdx];\n"
+"		c->m_worldNormalOnB = normalOnB;\n"
+"		c->m_restituitionCoeffCmp = (0.f*0xffff);c->m_frictionCoeffCmp = (0.7f*0xffff);\n"
+"		c->m_batchIdx = pairIndex;\n"
+"		c->m_bodyAPtrAndSignBit = bodies.x;\n"
+"		c->m_bodyBPtrAndSignBit = bodies.y;\n"
+"		c->m_worldPosB[0] = pointOnB;\n"
+"		c->m_childIndexA = -1;\n"
+"		c->m_childIndexB = -1;\n"
+"		GET_NPOINTS(*c) = 1;\n"
+"	}\n"
+"}\n"
+"///i runs over the gathered arrays, starting at firstPair, the pair index is pairOffset+i\n"
+"__kernel void   sphereSphereContactsKernel( __global const float4* sphereA,\n"
+"											__global const float4* sphereB,\n"
+"											__global const int2* signedBodies,\n"
+"											__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"											counter32_t nGlobalContactsOut,\n"
+"											int numPairs, int firstPair, int pairOffset, int maxContactCapacity)\n"
+"{\n"
+"	int i = get_global_id(0)+firstPair;\n"
+"	if (i>=numPairs)\n"
+"		return;\n"
+"	float4 a = sphereA[i];\n"
+"	float4 b = sphereB[i];\n"
+"	float radiusSum = a.w+b.w;\n"
+"	float4 diff = make_float4(a.x-b.x,a.y-b.y,a.z-b.z,0.f);\n"
+"	float len = length(diff);\n"
+"	if (len > radiusSum)\n"
+"		return;\n"
+"	float4 normalOnSurfaceB = make_float4(1.f,0.f,0.f,0.f);\n"
+"	if (len > 0.00001)\n"
+"	{\n"
+"		normalOnSurfaceB = diff / len;\n"
+"	}\n"
+"	float4 contactPosB = make_float4(b.x,b.y,b.z,0.f) + normalOnSurfaceB*b.w;\n"
+"	contactPosB.w = len - radiusSum;\n"
+"	writeSphereContact(globalContactsOut,nGlobalContactsOut,maxContactCapacity,pairOffset+i,signedBodies[i],normalOnSurfaceB,contactPosB);\n"
+"}\n"
+"__kernel void   spherePlaneContactsKernel( __global const float4* sphereA,\n"
+"											__global const float4* sphereB,\n"
+"											__global const int2* signedBodies,\n"
+"											__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"											counter32_t nGlobalContactsOut,\n"
+"											int numPairs, int firstPair, int pairOffset, int maxContactCapacity)\n"
+"{\n"
+"	int i = get_global_id(0)+firstPair;\n"
+"	if (i>=numPairs)\n"
+"		return;\n"
+"	float4 plane = sphereA[i];\n"
+"	float4 b = sphereB[i];\n"
+"	float4 planeNormal = make_float4(plane.x,plane.y,plane.z,0.f);\n"
+"	float distance = plane.x*b.x+plane.y*b.y+plane.z*b.z - (plane.w+b.w);\n"
+"	if (distance >= 0.f)\n"
+"		return;\n"
+"	float4 pOnB = make_float4(b.x,b.y,b.z,0.f) - planeNormal*b.w;\n"
+"	pOnB.w = distance;\n"
+"	writeSphereContact(globalContactsOut,nGlobalContactsOut,maxContactCapacity,pairOffset+i,signedBodies[i],-planeNormal,pOnB);\n"
+"}\n"
 ;
@@ -153,7 +153,12 @@ typedef struct
 	int m_vertexOffset;
 	int	m_uniqueEdgesOffset;
 	int	m_numUniqueEdges;
-	int m_unused;
+	int m_vertexAdjacencyOffset;
+
+	int m_edgeOffset;
+	int m_numEdges;
+	int m_unused0;
+	int m_unused1;
 } ConvexPolyhedronCL;
 
 typedef struct 
@@ -324,8 +329,36 @@ const float4* dir, const float4* vertices, float* min, float* max)
 	max[0] += offset;
 }
 
+//walk the vertex adjacency graph towards the support vertex of a closed convex hull
+//the first m_numVertices+1 entries at m_vertexAdjacencyOffset are the row starts into the neighbour lists
+inline float supportHillClimb(__global const ConvexPolyhedronCL* hull, const float4 localDir, __global const float4* vertices, __global const int* vertexAdjacency)
+{
+	int rowStarts = hull->m_vertexAdjacencyOffset;
+	int v = 0;
+	float best = dot3F4(vertices[hull->m_vertexOffset],localDir);
+	bool improved = true;
+	while (improved)
+	{
+		improved = false;
+		int begin = vertexAdjacency[rowStarts+v];
+		int end = vertexAdjacency[rowStarts+v+1];
+		for (int n=begin;n<end;n++)
+		{
+			int w = vertexAdjacency[n];
+			float dp = dot3F4(vertices[hull->m_vertexOffset+w],localDir);
+			if (dp>best)
+			{
+				best = dp;
+				v = w;
+				improved = true;
+			}
+		}
+	}
+	return best;
+}
+
 inline void project(__global const ConvexPolyhedronCL* hull,  const float4 pos, const float4 orn, 
-const float4* dir, __global const float4* vertices, float* min, float* max)
+const float4* dir, __global const float4* vertices, __global const int* vertexAdjacency, float* min, float* max)
 {
 	min[0] = FLT_MAX;
 	max[0] = -FLT_MAX;
@@ -333,13 +366,20 @@ const float4* dir, __global const float4* vertices, float* min, float* max)
 
 	const float4 localDir = qtInvRotate(orn,*dir);
 	float offset = dot(pos,*dir);
-	for(int i=0;i<numVerts;i++)
+	if (hull->m_vertexAdjacencyOffset>=0)
 	{
-		float dp = dot(vertices[hull->m_vertexOffset+i],localDir);
-		if(dp < min[0])	
-			min[0] = dp;
-		if(dp > max[0])	
-			max[0] = dp;
+		max[0] = supportHillClimb(hull,localDir,vertices,vertexAdjacency);
+		min[0] = -supportHillClimb(hull,-localDir,vertices,vertexAdjacency);
+	} else
+	{
+		for(int i=0;i<numVerts;i++)
+		{
+			float dp = dot(vertices[hull->m_vertexOffset+i],localDir);
+			if(dp < min[0])	
+				min[0] = dp;
+			if(dp > max[0])	
+				max[0] = dp;
+		}
 	}
 	if(min[0]>max[0])
 	{
@@ -354,12 +394,12 @@ const float4* dir, __global const float4* vertices, float* min, float* max)
 inline bool TestSepAxisLocalA(const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, 
 	const float4 posA,const float4 ornA,
 	const float4 posB,const float4 ornB,
-	float4* sep_axis, const float4* verticesA, __global const float4* verticesB,float* depth)
+	float4* sep_axis, const float4* verticesA, __global const float4* verticesB, __global const int* vertexAdjacencyB,float* depth)
 {
 	float Min0,Max0;
 	float Min1,Max1;
 	projectLocal(hullA,posA,ornA,sep_axis,verticesA, &Min0, &Max0);
-	project(hullB,posB,ornB, sep_axis,verticesB, &Min1, &Max1);
+	project(hullB,posB,ornB, sep_axis,verticesB, vertexAdjacencyB, &Min1, &Max1);
 
 	if(Max0<Min1 || Max1<Min0)
 		return false;
@@ -398,6 +438,7 @@ bool findSeparatingAxisLocalA(	const ConvexPolyhedronCL* hullA, __global const C
 	__global const float4* uniqueEdgesB, 
 	__global const btGpuFace* facesB,
 	__global const int*  indicesB,
+	__global const int* vertexAdjacencyB,
 	float4* sep,
 	float* dmin)
 {
@@ -419,7 +460,7 @@ bool findSeparatingAxisLocalA(	const ConvexPolyhedronCL* hullA, __global const C
 				faceANormalWS*=-1.f;
 			curPlaneTests++;
 			float d;
-			if(!TestSepAxisLocalA( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, verticesA, verticesB,&d))
+			if(!TestSepAxisLocalA( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, verticesA, verticesB,vertexAdjacencyB,&d))
 				return false;
 			if(d<*dmin)
 			{
@@ -445,6 +486,7 @@ bool findSeparatingAxisLocalB(	__global const ConvexPolyhedronCL* hullA,  const
 	__global const float4* uniqueEdgesA, 
 	__global const btGpuFace* facesA,
 	__global const int*  indicesA,
+	__global const int* vertexAdjacencyA,
 	const float4* verticesB,
 	const float4* uniqueEdgesB, 
 	const btGpuFace* facesB,
@@ -470,7 +512,7 @@ bool findSeparatingAxisLocalB(	__global const ConvexPolyhedronCL* hullA,  const
 				faceANormalWS *= -1.f;
 			curPlaneTests++;
 			float d;
-			if(!TestSepAxisLocalA( hullB, hullA, posB,ornB,posA,ornA, &faceANormalWS, verticesB,verticesA, &d))
+			if(!TestSepAxisLocalA( hullB, hullA, posB,ornB,posA,ornA, &faceANormalWS, verticesB,verticesA, vertexAdjacencyA, &d))
 				return false;
 			if(d<*dmin)
 			{
@@ -502,6 +544,7 @@ bool findSeparatingAxisEdgeEdgeLocalA(	const ConvexPolyhedronCL* hullA, __global
 	__global const float4* uniqueEdgesB, 
 	__global const btGpuFace* facesB,
 	__global const int*  indicesB,
+	__global const int* vertexAdjacencyB,
 		float4* sep,
 	float* dmin)
 {
@@ -542,7 +585,7 @@ bool findSeparatingAxisEdgeEdgeLocalA(	const ConvexPolyhedronCL* hullA, __global
 					float Min0,Max0;
 					float Min1,Max1;
 					projectLocal(hullA,posA,ornA,&crossje,verticesA, &Min0, &Max0);
-					project(hullB,posB,ornB,&crossje,verticesB, &Min1, &Max1);
+					project(hullB,posB,ornB,&crossje,verticesB, vertexAdjacencyB, &Min1, &Max1);
 				
 					if(Max0<Min1 || Max1<Min0)
 						result = false;
@@ -577,12 +620,12 @@ bool findSeparatingAxisEdgeEdgeLocalA(	const ConvexPolyhedronCL* hullA, __global
 inline bool TestSepAxis(__global const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, 
 	const float4 posA,const float4 ornA,
 	const float4 posB,const float4 ornB,
-	float4* sep_axis, __global const float4* vertices,float* depth)
+	float4* sep_axis, __global const float4* vertices, __global const int* vertexAdjacency,float* depth)
 {
 	float Min0,Max0;
 	float Min1,Max1;
-	project(hullA,posA,ornA,sep_axis,vertices, &Min0, &Max0);
-	project(hullB,posB,ornB, sep_axis,vertices, &Min1, &Max1);
+	project(hullA,posA,ornA,sep_axis,vertices, vertexAdjacency, &Min0, &Max0);
+	project(hullB,posB,ornB, sep_axis,vertices, vertexAdjacency, &Min1, &Max1);
 
 	if(Max0<Min1 || Max1<Min0)
 		return false;
@@ -604,6 +647,7 @@ bool findSeparatingAxis(	__global const ConvexPolyhedronCL* hullA, __global cons
 	__global const float4* uniqueEdges, 
 	__global const btGpuFace* faces,
 	__global const int*  indices,
+	__global const int* vertexAdjacency,
 	float4* sep,
 	float* dmin)
 {
@@ -630,7 +674,7 @@ bool findSeparatingAxis(	__global const ConvexPolyhedronCL* hullA, __global cons
 			curPlaneTests++;
 	
 			float d;
-			if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, vertices,&d))
+			if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, vertices,vertexAdjacency,&d))
 				return false;
 	
 			if(d<*dmin)
@@ -653,6 +697,82 @@ bool findSeparatingAxis(	__global const ConvexPolyhedronCL* hullA, __global cons
 
 
 
+//edge pairs only build a face of the Minkowski difference if the Gauss map arcs of both edges intersect
+//a,b are the face normals adjacent to the edge of A, c,d the negated face normals adjacent to the edge of B
+inline bool isMinkowskiFace(const float4 a, const float4 b, const float4 bxa, const float4 c, const float4 d, const float4 dxc)
+{
+	float cba = dot3F4(c,bxa);
+	float dba = dot3F4(d,bxa);
+	float adc = dot3F4(a,dxc);
+	float bdc = dot3F4(b,dxc);
+	return cba*dba<0.f && adc*bdc<0.f && cba*bdc>0.f;
+}
+
+//only edge pairs that pass the Gauss map test are candidate axes
+//the arc test runs in the local space of hullA, so the normals of hullA are used without rotation
+bool findSeparatingAxisEdgeEdgeGaussMap(	__global const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, 
+	const float4 posA,
+	const float4 ornA,
+	const float4 posB,
+	const float4 ornB,
+	const float4 DeltaC2,
+	__global const float4* vertices, 
+	__global const btGpuFace* faces,
+	__global const int* vertexAdjacency,
+	__global const int4* hullEdges,
+	float4* sep,
+	float* dmin)
+{
+	float4 ornBinA = qtMul(qtInvert(ornA),ornB);
+
+	for(int e1=0;e1<hullB->m_numEdges;e1++)
+	{
+		int4 edgeB = hullEdges[hullB->m_edgeOffset+e1];
+		float4 c = -qtRotate(ornBinA,faces[hullB->m_faceOffset+edgeB.z].m_plane);
+		float4 d = -qtRotate(ornBinA,faces[hullB->m_faceOffset+edgeB.w].m_plane);
+		float4 dxc = cross3(d,c);
+		float4 edge1 = qtRotate(ornBinA,vertices[hullB->m_vertexOffset+edgeB.y]-vertices[hullB->m_vertexOffset+edgeB.x]);
+
+		for(int e0=0;e0<hullA->m_numEdges;e0++)
+		{
+			int4 edgeA = hullEdges[hullA->m_edgeOffset+e0];
+			float4 a = faces[hullA->m_faceOffset+edgeA.z].m_plane;
+			float4 b = faces[hullA->m_faceOffset+edgeA.w].m_plane;
+			a.w = 0.f;
+			b.w = 0.f;
+			if (!isMinkowskiFace(a,b,cross3(b,a),c,d,dxc))
+				continue;
+
+			float4 edge0 = vertices[hullA->m_vertexOffset+edgeA.y]-vertices[hullA->m_vertexOffset+edgeA.x];
+			edge0.w = 0.f;
+			float4 crossje = cross3(edge0,edge1);
+			//skip nearly parallel edges, the face normals cover them
+			if (dot3F4(crossje,crossje) < 0.005f*0.005f*dot3F4(edge0,edge0)*dot3F4(edge1,edge1))
+				continue;
+
+			crossje = normalize3(qtRotate(ornA,crossje));
+			if (dot3F4(DeltaC2,crossje)<0)
+				crossje *= -1.f;
+
+			float dist;
+			if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,&crossje, vertices,vertexAdjacency,&dist))
+				return false;
+
+			if(dist<*dmin)
+			{
+				*dmin = dist;
+				*sep = crossje;
+			}
+		}
+	}
+
+	if((dot3F4(-DeltaC2,*sep))>0.0f)
+	{
+		*sep = -(*sep);
+	}
+	return true;
+}
+
 bool findSeparatingAxisEdgeEdge(	__global const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, 
 	const float4 posA1,
 	const float4 ornA,
@@ -663,6 +783,8 @@ bool findSeparatingAxisEdgeEdge(	__global const ConvexPolyhedronCL* hullA, __glo
 	__global const float4* uniqueEdges, 
 	__global const btGpuFace* faces,
 	__global const int*  indices,
+	__global const int* vertexAdjacency,
+	__global const int4* hullEdges,
 	float4* sep,
 	float* dmin)
 {
@@ -673,6 +795,11 @@ bool findSeparatingAxisEdgeEdge(	__global const ConvexPolyhedronCL* hullA, __glo
 	float4 posB = posB1;
 	posB.w = 0.f;
 
+	if (hullA->m_numEdges && hullB->m_numEdges)
+	{
+		return findSeparatingAxisEdgeEdgeGaussMap(hullA,hullB,posA,ornA,posB,ornB,DeltaC2,vertices,faces,vertexAdjacency,hullEdges,sep,dmin);
+	}
+
 	int curPlaneTests=0;
 
 	int curEdgeEdge = 0;
@@ -702,8 +829,8 @@ bool findSeparatingAxisEdgeEdge(	__global const ConvexPolyhedronCL* hullA, __glo
 				{
 					float Min0,Max0;
 					float Min1,Max1;
-					project(hullA,posA,ornA,&crossje,vertices, &Min0, &Max0);
-					project(hullB,posB,ornB,&crossje,vertices, &Min1, &Max1);
+					project(hullA,posA,ornA,&crossje,vertices, vertexAdjacency, &Min0, &Max0);
+					project(hullB,posB,ornB,&crossje,vertices, vertexAdjacency, &Min1, &Max1);
 				
 					if(Max0<Min1 || Max1<Min0)
 						result = false;
@@ -744,6 +871,8 @@ __kernel void   processCompoundPairsKernel( __global const int4* gpuCompoundPair
 																					__global const float4* uniqueEdges,
 																					__global const btGpuFace* faces,
 																					__global const int* indices,
+																					__global const int* vertexAdjacency,
+																					__global const int4* hullEdges,
 																					__global btAabbCL* aabbs,
 																					__global const btGpuChildShape* gpuChildShapes,
 																					__global volatile float4* gpuCompoundSepNormalsOut,
@@ -824,21 +953,21 @@ __kernel void   processCompoundPairsKernel( __global const int4* gpuCompoundPair
 		float4 c1 = transform(&c1local,&posB,&ornB);
 		const float4 DeltaC2 = c0 - c1;
 		float4 sepNormal = make_float4(1,0,0,0);
-		bool sepA = findSeparatingAxis(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,&sepNormal,&dmin);
+		bool sepA = findSeparatingAxis(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,vertexAdjacency,&sepNormal,&dmin);
 		hasSeparatingAxis = 4;
 		if (!sepA)
 		{
 			hasSeparatingAxis = 0;
 		} else
 		{
-			bool sepB = findSeparatingAxis(	&convexShapes[shapeIndexB],&convexShapes[shapeIndexA],posB,ornB,posA,ornA,DeltaC2,vertices,uniqueEdges,faces,indices,&sepNormal,&dmin);
+			bool sepB = findSeparatingAxis(	&convexShapes[shapeIndexB],&convexShapes[shapeIndexA],posB,ornB,posA,ornA,DeltaC2,vertices,uniqueEdges,faces,indices,vertexAdjacency,&sepNormal,&dmin);
 
 			if (!sepB)
 			{
 				hasSeparatingAxis = 0;
 			} else//(!sepB)
 			{
-				bool sepEE = findSeparatingAxisEdgeEdge(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,&sepNormal,&dmin);
+				bool sepEE = findSeparatingAxisEdgeEdge(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,vertexAdjacency,hullEdges,&sepNormal,&dmin);
 				if (sepEE)
 				{
 						gpuCompoundSepNormalsOut[i] = sepNormal;//fastNormalize4(sepNormal);
@@ -897,11 +1026,12 @@ __kernel void   findCompoundPairsKernel( __global const int4* pairs,
 	__global const b3QuantizedBvhNode* quantizedNodes,
 	__global const b3BvhInfo* bvhInfos,
 	int numPairs,
-	int maxNumCompoundPairsCapacity
+	int maxNumCompoundPairsCapacity,
+	int pairOffset
 	)
 {
 
-	int i = get_global_id(0);
+	int i = get_global_id(0)+pairOffset;
 
 	if (i<numPairs)
 	{
@@ -1248,18 +1378,26 @@ __kernel void   findSeparatingAxisKernel( __global const int4* pairs,
 																					__global const float4* uniqueEdges,
 																					__global const btGpuFace* faces,
 																					__global const int* indices,
+																					__global const int* vertexAdjacency,
+																					__global const int4* hullEdges,
 																					__global btAabbCL* aabbs,
 																					__global volatile float4* separatingNormals,
 																					__global volatile int* hasSeparatingAxis,
-																					int numPairs
+																					int numPairs,
+																					int pairOffset
 																					)
 {
 
-	int i = get_global_id(0);
+	int i = get_global_id(0)+pairOffset;
 	
 	if (i<numPairs)
 	{
-
+		//the contacts of this pair were re-projected from the manifold cache
+		if (hasSeparatingAxis[i]==-1)
+		{
+			hasSeparatingAxis[i] = 0;
+			return;
+		}
 	
 		int bodyIndexA = pairs[i].x;
 		int bodyIndexB = pairs[i].y;
@@ -1312,7 +1450,7 @@ __kernel void   findSeparatingAxisKernel( __global const int4* pairs,
 																								posB,ornB,
 																								DeltaC2,
 																								vertices,uniqueEdges,faces,
-																								indices,&sepNormal,&dmin);
+																								indices,vertexAdjacency,&sepNormal,&dmin);
 		hasSeparatingAxis[i] = 4;
 		if (!sepA)
 		{
@@ -1323,7 +1461,7 @@ __kernel void   findSeparatingAxisKernel( __global const int4* pairs,
 																									posA,ornA,
 																									DeltaC2,
 																									vertices,uniqueEdges,faces,
-																									indices,&sepNormal,&dmin);
+																									indices,vertexAdjacency,&sepNormal,&dmin);
 
 			if (!sepB)
 			{
@@ -1334,7 +1472,7 @@ __kernel void   findSeparatingAxisKernel( __global const int4* pairs,
 																									posB,ornB,
 																									DeltaC2,
 																									vertices,uniqueEdges,faces,
-																									indices,&sepNormal,&dmin);
+																									indices,vertexAdjacency,hullEdges,&sepNormal,&dmin);
 				if (!sepEE)
 				{
 					hasSeparatingAxis[i] = 0;
@@ -1362,6 +1500,7 @@ __kernel void   findConcaveSeparatingAxisKernel( __global int4* concavePairs,
 																					__global const float4* uniqueEdges,
 																					__global const btGpuFace* faces,
 																					__global const int* indices,
+																					__global const int* vertexAdjacency,
 																					__global const btGpuChildShape* gpuChildShapes,
 																					__global btAabbCL* aabbs,
 																					__global float4* concaveSeparatingNormalsOut,
@@ -1404,6 +1543,9 @@ __kernel void   findConcaveSeparatingAxisKernel( __global int4* concavePairs,
 	//add 3 vertices of the triangle
 	convexPolyhedronA.m_numVertices = 3;
 	convexPolyhedronA.m_vertexOffset = 0;
+	convexPolyhedronA.m_vertexAdjacencyOffset = -1;
+	convexPolyhedronA.m_edgeOffset = 0;
+	convexPolyhedronA.m_numEdges = 0;
 	float4	localCenter = make_float4(0.f,0.f,0.f,0.f);
 
 	btGpuFace face = faces[convexShapes[shapeIndexA].m_faceOffset+f];
@@ -1561,7 +1703,7 @@ __kernel void   findConcaveSeparatingAxisKernel( __global int4* concavePairs,
 												posB,ornB,
 												DeltaC2,
 												verticesA,uniqueEdgesA,facesA,indicesA,
-												vertices,uniqueEdges,faces,indices,
+												vertices,uniqueEdges,faces,indices,vertexAdjacency,
 												&sepAxis,&dmin);
 		hasSeparatingAxis = 4;
 		if (!sepA)
@@ -1573,7 +1715,7 @@ __kernel void   findConcaveSeparatingAxisKernel( __global int4* concavePairs,
 												posB,ornB,
 												posA,ornA,
 												DeltaC2,
-												vertices,uniqueEdges,faces,indices,
+												vertices,uniqueEdges,faces,indices,vertexAdjacency,
 												verticesA,uniqueEdgesA,facesA,indicesA,
 												&sepAxis,&dmin);
 
@@ -1587,7 +1729,7 @@ __kernel void   findConcaveSeparatingAxisKernel( __global int4* concavePairs,
 															posB,ornB,
 															DeltaC2,
 															verticesA,uniqueEdgesA,facesA,indicesA,
-															vertices,uniqueEdges,faces,indices,
+															vertices,uniqueEdges,faces,indices,vertexAdjacency,
 															&sepAxis,&dmin);
 	
 				if (!sepEE)
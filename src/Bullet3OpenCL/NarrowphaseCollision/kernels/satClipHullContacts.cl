@@ -42,6 +42,7 @@ typedef unsigned int u32;
 
 
 #include "Bullet3Collision/NarrowPhaseCollision/shared/b3Contact4Data.h"
+#include "Bullet3Collision/NarrowPhaseCollision/shared/b3ContactManifoldCacheData.h"
 
 
 ///keep this in sync with btCollidable.h
@@ -95,7 +96,12 @@ typedef struct
 	int m_vertexOffset;
 	int	m_uniqueEdgesOffset;
 	int	m_numUniqueEdges;
-	int m_unused;
+	int m_vertexAdjacencyOffset;
+
+	int m_edgeOffset;
+	int m_numEdges;
+	int m_unused0;
+	int m_unused1;
 
 } ConvexPolyhedronCL;
 
@@ -1305,6 +1311,9 @@ __kernel void   clipHullHullConcaveConvexKernel( __global int4* concavePairsIn,
 	//add 3 vertices of the triangle
 		convexPolyhedronA.m_numVertices = 3;
 		convexPolyhedronA.m_vertexOffset = 0;
+		convexPolyhedronA.m_vertexAdjacencyOffset = -1;
+		convexPolyhedronA.m_edgeOffset = 0;
+		convexPolyhedronA.m_numEdges = 0;
 		float4	localCenter = make_float4(0.f,0.f,0.f,0.f);
 
 		btGpuFace face = faces[convexShapes[shapeIndexA].m_faceOffset+f];
@@ -1929,3 +1938,191 @@ __kernel void   newContactReductionKernel( __global int4* pairs,
     
     
 }
+
+
+
+unsigned int manifoldCacheKey(int bodyIndexA, int bodyIndexB)
+{
+	return (((unsigned int)bodyIndexA)<<16) ^ ((unsigned int)bodyIndexB);
+}
+
+///re-project the manifold of the previous frame when the relative transform of the pair barely changed.
+///cachedKeys is sorted on manifoldCacheKey, .y is the index into cachedManifolds
+__kernel void   findCachedManifoldsKernel( __global int4* pairs,
+																					__global const BodyData* rigidBodies,
+																					__global const b3ContactManifoldCacheData_t* cachedManifolds,
+																					__global const int2* cachedKeys,
+																					int numCachedManifolds,
+																					__global int* cacheSource,
+																					__global volatile int* hasSeparatingAxis,
+																					__global struct b3Contact4Data* restrict globalContactsOut,
+																					counter32_t nGlobalContactsOut,
+																					int contactCapacity,
+																					float linearThreshold,
+																					float cosHalfAngularThreshold,
+																					float contactBreakingThreshold,
+																					int numPairs,
+																					int pairOffset)
+{
+	int i = get_global_id(0)+pairOffset;
+	if (i>=numPairs)
+		return;
+
+	cacheSource[i] = -1;
+
+	int bodyIndexA = pairs[i].x;
+	int bodyIndexB = pairs[i].y;
+
+	if ((rigidBodies[bodyIndexA].m_invMass==0) &&(rigidBodies[bodyIndexB].m_invMass==0))
+		return;
+
+	unsigned int key = manifoldCacheKey(bodyIndexA,bodyIndexB);
+	int lo = 0;
+	int hi = numCachedManifolds;
+	while (lo<hi)
+	{
+		int mid = (lo+hi)>>1;
+		if ((unsigned int)cachedKeys[mid].x < key)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	int manifoldIndex = -1;
+	for (;lo<numCachedManifolds && (unsigned int)cachedKeys[lo].x==key;lo++)
+	{
+		int m = cachedKeys[lo].y;
+		if (cachedManifolds[m].m_bodyA==bodyIndexA && cachedManifolds[m].m_bodyB==bodyIndexB)
+		{
+			manifoldIndex = m;
+			break;
+		}
+	}
+	if (manifoldIndex<0)
+		return;
+
+	float4 posA = rigidBodies[bodyIndexA].m_pos;
+	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;
+	float4 posB = rigidBodies[bodyIndexB].m_pos;
+	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;
+
+	float4 invPosA;
+	Quaternion invOrnA;
+	trInverse(posA,ornA,&invPosA,&invOrnA);
+	float4 relPos;
+	Quaternion relOrn;
+	trMul(invPosA,invOrnA,posB,ornB,&relPos,&relOrn);
+
+	float4 dPos = relPos-cachedManifolds[manifoldIndex].m_relPos;
+	dPos.w = 0.f;
+	if (dot(dPos,dPos) > linearThreshold*linearThreshold)
+		return;
+	if (fabs(dot(relOrn,cachedManifolds[manifoldIndex].m_relOrn)) < cosHalfAngularThreshold)
+		return;
+
+	float4 localNormal = cachedManifolds[manifoldIndex].m_localNormalOnA;
+	int nPoints = (int)localNormal.w;
+	localNormal.w = 0.f;
+	float4 normal = qtRotate(ornA,localNormal);
+
+	float4 pointsOnB[4];
+	for (int p=0;p<nPoints;p++)
+	{
+		float4 localA = cachedManifolds[manifoldIndex].m_localPointsA[p];
+		float4 localB = cachedManifolds[manifoldIndex].m_localPointsB[p];
+		float4 pA = transform(&localA,&posA,&ornA);
+		float4 pB = transform(&localB,&posB,&ornB);
+		float dist = dot3F4(pA-pB,normal);
+		//a point moved out of the breaking threshold, let the clipper build a new manifold
+		if (dist > contactBreakingThreshold)
+			return;
+		pB.w = dist;
+		pointsOnB[p] = pB;
+	}
+
+	int dstIdx;
+	AppendInc( nGlobalContactsOut, dstIdx );
+	if (dstIdx<contactCapacity)
+	{
+		pairs[i].z = dstIdx;
+		__global struct b3Contact4Data* c = globalContactsOut+ dstIdx;
+		c->m_worldNormalOnB = normal;
+		c->m_restituitionCoeffCmp = (0.f*0xffff);c->m_frictionCoeffCmp = (0.7f*0xffff);
+		c->m_batchIdx = i;
+		c->m_bodyAPtrAndSignBit = rigidBodies[bodyIndexA].m_invMass==0?-bodyIndexA:bodyIndexA;
+		c->m_bodyBPtrAndSignBit = rigidBodies[bodyIndexB].m_invMass==0?-bodyIndexB:bodyIndexB;
+		c->m_childIndexA = -1;
+		c->m_childIndexB = -1;
+		for (int p=0;p<nPoints;p++)
+		{
+			c->m_worldPosB[p] = pointsOnB[p];
+		}
+		GET_NPOINTS(*c) = nPoints;
+
+		cacheSource[i] = manifoldIndex;
+		hasSeparatingAxis[i] = -1;
+	}
+}
+
+///store the convex-convex contacts of this frame in the manifold cache of the next frame.
+///reused contacts keep the relative transform of the frame they were clipped in, so the drift can't accumulate
+__kernel void   storeCachedManifoldsKernel( __global const struct b3Contact4Data* contacts,
+																					__global const BodyData* rigidBodies,
+																					__global const b3ContactManifoldCacheData_t* cachedManifolds,
+																					__global const int* cacheSource,
+																					__global b3ContactManifoldCacheData_t* newManifolds,
+																					__global int2* newKeys,
+																					int firstContact,
+																					int numContacts,
+																					int firstManifold,
+																					int reused)
+{
+	int i = get_global_id(0);
+	if (i>=numContacts)
+		return;
+
+	__global const struct b3Contact4Data* c = &contacts[firstContact+i];
+	int m = firstManifold+i;
+	int bodyIndexA = abs(c->m_bodyAPtrAndSignBit);
+	int bodyIndexB = abs(c->m_bodyBPtrAndSignBit);
+
+	if (reused)
+	{
+		newManifolds[m] = cachedManifolds[cacheSource[c->m_batchIdx]];
+	} else
+	{
+		float4 posA = rigidBodies[bodyIndexA].m_pos;
+		Quaternion ornA = rigidBodies[bodyIndexA].m_quat;
+		float4 posB = rigidBodies[bodyIndexB].m_pos;
+		Quaternion ornB = rigidBodies[bodyIndexB].m_quat;
+
+		float4 invPosA,invPosB;
+		Quaternion invOrnA,invOrnB;
+		trInverse(posA,ornA,&invPosA,&invOrnA);
+		trInverse(posB,ornB,&invPosB,&invOrnB);
+		float4 relPos;
+		Quaternion relOrn;
+		trMul(invPosA,invOrnA,posB,ornB,&relPos,&relOrn);
+
+		float4 normal = c->m_worldNormalOnB;
+		int nPoints = (int)normal.w;
+		normal.w = 0.f;
+
+		newManifolds[m].m_relPos = relPos;
+		newManifolds[m].m_relOrn = relOrn;
+		float4 localNormal = qtRotate(invOrnA,normal);
+		localNormal.w = (float)nPoints;
+		newManifolds[m].m_localNormalOnA = localNormal;
+		for (int p=0;p<nPoints;p++)
+		{
+			float4 pB = c->m_worldPosB[p];
+			float4 pA = pB+normal*pB.w;
+			pA.w = 0.f;
+			pB.w = 0.f;
+			newManifolds[m].m_localPointsA[p] = transform(&pA,&invPosA,&invOrnA);
+			newManifolds[m].m_localPointsB[p] = transform(&pB,&invPosB,&invOrnB);
+		}
+		newManifolds[m].m_bodyA = bodyIndexA;
+		newManifolds[m].m_bodyB = bodyIndexB;
+	}
+	newKeys[m] = make_int2((int)manifoldCacheKey(bodyIndexA,bodyIndexB),m);
+}
@@ -92,6 +92,29 @@ static const char* satClipKernelsCL= \
 "	contact->m_worldNormalOnB.w = (float)numPoints;\n"
 "};\n"
 "#endif //B3_CONTACT4DATA_H\n"
+"#ifndef B3_CONTACT_MANIFOLD_CACHE_DATA_H\n"
+"#define B3_CONTACT_MANIFOLD_CACHE_DATA_H\n"
+"#ifndef B3_FLOAT4_H\n"
+"#ifdef __cplusplus\n"
+"#else\n"
+"#endif \n"
+"#endif //B3_FLOAT4_H\n"
+"typedef struct b3ContactManifoldCacheData b3ContactManifoldCacheData_t;\n"
+"///convex-convex manifold as generated by the clipping stage, stored in the local frames of both bodies\n"
+"///so it can be re-projected while the relative transform of the pair stays (almost) the same\n"
+"struct b3ContactManifoldCacheData\n"
+"{\n"
+"	b3Float4	m_relPos;//position of B in the frame of A when the manifold was clipped\n"
+"	b3Float4	m_relOrn;//orientation of B in the frame of A\n"
+"	b3Float4	m_localNormalOnA;//w: number of points\n"
+"	b3Float4	m_localPointsA[4];\n"
+"	b3Float4	m_localPointsB[4];\n"
+"	int			m_bodyA;\n"
+"	int			m_bodyB;\n"
+"	int			m_unused0;\n"
+"	int			m_unused1;\n"
+"};\n"
+"#endif //B3_CONTACT_MANIFOLD_CACHE_DATA_H\n"
 "///keep this in sync with btCollidable.h\n"
 "typedef struct\n"
 "{\n"
@@ -137,7 +160,11 @@ static const char* satClipKernelsCL= \
 "	int m_vertexOffset;\n"
 "	int	m_uniqueEdgesOffset;\n"
 "	int	m_numUniqueEdges;\n"
-"	int m_unused;\n"
+"	int m_vertexAdjacencyOffset;\n"
+"	int m_edgeOffset;\n"
+"	int m_numEdges;\n"
+"	int m_unused0;\n"
+"	int m_unused1;\n"
 "} ConvexPolyhedronCL;\n"
 "typedef struct\n"
 "{\n"
@@ -622,8 +649,10 @@ static const char* satClipKernelsCL= \
 "}\n"
 "#define PARALLEL_SUM(v, n) for(int j=1; j<n; j++) v[0] += v[j];\n"
 "#define PARALLEL_DO(execution, n) for(int ie=0; ie<n; ie++){execution;}\n"
-"#define REDUCE_MAX(v, n) {int i=0; for(int offset=0; offset<n; offset++) v[i] = (v[i].y > v[i+offset].y)? v[i]: v[i+offset]; }\n"
-"#define REDUCE_MIN(v, n) {int i=0; for(int offset=0; offset<n; offset++) v[i] = (v[i].y < v[i+offset].y)? v[i]: v[i+offset]; }\n"
+"#define REDUCE_MAX(v, n) {int i=0;\\n"
+"for(int offset=0; offset<n; offset++) v[i] = (v[i].y > v[i+offset].y)? v[i]: v[i+offset]; }\n"
+"#define REDUCE_MIN(v, n) {int i=0;\\n"
+"for(int offset=0; offset<n; offset++) v[i] = (v[i].y < v[i+offset].y)? v[i]: v[i+offset]; }\n"
 "int extractManifoldSequentialGlobal(__global const float4* p, int nPoints, float4 nearNormal, int4* contactIdx)\n"
 "{\n"
 "	if( nPoints == 0 )\n"
@@ -1195,6 +1224,9 @@ static const char* satClipKernelsCL= \
 "	//add 3 vertices of the triangle\n"
 "		convexPolyhedronA.m_numVertices = 3;\n"
 "		convexPolyhedronA.m_vertexOffset = 0;\n"
+"		convexPolyhedronA.m_vertexAdjacencyOffset = -1;\n"
+"		convexPolyhedronA.m_edgeOffset = 0;\n"
+"		convexPolyhedronA.m_numEdges = 0;\n"
 "		float4	localCenter = make_float4(0.f,0.f,0.f,0.f);\n"
 "		btGpuFace face = faces[convexShapes[shapeIndexA].m_faceOffset+f];\n"
 "		\n"
@@ -1770,4 +1802,171 @@ static const char* satClipKernelsCL= \
 "    \n"
 "    \n"
 "}\n"
+"unsigned int manifoldCacheKey(int bodyIndexA, int bodyIndexB)\n"
+"{\n"
+"	return (((unsigned int)bodyIndexA)<<16) ^ ((unsigned int)bodyIndexB);\n"
+"}\n"
+"///re-project the manifold of the previous frame when the relative transform of the pair barely changed.\n"
+"///cachedKeys is sorted on manifoldCacheKey, .y is the index into cachedManifolds\n"
+"__kernel void   findCachedManifoldsKernel( __global int4* pairs,\n"
+"																					__global const BodyData* rigidBodies,\n"
+"																					__global const b3ContactManifoldCacheData_t* cachedManifolds,\n"
+"																					__global const int2* cachedKeys,\n"
+"																					int numCachedManifolds,\n"
+"																					__global int* cacheSource,\n"
+"																					__global volatile int* hasSeparatingAxis,\n"
+"																					__global struct b3Contact4Data* restrict globalContactsOut,\n"
+"																					counter32_t nGlobalContactsOut,\n"
+"																					int contactCapacity,\n"
+"																					float linearThreshold,\n"
+"																					float cosHalfAngularThreshold,\n"
+"																					float contactBreakingThreshold,\n"
+"																					int numPairs,\n"
+"																					int pairOffset)\n"
+"{\n"
+"	int i = get_global_id(0)+pairOffset;\n"
+"	if (i>=numPairs)\n"
+"		return;\n"
+"	cacheSource[i] = -1;\n"
+"	int bodyIndexA = pairs[i].x;\n"
+"	int bodyIndexB = pairs[i].y;\n"
+"	if ((rigidBodies[bodyIndexA].m_invMass==0) &&(rigidBodies[bodyIndexB].m_invMass==0))\n"
+"		return;\n"
+"	unsigned int key = manifoldCacheKey(bodyIndexA,bodyIndexB);\n"
+"	int lo = 0;\n"
+"	int hi = numCachedManifolds;\n"
+"	while (lo<hi)\n"
+"	{\n"
+"		int mid = (lo+hi)>>1;\n"
+"		if ((unsigned int)cachedKeys[mid].x < key)\n"
+"			lo = mid+1;\n"
+"		else\n"
+"			hi = mid;\n"
+"	}\n"
+"	int manifoldIndex = -1;\n"
+"	for (;lo<numCachedManifolds && (unsigned int)cachedKeys[lo].x==key;lo++)\n"
+"	{\n"
+"		int m = cachedKeys[lo].y;\n"
+"		if (cachedManifolds[m].m_bodyA==bodyIndexA && cachedManifolds[m].m_bodyB==bodyIndexB)\n"
+"		{\n"
+"			manifoldIndex = m;\n"
+"			break;\n"
+"		}\n"
+"	}\n"
+"	if (manifoldIndex<0)\n"
+"		return;\n"
+"	float4 posA = rigidBodies[bodyIndexA].m_pos;\n"
+"	Quaternion ornA = rigidBodies[bodyIndexA].m_quat;\n"
+"	float4 posB = rigidBodies[bodyIndexB].m_pos;\n"
+"	Quaternion ornB = rigidBodies[bodyIndexB].m_quat;\n"
+"	float4 invPosA;\n"
+"	Quaternion invOrnA;\n"
+"	trInverse(posA,ornA,&invPosA,&invOrnA);\n"
+"	float4 relPos;\n"
+"	Quaternion relOrn;\n"
+"	trMul(invPosA,invOrnA,posB,ornB,&relPos,&relOrn);\n"
+"	float4 dPos = relPos-cachedManifolds[manifoldIndex].m_relPos;\n"
+"	dPos.w = 0.f;\n"
+"	if (dot(dPos,dPos) > linearThreshold*linearThreshold)\n"
+"		return;\n"
+"	if (fabs(dot(relOrn,cachedManifolds[manifoldIndex].m_relOrn)) < cosHalfAngularThreshold)\n"
+"		return;\n"
+"	float4 localNormal = cachedManifolds[manifoldIndex].m_localNormalOnA;\n"
+"	int nPoints = (int)localNormal.w;\n"
+"	localNormal.w = 0.f;\n"
+"	float4 normal = qtRotate(ornA,localNormal);\n"
+"	float4 pointsOnB[4];\n"
+"	for (int p=0;p<nPoints;p++)\n"
+"	{\n"
+"		float4 localA = cachedManifolds[manifoldIndex].m_localPointsA[p];\n"
+"		float4 localB = cachedManifolds[manifoldIndex].m_localPointsB[p];\n"
+"		float4 pA = transform(&localA,&posA,&ornA);\n"
+"		float4 pB = transform(&localB,&posB,&ornB);\n"
+"		float dist = dot3F4(pA-pB,normal);\n"
+"		//a point moved out of the breaking threshold, let the clipper build a new manifold\n"
+"		if (dist > contactBreakingThreshold)\n"
+"			return;\n"
+"		pB.w = dist;\n"
+"		pointsOnB[p] = pB;\n"
+"	}\n"
+"	int dstIdx;\n"
+"	AppendInc( nGlobalContactsOut, dstIdx );\n"
+"	if (dstIdx<contactCapacity)\n"
+"	{\n"
+"		pairs[i].z = dstIdx;\n"
+"		__global struct b3Contact4Data* c = globalContactsOut+ dstIdx;\n"
+"		c->m_worldNormalOnB = normal;\n"
+"		c->m_restituitionCoeffCmp = (0.f*0xffff);c->m_frictionCoeffCmp = (0.7f*0xffff);\n"
+"		c->m_batchIdx = i;\n"
+"		c->m_bodyAPtrAndSignBit = rigidBodies[bodyIndexA].m_invMass==0?-bodyIndexA:bodyIndexA;\n"
+"		c->m_bodyBPtrAndSignBit = rigidBodies[bodyIndexB].m_invMass==0?-bodyIndexB:bodyIndexB;\n"
+"		c->m_childIndexA = -1;\n"
+"		c->m_childIndexB = -1;\n"
+"		for (int p=0;p<nPoints;p++)\n"
+"		{\n"
+"			c->m_worldPosB[p] = pointsOnB[p];\n"
+"		}\n"
+"		GET_NPOINTS(*c) = nPoints;\n"
+"		cacheSource[i] = manifoldIndex;\n"
+"		hasSeparatingAxis[i] = -1;\n"
+"	}\n"
+"}\n"
+"///store the convex-convex contacts of this frame in the manifold cache of the next frame.\n"
+"///reused contacts keep the relative transform of the frame they were clipped in, so the drift can't accumulate\n"
+"__kernel void   storeCachedManifoldsKernel( __global const struct b3Contact4Data* contacts,\n"
+"																					__global const BodyData* rigidBodies,\n"
+"																					__global const b3ContactManifoldCacheData_t* cachedManifolds,\n"
+"																					__global const int* cacheSource,\n"
+"																					__global b3ContactManifoldCacheData_t* newManifolds,\n"
+"																					__global int2* newKeys,\n"
+"																					int firstContact,\n"
+"																					int numContacts,\n"
+"																					int firstManifold,\n"
+"																					int reused)\n"
+"{\n"
+"	int i = get_global_id(0);\n"
+"	if (i>=numContacts)\n"
+"		return;\n"
+"	__global const struct b3Contact4Data* c = &contacts[firstContact+i];\n"
+"	int m = firstManifold+i;\n"
+"	int bodyIndexA = abs(c->m_bodyAPtrAndSignBit);\n"
+"	int bodyIndexB = abs(c->m_bodyBPtrAndSignBit);\n"
+"	if (reused)\n"
+"	{\n"
+"		newManifolds[m] = cachedManifolds[cacheSource[c->m_batchIdx]];\n"
+"	} else\n"
+"	{\n"
+"		float4 posA = rigidBodies[bodyIndexA].m_pos;\n"
+"		Quaternion ornA = rigidBodies[bodyIndexA].m_quat;\n"
+"		float4 posB = rigidBodies[bodyIndexB].m_pos;\n"
+"		Quaternion ornB = rigidBodies[bodyIndexB].m_quat;\n"
+"		float4 invPosA,invPosB;\n"
+"		Quaternion invOrnA,invOrnB;\n"
+"		trInverse(posA,ornA,&invPosA,&invOrnA);\n"
+"		trInverse(posB,ornB,&invPosB,&invOrnB);\n"
+"		float4 relPos;\n"
+"		Quaternion relOrn;\n"
+"		trMul(invPosA,invOrnA,posB,ornB,&relPos,&relOrn);\n"
+"		float4 normal = c->m_worldNormalOnB;\n"
+"		int nPoints = (int)normal.w;\n"
+"		normal.w = 0.f;\n"
+"		newManifolds[m].m_relPos = relPos;\n"
+"		newManifolds[m].m_relOrn = relOrn;\n"
+"		float4 localNormal = qtRotate(invOrnA,normal);\n"
+"		localNormal.w = (float)nPoints;\n"
+"		newManifolds[m].m_localNormalOnA = localNormal;\n"
+"		for (int p=0;p<nPoints;p++)\n"
+"		{\n"
+"			float4 pB = c->m_worldPosB[p];\n"
+"			float4 pA = pB+normal*pB.w;\n"
+"			pA.w = 0.f;\n"
+"			pB.w = 0.f;\n"
+"			newManifolds[m].m_localPointsA[p] = transform(&pA,&invPosA,&invOrnA);\n"
+"			newManifolds[m].m_localPointsB[p] = transform(&pB,&invPosB,&invOrnB);\n"
+"		}\n"
+"		newManifolds[m].m_bodyA = bodyIndexA;\n"
+"		newManifolds[m].m_bodyB = bodyIndexB;\n"
+"	}\n"
+"	newKeys[m] = make_int2((int)manifoldCacheKey(bodyIndexA,bodyIndexB),m);\n"
+"}\n"
 ;
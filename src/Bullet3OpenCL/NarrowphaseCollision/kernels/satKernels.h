@@ -124,7 +124,11 @@ static const char* satKernelsCL= \
 "	int m_vertexOffset;\n"
 "	int	m_uniqueEdgesOffset;\n"
 "	int	m_numUniqueEdges;\n"
-"	int m_unused;\n"
+"	int m_vertexAdjacencyOffset;\n"
+"	int m_edgeOffset;\n"
+"	int m_numEdges;\n"
+"	int m_unused0;\n"
+"	int m_unused1;\n"
 "} ConvexPolyhedronCL;\n"
 "typedef struct \n"
 "{\n"
@@ -463,21 +467,55 @@ static const char* satKernelsCL= \
 "	min[0] += offset;\n"
 "	max[0] += offset;\n"
 "}\n"
+"//walk the vertex adjacency graph towards the support vertex of a closed convex hull\n"
+"//the first m_numVertices+1 entries at m_vertexAdjacencyOffset are the row starts into the neighbour lists\n"
+"inline float supportHillClimb(__global const ConvexPolyhedronCL* hull, const float4 localDir, __global const float4* vertices, __global const int* vertexAdjacency)\n"
+"{\n"
+"	int rowStarts = hull->m_vertexAdjacencyOffset;\n"
+"	int v = 0;\n"
+"	float best = dot3F4(vertices[hull->m_vertexOffset],localDir);\n"
+"	bool improved = true;\n"
+"	while (improved)\n"
+"	{\n"
+"		improved = false;\n"
+"		int begin = vertexAdjacency[rowStarts+v];\n"
+"		int end = vertexAdjacency[rowStarts+v+1];\n"
+"		for (int n=begin;n<end;n++)\n"
+"		{\n"
+"			int w = vertexAdjacency[n];\n"
+"			float dp = dot3F4(vertices[hull->m_vertexOffset+w],localDir);\n"
+"			if (dp>best)\n"
+"			{\n"
+"				best = dp;\n"
+"				v = w;\n"
+"				improved = true;\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"	return best;\n"
+"}\n"
 "inline void project(__global const ConvexPolyhedronCL* hull,  const float4 pos, const float4 orn, \n"
-"const float4* dir, __global const float4* vertices, float* min, float* max)\n"
+"const float4* dir, __global const float4* vertices, __global const int* vertexAdjacency, float* min, float* max)\n"
 "{\n"
 "	min[0] = FLT_MAX;\n"
 "	max[0] = -FLT_MAX;\n"
 "	int numVerts = hull->m_numVertices;\n"
 "	const float4 localDir = qtInvRotate(orn,*dir);\n"
 "	float offset = dot(pos,*dir);\n"
-"	for(int i=0;i<numVerts;i++)\n"
+"	if (hull->m_vertexAdjacencyOffset>=0)\n"
 "	{\n"
-"		float dp = dot(vertices[hull->m_vertexOffset+i],localDir);\n"
-"		if(dp < min[0])	\n"
-"			min[0] = dp;\n"
-"		if(dp > max[0])	\n"
-"			max[0] = dp;\n"
+"		max[0] = supportHillClimb(hull,localDir,vertices,vertexAdjacency);\n"
+"		min[0] = -supportHillClimb(hull,-localDir,vertices,vertexAdjacency);\n"
+"	} else\n"
+"	{\n"
+"		for(int i=0;i<numVerts;i++)\n"
+"		{\n"
+"			float dp = dot(vertices[hull->m_vertexOffset+i],localDir);\n"
+"			if(dp < min[0])	\n"
+"				min[0] = dp;\n"
+"			if(dp > max[0])	\n"
+"				max[0] = dp;\n"
+"		}\n"
 "	}\n"
 "	if(min[0]>max[0])\n"
 "	{\n"
@@ -491,12 +529,12 @@ static const char* satKernelsCL= \
 "inline bool TestSepAxisLocalA(const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, \n"
 "	const float4 posA,const float4 ornA,\n"
 "	const float4 posB,const float4 ornB,\n"
-"	float4* sep_axis, const float4* verticesA, __global const float4* verticesB,float* depth)\n"
+"	float4* sep_axis, const float4* verticesA, __global const float4* verticesB, __global const int* vertexAdjacencyB,float* depth)\n"
 "{\n"
 "	float Min0,Max0;\n"
 "	float Min1,Max1;\n"
 "	projectLocal(hullA,posA,ornA,sep_axis,verticesA, &Min0, &Max0);\n"
-"	project(hullB,posB,ornB, sep_axis,verticesB, &Min1, &Max1);\n"
+"	project(hullB,posB,ornB, sep_axis,verticesB, vertexAdjacencyB, &Min1, &Max1);\n"
 "	if(Max0<Min1 || Max1<Min0)\n"
 "		return false;\n"
 "	float d0 = Max0 - Min1;\n"
@@ -525,6 +563,7 @@ static const char* satKernelsCL= \
 "	__global const float4* uniqueEdgesB, \n"
 "	__global const btGpuFace* facesB,\n"
 "	__global const int*  indicesB,\n"
+"	__global const int* vertexAdjacencyB,\n"
 "	float4* sep,\n"
 "	float* dmin)\n"
 "{\n"
@@ -545,7 +584,7 @@ static const char* satKernelsCL= \
 "				faceANormalWS*=-1.f;\n"
 "			curPlaneTests++;\n"
 "			float d;\n"
-"			if(!TestSepAxisLocalA( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, verticesA, verticesB,&d))\n"
+"			if(!TestSepAxisLocalA( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, verticesA, verticesB,vertexAdjacencyB,&d))\n"
 "				return false;\n"
 "			if(d<*dmin)\n"
 "			{\n"
@@ -570,6 +609,7 @@ static const char* satKernelsCL= \
 "	__global const float4* uniqueEdgesA, \n"
 "	__global const btGpuFace* facesA,\n"
 "	__global const int*  indicesA,\n"
+"	__global const int* vertexAdjacencyA,\n"
 "	const float4* verticesB,\n"
 "	const float4* uniqueEdgesB, \n"
 "	const btGpuFace* facesB,\n"
@@ -594,7 +634,7 @@ static const char* satKernelsCL= \
 "				faceANormalWS *= -1.f;\n"
 "			curPlaneTests++;\n"
 "			float d;\n"
-"			if(!TestSepAxisLocalA( hullB, hullA, posB,ornB,posA,ornA, &faceANormalWS, verticesB,verticesA, &d))\n"
+"			if(!TestSepAxisLocalA( hullB, hullA, posB,ornB,posA,ornA, &faceANormalWS, verticesB,verticesA, vertexAdjacencyA, &d))\n"
 "				return false;\n"
 "			if(d<*dmin)\n"
 "			{\n"
@@ -623,6 +663,7 @@ static const char* satKernelsCL= \
 "	__global const float4* uniqueEdgesB, \n"
 "	__global const btGpuFace* facesB,\n"
 "	__global const int*  indicesB,\n"
+"	__global const int* vertexAdjacencyB,\n"
 "		float4* sep,\n"
 "	float* dmin)\n"
 "{\n"
@@ -655,7 +696,7 @@ static const char* satKernelsCL= \
 "					float Min0,Max0;\n"
 "					float Min1,Max1;\n"
 "					projectLocal(hullA,posA,ornA,&crossje,verticesA, &Min0, &Max0);\n"
-"					project(hullB,posB,ornB,&crossje,verticesB, &Min1, &Max1);\n"
+"					project(hullB,posB,ornB,&crossje,verticesB, vertexAdjacencyB, &Min1, &Max1);\n"
 "				\n"
 "					if(Max0<Min1 || Max1<Min0)\n"
 "						result = false;\n"
@@ -684,12 +725,12 @@ static const char* satKernelsCL= \
 "inline bool TestSepAxis(__global const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, \n"
 "	const float4 posA,const float4 ornA,\n"
 "	const float4 posB,const float4 ornB,\n"
-"	float4* sep_axis, __global const float4* vertices,float* depth)\n"
+"	float4* sep_axis, __global const float4* vertices, __global const int* vertexAdjacency,float* depth)\n"
 "{\n"
 "	float Min0,Max0;\n"
 "	float Min1,Max1;\n"
-"	project(hullA,posA,ornA,sep_axis,vertices, &Min0, &Max0);\n"
-"	project(hullB,posB,ornB, sep_axis,vertices, &Min1, &Max1);\n"
+"	project(hullA,posA,ornA,sep_axis,vertices, vertexAdjacency, &Min0, &Max0);\n"
+"	project(hullB,posB,ornB, sep_axis,vertices, vertexAdjacency, &Min1, &Max1);\n"
 "	if(Max0<Min1 || Max1<Min0)\n"
 "		return false;\n"
 "	float d0 = Max0 - Min1;\n"
@@ -707,6 +748,7 @@ static const char* satKernelsCL= \
 "	__global const float4* uniqueEdges, \n"
 "	__global const btGpuFace* faces,\n"
 "	__global const int*  indices,\n"
+"	__global const int* vertexAdjacency,\n"
 "	float4* sep,\n"
 "	float* dmin)\n"
 "{\n"
@@ -731,7 +773,7 @@ static const char* satKernelsCL= \
 "			curPlaneTests++;\n"
 "	\n"
 "			float d;\n"
-"			if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, vertices,&d))\n"
+"			if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,&faceANormalWS, vertices,vertexAdjacency,&d))\n"
 "				return false;\n"
 "	\n"
 "			if(d<*dmin)\n"
@@ -748,6 +790,73 @@ static const char* satKernelsCL= \
 "	\n"
 "	return true;\n"
 "}\n"
+"//edge pairs only build a face of the Minkowski difference if the Gauss map arcs of both edges intersect\n"
+"//a,b are the face normals adjacent to the edge of A, c,d the negated face normals adjacent to the edge of B\n"
+"inline bool isMinkowskiFace(const float4 a, const float4 b, const float4 bxa, const float4 c, const float4 d, const float4 dxc)\n"
+"{\n"
+"	float cba = dot3F4(c,bxa);\n"
+"	float dba = dot3F4(d,bxa);\n"
+"	float adc = dot3F4(a,dxc);\n"
+"	float bdc = dot3F4(b,dxc);\n"
+"	return cba*dba<0.f && adc*bdc<0.f && cba*bdc>0.f;\n"
+"}\n"
+"//only edge pairs that pass the Gauss map test are candidate axes\n"
+"//the arc test runs in the local space of hullA, so the normals of hullA are used without rotation\n"
+"bool findSeparatingAxisEdgeEdgeGaussMap(	__global const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, \n"
+"	const float4 posA,\n"
+"	const float4 ornA,\n"
+"	const float4 posB,\n"
+"	const float4 ornB,\n"
+"	const float4 DeltaC2,\n"
+"	__global const float4* vertices, \n"
+"	__global const btGpuFace* faces,\n"
+"	__global const int* vertexAdjacency,\n"
+"	__global const int4* hullEdges,\n"
+"	float4* sep,\n"
+"	float* dmin)\n"
+"{\n"
+"	float4 ornBinA = qtMul(qtInvert(ornA),ornB);\n"
+"	for(int e1=0;e1<hullB->m_numEdges;e1++)\n"
+"	{\n"
+"		int4 edgeB = hullEdges[hullB->m_edgeOffset+e1];\n"
+"		float4 c = -qtRotate(ornBinA,faces[hullB->m_faceOffset+edgeB.z].m_plane);\n"
+"		float4 d = -qtRotate(ornBinA,faces[hullB->m_faceOffset+edgeB.w].m_plane);\n"
+"		float4 dxc = cross3(d,c);\n"
+"		float4 edge1 = qtRotate(ornBinA,vertices[hullB->m_vertexOffset+edgeB.y]-vertices[hullB->m_vertexOffset+edgeB.x]);\n"
+"		for(int e0=0;e0<hullA->m_numEdges;e0++)\n"
+"		{\n"
+"			int4 edgeA = hullEdges[hullA->m_edgeOffset+e0];\n"
+"			float4 a = faces[hullA->m_faceOffset+edgeA.z].m_plane;\n"
+"			float4 b = faces[hullA->m_faceOffset+edgeA.w].m_plane;\n"
+"			a.w = 0.f;\n"
+"			b.w = 0.f;\n"
+"			if (!isMinkowskiFace(a,b,cross3(b,a),c,d,dxc))\n"
+"				continue;\n"
+"			float4 edge0 = vertices[hullA->m_vertexOffset+edgeA.y]-vertices[hullA->m_vertexOffset+edgeA.x];\n"
+"			edge0.w = 0.f;\n"
+"			float4 crossje = cross3(edge0,edge1);\n"
+"			//skip nearly parallel edges, the face normals cover them\n"
+"			if (dot3F4(crossje,crossje) < 0.005f*0.005f*dot3F4(edge0,edge0)*dot3F4(edge1,edge1))\n"
+"				continue;\n"
+"			crossje = normalize3(qtRotate(ornA,crossje));\n"
+"			if (dot3F4(DeltaC2,crossje)<0)\n"
+"				crossje *= -1.f;\n"
+"			float dist;\n"
+"			if(!TestSepAxis( hullA, hullB, posA,ornA,posB,ornB,&crossje, vertices,vertexAdjacency,&dist))\n"
+"				return false;\n"
+"			if(dist<*dmin)\n"
+"			{\n"
+"				*dmin = dist;\n"
+"				*sep = crossje;\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"	if((dot3F4(-DeltaC2,*sep))>0.0f)\n"
+"	{\n"
+"		*sep = -(*sep);\n"
+"	}\n"
+"	return true;\n"
+"}\n"
 "bool findSeparatingAxisEdgeEdge(	__global const ConvexPolyhedronCL* hullA, __global const ConvexPolyhedronCL* hullB, \n"
 "	const float4 posA1,\n"
 "	const float4 ornA,\n"
@@ -758,6 +867,8 @@ static const char* satKernelsCL= \
 "	__global const float4* uniqueEdges, \n"
 "	__global const btGpuFace* faces,\n"
 "	__global const int*  indices,\n"
+"	__global const int* vertexAdjacency,\n"
+"	__global const int4* hullEdges,\n"
 "	float4* sep,\n"
 "	float* dmin)\n"
 "{\n"
@@ -766,6 +877,10 @@ static const char* satKernelsCL= \
 "	posA.w = 0.f;\n"
 "	float4 posB = posB1;\n"
 "	posB.w = 0.f;\n"
+"	if (hullA->m_numEdges && hullB->m_numEdges)\n"
+"	{\n"
+"		return findSeparatingAxisEdgeEdgeGaussMap(hullA,hullB,posA,ornA,posB,ornB,DeltaC2,vertices,faces,vertexAdjacency,hullEdges,sep,dmin);\n"
+"	}\n"
 "	int curPlaneTests=0;\n"
 "	int curEdgeEdge = 0;\n"
 "	// Test edges\n"
@@ -790,8 +905,8 @@ static const char* satKernelsCL= \
 "				{\n"
 "					float Min0,Max0;\n"
 "					float Min1,Max1;\n"
-"					project(hullA,posA,ornA,&crossje,vertices, &Min0, &Max0);\n"
-"					project(hullB,posB,ornB,&crossje,vertices, &Min1, &Max1);\n"
+"					project(hullA,posA,ornA,&crossje,vertices, vertexAdjacency, &Min0, &Max0);\n"
+"					project(hullB,posB,ornB,&crossje,vertices, vertexAdjacency, &Min1, &Max1);\n"
 "				\n"
 "					if(Max0<Min1 || Max1<Min0)\n"
 "						result = false;\n"
@@ -826,6 +941,8 @@ static const char* satKernelsCL= \
 "																					__global const float4* uniqueEdges,\n"
 "																					__global const btGpuFace* faces,\n"
 "																					__global const int* indices,\n"
+"																					__global const int* vertexAdjacency,\n"
+"																					__global const int4* hullEdges,\n"
 "																					__global btAabbCL* aabbs,\n"
 "																					__global const btGpuChildShape* gpuChildShapes,\n"
 "																					__global volatile float4* gpuCompoundSepNormalsOut,\n"
@@ -902,20 +1019,20 @@ static const char* satKernelsCL= \
 "		float4 c1 = transform(&c1local,&posB,&ornB);\n"
 "		const float4 DeltaC2 = c0 - c1;\n"
 "		float4 sepNormal = make_float4(1,0,0,0);\n"
-"		bool sepA = findSeparatingAxis(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,&sepNormal,&dmin);\n"
+"		bool sepA = findSeparatingAxis(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,vertexAdjacency,&sepNormal,&dmin);\n"
 "		hasSeparatingAxis = 4;\n"
 "		if (!sepA)\n"
 "		{\n"
 "			hasSeparatingAxis = 0;\n"
 "		} else\n"
 "		{\n"
-"			bool sepB = findSeparatingAxis(	&convexShapes[shapeIndexB],&convexShapes[shapeIndexA],posB,ornB,posA,ornA,DeltaC2,vertices,uniqueEdges,faces,indices,&sepNormal,&dmin);\n"
+"			bool sepB = findSeparatingAxis(	&convexShapes[shapeIndexB],&convexShapes[shapeIndexA],posB,ornB,posA,ornA,DeltaC2,vertices,uniqueEdges,faces,indices,vertexAdjacency,&sepNormal,&dmin);\n"
 "			if (!sepB)\n"
 "			{\n"
 "				hasSeparatingAxis = 0;\n"
 "			} else//(!sepB)\n"
 "			{\n"
-"				bool sepEE = findSeparatingAxisEdgeEdge(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,&sepNormal,&dmin);\n"
+"				bool sepEE = findSeparatingAxisEdgeEdge(	&convexShapes[shapeIndexA], &convexShapes[shapeIndexB],posA,ornA,posB,ornB,DeltaC2,vertices,uniqueEdges,faces,indices,vertexAdjacency,hullEdges,&sepNormal,&dmin);\n"
 "				if (sepEE)\n"
 "				{\n"
 "						gpuCompoundSepNormalsOut[i] = sepNormal;//fastNormalize4(sepNormal);\n"
@@ -967,10 +1084,11 @@ static const char* satKernelsCL= \
 "	__global const b3QuantizedBvhNode* quantizedNodes,\n"
 "	__global const b3BvhInfo* bvhInfos,\n"
 "	int numPairs,\n"
-"	int maxNumCompoundPairsCapacity\n"
+"	int maxNumCompoundPairsCapacity,\n"
+"	int pairOffset\n"
 "	)\n"
 "{\n"
-"	int i = get_global_id(0);\n"
+"	int i = get_global_id(0)+pairOffset;\n"
 "	if (i<numPairs)\n"
 "	{\n"
 "		int bodyIndexA = pairs[i].x;\n"
@@ -1273,16 +1391,25 @@ static const char* satKernelsCL= \
 "																					__global const float4* uniqueEdges,\n"
 "																					__global const btGpuFace* faces,\n"
 "																					__global const int* indices,\n"
+"																					__global const int* vertexAdjacency,\n"
+"																					__global const int4* hullEdges,\n"
 "																					__global btAabbCL* aabbs,\n"
 "																					__global volatile float4* separatingNormals,\n"
 "																					__global volatile int* hasSeparatingAxis,\n"
-"																					int numPairs\n"
+"																					int numPairs,\n"
+"																					int pairOffset\n"
 "																					)\n"
 "{\n"
-"	int i = get_global_id(0);\n"
+"	int i = get_global_id(0)+pairOffset;\n"
 "	\n"
 "	if (i<numPairs)\n"
 "	{\n"
+"		//the contacts of this pair were re-projected from the manifold cache\n"
+"		if (hasSeparatingAxis[i]==-1)\n"
+"		{\n"
+"			hasSeparatingAxis[i] = 0;\n"
+"			return;\n"
+"		}\n"
 "	\n"
 "		int bodyIndexA = pairs[i].x;\n"
 "		int bodyIndexB = pairs[i].y;\n"
@@ -1330,7 +1457,7 @@ static const char* satKernelsCL= \
 "																								posB,ornB,\n"
 "																								DeltaC2,\n"
 "																								vertices,uniqueEdges,faces,\n"
-"																								indices,&sepNormal,&dmin);\n"
+"																								indices,vertexAdjacency,&sepNormal,&dmin);\n"
 "		hasSeparatingAxis[i] = 4;\n"
 "		if (!sepA)\n"
 "		{\n"
@@ -1341,7 +1468,7 @@ static const char* satKernelsCL= \
 "																									posA,ornA,\n"
 "																									DeltaC2,\n"
 "																									vertices,uniqueEdges,faces,\n"
-"																									indices,&sepNormal,&dmin);\n"
+"																									indices,vertexAdjacency,&sepNormal,&dmin);\n"
 "			if (!sepB)\n"
 "			{\n"
 "				hasSeparatingAxis[i] = 0;\n"
@@ -1351,7 +1478,7 @@ static const char* satKernelsCL= \
 "																									posB,ornB,\n"
 "																									DeltaC2,\n"
 "																									vertices,uniqueEdges,faces,\n"
-"																									indices,&sepNormal,&dmin);\n"
+"																									indices,vertexAdjacency,hullEdges,&sepNormal,&dmin);\n"
 "				if (!sepEE)\n"
 "				{\n"
 "					hasSeparatingAxis[i] = 0;\n"
@@ -1374,6 +1501,7 @@ static const char* satKernelsCL= \
 "																					__global const float4* uniqueEdges,\n"
 "																					__global const btGpuFace* faces,\n"
 "																					__global const int* indices,\n"
+"																					__global const int* vertexAdjacency,\n"
 "																					__global const btGpuChildShape* gpuChildShapes,\n"
 "																					__global btAabbCL* aabbs,\n"
 "																					__global float4* concaveSeparatingNormalsOut,\n"
@@ -1407,6 +1535,9 @@ static const char* satKernelsCL= \
 "	//add 3 vertices of the triangle\n"
 "	convexPolyhedronA.m_numVertices = 3;\n"
 "	convexPolyhedronA.m_vertexOffset = 0;\n"
+"	convexPolyhedronA.m_vertexAdjacencyOffset = -1;\n"
+"	convexPolyhedronA.m_edgeOffset = 0;\n"
+"	convexPolyhedronA.m_numEdges = 0;\n"
 "	float4	localCenter = make_float4(0.f,0.f,0.f,0.f);\n"
 "	btGpuFace face = faces[convexShapes[shapeIndexA].m_faceOffset+f];\n"
 "	float4 triMinAabb, triMaxAabb;\n"
@@ -1544,7 +1675,7 @@ static const char* satKernelsCL= \
 "												posB,ornB,\n"
 "												DeltaC2,\n"
 "												verticesA,uniqueEdgesA,facesA,indicesA,\n"
-"												vertices,uniqueEdges,faces,indices,\n"
+"												vertices,uniqueEdges,faces,indices,vertexAdjacency,\n"
 "												&sepAxis,&dmin);\n"
 "		hasSeparatingAxis = 4;\n"
 "		if (!sepA)\n"
@@ -1556,7 +1687,7 @@ static const char* satKernelsCL= \
 "												posB,ornB,\n"
 "												posA,ornA,\n"
 "												DeltaC2,\n"
-"												vertices,uniqueEdges,faces,indices,\n"
+"												vertices,uniqueEdges,faces,indices,vertexAdjacency,\n"
 "												verticesA,uniqueEdgesA,facesA,indicesA,\n"
 "												&sepAxis,&dmin);\n"
 "			if (!sepB)\n"
@@ -1569,7 +1700,7 @@ static const char* satKernelsCL= \
 "															posB,ornB,\n"
 "															DeltaC2,\n"
 "															verticesA,uniqueEdgesA,facesA,indicesA,\n"
-"															vertices,uniqueEdges,faces,indices,\n"
+"															vertices,uniqueEdges,faces,indices,vertexAdjacency,\n"
 "															&sepAxis,&dmin);\n"
 "	\n"
 "				if (!sepEE)\n"
@@ -9,9 +9,14 @@
 #include "Bullet3OpenCL/ParallelPrimitives/b3OpenCLArray.h"
 #include "Bullet3OpenCL/ParallelPrimitives/b3LauncherCL.h"
 #include "Bullet3OpenCL/Raycast/kernels/rayCastKernels.h"
+#include "Bullet3OpenCL/Raycast/b3RaycastBvh.h"
+#include "Bullet3Geometry/b3AabbUtil.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
 
 
 #define B3_RAYCAST_PATH "src/Bullet3OpenCL/Raycast/kernels/rayCastKernels.cl"
+///castRaysHost hands out the rays in chunks, chunk c goes to task c%numTasks
+#define B3_RAYCAST_HOST_CHUNK_SIZE 64
 
 
 
@@ -22,8 +27,31 @@ struct b3GpuRaycastInternalData
 	cl_command_queue  m_q;
 	cl_kernel	m_raytraceKernel;
 	int m_test;
+
+	///host rays: tree over the world AABBs of the bodies with a supported shape, rebuilt each castRaysHost
+	b3RaycastBvh	m_bodyBvh;
+	b3AlignedObjectArray<int>	m_bvhBodies;
+	b3AlignedObjectArray<b3Vector3>	m_bodyAabbMins;
+	b3AlignedObjectArray<b3Vector3>	m_bodyAabbMaxs;
+
+	b3ThreadSupportInterface*	m_threadSupport;
+	int		m_rayPacketWidth;
 };
 
+static int b3GetDefaultRayPacketWidth()
+{
+#ifdef B3_USE_SSE
+#ifdef B3_HAS_AVX2_TARGET
+	static int width = b3CpuHasAvx2()? 8 : 4;
+	return width;
+#else
+	return 4;
+#endif
+#else
+	return 1;
+#endif
+}
+
 b3GpuRaycast::b3GpuRaycast(cl_context ctx,cl_device_id device, cl_command_queue  q)
 {
 	m_data = new b3GpuRaycastInternalData;
@@ -31,6 +59,8 @@ b3GpuRaycast::b3GpuRaycast(cl_context ctx,cl_device_id device, cl_command_queue
 	m_data->m_device = device;
 	m_data->m_q = q;
 	m_data->m_raytraceKernel = 0;
+	m_data->m_threadSupport = 0;
+	m_data->m_rayPacketWidth = b3GetDefaultRayPacketWidth();
 
 
 	{
@@ -124,86 +154,534 @@ bool rayConvex(const b3Vector3& rayFromLocal, const b3Vector3& rayToLocal, const
 	return true;
 }
 
-void b3GpuRaycast::castRaysHost(const b3AlignedObjectArray<b3RayInfo>& rays,	b3AlignedObjectArray<b3RayHit>& hitResults,
-		int numBodies,const struct b3RigidBodyCL* bodies, int numCollidables,const struct b3Collidable* collidables, const struct b3GpuNarrowPhaseInternalData* narrowphaseData)
+#ifdef B3_USE_SSE
+///Moller-Trumbore test of four two-sided triangles at once, returns the lane of the closest hit or -1
+static int rayTriangle4(const b3Vector3& rayFrom, const b3Vector3& rayDir, const b3Vector3* v0, const b3Vector3* v1, const b3Vector3* v2, float& hitFraction)
 {
+	__m128 v0x = v0[0].mVec128, v0y = v0[1].mVec128, v0z = v0[2].mVec128, v0w = v0[3].mVec128;
+	__m128 e1x = _mm_sub_ps(v1[0].mVec128,v0x), e1y = _mm_sub_ps(v1[1].mVec128,v0y), e1z = _mm_sub_ps(v1[2].mVec128,v0z), e1w = _mm_sub_ps(v1[3].mVec128,v0w);
+	__m128 e2x = _mm_sub_ps(v2[0].mVec128,v0x), e2y = _mm_sub_ps(v2[1].mVec128,v0y), e2z = _mm_sub_ps(v2[2].mVec128,v0z), e2w = _mm_sub_ps(v2[3].mVec128,v0w);
+	//from one vertex per register to one axis per register
+	_MM_TRANSPOSE4_PS(v0x,v0y,v0z,v0w);
+	_MM_TRANSPOSE4_PS(e1x,e1y,e1z,e1w);
+	_MM_TRANSPOSE4_PS(e2x,e2y,e2z,e2w);
+
+	__m128 dx = _mm_set1_ps(rayDir.getX()), dy = _mm_set1_ps(rayDir.getY()), dz = _mm_set1_ps(rayDir.getZ());
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy,e2z),_mm_mul_ps(dz,e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz,e2x),_mm_mul_ps(dx,e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx,e2y),_mm_mul_ps(dy,e2x));
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x,px),_mm_mul_ps(e1y,py)),_mm_mul_ps(e1z,pz));
+	__m128 invDet = _mm_div_ps(_mm_set1_ps(1.f),det);
+
+	__m128 sx = _mm_sub_ps(_mm_set1_ps(rayFrom.getX()),v0x);
+	__m128 sy = _mm_sub_ps(_mm_set1_ps(rayFrom.getY()),v0y);
+	__m128 sz = _mm_sub_ps(_mm_set1_ps(rayFrom.getZ()),v0z);
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx,px),_mm_mul_ps(sy,py)),_mm_mul_ps(sz,pz)),invDet);
+
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(sy,e1z),_mm_mul_ps(sz,e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(sz,e1x),_mm_mul_ps(sx,e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(sx,e1y),_mm_mul_ps(sy,e1x));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,qx),_mm_mul_ps(dy,qy)),_mm_mul_ps(dz,qz)),invDet);
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x,qx),_mm_mul_ps(e2y,qy)),_mm_mul_ps(e2z,qz)),invDet);
+
+	//the comparisons are false for the NaNs of degenerate triangles
+	__m128 zero = _mm_setzero_ps();
+	__m128 hitMask = _mm_cmpneq_ps(det,zero);
+	hitMask = _mm_and_ps(hitMask,_mm_cmpge_ps(u,zero));
+	hitMask = _mm_and_ps(hitMask,_mm_cmpge_ps(v,zero));
+	hitMask = _mm_and_ps(hitMask,_mm_cmple_ps(_mm_add_ps(u,v),_mm_set1_ps(1.f)));
+	hitMask = _mm_and_ps(hitMask,_mm_cmpge_ps(t,zero));
+	hitMask = _mm_and_ps(hitMask,_mm_cmplt_ps(t,_mm_set1_ps(hitFraction)));
+	int hits = _mm_movemask_ps(hitMask);
+	if (!hits)
+		return -1;
+
+	B3_ATTRIBUTE_ALIGNED16(float) fractions[4];
+	_mm_store_ps(fractions,t);
+	int hitLane = -1;
+	for (int lane=0;lane<4;lane++)
+	{
+		if ((hits & (1<<lane)) && fractions[lane]<hitFraction)
+		{
+			hitFraction = fractions[lane];
+			hitLane = lane;
+		}
+	}
+	return hitLane;
+}
+#else
 
-//	return castRays(rays,hitResults,numBodies,bodies,numCollidables,collidables);
+///Moller-Trumbore test of a two-sided triangle, hitFraction is lowered on a hit
+static bool rayTriangle(const b3Vector3& rayFrom, const b3Vector3& rayDir, const b3Vector3& v0, const b3Vector3& v1, const b3Vector3& v2, float& hitFraction)
+{
+	b3Vector3 edge1 = v1-v0;
+	b3Vector3 edge2 = v2-v0;
+	b3Vector3 p = rayDir.cross(edge2);
+	b3Scalar det = edge1.dot(p);
+	if (det==0.f)
+		return false;
+	b3Scalar invDet = 1.f/det;
+	b3Vector3 s = rayFrom-v0;
+	b3Scalar u = s.dot(p)*invDet;
+	if (u<0.f || u>1.f)
+		return false;
+	b3Vector3 q = s.cross(edge1);
+	b3Scalar v = rayDir.dot(q)*invDet;
+	if (v<0.f || u+v>1.f)
+		return false;
+	b3Scalar t = edge2.dot(q)*invDet;
+	if (t<0.f || t>=hitFraction)
+		return false;
+	hitFraction = t;
+	return true;
+}
+#endif //B3_USE_SSE
 
-	B3_PROFILE("castRaysHost");
-	for (int r=0;r<rays.size();r++)
+static void getMeshTriangle(const b3ConvexPolyhedronCL& mesh, int triangleIndex, const struct b3GpuNarrowPhaseInternalData* narrowphaseData,
+	b3Vector3& v0, b3Vector3& v1, b3Vector3& v2)
+{
+	const b3GpuFace& face = narrowphaseData->m_convexFaces[mesh.m_faceOffset+triangleIndex];
+	const int* indices = &narrowphaseData->m_convexIndices[face.m_indexOffset];
+	v0 = narrowphaseData->m_convexVertices[mesh.m_vertexOffset+indices[0]];
+	v1 = narrowphaseData->m_convexVertices[mesh.m_vertexOffset+indices[1]];
+	v2 = narrowphaseData->m_convexVertices[mesh.m_vertexOffset+indices[2]];
+}
+
+///collects the triangles that the quantized tree reports along the ray and tests them four at a time
+struct b3RayTrimeshCallback : public b3NodeOverlapCallback
+{
+	b3Vector3	m_rayFrom;
+	b3Vector3	m_rayDir;
+	const b3ConvexPolyhedronCL* m_mesh;
+	const struct b3GpuNarrowPhaseInternalData* m_narrowphaseData;
+	float		m_hitFraction;
+	int			m_hitTriangle;
+	int			m_triangles[4];
+	int			m_numTriangles;
+
+	virtual void processNode(int subPart, int triangleIndex)
 	{
-		b3Vector3 rayFrom = rays[r].m_from;
-		b3Vector3 rayTo = rays[r].m_to;
-		float hitFraction = hitResults[r].m_hitFraction;
+		m_triangles[m_numTriangles++] = triangleIndex;
+		if (m_numTriangles==4)
+			flush();
+	}
+
+	void	flush()
+	{
+		if (!m_numTriangles)
+			return;
+#ifdef B3_USE_SSE
+		b3Vector3 v0[4],v1[4],v2[4];
+		for (int i=0;i<4;i++)
+		{
+			//a partial batch repeats its first triangle
+			int triangle = m_triangles[i<m_numTriangles? i : 0];
+			getMeshTriangle(*m_mesh,triangle,m_narrowphaseData,v0[i],v1[i],v2[i]);
+		}
+		int hitLane = rayTriangle4(m_rayFrom,m_rayDir,v0,v1,v2,m_hitFraction);
+		if (hitLane>=0)
+			m_hitTriangle = m_triangles[hitLane];
+#else
+		for (int i=0;i<m_numTriangles;i++)
+		{
+			b3Vector3 v0,v1,v2;
+			getMeshTriangle(*m_mesh,m_triangles[i],m_narrowphaseData,v0,v1,v2);
+			if (rayTriangle(m_rayFrom,m_rayDir,v0,v1,v2,m_hitFraction))
+				m_hitTriangle = m_triangles[i];
+		}
+#endif
+		m_numTriangles = 0;
+	}
+};
+
+static bool rayTestCollidable(int collidableIndex, const b3Transform& tr, const b3Vector3& rayFrom, const b3Vector3& rayTo, const struct b3Collidable* collidables,
+	const struct b3GpuNarrowPhaseInternalData* narrowphaseData, float& hitFraction, b3Vector3& hitNormal);
+
+///tests the children that the compound tree reports along the ray, in world space
+struct b3RayCompoundCallback : public b3NodeOverlapCallback
+{
+	const b3GpuChildShape* m_children;
+	b3Transform	m_compoundTransform;
+	b3Vector3	m_rayFrom;
+	b3Vector3	m_rayTo;
+	const struct b3Collidable* m_collidables;
+	const struct b3GpuNarrowPhaseInternalData* m_narrowphaseData;
+	float		m_hitFraction;
+	b3Vector3	m_hitNormal;
+	bool		m_hasHit;
+
+	virtual void processNode(int subPart, int childIndex)
+	{
+		const b3GpuChildShape& child = m_children[childIndex];
+		b3Transform childTr;
+		childTr.setOrigin(child.m_childPosition);
+		childTr.setRotation(child.m_childOrientation);
+		if (rayTestCollidable(child.m_shapeIndex,m_compoundTransform*childTr,m_rayFrom,m_rayTo,m_collidables,m_narrowphaseData,m_hitFraction,m_hitNormal))
+			m_hasHit = true;
+	}
+};
 
-		int hitBodyIndex= -1;
-		b3Vector3 hitNormal;
+///walks the child tree of the compound in its local space
+static bool rayCompound(const b3Collidable& compound, const b3Transform& tr, const b3Vector3& rayFrom, const b3Vector3& rayTo, const struct b3Collidable* collidables,
+	const struct b3GpuNarrowPhaseInternalData* narrowphaseData, float& hitFraction, b3Vector3& hitNormal)
+{
+	b3RayCompoundCallback callback;
+	callback.m_children = &narrowphaseData->m_cpuChildShapes[compound.m_shapeIndex];
+	callback.m_compoundTransform = tr;
+	callback.m_rayFrom = rayFrom;
+	callback.m_rayTo = rayTo;
+	callback.m_collidables = collidables;
+	callback.m_narrowphaseData = narrowphaseData;
+	callback.m_hitFraction = hitFraction;
+	callback.m_hasHit = false;
+
+	b3Transform world2Local = tr.inverse();
+	const b3QuantizedBvh* bvh = narrowphaseData->m_bvhCPU[compound.m_compoundBvhIndex];
+	bvh->reportRayOverlappingNodex(&callback,world2Local(rayFrom),world2Local(rayTo));
+	if (!callback.m_hasHit)
+		return false;
+	hitFraction = callback.m_hitFraction;
+	hitNormal = callback.m_hitNormal;
+	return true;
+}
 
-		for (int b=0;b<numBodies;b++)
+///hitNormal is in world space
+static bool rayTestCollidable(int collidableIndex, const b3Transform& tr, const b3Vector3& rayFrom, const b3Vector3& rayTo, const struct b3Collidable* collidables,
+	const struct b3GpuNarrowPhaseInternalData* narrowphaseData, float& hitFraction, b3Vector3& hitNormal)
+{
+	const b3Collidable& collidable = collidables[collidableIndex];
+	switch (collidable.m_shapeType)
+	{
+	case SHAPE_SPHERE:
 		{
-				
-			const b3Vector3& pos = bodies[b].m_pos;
-			const b3Quaternion& orn = bodies[b].m_quat;
-			
-			switch (collidables[bodies[b].m_collidableIdx].m_shapeType)
+			if (sphere_intersect(tr.getOrigin(), collidable.m_radius, rayFrom, rayTo,hitFraction))
 			{
-			case SHAPE_SPHERE:
-				{
-					b3Scalar radius = collidables[bodies[b].m_collidableIdx].m_radius;
-					if (sphere_intersect(pos,  radius, rayFrom, rayTo,hitFraction))
-					{
-						hitBodyIndex = b;
-						b3Vector3 hitPoint;
-						hitPoint.setInterpolate3(rays[r].m_from, rays[r].m_to,hitFraction);
-						hitNormal = (hitPoint-bodies[b].m_pos).normalize();
-					}
-				}
-			case SHAPE_CONVEX_HULL:
-				{
+				b3Vector3 hitPoint;
+				hitPoint.setInterpolate3(rayFrom,rayTo,hitFraction);
+				hitNormal = (hitPoint-tr.getOrigin()).normalize();
+				return true;
+			}
+			return false;
+		}
+	case SHAPE_CONVEX_HULL:
+		{
+			b3Transform convexWorld2Local = tr.inverse();
 
-					b3Transform convexWorldTransform;
-					convexWorldTransform.setIdentity();
-					convexWorldTransform.setOrigin(bodies[b].m_pos);
-					convexWorldTransform.setRotation(bodies[b].m_quat);
-					b3Transform convexWorld2Local = convexWorldTransform.inverse();
-
-					b3Vector3 rayFromLocal = convexWorld2Local(rayFrom);
-					b3Vector3 rayToLocal = convexWorld2Local(rayTo);
-					
-					
-					int shapeIndex = collidables[bodies[b].m_collidableIdx].m_shapeIndex;
-					const b3ConvexPolyhedronCL& poly = narrowphaseData->m_convexPolyhedra[shapeIndex];
-					if (rayConvex(rayFromLocal, rayToLocal,poly,narrowphaseData->m_convexFaces, hitFraction, hitNormal))
-					{
-						hitBodyIndex = b;
-					}
-
-					
-					break;
-				}
-			default:
-				{
-					static bool once=true;
-					if (once)
-					{
-						once=false;
-						b3Warning("Raytest: unsupported shape type\n");
-					}
-				}
+			b3Vector3 rayFromLocal = convexWorld2Local(rayFrom);
+			b3Vector3 rayToLocal = convexWorld2Local(rayTo);
+
+			const b3ConvexPolyhedronCL& poly = narrowphaseData->m_convexPolyhedra[collidable.m_shapeIndex];
+			b3Vector3 localNormal;
+			if (rayConvex(rayFromLocal, rayToLocal,poly,narrowphaseData->m_convexFaces, hitFraction, localNormal))
+			{
+				hitNormal = tr.getBasis()*localNormal;
+				return true;
+			}
+			return false;
+		}
+	case SHAPE_CONCAVE_TRIMESH:
+		{
+			if (hitFraction<=0.f)
+				return false;
+			b3Transform meshWorld2Local = tr.inverse();
+
+			b3RayTrimeshCallback callback;
+			callback.m_rayFrom = meshWorld2Local(rayFrom);
+			callback.m_rayDir = meshWorld2Local(rayTo)-callback.m_rayFrom;
+			callback.m_mesh = &narrowphaseData->m_convexPolyhedra[collidable.m_shapeIndex];
+			callback.m_narrowphaseData = narrowphaseData;
+			callback.m_hitFraction = hitFraction;
+			callback.m_hitTriangle = -1;
+			callback.m_numTriangles = 0;
+
+			//only the part of the ray before the closest hit so far can hit the mesh
+			const b3QuantizedBvh* bvh = narrowphaseData->m_bvhCPU[collidable.m_bvhIndex];
+			bvh->reportRayOverlappingNodex(&callback,callback.m_rayFrom,callback.m_rayFrom+callback.m_rayDir*hitFraction);
+			callback.flush();
+			if (callback.m_hitTriangle<0)
+				return false;
+
+			const b3GpuFace& face = narrowphaseData->m_convexFaces[callback.m_mesh->m_faceOffset+callback.m_hitTriangle];
+			b3Vector3 localNormal = b3MakeVector3(face.m_plane.x,face.m_plane.y,face.m_plane.z);
+			//triangles are two-sided, the normal faces the ray
+			if (localNormal.dot(callback.m_rayDir)>0.f)
+				localNormal = -localNormal;
+			hitFraction = callback.m_hitFraction;
+			hitNormal = tr.getBasis()*localNormal;
+			return true;
+		}
+	case SHAPE_COMPOUND_OF_CONVEX_HULLS:
+		{
+			return rayCompound(collidable,tr,rayFrom,rayTo,collidables,narrowphaseData,hitFraction,hitNormal);
+		}
+	}
+	//unsupported shapes are not in the tree, see buildBodyBvh
+	return false;
+}
+
+static bool rayTestBody(int bodyIndex, const b3Vector3& rayFrom, const b3Vector3& rayTo, const struct b3RigidBodyCL* bodies, const struct b3Collidable* collidables,
+	const struct b3GpuNarrowPhaseInternalData* narrowphaseData, float& hitFraction, b3Vector3& hitNormal)
+{
+	const b3RigidBodyCL& body = bodies[bodyIndex];
+	b3Transform bodyTransform;
+	bodyTransform.setOrigin(body.m_pos);
+	bodyTransform.setRotation(body.m_quat);
+	return rayTestCollidable(body.m_collidableIdx,bodyTransform,rayFrom,rayTo,collidables,narrowphaseData,hitFraction,hitNormal);
+}
+
+struct b3RayBodyCallback
+{
+	b3Vector3	m_rayFrom;
+	b3Vector3	m_rayTo;
+	const int*	m_bvhBodies;
+	const struct b3RigidBodyCL* m_bodies;
+	const struct b3Collidable* m_collidables;
+	const struct b3GpuNarrowPhaseInternalData* m_narrowphaseData;
+	int			m_hitBodyIndex;
+	b3Vector3	m_hitNormal;
+
+	void	processObject(int object, b3Scalar& hitFraction)
+	{
+		int bodyIndex = m_bvhBodies[object];
+		if (rayTestBody(bodyIndex,m_rayFrom,m_rayTo,m_bodies,m_collidables,m_narrowphaseData,hitFraction,m_hitNormal))
+			m_hitBodyIndex = bodyIndex;
+	}
+};
+
+///the arguments of castRaysHost, shared by its tasks
+struct b3CastRaysHostArgs
+{
+	const b3RayInfo*	m_rays;
+	b3RayHit*			m_hitResults;
+	int					m_numRays;
+	const struct b3RigidBodyCL* m_bodies;
+	const struct b3Collidable* m_collidables;
+	const struct b3GpuNarrowPhaseInternalData* m_narrowphaseData;
+};
+
+struct b3CastRaysHostTask : public b3ThreadTask
+{
+	b3GpuRaycast*	m_raycaster;
+	const b3CastRaysHostArgs*	m_args;
+	int	m_taskIndex;
+	int	m_numTasks;
+
+	virtual void	run(void* lsMemory)
+	{
+		m_raycaster->castRaysHostChunks(m_taskIndex,m_numTasks,*m_args);
+	}
+};
+
+static void initRayCallback(b3RayBodyCallback& callback, const b3RayInfo& ray, const int* bvhBodies, const b3CastRaysHostArgs& args)
+{
+	callback.m_rayFrom = ray.m_from;
+	callback.m_rayTo = ray.m_to;
+	callback.m_bvhBodies = bvhBodies;
+	callback.m_bodies = args.m_bodies;
+	callback.m_collidables = args.m_collidables;
+	callback.m_narrowphaseData = args.m_narrowphaseData;
+	callback.m_hitBodyIndex = -1;
+}
+
+static void writeRayHit(const b3RayInfo& ray, const b3RayBodyCallback& callback, b3Scalar hitFraction, b3RayHit& hit)
+{
+	if (callback.m_hitBodyIndex>=0)
+	{
+		hit.m_hitFraction = hitFraction;
+		hit.m_hitPoint.setInterpolate3(ray.m_from,ray.m_to,hitFraction);
+		hit.m_hitNormal = callback.m_hitNormal;
+		hit.m_hitBody = callback.m_hitBodyIndex;
+	}
+}
+
+#ifdef B3_USE_SSE
+///the rays of a packet need the same direction signs, so that they traverse the tree in a similar order
+static bool isRayPacketCoherent(const b3RayInfo* rays, int numRays)
+{
+	b3Vector3 dir0 = rays[0].m_to-rays[0].m_from;
+	for (int i=1;i<numRays;i++)
+	{
+		b3Vector3 dir = rays[i].m_to-rays[i].m_from;
+		for (int k=0;k<3;k++)
+		{
+			if ((dir[k]<0.f) != (dir0[k]<0.f))
+				return false;
+		}
+	}
+	return true;
+}
+
+template <class P>
+static void castRayPacket(const b3RaycastBvh& bvh, const int* bvhBodies, const b3CastRaysHostArgs& args, int firstRay, int numRays)
+{
+	P packet;
+	b3RayBodyCallback callbacks[P::B3_NUM_LANES];
+	packet.clear();
+	for (int lane=0;lane<numRays;lane++)
+	{
+		const b3RayInfo& ray = args.m_rays[firstRay+lane];
+		initRayCallback(callbacks[lane],ray,bvhBodies,args);
+		packet.setRay(lane,ray.m_from,ray.m_to,args.m_hitResults[firstRay+lane].m_hitFraction);
+	}
+	bvh.rayTestPacket(packet,callbacks);
+	for (int lane=0;lane<numRays;lane++)
+		writeRayHit(args.m_rays[firstRay+lane],callbacks[lane],packet.m_hitFraction[lane],args.m_hitResults[firstRay+lane]);
+}
+#endif //B3_USE_SSE
+
+static bool isRayTestShapeSupported(int shapeType)
+{
+	return shapeType==SHAPE_SPHERE || shapeType==SHAPE_CONVEX_HULL || shapeType==SHAPE_CONCAVE_TRIMESH || shapeType==SHAPE_COMPOUND_OF_CONVEX_HULLS;
+}
+
+void b3GpuRaycast::buildBodyBvh(int numBodies,const struct b3RigidBodyCL* bodies, const struct b3Collidable* collidables, const struct b3GpuNarrowPhaseInternalData* narrowphaseData)
+{
+	B3_PROFILE("buildBodyBvh");
+	m_data->m_bvhBodies.resize(0);
+	m_data->m_bodyAabbMins.resize(0);
+	m_data->m_bodyAabbMaxs.resize(0);
+	for (int b=0;b<numBodies;b++)
+	{
+		const b3Collidable& collidable = collidables[bodies[b].m_collidableIdx];
+		if (!isRayTestShapeSupported(collidable.m_shapeType))
+		{
+			static bool once=true;
+			if (once)
+			{
+				once=false;
+				b3Warning("Raytest: unsupported shape type\n");
 			}
+			continue;
 		}
-		if (hitBodyIndex>=0)
+
+		b3Vector3 aabbMin,aabbMax;
+		if (collidable.m_shapeType==SHAPE_SPHERE)
 		{
+			b3Vector3 radius = b3MakeVector3(collidable.m_radius,collidable.m_radius,collidable.m_radius);
+			aabbMin = bodies[b].m_pos-radius;
+			aabbMax = bodies[b].m_pos+radius;
+		} else
+		{
+			const b3SapAabb& localAabb = narrowphaseData->m_localShapeAABBCPU->at(bodies[b].m_collidableIdx);
+			b3Transform tr;
+			tr.setOrigin(bodies[b].m_pos);
+			tr.setRotation(bodies[b].m_quat);
+			b3TransformAabb(b3MakeVector3(localAabb.m_min[0],localAabb.m_min[1],localAabb.m_min[2]),
+				b3MakeVector3(localAabb.m_max[0],localAabb.m_max[1],localAabb.m_max[2]),0.f,tr,aabbMin,aabbMax);
+		}
+		m_data->m_bvhBodies.push_back(b);
+		m_data->m_bodyAabbMins.push_back(aabbMin);
+		m_data->m_bodyAabbMaxs.push_back(aabbMax);
+	}
+	int numBvhBodies = m_data->m_bvhBodies.size();
+	m_data->m_bodyBvh.build(numBvhBodies? &m_data->m_bodyAabbMins[0] : 0,numBvhBodies? &m_data->m_bodyAabbMaxs[0] : 0,numBvhBodies);
+}
 
-			hitResults[r].m_hitFraction = hitFraction;
-			hitResults[r].m_hitPoint.setInterpolate3(rays[r].m_from, rays[r].m_to,hitFraction);
-			hitResults[r].m_hitNormal = hitNormal;
-			hitResults[r].m_hitBody = hitBodyIndex;
+void b3GpuRaycast::castRaysHostChunks(int taskIndex, int numTasks, const b3CastRaysHostArgs& args)
+{
+	const b3RaycastBvh& bvh = m_data->m_bodyBvh;
+	const int* bvhBodies = m_data->m_bvhBodies.size()? &m_data->m_bvhBodies[0] : 0;
+	int packetWidth = m_data->m_rayPacketWidth;
+
+	for (int chunkBegin=taskIndex*B3_RAYCAST_HOST_CHUNK_SIZE;chunkBegin<args.m_numRays;chunkBegin+=numTasks*B3_RAYCAST_HOST_CHUNK_SIZE)
+	{
+		int chunkEnd = b3Min(chunkBegin+B3_RAYCAST_HOST_CHUNK_SIZE,args.m_numRays);
+		for (int r=chunkBegin;r<chunkEnd;)
+		{
+			int numPacketRays = b3Min(packetWidth,chunkEnd-r);
+#ifdef B3_USE_SSE
+			if (numPacketRays>1 && isRayPacketCoherent(&args.m_rays[r],numPacketRays))
+			{
+#ifdef B3_HAS_AVX2_TARGET
+				if (packetWidth==8)
+					castRayPacket<b3RayPacket8>(bvh,bvhBodies,args,r,numPacketRays);
+				else
+#endif
+					castRayPacket<b3RayPacket4>(bvh,bvhBodies,args,r,numPacketRays);
+				r += numPacketRays;
+				continue;
+			}
+#endif //B3_USE_SSE
+			//the rays of a diverging packet are cast one by one
+			for (int i=0;i<numPacketRays;i++,r++)
+			{
+				b3RayBodyCallback callback;
+				initRayCallback(callback,args.m_rays[r],bvhBodies,args);
+				b3Scalar hitFraction = args.m_hitResults[r].m_hitFraction;
+				bvh.rayTest(callback.m_rayFrom,callback.m_rayTo,hitFraction,callback);
+				writeRayHit(args.m_rays[r],callback,hitFraction,args.m_hitResults[r]);
+			}
 		}
+	}
+}
 
+void b3GpuRaycast::castRaysHost(const b3AlignedObjectArray<b3RayInfo>& rays,	b3AlignedObjectArray<b3RayHit>& hitResults,
+		int numBodies,const struct b3RigidBodyCL* bodies, int numCollidables,const struct b3Collidable* collidables, const struct b3GpuNarrowPhaseInternalData* narrowphaseData)
+{
+
+//	return castRays(rays,hitResults,numBodies,bodies,numCollidables,collidables);
+
+	B3_PROFILE("castRaysHost");
+	buildBodyBvh(numBodies,bodies,collidables,narrowphaseData);
+	if (!rays.size())
+		return;
+
+	b3CastRaysHostArgs args;
+	args.m_rays = &rays[0];
+	args.m_hitResults = &hitResults[0];
+	args.m_numRays = rays.size();
+	args.m_bodies = bodies;
+	args.m_collidables = collidables;
+	args.m_narrowphaseData = narrowphaseData;
+
+	int numChunks = (rays.size()+B3_RAYCAST_HOST_CHUNK_SIZE-1)/B3_RAYCAST_HOST_CHUNK_SIZE;
+	int numTasks = m_data->m_threadSupport? b3Min(m_data->m_threadSupport->getNumTasks(),numChunks) : 1;
+	if (numTasks<2)
+	{
+		castRaysHostChunks(0,1,args);
+		return;
+	}
+
+	//the tasks write the hits of their own rays straight into hitResults
+	b3AlignedObjectArray<b3CastRaysHostTask> tasks;
+	tasks.resize(numTasks);
+	for (int t=0;t<numTasks;t++)
+	{
+		tasks[t].m_raycaster = this;
+		tasks[t].m_args = &args;
+		tasks[t].m_taskIndex = t;
+		tasks[t].m_numTasks = numTasks;
+		m_data->m_threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+	}
+	for (int t=0;t<numTasks;t++)
+	{
+		int arg0,arg1;
+		m_data->m_threadSupport->waitForResponse(&arg0,&arg1);
 	}
 }
+
+void b3GpuRaycast::setThreadSupport(b3ThreadSupportInterface* threadSupport)
+{
+	m_data->m_threadSupport = threadSupport;
+}
+
+void b3GpuRaycast::setRayPacketWidth(int width)
+{
+	b3Assert(width==1 || width==4 || width==8);
+#ifdef B3_USE_SSE
+	//the 8 wide packets need AVX2 support of the cpu, not just of the compiler
+	if (width==8 && b3GetDefaultRayPacketWidth()!=8)
+		width = 4;
+#else
+	width = 1;
+#endif
+	m_data->m_rayPacketWidth = width;
+}
+
+int b3GpuRaycast::getRayPacketWidth() const
+{
+	return m_data->m_rayPacketWidth;
+}
 ///todo: add some acceleration structure (AABBs, tree etc)
 void b3GpuRaycast::castRays(const b3AlignedObjectArray<b3RayInfo>& rays,	b3AlignedObjectArray<b3RayHit>& hitResults,
 		int numBodies,const struct b3RigidBodyCL* bodies, int numCollidables, const struct b3Collidable* collidables, const struct b3GpuNarrowPhaseInternalData* narrowphaseData)
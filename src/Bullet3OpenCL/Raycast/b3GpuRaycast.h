@@ -13,14 +13,30 @@ class b3GpuRaycast
 {
 protected:
 	struct b3GpuRaycastInternalData* m_data;
+
+	void buildBodyBvh(int numBodies, const struct b3RigidBodyCL* bodies, const struct b3Collidable* collidables,
+		const struct b3GpuNarrowPhaseInternalData* narrowphaseData);
 public:
 	b3GpuRaycast(cl_context ctx,cl_device_id device, cl_command_queue  q);
 	virtual ~b3GpuRaycast();
 
+	///rays against the bodies on the host, through a tree over the world AABBs of the bodies that is rebuilt on each call.
+	///Coherent rays (same direction signs) traverse the tree in packets of getRayPacketWidth() rays, the others one by one
 	void castRaysHost(const b3AlignedObjectArray<b3RayInfo>& raysIn,	b3AlignedObjectArray<b3RayHit>& hitResults,
 		int numBodies, const struct b3RigidBodyCL* bodies, int numCollidables, const struct b3Collidable* collidables,
 		const struct b3GpuNarrowPhaseInternalData* narrowphaseData);
 
+	///castRaysHost splits the rays over the threads of threadSupport, which need to be created with b3ThreadTaskFunc and b3ThreadTaskLocalStoreFunc.
+	///Pass 0 to cast the rays on the calling thread
+	void setThreadSupport(class b3ThreadSupportInterface* threadSupport);
+
+	///rays per packet of castRaysHost: 8 with AVX2, 4 with SSE, 1 casts every ray on its own
+	void setRayPacketWidth(int width);
+	int getRayPacketWidth() const;
+
+	///internal method, casts the rays of the chunks of task taskIndex
+	void castRaysHostChunks(int taskIndex, int numTasks, const struct b3CastRaysHostArgs& args);
+
 	void castRays(const b3AlignedObjectArray<b3RayInfo>& rays,	b3AlignedObjectArray<b3RayHit>& hitResults,
 		int numBodies,const struct b3RigidBodyCL* bodies, int numCollidables, const struct b3Collidable* collidables,
 		const struct b3GpuNarrowPhaseInternalData* narrowphaseData
@@ -0,0 +1,92 @@
+
+#include "b3RaycastBvh.h"
+
+///partially sorts indices[begin,end) so that indices[nth] has the nth smallest center along axis, with smaller or equal ones before it
+static void b3SelectNthCenter(int* indices, const b3Vector3* centers, int axis, int begin, int end, int nth)
+{
+	while (end-begin>1)
+	{
+		b3Scalar pivot = centers[indices[(begin+end)/2]][axis];
+		int i = begin;
+		int j = end-1;
+		while (i<=j)
+		{
+			while (centers[indices[i]][axis]<pivot)
+				i++;
+			while (centers[indices[j]][axis]>pivot)
+				j--;
+			if (i<=j)
+			{
+				b3Swap(indices[i],indices[j]);
+				i++;
+				j--;
+			}
+		}
+		if (nth<=j)
+			end = j+1;
+		else if (nth>=i)
+			begin = i;
+		else
+			return;
+	}
+}
+
+void	b3RaycastBvh::build(const b3Vector3* aabbMins, const b3Vector3* aabbMaxs, int numObjects)
+{
+	clear();
+	if (!numObjects)
+		return;
+
+	m_objectIndices.resizeNoInitialize(numObjects);
+	m_centers.resizeNoInitialize(numObjects);
+	for (int i=0;i<numObjects;i++)
+	{
+		m_objectIndices[i] = i;
+		//twice the center, only the order matters
+		m_centers[i] = aabbMins[i]+aabbMaxs[i];
+	}
+	m_nodes.reserve(2*numObjects);
+	buildNode(aabbMins,aabbMaxs,0,numObjects);
+}
+
+int	b3RaycastBvh::buildNode(const b3Vector3* aabbMins, const b3Vector3* aabbMaxs, int begin, int end)
+{
+	int nodeIndex = m_nodes.size();
+	m_nodes.expandNonInitializing();
+
+	b3Vector3 aabbMin = aabbMins[m_objectIndices[begin]];
+	b3Vector3 aabbMax = aabbMaxs[m_objectIndices[begin]];
+	b3Vector3 centerMin = m_centers[m_objectIndices[begin]];
+	b3Vector3 centerMax = centerMin;
+	for (int i=begin+1;i<end;i++)
+	{
+		int object = m_objectIndices[i];
+		aabbMin.setMin(aabbMins[object]);
+		aabbMax.setMax(aabbMaxs[object]);
+		centerMin.setMin(m_centers[object]);
+		centerMax.setMax(m_centers[object]);
+	}
+	for (int i=0;i<3;i++)
+	{
+		m_nodes[nodeIndex].m_aabbMin[i] = aabbMin[i];
+		m_nodes[nodeIndex].m_aabbMax[i] = aabbMax[i];
+	}
+
+	int numObjects = end-begin;
+	if (numObjects<=B3_RAYCAST_BVH_MAX_LEAF_OBJECTS)
+	{
+		m_nodes[nodeIndex].m_childOrFirstObject = begin;
+		m_nodes[nodeIndex].m_numObjects = numObjects;
+		return nodeIndex;
+	}
+
+	int axis = (centerMax-centerMin).maxAxis();
+	int mid = begin+numObjects/2;
+	b3SelectNthCenter(&m_objectIndices[0],&m_centers[0],axis,begin,end,mid);
+
+	buildNode(aabbMins,aabbMaxs,begin,mid);
+	int secondChild = buildNode(aabbMins,aabbMaxs,mid,end);
+	m_nodes[nodeIndex].m_childOrFirstObject = secondChild;
+	m_nodes[nodeIndex].m_numObjects = 0;
+	return nodeIndex;
+}
@@ -0,0 +1,330 @@
+
+#ifndef B3_RAYCAST_BVH_H
+#define B3_RAYCAST_BVH_H
+
+#include "Bullet3Common/b3Vector3.h"
+#include "Bullet3Common/b3AlignedObjectArray.h"
+#include "Bullet3Common/b3CpuFeatures.h"
+
+#define B3_RAYCAST_BVH_MAX_LEAF_OBJECTS 2
+///the object median split keeps the depth below log2(numObjects)+1
+#define B3_RAYCAST_BVH_STACK_SIZE 64
+
+///node of a b3RaycastBvh, 32 bytes. The first child of an internal node directly follows it
+B3_ATTRIBUTE_ALIGNED16(struct) b3RaycastBvhNode
+{
+	float	m_aabbMin[3];
+	int		m_childOrFirstObject;//second child of an internal node, first entry in the object indices of a leaf
+	float	m_aabbMax[3];
+	int		m_numObjects;//0 for internal nodes
+
+	bool	isLeaf() const
+	{
+		return m_numObjects!=0;
+	}
+};
+
+///flattened AABB tree for ray queries, rebuilt from scratch over a set of object AABBs (typically once per frame).
+///The nodes are stored depth-first, the tree is built top-down with an object median split along the longest axis of the centers
+class b3RaycastBvh
+{
+	b3AlignedObjectArray<b3RaycastBvhNode>	m_nodes;
+	b3AlignedObjectArray<int>				m_objectIndices;
+	b3AlignedObjectArray<b3Vector3>			m_centers;
+
+	int		buildNode(const b3Vector3* aabbMins, const b3Vector3* aabbMaxs, int begin, int end);
+
+public:
+
+	///builds the tree over the objects [0,numObjects), the leaves refer to them by index
+	void	build(const b3Vector3* aabbMins, const b3Vector3* aabbMaxs, int numObjects);
+
+	void	clear()
+	{
+		m_nodes.resize(0);
+		m_objectIndices.resize(0);
+	}
+
+	int		getNumNodes() const
+	{
+		return m_nodes.size();
+	}
+	const b3RaycastBvhNode*	getNodes() const
+	{
+		return m_nodes.size()? &m_nodes[0] : 0;
+	}
+	const int*	getObjectIndices() const
+	{
+		return m_objectIndices.size()? &m_objectIndices[0] : 0;
+	}
+
+	///slab test of the ray rayFrom+t*(rayTo-rayFrom), t in [0,maxFraction], against the AABB of node.
+	///rayInvDir is 1/(rayTo-rayFrom) with B3_LARGE_FLOAT for zero components, see computeRayInvDir
+	static bool	rayAabb(const b3RaycastBvhNode& node, const b3Vector3& rayFrom, const b3Vector3& rayInvDir, b3Scalar maxFraction, b3Scalar& enterFraction)
+	{
+		b3Scalar tmin = 0.f;
+		b3Scalar tmax = maxFraction;
+		for (int i=0;i<3;i++)
+		{
+			b3Scalar t0 = (node.m_aabbMin[i]-rayFrom[i])*rayInvDir[i];
+			b3Scalar t1 = (node.m_aabbMax[i]-rayFrom[i])*rayInvDir[i];
+			if (t0>t1)
+				b3Swap(t0,t1);
+			tmin = t0>tmin? t0 : tmin;
+			tmax = t1<tmax? t1 : tmax;
+		}
+		enterFraction = tmin;
+		return tmin<=tmax;
+	}
+
+	static b3Vector3	computeRayInvDir(const b3Vector3& rayFrom, const b3Vector3& rayTo)
+	{
+		b3Vector3 rayDir = rayTo-rayFrom;
+		b3Vector3 rayInvDir;
+		rayInvDir.setValue(rayDir[0] == b3Scalar(0.0) ? b3Scalar(B3_LARGE_FLOAT) : b3Scalar(1.0) / rayDir[0],
+			rayDir[1] == b3Scalar(0.0) ? b3Scalar(B3_LARGE_FLOAT) : b3Scalar(1.0) / rayDir[1],
+			rayDir[2] == b3Scalar(0.0) ? b3Scalar(B3_LARGE_FLOAT) : b3Scalar(1.0) / rayDir[2]);
+		return rayInvDir;
+	}
+
+	///calls callback.processObject(objectIndex,hitFraction) for each object in a leaf that the ray reaches before hitFraction, nearest child first.
+	///The callback lowers hitFraction when it finds a closer hit, which prunes the remaining nodes. Re-entrant, the stack is local
+	template <class T>
+	void	rayTest(const b3Vector3& rayFrom, const b3Vector3& rayTo, b3Scalar& hitFraction, T& callback) const
+	{
+		if (!m_nodes.size())
+			return;
+		b3Vector3 rayInvDir = computeRayInvDir(rayFrom,rayTo);
+		b3Scalar enterFraction;
+		if (rayAabb(m_nodes[0],rayFrom,rayInvDir,hitFraction,enterFraction))
+			rayTestSubtree(0,rayFrom,rayInvDir,hitFraction,callback);
+	}
+
+	///rayTest below startNode, which the ray already overlaps
+	template <class T>
+	void	rayTestSubtree(int startNode, const b3Vector3& rayFrom, const b3Vector3& rayInvDir, b3Scalar& hitFraction, T& callback) const
+	{
+		int stack[B3_RAYCAST_BVH_STACK_SIZE];
+		b3Scalar stackEnterFractions[B3_RAYCAST_BVH_STACK_SIZE];
+		int depth = 0;
+		int nodeIndex = startNode;
+		for (;;)
+		{
+			const b3RaycastBvhNode& node = m_nodes[nodeIndex];
+			if (node.isLeaf())
+			{
+				for (int i=0;i<node.m_numObjects;i++)
+					callback.processObject(m_objectIndices[node.m_childOrFirstObject+i],hitFraction);
+			} else
+			{
+				int childA = nodeIndex+1;
+				int childB = node.m_childOrFirstObject;
+				b3Scalar enterA,enterB;
+				bool hitA = rayAabb(m_nodes[childA],rayFrom,rayInvDir,hitFraction,enterA);
+				bool hitB = rayAabb(m_nodes[childB],rayFrom,rayInvDir,hitFraction,enterB);
+				if (hitA && hitB)
+				{
+					if (enterB<enterA)
+					{
+						b3Swap(childA,childB);
+						b3Swap(enterA,enterB);
+					}
+					b3Assert(depth<B3_RAYCAST_BVH_STACK_SIZE);
+					stack[depth] = childB;
+					stackEnterFractions[depth] = enterB;
+					depth++;
+					nodeIndex = childA;
+					continue;
+				}
+				if (hitA || hitB)
+				{
+					nodeIndex = hitA? childA : childB;
+					continue;
+				}
+			}
+			//skip the nodes behind the closest hit so far
+			do
+			{
+				if (!depth)
+					return;
+				depth--;
+			} while (stackEnterFractions[depth]>hitFraction);
+			nodeIndex = stack[depth];
+		}
+	}
+
+	///rayTest of the rays of a packet (b3RayPacket4 or b3RayPacket8) with one callback per lane.
+	///The rays visit the nodes that any of them overlaps, a subtree that only one ray overlaps is left to rayTestSubtree
+	template <class P, class T>
+	void	rayTestPacket(P& packet, T* callbacks) const
+	{
+		if (!m_nodes.size())
+			return;
+		B3_ATTRIBUTE_ALIGNED16(float enterA[P::B3_NUM_LANES]);
+		B3_ATTRIBUTE_ALIGNED16(float enterB[P::B3_NUM_LANES]);
+		int mask = packet.intersect(m_nodes[0],enterA);
+		if (!mask)
+			return;
+
+		int stack[B3_RAYCAST_BVH_STACK_SIZE];
+		int depth = 0;
+		int nodeIndex = 0;
+		for (;;)
+		{
+			const b3RaycastBvhNode& node = m_nodes[nodeIndex];
+			if (node.isLeaf())
+			{
+				for (int lane=0;lane<P::B3_NUM_LANES;lane++)
+				{
+					if (!(mask&(1<<lane)))
+						continue;
+					for (int i=0;i<node.m_numObjects;i++)
+						callbacks[lane].processObject(m_objectIndices[node.m_childOrFirstObject+i],packet.m_hitFraction[lane]);
+				}
+			} else if (!(mask&(mask-1)))
+			{
+				int lane = 0;
+				while (!(mask&(1<<lane)))
+					lane++;
+				rayTestSubtree(nodeIndex,packet.getRayFrom(lane),packet.getRayInvDir(lane),packet.m_hitFraction[lane],callbacks[lane]);
+			} else
+			{
+				int childA = nodeIndex+1;
+				int childB = node.m_childOrFirstObject;
+				int maskA = packet.intersect(m_nodes[childA],enterA);
+				int maskB = packet.intersect(m_nodes[childB],enterB);
+				if (maskA && maskB)
+				{
+					if (getMinEnterFraction(enterB,maskB,P::B3_NUM_LANES)<getMinEnterFraction(enterA,maskA,P::B3_NUM_LANES))
+					{
+						b3Swap(childA,childB);
+						b3Swap(maskA,maskB);
+					}
+					b3Assert(depth<B3_RAYCAST_BVH_STACK_SIZE);
+					stack[depth++] = childB;
+					nodeIndex = childA;
+					mask = maskA;
+					continue;
+				}
+				if (maskA || maskB)
+				{
+					nodeIndex = maskA? childA : childB;
+					mask = maskA? maskA : maskB;
+					continue;
+				}
+			}
+			//the closer hits may have pruned the stacked nodes for some or all of the rays
+			do
+			{
+				if (!depth)
+					return;
+				nodeIndex = stack[--depth];
+				mask = packet.intersect(m_nodes[nodeIndex],enterA);
+			} while (!mask);
+		}
+	}
+
+	static float	getMinEnterFraction(const float* enterFractions, int mask, int numLanes)
+	{
+		float minEnter = B3_LARGE_FLOAT;
+		for (int lane=0;lane<numLanes;lane++)
+		{
+			if ((mask&(1<<lane)) && enterFractions[lane]<minEnter)
+				minEnter = enterFractions[lane];
+		}
+		return minEnter;
+	}
+};
+
+///rays in structure of arrays layout for b3RaycastBvh::rayTestPacket. Lanes without a ray keep a negative hit fraction
+template <int N>
+struct b3RayPacket
+{
+	enum
+	{
+		B3_NUM_LANES = N
+	};
+	B3_ATTRIBUTE_ALIGNED16(float m_rayFrom[3][N]);
+	B3_ATTRIBUTE_ALIGNED16(float m_rayInvDir[3][N]);
+	B3_ATTRIBUTE_ALIGNED16(float m_hitFraction[N]);
+
+	void	clear()
+	{
+		for (int lane=0;lane<N;lane++)
+		{
+			for (int i=0;i<3;i++)
+			{
+				m_rayFrom[i][lane] = 0.f;
+				m_rayInvDir[i][lane] = 0.f;
+			}
+			m_hitFraction[lane] = -1.f;
+		}
+	}
+	void	setRay(int lane, const b3Vector3& rayFrom, const b3Vector3& rayTo, b3Scalar hitFraction)
+	{
+		b3Vector3 rayInvDir = b3RaycastBvh::computeRayInvDir(rayFrom,rayTo);
+		for (int i=0;i<3;i++)
+		{
+			m_rayFrom[i][lane] = rayFrom[i];
+			m_rayInvDir[i][lane] = rayInvDir[i];
+		}
+		m_hitFraction[lane] = hitFraction;
+	}
+	b3Vector3	getRayFrom(int lane) const
+	{
+		return b3MakeVector3(m_rayFrom[0][lane],m_rayFrom[1][lane],m_rayFrom[2][lane]);
+	}
+	b3Vector3	getRayInvDir(int lane) const
+	{
+		return b3MakeVector3(m_rayInvDir[0][lane],m_rayInvDir[1][lane],m_rayInvDir[2][lane]);
+	}
+};
+
+#ifdef B3_USE_SSE
+///4 rays, the same slab test as b3RaycastBvh::rayAabb on SSE lanes
+struct b3RayPacket4 : public b3RayPacket<4>
+{
+	///returns the mask of the lanes that overlap node, enterFractions receives their entry fractions
+	int	intersect(const b3RaycastBvhNode& node, float* enterFractions) const
+	{
+		__m128 tmin = _mm_setzero_ps();
+		__m128 tmax = _mm_load_ps(m_hitFraction);
+		for (int i=0;i<3;i++)
+		{
+			__m128 rayFrom = _mm_load_ps(m_rayFrom[i]);
+			__m128 rayInvDir = _mm_load_ps(m_rayInvDir[i]);
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.m_aabbMin[i]),rayFrom),rayInvDir);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.m_aabbMax[i]),rayFrom),rayInvDir);
+			tmin = _mm_max_ps(tmin,_mm_min_ps(t0,t1));
+			tmax = _mm_min_ps(tmax,_mm_max_ps(t0,t1));
+		}
+		_mm_store_ps(enterFractions,tmin);
+		return _mm_movemask_ps(_mm_cmple_ps(tmin,tmax));
+	}
+};
+
+#ifdef B3_HAS_AVX2_TARGET
+///8 rays, only use it after b3CpuHasAvx2() returned true
+struct b3RayPacket8 : public b3RayPacket<8>
+{
+	B3_AVX2_TARGET int	intersect(const b3RaycastBvhNode& node, float* enterFractions) const
+	{
+		__m256 tmin = _mm256_setzero_ps();
+		__m256 tmax = _mm256_loadu_ps(m_hitFraction);
+		for (int i=0;i<3;i++)
+		{
+			__m256 rayFrom = _mm256_loadu_ps(m_rayFrom[i]);
+			__m256 rayInvDir = _mm256_loadu_ps(m_rayInvDir[i]);
+			__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.m_aabbMin[i]),rayFrom),rayInvDir);
+			__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.m_aabbMax[i]),rayFrom),rayInvDir);
+			tmin = _mm256_max_ps(tmin,_mm256_min_ps(t0,t1));
+			tmax = _mm256_min_ps(tmax,_mm256_max_ps(t0,t1));
+		}
+		_mm256_storeu_ps(enterFractions,tmin);
+		return _mm256_movemask_ps(_mm256_cmp_ps(tmin,tmax,_CMP_LE_OQ));
+	}
+};
+#endif //B3_HAS_AVX2_TARGET
+#endif //B3_USE_SSE
+
+#endif //B3_RAYCAST_BVH_H
@@ -62,7 +62,12 @@ typedef struct
 	int m_vertexOffset;
 	int	m_uniqueEdgesOffset;
 	int	m_numUniqueEdges;
-	int m_unused;
+	int m_vertexAdjacencyOffset;
+
+	int m_edgeOffset;
+	int m_numEdges;
+	int m_unused0;
+	int m_unused1;
 
 } ConvexPolyhedronCL;
 
@@ -311,7 +316,7 @@ __kernel void rayCastKernel(
 				if (rayConvex(rayFromLocal, rayToLocal, numFaces, faceOffset,faces, &hitFraction, &hitNormal))
 				{
 					hitBodyIndex = b;
-					
+					hitNormal = qtRotate(orn, hitNormal);
 				}
 			}
 		}
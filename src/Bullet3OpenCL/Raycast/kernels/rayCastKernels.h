@@ -53,7 +53,11 @@ static const char* rayCastKernelCL= \
 "	int m_vertexOffset;\n"
 "	int	m_uniqueEdgesOffset;\n"
 "	int	m_numUniqueEdges;\n"
-"	int m_unused;\n"
+"	int m_vertexAdjacencyOffset;\n"
+"	int m_edgeOffset;\n"
+"	int m_numEdges;\n"
+"	int m_unused0;\n"
+"	int m_unused1;\n"
 "} ConvexPolyhedronCL;\n"
 "typedef struct\n"
 "{\n"
@@ -257,7 +261,7 @@ static const char* rayCastKernelCL= \
 "				if (rayConvex(rayFromLocal, rayToLocal, numFaces, faceOffset,faces, &hitFraction, &hitNormal))\n"
 "				{\n"
 "					hitBodyIndex = b;\n"
-"					\n"
+"					hitNormal = qtRotate(orn, hitNormal);\n"
 "				}\n"
 "			}\n"
 "		}\n"
@@ -14,11 +14,21 @@ struct	b3Config
 	int	m_maxConvexVertices;
 	int m_maxConvexIndices;
 	int m_maxConvexUniqueEdges;
+	int m_maxConvexVertexAdjacency;
+	int m_maxConvexEdges;
+
+	//hulls with at least this many vertices get vertex adjacency for hill-climbing support queries
+	int m_minVerticesForHillClimbing;
 	
 	int	m_maxCompoundChildShapes;
 	
 	int m_maxTriConvexPairCapacity;
 
+	//convex-convex manifolds are re-projected instead of clipped while the relative transform of the pair
+	//moved less than these thresholds (in meters and radians) since the manifold was clipped, zero disables the cache
+	float	m_contactCacheLinearThreshold;
+	float	m_contactCacheAngularThreshold;
+
 	b3Config()
 		:m_maxConvexBodies(32*1024),
 		m_maxVerticesPerFace(64),
@@ -26,8 +36,13 @@ struct	b3Config
 		m_maxConvexVertices(8192),
 		m_maxConvexIndices(81920),
 		m_maxConvexUniqueEdges(8192),
+		m_maxConvexVertexAdjacency(65536),
+		m_maxConvexEdges(16384),
+		m_minVerticesForHillClimbing(16),
 		m_maxCompoundChildShapes(8192),
-		m_maxTriConvexPairCapacity(256*1024)
+		m_maxTriConvexPairCapacity(256*1024),
+		m_contactCacheLinearThreshold(0.002f),
+		m_contactCacheAngularThreshold(0.005f)
 	{
 		m_maxConvexShapes = m_maxConvexBodies;
 		m_maxBroadphasePairs = 16*m_maxConvexBodies;
@@ -3,6 +3,10 @@ bool b3GpuBatchContacts = true;
 bool b3GpuSolveConstraint = true;
 bool gpuRadixSort=true;
 bool gpuSetSortData = true;
+///host batching (b3GpuBatchContacts=false) with exact per-body conflicts, solved on the threads of setThreadSupport
+bool b3ExactCpuBatching = true;
+///the exact host batching starts from the batch of each contact pair in the previous frame
+bool b3ReuseCpuBatches = true;
 
 bool optionalSortContactsDeterminism = true;
 bool gpuSortContactsDeterminism = true;
@@ -17,6 +21,8 @@ bool gpuSortContactsDeterminism = true;
 #include "Bullet3OpenCL/Initialize/b3OpenCLUtils.h"
 #include "b3Config.h"
 #include "b3Solver.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
+#include "Bullet3Common/b3HashMap.h"
 
 
 #define B3_SOLVER_SETUP_KERNEL_PATH "src/Bullet3OpenCL/RigidBody/kernels/solverSetup.cl"
@@ -37,6 +43,350 @@ bool gpuSortContactsDeterminism = true;
 
 
 
+static void	b3NextBatchGeneration(b3AlignedObjectArray<unsigned int>& bodyStamps, unsigned int& generation)
+{
+	if (generation==0xffffffff)
+	{
+		for (int i=0;i<bodyStamps.size();i++)
+			bodyStamps[i] = 0;
+		generation = 0;
+	}
+	generation++;
+}
+
+///stable counting sort of the contacts of one cell by batch, batchCounts holds the number of contacts of each batch
+static void	b3SortContactsByBatch(b3Contact4* cs, int numConstraints, b3AlignedObjectArray<int>& batchCounts, b3AlignedObjectArray<b3Contact4>& scratch)
+{
+	int offset = 0;
+	for (int b=0;b<batchCounts.size();b++)
+	{
+		int count = batchCounts[b];
+		batchCounts[b] = offset;
+		offset += count;
+	}
+	scratch.resize(numConstraints);
+	for (int i=0;i<numConstraints;i++)
+	{
+		scratch[batchCounts[cs[i].getBatchIdx()]++] = cs[i];
+	}
+	if (numConstraints)
+		memcpy(cs,&scratch[0],sizeof(b3Contact4)*numConstraints);
+}
+
+///Greedy batching of the contacts of one cell, like sortConstraintByBatch3, but a body is used in the current
+///batch when its stamp equals the current generation. Starting a batch only increments the generation, so
+///the stamps are sized to the number of bodies, never cleared per cell and never alias.
+///The contacts are reordered by batch, keeping their order within a batch.
+static int	b3BatchContactsExact(b3Contact4* cs, int numConstraints, int simdWidth, int staticIdx,
+							b3AlignedObjectArray<unsigned int>& bodyStamps, unsigned int& generation,
+							b3AlignedObjectArray<int>& pending, b3AlignedObjectArray<int>& batchCounts, b3AlignedObjectArray<b3Contact4>& scratch)
+{
+	pending.resize(numConstraints);
+	for (int i=0;i<numConstraints;i++)
+		pending[i] = i;
+	batchCounts.resize(0);
+
+	int numPending = numConstraints;
+	int batchIdx = 0;
+	while (numPending)
+	{
+		b3NextBatchGeneration(bodyStamps,generation);
+
+		int numBatched = 0;
+		int nCurrentBatch = 0;
+		int numLeft = 0;
+		for (int i=0;i<numPending;i++)
+		{
+			int idx = pending[i];
+			int bodyAS = cs[idx].m_bodyAPtrAndSignBit;
+			int bodyBS = cs[idx].m_bodyBPtrAndSignBit;
+			int bodyA = abs(bodyAS);
+			int bodyB = abs(bodyBS);
+			bool aIsStatic = (bodyAS<0) || bodyAS==staticIdx;
+			bool bIsStatic = (bodyBS<0) || bodyBS==staticIdx;
+			b3Assert(aIsStatic || bodyA<bodyStamps.size());
+			b3Assert(bIsStatic || bodyB<bodyStamps.size());
+
+			bool aUnavailable = !aIsStatic && bodyStamps[bodyA]==generation;
+			bool bUnavailable = !bIsStatic && bodyStamps[bodyB]==generation;
+			if (aUnavailable || bUnavailable)
+			{
+				pending[numLeft++] = idx;
+				continue;
+			}
+			if (!aIsStatic)
+				bodyStamps[bodyA] = generation;
+			if (!bIsStatic)
+				bodyStamps[bodyB] = generation;
+			cs[idx].getBatchIdx() = batchIdx;
+			numBatched++;
+
+			nCurrentBatch++;
+			if (nCurrentBatch == simdWidth)
+			{
+				nCurrentBatch = 0;
+				generation++;
+			}
+		}
+		batchCounts.push_back(numBatched);
+		numPending = numLeft;
+		batchIdx++;
+	}
+
+	b3SortContactsByBatch(cs,numConstraints,batchCounts,scratch);
+	return batchIdx;
+}
+
+///identifies a contact pair across frames, to reuse its batch
+struct b3BatchPairKey
+{
+	int	m_bodyA;
+	int	m_bodyB;
+	int	m_childIndexA;
+	int	m_childIndexB;
+
+	b3BatchPairKey()
+	{
+	}
+
+	b3BatchPairKey(const b3Contact4& contact)
+		:m_bodyA(contact.m_bodyAPtrAndSignBit),
+		m_bodyB(contact.m_bodyBPtrAndSignBit),
+		m_childIndexA(contact.m_childIndexA),
+		m_childIndexB(contact.m_childIndexB)
+	{
+	}
+
+	unsigned int getHash() const
+	{
+		int key = m_bodyA ^ (m_bodyB<<16) ^ (m_bodyB>>16) ^ (m_childIndexA<<8) ^ (m_childIndexB<<24);
+		// Thomas Wang's hash, see b3HashInt
+		key += ~(key << 15);	key ^=  (key >> 10);	key +=  (key << 3);	key ^=  (key >> 6);	key += ~(key << 11);	key ^=  (key >> 16);
+		return key;
+	}
+
+	bool equals(const b3BatchPairKey& other) const
+	{
+		return m_bodyA==other.m_bodyA && m_bodyB==other.m_bodyB && m_childIndexA==other.m_childIndexA && m_childIndexB==other.m_childIndexB;
+	}
+};
+
+struct b3BatchPairUpdate
+{
+	b3BatchPairKey	m_key;
+	int				m_batchIdx;
+
+	b3BatchPairUpdate()
+	{
+	}
+
+	b3BatchPairUpdate(const b3BatchPairKey& key, int batchIdx)
+		:m_key(key),
+		m_batchIdx(batchIdx)
+	{
+	}
+};
+
+///the batches of a body are a bit mask, valid while its stamp equals the generation of the cell
+#define B3_MAX_REUSED_BATCHES 32
+
+static inline unsigned int	b3GetBodyBatchMask(int bodyS, int staticIdx, const b3AlignedObjectArray<unsigned int>& bodyStamps,
+							const b3AlignedObjectArray<unsigned int>& bodyMasks, unsigned int generation)
+{
+	if ((bodyS<0) || bodyS==staticIdx)
+		return 0;
+	return bodyStamps[bodyS]==generation ? bodyMasks[bodyS] : 0;
+}
+
+static inline void	b3AddBodyBatch(int bodyS, int staticIdx, b3AlignedObjectArray<unsigned int>& bodyStamps,
+							b3AlignedObjectArray<unsigned int>& bodyMasks, unsigned int generation, unsigned int batchBit)
+{
+	if ((bodyS<0) || bodyS==staticIdx)
+		return;
+	if (bodyStamps[bodyS]!=generation)
+	{
+		bodyStamps[bodyS] = generation;
+		bodyMasks[bodyS] = 0;
+	}
+	bodyMasks[bodyS] |= batchBit;
+}
+
+///Batches the contacts of one cell starting from the batch of their pair in the previous frame (batchHints, -1 for new pairs).
+///A contact keeps its batch when no earlier contact of that batch uses one of its dynamic bodies, the other contacts
+///go to the first batch that is free for both bodies. Empty batches are removed, keeping the order of the others.
+///Returns -1 when a contact needs more than B3_MAX_REUSED_BATCHES batches, then the cell is batched from scratch.
+///The pairs whose batch changed are appended to pairUpdates, the contacts are reordered by batch.
+static int	b3BatchContactsReuse(b3Contact4* cs, int numConstraints, int simdWidth, int staticIdx, const int* batchHints,
+							b3AlignedObjectArray<unsigned int>& bodyStamps, b3AlignedObjectArray<unsigned int>& bodyMasks, unsigned int& generation,
+							b3AlignedObjectArray<int>& pending, b3AlignedObjectArray<int>& batchCounts, b3AlignedObjectArray<b3Contact4>& scratch,
+							b3AlignedObjectArray<b3BatchPairUpdate>& pairUpdates)
+{
+	b3NextBatchGeneration(bodyStamps,generation);
+	batchCounts.resize(0);
+	batchCounts.resize(B3_MAX_REUSED_BATCHES,0);
+	unsigned int fullBatches = 0;
+	pending.resize(0);
+
+	for (int pass=0;pass<2;pass++)
+	{
+		int numContacts = pass==0? numConstraints : pending.size();
+		for (int j=0;j<numContacts;j++)
+		{
+			int i = pass==0? j : pending[j];
+			int bodyAS = cs[i].m_bodyAPtrAndSignBit;
+			int bodyBS = cs[i].m_bodyBPtrAndSignBit;
+			unsigned int used = fullBatches | b3GetBodyBatchMask(bodyAS,staticIdx,bodyStamps,bodyMasks,generation)
+				| b3GetBodyBatchMask(bodyBS,staticIdx,bodyStamps,bodyMasks,generation);
+
+			int batchIdx = -1;
+			if (pass==0)
+			{
+				int hint = batchHints[i];
+				if (hint<0 || hint>=B3_MAX_REUSED_BATCHES || (used & (1u<<hint)))
+				{
+					pending.push_back(i);
+					continue;
+				}
+				batchIdx = hint;
+			} else
+			{
+				if (used==0xffffffff)
+					return -1;
+				batchIdx = 0;
+				while (used & (1u<<batchIdx))
+					batchIdx++;
+			}
+
+			unsigned int batchBit = 1u<<batchIdx;
+			b3AddBodyBatch(bodyAS,staticIdx,bodyStamps,bodyMasks,generation,batchBit);
+			b3AddBodyBatch(bodyBS,staticIdx,bodyStamps,bodyMasks,generation,batchBit);
+			cs[i].getBatchIdx() = batchIdx;
+			if (++batchCounts[batchIdx] == simdWidth)
+				fullBatches |= batchBit;
+		}
+	}
+
+	int remap[B3_MAX_REUSED_BATCHES];
+	int numBatches = 0;
+	for (int b=0;b<B3_MAX_REUSED_BATCHES;b++)
+	{
+		remap[b] = numBatches;
+		if (batchCounts[b])
+			batchCounts[numBatches++] = batchCounts[b];
+	}
+	batchCounts.resize(numBatches);
+	for (int i=0;i<numConstraints;i++)
+	{
+		int batchIdx = remap[cs[i].getBatchIdx()];
+		cs[i].getBatchIdx() = batchIdx;
+		if (batchIdx!=batchHints[i])
+			pairUpdates.push_back(b3BatchPairUpdate(b3BatchPairKey(cs[i]),batchIdx));
+	}
+
+	b3SortContactsByBatch(cs,numConstraints,batchCounts,scratch);
+	return numBatches;
+}
+
+///batches the contacts of a list of cells, the cells are disjoint ranges of the contact array
+struct b3BatchCellsTask : public b3ThreadTask
+{
+	b3Contact4*	m_contacts;
+	const unsigned int*	m_numConstraints;
+	const unsigned int*	m_offsets;
+	int*	m_cellBatches;
+	int		m_simdWidth;
+	int		m_staticIdx;
+	int		m_maxNumBatches;
+	b3AlignedObjectArray<int>	m_cells;
+
+	//kept between frames, so the stamps are only cleared when the number of bodies changes
+	b3AlignedObjectArray<unsigned int>	m_bodyStamps;
+	unsigned int	m_generation;
+	b3AlignedObjectArray<int>	m_pending;
+	b3AlignedObjectArray<int>	m_batchCounts;
+	b3AlignedObjectArray<b3Contact4>	m_scratch;
+
+	///batch of each pair in the previous frame, only read by the tasks, 0 to batch from scratch
+	const b3HashMap<b3BatchPairKey,int>*	m_previousBatches;
+	b3AlignedObjectArray<unsigned int>	m_bodyBatchMasks;
+	b3AlignedObjectArray<int>	m_batchHints;
+	b3AlignedObjectArray<b3BatchPairUpdate>	m_pairUpdates;
+	int		m_numReusedContacts;
+
+	b3BatchCellsTask()
+		:m_generation(0),
+		m_previousBatches(0),
+		m_numReusedContacts(0)
+	{
+	}
+
+	void	setNumBodies(int numBodies)
+	{
+		if (m_bodyStamps.size()!=numBodies)
+		{
+			m_bodyStamps.resize(0);
+			m_bodyStamps.resize(numBodies,0);
+			m_bodyBatchMasks.resize(numBodies,0);
+			m_generation = 0;
+		}
+	}
+
+	virtual void	run(void* lsMemory)
+	{
+		m_maxNumBatches = 0;
+		m_numReusedContacts = 0;
+		m_pairUpdates.resize(0);
+		for (int c=0;c<m_cells.size();c++)
+		{
+			int cellIdx = m_cells[c];
+			b3Contact4* cs = m_contacts+m_offsets[cellIdx];
+			int numConstraints = m_numConstraints[cellIdx];
+			int numBatches = -1;
+			if (m_previousBatches)
+			{
+				m_batchHints.resize(numConstraints);
+				for (int i=0;i<numConstraints;i++)
+				{
+					const int* batchIdx = m_previousBatches->find(b3BatchPairKey(cs[i]));
+					m_batchHints[i] = batchIdx? *batchIdx : -1;
+				}
+				int numUpdates = m_pairUpdates.size();
+				numBatches = b3BatchContactsReuse(cs,numConstraints,m_simdWidth,m_staticIdx,&m_batchHints[0],
+					m_bodyStamps,m_bodyBatchMasks,m_generation,m_pending,m_batchCounts,m_scratch,m_pairUpdates);
+				if (numBatches>=0)
+				{
+					m_numReusedContacts += numConstraints-(m_pairUpdates.size()-numUpdates);
+				} else
+				{
+					m_pairUpdates.resize(numUpdates);
+				}
+			}
+			if (numBatches<0)
+			{
+				numBatches = b3BatchContactsExact(cs,numConstraints,m_simdWidth,m_staticIdx,
+					m_bodyStamps,m_generation,m_pending,m_batchCounts,m_scratch);
+				if (m_previousBatches)
+				{
+					for (int i=0;i<numConstraints;i++)
+						m_pairUpdates.push_back(b3BatchPairUpdate(b3BatchPairKey(cs[i]),cs[i].getBatchIdx()));
+				}
+			}
+			m_cellBatches[cellIdx] = numBatches;
+			m_maxNumBatches = b3Max(m_maxNumBatches,numBatches);
+		}
+	}
+};
+
+struct b3CellContactsSortPredicate
+{
+	const unsigned int* m_numConstraints;
+
+	bool operator() ( int a, int b ) const
+	{
+		return (m_numConstraints[a]>m_numConstraints[b]) || (m_numConstraints[a]==m_numConstraints[b] && a<b);
+	}
+};
+
 struct	b3GpuBatchingPgsSolverInternalData
 {
 	cl_context m_context;
@@ -64,7 +414,27 @@ struct	b3GpuBatchingPgsSolverInternalData
 	cl_kernel	m_setDeterminismSortDataBodyBKernel;
 	cl_kernel	m_setDeterminismSortDataChildShapeAKernel;
 	cl_kernel	m_setDeterminismSortDataChildShapeBKernel;
+	cl_kernel	m_setAxisHistogramKernel;
+
+	b3OpenCLArray<unsigned int>*	m_axisHistogramGPU;
+	b3AlignedObjectArray<unsigned int>	m_axisHistogramCPU;
+	bool	m_adaptiveCellSplit;
+	bool	m_collectCellStats;
+	b3BatchingCellStatistics	m_cellStats;
+
+	b3AlignedObjectArray<b3BatchCellsTask>	m_batchCellsTasks;
+	b3AlignedObjectArray<int>	m_cellBatches;
+	b3AlignedObjectArray<int>	m_batchCells;
+	b3AlignedObjectArray<int>	m_batchCellsTaskLoad;
+	///batch of each contact pair in the last frame of the exact host batching, entries of pairs that separated stay until the map is rebuilt
+	b3HashMap<b3BatchPairKey,int>	m_pairBatches;
+	int		m_numReusedContacts;
 
+	int		m_minNumIterations;
+	float	m_residualThreshold;
+	bool	m_collectIterationStats;
+	b3AlignedObjectArray<float>	m_residualCPU;
+	b3SolverIterationStats	m_iterationStats;
 
 
 
@@ -107,6 +477,22 @@ b3GpuBatchingPgsSolver::b3GpuBatchingPgsSolver(cl_context ctx,cl_device_id devic
 	m_data->m_pBufContactOutGPUCopy = new b3OpenCLArray<b3Contact4>(ctx,q);
 	m_data->m_contactKeyValues = new b3OpenCLArray<b3SortData>(ctx,q);
 
+	m_data->m_axisHistogramGPU = new b3OpenCLArray<unsigned int>(ctx,q,3*B3_SOLVER_N_AXIS_BINS);
+	m_data->m_axisHistogramGPU->resize(3*B3_SOLVER_N_AXIS_BINS);
+	m_data->m_adaptiveCellSplit = true;
+	m_data->m_collectCellStats = false;
+	m_data->m_cellStats.m_nSplit = b3MakeInt4(B3_SOLVER_N_SPLIT_X,B3_SOLVER_N_SPLIT_Y,B3_SOLVER_N_SPLIT_Z,0);
+	m_data->m_cellStats.m_numContacts = 0;
+	m_data->m_cellStats.m_numNonEmptyCells = 0;
+	m_data->m_cellStats.m_maxCellContacts = 0;
+	m_data->m_cellStats.m_averageCellContacts = 0.f;
+	m_data->m_cellStats.m_maxNumBatches = 0;
+	m_data->m_cellStats.m_numReusedContacts = -1;
+	m_data->m_numReusedContacts = -1;
+	m_data->m_minNumIterations = 1;
+	m_data->m_residualThreshold = 0.f;
+	m_data->m_collectIterationStats = false;
+
 
 	m_data->m_solverGPU = new b3Solver(ctx,device,q,512*1024);
 
@@ -170,6 +556,9 @@ b3GpuBatchingPgsSolver::b3GpuBatchingPgsSolver(cl_context ctx,cl_device_id devic
 		m_data->m_setSortDataKernel =  b3OpenCLUtils::compileCLKernelFromString( ctx, device, solverSetup2Source, "SetSortDataKernel", &pErrNum, solverSetup2Prog,additionalMacros );
 		b3Assert(m_data->m_setSortDataKernel);
 
+		m_data->m_setAxisHistogramKernel =  b3OpenCLUtils::compileCLKernelFromString( ctx, device, solverSetup2Source, "SetAxisHistogramKernel", &pErrNum, solverSetup2Prog,additionalMacros );
+		b3Assert(m_data->m_setAxisHistogramKernel);
+
 		m_data->m_setDeterminismSortDataBodyAKernel =  b3OpenCLUtils::compileCLKernelFromString( ctx, device, solverSetup2Source, "SetDeterminismSortDataBodyA", &pErrNum, solverSetup2Prog,additionalMacros );
 		b3Assert(m_data->m_setDeterminismSortDataBodyAKernel);
 
@@ -223,6 +612,7 @@ b3GpuBatchingPgsSolver::~b3GpuBatchingPgsSolver()
 	delete m_data->m_pBufContactOutGPU;
 	delete m_data->m_pBufContactOutGPUCopy;
 	delete m_data->m_contactKeyValues;
+	delete m_data->m_axisHistogramGPU;
 
 
 
@@ -252,6 +642,7 @@ b3GpuBatchingPgsSolver::~b3GpuBatchingPgsSolver()
 	clReleaseKernel(m_data->m_setDeterminismSortDataBodyBKernel);
 	clReleaseKernel(m_data->m_setDeterminismSortDataChildShapeAKernel);
 	clReleaseKernel(m_data->m_setDeterminismSortDataChildShapeBKernel);
+	clReleaseKernel(m_data->m_setAxisHistogramKernel);
 
 
 
@@ -299,6 +690,11 @@ void b3GpuBatchingPgsSolver::solveContactConstraint(  const b3OpenCLArray<b3Rigi
 
 
 
+		bool checkResidual = m_data->m_residualThreshold>0.f;
+		bool readResidual = checkResidual || m_data->m_collectIterationStats;
+		m_data->m_iterationStats.reset();
+		int numContactIterations = 0;
+
 		{
 
 			B3_PROFILE("m_batchSolveKernel iterations");
@@ -324,7 +720,8 @@ void b3GpuBatchingPgsSolver::solveContactConstraint(  const b3OpenCLArray<b3Rigi
 						b3BufferInfoCL( shapeBuf->getBufferCL() ), 
 						b3BufferInfoCL( constraint->getBufferCL() ),
 						b3BufferInfoCL( m_data->m_solverGPU->m_numConstraints->getBufferCL() ), 
-						b3BufferInfoCL( m_data->m_solverGPU->m_offsets->getBufferCL() ) 
+						b3BufferInfoCL( m_data->m_solverGPU->m_offsets->getBufferCL() ),
+						b3BufferInfoCL( m_data->m_solverGPU->m_residual->getBufferCL() )
 #ifdef DEBUG_ME
 						,	b3BufferInfoCL(&gpuDebugInfo)
 #endif
@@ -336,12 +733,10 @@ void b3GpuBatchingPgsSolver::solveContactConstraint(  const b3OpenCLArray<b3Rigi
 					//launcher.setConst(  cdata.x );
                     launcher.setConst(  cdata.y );
                     launcher.setConst(  cdata.z );
-					b3Int4 nSplit;
-					nSplit.x = B3_SOLVER_N_SPLIT_X;
-					nSplit.y = B3_SOLVER_N_SPLIT_Y;
-					nSplit.z = B3_SOLVER_N_SPLIT_Z;
+					b3Int4 nSplit = m_data->m_solverGPU->m_nSplit;
 
                     launcher.setConst(  nSplit );
+                    launcher.setConst(  m_data->m_solverGPU->m_blockContactSolve? 1 : 0 );
                     launcher.launch1D( numWorkItems, 64 );
 
                     
@@ -391,7 +786,20 @@ void b3GpuBatchingPgsSolver::solveContactConstraint(  const b3OpenCLArray<b3Rigi
 
 
 				}
+				numContactIterations = iter+1;
+
+				if (readResidual)
+				{
+					b3SolverResidual residual = readContactResidual();
+					m_data->m_iterationStats.m_residuals.push_back(residual);
+					if (checkResidual && numContactIterations>=m_data->m_minNumIterations && residual.m_maxDeltaImpulse<m_data->m_residualThreshold)
+					{
+						m_data->m_iterationStats.m_converged = true;
+						break;
+					}
+				}
 			}
+			m_data->m_iterationStats.m_numIterations = numContactIterations;
 		
 			clFinish(m_data->m_queue);
 
@@ -403,7 +811,7 @@ void b3GpuBatchingPgsSolver::solveContactConstraint(  const b3OpenCLArray<b3Rigi
 		if (applyFriction)
     	{
 			B3_PROFILE("m_batchSolveKernel iterations2");
-			for(int iter=0; iter<numIterations; iter++)
+			for(int iter=0; iter<numContactIterations; iter++)
 			{
 				for(int ib=0; ib<B3_SOLVER_N_BATCHES; ib++)
 				{
@@ -426,10 +834,7 @@ void b3GpuBatchingPgsSolver::solveContactConstraint(  const b3OpenCLArray<b3Rigi
                     launcher.setConst(  cdata.y );
                     launcher.setConst(  cdata.z );
 
-                    b3Int4 nSplit;
-					nSplit.x = B3_SOLVER_N_SPLIT_X;
-					nSplit.y = B3_SOLVER_N_SPLIT_Y;
-					nSplit.z = B3_SOLVER_N_SPLIT_Z;
+                    b3Int4 nSplit = m_data->m_solverGPU->m_nSplit;
 
                     launcher.setConst(  nSplit );
                     
@@ -568,6 +973,173 @@ void SetSortDataCPU(b3Contact4* gContact, b3RigidBodyCL* gBodies, b3SortData* gS
 
 
 
+void	b3GpuBatchingPgsSolver::setThreadSupport(b3ThreadSupportInterface* threadSupport)
+{
+	m_data->m_solverGPU->setThreadSupport(threadSupport);
+}
+
+void	b3GpuBatchingPgsSolver::setAdaptiveCellSplit(bool adaptive)
+{
+	m_data->m_adaptiveCellSplit = adaptive;
+	if (!adaptive)
+	{
+		m_data->m_solverGPU->m_nSplit = b3MakeInt4(B3_SOLVER_N_SPLIT_X,B3_SOLVER_N_SPLIT_Y,B3_SOLVER_N_SPLIT_Z,0);
+	}
+}
+
+bool	b3GpuBatchingPgsSolver::getAdaptiveCellSplit() const
+{
+	return m_data->m_adaptiveCellSplit;
+}
+
+void	b3GpuBatchingPgsSolver::setCollectCellStatistics(bool collect)
+{
+	m_data->m_collectCellStats = collect;
+}
+
+const b3BatchingCellStatistics&	b3GpuBatchingPgsSolver::getCellStatistics() const
+{
+	return m_data->m_cellStats;
+}
+
+void	b3GpuBatchingPgsSolver::setNumIterations(int numIterations)
+{
+	m_data->m_nIterations = numIterations;
+}
+
+int		b3GpuBatchingPgsSolver::getNumIterations() const
+{
+	return m_data->m_nIterations;
+}
+
+void	b3GpuBatchingPgsSolver::setResidualThreshold(float threshold, int minNumIterations)
+{
+	m_data->m_residualThreshold = threshold;
+	m_data->m_minNumIterations = minNumIterations;
+}
+
+float	b3GpuBatchingPgsSolver::getResidualThreshold() const
+{
+	return m_data->m_residualThreshold;
+}
+
+void	b3GpuBatchingPgsSolver::setCollectIterationStatistics(bool collect)
+{
+	m_data->m_collectIterationStats = collect;
+}
+
+const b3SolverIterationStats&	b3GpuBatchingPgsSolver::getIterationStats() const
+{
+	return m_data->m_iterationStats;
+}
+
+void	b3GpuBatchingPgsSolver::setBlockContactSolve(bool blockSolve)
+{
+	m_data->m_solverGPU->m_blockContactSolve = blockSolve;
+}
+
+bool	b3GpuBatchingPgsSolver::getBlockContactSolve() const
+{
+	return m_data->m_solverGPU->m_blockContactSolve;
+}
+
+///merges the residuals that each work group of BatchSolveKernelContact wrote for each cell batch of the last iteration
+b3SolverResidual	b3GpuBatchingPgsSolver::readContactResidual()
+{
+	m_data->m_solverGPU->m_residual->copyToHost(m_data->m_residualCPU);
+	b3SolverResidual residual;
+	for (int i=0;i<B3_SOLVER_N_CELLS;i++)
+	{
+		const float* groupResidual = &m_data->m_residualCPU[4*i];
+		residual.m_maxDeltaImpulse = b3Max(residual.m_maxDeltaImpulse,groupResidual[0]);
+		residual.m_sumSquaredDeltaImpulse += groupResidual[1];
+		residual.m_numRows += int(groupResidual[2]);
+	}
+	return residual;
+}
+
+///sum of the squared contact counts when the B3_SOLVER_N_AXIS_BINS bins of one axis are folded into nSplit cells
+static double	b3AxisSplitCost(const unsigned int* axisBins, int nSplit)
+{
+	unsigned int folded[B3_SOLVER_N_AXIS_BINS];
+	for (int i=0;i<nSplit;i++)
+		folded[i] = 0;
+	for (int i=0;i<B3_SOLVER_N_AXIS_BINS;i++)
+		folded[i&(nSplit-1)] += axisBins[i];
+	double cost = 0;
+	for (int i=0;i<nSplit;i++)
+		cost += double(folded[i])*double(folded[i]);
+	return cost;
+}
+
+static int	b3SplitIndex(int nSplit)
+{
+	int k=0;
+	while ((2<<k)<nSplit)
+		k++;
+	return k;
+}
+
+///Picks the split with x*y*z = B3_SOLVER_N_CELLS that minimizes the sum of the squared cell counts,
+///estimated as the product of the per-axis costs. The cell size stays the same, a cell batch still needs
+///every other cell along each axis, so each split is an even power of two.
+void	b3GpuBatchingPgsSolver::chooseCellSplit(int numContacts, float scale, int staticIdx)
+{
+	B3_PROFILE("chooseCellSplit");
+	b3Solver* solver = m_data->m_solverGPU;
+
+	m_data->m_axisHistogramCPU.resize(0);
+	m_data->m_axisHistogramCPU.resize(3*B3_SOLVER_N_AXIS_BINS,0);
+	m_data->m_axisHistogramGPU->copyFromHost(m_data->m_axisHistogramCPU);
+	{
+		int sortSize = B3NEXTMULTIPLEOF( numContacts, 64 );
+		b3BufferInfoCL bInfo[] = { b3BufferInfoCL( m_data->m_pBufContactOutGPU->getBufferCL() ), b3BufferInfoCL( m_data->m_bodyBufferGPU->getBufferCL()), b3BufferInfoCL( m_data->m_axisHistogramGPU->getBufferCL()) };
+		b3LauncherCL launcher(m_data->m_queue, m_data->m_setAxisHistogramKernel );
+		launcher.setBuffers( bInfo, sizeof(bInfo)/sizeof(b3BufferInfoCL) );
+		launcher.setConst( numContacts );
+		launcher.setConst( scale );
+		launcher.setConst( staticIdx );
+		launcher.launch1D( sortSize, 64 );
+	}
+	m_data->m_axisHistogramGPU->copyToHost(m_data->m_axisHistogramCPU);
+	const unsigned int* bins = &m_data->m_axisHistogramCPU[0];
+
+	//costs[axis][k] for a split of 2<<k cells
+	const int numSplits = 6;
+	b3Assert((2<<(numSplits-1))==B3_SOLVER_N_AXIS_BINS);
+	double costs[3][numSplits];
+	for (int axis=0;axis<3;axis++)
+	{
+		for (int k=0;k<numSplits;k++)
+		{
+			costs[axis][k] = b3AxisSplitCost(bins+axis*B3_SOLVER_N_AXIS_BINS,2<<k);
+		}
+	}
+
+	//the default split wins ties, so uniform scenes keep it
+	b3Int4 bestSplit = b3MakeInt4(B3_SOLVER_N_SPLIT_X,B3_SOLVER_N_SPLIT_Y,B3_SOLVER_N_SPLIT_Z,0);
+	double bestCost = costs[0][b3SplitIndex(bestSplit.x)]*costs[1][b3SplitIndex(bestSplit.y)]*costs[2][b3SplitIndex(bestSplit.z)];
+
+	//(kx+1)+(ky+1)+(kz+1) = log2(B3_SOLVER_N_CELLS)
+	int log2Cells = b3SplitIndex(B3_SOLVER_N_CELLS)+1;
+	for (int kx=0;kx<numSplits;kx++)
+	{
+		for (int ky=0;ky<numSplits;ky++)
+		{
+			int kz = log2Cells-3-kx-ky;
+			if (kz<0 || kz>=numSplits)
+				continue;
+			double cost = costs[0][kx]*costs[1][ky]*costs[2][kz];
+			if (cost<bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b3MakeInt4(2<<kx,2<<ky,2<<kz,0);
+			}
+		}
+	}
+	solver->m_nSplit = bestSplit;
+}
+
 void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem inertiaBuf, int numContacts, cl_mem contactBuf, const b3Config& config, int static0Index)
 {
 	B3_PROFILE("solveContacts");
@@ -733,6 +1305,10 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
                         b3OpenCLArray<unsigned int>* countsNative = m_data->m_solverGPU->m_numConstraints;
                         b3OpenCLArray<unsigned int>* offsetsNative = m_data->m_solverGPU->m_offsets;
 
+						if (m_data->m_adaptiveCellSplit && nContacts)
+						{	//	1. pick the cell split from the contact distribution
+							chooseCellSplit(nContacts,1.f/csCfg.m_batchCellSize,csCfg.m_staticIdx);
+						}
 						
 						if (gpuSetSortData)
                         {	//	2. set cell idx
@@ -750,9 +1326,7 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
                             cdata.m_nContacts = nContacts;
                             cdata.m_staticIdx = csCfg.m_staticIdx;
                             cdata.m_scale = 1.f/csCfg.m_batchCellSize;
-                            cdata.m_nSplit.x = B3_SOLVER_N_SPLIT_X;
-							cdata.m_nSplit.y = B3_SOLVER_N_SPLIT_Y;
-							cdata.m_nSplit.z = B3_SOLVER_N_SPLIT_Z;
+                            cdata.m_nSplit = m_data->m_solverGPU->m_nSplit;
                             
                             m_data->m_solverGPU->m_sortDataBuffer->resize(nContacts);
                             
@@ -778,10 +1352,7 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
 							b3AlignedObjectArray<b3RigidBodyCL> bodiesCPU;
 							bodyBuf->copyToHost(bodiesCPU);
 							float scale = 1.f/csCfg.m_batchCellSize;
-							b3Int4 nSplit;
-							nSplit.x = B3_SOLVER_N_SPLIT_X;
-							nSplit.y = B3_SOLVER_N_SPLIT_Y;
-							nSplit.z = B3_SOLVER_N_SPLIT_Z;
+							b3Int4 nSplit = m_data->m_solverGPU->m_nSplit;
 
 							SetSortDataCPU(&contactCPU[0],  &bodiesCPU[0], &sortDataCPU[0], nContacts,scale,nSplit,csCfg.m_staticIdx);
 
@@ -829,6 +1400,30 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
                             m_data->m_solverGPU->m_scan->execute(*countsNative,*offsetsNative, B3_SOLVER_N_CELLS);//,&sum );
                             //printf("sum = %d\n",sum);
                         } 
+
+						if (m_data->m_collectCellStats)
+						{
+							B3_PROFILE("cell statistics");
+							b3BatchingCellStatistics& stats = m_data->m_cellStats;
+							countsNative->copyToHost(stats.m_cellContacts);
+							stats.m_nSplit = m_data->m_solverGPU->m_nSplit;
+							stats.m_numContacts = nContacts;
+							stats.m_numNonEmptyCells = 0;
+							stats.m_maxCellContacts = 0;
+							for (int i=0;i<stats.m_cellContacts.size();i++)
+							{
+								int n = stats.m_cellContacts[i];
+								if (n)
+								{
+									stats.m_numNonEmptyCells++;
+									stats.m_maxCellContacts = b3Max(stats.m_maxCellContacts,n);
+								}
+							}
+							stats.m_averageCellContacts = stats.m_numNonEmptyCells? float(nContacts)/float(stats.m_numNonEmptyCells) : 0.f;
+							stats.m_maxNumBatches = -1;
+							stats.m_cellBatches.resize(0);
+							stats.m_numReusedContacts = -1;
+						}
                         
                         
                         
@@ -910,6 +1505,12 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
                     
 						int numNonzeroGrid=0;
                     
+						if (b3ExactCpuBatching)
+						{
+							B3_PROFILE("exact batch grid");
+							int simdWidth = numBodies+1;
+							maxNumBatches = batchCellsExact(&cpuContacts[0],&nNativeHost[0],&offsetsNativeHost[0],numBodies,simdWidth,csCfg.m_staticIdx);
+						} else
 						{
 							B3_PROFILE("batch grid");
 							for(int i=0; i<B3_SOLVER_N_CELLS; i++)
@@ -945,6 +1546,15 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
 								}
 							}
 						}
+						if (m_data->m_collectCellStats)
+						{
+							m_data->m_cellStats.m_maxNumBatches = maxNumBatches;
+							if (b3ExactCpuBatching)
+							{
+								m_data->m_cellStats.m_cellBatches = m_data->m_cellBatches;
+								m_data->m_cellStats.m_numReusedContacts = m_data->m_numReusedContacts;
+							}
+						}
 						{
 							B3_PROFILE("m_contactBuffer->copyFromHost");
 							m_data->m_solverGPU->m_contactBuffer2->copyFromHost((b3AlignedObjectArray<b3Contact4>&)cpuContacts);
@@ -978,7 +1588,7 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
         
         if (1)
         {
-			int numIter = 4;
+			int numIter = m_data->m_nIterations;
 
             m_data->m_solverGPU->m_nIterations = numIter;//10
 			if (b3GpuSolveConstraint)
@@ -1028,6 +1638,110 @@ void b3GpuBatchingPgsSolver::solveContacts(int numBodies, cl_mem bodyBuf, cl_mem
 }
 
 
+int	b3GpuBatchingPgsSolver::batchCellsExact(b3Contact4* contacts, const unsigned int* numConstraints, const unsigned int* offsets, int numBodies, int simdWidth, int staticIdx)
+{
+	b3ThreadSupportInterface* threadSupport = m_data->m_solverGPU->m_threadSupport;
+	int numTasks = threadSupport? threadSupport->getNumTasks() : 1;
+
+	m_data->m_cellBatches.resize(0);
+	m_data->m_cellBatches.resize(B3_SOLVER_N_CELLS,0);
+
+	b3AlignedObjectArray<b3BatchCellsTask>& tasks = m_data->m_batchCellsTasks;
+	if (tasks.size()!=numTasks)
+		tasks.resize(numTasks);
+	//the map is only read while the tasks run
+	if (!b3ReuseCpuBatches)
+		m_data->m_pairBatches.clear();
+	for (int t=0;t<numTasks;t++)
+	{
+		tasks[t].m_previousBatches = b3ReuseCpuBatches? &m_data->m_pairBatches : 0;
+		tasks[t].m_contacts = contacts;
+		tasks[t].m_numConstraints = numConstraints;
+		tasks[t].m_offsets = offsets;
+		tasks[t].m_cellBatches = &m_data->m_cellBatches[0];
+		tasks[t].m_simdWidth = simdWidth;
+		tasks[t].m_staticIdx = staticIdx;
+		tasks[t].m_cells.resize(0);
+		tasks[t].setNumBodies(numBodies);
+	}
+
+	//the non-empty cells go to the least loaded task, largest cells first
+	b3AlignedObjectArray<int>& cells = m_data->m_batchCells;
+	cells.resize(0);
+	for (int i=0;i<B3_SOLVER_N_CELLS;i++)
+	{
+		if (numConstraints[i])
+			cells.push_back(i);
+	}
+	b3CellContactsSortPredicate predicate;
+	predicate.m_numConstraints = numConstraints;
+	cells.quickSort(predicate);
+
+	b3AlignedObjectArray<int>& taskLoad = m_data->m_batchCellsTaskLoad;
+	taskLoad.resize(0);
+	taskLoad.resize(numTasks,0);
+	for (int c=0;c<cells.size();c++)
+	{
+		int task = 0;
+		for (int t=1;t<numTasks;t++)
+		{
+			if (taskLoad[t]<taskLoad[task])
+				task = t;
+		}
+		tasks[task].m_cells.push_back(cells[c]);
+		taskLoad[task] += numConstraints[cells[c]];
+	}
+
+	if (numTasks>1)
+	{
+		for (int t=0;t<numTasks;t++)
+			threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+		for (int t=0;t<numTasks;t++)
+		{
+			int arg0,arg1;
+			threadSupport->waitForResponse(&arg0,&arg1);
+		}
+	} else
+	{
+		tasks[0].run(0);
+	}
+
+	int maxNumBatches = 0;
+	for (int t=0;t<numTasks;t++)
+		maxNumBatches = b3Max(maxNumBatches,tasks[t].m_maxNumBatches);
+
+	m_data->m_numReusedContacts = -1;
+	if (b3ReuseCpuBatches)
+	{
+		B3_PROFILE("update pair batches");
+		int numContacts = 0;
+		m_data->m_numReusedContacts = 0;
+		for (int i=0;i<B3_SOLVER_N_CELLS;i++)
+			numContacts += numConstraints[i];
+		for (int t=0;t<numTasks;t++)
+			m_data->m_numReusedContacts += tasks[t].m_numReusedContacts;
+
+		b3HashMap<b3BatchPairKey,int>& pairBatches = m_data->m_pairBatches;
+		if (pairBatches.size() > 2*numContacts+1024)
+		{
+			//drop the pairs that separated, the contacts of all cells are contiguous
+			pairBatches.clear();
+			for (int i=0;i<numContacts;i++)
+				pairBatches.insert(b3BatchPairKey(contacts[i]),contacts[i].getBatchIdx());
+		} else
+		{
+			//only the pairs that are new or changed batch
+			for (int t=0;t<numTasks;t++)
+			{
+				const b3AlignedObjectArray<b3BatchPairUpdate>& updates = tasks[t].m_pairUpdates;
+				for (int u=0;u<updates.size();u++)
+					pairBatches.insert(updates[u].m_key,updates[u].m_batchIdx);
+			}
+		}
+	}
+	return maxNumBatches;
+}
+
 void b3GpuBatchingPgsSolver::batchContacts( b3OpenCLArray<b3Contact4>* contacts, int nContacts, b3OpenCLArray<unsigned int>* n, b3OpenCLArray<unsigned int>* offsets, int staticIdx )
 {
 }
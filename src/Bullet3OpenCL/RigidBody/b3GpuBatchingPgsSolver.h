@@ -7,6 +7,27 @@
 #include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
 #include "Bullet3Collision/NarrowPhaseCollision/b3Contact4.h"
 #include "b3GpuConstraint4.h"
+#include "Bullet3Common/shared/b3Int4.h"
+#include "Bullet3Dynamics/ConstraintSolver/b3SolverIterationStats.h"
+
+///per-cell occupancy of the contacts of the last solveContacts call, see b3GpuBatchingPgsSolver::setCollectCellStatistics
+struct b3BatchingCellStatistics
+{
+	b3Int4	m_nSplit;
+	int		m_numContacts;
+	int		m_numNonEmptyCells;
+	int		m_maxCellContacts;
+	///average number of contacts of the non-empty cells
+	float	m_averageCellContacts;
+	///-1 when the contacts are batched on the GPU
+	int		m_maxNumBatches;
+	///B3_SOLVER_N_CELLS contact counts
+	b3AlignedObjectArray<unsigned int>	m_cellContacts;
+	///B3_SOLVER_N_CELLS batch counts, only filled by the exact host batching (b3ExactCpuBatching)
+	b3AlignedObjectArray<int>	m_cellBatches;
+	///contacts that kept the batch of their pair in the previous frame, -1 unless the exact host batching reuses batches (b3ReuseCpuBatches)
+	int		m_numReusedContacts;
+};
 
 class b3GpuBatchingPgsSolver
 {
@@ -21,9 +42,15 @@ protected:
 	inline int sortConstraintByBatch( b3Contact4* cs, int n, int simdWidth , int staticIdx, int numBodies);
 	inline int sortConstraintByBatch2( b3Contact4* cs, int n, int simdWidth , int staticIdx, int numBodies);
 	inline int sortConstraintByBatch3( b3Contact4* cs, int n, int simdWidth , int staticIdx, int numBodies);
+
+	///batches all cells with exact per-body conflicts, in parallel over the cells, returns the largest number of batches of a cell
+	int	batchCellsExact(b3Contact4* contacts, const unsigned int* numConstraints, const unsigned int* offsets, int numBodies, int simdWidth, int staticIdx);
 	
 
 
+	void	chooseCellSplit(int numContacts, float scale, int staticIdx);
+	b3SolverResidual	readContactResidual();
+
 	void solveContactConstraint(  const b3OpenCLArray<b3RigidBodyCL>* bodyBuf, const b3OpenCLArray<b3InertiaCL>* shapeBuf, 
 			b3OpenCLArray<b3GpuConstraint4>* constraint, void* additionalData, int n ,int maxNumBatches, int numIterations);
 
@@ -34,6 +61,36 @@ public:
 
 	void solveContacts(int numBodies, cl_mem bodyBuf, cl_mem inertiaBuf, int numContacts, cl_mem contactBuf, const struct b3Config& config, int static0Index);
 
+	///the host version of the batched solver (b3GpuSolveConstraint=false) solves the cells of each cell batch on these threads, see b3Solver::setThreadSupport
+	void	setThreadSupport(class b3ThreadSupportInterface* threadSupport);
+
+	///the cell split along x, y and z is picked each frame from the contact distribution, so that tall stacks and
+	///spread-out scenes fill the cells evenly. Disabled it uses the fixed B3_SOLVER_N_SPLIT_X/Y/Z split
+	void	setAdaptiveCellSplit(bool adaptive);
+	bool	getAdaptiveCellSplit() const;
+
+	///reads back the per-cell contact counts each frame, off by default
+	void	setCollectCellStatistics(bool collect);
+	const b3BatchingCellStatistics&	getCellStatistics() const;
+
+	///maximum number of contact iterations, the friction rows run as many iterations as the contacts. 4 by default
+	void	setNumIterations(int numIterations);
+	int		getNumIterations() const;
+
+	///stops the contact iterations once the largest delta impulse of an iteration is below threshold, after at least minNumIterations.
+	///0 disables the early exit. The residual is read back after each iteration, which waits for the device
+	void	setResidualThreshold(float threshold, int minNumIterations=1);
+	float	getResidualThreshold() const;
+
+	///reads back the residual of each contact iteration also without a threshold, off by default
+	void	setCollectIterationStatistics(bool collect);
+	const b3SolverIterationStats&	getIterationStats() const;
+
+	///solves the normal impulses of the up to 4 points of each contact constraint together with a small LCP instead of one by one.
+	///Contact stacks settle in fewer iterations at a higher cost per constraint, off by default
+	void	setBlockContactSolve(bool blockSolve);
+	bool	getBlockContactSolve() const;
+
 };
 
 #endif //B3_GPU_BATCHING_PGS_SOLVER_H
@@ -18,6 +18,7 @@ subject to the following restrictions:
 
 #include <new>
 #include "Bullet3Common/b3Transform.h"
+#include "Bullet3Common/b3TransformUtil.h"
 
 void b3GpuGenericConstraint::getInfo1 (unsigned int* info,const b3RigidBodyCL* bodies)
 {
@@ -28,6 +29,12 @@ void b3GpuGenericConstraint::getInfo1 (unsigned int* info,const b3RigidBodyCL* b
 			*info = 3;
 			break;
 		};
+	case B3_GPU_FIXED_CONSTRAINT_TYPE:
+	case B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE:
+		{
+			*info = 6;
+			break;
+		};
 		default:
 		{
 			b3Assert(0);
@@ -120,6 +127,134 @@ void getInfo2Point2Point(b3GpuGenericConstraint* constraint, b3GpuConstraintInfo
 
 }
 
+void getInfo2FixedOrientation(b3GpuGenericConstraint* constraint, b3GpuConstraintInfo2* info,  const b3RigidBodyCL* bodies, int start_row)
+{
+	b3Quaternion worldOrnA = bodies[constraint->m_rbA].m_quat;
+	b3Quaternion worldOrnB = bodies[constraint->m_rbB].m_quat;
+
+	int s = info->rowskip;
+	int start_index = start_row * s;
+
+	// 3 rows to make body rotations equal
+	info->m_J1angularAxis[start_index] = 1;
+	info->m_J1angularAxis[start_index + s + 1] = 1;
+	info->m_J1angularAxis[start_index + s*2+2] = 1;
+	if ( info->m_J2angularAxis)
+	{
+		info->m_J2angularAxis[start_index] = -1;
+		info->m_J2angularAxis[start_index + s+1] = -1;
+		info->m_J2angularAxis[start_index + s*2+2] = -1;
+	}
+
+	b3Scalar k = info->fps * info->erp;
+	b3Vector3 diff;
+	b3Scalar angle;
+	b3Quaternion qrelCur = worldOrnA*worldOrnB.inverse();
+	b3TransformUtil::calculateDiffAxisAngleQuaternion(constraint->m_relTargetAB,qrelCur,diff,angle);
+	diff*=-angle;
+	for (int j=0; j<3; j++)
+	{
+		info->m_constraintError[(start_row+j)*s] = k * diff[j];
+	}
+}
+
+///the Euler angles of b3Generic6DofConstraint, m[i][j] is the dot product of column i of frame A and column j of frame B
+static b3Vector3	b3GpuEulerXYZ(const b3Matrix3x3& basisA, const b3Matrix3x3& basisB)
+{
+	b3Matrix3x3 m = basisA.transposeTimes(basisB);
+	b3Vector3 xyz;
+	b3Scalar fi = m[2][0];
+	if (fi < b3Scalar(1.f))
+	{
+		if (fi > b3Scalar(-1.f))
+		{
+			xyz.setValue(b3Atan2(-m[2][1],m[2][2]),b3Asin(fi),b3Atan2(-m[1][0],m[0][0]));
+		} else
+		{
+			xyz.setValue(-b3Atan2(m[0][1],m[1][1]),-B3_HALF_PI,0.f);
+		}
+	} else
+	{
+		xyz.setValue(b3Atan2(m[0][1],m[1][1]),B3_HALF_PI,0.f);
+	}
+	return xyz;
+}
+
+///row of one axis of a 6dof constraint, it stays zero (no effect) when the axis is free or within its limits
+static void getInfo2Generic6DofRow(b3GpuConstraintInfo2* info, int row, const b3Vector3& axis, const b3Vector3& angularA, const b3Vector3& angularB, 
+								   b3Scalar position, b3Scalar lowerLimit, b3Scalar upperLimit, int rotational)
+{
+	if (lowerLimit>upperLimit)
+		return;
+	b3Scalar limitError = 0.f;
+	if (position<lowerLimit)
+		limitError = position-lowerLimit;
+	else if (position>upperLimit)
+		limitError = position-upperLimit;
+	else if (lowerLimit<upperLimit)
+		return;
+	if (rotational)
+	{
+		if (limitError>B3_PI)
+			limitError -= B3_2_PI;
+		else if (limitError<-B3_PI)
+			limitError += B3_2_PI;
+	}
+
+	int srow = row*info->rowskip;
+	for (int i=0;i<3;i++)
+	{
+		if (!rotational)
+			info->m_J1linearAxis[srow+i] = axis[i];
+		info->m_J1angularAxis[srow+i] = angularA[i];
+		info->m_J2angularAxis[srow+i] = angularB[i];
+	}
+	//the Euler angles decrease when body B turns along the axis, the linear offsets increase when it moves along it
+	b3Scalar k = info->fps * info->erp;
+	b3Scalar error = rotational? -k*limitError : k*limitError;
+	info->m_constraintError[srow] = error;
+	if (lowerLimit<upperLimit)
+	{
+		//a limit only pushes back
+		info->m_lowerLimit[srow] = error>0.f? 0.f : -B3_INFINITY;
+		info->m_upperLimit[srow] = error>0.f? B3_INFINITY : 0.f;
+	}
+}
+
+void getInfo2Generic6Dof(b3GpuGenericConstraint* constraint, b3GpuConstraintInfo2* info,  const b3RigidBodyCL* bodies)
+{
+	const b3RigidBodyCL& rbA = bodies[constraint->m_rbA];
+	const b3RigidBodyCL& rbB = bodies[constraint->m_rbB];
+	b3Matrix3x3 basisA(rbA.m_quat*constraint->m_frameInA);
+	b3Matrix3x3 basisB(rbB.m_quat*constraint->m_frameInB);
+	b3Vector3 originA = rbA.m_pos + b3QuatRotate(rbA.m_quat,constraint->m_pivotInA);
+	b3Vector3 originB = rbB.m_pos + b3QuatRotate(rbB.m_quat,constraint->m_pivotInB);
+
+	//linear rows along the axes of frame A
+	b3Vector3 linearDiff = basisA.transpose()*(originB-originA);
+	for (int i=0;i<3;i++)
+	{
+		b3Vector3 axis = basisA.getColumn(i);
+		b3Vector3 angularA = (originB-rbA.m_pos).cross(axis);
+		b3Vector3 angularB = -(originB-rbB.m_pos).cross(axis);
+		getInfo2Generic6DofRow(info,i,axis,angularA,angularB,linearDiff[i],constraint->m_linearLowerLimit[i],constraint->m_linearUpperLimit[i],0);
+	}
+
+	//angular rows, see b3Generic6DofConstraint::calculateAngleInfo
+	b3Vector3 angleDiff = b3GpuEulerXYZ(basisA,basisB);
+	b3Vector3 axis0 = basisB.getColumn(0);
+	b3Vector3 axis2 = basisA.getColumn(2);
+	b3Vector3 axes[3];
+	axes[1] = axis2.cross(axis0);
+	axes[0] = axes[1].cross(axis2);
+	axes[2] = axis0.cross(axes[1]);
+	for (int i=0;i<3;i++)
+	{
+		axes[i].normalize();
+		getInfo2Generic6DofRow(info,3+i,axes[i],axes[i],-axes[i],angleDiff[i],constraint->m_angularLowerLimit[i],constraint->m_angularUpperLimit[i],1);
+	}
+}
+
 void b3GpuGenericConstraint::getInfo2 (b3GpuConstraintInfo2* info,  const b3RigidBodyCL* bodies)
 {
 	switch (m_constraintType)
@@ -129,6 +264,17 @@ void b3GpuGenericConstraint::getInfo2 (b3GpuConstraintInfo2* info,  const b3Rigi
 			getInfo2Point2Point(this,info,bodies);
 			break;
 		};
+	case B3_GPU_FIXED_CONSTRAINT_TYPE:
+		{
+			getInfo2Point2Point(this,info,bodies);
+			getInfo2FixedOrientation(this,info,bodies,3);
+			break;
+		};
+	case B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE:
+		{
+			getInfo2Generic6Dof(this,info,bodies);
+			break;
+		};
 		default:
 			{
 				b3Assert(0);
@@ -27,6 +27,8 @@ enum b3GpuGenericConstraintType
 {
 	B3_GPU_POINT2POINT_CONSTRAINT_TYPE=3,
 	B3_GPU_FIXED_CONSTRAINT_TYPE=4,
+	///hinge and slider constraints are 6dof constraints with preset limits, see b3GpuRigidBodyPipeline
+	B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE=5,
 //	B3_HINGE_CONSTRAINT_TYPE,
 //	B3_CONETWIST_CONSTRAINT_TYPE,
 //	B3_D6_CONSTRAINT_TYPE,
@@ -91,6 +93,16 @@ B3_ATTRIBUTE_ALIGNED16(struct) b3GpuGenericConstraint
 	int m_uid;
 	int m_padding[2];
 
+	///B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE only, the constraint frames are (m_pivotInA,m_frameInA) and (m_pivotInB,m_frameInB) in body space.
+	///Each of the 3 linear and 3 (Euler XYZ) angular axes is locked when lower==upper, limited when lower<upper and free when lower>upper.
+	///It always has 6 rows, so the batches can be reused, the rows of free axes and axes within their limits have no effect.
+	b3Quaternion m_frameInA;
+	b3Quaternion m_frameInB;
+	b3Vector3 m_linearLowerLimit;
+	b3Vector3 m_linearUpperLimit;
+	b3Vector3 m_angularLowerLimit;
+	b3Vector3 m_angularUpperLimit;
+
 	int	getRigidBodyA() const
 	{
 		return m_rbA;
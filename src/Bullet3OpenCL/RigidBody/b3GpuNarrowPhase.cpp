@@ -35,6 +35,8 @@ m_queue(queue)
 	m_data->m_config = config;
 	
 	m_data->m_gpuSatCollision = new GpuSatCollision(ctx,device,queue);
+	m_data->m_gpuSatCollision->m_manifoldCacheLinearThreshold = config.m_contactCacheLinearThreshold;
+	m_data->m_gpuSatCollision->m_manifoldCacheAngularThreshold = config.m_contactCacheAngularThreshold;
 	
 	
 	m_data->m_triangleConvexPairs = new b3OpenCLArray<b3Int4>(m_context,m_queue, config.m_maxTriConvexPairCapacity);
@@ -83,6 +85,12 @@ m_queue(queue)
 
 	m_data->m_convexIndicesGPU = new b3OpenCLArray<int>(ctx,queue,config.m_maxConvexIndices,true);
     m_data->m_convexIndices.reserve(config.m_maxConvexIndices);
+
+	m_data->m_convexVertexAdjacencyGPU = new b3OpenCLArray<int>(ctx,queue,config.m_maxConvexVertexAdjacency,true);
+	m_data->m_convexVertexAdjacency.reserve(config.m_maxConvexVertexAdjacency);
+
+	m_data->m_convexEdgesGPU = new b3OpenCLArray<b3Int4>(ctx,queue,config.m_maxConvexEdges,true);
+	m_data->m_convexEdges.reserve(config.m_maxConvexEdges);
     
 	m_data->m_worldVertsB1GPU = new b3OpenCLArray<b3Vector3>(ctx,queue,config.m_maxConvexBodies*config.m_maxVerticesPerFace);
     m_data->m_clippingFacesOutGPU = new  b3OpenCLArray<b3Int4>(ctx,queue,config.m_maxConvexBodies);
@@ -138,6 +146,8 @@ b3GpuNarrowPhase::~b3GpuNarrowPhase()
 	delete m_data->m_uniqueEdgesGPU;
 	delete m_data->m_convexVerticesGPU;
 	delete m_data->m_convexIndicesGPU;
+	delete m_data->m_convexVertexAdjacencyGPU;
+	delete m_data->m_convexEdgesGPU;
 	delete m_data->m_worldVertsB1GPU;
     delete m_data->m_clippingFacesOutGPU;
     delete m_data->m_worldNormalsAGPU;
@@ -150,12 +160,18 @@ b3GpuNarrowPhase::~b3GpuNarrowPhase()
 	{
 		delete m_data->m_bvhData[i];
 	}
+	for (int i=0;i<m_data->m_compoundBvhData.size();i++)
+	{
+		delete m_data->m_compoundBvhData[i];
+	}
 	for (int i=0;i<m_data->m_meshInterfaces.size();i++)
 	{
 		delete m_data->m_meshInterfaces[i];
 	}
 	m_data->m_meshInterfaces.clear();
 	m_data->m_bvhData.clear();
+	m_data->m_compoundBvhData.clear();
+	m_data->m_bvhCPU.clear();
 	delete m_data->m_treeNodesGPU;
 	delete m_data->m_subTreesGPU;
 
@@ -264,6 +280,76 @@ int		b3GpuNarrowPhase::registerPlaneShape(const b3Vector3& planeNormal, float pl
 }
 
 
+int		b3GpuNarrowPhase::registerBoxShape(const b3Vector3& halfExtents)
+{
+	int collidableIndex = allocateCollidable();
+	if (collidableIndex<0)
+		return collidableIndex;
+
+	b3Collidable& col = getCollidableCpu(collidableIndex);
+	col.m_shapeType = SHAPE_BOX;
+	col.m_shapeIndex = registerFace(halfExtents,0.f);
+	col.m_radius = halfExtents.length();
+
+	if (col.m_shapeIndex>=0)
+	{
+		b3SapAabb aabb;
+		aabb.m_min[0] = -halfExtents[0];
+		aabb.m_min[1] = -halfExtents[1];
+		aabb.m_min[2] = -halfExtents[2];
+		aabb.m_minIndices[3] = 0;
+
+		aabb.m_max[0] = halfExtents[0];
+		aabb.m_max[1] = halfExtents[1];
+		aabb.m_max[2] = halfExtents[2];
+		aabb.m_signedMaxIndices[3] = 0;
+
+		m_data->m_localShapeAABBCPU->push_back(aabb);
+		clFinish(m_queue);
+	}
+
+	return collidableIndex;
+}
+
+int		b3GpuNarrowPhase::registerCapsuleShape(float radius, float halfHeight, int upAxis)
+{
+	b3Assert(upAxis>=0 && upAxis<3);
+	int collidableIndex = allocateCollidable();
+	if (collidableIndex<0)
+		return collidableIndex;
+
+	b3Vector3 axis = b3MakeVector3(0,0,0);
+	axis[upAxis] = 1.f;
+
+	b3Collidable& col = getCollidableCpu(collidableIndex);
+	col.m_shapeType = SHAPE_CAPSULE;
+	col.m_shapeIndex = registerFace(axis,halfHeight);
+	col.m_radius = radius;
+
+	if (col.m_shapeIndex>=0)
+	{
+		b3Vector3 halfExtents = b3MakeVector3(radius,radius,radius);
+		halfExtents[upAxis] += halfHeight;
+
+		b3SapAabb aabb;
+		aabb.m_min[0] = -halfExtents[0];
+		aabb.m_min[1] = -halfExtents[1];
+		aabb.m_min[2] = -halfExtents[2];
+		aabb.m_minIndices[3] = 0;
+
+		aabb.m_max[0] = halfExtents[0];
+		aabb.m_max[1] = halfExtents[1];
+		aabb.m_max[2] = halfExtents[2];
+		aabb.m_signedMaxIndices[3] = 0;
+
+		m_data->m_localShapeAABBCPU->push_back(aabb);
+		clFinish(m_queue);
+	}
+
+	return collidableIndex;
+}
+
+
 int b3GpuNarrowPhase::registerConvexHullShape(b3ConvexUtility* convexPtr,b3Collidable& col)
 {
 
@@ -327,6 +413,41 @@ int b3GpuNarrowPhase::registerConvexHullShape(b3ConvexUtility* convexPtr,b3Colli
 		m_data->m_convexVertices[vertexOffset+i] = convexPtr->m_vertices[i];
 	}
 
+	convex.m_vertexAdjacencyOffset = -1;
+	convex.m_edgeOffset = m_data->m_convexEdges.size();
+	convex.m_numEdges = 0;
+	convex.m_unused0 = 0;
+	convex.m_unused1 = 0;
+
+	//large hulls use hill climbing for support queries and the Gauss map to prune edge-edge axes
+	if (convex.m_numVertices>=m_data->m_config.m_minVerticesForHillClimbing)
+	{
+		b3AlignedObjectArray<int> adjacency;
+		b3AlignedObjectArray<b3Int4> edges;
+		if (convexPtr->computeVertexAdjacency(adjacency,edges))
+		{
+			int adjacencyOffset = m_data->m_convexVertexAdjacency.size();
+			convex.m_vertexAdjacencyOffset = adjacencyOffset;
+			m_data->m_convexVertexAdjacency.resize(adjacencyOffset+adjacency.size());
+			//row starts become absolute, neighbours stay local vertex indices
+			for (i=0;i<=convex.m_numVertices;i++)
+			{
+				m_data->m_convexVertexAdjacency[adjacencyOffset+i] = adjacency[i]+adjacencyOffset;
+			}
+			for (;i<adjacency.size();i++)
+			{
+				m_data->m_convexVertexAdjacency[adjacencyOffset+i] = adjacency[i];
+			}
+
+			convex.m_numEdges = edges.size();
+			m_data->m_convexEdges.resize(convex.m_edgeOffset+convex.m_numEdges);
+			for (i=0;i<edges.size();i++)
+			{
+				m_data->m_convexEdges[convex.m_edgeOffset+i] = edges[i];
+			}
+		}
+	}
+
 	(*m_data->m_convexData)[m_data->m_numAcceleratedShapes] = convexPtr;
 	
     
@@ -549,6 +670,8 @@ int		b3GpuNarrowPhase::registerCompoundShape(b3AlignedObjectArray<b3GpuChildShap
 	}
 
 	m_data->m_bvhInfoCPU.push_back(bvhInfo);
+	m_data->m_compoundBvhData.push_back(bvh);
+	m_data->m_bvhCPU.push_back(bvh);
 
 	int numNewSubtrees = bvh->getSubtreeInfoArray().size();
 	m_data->m_subTreesCPU.reserve(m_data->m_subTreesCPU.size()+numNewSubtrees);
@@ -642,6 +765,7 @@ int		b3GpuNarrowPhase::registerConcaveMesh(b3AlignedObjectArray<b3Vector3>* vert
 	bvhInfo.m_subTreeOffset = m_data->m_subTreesCPU.size();
 
 	m_data->m_bvhInfoCPU.push_back(bvhInfo);
+	m_data->m_bvhCPU.push_back(bvh);
 
 
 	int numNewSubtrees = bvh->getSubtreeInfoArray().size();
@@ -683,6 +807,11 @@ int b3GpuNarrowPhase::registerConcaveMeshShape(b3AlignedObjectArray<b3Vector3>*
 	convex.m_numUniqueEdges = 0;
 	int edgeOffset = m_data->m_uniqueEdges.size();
 	convex.m_uniqueEdgesOffset = edgeOffset;
+	convex.m_vertexAdjacencyOffset = -1;
+	convex.m_edgeOffset = m_data->m_convexEdges.size();
+	convex.m_numEdges = 0;
+	convex.m_unused0 = 0;
+	convex.m_unused1 = 0;
 	
 	int faceOffset = m_data->m_convexFaces.size();
 	convex.m_faceOffset = faceOffset;
@@ -802,6 +931,19 @@ int	b3GpuNarrowPhase::getNumContactsGpu() const
 {
 	return m_data->m_pBufContactBuffersGPU[m_data->m_currentContactBuffer]->size();
 }
+
+int	b3GpuNarrowPhase::getNumPairsInTypeBin(int bin) const
+{
+	b3Assert(bin>=0 && bin<B3_NUM_PAIR_BINS);
+	return m_data->m_gpuSatCollision->m_pairTypeBinCounts[bin];
+}
+
+void	b3GpuNarrowPhase::getContactCacheStatistics(int& numConvexPairs, int& numHits) const
+{
+	numConvexPairs = m_data->m_gpuSatCollision->m_numManifoldCacheLookups;
+	numHits = m_data->m_gpuSatCollision->m_numManifoldCacheHits;
+}
+
 cl_mem b3GpuNarrowPhase::getContactsGpu()
 {
 	return m_data->m_pBufContactBuffersGPU[m_data->m_currentContactBuffer]->getBufferCL();
@@ -853,6 +995,8 @@ void b3GpuNarrowPhase::computeContacts(cl_mem broadphasePairs, int numBroadphase
 		*m_data->m_uniqueEdgesGPU,
 		*m_data->m_convexFacesGPU,
 		*m_data->m_convexIndicesGPU,
+		*m_data->m_convexVertexAdjacencyGPU,
+		*m_data->m_convexEdgesGPU,
 		*m_data->m_collidablesGPU,
 		*m_data->m_gpuChildShapes,
 		clAabbArrayWorldSpace,
@@ -1004,6 +1148,8 @@ void	b3GpuNarrowPhase::writeAllBodiesToGpu()
 	m_data->m_convexPolyhedraGPU->copyFromHost(m_data->m_convexPolyhedra);
 	m_data->m_uniqueEdgesGPU->copyFromHost(m_data->m_uniqueEdges);
 	m_data->m_convexVerticesGPU->copyFromHost(m_data->m_convexVertices);
+	m_data->m_convexVertexAdjacencyGPU->copyFromHost(m_data->m_convexVertexAdjacency);
+	m_data->m_convexEdgesGPU->copyFromHost(m_data->m_convexEdges);
 	m_data->m_convexIndicesGPU->copyFromHost(m_data->m_convexIndices);
 	m_data->m_bvhInfoGPU->copyFromHost(m_data->m_bvhInfoCPU);
 	m_data->m_treeNodesGPU->copyFromHost(m_data->m_treeNodesCPU);
@@ -1034,6 +1180,8 @@ void	b3GpuNarrowPhase::reset()
 	this->m_static0Index = -1;
 	m_data->m_uniqueEdges.resize(0);
 	m_data->m_convexVertices.resize(0);
+	m_data->m_convexVertexAdjacency.resize(0);
+	m_data->m_convexEdges.resize(0);
 	m_data->m_convexPolyhedra.resize(0);
 	m_data->m_convexIndices.resize(0);
 	m_data->m_cpuChildShapes.resize(0);
@@ -1041,6 +1189,8 @@ void	b3GpuNarrowPhase::reset()
 	m_data->m_collidablesCPU.resize(0);
 	m_data->m_localShapeAABBCPU->resize(0);
 	m_data->m_bvhData.resize(0);
+	m_data->m_compoundBvhData.resize(0);
+	m_data->m_bvhCPU.resize(0);
 	m_data->m_treeNodesCPU.resize(0);
 	m_data->m_subTreesCPU.resize(0);
 	m_data->m_bvhInfoCPU.resize(0);
@@ -33,6 +33,11 @@ public:
 
 	int		registerSphereShape(float radius);
 	int		registerPlaneShape(const b3Vector3& planeNormal, float planeConstant);
+	///half extents are stored in the face array, so the box needs no convex hull data.
+	///Boxes and capsules collide with spheres, planes, boxes and capsules only, use a convex hull against hulls, compounds and trimeshes
+	int		registerBoxShape(const b3Vector3& halfExtents);
+	///capsule segment along the local upAxis (0=x,1=y,2=z), halfHeight excludes the radius
+	int		registerCapsuleShape(float radius, float halfHeight, int upAxis=1);
 
 	int registerCompoundShape(b3AlignedObjectArray<b3GpuChildShape>* childShapes);
 	int registerFace(const b3Vector3& faceNormal, float faceConstant);
@@ -78,6 +83,12 @@ public:
 	cl_mem	getContactsGpu();
 	int	getNumContactsGpu() const;
 
+	///number of broadphase pairs in each shape type pair bin (see b3PairTypeBin) during the last computeContacts
+	int	getNumPairsInTypeBin(int bin) const;
+
+	///number of convex-convex pairs looked up in the manifold cache and the number of reused manifolds during the last computeContacts
+	void	getContactCacheStatistics(int& numConvexPairs, int& numHits) const;
+
 	cl_mem	getAabbLocalSpaceBufferGpu();
 	
 	int getNumRigidBodies() const;
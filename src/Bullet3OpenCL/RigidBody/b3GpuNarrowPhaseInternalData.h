@@ -31,11 +31,15 @@ struct b3GpuNarrowPhaseInternalData
 	b3AlignedObjectArray<b3Vector3> m_uniqueEdges;
 	b3AlignedObjectArray<b3Vector3> m_convexVertices;
 	b3AlignedObjectArray<int> m_convexIndices;
+	b3AlignedObjectArray<int> m_convexVertexAdjacency;
+	b3AlignedObjectArray<b3Int4> m_convexEdges;
     
 	b3OpenCLArray<b3ConvexPolyhedronCL>* m_convexPolyhedraGPU;
 	b3OpenCLArray<b3Vector3>* m_uniqueEdgesGPU;
 	b3OpenCLArray<b3Vector3>* m_convexVerticesGPU;
 	b3OpenCLArray<int>* m_convexIndicesGPU;
+	b3OpenCLArray<int>* m_convexVertexAdjacencyGPU;
+	b3OpenCLArray<b3Int4>* m_convexEdgesGPU;
     
     b3OpenCLArray<b3Vector3>* m_worldVertsB1GPU;
     b3OpenCLArray<b3Int4>* m_clippingFacesOutGPU;
@@ -77,6 +81,9 @@ struct b3GpuNarrowPhaseInternalData
 
 	b3AlignedObjectArray<class b3OptimizedBvh*> m_bvhData;
 	b3AlignedObjectArray<class b3TriangleIndexVertexArray*> m_meshInterfaces;
+	b3AlignedObjectArray<class b3QuantizedBvh*> m_compoundBvhData;
+	///host tree of each m_bvhInfoCPU entry, points into m_bvhData or m_compoundBvhData
+	b3AlignedObjectArray<const class b3QuantizedBvh*> m_bvhCPU;
 
 	b3AlignedObjectArray<b3QuantizedBvhNode>	m_treeNodesCPU;
 	b3AlignedObjectArray<b3BvhSubtreeInfo>	m_subTreesCPU;
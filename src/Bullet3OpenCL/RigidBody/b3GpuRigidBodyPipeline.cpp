@@ -205,6 +205,51 @@ int b3GpuRigidBodyPipeline::createFixedConstraint(int bodyA, int bodyB, const fl
 	return c.m_uid;
 }
 
+int b3GpuRigidBodyPipeline::createGeneric6DofConstraint(int bodyA, int bodyB, const float* pivotInA, const float* frameInA, const float* pivotInB, const float* frameInB, const float* linearLowerLimit, const float* linearUpperLimit, const float* angularLowerLimit, const float* angularUpperLimit, float breakingThreshold)
+{
+	m_data->m_gpuSolver->recomputeBatches();
+	b3GpuGenericConstraint c;
+	c.m_uid = m_data->m_constraintUid;
+	m_data->m_constraintUid++;
+	c.m_flags = B3_CONSTRAINT_FLAG_ENABLED;
+	c.m_rbA = bodyA;
+	c.m_rbB = bodyB;
+	c.m_pivotInA.setValue(pivotInA[0],pivotInA[1],pivotInA[2]);
+	c.m_pivotInB.setValue(pivotInB[0],pivotInB[1],pivotInB[2]);
+	c.m_relTargetAB.setValue(0,0,0,1);
+	c.m_frameInA.setValue(frameInA[0],frameInA[1],frameInA[2],frameInA[3]);
+	c.m_frameInB.setValue(frameInB[0],frameInB[1],frameInB[2],frameInB[3]);
+	c.m_linearLowerLimit.setValue(linearLowerLimit[0],linearLowerLimit[1],linearLowerLimit[2]);
+	c.m_linearUpperLimit.setValue(linearUpperLimit[0],linearUpperLimit[1],linearUpperLimit[2]);
+	c.m_angularLowerLimit.setValue(angularLowerLimit[0],angularLowerLimit[1],angularLowerLimit[2]);
+	c.m_angularUpperLimit.setValue(angularUpperLimit[0],angularUpperLimit[1],angularUpperLimit[2]);
+	c.m_breakingImpulseThreshold = breakingThreshold;
+	c.m_constraintType = B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE;
+
+	m_data->m_cpuConstraints.push_back(c);
+	return c.m_uid;
+}
+
+int b3GpuRigidBodyPipeline::createHingeConstraint(int bodyA, int bodyB, const float* pivotInA, const float* pivotInB, const float* axisInA, const float* axisInB, float lowerLimit, float upperLimit, float breakingThreshold)
+{
+	//the hinge axis is the x axis of the frames, the hinge angle is the Euler x angle
+	b3Vector3 xAxis = b3MakeVector3(1,0,0);
+	b3Quaternion frameInA = b3ShortestArcQuat(xAxis,b3MakeVector3(axisInA[0],axisInA[1],axisInA[2]).normalized());
+	b3Quaternion frameInB = b3ShortestArcQuat(xAxis,b3MakeVector3(axisInB[0],axisInB[1],axisInB[2]).normalized());
+	float linearLimit[3] = {0,0,0};
+	float angularLowerLimit[3] = {lowerLimit,0,0};
+	float angularUpperLimit[3] = {upperLimit,0,0};
+	return createGeneric6DofConstraint(bodyA,bodyB,pivotInA,frameInA,pivotInB,frameInB,linearLimit,linearLimit,angularLowerLimit,angularUpperLimit,breakingThreshold);
+}
+
+int b3GpuRigidBodyPipeline::createSliderConstraint(int bodyA, int bodyB, const float* pivotInA, const float* frameInA, const float* pivotInB, const float* frameInB, float lowerLimit, float upperLimit, float breakingThreshold)
+{
+	float linearLowerLimit[3] = {lowerLimit,0,0};
+	float linearUpperLimit[3] = {upperLimit,0,0};
+	float angularLimit[3] = {0,0,0};
+	return createGeneric6DofConstraint(bodyA,bodyB,pivotInA,frameInA,pivotInB,frameInB,linearLowerLimit,linearUpperLimit,angularLimit,angularLimit,breakingThreshold);
+}
+
 
 void	b3GpuRigidBodyPipeline::stepSimulation(float deltaTime)
 {
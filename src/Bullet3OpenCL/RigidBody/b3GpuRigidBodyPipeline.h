@@ -58,6 +58,12 @@ public:
 	
 	int createPoint2PointConstraint(int bodyA, int bodyB, const float* pivotInA, const float* pivotInB,float breakingThreshold);
 	int createFixedConstraint(int bodyA, int bodyB, const float* pivotInA, const float* pivotInB, const float* relTargetAB, float breakingThreshold);
+	///the limits are xyz triplets, an axis is locked when lower==upper, limited when lower<upper and free when lower>upper
+	int createGeneric6DofConstraint(int bodyA, int bodyB, const float* pivotInA, const float* frameInA, const float* pivotInB, const float* frameInB, const float* linearLowerLimit, const float* linearUpperLimit, const float* angularLowerLimit, const float* angularUpperLimit, float breakingThreshold);
+	///the hinge rotates around axisInA/axisInB, it is free when lowerLimit>upperLimit
+	int createHingeConstraint(int bodyA, int bodyB, const float* pivotInA, const float* pivotInB, const float* axisInA, const float* axisInB, float lowerLimit, float upperLimit, float breakingThreshold);
+	///the slider moves along the x axis of frameInA, it is free when lowerLimit>upperLimit
+	int createSliderConstraint(int bodyA, int bodyB, const float* pivotInA, const float* frameInA, const float* pivotInB, const float* frameInB, float lowerLimit, float upperLimit, float breakingThreshold);
 	void removeConstraintByUid(int uid);
 
 	void	addConstraint(class b3TypedConstraint* constraint);
@@ -39,6 +39,8 @@ bool useNewBatchingKernel = false;
 
 #include "Bullet3OpenCL/ParallelPrimitives/b3LauncherCL.h"
 #include "Bullet3Common/b3Vector3.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
+#include "Bullet3Dynamics/shared/b3ContactBlockSolver.h"
 
 struct SolverDebugInfo
 {
@@ -88,8 +90,17 @@ b3Solver::b3Solver(cl_context ctx, cl_device_id device, cl_command_queue queue,
 			:m_nIterations(4),
 			m_context(ctx),
 			m_device(device),
-			m_queue(queue)
+			m_queue(queue),
+			m_blockContactSolve(false),
+			m_threadSupport(0),
+			m_barrier(0),
+			m_stackAlloc(0)
 {
+	m_nSplit.x = B3_SOLVER_N_SPLIT_X;
+	m_nSplit.y = B3_SOLVER_N_SPLIT_Y;
+	m_nSplit.z = B3_SOLVER_N_SPLIT_Z;
+	m_nSplit.w = 0;
+
 	m_sort32 = new b3RadixSort32CL(ctx,device,queue);
 	m_scan = new b3PrefixScanCL(ctx,device,queue,B3_SOLVER_N_CELLS);
 	m_search = new b3BoundSearchCL(ctx,device,queue,B3_SOLVER_N_CELLS);
@@ -104,6 +115,9 @@ b3Solver::b3Solver(cl_context ctx, cl_device_id device, cl_command_queue queue,
 
 	m_offsets = new b3OpenCLArray<unsigned int>( ctx,queue,B3_SOLVER_N_CELLS);
 	m_offsets->resize(B3_SOLVER_N_CELLS);
+
+	m_residual = new b3OpenCLArray<float>( ctx,queue,4*B3_SOLVER_N_CELLS);
+	m_residual->resize(4*B3_SOLVER_N_CELLS);
 	const char* additionalMacros = "";
 	const char* srcFileNameForCaching="";
 
@@ -177,8 +191,11 @@ b3Solver::b3Solver(cl_context ctx, cl_device_id device, cl_command_queue queue,
 		
 b3Solver::~b3Solver()
 {
+	setThreadSupport(0);
+
 	delete m_offsets;
 	delete m_numConstraints;
+	delete m_residual;
 	delete m_sortDataBuffer;
 	delete m_contactBuffer2;
 
@@ -376,6 +393,74 @@ void solveContact(b3GpuConstraint4& cs,
 
 
 
+///host version of solveContactBlock in solveContact.cl, falls back to solveContact when the block LCP fails
+static
+__inline
+void solveContactBlock(b3GpuConstraint4& cs, 
+	const b3Vector3& posA, b3Vector3& linVelA, b3Vector3& angVelA, float invMassA, const b3Matrix3x3& invInertiaA,
+	const b3Vector3& posB, b3Vector3& linVelB, b3Vector3& angVelB, float invMassB, const b3Matrix3x3& invInertiaB, 
+	float maxRambdaDt[4], float minRambdaDt[4])
+{
+	b3Vector3 angular0[4], angular1[4];
+	float A[16];
+	float b[4];
+	float lambda[4];
+	int pointIdx[4];
+	int n = 0;
+
+	for(int ic=0; ic<4; ic++)
+	{
+		if( cs.m_jacCoeffInv[ic] == 0.f ) continue;
+
+		b3Vector3 linear;
+		b3Vector3 r0 = cs.m_worldPos[ic] - (b3Vector3&)posA;
+		b3Vector3 r1 = cs.m_worldPos[ic] - (b3Vector3&)posB;
+		setLinearAndAngular( (const b3Vector3 &)-cs.m_linear, (const b3Vector3 &)r0, (const b3Vector3 &)r1, linear, angular0[n], angular1[n] );
+		pointIdx[n++] = ic;
+	}
+
+	if( n>1 )
+	{
+		for(int i=0; i<n; i++)
+		{
+			b3Vector3 invInertiaAngular0 = invInertiaA*angular0[i];
+			b3Vector3 invInertiaAngular1 = invInertiaB*angular1[i];
+			for(int j=0; j<n; j++)
+			{
+				A[j*4+i] = invMassA + invMassB + b3Dot(angular0[j], invInertiaAngular0) + b3Dot(angular1[j], invInertiaAngular1);
+			}
+			b[i] = calcRelVel((const b3Vector3 &)cs.m_linear,(const b3Vector3 &) -cs.m_linear, angular0[i], angular1[i],
+				linVelA, angVelA, linVelB, angVelB ) + cs.m_b[pointIdx[i]];
+		}
+		for(int i=0; i<n; i++)
+		{
+			for(int j=0; j<n; j++)
+				b[i] -= A[i*4+j]*cs.m_appliedRambdaDt[pointIdx[j]];
+		}
+	}
+
+	if( n<2 || !b3SolveContactBlockLcp(A, b, n, lambda) )
+	{
+		solveContact<false>( cs, posA, linVelA, angVelA, invMassA, invInertiaA,
+			posB, linVelB, angVelB, invMassB, invInertiaB, maxRambdaDt, minRambdaDt );
+		return;
+	}
+
+	const b3Vector3& linear = (const b3Vector3&)cs.m_linear;
+	for(int i=0; i<n; i++)
+	{
+		int ic = pointIdx[i];
+		float rambdaDt = lambda[i] - cs.m_appliedRambdaDt[ic];
+		cs.m_appliedRambdaDt[ic] = lambda[i];
+
+		linVelA += invMassA*linear*rambdaDt;
+		angVelA += (invInertiaA*angular0[i])*rambdaDt;
+		linVelB += invMassB*(-linear)*rambdaDt;
+		angVelB += (invInertiaB*angular1[i])*rambdaDt;
+	}
+}
+
+
 
 
 	static
@@ -457,7 +542,7 @@ struct SolveTask// : public ThreadPool::Task
 	SolveTask(b3AlignedObjectArray<b3RigidBodyCL>& bodies,  b3AlignedObjectArray<b3InertiaCL>& shapes, b3AlignedObjectArray<b3GpuConstraint4>& constraints,
 		int start, int nConstraints,int maxNumBatches,b3AlignedObjectArray<int>* wgUsedBodies, int curWgidx)
 		: m_bodies( bodies ), m_shapes( shapes ), m_constraints( constraints ), m_start( start ), m_nConstraints( nConstraints ),
-		m_solveFriction( true ),m_maxNumBatches(maxNumBatches),
+		m_solveFriction( true ),m_blockSolve( false ),m_maxNumBatches(maxNumBatches),
 		m_wgUsedBodies(wgUsedBodies),m_curWgidx(curWgidx)
 	{}
 
@@ -500,62 +585,74 @@ struct SolveTask// : public ThreadPool::Task
 				{
 					//printf("ic(a)=%d, localBatch=%d\n",ic,localBatch);
 				}
-				if (usedBodies.size()<(aIdx+1))
+				//the body usage is only tracked to verify the cell batches, see solveContactConstraintHost
+				if (m_wgUsedBodies)
 				{
-					usedBodies.resize(aIdx+1,0);
-				}
+					if (usedBodies.size()<(aIdx+1))
+					{
+						usedBodies.resize(aIdx+1,0);
+					}
 		
-				if (usedBodies.size()<(bIdx+1))
-				{
-					usedBodies.resize(bIdx+1,0);
-				}
+					if (usedBodies.size()<(bIdx+1))
+					{
+						usedBodies.resize(bIdx+1,0);
+					}
 
-				if (bodyA.m_invMass)
-				{
-					b3Assert(usedBodies[aIdx]==0);
-					usedBodies[aIdx]++;
-				}
-				if (m_wgUsedBodies)
-				{
-					for (int w=0;w<B3_SOLVER_N_CELLS;w++)
+					if (bodyA.m_invMass)
+					{
+						b3Assert(usedBodies[aIdx]==0);
+						usedBodies[aIdx]++;
+					}
+					if (m_wgUsedBodies)
 					{
-						if (w!=m_curWgidx)
+						for (int w=0;w<B3_SOLVER_N_CELLS;w++)
 						{
-							if (bodyA.m_invMass)
+							if (w!=m_curWgidx)
 							{
-								if (m_wgUsedBodies[w].size()>aIdx)
+								if (bodyA.m_invMass)
 								{
-									b3Assert(m_wgUsedBodies[w][aIdx]==0);
+									if (m_wgUsedBodies[w].size()>aIdx)
+									{
+										b3Assert(m_wgUsedBodies[w][aIdx]==0);
+									}
 								}
-							}
-							if (bodyB.m_invMass)
-							{
-								if (m_wgUsedBodies[w].size()>bIdx)
+								if (bodyB.m_invMass)
 								{
-									b3Assert(m_wgUsedBodies[w][bIdx]==0);
+									if (m_wgUsedBodies[w].size()>bIdx)
+									{
+										b3Assert(m_wgUsedBodies[w][bIdx]==0);
+									}
 								}
 							}
 						}
 					}
-				}
 
 
 
-				if (bodyB.m_invMass)
-				{
-					b3Assert(usedBodies[bIdx]==0);
-					usedBodies[bIdx]++;
-				}
+					if (bodyB.m_invMass)
+					{
+						b3Assert(usedBodies[bIdx]==0);
+						usedBodies[bIdx]++;
+					}
 				
+				}
 
 				if( !m_solveFriction )
 				{
 					float maxRambdaDt[4] = {FLT_MAX,FLT_MAX,FLT_MAX,FLT_MAX};
 					float minRambdaDt[4] = {0.f,0.f,0.f,0.f};
 
-					solveContact<false>( m_constraints[i], (b3Vector3&)bodyA.m_pos, (b3Vector3&)bodyA.m_linVel, (b3Vector3&)bodyA.m_angVel, bodyA.m_invMass, (const b3Matrix3x3 &)m_shapes[aIdx].m_invInertiaWorld, 
-							(b3Vector3&)bodyB.m_pos, (b3Vector3&)bodyB.m_linVel, (b3Vector3&)bodyB.m_angVel, bodyB.m_invMass, (const b3Matrix3x3 &)m_shapes[bIdx].m_invInertiaWorld,
-						maxRambdaDt, minRambdaDt );
+					if (m_blockSolve)
+					{
+						solveContactBlock( m_constraints[i], (b3Vector3&)bodyA.m_pos, (b3Vector3&)bodyA.m_linVel, (b3Vector3&)bodyA.m_angVel, bodyA.m_invMass, (const b3Matrix3x3 &)m_shapes[aIdx].m_invInertiaWorld, 
+								(b3Vector3&)bodyB.m_pos, (b3Vector3&)bodyB.m_linVel, (b3Vector3&)bodyB.m_angVel, bodyB.m_invMass, (const b3Matrix3x3 &)m_shapes[bIdx].m_invInertiaWorld,
+							maxRambdaDt, minRambdaDt );
+					} else
+					{
+						solveContact<false>( m_constraints[i], (b3Vector3&)bodyA.m_pos, (b3Vector3&)bodyA.m_linVel, (b3Vector3&)bodyA.m_angVel, bodyA.m_invMass, (const b3Matrix3x3 &)m_shapes[aIdx].m_invInertiaWorld, 
+								(b3Vector3&)bodyB.m_pos, (b3Vector3&)bodyB.m_linVel, (b3Vector3&)bodyB.m_angVel, bodyB.m_invMass, (const b3Matrix3x3 &)m_shapes[bIdx].m_invInertiaWorld,
+							maxRambdaDt, minRambdaDt );
+					}
 
 				}
 				else
@@ -612,10 +709,89 @@ struct SolveTask// : public ThreadPool::Task
 	int m_start;
 	int m_nConstraints;
 	bool m_solveFriction;
+	///solve the normal impulses of each constraint together, see solveContactBlock
+	bool m_blockSolve;
 	int m_maxNumBatches;
 };
 
 
+static int	b3GetSolverCellIndex(const b3Int4& nSplit, int cellBatch, int wgIdx)
+{
+	int nSplitX = nSplit.x;
+	int nSplitY = nSplit.y;
+	int zIdx = (wgIdx/((nSplitX*nSplitY)/4))*2+((cellBatch&4)>>2);
+	int remain= (wgIdx%((nSplitX*nSplitY)/4));
+	int yIdx = (remain/(nSplitX/2))*2 + ((cellBatch&2)>>1);
+	int xIdx = (remain%(nSplitX/2))*2 + (cellBatch&1);
+	return xIdx+yIdx*nSplitX+zIdx*(nSplitX*nSplitY);
+}
+
+///solves the cells assigned to one task, in the same cell batch order as the serial version and the GPU kernel.
+///The cells of a cell batch are not adjacent so they share no dynamic body, a barrier separates the cell batches
+struct b3SolveCellBatchesTask : public b3ThreadTask
+{
+	b3AlignedObjectArray<b3RigidBodyCL>*	m_bodies;
+	b3AlignedObjectArray<b3InertiaCL>*		m_shapes;
+	b3AlignedObjectArray<b3GpuConstraint4>*	m_constraints;
+	const b3AlignedObjectArray<unsigned int>*	m_offsets;
+	const b3AlignedObjectArray<unsigned int>*	m_numConstraints;
+	b3Barrier*	m_barrier;
+	int		m_nIterations;
+	int		m_maxNumBatches;
+	bool	m_blockSolve;
+
+	///cells of this task, grouped by cell batch
+	b3AlignedObjectArray<int>	m_cells;
+	int		m_cellBatchOffsets[B3_SOLVER_N_BATCHES+1];
+
+	virtual void	run(void* lsMemory)
+	{
+		//all contact iterations run before the friction iterations, like the serial version
+		for (int solveFriction=0;solveFriction<2;solveFriction++)
+		{
+			for(int iter=0; iter<m_nIterations; iter++)
+			{
+				for (int cellBatch=0;cellBatch<B3_SOLVER_N_BATCHES;cellBatch++)
+				{
+					for (int c=m_cellBatchOffsets[cellBatch];c<m_cellBatchOffsets[cellBatch+1];c++)
+					{
+						int cellIdx = m_cells[c];
+						SolveTask task( *m_bodies, *m_shapes, *m_constraints, (*m_offsets)[cellIdx], (*m_numConstraints)[cellIdx], m_maxNumBatches, 0,0);
+						task.m_solveFriction = (solveFriction!=0);
+						task.m_blockSolve = m_blockSolve;
+						task.run(0);
+					}
+					m_barrier->sync();
+				}
+			}
+		}
+	}
+};
+
+struct b3CellSizeSortPredicate
+{
+	const unsigned int* m_numConstraints;
+
+	bool operator() ( int a, int b ) const
+	{
+		return (m_numConstraints[a]>m_numConstraints[b]) || (m_numConstraints[a]==m_numConstraints[b] && a<b);
+	}
+};
+
+void	b3Solver::setThreadSupport(b3ThreadSupportInterface* threadSupport)
+{
+	if (m_barrier)
+	{
+		m_threadSupport->deleteBarrier(m_barrier);
+		m_barrier = 0;
+	}
+	m_threadSupport = threadSupport;
+	if (m_threadSupport)
+	{
+		m_barrier = m_threadSupport->createBarrier();
+	}
+}
+
 void b3Solver::solveContactConstraintHost(  b3OpenCLArray<b3RigidBodyCL>* bodyBuf, b3OpenCLArray<b3InertiaCL>* shapeBuf, 
 			b3OpenCLArray<b3GpuConstraint4>* constraint, void* additionalData, int n ,int maxNumBatches)
 {
@@ -665,30 +841,103 @@ void b3Solver::solveContactConstraintHost(  b3OpenCLArray<b3RigidBodyCL>* bodyBu
 	}
 #endif
 
-	b3AlignedObjectArray<b3RigidBodyCL> bodyNative;
+	b3AlignedObjectArray<b3RigidBodyCL>& bodyNative = m_bodiesHost;
 	bodyBuf->copyToHost(bodyNative);
-	b3AlignedObjectArray<b3InertiaCL> shapeNative;
+	b3AlignedObjectArray<b3InertiaCL>& shapeNative = m_inertiasHost;
 	shapeBuf->copyToHost(shapeNative);
-	b3AlignedObjectArray<b3GpuConstraint4> constraintNative;
+	b3AlignedObjectArray<b3GpuConstraint4>& constraintNative = m_constraintsHost;
 	constraint->copyToHost(constraintNative);
 
-	b3AlignedObjectArray<unsigned int> numConstraintsHost;
+	b3AlignedObjectArray<unsigned int>& numConstraintsHost = m_numConstraintsHost;
 	m_numConstraints->copyToHost(numConstraintsHost);
 
 	//printf("------------------------\n");
-	b3AlignedObjectArray<unsigned int> offsetsHost;
+	b3AlignedObjectArray<unsigned int>& offsetsHost = m_offsetsHost;
 	m_offsets->copyToHost(offsetsHost);
 	static int frame=0;
 	bool useBatches=true;
-	if (useBatches)
+	int numTasks = m_threadSupport? m_threadSupport->getNumTasks() : 1;
+	if (useBatches && numTasks>1)
+	{
+		B3_PROFILE("solve cell batches on threads");
+		int numWorkgroups = B3_SOLVER_N_CELLS/B3_SOLVER_N_BATCHES;
+		//the tasks and cell arrays live in the stack allocator, each task can hold all cells
+		m_stackAlloc.reserve(sizeof(b3Block)+b3StackAlloc::getArraySize<b3SolveCellBatchesTask>(numTasks)
+			+numTasks*b3StackAlloc::getArraySize<int>(B3_SOLVER_N_CELLS)+b3StackAlloc::getArraySize<int>(numWorkgroups)+b3StackAlloc::getArraySize<int>(numTasks));
+		b3Block* block = m_stackAlloc.beginBlock();
+		b3SolveCellBatchesTask* tasks = m_stackAlloc.allocateArray<b3SolveCellBatchesTask>(numTasks);
+		for (int t=0;t<numTasks;t++)
+		{
+			new (&tasks[t]) b3SolveCellBatchesTask();
+			tasks[t].m_bodies = &bodyNative;
+			tasks[t].m_shapes = &shapeNative;
+			tasks[t].m_constraints = &constraintNative;
+			tasks[t].m_offsets = &offsetsHost;
+			tasks[t].m_numConstraints = &numConstraintsHost;
+			tasks[t].m_barrier = m_barrier;
+			tasks[t].m_nIterations = m_nIterations;
+			tasks[t].m_maxNumBatches = maxNumBatches;
+			tasks[t].m_blockSolve = m_blockContactSolve;
+			tasks[t].m_cells.initializeFromBuffer(m_stackAlloc.allocateArray<int>(B3_SOLVER_N_CELLS),0,B3_SOLVER_N_CELLS);
+		}
+
+		//the non-empty cells of each cell batch go to the least loaded task, largest cells first
+		b3AlignedObjectArray<int> cells;
+		cells.initializeFromBuffer(m_stackAlloc.allocateArray<int>(numWorkgroups),0,numWorkgroups);
+		b3AlignedObjectArray<int> taskLoad;
+		taskLoad.initializeFromBuffer(m_stackAlloc.allocateArray<int>(numTasks),0,numTasks);
+		b3CellSizeSortPredicate predicate;
+		predicate.m_numConstraints = &numConstraintsHost[0];
+		for (int cellBatch=0;cellBatch<B3_SOLVER_N_BATCHES;cellBatch++)
+		{
+			for (int t=0;t<numTasks;t++)
+				tasks[t].m_cellBatchOffsets[cellBatch] = tasks[t].m_cells.size();
+
+			cells.resize(0);
+			for (int wgIdx=0;wgIdx<numWorkgroups;wgIdx++)
+			{
+				int cellIdx = b3GetSolverCellIndex(m_nSplit,cellBatch,wgIdx);
+				if (numConstraintsHost[cellIdx])
+					cells.push_back(cellIdx);
+			}
+			cells.quickSort(predicate);
+
+			taskLoad.resize(0);
+			taskLoad.resize(numTasks,0);
+			for (int c=0;c<cells.size();c++)
+			{
+				int task = 0;
+				for (int t=1;t<numTasks;t++)
+				{
+					if (taskLoad[t]<taskLoad[task])
+						task = t;
+				}
+				tasks[task].m_cells.push_back(cells[c]);
+				taskLoad[task] += numConstraintsHost[cells[c]];
+			}
+		}
+		for (int t=0;t<numTasks;t++)
+		{
+			tasks[t].m_cellBatchOffsets[B3_SOLVER_N_BATCHES] = tasks[t].m_cells.size();
+			m_threadSupport->sendRequest(B3_THREAD_SCHEDULE_TASK,&tasks[t],t);
+		}
+		for (int t=0;t<numTasks;t++)
+		{
+			int arg0,arg1;
+			m_threadSupport->waitForResponse(&arg0,&arg1);
+		}
+		for (int t=0;t<numTasks;t++)
+			tasks[t].~b3SolveCellBatchesTask();
+		m_stackAlloc.endBlock(block);
+	} else if (useBatches)
 	{
 		for(int iter=0; iter<m_nIterations; iter++)
 		{
 			for (int cellBatch=0;cellBatch<B3_SOLVER_N_BATCHES;cellBatch++)
 			{
 				
-				int nSplitX = B3_SOLVER_N_SPLIT_X;
-				int nSplitY = B3_SOLVER_N_SPLIT_Y;
+				int nSplitX = m_nSplit.x;
+				int nSplitY = m_nSplit.y;
 				int numWorkgroups = B3_SOLVER_N_CELLS/B3_SOLVER_N_BATCHES;
 				//printf("cell Batch %d\n",cellBatch);
 				b3AlignedObjectArray<int> usedBodies[B3_SOLVER_N_CELLS];
@@ -729,8 +978,14 @@ void b3Solver::solveContactConstraintHost(  b3OpenCLArray<b3RigidBodyCL>* bodyBu
 					int numConstraintsInCell = numConstraintsHost[cellIdx];
 					const int end = start + numConstraintsInCell;
 
+#ifdef B3_DEBUG
 					SolveTask task( bodyNative, shapeNative, constraintNative, start, numConstraintsInCell ,maxNumBatches,usedBodies,wgIdx);
+#else
+					//the body usage of the cells is only verified when the asserts are enabled
+					SolveTask task( bodyNative, shapeNative, constraintNative, start, numConstraintsInCell ,maxNumBatches,0,0);
+#endif
 					task.m_solveFriction = false;
+					task.m_blockSolve = m_blockContactSolve;
 					task.run(0);
 				
 				}
@@ -741,8 +996,8 @@ void b3Solver::solveContactConstraintHost(  b3OpenCLArray<b3RigidBodyCL>* bodyBu
 		{
 			for (int cellBatch=0;cellBatch<B3_SOLVER_N_BATCHES;cellBatch++)
 			{
-				int nSplitX = B3_SOLVER_N_SPLIT_X;
-				int nSplitY = B3_SOLVER_N_SPLIT_Y;
+				int nSplitX = m_nSplit.x;
+				int nSplitY = m_nSplit.y;
 				
 
 				int numWorkgroups = B3_SOLVER_N_CELLS/B3_SOLVER_N_BATCHES;
@@ -780,6 +1035,7 @@ void b3Solver::solveContactConstraintHost(  b3OpenCLArray<b3RigidBodyCL>* bodyBu
 		{
 			SolveTask task( bodyNative, shapeNative, constraintNative, 0, n ,maxNumBatches,0,0);
 			task.m_solveFriction = false;
+			task.m_blockSolve = m_blockContactSolve;
 			task.run(0);
 		}
 
@@ -928,7 +1184,8 @@ void b3Solver::solveContactConstraint(  const b3OpenCLArray<b3RigidBodyCL>* body
 						b3BufferInfoCL( shapeBuf->getBufferCL() ), 
 						b3BufferInfoCL( constraint->getBufferCL() ),
 						b3BufferInfoCL( m_numConstraints->getBufferCL() ), 
-						b3BufferInfoCL( m_offsets->getBufferCL() ) 
+						b3BufferInfoCL( m_offsets->getBufferCL() ),
+						b3BufferInfoCL( m_residual->getBufferCL() )
 #ifdef DEBUG_ME
 						,	b3BufferInfoCL(&gpuDebugInfo)
 #endif
@@ -940,12 +1197,8 @@ void b3Solver::solveContactConstraint(  const b3OpenCLArray<b3RigidBodyCL>* body
 					//launcher.setConst(  cdata.x );
                     launcher.setConst(  cdata.y );
                     launcher.setConst(  cdata.z );
-                    b3Int4 nSplit;
-					nSplit.x = B3_SOLVER_N_SPLIT_X;
-					nSplit.y = B3_SOLVER_N_SPLIT_Y;
-					nSplit.z = B3_SOLVER_N_SPLIT_Z;
-
-                    launcher.setConst(  nSplit );
+                    launcher.setConst(  m_nSplit );
+                    launcher.setConst(  m_blockContactSolve? 1 : 0 );
                     launcher.launch1D( numWorkItems, 64 );
 
                     
@@ -1029,12 +1282,7 @@ void b3Solver::solveContactConstraint(  const b3OpenCLArray<b3RigidBodyCL>* body
 					//launcher.setConst(  cdata.x );
                     launcher.setConst(  cdata.y );
                     launcher.setConst(  cdata.z );
-                    b3Int4 nSplit;
-					nSplit.x = B3_SOLVER_N_SPLIT_X;
-					nSplit.y = B3_SOLVER_N_SPLIT_Y;
-					nSplit.z = B3_SOLVER_N_SPLIT_Z;
-
-                    launcher.setConst(  nSplit );
+                    launcher.setConst(  m_nSplit );
                     
 					launcher.launch1D( 64*nn/B3_SOLVER_N_BATCHES, 64 );
 				}
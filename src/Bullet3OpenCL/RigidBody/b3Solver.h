@@ -26,6 +26,11 @@ subject to the following restrictions:
 #include "Bullet3OpenCL/ParallelPrimitives/b3PrefixScanCL.h"
 #include "Bullet3OpenCL/ParallelPrimitives/b3RadixSort32CL.h"
 #include "Bullet3OpenCL/ParallelPrimitives/b3BoundSearchCL.h"
+#include "Bullet3Common/shared/b3Int4.h"
+#include "Bullet3Common/b3StackAlloc.h"
+
+class b3ThreadSupportInterface;
+class b3Barrier;
 
 #include "Bullet3OpenCL/Initialize/b3OpenCLUtils.h"
 
@@ -39,6 +44,7 @@ enum
 	B3_SOLVER_N_SPLIT_Z = 8,//,
 	B3_SOLVER_N_CELLS = B3_SOLVER_N_SPLIT_X*B3_SOLVER_N_SPLIT_Y*B3_SOLVER_N_SPLIT_Z,
 	B3_SOLVER_N_BATCHES = 8,//4,//8,//4,
+	B3_SOLVER_N_AXIS_BINS = 64,//histogram bins per axis used to pick m_nSplit, see SetAxisHistogramKernel
 };
 
 class b3SolverBase
@@ -71,9 +77,13 @@ class b3Solver : public b3SolverBase
 
 		b3OpenCLArray<unsigned int>* m_numConstraints;
 		b3OpenCLArray<unsigned int>* m_offsets;
+		///4 floats per work group and cell batch of BatchSolveKernelContact: largest delta impulse, sum of squared delta impulses, number of points
+		b3OpenCLArray<float>* m_residual;
 		
 		
 		int m_nIterations;
+		///solve the normal impulses of each b3GpuConstraint4 together, see b3ContactBlockSolver.h
+		bool m_blockContactSolve;
 		cl_kernel m_batchingKernel;
 		cl_kernel m_batchingKernelNew;
 		cl_kernel m_solveContactKernel;
@@ -90,6 +100,22 @@ class b3Solver : public b3SolverBase
 		b3OpenCLArray<b3SortData>* m_sortDataBuffer;
 		b3OpenCLArray<b3Contact4>* m_contactBuffer2;
 
+		///cell split of the current frame, x*y*z is B3_SOLVER_N_CELLS and each axis is an even power of two up to B3_SOLVER_N_AXIS_BINS
+		b3Int4	m_nSplit;
+
+		///when set, solveContactConstraintHost solves the cells of each cell batch on these threads
+		b3ThreadSupportInterface*	m_threadSupport;
+		b3Barrier*					m_barrier;
+
+		///host copies of solveContactConstraintHost, kept between the calls so they keep their capacity
+		b3AlignedObjectArray<b3RigidBodyCL>		m_bodiesHost;
+		b3AlignedObjectArray<b3InertiaCL>		m_inertiasHost;
+		b3AlignedObjectArray<b3GpuConstraint4>	m_constraintsHost;
+		b3AlignedObjectArray<unsigned int>		m_numConstraintsHost;
+		b3AlignedObjectArray<unsigned int>		m_offsetsHost;
+		///scratch of the threaded cell assignment, reserved before each call
+		b3StackAlloc				m_stackAlloc;
+
 		enum
 		{
 			DYNAMIC_CONTACT_ALLOCATION_THRESHOLD = 2000000,
@@ -108,6 +134,9 @@ class b3Solver : public b3SolverBase
 		void solveContactConstraintHost(  b3OpenCLArray<b3RigidBodyCL>* bodyBuf, b3OpenCLArray<b3InertiaCL>* shapeBuf, 
 			b3OpenCLArray<b3GpuConstraint4>* constraint, void* additionalData, int n ,int maxNumBatches);
 
+		///threadSupport needs to be created with b3ThreadTaskFunc and b3ThreadTaskLocalStoreFunc, pass 0 to solve the cells in series
+		void	setThreadSupport(b3ThreadSupportInterface* threadSupport);
+
 
 		void convertToConstraints( const b3OpenCLArray<b3RigidBodyCL>* bodyBuf, 
 			const b3OpenCLArray<b3InertiaCL>* shapeBuf, 
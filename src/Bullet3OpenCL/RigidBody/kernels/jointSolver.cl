@@ -17,6 +17,7 @@ subject to the following restrictions:
 
 #define B3_GPU_POINT2POINT_CONSTRAINT_TYPE 3
 #define B3_GPU_FIXED_CONSTRAINT_TYPE 4
+#define B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE 5
 
 #define MOTIONCLAMP 100000 //unused, for debugging/safety in case constraint solver fails
 #define B3_INFINITY 1e30f
@@ -185,6 +186,13 @@ typedef struct
 
 	int	m_flags;
 	int m_padding[3];
+
+	Quaternion m_frameInA;
+	Quaternion m_frameInB;
+	float4 m_linearLowerLimit;
+	float4 m_linearUpperLimit;
+	float4 m_angularLowerLimit;
+	float4 m_angularUpperLimit;
 } b3GpuGenericConstraint;
 
 
@@ -387,6 +395,7 @@ __kernel void getInfo1Kernel(__global unsigned int* infos, __global b3GpuGeneric
 			break;
 		}
 		case B3_GPU_FIXED_CONSTRAINT_TYPE:
+		case B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE:
 		{
 			infos[i] = 6;
 			break;
@@ -628,6 +637,112 @@ void getInfo2FixedOrientation(__global b3GpuGenericConstraint* constraint,b3GpuC
 }
 
 
+//row of one axis of a 6dof constraint, it stays zero (no effect) when the axis is free or within its limits
+void getInfo2Generic6DofRow(b3GpuConstraintInfo2* info, int row, float4 axis, float4 angularA, float4 angularB, float position, float lowerLimit, float upperLimit, int rotational)
+{
+	if (lowerLimit>upperLimit)
+		return;
+	float limitError = 0.f;
+	if (position<lowerLimit)
+		limitError = position-lowerLimit;
+	else if (position>upperLimit)
+		limitError = position-upperLimit;
+	else if (lowerLimit<upperLimit)
+		return;
+	if (rotational)
+	{
+		if (limitError>M_PI_F)
+			limitError -= 2.f*M_PI_F;
+		else if (limitError<-M_PI_F)
+			limitError += 2.f*M_PI_F;
+	}
+
+	int srow = row*info->rowskip;
+	if (!rotational)
+	{
+		info->m_J1linearAxis[srow] = axis.x;
+		info->m_J1linearAxis[srow+1] = axis.y;
+		info->m_J1linearAxis[srow+2] = axis.z;
+	}
+	info->m_J1angularAxis[srow] = angularA.x;
+	info->m_J1angularAxis[srow+1] = angularA.y;
+	info->m_J1angularAxis[srow+2] = angularA.z;
+	info->m_J2angularAxis[srow] = angularB.x;
+	info->m_J2angularAxis[srow+1] = angularB.y;
+	info->m_J2angularAxis[srow+2] = angularB.z;
+
+	//the Euler angles decrease when body B turns along the axis, the linear offsets increase when it moves along it
+	float k = info->fps * info->erp;
+	float error = rotational? -k*limitError : k*limitError;
+	info->m_constraintError[srow] = error;
+	if (lowerLimit<upperLimit)
+	{
+		//a limit only pushes back
+		info->m_lowerLimit[srow] = error>0.f? 0.f : -B3_INFINITY;
+		info->m_upperLimit[srow] = error>0.f? B3_INFINITY : 0.f;
+	}
+}
+
+//same rows as b3GpuGenericConstraint::getInfo2 on the host, the angles are the Euler XYZ angles of b3Generic6DofConstraint
+void getInfo2Generic6Dof(__global b3GpuGenericConstraint* constraint,b3GpuConstraintInfo2* info,__global b3RigidBodyCL* bodies)
+{
+	float4 posA = bodies[constraint->m_rbA].m_pos;
+	Quaternion rotA = bodies[constraint->m_rbA].m_quat;
+	float4 posB = bodies[constraint->m_rbB].m_pos;
+	Quaternion rotB = bodies[constraint->m_rbB].m_quat;
+
+	Quaternion frameA = qtMul(rotA,constraint->m_frameInA);
+	Quaternion frameB = qtMul(rotB,constraint->m_frameInB);
+	float4 a0 = qtRotate(frameA,(float4)(1,0,0,0));
+	float4 a1 = qtRotate(frameA,(float4)(0,1,0,0));
+	float4 a2 = qtRotate(frameA,(float4)(0,0,1,0));
+	float4 b0 = qtRotate(frameB,(float4)(1,0,0,0));
+	float4 b1 = qtRotate(frameB,(float4)(0,1,0,0));
+	float4 b2 = qtRotate(frameB,(float4)(0,0,1,0));
+	float4 originA = posA + qtRotate(rotA,constraint->m_pivotInA);
+	float4 originB = posB + qtRotate(rotB,constraint->m_pivotInB);
+
+	//linear rows along the axes of frame A
+	float4 diff = originB-originA;
+	float4 relA = originB-posA;
+	float4 relB = originB-posB;
+	getInfo2Generic6DofRow(info,0,a0,cross3(relA,a0),-cross3(relB,a0),dot3F4(diff,a0),constraint->m_linearLowerLimit.x,constraint->m_linearUpperLimit.x,0);
+	getInfo2Generic6DofRow(info,1,a1,cross3(relA,a1),-cross3(relB,a1),dot3F4(diff,a1),constraint->m_linearLowerLimit.y,constraint->m_linearUpperLimit.y,0);
+	getInfo2Generic6DofRow(info,2,a2,cross3(relA,a2),-cross3(relB,a2),dot3F4(diff,a2),constraint->m_linearLowerLimit.z,constraint->m_linearUpperLimit.z,0);
+
+	//Euler XYZ angles of the relative frame, mij is the dot product of axis i of frame A and axis j of frame B
+	float m00 = dot3F4(a0,b0);
+	float m01 = dot3F4(a0,b1);
+	float m10 = dot3F4(a1,b0);
+	float m11 = dot3F4(a1,b1);
+	float m20 = dot3F4(a2,b0);
+	float m21 = dot3F4(a2,b1);
+	float m22 = dot3F4(a2,b2);
+	float4 angle;
+	if (m20 < 1.f)
+	{
+		if (m20 > -1.f)
+		{
+			angle = (float4)(atan2(-m21,m22),asin(m20),atan2(-m10,m00),0.f);
+		} else
+		{
+			angle = (float4)(-atan2(m01,m11),-0.5f*M_PI_F,0.f,0.f);
+		}
+	} else
+	{
+		angle = (float4)(atan2(m01,m11),0.5f*M_PI_F,0.f,0.f);
+	}
+
+	//angular rows, see b3Generic6DofConstraint::calculateAngleInfo
+	float4 axis1 = fastNormalize4(cross3(a2,b0));
+	float4 axis0 = fastNormalize4(cross3(axis1,a2));
+	float4 axis2 = fastNormalize4(cross3(b0,axis1));
+	getInfo2Generic6DofRow(info,3,axis0,axis0,-axis0,angle.x,constraint->m_angularLowerLimit.x,constraint->m_angularUpperLimit.x,1);
+	getInfo2Generic6DofRow(info,4,axis1,axis1,-axis1,angle.y,constraint->m_angularLowerLimit.y,constraint->m_angularUpperLimit.y,1);
+	getInfo2Generic6DofRow(info,5,axis2,axis2,-axis2,angle.z,constraint->m_angularLowerLimit.z,constraint->m_angularUpperLimit.z,1);
+}
+
+
 __kernel void writeBackVelocitiesKernel(__global b3RigidBodyCL* bodies,__global b3GpuSolverBody* solverBodies,int numBodies)
 {
 	int i = get_global_id(0);
@@ -793,6 +908,11 @@ __kernel void getInfo2Kernel(__global b3SolverConstraint* solverConstraintRows,
 
 				break;
 			}
+			case B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE:
+			{
+				getInfo2Generic6Dof(constraint,&info2,bodies);
+				break;
+			}
 
 			default:
 			{
@@ -15,6 +15,7 @@ static const char* solveConstraintRowsCL= \
 "#define B3_CONSTRAINT_FLAG_ENABLED 1\n"
 "#define B3_GPU_POINT2POINT_CONSTRAINT_TYPE 3\n"
 "#define B3_GPU_FIXED_CONSTRAINT_TYPE 4\n"
+"#define B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE 5\n"
 "#define MOTIONCLAMP 100000 //unused, for debugging/safety in case constraint solver fails\n"
 "#define B3_INFINITY 1e30f\n"
 "#define mymake_float4 (float4)\n"
@@ -140,6 +141,12 @@ static const char* solveConstraintRowsCL= \
 "	Quaternion m_relTargetAB;\n"
 "	int	m_flags;\n"
 "	int m_padding[3];\n"
+"	Quaternion m_frameInA;\n"
+"	Quaternion m_frameInB;\n"
+"	float4 m_linearLowerLimit;\n"
+"	float4 m_linearUpperLimit;\n"
+"	float4 m_angularLowerLimit;\n"
+"	float4 m_angularUpperLimit;\n"
 "} b3GpuGenericConstraint;\n"
 "/*b3Transform	getWorldTransform(b3RigidBodyCL* rb)\n"
 "{\n"
@@ -305,6 +312,7 @@ static const char* solveConstraintRowsCL= \
 "			break;\n"
 "		}\n"
 "		case B3_GPU_FIXED_CONSTRAINT_TYPE:\n"
+"		case B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE:\n"
 "		{\n"
 "			infos[i] = 6;\n"
 "			break;\n"
@@ -508,6 +516,103 @@ static const char* solveConstraintRowsCL= \
 "    }\n"
 "	\n"
 "}\n"
+"//row of one axis of a 6dof constraint, it stays zero (no effect) when the axis is free or within its limits\n"
+"void getInfo2Generic6DofRow(b3GpuConstraintInfo2* info, int row, float4 axis, float4 angularA, float4 angularB, float position, float lowerLimit, float upperLimit, int rotational)\n"
+"{\n"
+"	if (lowerLimit>upperLimit)\n"
+"		return;\n"
+"	float limitError = 0.f;\n"
+"	if (position<lowerLimit)\n"
+"		limitError = position-lowerLimit;\n"
+"	else if (position>upperLimit)\n"
+"		limitError = position-upperLimit;\n"
+"	else if (lowerLimit<upperLimit)\n"
+"		return;\n"
+"	if (rotational)\n"
+"	{\n"
+"		if (limitError>M_PI_F)\n"
+"			limitError -= 2.f*M_PI_F;\n"
+"		else if (limitError<-M_PI_F)\n"
+"			limitError += 2.f*M_PI_F;\n"
+"	}\n"
+"	int srow = row*info->rowskip;\n"
+"	if (!rotational)\n"
+"	{\n"
+"		info->m_J1linearAxis[srow] = axis.x;\n"
+"		info->m_J1linearAxis[srow+1] = axis.y;\n"
+"		info->m_J1linearAxis[srow+2] = axis.z;\n"
+"	}\n"
+"	info->m_J1angularAxis[srow] = angularA.x;\n"
+"	info->m_J1angularAxis[srow+1] = angularA.y;\n"
+"	info->m_J1angularAxis[srow+2] = angularA.z;\n"
+"	info->m_J2angularAxis[srow] = angularB.x;\n"
+"	info->m_J2angularAxis[srow+1] = angularB.y;\n"
+"	info->m_J2angularAxis[srow+2] = angularB.z;\n"
+"	//the Euler angles decrease when body B turns along the axis, the linear offsets increase when it moves along it\n"
+"	float k = info->fps * info->erp;\n"
+"	float error = rotational? -k*limitError : k*limitError;\n"
+"	info->m_constraintError[srow] = error;\n"
+"	if (lowerLimit<upperLimit)\n"
+"	{\n"
+"		//a limit only pushes back\n"
+"		info->m_lowerLimit[srow] = error>0.f? 0.f : -B3_INFINITY;\n"
+"		info->m_upperLimit[srow] = error>0.f? B3_INFINITY : 0.f;\n"
+"	}\n"
+"}\n"
+"//same rows as b3GpuGenericConstraint::getInfo2 on the host, the angles are the Euler XYZ angles of b3Generic6DofConstraint\n"
+"void getInfo2Generic6Dof(__global b3GpuGenericConstraint* constraint,b3GpuConstraintInfo2* info,__global b3RigidBodyCL* bodies)\n"
+"{\n"
+"	float4 posA = bodies[constraint->m_rbA].m_pos;\n"
+"	Quaternion rotA = bodies[constraint->m_rbA].m_quat;\n"
+"	float4 posB = bodies[constraint->m_rbB].m_pos;\n"
+"	Quaternion rotB = bodies[constraint->m_rbB].m_quat;\n"
+"	Quaternion frameA = qtMul(rotA,constraint->m_frameInA);\n"
+"	Quaternion frameB = qtMul(rotB,constraint->m_frameInB);\n"
+"	float4 a0 = qtRotate(frameA,(float4)(1,0,0,0));\n"
+"	float4 a1 = qtRotate(frameA,(float4)(0,1,0,0));\n"
+"	float4 a2 = qtRotate(frameA,(float4)(0,0,1,0));\n"
+"	float4 b0 = qtRotate(frameB,(float4)(1,0,0,0));\n"
+"	float4 b1 = qtRotate(frameB,(float4)(0,1,0,0));\n"
+"	float4 b2 = qtRotate(frameB,(float4)(0,0,1,0));\n"
+"	float4 originA = posA + qtRotate(rotA,constraint->m_pivotInA);\n"
+"	float4 originB = posB + qtRotate(rotB,constraint->m_pivotInB);\n"
+"	//linear rows along the axes of frame A\n"
+"	float4 diff = originB-originA;\n"
+"	float4 relA = originB-posA;\n"
+"	float4 relB = originB-posB;\n"
+"	getInfo2Generic6DofRow(info,0,a0,cross3(relA,a0),-cross3(relB,a0),dot3F4(diff,a0),constraint->m_linearLowerLimit.x,constraint->m_linearUpperLimit.x,0);\n"
+"	getInfo2Generic6DofRow(info,1,a1,cross3(relA,a1),-cross3(relB,a1),dot3F4(diff,a1),constraint->m_linearLowerLimit.y,constraint->m_linearUpperLimit.y,0);\n"
+"	getInfo2Generic6DofRow(info,2,a2,cross3(relA,a2),-cross3(relB,a2),dot3F4(diff,a2),constraint->m_linearLowerLimit.z,constraint->m_linearUpperLimit.z,0);\n"
+"	//Euler XYZ angles of the relative frame, mij is the dot product of axis i of frame A and axis j of frame B\n"
+"	float m00 = dot3F4(a0,b0);\n"
+"	float m01 = dot3F4(a0,b1);\n"
+"	float m10 = dot3F4(a1,b0);\n"
+"	float m11 = dot3F4(a1,b1);\n"
+"	float m20 = dot3F4(a2,b0);\n"
+"	float m21 = dot3F4(a2,b1);\n"
+"	float m22 = dot3F4(a2,b2);\n"
+"	float4 angle;\n"
+"	if (m20 < 1.f)\n"
+"	{\n"
+"		if (m20 > -1.f)\n"
+"		{\n"
+"			angle = (float4)(atan2(-m21,m22),asin(m20),atan2(-m10,m00),0.f);\n"
+"		} else\n"
+"		{\n"
+"			angle = (float4)(-atan2(m01,m11),-0.5f*M_PI_F,0.f,0.f);\n"
+"		}\n"
+"	} else\n"
+"	{\n"
+"		angle = (float4)(atan2(m01,m11),0.5f*M_PI_F,0.f,0.f);\n"
+"	}\n"
+"	//angular rows, see b3Generic6DofConstraint::calculateAngleInfo\n"
+"	float4 axis1 = fastNormalize4(cross3(a2,b0));\n"
+"	float4 axis0 = fastNormalize4(cross3(axis1,a2));\n"
+"	float4 axis2 = fastNormalize4(cross3(b0,axis1));\n"
+"	getInfo2Generic6DofRow(info,3,axis0,axis0,-axis0,angle.x,constraint->m_angularLowerLimit.x,constraint->m_angularUpperLimit.x,1);\n"
+"	getInfo2Generic6DofRow(info,4,axis1,axis1,-axis1,angle.y,constraint->m_angularLowerLimit.y,constraint->m_angularUpperLimit.y,1);\n"
+"	getInfo2Generic6DofRow(info,5,axis2,axis2,-axis2,angle.z,constraint->m_angularLowerLimit.z,constraint->m_angularUpperLimit.z,1);\n"
+"}\n"
 "__kernel void writeBackVelocitiesKernel(__global b3RigidBodyCL* bodies,__global b3GpuSolverBody* solverBodies,int numBodies)\n"
 "{\n"
 "	int i = get_global_id(0);\n"
@@ -650,6 +755,11 @@ static const char* solveConstraintRowsCL= \
 "				getInfo2FixedOrientation(constraint,&info2,bodies,3);\n"
 "				break;\n"
 "			}\n"
+"			case B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE:\n"
+"			{\n"
+"				getInfo2Generic6Dof(constraint,&info2,bodies);\n"
+"				break;\n"
+"			}\n"
 "			default:\n"
 "			{\n"
 "			}\n"
@@ -13,6 +13,8 @@ subject to the following restrictions:
 */
 //Originally written by Takahiro Harada
 
+#include "Bullet3Dynamics/shared/b3ContactBlockSolver.h"
+
 
 //#pragma OPENCL EXTENSION cl_amd_printf : enable
 #pragma OPENCL EXTENSION cl_khr_local_int32_base_atomics : enable
@@ -256,13 +258,14 @@ float calcJacCoeff(const float4 linear0, const float4 linear1, const float4 angu
 }
 
 
+//residual: x is the largest absolute delta impulse, y the sum of squared delta impulses and z the number of solved points
 void solveContact(__global Constraint4* cs,
 				  float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,
-				  float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB);
+				  float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual);
 
 void solveContact(__global Constraint4* cs,
 			float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,
-			float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB)
+			float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual)
 {
 	float minRambdaDt = 0;
 	float maxRambdaDt = FLT_MAX;
@@ -289,6 +292,9 @@ void solveContact(__global Constraint4* cs,
 			rambdaDt = updated - prevSum;
 			cs->m_appliedRambdaDt[ic] = updated;
 		}
+		residual->x = max2( residual->x, fabs(rambdaDt) );
+		residual->y += rambdaDt*rambdaDt;
+		residual->z += 1.f;
 
 		float4 linImp0 = invMassA*linear*rambdaDt;
 		float4 linImp1 = invMassB*(-linear)*rambdaDt;
@@ -302,6 +308,79 @@ void solveContact(__global Constraint4* cs,
 	}
 }
 
+//solves the normal impulses of the points together, see b3ContactBlockSolver.h, falls back to solveContact when the block LCP fails
+void solveContactBlock(__global Constraint4* cs,
+				  float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,
+				  float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual);
+
+void solveContactBlock(__global Constraint4* cs,
+			float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,
+			float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual)
+{
+	float4 angular0[4];
+	float4 angular1[4];
+	float A[16];
+	float b[4];
+	float lambda[4];
+	int pointIdx[4];
+	int n = 0;
+
+	for(int ic=0; ic<4; ic++)
+	{
+		if( cs->m_jacCoeffInv[ic] == 0.f ) continue;
+
+		float4 linear;
+		float4 r0 = cs->m_worldPos[ic] - posA;
+		float4 r1 = cs->m_worldPos[ic] - posB;
+		setLinearAndAngular( -cs->m_linear, r0, r1, &linear, &angular0[n], &angular1[n] );
+		pointIdx[n++] = ic;
+	}
+
+	if( n>1 )
+	{
+		for(int i=0; i<n; i++)
+		{
+			float4 invInertiaAngular0 = mtMul1(invInertiaA, angular0[i]);
+			float4 invInertiaAngular1 = mtMul1(invInertiaB, angular1[i]);
+			for(int j=0; j<n; j++)
+			{
+				A[j*4+i] = invMassA + invMassB + dot3F4(angular0[j], invInertiaAngular0) + dot3F4(angular1[j], invInertiaAngular1);
+			}
+			b[i] = calcRelVel( cs->m_linear, -cs->m_linear, angular0[i], angular1[i], 
+				*linVelA, *angVelA, *linVelB, *angVelB ) + cs->m_b[pointIdx[i]];
+		}
+		for(int i=0; i<n; i++)
+		{
+			for(int j=0; j<n; j++)
+				b[i] -= A[i*4+j]*cs->m_appliedRambdaDt[pointIdx[j]];
+		}
+	}
+
+	if( n<2 || !b3SolveContactBlockLcp(A, b, n, lambda) )
+	{
+		solveContact( cs, posA, linVelA, angVelA, invMassA, invInertiaA,
+			posB, linVelB, angVelB, invMassB, invInertiaB, residual );
+		return;
+	}
+
+	float4 linear = cs->m_linear;
+	for(int i=0; i<n; i++)
+	{
+		int ic = pointIdx[i];
+		float rambdaDt = lambda[i] - cs->m_appliedRambdaDt[ic];
+		cs->m_appliedRambdaDt[ic] = lambda[i];
+
+		residual->x = max2( residual->x, fabs(rambdaDt) );
+		residual->y += rambdaDt*rambdaDt;
+		residual->z += 1.f;
+
+		*linVelA += invMassA*linear*rambdaDt;
+		*angVelA += mtMul1(invInertiaA, angular0[i])*rambdaDt;
+		*linVelB += invMassB*(-linear)*rambdaDt;
+		*angVelB += mtMul1(invInertiaB, angular1[i])*rambdaDt;
+	}
+}
+
 void btPlaneSpace1 (const float4* n, float4* p, float4* q);
  void btPlaneSpace1 (const float4* n, float4* p, float4* q)
 {
@@ -331,8 +410,8 @@ void btPlaneSpace1 (const float4* n, float4* p, float4* q);
   }
 }
 
-void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs);
-void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs)
+void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs, float4* residual, int blockSolve);
+void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs, float4* residual, int blockSolve)
 {
 	//float frictionCoeff = ldsCs[0].m_linear.w;
 	int aIdx = ldsCs[0].m_bodyA;
@@ -350,8 +429,15 @@ void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __g
 	float invMassB = gBodies[bIdx].m_invMass;
 	Matrix3x3 invInertiaB = gShapes[bIdx].m_invInertia;
 
-	solveContact( ldsCs, posA, &linVelA, &angVelA, invMassA, invInertiaA,
-			posB, &linVelB, &angVelB, invMassB, invInertiaB );
+	if (blockSolve)
+	{
+		solveContactBlock( ldsCs, posA, &linVelA, &angVelA, invMassA, invInertiaA,
+			posB, &linVelB, &angVelB, invMassB, invInertiaB, residual );
+	} else
+	{
+		solveContact( ldsCs, posA, &linVelA, &angVelA, invMassA, invInertiaA,
+			posB, &linVelB, &angVelB, invMassB, invInertiaB, residual );
+	}
 
   if (gBodies[aIdx].m_invMass)
   {
@@ -401,12 +487,15 @@ void BatchSolveKernelContact(__global Body* gBodies,
                       __global Constraint4* gConstraints,
                       __global int* gN,
                       __global int* gOffsets,
+                      __global float4* gResidual,
                        int maxBatch,
                        int cellBatch,
-                       int4 nSplit
+                       int4 nSplit,
+                       int blockSolve
                       )
 {
 	//__local int ldsBatchIdx[WG_SIZE+1];
+	__local float4 ldsResidual[WG_SIZE];
 	__local int ldsCurBatch;
 	__local int ldsNextBatch;
 	__local int ldsStart;
@@ -428,9 +517,16 @@ void BatchSolveKernelContact(__global Body* gBodies,
 	//int xIdx = (wgIdx/(nSplit/2))*2 + (bIdx&1);
 	//int yIdx = (wgIdx%(nSplit/2))*2 + (bIdx>>1);
 	//int cellIdx = xIdx+yIdx*nSplit;
+
+	//one residual per work group and cell batch, the host reduces them after each iteration
+	int residualIdx = cellBatch*GET_NUM_GROUPS+wgIdx;
 	
 	if( gN[cellIdx] == 0 ) 
+	{
+		if( lIdx == 0 )
+			gResidual[residualIdx] = mymake_float4(0,0,0,0);
 		return;
+	}
 
 	
 	
@@ -450,6 +546,7 @@ void BatchSolveKernelContact(__global Body* gBodies,
 
 	GROUP_LDS_BARRIER;
 
+	float4 residual = mymake_float4(0,0,0,0);
 	int idx=ldsStart+lIdx;
 	while (ldsCurBatch < maxBatch)
 	{
@@ -457,7 +554,7 @@ void BatchSolveKernelContact(__global Body* gBodies,
 		{
 			if (gConstraints[idx].m_batchIdx == ldsCurBatch)
 			{
-					solveContactConstraint( gBodies, gShapes, &gConstraints[idx] );
+					solveContactConstraint( gBodies, gShapes, &gConstraints[idx], &residual, blockSolve );
 
 				 idx+=64;
 			} else
@@ -473,6 +570,21 @@ void BatchSolveKernelContact(__global Body* gBodies,
 		}
 		GROUP_LDS_BARRIER;
 	}
-	
+
+	ldsResidual[lIdx] = residual;
+	GROUP_LDS_BARRIER;
+	for(int stride=WG_SIZE/2; stride>0; stride>>=1)
+	{
+		if( lIdx < stride )
+		{
+			float4 other = ldsResidual[lIdx+stride];
+			ldsResidual[lIdx].x = max2( ldsResidual[lIdx].x, other.x );
+			ldsResidual[lIdx].y += other.y;
+			ldsResidual[lIdx].z += other.z;
+		}
+		GROUP_LDS_BARRIER;
+	}
+	if( lIdx == 0 )
+		gResidual[residualIdx] = ldsResidual[0];
     
 }
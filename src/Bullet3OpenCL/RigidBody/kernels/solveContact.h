@@ -12,6 +12,104 @@ static const char* solveContactCL= \
 "3. This notice may not be removed or altered from any source distribution.\n"
 "*/\n"
 "//Originally written by Takahiro Harada\n"
+"#ifndef B3_CONTACT_BLOCK_SOLVER_H\n"
+"#define B3_CONTACT_BLOCK_SOLVER_H\n"
+"///block solver for the normal impulses of a contact manifold with up to 4 points, shared by the host and OpenCL solvers\n"
+"///A is the 4x4 (row major) effective mass matrix of the points, the relative normal velocity is w = A*lambda + b\n"
+"///it finds lambda >= 0 with w >= 0 and lambda[i]*w[i] = 0 by enumerating the active sets, the most active points first\n"
+"#define B3_CONTACT_BLOCK_MAX_POINTS 4\n"
+"///relative regularization of the diagonal, 4 coplanar points only have 3 independent normal rows\n"
+"#define B3_CONTACT_BLOCK_REGULARIZATION 1e-4f\n"
+"#define B3_CONTACT_BLOCK_TOLERANCE 1e-5f\n"
+"inline int b3ContactBlockCountBits(int mask)\n"
+"{\n"
+"	int count = 0;\n"
+"	for (int i=0;i<B3_CONTACT_BLOCK_MAX_POINTS;i++)\n"
+"	{\n"
+"		if (mask&(1<<i))\n"
+"			count++;\n"
+"	}\n"
+"	return count;\n"
+"}\n"
+"///solves the points in activeMask as equalities, returns 0 when the solution violates lambda >= 0 or w >= 0\n"
+"inline int b3SolveContactBlockSubset(const float* A, const float* b, int n, int activeMask, float* lambda)\n"
+"{\n"
+"	float M[16];\n"
+"	float r[4];\n"
+"	float y[4];\n"
+"	int idx[4];\n"
+"	int k = 0;\n"
+"	for (int i=0;i<n;i++)\n"
+"	{\n"
+"		if (activeMask&(1<<i))\n"
+"			idx[k++] = i;\n"
+"	}\n"
+"	for (int i=0;i<k;i++)\n"
+"	{\n"
+"		for (int j=0;j<k;j++)\n"
+"			M[i*4+j] = A[idx[i]*4+idx[j]];\n"
+"		M[i*4+i] *= 1.f+B3_CONTACT_BLOCK_REGULARIZATION;\n"
+"		r[i] = -b[idx[i]];\n"
+"	}\n"
+"	//Gaussian elimination without pivoting, the matrix is symmetric and (after regularization) positive definite\n"
+"	for (int p=0;p<k;p++)\n"
+"	{\n"
+"		float pivot = M[p*4+p];\n"
+"		if (pivot <= B3_CONTACT_BLOCK_TOLERANCE*A[idx[p]*4+idx[p]])\n"
+"			return 0;\n"
+"		float invPivot = 1.f/pivot;\n"
+"		for (int i=p+1;i<k;i++)\n"
+"		{\n"
+"			float f = M[i*4+p]*invPivot;\n"
+"			for (int j=p;j<k;j++)\n"
+"				M[i*4+j] -= f*M[p*4+j];\n"
+"			r[i] -= f*r[p];\n"
+"		}\n"
+"	}\n"
+"	for (int i=k-1;i>=0;i--)\n"
+"	{\n"
+"		float s = r[i];\n"
+"		for (int j=i+1;j<k;j++)\n"
+"			s -= M[i*4+j]*y[j];\n"
+"		y[i] = s/M[i*4+i];\n"
+"		if (y[i] < 0.f)\n"
+"			return 0;\n"
+"	}\n"
+"	//the separating points must not approach\n"
+"	for (int j=0;j<n;j++)\n"
+"	{\n"
+"		if (activeMask&(1<<j))\n"
+"			continue;\n"
+"		float w = b[j];\n"
+"		for (int i=0;i<k;i++)\n"
+"			w += A[j*4+idx[i]]*y[i];\n"
+"		float absB = b[j] < 0.f ? -b[j] : b[j];\n"
+"		if (w < -B3_CONTACT_BLOCK_TOLERANCE*(1.f+absB))\n"
+"			return 0;\n"
+"	}\n"
+"	for (int i=0;i<n;i++)\n"
+"		lambda[i] = 0.f;\n"
+"	for (int i=0;i<k;i++)\n"
+"		lambda[idx[i]] = y[i];\n"
+"	return 1;\n"
+"}\n"
+"///returns 0 when no active set satisfies the conditions, the caller should solve the points one by one instead\n"
+"inline int b3SolveContactBlockLcp(const float* A, const float* b, int n, float* lambda)\n"
+"{\n"
+"	int numMasks = 1<<n;\n"
+"	for (int numActive=n;numActive>=0;numActive--)\n"
+"	{\n"
+"		for (int mask=numMasks-1;mask>=0;mask--)\n"
+"		{\n"
+"			if (b3ContactBlockCountBits(mask)!=numActive)\n"
+"				continue;\n"
+"			if (b3SolveContactBlockSubset(A,b,n,mask,lambda))\n"
+"				return 1;\n"
+"		}\n"
+"	}\n"
+"	return 0;\n"
+"}\n"
+"#endif //B3_CONTACT_BLOCK_SOLVER_H\n"
 "//#pragma OPENCL EXTENSION cl_amd_printf : enable\n"
 "#pragma OPENCL EXTENSION cl_khr_local_int32_base_atomics : enable\n"
 "#pragma OPENCL EXTENSION cl_khr_global_int32_base_atomics : enable\n"
@@ -184,12 +282,13 @@ static const char* solveContactCL= \
 "	float jmj3 = dot3F4(mtMul3(angular1,*invInertia1), angular1);\n"
 "	return -1.f/(jmj0+jmj1+jmj2+jmj3);\n"
 "}\n"
+"//residual: x is the largest absolute delta impulse, y the sum of squared delta impulses and z the number of solved points\n"
 "void solveContact(__global Constraint4* cs,\n"
 "				  float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,\n"
-"				  float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB);\n"
+"				  float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual);\n"
 "void solveContact(__global Constraint4* cs,\n"
 "			float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,\n"
-"			float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB)\n"
+"			float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual)\n"
 "{\n"
 "	float minRambdaDt = 0;\n"
 "	float maxRambdaDt = FLT_MAX;\n"
@@ -212,6 +311,9 @@ static const char* solveContactCL= \
 "			rambdaDt = updated - prevSum;\n"
 "			cs->m_appliedRambdaDt[ic] = updated;\n"
 "		}\n"
+"		residual->x = max2( residual->x, fabs(rambdaDt) );\n"
+"		residual->y += rambdaDt*rambdaDt;\n"
+"		residual->z += 1.f;\n"
 "		float4 linImp0 = invMassA*linear*rambdaDt;\n"
 "		float4 linImp1 = invMassB*(-linear)*rambdaDt;\n"
 "		float4 angImp0 = mtMul1(invInertiaA, angular0)*rambdaDt;\n"
@@ -222,6 +324,70 @@ static const char* solveContactCL= \
 "		*angVelB += angImp1;\n"
 "	}\n"
 "}\n"
+"//solves the normal impulses of the points together, see b3ContactBlockSolver.h, falls back to solveContact when the block LCP fails\n"
+"void solveContactBlock(__global Constraint4* cs,\n"
+"				  float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,\n"
+"				  float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual);\n"
+"void solveContactBlock(__global Constraint4* cs,\n"
+"			float4 posA, float4* linVelA, float4* angVelA, float invMassA, Matrix3x3 invInertiaA,\n"
+"			float4 posB, float4* linVelB, float4* angVelB, float invMassB, Matrix3x3 invInertiaB, float4* residual)\n"
+"{\n"
+"	float4 angular0[4];\n"
+"	float4 angular1[4];\n"
+"	float A[16];\n"
+"	float b[4];\n"
+"	float lambda[4];\n"
+"	int pointIdx[4];\n"
+"	int n = 0;\n"
+"	for(int ic=0; ic<4; ic++)\n"
+"	{\n"
+"		if( cs->m_jacCoeffInv[ic] == 0.f ) continue;\n"
+"		float4 linear;\n"
+"		float4 r0 = cs->m_worldPos[ic] - posA;\n"
+"		float4 r1 = cs->m_worldPos[ic] - posB;\n"
+"		setLinearAndAngular( -cs->m_linear, r0, r1, &linear, &angular0[n], &angular1[n] );\n"
+"		pointIdx[n++] = ic;\n"
+"	}\n"
+"	if( n>1 )\n"
+"	{\n"
+"		for(int i=0; i<n; i++)\n"
+"		{\n"
+"			float4 invInertiaAngular0 = mtMul1(invInertiaA, angular0[i]);\n"
+"			float4 invInertiaAngular1 = mtMul1(invInertiaB, angular1[i]);\n"
+"			for(int j=0; j<n; j++)\n"
+"			{\n"
+"				A[j*4+i] = invMassA + invMassB + dot3F4(angular0[j], invInertiaAngular0) + dot3F4(angular1[j], invInertiaAngular1);\n"
+"			}\n"
+"			b[i] = calcRelVel( cs->m_linear, -cs->m_linear, angular0[i], angular1[i], \n"
+"				*linVelA, *angVelA, *linVelB, *angVelB ) + cs->m_b[pointIdx[i]];\n"
+"		}\n"
+"		for(int i=0; i<n; i++)\n"
+"		{\n"
+"			for(int j=0; j<n; j++)\n"
+"				b[i] -= A[i*4+j]*cs->m_appliedRambdaDt[pointIdx[j]];\n"
+"		}\n"
+"	}\n"
+"	if( n<2 || !b3SolveContactBlockLcp(A, b, n, lambda) )\n"
+"	{\n"
+"		solveContact( cs, posA, linVelA, angVelA, invMassA, invInertiaA,\n"
+"			posB, linVelB, angVelB, invMassB, invInertiaB, residual );\n"
+"		return;\n"
+"	}\n"
+"	float4 linear = cs->m_linear;\n"
+"	for(int i=0; i<n; i++)\n"
+"	{\n"
+"		int ic = pointIdx[i];\n"
+"		float rambdaDt = lambda[i] - cs->m_appliedRambdaDt[ic];\n"
+"		cs->m_appliedRambdaDt[ic] = lambda[i];\n"
+"		residual->x = max2( residual->x, fabs(rambdaDt) );\n"
+"		residual->y += rambdaDt*rambdaDt;\n"
+"		residual->z += 1.f;\n"
+"		*linVelA += invMassA*linear*rambdaDt;\n"
+"		*angVelA += mtMul1(invInertiaA, angular0[i])*rambdaDt;\n"
+"		*linVelB += invMassB*(-linear)*rambdaDt;\n"
+"		*angVelB += mtMul1(invInertiaB, angular1[i])*rambdaDt;\n"
+"	}\n"
+"}\n"
 "void btPlaneSpace1 (const float4* n, float4* p, float4* q);\n"
 " void btPlaneSpace1 (const float4* n, float4* p, float4* q)\n"
 "{\n"
@@ -250,8 +416,8 @@ static const char* solveContactCL= \
 "	q[0].z = a*k;\n"
 "  }\n"
 "}\n"
-"void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs);\n"
-"void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs)\n"
+"void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs, float4* residual, int blockSolve);\n"
+"void solveContactConstraint(__global Body* gBodies, __global Shape* gShapes, __global Constraint4* ldsCs, float4* residual, int blockSolve)\n"
 "{\n"
 "	//float frictionCoeff = ldsCs[0].m_linear.w;\n"
 "	int aIdx = ldsCs[0].m_bodyA;\n"
@@ -266,8 +432,15 @@ static const char* solveContactCL= \
 "	float4 angVelB = gBodies[bIdx].m_angVel;\n"
 "	float invMassB = gBodies[bIdx].m_invMass;\n"
 "	Matrix3x3 invInertiaB = gShapes[bIdx].m_invInertia;\n"
-"	solveContact( ldsCs, posA, &linVelA, &angVelA, invMassA, invInertiaA,\n"
-"			posB, &linVelB, &angVelB, invMassB, invInertiaB );\n"
+"	if (blockSolve)\n"
+"	{\n"
+"		solveContactBlock( ldsCs, posA, &linVelA, &angVelA, invMassA, invInertiaA,\n"
+"			posB, &linVelB, &angVelB, invMassB, invInertiaB, residual );\n"
+"	} else\n"
+"	{\n"
+"		solveContact( ldsCs, posA, &linVelA, &angVelA, invMassA, invInertiaA,\n"
+"			posB, &linVelB, &angVelB, invMassB, invInertiaB, residual );\n"
+"	}\n"
 "  if (gBodies[aIdx].m_invMass)\n"
 "  {\n"
 "		gBodies[aIdx].m_linVel = linVelA;\n"
@@ -307,12 +480,15 @@ static const char* solveContactCL= \
 "                      __global Constraint4* gConstraints,\n"
 "                      __global int* gN,\n"
 "                      __global int* gOffsets,\n"
+"                      __global float4* gResidual,\n"
 "                       int maxBatch,\n"
 "                       int cellBatch,\n"
-"                       int4 nSplit\n"
+"                       int4 nSplit,\n"
+"                       int blockSolve\n"
 "                      )\n"
 "{\n"
 "	//__local int ldsBatchIdx[WG_SIZE+1];\n"
+"	__local float4 ldsResidual[WG_SIZE];\n"
 "	__local int ldsCurBatch;\n"
 "	__local int ldsNextBatch;\n"
 "	__local int ldsStart;\n"
@@ -329,9 +505,15 @@ static const char* solveContactCL= \
 "	//int xIdx = (wgIdx/(nSplit/2))*2 + (bIdx&1);\n"
 "	//int yIdx = (wgIdx%(nSplit/2))*2 + (bIdx>>1);\n"
 "	//int cellIdx = xIdx+yIdx*nSplit;\n"
+"	//one residual per work group and cell batch, the host reduces them after each iteration\n"
+"	int residualIdx = cellBatch*GET_NUM_GROUPS+wgIdx;\n"
 "	\n"
 "	if( gN[cellIdx] == 0 ) \n"
+"	{\n"
+"		if( lIdx == 0 )\n"
+"			gResidual[residualIdx] = mymake_float4(0,0,0,0);\n"
 "		return;\n"
+"	}\n"
 "	\n"
 "	\n"
 "	const int start = gOffsets[cellIdx];\n"
@@ -346,6 +528,7 @@ static const char* solveContactCL= \
 "		ldsStart = start;\n"
 "	}\n"
 "	GROUP_LDS_BARRIER;\n"
+"	float4 residual = mymake_float4(0,0,0,0);\n"
 "	int idx=ldsStart+lIdx;\n"
 "	while (ldsCurBatch < maxBatch)\n"
 "	{\n"
@@ -353,7 +536,7 @@ static const char* solveContactCL= \
 "		{\n"
 "			if (gConstraints[idx].m_batchIdx == ldsCurBatch)\n"
 "			{\n"
-"					solveContactConstraint( gBodies, gShapes, &gConstraints[idx] );\n"
+"					solveContactConstraint( gBodies, gShapes, &gConstraints[idx], &residual, blockSolve );\n"
 "				 idx+=64;\n"
 "			} else\n"
 "			{\n"
@@ -368,7 +551,21 @@ static const char* solveContactCL= \
 "		}\n"
 "		GROUP_LDS_BARRIER;\n"
 "	}\n"
-"	\n"
+"	ldsResidual[lIdx] = residual;\n"
+"	GROUP_LDS_BARRIER;\n"
+"	for(int stride=WG_SIZE/2; stride>0; stride>>=1)\n"
+"	{\n"
+"		if( lIdx < stride )\n"
+"		{\n"
+"			float4 other = ldsResidual[lIdx+stride];\n"
+"			ldsResidual[lIdx].x = max2( ldsResidual[lIdx].x, other.x );\n"
+"			ldsResidual[lIdx].y += other.y;\n"
+"			ldsResidual[lIdx].z += other.z;\n"
+"		}\n"
+"		GROUP_LDS_BARRIER;\n"
+"	}\n"
+"	if( lIdx == 0 )\n"
+"		gResidual[residualIdx] = ldsResidual[0];\n"
 "    \n"
 "}\n"
 ;
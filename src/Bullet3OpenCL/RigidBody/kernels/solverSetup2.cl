@@ -534,6 +534,55 @@ static __constant const int gridTable8x8[] =
 
 
 
+#define N_AXIS_BINS 64
+
+//counts the contacts per cell coordinate along each axis, folded into N_AXIS_BINS bins per axis
+//the host picks the cell split of SetSortDataKernel from these histograms
+__kernel
+__attribute__((reqd_work_group_size(WG_SIZE,1,1)))
+void SetAxisHistogramKernel(__global struct b3Contact4Data* gContact, __global Body* gBodies, __global u32* gHistogramOut, 
+int nContacts,float scale,int staticIdx)
+{
+	__local u32 ldsHistogram[3*N_AXIS_BINS];
+
+	int gIdx = GET_GLOBAL_IDX;
+	int lIdx = GET_LOCAL_IDX;
+
+	for(int i=lIdx; i<3*N_AXIS_BINS; i+=WG_SIZE)
+		ldsHistogram[i] = 0;
+
+	GROUP_LDS_BARRIER;
+
+	if( gIdx < nContacts )
+	{
+		int aPtrAndSignBit  = gContact[gIdx].m_bodyAPtrAndSignBit;
+		int bPtrAndSignBit  = gContact[gIdx].m_bodyBPtrAndSignBit;
+
+		int aIdx = abs(aPtrAndSignBit );
+		int bIdx = abs(bPtrAndSignBit);
+
+		bool aStatic = (aPtrAndSignBit<0) ||(aPtrAndSignBit==staticIdx);
+
+		int idx = (aStatic)? bIdx: aIdx;
+		float4 p = gBodies[idx].m_pos;
+		int xIdx = (int)((p.x-((p.x<0.f)?1.f:0.f))*scale) & (N_AXIS_BINS-1);
+		int yIdx = (int)((p.y-((p.y<0.f)?1.f:0.f))*scale) & (N_AXIS_BINS-1);
+		int zIdx = (int)((p.z-((p.z<0.f)?1.f:0.f))*scale) & (N_AXIS_BINS-1);
+
+		AtomInc( ldsHistogram[xIdx] );
+		AtomInc( ldsHistogram[N_AXIS_BINS+yIdx] );
+		AtomInc( ldsHistogram[2*N_AXIS_BINS+zIdx] );
+	}
+
+	GROUP_LDS_BARRIER;
+
+	for(int i=lIdx; i<3*N_AXIS_BINS; i+=WG_SIZE)
+	{
+		if( ldsHistogram[i] )
+			AtomAdd( gHistogramOut[i], ldsHistogram[i] );
+	}
+}
+
 #define USE_SPATIAL_BATCHING 1
 #define USE_4x4_GRID 1
 
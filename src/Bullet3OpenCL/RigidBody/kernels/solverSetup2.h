@@ -490,6 +490,43 @@ static const char* solverSetup2CL= \
 "	197,27,214,213,212,199,198,196\n"
 "	\n"
 "};\n"
+"#define N_AXIS_BINS 64\n"
+"//counts the contacts per cell coordinate along each axis, folded into N_AXIS_BINS bins per axis\n"
+"//the host picks the cell split of SetSortDataKernel from these histograms\n"
+"__kernel\n"
+"__attribute__((reqd_work_group_size(WG_SIZE,1,1)))\n"
+"void SetAxisHistogramKernel(__global struct b3Contact4Data* gContact, __global Body* gBodies, __global u32* gHistogramOut, \n"
+"int nContacts,float scale,int staticIdx)\n"
+"{\n"
+"	__local u32 ldsHistogram[3*N_AXIS_BINS];\n"
+"	int gIdx = GET_GLOBAL_IDX;\n"
+"	int lIdx = GET_LOCAL_IDX;\n"
+"	for(int i=lIdx; i<3*N_AXIS_BINS; i+=WG_SIZE)\n"
+"		ldsHistogram[i] = 0;\n"
+"	GROUP_LDS_BARRIER;\n"
+"	if( gIdx < nContacts )\n"
+"	{\n"
+"		int aPtrAndSignBit  = gContact[gIdx].m_bodyAPtrAndSignBit;\n"
+"		int bPtrAndSignBit  = gContact[gIdx].m_bodyBPtrAndSignBit;\n"
+"		int aIdx = abs(aPtrAndSignBit );\n"
+"		int bIdx = abs(bPtrAndSignBit);\n"
+"		bool aStatic = (aPtrAndSignBit<0) ||(aPtrAndSignBit==staticIdx);\n"
+"		int idx = (aStatic)? bIdx: aIdx;\n"
+"		float4 p = gBodies[idx].m_pos;\n"
+"		int xIdx = (int)((p.x-((p.x<0.f)?1.f:0.f))*scale) & (N_AXIS_BINS-1);\n"
+"		int yIdx = (int)((p.y-((p.y<0.f)?1.f:0.f))*scale) & (N_AXIS_BINS-1);\n"
+"		int zIdx = (int)((p.z-((p.z<0.f)?1.f:0.f))*scale) & (N_AXIS_BINS-1);\n"
+"		AtomInc( ldsHistogram[xIdx] );\n"
+"		AtomInc( ldsHistogram[N_AXIS_BINS+yIdx] );\n"
+"		AtomInc( ldsHistogram[2*N_AXIS_BINS+zIdx] );\n"
+"	}\n"
+"	GROUP_LDS_BARRIER;\n"
+"	for(int i=lIdx; i<3*N_AXIS_BINS; i+=WG_SIZE)\n"
+"	{\n"
+"		if( ldsHistogram[i] )\n"
+"			AtomAdd( gHistogramOut[i], ldsHistogram[i] );\n"
+"	}\n"
+"}\n"
 "#define USE_SPATIAL_BATCHING 1\n"
 "#define USE_4x4_GRID 1\n"
 "__kernel\n"
@@ -0,0 +1,942 @@
+/*
+Copyright (c) 2013 Advanced Micro Devices, Inc.
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Bullet3OpenCL/Initialize/b3OpenCLUtils.h"
+#include "Bullet3OpenCL/ParallelPrimitives/b3OpenCLArray.h"
+#include "Bullet3OpenCL/RigidBody/b3GpuNarrowPhase.h"
+#include "Bullet3OpenCL/RigidBody/b3Config.h"
+#include "Bullet3OpenCL/BroadphaseCollision/b3SapAabb.h"
+#include "Bullet3OpenCL/NarrowphaseCollision/b3ConvexUtility.h"
+#include "Bullet3OpenCL/NarrowphaseCollision/b3ConvexHullContact.h"
+#include "Bullet3OpenCL/NarrowphaseCollision/b3SpherePairBatch.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3Contact4.h"
+#include "Bullet3Geometry/b3AabbUtil.h"
+#include "Bullet3Common/shared/b3Int4.h"
+#include "Bullet3Common/b3Quaternion.h"
+#include "Bullet3Common/b3CommandLineArgs.h"
+#include "Bullet3Common/b3MinMax.h"
+
+int g_nPassed = 0;
+int g_nFailed = 0;
+bool g_testFailed = 0;
+
+#define TEST_INIT g_testFailed = 0;
+#define TEST_ASSERT(x) if( !(x) ){g_testFailed = 1;}
+#define TEST_REPORT(testName) printf("[%s] %s\n",(g_testFailed)?"X":"O", testName); if(g_testFailed) g_nFailed++; else g_nPassed++;
+
+cl_context g_context=0;
+cl_device_id g_device=0;
+cl_command_queue g_queue =0;
+
+void initCL(int preferredDeviceIndex, int preferredPlatformIndex)
+{
+	int ciErrNum = 0;
+	cl_device_type deviceType = CL_DEVICE_TYPE_ALL;
+
+	g_context = b3OpenCLUtils::createContextFromType(deviceType, &ciErrNum, 0,0,preferredDeviceIndex, preferredPlatformIndex);
+	int numDev = g_context? b3OpenCLUtils::getNumDevices(g_context) : 0;
+	if (numDev>0)
+	{
+		g_device= b3OpenCLUtils::getDevice(g_context,0);
+		g_queue = clCreateCommandQueue(g_context, g_device, 0, &ciErrNum);
+		oclCHECKERROR(ciErrNum, CL_SUCCESS);
+		b3OpenCLUtils::printDeviceInfo(g_device);
+	}
+}
+
+void exitCL()
+{
+	clReleaseCommandQueue(g_queue);
+	clReleaseContext(g_context);
+}
+
+static b3Config getTestConfig()
+{
+	b3Config config;
+	config.m_maxConvexBodies = 1024;
+	config.m_maxConvexShapes = config.m_maxConvexBodies;
+	config.m_maxBroadphasePairs = 16*config.m_maxConvexBodies;
+	config.m_maxContactCapacity = config.m_maxBroadphasePairs;
+	config.m_compoundPairCapacity = 16*1024;
+	//the manifold cache has its own test
+	config.m_contactCacheLinearThreshold = 0.f;
+	config.m_contactCacheAngularThreshold = 0.f;
+	return config;
+}
+
+static void getBoxVertices(const b3Vector3& halfExtents, b3AlignedObjectArray<b3Vector3>& vertices)
+{
+	vertices.resize(0);
+	for (int i=0;i<8;i++)
+	{
+		vertices.push_back(b3MakeVector3(i&1? halfExtents.x : -halfExtents.x,
+			i&2? halfExtents.y : -halfExtents.y,
+			i&4? halfExtents.z : -halfExtents.z));
+	}
+}
+
+///points on the surface of a capsule along the x axis, the lowest ring point lies exactly at y=-radius
+static void getCapsuleVertices(float radius, float halfHeight, b3AlignedObjectArray<b3Vector3>& vertices)
+{
+	vertices.resize(0);
+	for (int side=-1;side<=1;side+=2)
+	{
+		for (int ring=0;ring<4;ring++)
+		{
+			float theta = ring*B3_HALF_PI/4.f;
+			for (int j=0;j<16;j++)
+			{
+				float phi = j*B3_2_PI/16.f;
+				vertices.push_back(b3MakeVector3(side*(halfHeight+radius*b3Sin(theta)),
+					radius*b3Cos(theta)*b3Cos(phi),radius*b3Cos(theta)*b3Sin(phi)));
+			}
+		}
+		vertices.push_back(b3MakeVector3(side*(halfHeight+radius),0,0));
+	}
+}
+
+///rings of points on a sphere, with a vertex at each pole
+static void getSphereVertices(float radius, int numRings, int numSegments, b3AlignedObjectArray<b3Vector3>& vertices)
+{
+	vertices.resize(0);
+	vertices.push_back(b3MakeVector3(0,-radius,0));
+	vertices.push_back(b3MakeVector3(0,radius,0));
+	for (int ring=1;ring<numRings;ring++)
+	{
+		float theta = -B3_HALF_PI+ring*B3_PI/numRings;
+		for (int j=0;j<numSegments;j++)
+		{
+			float phi = j*B3_2_PI/numSegments;
+			vertices.push_back(b3MakeVector3(radius*b3Cos(theta)*b3Cos(phi),radius*b3Sin(theta),radius*b3Cos(theta)*b3Sin(phi)));
+		}
+	}
+}
+
+static int registerHull(b3GpuNarrowPhase* np, const b3AlignedObjectArray<b3Vector3>& vertices)
+{
+	float scaling[3] = {1,1,1};
+	return np->registerConvexHullShape(&vertices[0].x,sizeof(b3Vector3),vertices.size(),scaling);
+}
+
+static int registerBody(b3GpuNarrowPhase* np, int collidableIndex, float mass, const b3Vector3& position, const b3Quaternion& orientation)
+{
+	const b3SapAabb& localAabb = np->getLocalSpaceAabb(collidableIndex);
+	return np->registerRigidBody(collidableIndex,mass,position,orientation,localAabb.m_min,localAabb.m_max,false);
+}
+
+///uploads the bodies and computes the contacts of the given pairs, contactsOut receives a host copy
+static int computeContacts(b3GpuNarrowPhase* np, const b3AlignedObjectArray<b3Int4>& pairs, b3AlignedObjectArray<b3Contact4>& contactsOut)
+{
+	np->writeAllBodiesToGpu();
+
+	int numBodies = np->getNumRigidBodies();
+	const b3RigidBodyCL* bodies = np->getBodiesCpu();
+	b3AlignedObjectArray<b3SapAabb> aabbsHost;
+	aabbsHost.resize(numBodies);
+	for (int i=0;i<numBodies;i++)
+	{
+		const b3SapAabb& localAabb = np->getLocalSpaceAabb(bodies[i].m_collidableIdx);
+		b3Transform tr;
+		tr.setOrigin(bodies[i].m_pos);
+		tr.setRotation(bodies[i].m_quat);
+		b3Vector3 aabbMin,aabbMax;
+		b3TransformAabb(b3MakeVector3(localAabb.m_min[0],localAabb.m_min[1],localAabb.m_min[2]),
+			b3MakeVector3(localAabb.m_max[0],localAabb.m_max[1],localAabb.m_max[2]),0.f,tr,aabbMin,aabbMax);
+		for (int j=0;j<3;j++)
+		{
+			aabbsHost[i].m_min[j] = aabbMin[j];
+			aabbsHost[i].m_max[j] = aabbMax[j];
+		}
+		aabbsHost[i].m_minIndices[3] = i;
+		aabbsHost[i].m_signedMaxIndices[3] = bodies[i].m_invMass==0.f? -i : i;
+	}
+
+	b3OpenCLArray<b3SapAabb> aabbsGPU(g_context,g_queue);
+	aabbsGPU.copyFromHost(aabbsHost);
+	b3OpenCLArray<b3Int4> pairsGPU(g_context,g_queue);
+	pairsGPU.copyFromHost(pairs);
+
+	np->computeContacts(pairsGPU.getBufferCL(),pairs.size(),aabbsGPU.getBufferCL(),numBodies);
+
+	int numContacts = np->getNumContactsGpu();
+	contactsOut.resize(numContacts);
+	if (numContacts)
+	{
+		const b3Contact4* contacts = np->getContactsCPU();
+		for (int i=0;i<numContacts;i++)
+			contactsOut[i] = contacts[i];
+	}
+	return numContacts;
+}
+
+///finds the manifold of the body pair in either order, the normal is flipped so it matches the order (bodyA,bodyB)
+static bool findPairContact(const b3AlignedObjectArray<b3Contact4>& contacts, int bodyA, int bodyB, b3Contact4& contactOut)
+{
+	for (int i=0;i<contacts.size();i++)
+	{
+		int a = contacts[i].getBodyA();
+		int b = contacts[i].getBodyB();
+		if (a==bodyA && b==bodyB)
+		{
+			contactOut = contacts[i];
+			return true;
+		}
+		if (a==bodyB && b==bodyA)
+		{
+			contactOut = contacts[i];
+			float numPoints = contactOut.m_worldNormalOnB.w;
+			contactOut.m_worldNormalOnB = -contactOut.m_worldNormalOnB;
+			contactOut.m_worldNormalOnB.w = numPoints;
+			return true;
+		}
+	}
+	return false;
+}
+
+static float getDeepestPenetration(const b3Contact4& contact)
+{
+	float depth = B3_LARGE_FLOAT;
+	for (int i=0;i<contact.getNPoints();i++)
+		depth = b3Min(depth,contact.getPenetration(i));
+	return depth;
+}
+
+static bool isSameNormal(const b3Contact4& contactA, const b3Contact4& contactB, float tolerance)
+{
+	b3Vector3 normalA = b3MakeVector3(contactA.m_worldNormalOnB.x,contactA.m_worldNormalOnB.y,contactA.m_worldNormalOnB.z);
+	b3Vector3 normalB = b3MakeVector3(contactB.m_worldNormalOnB.x,contactB.m_worldNormalOnB.y,contactB.m_worldNormalOnB.z);
+	return normalA.dot(normalB) > 1.f-tolerance;
+}
+
+///same normal and the same points, in any order
+static bool isSameManifold(const b3Contact4& contactA, const b3Contact4& contactB, float tolerance)
+{
+	if (contactA.getNPoints()!=contactB.getNPoints() || !isSameNormal(contactA,contactB,tolerance))
+		return false;
+	for (int i=0;i<contactA.getNPoints();i++)
+	{
+		bool found = false;
+		for (int j=0;j<contactB.getNPoints() && !found;j++)
+		{
+			b3Vector3 delta = b3MakeVector3(contactA.m_worldPosB[i].x-contactB.m_worldPosB[j].x,
+				contactA.m_worldPosB[i].y-contactB.m_worldPosB[j].y,contactA.m_worldPosB[i].z-contactB.m_worldPosB[j].z);
+			found = delta.length()<tolerance && b3Fabs(contactA.getPenetration(i)-contactB.getPenetration(j))<tolerance;
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
+
+inline void boxCapsuleContactTest()
+{
+	TEST_INIT;
+
+	b3GpuNarrowPhase* np = new b3GpuNarrowPhase(g_context,g_device,g_queue,getTestConfig());
+
+	b3AlignedObjectArray<b3Vector3> vertices;
+	b3Vector3 groundHalfExtents = b3MakeVector3(2.f,1.f,2.f);
+	b3Vector3 boxHalfExtents = b3MakeVector3(0.5f,0.3f,0.4f);
+	float capsuleRadius = 0.25f;
+	float capsuleHalfHeight = 0.5f;
+	float penetration = 0.01f;
+
+	int planeShape = np->registerPlaneShape(b3MakeVector3(0,1,0),0.f);
+	int groundBoxShape = np->registerBoxShape(groundHalfExtents);
+	getBoxVertices(groundHalfExtents,vertices);
+	int groundHullShape = registerHull(np,vertices);
+	int boxShape = np->registerBoxShape(boxHalfExtents);
+	getBoxVertices(boxHalfExtents,vertices);
+	int boxHullShape = registerHull(np,vertices);
+	int capsuleShape = np->registerCapsuleShape(capsuleRadius,capsuleHalfHeight,0);
+	getCapsuleVertices(capsuleRadius,capsuleHalfHeight,vertices);
+	int capsuleHullShape = registerHull(np,vertices);
+
+	//the analytic shapes and their hull versions at the same transforms, both with the top of the ground at y=0
+	b3Quaternion identity(0,0,0,1);
+	b3Quaternion turned(b3MakeVector3(0,1,0),0.3f);
+	int plane = registerBody(np,planeShape,0.f,b3MakeVector3(0,0,0),identity);
+	int groundBox = registerBody(np,groundBoxShape,0.f,b3MakeVector3(0,-groundHalfExtents.y,0),identity);
+	int groundHull = registerBody(np,groundHullShape,0.f,b3MakeVector3(0,-groundHalfExtents.y,0),identity);
+	int box = registerBody(np,boxShape,1.f,b3MakeVector3(0,boxHalfExtents.y-penetration,0),turned);
+	int boxHull = registerBody(np,boxHullShape,1.f,b3MakeVector3(0,boxHalfExtents.y-penetration,0),turned);
+	int capsule = registerBody(np,capsuleShape,1.f,b3MakeVector3(0,capsuleRadius-penetration,0),turned);
+	int capsuleHull = registerBody(np,capsuleHullShape,1.f,b3MakeVector3(0,capsuleRadius-penetration,0),turned);
+
+	//each analytic pair is followed by the same pair of hulls
+	b3AlignedObjectArray<b3Int4> pairs;
+	pairs.push_back(b3MakeInt4(plane,box,-1,-1));
+	pairs.push_back(b3MakeInt4(plane,boxHull,-1,-1));
+	pairs.push_back(b3MakeInt4(groundBox,box,-1,-1));
+	pairs.push_back(b3MakeInt4(groundHull,boxHull,-1,-1));
+	pairs.push_back(b3MakeInt4(plane,capsule,-1,-1));
+	pairs.push_back(b3MakeInt4(plane,capsuleHull,-1,-1));
+	pairs.push_back(b3MakeInt4(groundBox,capsule,-1,-1));
+	pairs.push_back(b3MakeInt4(groundHull,capsuleHull,-1,-1));
+
+	b3AlignedObjectArray<b3Contact4> contacts;
+	computeContacts(np,pairs,contacts);
+	TEST_ASSERT(contacts.size()==pairs.size());
+
+	for (int i=0;i<pairs.size();i+=2)
+	{
+		b3Contact4 analytic,hull;
+		bool hasAnalytic = findPairContact(contacts,pairs[i].x,pairs[i].y,analytic);
+		bool hasHull = findPairContact(contacts,pairs[i+1].x,pairs[i+1].y,hull);
+		TEST_ASSERT(hasAnalytic && hasHull);
+		if (!hasAnalytic || !hasHull)
+			continue;
+
+		TEST_ASSERT(isSameNormal(analytic,hull,1e-3f));
+		TEST_ASSERT(b3Fabs(getDeepestPenetration(analytic)-getDeepestPenetration(hull))<1e-3f);
+		TEST_ASSERT(b3Fabs(getDeepestPenetration(analytic)+penetration)<1e-3f);
+		//a resting box face touches with 4 points, the capsule segment with its ends
+		bool isBoxPair = pairs[i].y==box;
+		if (isBoxPair)
+		{
+			TEST_ASSERT(analytic.getNPoints()==4);
+			TEST_ASSERT(hull.getNPoints()==4);
+		} else
+		{
+			TEST_ASSERT(analytic.getNPoints()>=2);
+		}
+	}
+
+	delete np;
+
+	TEST_REPORT("boxCapsuleContact");
+}
+
+inline void vertexAdjacencyTest()
+{
+	TEST_INIT;
+
+	b3AlignedObjectArray<b3Vector3> vertices;
+	getSphereVertices(1.f,10,20,vertices);
+	b3ConvexUtility hull;
+	hull.initializePolyhedralFeatures(&vertices[0],vertices.size());
+
+	b3AlignedObjectArray<int> adjacency;
+	b3AlignedObjectArray<b3Int4> edges;
+	TEST_ASSERT(hull.computeVertexAdjacency(adjacency,edges));
+
+	//closed hull: V-E+F=2, each edge between two faces
+	int numVertices = hull.m_vertices.size();
+	TEST_ASSERT(numVertices-edges.size()+hull.m_faces.size()==2);
+	for (int i=0;i<edges.size();i++)
+	{
+		TEST_ASSERT(edges[i].z>=0 && edges[i].w>=0 && edges[i].z!=edges[i].w);
+	}
+	//neighbourhood is symmetric and every vertex can be reached
+	TEST_ASSERT(adjacency.size()>numVertices);
+	for (int v=0;v<numVertices && adjacency.size()>numVertices;v++)
+	{
+		TEST_ASSERT(adjacency[v+1]>adjacency[v]);
+		for (int n=adjacency[v];n<adjacency[v+1];n++)
+		{
+			int u = adjacency[n];
+			bool found = false;
+			for (int k=adjacency[u];k<adjacency[u+1];k++)
+				found = found || adjacency[k]==v;
+			TEST_ASSERT(found);
+		}
+	}
+
+	TEST_REPORT("vertexAdjacency");
+}
+
+///contacts of large hulls, with hill climbing and Gauss map pruning (above m_minVerticesForHillClimbing) and without
+static void computeLargeHullContacts(int minVerticesForHillClimbing, b3AlignedObjectArray<b3Int4>& pairs, b3AlignedObjectArray<b3Contact4>& contacts)
+{
+	b3Config config = getTestConfig();
+	config.m_minVerticesForHillClimbing = minVerticesForHillClimbing;
+	b3GpuNarrowPhase* np = new b3GpuNarrowPhase(g_context,g_device,g_queue,config);
+
+	b3AlignedObjectArray<b3Vector3> vertices;
+	b3Vector3 groundHalfExtents = b3MakeVector3(4.f,1.f,4.f);
+	getBoxVertices(groundHalfExtents,vertices);
+	int groundShape = registerHull(np,vertices);
+	getSphereVertices(1.f,10,20,vertices);
+	int largeShape = registerHull(np,vertices);
+	getSphereVertices(0.8f,7,13,vertices);
+	int smallerShape = registerHull(np,vertices);
+
+	b3Quaternion identity(0,0,0,1);
+	b3Quaternion tilted(b3MakeVector3(1,0,1).normalized(),0.4f);
+	int ground = registerBody(np,groundShape,0.f,b3MakeVector3(0,-groundHalfExtents.y,0),identity);
+	int large = registerBody(np,largeShape,1.f,b3MakeVector3(0,0.99f,0),identity);
+	int smaller = registerBody(np,smallerShape,1.f,b3MakeVector3(0.3f,2.75f,0.2f),tilted);
+	int tiltedLarge = registerBody(np,largeShape,1.f,b3MakeVector3(2.5f,0.95f,-1.5f),tilted);
+
+	pairs.resize(0);
+	pairs.push_back(b3MakeInt4(ground,large,-1,-1));
+	pairs.push_back(b3MakeInt4(large,smaller,-1,-1));
+	pairs.push_back(b3MakeInt4(ground,tiltedLarge,-1,-1));
+	computeContacts(np,pairs,contacts);
+
+	delete np;
+}
+
+inline void hillClimbingContactTest()
+{
+	TEST_INIT;
+
+	b3AlignedObjectArray<b3Int4> pairs;
+	b3AlignedObjectArray<b3Contact4> hillClimbing,bruteForce;
+	computeLargeHullContacts(16,pairs,hillClimbing);
+	computeLargeHullContacts(1<<30,pairs,bruteForce);
+
+	TEST_ASSERT(hillClimbing.size()==pairs.size());
+	TEST_ASSERT(bruteForce.size()==pairs.size());
+	for (int i=0;i<pairs.size();i++)
+	{
+		b3Contact4 a,b;
+		bool hasA = findPairContact(hillClimbing,pairs[i].x,pairs[i].y,a);
+		bool hasB = findPairContact(bruteForce,pairs[i].x,pairs[i].y,b);
+		TEST_ASSERT(hasA && hasB);
+		if (hasA && hasB)
+		{
+			TEST_ASSERT(isSameManifold(a,b,1e-3f));
+		}
+	}
+
+	TEST_REPORT("hillClimbingContact");
+}
+
+inline void pairTypeBinTest()
+{
+	TEST_INIT;
+
+	b3GpuNarrowPhase* np = new b3GpuNarrowPhase(g_context,g_device,g_queue,getTestConfig());
+
+	b3AlignedObjectArray<b3Vector3> vertices;
+	b3Vector3 halfExtents = b3MakeVector3(0.5f,0.3f,0.4f);
+	float radius = 0.5f;
+	int planeShape = np->registerPlaneShape(b3MakeVector3(0,1,0),0.f);
+	int sphereShape = np->registerSphereShape(radius);
+	int boxShape = np->registerBoxShape(halfExtents);
+	getBoxVertices(halfExtents,vertices);
+	int hullShape = registerHull(np,vertices);
+	int capsuleShape = np->registerCapsuleShape(0.25f,0.5f,0);
+
+	//each pair gets its own bodies, spread along x, all pairs touch
+	b3Quaternion identity(0,0,0,1);
+	int plane = registerBody(np,planeShape,0.f,b3MakeVector3(0,0,0),identity);
+	b3AlignedObjectArray<b3Int4> pairs;
+	int expectedBinCounts[B3_NUM_PAIR_BINS] = {0};
+	float x = 0.f;
+	for (int i=0;i<3;i++,x+=3.f)
+	{
+		int a = registerBody(np,sphereShape,1.f,b3MakeVector3(x,radius,0),identity);
+		int b = registerBody(np,sphereShape,1.f,b3MakeVector3(x+1.9f*radius,radius,0),identity);
+		pairs.push_back(b3MakeInt4(a,b,-1,-1));
+		expectedBinCounts[B3_PAIR_BIN_SPHERE_SPHERE]++;
+	}
+	for (int i=0;i<2;i++,x+=3.f)
+	{
+		int sphere = registerBody(np,sphereShape,1.f,b3MakeVector3(x,radius-0.01f,0),identity);
+		pairs.push_back(b3MakeInt4(plane,sphere,-1,-1));
+		expectedBinCounts[B3_PAIR_BIN_SPHERE_PLANE]++;
+		int hull = registerBody(np,hullShape,1.f,b3MakeVector3(x+1.5f,halfExtents.y-0.01f,0),identity);
+		pairs.push_back(b3MakeInt4(plane,hull,-1,-1));
+		expectedBinCounts[B3_PAIR_BIN_CONVEX_PLANE]++;
+	}
+	for (int i=0;i<2;i++,x+=3.f)
+	{
+		int a = registerBody(np,hullShape,1.f,b3MakeVector3(x,halfExtents.y,0),identity);
+		int b = registerBody(np,hullShape,1.f,b3MakeVector3(x+0.1f,3.f*halfExtents.y-0.01f,0),identity);
+		pairs.push_back(b3MakeInt4(a,b,-1,-1));
+		expectedBinCounts[B3_PAIR_BIN_CONVEX_CONVEX]++;
+	}
+	{
+		int box = registerBody(np,boxShape,1.f,b3MakeVector3(x,halfExtents.y-0.01f,0),identity);
+		pairs.push_back(b3MakeInt4(plane,box,-1,-1));
+		int stackedBox = registerBody(np,boxShape,1.f,b3MakeVector3(x,3.f*halfExtents.y-0.02f,0),identity);
+		pairs.push_back(b3MakeInt4(box,stackedBox,-1,-1));
+		int capsule = registerBody(np,capsuleShape,1.f,b3MakeVector3(x+3.f,0.24f,0),identity);
+		pairs.push_back(b3MakeInt4(plane,capsule,-1,-1));
+		int sphere = registerBody(np,sphereShape,1.f,b3MakeVector3(x,4.f*halfExtents.y+radius-0.03f,0),identity);
+		pairs.push_back(b3MakeInt4(stackedBox,sphere,-1,-1));
+		expectedBinCounts[B3_PAIR_BIN_PRIMITIVE]+=4;
+		x += 6.f;
+	}
+	{
+		//hull against box has no contact function
+		int hull = registerBody(np,hullShape,1.f,b3MakeVector3(x,halfExtents.y,0),identity);
+		int box = registerBody(np,boxShape,1.f,b3MakeVector3(x,3.f*halfExtents.y-0.01f,0),identity);
+		pairs.push_back(b3MakeInt4(hull,box,-1,-1));
+		expectedBinCounts[B3_PAIR_BIN_UNSUPPORTED_BOX_CAPSULE]++;
+	}
+
+	//interleave the shape types, so the binning has to reorder the pairs
+	b3AlignedObjectArray<b3Int4> mixedPairs;
+	for (int i=0;i<pairs.size();i++)
+	{
+		mixedPairs.push_back(pairs[i&1? pairs.size()-1-i/2 : i/2]);
+	}
+	b3AlignedObjectArray<b3Contact4> contacts;
+	computeContacts(np,mixedPairs,contacts);
+
+	for (int bin=0;bin<B3_NUM_PAIR_BINS;bin++)
+	{
+		TEST_ASSERT(np->getNumPairsInTypeBin(bin)==expectedBinCounts[bin]);
+	}
+	TEST_ASSERT(contacts.size()==pairs.size()-expectedBinCounts[B3_PAIR_BIN_UNSUPPORTED]-expectedBinCounts[B3_PAIR_BIN_UNSUPPORTED_BOX_CAPSULE]);
+
+	//each pair on its own gives the same manifold
+	for (int i=0;i<pairs.size();i++)
+	{
+		b3AlignedObjectArray<b3Int4> singlePair;
+		singlePair.push_back(pairs[i]);
+		b3AlignedObjectArray<b3Contact4> singleContacts;
+		computeContacts(np,singlePair,singleContacts);
+
+		b3Contact4 a,b;
+		bool hasA = findPairContact(contacts,pairs[i].x,pairs[i].y,a);
+		bool hasB = findPairContact(singleContacts,pairs[i].x,pairs[i].y,b);
+		TEST_ASSERT(hasA==hasB);
+		if (hasA && hasB)
+		{
+			TEST_ASSERT(isSameManifold(a,b,1e-5f));
+		}
+	}
+
+	delete np;
+
+	TEST_REPORT("pairTypeBin");
+}
+
+///spheres near each other and near a tilted plane (body 0), as the host batch sees them
+struct SpherePairScene
+{
+	b3AlignedObjectArray<b3RigidBodyCL>	m_bodies;
+	b3AlignedObjectArray<b3Collidable>	m_collidables;
+	b3AlignedObjectArray<b3GpuFace>	m_faces;
+	b3AlignedObjectArray<b3Int4>	m_pairs;
+	b3AlignedObjectArray<int>	m_sphereSpherePairs;
+	b3AlignedObjectArray<int>	m_spherePlanePairs;
+};
+
+static float randRange(float minValue, float maxValue)
+{
+	return minValue+(maxValue-minValue)*float(rand())/float(RAND_MAX);
+}
+
+static void createSpherePairScene(SpherePairScene& scene)
+{
+	srand(1);
+	//the counts are no multiple of the SIMD width, so the remainder loops run too
+	int numSphereSpherePairs = 37;
+	int numSpherePlanePairs = 21;
+	float radii[2] = {0.3f,0.5f};
+
+	b3Collidable planeCollidable;
+	memset(&planeCollidable,0,sizeof(b3Collidable));
+	planeCollidable.m_shapeType = SHAPE_PLANE;
+	planeCollidable.m_shapeIndex = 0;
+	scene.m_collidables.push_back(planeCollidable);
+	b3GpuFace face;
+	memset(&face,0,sizeof(b3GpuFace));
+	face.m_plane = b3MakeVector3(0,1,0);
+	face.m_plane.w = 0.2f;
+	scene.m_faces.push_back(face);
+	for (int i=0;i<2;i++)
+	{
+		b3Collidable sphereCollidable;
+		memset(&sphereCollidable,0,sizeof(b3Collidable));
+		sphereCollidable.m_shapeType = SHAPE_SPHERE;
+		sphereCollidable.m_radius = radii[i];
+		scene.m_collidables.push_back(sphereCollidable);
+	}
+
+	b3RigidBodyCL body;
+	memset(&body,0,sizeof(b3RigidBodyCL));
+	body.m_pos = b3MakeVector3(0,0.1f,0);
+	body.m_quat = b3Quaternion(b3MakeVector3(0,0,1),0.05f);
+	body.m_collidableIdx = 0;
+	scene.m_bodies.push_back(body);
+
+	for (int i=0;i<numSphereSpherePairs;i++)
+	{
+		//every third pair is separated
+		float distance = i%3==0? 2.f : randRange(0.f,0.75f);
+		body.m_quat = b3Quaternion(0,0,0,1);
+		body.m_invMass = 1.f;
+		body.m_collidableIdx = 1+(i&1);
+		body.m_pos = b3MakeVector3(i*3.f,5.f,randRange(-1.f,1.f));
+		scene.m_bodies.push_back(body);
+		body.m_collidableIdx = 1+((i/2)&1);
+		body.m_pos += b3MakeVector3(randRange(-1.f,1.f),randRange(-1.f,1.f),randRange(-1.f,1.f)).normalized()*distance;
+		//a static sphere gets a negative body index in the contact
+		body.m_invMass = i%5==0? 0.f : 1.f;
+		scene.m_bodies.push_back(body);
+		scene.m_sphereSpherePairs.push_back(scene.m_pairs.size());
+		scene.m_pairs.push_back(b3MakeInt4(scene.m_bodies.size()-2,scene.m_bodies.size()-1,-1,-1));
+	}
+	for (int i=0;i<numSpherePlanePairs;i++)
+	{
+		body.m_quat = b3Quaternion(0,0,0,1);
+		body.m_invMass = 1.f;
+		body.m_collidableIdx = 1+(i&1);
+		body.m_pos = b3MakeVector3(randRange(-10.f,10.f),randRange(0.f,1.f),randRange(-10.f,10.f));
+		scene.m_bodies.push_back(body);
+		int sphere = scene.m_bodies.size()-1;
+		scene.m_spherePlanePairs.push_back(scene.m_pairs.size());
+		//both orders, the plane becomes body A
+		scene.m_pairs.push_back(i&1? b3MakeInt4(0,sphere,-1,-1) : b3MakeInt4(sphere,0,-1,-1));
+	}
+}
+
+static int getSignedBodyIndex(const SpherePairScene& scene, int bodyIndex)
+{
+	return scene.m_bodies[bodyIndex].m_invMass==0.f? -bodyIndex : bodyIndex;
+}
+
+static void setReferenceContact(b3Contact4& contact, int bodyA, int bodyB, const b3Vector3& normal, const b3Vector3& point, float distance)
+{
+	memset(&contact,0,sizeof(b3Contact4));
+	contact.m_bodyAPtrAndSignBit = bodyA;
+	contact.m_bodyBPtrAndSignBit = bodyB;
+	contact.m_worldNormalOnB = normal;
+	contact.m_worldNormalOnB.w = 1.f;
+	contact.m_worldPosB[0] = point;
+	contact.m_worldPosB[0].w = distance;
+}
+
+///one contact per touching pair, computed pair by pair like the generic primitive contacts
+static void computeReferenceSphereContacts(const SpherePairScene& scene, b3AlignedObjectArray<b3Contact4>& contacts)
+{
+	contacts.resize(0);
+	for (int i=0;i<scene.m_sphereSpherePairs.size();i++)
+	{
+		const b3Int4& pair = scene.m_pairs[scene.m_sphereSpherePairs[i]];
+		const b3RigidBodyCL& bodyA = scene.m_bodies[pair.x];
+		const b3RigidBodyCL& bodyB = scene.m_bodies[pair.y];
+		float radiusA = scene.m_collidables[bodyA.m_collidableIdx].m_radius;
+		float radiusB = scene.m_collidables[bodyB.m_collidableIdx].m_radius;
+		b3Vector3 diff = bodyA.m_pos-bodyB.m_pos;
+		float len = diff.length();
+		if (len>radiusA+radiusB)
+			continue;
+		b3Vector3 normal = len>0.00001f? diff/len : b3MakeVector3(1,0,0);
+		b3Contact4 contact;
+		setReferenceContact(contact,getSignedBodyIndex(scene,pair.x),getSignedBodyIndex(scene,pair.y),normal,
+			bodyB.m_pos+normal*radiusB,len-(radiusA+radiusB));
+		contacts.push_back(contact);
+	}
+	for (int i=0;i<scene.m_spherePlanePairs.size();i++)
+	{
+		const b3Int4& pair = scene.m_pairs[scene.m_spherePlanePairs[i]];
+		int planeIndex = pair.x==0? pair.x : pair.y;
+		int sphereIndex = pair.x==0? pair.y : pair.x;
+		const b3RigidBodyCL& plane = scene.m_bodies[planeIndex];
+		const b3RigidBodyCL& sphere = scene.m_bodies[sphereIndex];
+		const b3Vector3& planeEq = scene.m_faces[scene.m_collidables[plane.m_collidableIdx].m_shapeIndex].m_plane;
+		float radius = scene.m_collidables[sphere.m_collidableIdx].m_radius;
+		b3Vector3 planeNormal = b3QuatRotate(plane.m_quat,b3MakeVector3(planeEq.x,planeEq.y,planeEq.z));
+		float distance = planeNormal.dot(sphere.m_pos-plane.m_pos)-planeEq.w-radius;
+		if (distance>=0.f)
+			continue;
+		b3Contact4 contact;
+		setReferenceContact(contact,getSignedBodyIndex(scene,planeIndex),getSignedBodyIndex(scene,sphereIndex),-planeNormal,
+			sphere.m_pos-planeNormal*radius,distance);
+		contacts.push_back(contact);
+	}
+}
+
+static bool isSameSphereContacts(const b3AlignedObjectArray<b3Contact4>& contacts, const b3AlignedObjectArray<b3Contact4>& reference)
+{
+	if (contacts.size()!=reference.size())
+		return false;
+	for (int i=0;i<reference.size();i++)
+	{
+		b3Contact4 contact;
+		if (!findPairContact(contacts,reference[i].getBodyA(),reference[i].getBodyB(),contact))
+			return false;
+		if (contact.m_bodyAPtrAndSignBit!=reference[i].m_bodyAPtrAndSignBit || contact.m_bodyBPtrAndSignBit!=reference[i].m_bodyBPtrAndSignBit)
+			return false;
+		if (!isSameManifold(contact,reference[i],1e-5f))
+			return false;
+	}
+	return true;
+}
+
+inline void boxTrimeshTest()
+{
+	TEST_INIT;
+
+	b3GpuNarrowPhase* np = new b3GpuNarrowPhase(g_context,g_device,g_queue,getTestConfig());
+
+	//a flat square of two triangles, facing up
+	b3AlignedObjectArray<b3Vector3> meshVertices;
+	meshVertices.push_back(b3MakeVector3(-5,0,-5));
+	meshVertices.push_back(b3MakeVector3(-5,0,5));
+	meshVertices.push_back(b3MakeVector3(5,0,5));
+	meshVertices.push_back(b3MakeVector3(5,0,-5));
+	b3AlignedObjectArray<int> meshIndices;
+	int triangles[6] = {0,1,2,0,2,3};
+	for (int i=0;i<6;i++)
+		meshIndices.push_back(triangles[i]);
+	float scaling[3] = {1,1,1};
+	int meshShape = np->registerConcaveMesh(&meshVertices,&meshIndices,scaling);
+
+	b3Vector3 halfExtents = b3MakeVector3(0.5f,0.3f,0.4f);
+	b3AlignedObjectArray<b3Vector3> vertices;
+	getBoxVertices(halfExtents,vertices);
+	int boxShape = np->registerBoxShape(halfExtents);
+	int hullShape = registerHull(np,vertices);
+
+	b3Quaternion identity(0,0,0,1);
+	int mesh = registerBody(np,meshShape,0.f,b3MakeVector3(0,0,0),identity);
+	int box = registerBody(np,boxShape,1.f,b3MakeVector3(-2,halfExtents.y-0.01f,0),identity);
+	int hull = registerBody(np,hullShape,1.f,b3MakeVector3(2,halfExtents.y-0.01f,0),identity);
+
+	b3AlignedObjectArray<b3Int4> pairs;
+	pairs.push_back(b3MakeInt4(mesh,box,-1,-1));
+	pairs.push_back(b3MakeInt4(mesh,hull,-1,-1));
+	b3AlignedObjectArray<b3Contact4> contacts;
+	computeContacts(np,pairs,contacts);
+
+	//the box is binned as unsupported and warned about, it must not reach the concave kernels
+	TEST_ASSERT(np->getNumPairsInTypeBin(B3_PAIR_BIN_UNSUPPORTED_BOX_CAPSULE)==1);
+	TEST_ASSERT(np->getNumPairsInTypeBin(B3_PAIR_BIN_CONCAVE)==1);
+	b3Contact4 contact;
+	TEST_ASSERT(!findPairContact(contacts,mesh,box,contact));
+	//the same box registered as a hull rests on the mesh
+	TEST_ASSERT(findPairContact(contacts,mesh,hull,contact));
+	if (findPairContact(contacts,mesh,hull,contact))
+	{
+		TEST_ASSERT(contact.m_worldNormalOnB.y<-0.99f || contact.m_worldNormalOnB.y>0.99f);
+		TEST_ASSERT(b3Fabs(getDeepestPenetration(contact)+0.01f)<1e-3f);
+	}
+
+	delete np;
+
+	TEST_REPORT("boxTrimesh");
+}
+
+inline void spherePairBatchTest()
+{
+	TEST_INIT;
+
+	SpherePairScene scene;
+	createSpherePairScene(scene);
+	b3AlignedObjectArray<b3Contact4> reference;
+	computeReferenceSphereContacts(scene,reference);
+	TEST_ASSERT(reference.size()>0 && reference.size()<scene.m_pairs.size());
+
+	int maxContactCapacity = scene.m_pairs.size();
+	b3AlignedObjectArray<b3Contact4> contacts;
+	contacts.resize(maxContactCapacity);
+	b3SpherePairBatch batch;
+	batch.gatherSphereSpherePairs(&scene.m_pairs[0],&scene.m_sphereSpherePairs[0],scene.m_sphereSpherePairs.size(),&scene.m_bodies[0],&scene.m_collidables[0]);
+	int numContacts = batch.computeSphereSphereContacts(&contacts[0],0,maxContactCapacity);
+	batch.gatherSpherePlanePairs(&scene.m_pairs[0],&scene.m_spherePlanePairs[0],scene.m_spherePlanePairs.size(),&scene.m_bodies[0],&scene.m_collidables[0],&scene.m_faces[0]);
+	numContacts = batch.computeSpherePlaneContacts(&contacts[0],numContacts,maxContactCapacity);
+	contacts.resize(numContacts);
+
+	TEST_ASSERT(isSameSphereContacts(contacts,reference));
+	for (int i=0;i<contacts.size();i++)
+	{
+		//the pair index is stored in the batch index
+		const b3Int4& pair = scene.m_pairs[contacts[i].m_batchIdx];
+		TEST_ASSERT(pair.x==contacts[i].getBodyA() || pair.y==contacts[i].getBodyA());
+		TEST_ASSERT(pair.x==contacts[i].getBodyB() || pair.y==contacts[i].getBodyB());
+	}
+
+	TEST_REPORT("spherePairBatch");
+}
+
+inline void spherePairBatchGpuTest()
+{
+	TEST_INIT;
+
+	SpherePairScene scene;
+	createSpherePairScene(scene);
+	b3AlignedObjectArray<b3Contact4> reference;
+	computeReferenceSphereContacts(scene,reference);
+
+	b3GpuNarrowPhase* np = new b3GpuNarrowPhase(g_context,g_device,g_queue,getTestConfig());
+	const b3Vector3& planeEq = scene.m_faces[0].m_plane;
+	int planeShape = np->registerPlaneShape(b3MakeVector3(planeEq.x,planeEq.y,planeEq.z),planeEq.w);
+	int sphereShapes[2];
+	for (int i=0;i<2;i++)
+		sphereShapes[i] = np->registerSphereShape(scene.m_collidables[1+i].m_radius);
+	for (int i=0;i<scene.m_bodies.size();i++)
+	{
+		const b3RigidBodyCL& body = scene.m_bodies[i];
+		int shape = body.m_collidableIdx==0? planeShape : sphereShapes[body.m_collidableIdx-1];
+		registerBody(np,shape,body.m_invMass==0.f? 0.f : 1.f,body.m_pos,body.m_quat);
+	}
+
+	b3AlignedObjectArray<b3Contact4> contacts;
+	computeContacts(np,scene.m_pairs,contacts);
+	TEST_ASSERT(isSameSphereContacts(contacts,reference));
+
+	delete np;
+
+	TEST_REPORT("spherePairBatchGpu");
+}
+
+///hull boxes resting on a static hull ground, one convex pair per box
+static void createCachedManifoldScene(b3GpuNarrowPhase* np, int numBoxes, b3AlignedObjectArray<b3Int4>& pairs)
+{
+	b3AlignedObjectArray<b3Vector3> vertices;
+	getBoxVertices(b3MakeVector3(10.f,1.f,10.f),vertices);
+	int groundHull = registerHull(np,vertices);
+	getBoxVertices(b3MakeVector3(0.5f,0.5f,0.5f),vertices);
+	int boxHull = registerHull(np,vertices);
+
+	int ground = registerBody(np,groundHull,0.f,b3MakeVector3(0,0,0),b3Quaternion(0,0,0,1));
+	pairs.resize(0);
+	for (int i=0;i<numBoxes;i++)
+	{
+		int box = registerBody(np,boxHull,1.f,b3MakeVector3(-6.f+4.f*i,1.49f,0),b3Quaternion(0,0,0,1));
+		pairs.push_back(b3MakeInt4(ground,box,-1,-1));
+	}
+}
+
+static void setBodyTransform(b3GpuNarrowPhase* np, int bodyIndex, const b3Vector3& position, const b3Quaternion& orientation)
+{
+	float pos[4] = {position.x,position.y,position.z,0.f};
+	float orn[4] = {orientation.x,orientation.y,orientation.z,orientation.w};
+	np->setObjectTransformCpu(pos,orn,bodyIndex);
+}
+
+static bool isSamePairManifolds(const b3AlignedObjectArray<b3Int4>& pairs, const b3AlignedObjectArray<b3Contact4>& contactsA, const b3AlignedObjectArray<b3Contact4>& contactsB, float tolerance)
+{
+	if (contactsA.size()!=contactsB.size())
+		return false;
+	for (int i=0;i<pairs.size();i++)
+	{
+		b3Contact4 contactA,contactB;
+		bool foundA = findPairContact(contactsA,pairs[i].x,pairs[i].y,contactA);
+		bool foundB = findPairContact(contactsB,pairs[i].x,pairs[i].y,contactB);
+		if (foundA!=foundB || (foundA && !isSameManifold(contactA,contactB,tolerance)))
+			return false;
+	}
+	return true;
+}
+
+inline void manifoldCacheTest()
+{
+	TEST_INIT;
+
+	int numBoxes = 4;
+	b3Config config = getTestConfig();
+	config.m_contactCacheLinearThreshold = 0.002f;
+	config.m_contactCacheAngularThreshold = 0.005f;
+	b3GpuNarrowPhase* np = new b3GpuNarrowPhase(g_context,g_device,g_queue,config);
+	//the reference clips every pair, the test config disables the cache
+	b3GpuNarrowPhase* npRef = new b3GpuNarrowPhase(g_context,g_device,g_queue,getTestConfig());
+	b3AlignedObjectArray<b3Int4> pairs;
+	createCachedManifoldScene(np,numBoxes,pairs);
+	createCachedManifoldScene(npRef,numBoxes,pairs);
+
+	int numLookups = 0;
+	int numHits = 0;
+	b3AlignedObjectArray<b3Contact4> firstContacts,contacts,refContacts;
+
+	//an empty cache misses every pair
+	computeContacts(np,pairs,firstContacts);
+	np->getContactCacheStatistics(numLookups,numHits);
+	TEST_ASSERT(numLookups==numBoxes);
+	TEST_ASSERT(numHits==0);
+	TEST_ASSERT(firstContacts.size()==numBoxes);
+
+	//nothing moved, every manifold is reused as it was
+	computeContacts(np,pairs,contacts);
+	np->getContactCacheStatistics(numLookups,numHits);
+	TEST_ASSERT(numLookups==numBoxes);
+	TEST_ASSERT(numHits==numBoxes);
+	TEST_ASSERT(isSamePairManifolds(pairs,contacts,firstContacts,1e-5f));
+
+	//a move below the linear threshold still hits, the reused points stay close to freshly clipped ones
+	int movedBox = pairs[1].y;
+	b3Vector3 movedPos = np->getBodiesCpu()[movedBox].m_pos+b3MakeVector3(0.001f,0,0);
+	setBodyTransform(np,movedBox,movedPos,b3Quaternion(0,0,0,1));
+	setBodyTransform(npRef,movedBox,movedPos,b3Quaternion(0,0,0,1));
+	computeContacts(np,pairs,contacts);
+	computeContacts(npRef,pairs,refContacts);
+	np->getContactCacheStatistics(numLookups,numHits);
+	TEST_ASSERT(numHits==numBoxes);
+	TEST_ASSERT(isSamePairManifolds(pairs,contacts,refContacts,0.005f));
+
+	//a rotation past the angular threshold misses and clips that pair again
+	int rotatedBox = pairs[2].y;
+	b3Quaternion rotatedOrn(b3MakeVector3(0,1,0),0.05f);
+	b3Vector3 rotatedPos = np->getBodiesCpu()[rotatedBox].m_pos;
+	setBodyTransform(np,rotatedBox,rotatedPos,rotatedOrn);
+	setBodyTransform(npRef,rotatedBox,rotatedPos,rotatedOrn);
+	computeContacts(np,pairs,contacts);
+	computeContacts(npRef,pairs,refContacts);
+	np->getContactCacheStatistics(numLookups,numHits);
+	TEST_ASSERT(numLookups==numBoxes);
+	TEST_ASSERT(numHits==numBoxes-1);
+	b3Contact4 contact,refContact;
+	TEST_ASSERT(findPairContact(contacts,pairs[2].x,rotatedBox,contact));
+	TEST_ASSERT(findPairContact(refContacts,pairs[2].x,rotatedBox,refContact));
+	TEST_ASSERT(isSameManifold(contact,refContact,1e-5f));
+
+	delete npRef;
+	delete np;
+
+	TEST_REPORT("manifoldCache");
+}
+
+
+int main(int argc, char** argv)
+{
+	int preferredDeviceIndex = -1;
+	int preferredPlatformIndex = -1;
+
+	b3CommandLineArgs args(argc, argv);
+	args.GetCmdLineArgument("deviceId", preferredDeviceIndex);
+	args.GetCmdLineArgument("platformId", preferredPlatformIndex);
+
+	//host only
+	vertexAdjacencyTest();
+
+	spherePairBatchTest();
+
+	initCL(preferredDeviceIndex,preferredPlatformIndex);
+	if (g_queue)
+	{
+		boxCapsuleContactTest();
+
+		hillClimbingContactTest();
+
+		pairTypeBinTest();
+
+		boxTrimeshTest();
+
+		spherePairBatchGpuTest();
+
+		manifoldCacheTest();
+
+		exitCL();
+	} else
+	{
+		printf("No OpenCL device found, skipping the OpenCL tests\n");
+	}
+
+	printf("%d tests passed, %d tests failed\n",g_nPassed, g_nFailed);
+	return g_nFailed;
+}
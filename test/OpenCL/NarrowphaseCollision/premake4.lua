@@ -0,0 +1,35 @@
+function createProject(vendor)	
+	hasCL = findOpenCL(vendor)
+	
+	if (hasCL) then
+
+		project ("Test_OpenCL_NarrowphaseCollision_" .. vendor)
+
+		initOpenCL(vendor)
+
+		language "C++"
+				
+		kind "ConsoleApp"
+		targetdir "../../../bin"
+		includedirs {".","../../../src"}
+		
+		links {
+			"Bullet3OpenCL_" .. vendor,
+			"Bullet3Dynamics",
+			"Bullet3Collision",
+			"Bullet3Geometry",
+			"Bullet3Common",
+		}
+		
+		files {
+			"main.cpp",
+		}
+		
+	end
+end
+
+createProject("clew")
+createProject("AMD")
+createProject("Intel")
+createProject("NVIDIA")
+createProject("Apple")
@@ -0,0 +1,646 @@
+/*
+Copyright (c) 2013 Advanced Micro Devices, Inc.
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Bullet3OpenCL/Initialize/b3OpenCLUtils.h"
+#include "Bullet3OpenCL/RigidBody/b3GpuNarrowPhase.h"
+#include "Bullet3OpenCL/RigidBody/b3Config.h"
+#include "Bullet3OpenCL/Raycast/b3GpuRaycast.h"
+#include "Bullet3OpenCL/Raycast/b3RaycastInfo.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
+#include "Bullet3Common/b3Quaternion.h"
+#include "Bullet3Common/b3Transform.h"
+#include "Bullet3Common/b3CommandLineArgs.h"
+#include "Bullet3Common/b3MinMax.h"
+
+#ifdef _WIN32
+#include "b3Win32ThreadSupport.h"
+#else
+#include "b3PosixThreadSupport.h"
+#endif
+
+int g_nPassed = 0;
+int g_nFailed = 0;
+bool g_testFailed = 0;
+
+#define TEST_INIT g_testFailed = 0;
+#define TEST_ASSERT(x) if( !(x) ){g_testFailed = 1;}
+#define TEST_REPORT(testName) printf("[%s] %s\n",(g_testFailed)?"X":"O", testName); if(g_testFailed) g_nFailed++; else g_nPassed++;
+
+cl_context g_context=0;
+cl_device_id g_device=0;
+cl_command_queue g_queue =0;
+b3ThreadSupportInterface* g_threadSupport = 0;
+
+void initCL(int preferredDeviceIndex, int preferredPlatformIndex)
+{
+	int ciErrNum = 0;
+	cl_device_type deviceType = CL_DEVICE_TYPE_ALL;
+
+	g_context = b3OpenCLUtils::createContextFromType(deviceType, &ciErrNum, 0,0,preferredDeviceIndex, preferredPlatformIndex);
+	int numDev = g_context? b3OpenCLUtils::getNumDevices(g_context) : 0;
+	if (numDev>0)
+	{
+		g_device= b3OpenCLUtils::getDevice(g_context,0);
+		g_queue = clCreateCommandQueue(g_context, g_device, 0, &ciErrNum);
+		oclCHECKERROR(ciErrNum, CL_SUCCESS);
+		b3OpenCLUtils::printDeviceInfo(g_device);
+	}
+}
+
+void exitCL()
+{
+	clReleaseCommandQueue(g_queue);
+	clReleaseContext(g_context);
+}
+
+static b3ThreadSupportInterface* createThreadSupport(int numThreads)
+{
+#ifdef _WIN32
+	b3Win32ThreadSupport::Win32ThreadConstructionInfo threadConstructionInfo("raycast",b3ThreadTaskFunc,b3ThreadTaskLocalStoreFunc,numThreads);
+	return new b3Win32ThreadSupport(threadConstructionInfo);
+#else
+	b3PosixThreadSupport::ThreadConstructionInfo threadConstructionInfo("raycast",b3ThreadTaskFunc,b3ThreadTaskLocalStoreFunc,numThreads);
+	return new b3PosixThreadSupport(threadConstructionInfo);
+#endif
+}
+
+static float cube_vertices[] =
+{
+	-1,-1,-1,0,	1,-1,-1,0,	-1,1,-1,0,	1,1,-1,0,
+	-1,-1,1,0,	1,-1,1,0,	-1,1,1,0,	1,1,1,0,
+};
+
+enum RayShapeType
+{
+	RAY_SHAPE_SPHERE,
+	RAY_SHAPE_BOX,
+	RAY_SHAPE_MESH,
+	RAY_SHAPE_COMPOUND,
+	NUM_RAY_SHAPE_TYPES
+};
+
+///bodies registered in a narrowphase, with what the brute-force reference needs to cast rays against them
+struct RayScene
+{
+	b3GpuNarrowPhase*	m_np;
+	b3AlignedObjectArray<int>	m_bodyShapes;
+	//radius of the spheres in x, half extents of the boxes
+	b3AlignedObjectArray<b3Vector3>	m_bodySizes;
+
+	//the tree of the mesh refers to these arrays, they live as long as the narrowphase
+	b3AlignedObjectArray<b3Vector3>	m_meshVertices;
+	b3AlignedObjectArray<int>	m_meshIndices;
+
+	//children of the compounds, boxes with m_childHalfExtents
+	b3AlignedObjectArray<b3Transform>	m_childTransforms;
+	b3Vector3	m_childHalfExtents;
+
+	RayScene()
+	{
+		b3Config config;
+		m_np = new b3GpuNarrowPhase(g_context,g_device,g_queue,config);
+	}
+	virtual ~RayScene()
+	{
+		delete m_np;
+	}
+
+	int	registerBoxShape(const b3Vector3& halfExtents)
+	{
+		float scaling[4] = {halfExtents.x,halfExtents.y,halfExtents.z,1};
+		int strideInBytes = 4*sizeof(float);
+		int numVertices = sizeof(cube_vertices)/strideInBytes;
+		return m_np->registerConvexHullShape(&cube_vertices[0],strideInBytes,numVertices,scaling);
+	}
+
+	void	addBody(int collidableIndex, int shape, const b3Vector3& size, const b3Vector3& pos, const b3Quaternion& orn)
+	{
+		float radius = size.length()+1.f;
+		b3Vector3 aabbMin = pos-b3MakeVector3(radius,radius,radius);
+		b3Vector3 aabbMax = pos+b3MakeVector3(radius,radius,radius);
+		m_np->registerRigidBody(collidableIndex,0.f,&pos[0],&orn[0],&aabbMin[0],&aabbMax[0],false);
+		m_bodyShapes.push_back(shape);
+		m_bodySizes.push_back(size);
+	}
+};
+
+static float randRange(float minValue, float maxValue)
+{
+	return minValue+(maxValue-minValue)*(rand()/(float)RAND_MAX);
+}
+
+static b3Quaternion randOrientation()
+{
+	b3Vector3 axis = b3MakeVector3(randRange(-1,1),randRange(-1,1),randRange(-1,1));
+	if (axis.length2()<1e-4f)
+		axis = b3MakeVector3(0,1,0);
+	return b3Quaternion(axis.normalized(),randRange(0,B3_2_PI));
+}
+
+///rotated spheres and boxes on a grid, spaced so that they don't touch
+static void createConvexScene(RayScene& scene)
+{
+	srand(7);
+	int sphereIndex[2] = {scene.m_np->registerSphereShape(0.5f),scene.m_np->registerSphereShape(0.8f)};
+	b3Vector3 halfExtents[2] = {b3MakeVector3(0.5f,0.3f,0.8f),b3MakeVector3(0.9f,0.4f,0.2f)};
+	int boxIndex[2] = {scene.registerBoxShape(halfExtents[0]),scene.registerBoxShape(halfExtents[1])};
+
+	for (int x=0;x<8;x++)
+	{
+		for (int y=0;y<3;y++)
+		{
+			for (int z=0;z<8;z++)
+			{
+				b3Vector3 pos = b3MakeVector3(3.f*x,3.f*y,3.f*z);
+				int k = (x+y+z)%4;
+				if (k<2)
+					scene.addBody(sphereIndex[k],RAY_SHAPE_SPHERE,b3MakeVector3(k? 0.8f : 0.5f,0,0),pos,b3Quaternion(0,0,0,1));
+				else
+					scene.addBody(boxIndex[k-2],RAY_SHAPE_BOX,halfExtents[k-2],pos,randOrientation());
+			}
+		}
+	}
+	scene.m_np->writeAllBodiesToGpu();
+}
+
+///a wavy grid of triangles, with a few spheres and boxes above it
+static void createMeshScene(RayScene& scene)
+{
+	srand(11);
+	int numCells = 12;
+	float cellSize = 2.f;
+	for (int i=0;i<=numCells;i++)
+	{
+		for (int j=0;j<=numCells;j++)
+		{
+			float x = i*cellSize;
+			float z = j*cellSize;
+			scene.m_meshVertices.push_back(b3MakeVector3(x,0.7f*b3Sin(0.6f*x)*b3Cos(0.4f*z),z));
+		}
+	}
+	for (int i=0;i<numCells;i++)
+	{
+		for (int j=0;j<numCells;j++)
+		{
+			int v00 = i*(numCells+1)+j;
+			int v01 = v00+1;
+			int v10 = v00+numCells+1;
+			int v11 = v10+1;
+			scene.m_meshIndices.push_back(v00);
+			scene.m_meshIndices.push_back(v01);
+			scene.m_meshIndices.push_back(v11);
+			scene.m_meshIndices.push_back(v00);
+			scene.m_meshIndices.push_back(v11);
+			scene.m_meshIndices.push_back(v10);
+		}
+	}
+	float scaling[4] = {1,1,1,1};
+	int meshIndex = scene.m_np->registerConcaveMesh(&scene.m_meshVertices,&scene.m_meshIndices,scaling);
+	scene.addBody(meshIndex,RAY_SHAPE_MESH,b3MakeVector3(numCells*cellSize,1,numCells*cellSize),b3MakeVector3(-12,-1,-12),
+		b3Quaternion(b3MakeVector3(0,1,0),0.3f));
+
+	int sphereIndex = scene.m_np->registerSphereShape(0.7f);
+	b3Vector3 halfExtents = b3MakeVector3(0.6f,0.5f,0.4f);
+	int boxIndex = scene.registerBoxShape(halfExtents);
+	for (int i=0;i<10;i++)
+	{
+		b3Vector3 pos = b3MakeVector3(-8.f+4.f*(i%5),3.f+2.f*(i/5),-6.f+3.f*(i%3));
+		if (i%2)
+			scene.addBody(sphereIndex,RAY_SHAPE_SPHERE,b3MakeVector3(0.7f,0,0),pos,b3Quaternion(0,0,0,1));
+		else
+			scene.addBody(boxIndex,RAY_SHAPE_BOX,halfExtents,pos,randOrientation());
+	}
+	scene.m_np->writeAllBodiesToGpu();
+}
+
+///compounds of three boxes, one of them rotated within the compound, on a grid
+static void createCompoundScene(RayScene& scene)
+{
+	srand(13);
+	scene.m_childHalfExtents = b3MakeVector3(0.5f,0.5f,0.5f);
+	int childIndex = scene.registerBoxShape(scene.m_childHalfExtents);
+
+	b3Vector3 childPositions[3] = {b3MakeVector3(-1.2f,0,0),b3MakeVector3(0,0,0),b3MakeVector3(0.4f,1.1f,0.3f)};
+	b3Quaternion childOrientations[3] = {b3Quaternion(0,0,0,1),b3Quaternion(0,0,0,1),b3Quaternion(b3MakeVector3(1,0,1).normalized(),0.7f)};
+	b3AlignedObjectArray<b3GpuChildShape> childShapes;
+	for (int i=0;i<3;i++)
+	{
+		b3GpuChildShape child;
+		memset(&child,0,sizeof(b3GpuChildShape));
+		child.m_shapeIndex = childIndex;
+		for (int v=0;v<4;v++)
+		{
+			child.m_childPosition[v] = childPositions[i][v];
+			child.m_childOrientation[v] = childOrientations[i][v];
+		}
+		childShapes.push_back(child);
+		b3Transform childTr;
+		childTr.setOrigin(childPositions[i]);
+		childTr.setRotation(childOrientations[i]);
+		scene.m_childTransforms.push_back(childTr);
+	}
+	int compoundIndex = scene.m_np->registerCompoundShape(&childShapes);
+
+	for (int x=0;x<6;x++)
+	{
+		for (int y=0;y<2;y++)
+		{
+			for (int z=0;z<6;z++)
+			{
+				b3Vector3 pos = b3MakeVector3(5.f*x,5.f*y,5.f*z);
+				scene.addBody(compoundIndex,RAY_SHAPE_COMPOUND,b3MakeVector3(2,2,2),pos,randOrientation());
+			}
+		}
+	}
+	scene.m_np->writeAllBodiesToGpu();
+}
+
+///rays between random points on a sphere around the scene, they start and end outside of all bodies
+static void createRandomRays(b3AlignedObjectArray<b3RayInfo>& rays, int numRays, const b3Vector3& center, float radius)
+{
+	srand(3);
+	rays.resize(numRays);
+	for (int i=0;i<numRays;i++)
+	{
+		b3Vector3 from = b3MakeVector3(randRange(-1,1),randRange(-1,1),randRange(-1,1));
+		b3Vector3 to = b3MakeVector3(randRange(-1,1),randRange(-1,1),randRange(-1,1));
+		from.safeNormalize();
+		to.safeNormalize();
+		rays[i].m_from = center+from*radius;
+		rays[i].m_to = center+to*radius;
+	}
+}
+
+///a grid of parallel slanted rays from above, all with the same direction signs so they form packets
+static void createCoherentRays(b3AlignedObjectArray<b3RayInfo>& rays, int gridSize, const b3Vector3& minCorner, float extent, float height)
+{
+	rays.resize(gridSize*gridSize);
+	for (int i=0;i<gridSize;i++)
+	{
+		for (int j=0;j<gridSize;j++)
+		{
+			b3RayInfo& ray = rays[i*gridSize+j];
+			ray.m_from = minCorner+b3MakeVector3(extent*i/gridSize,height,extent*j/gridSize);
+			ray.m_to = ray.m_from+b3MakeVector3(3.f,-2.f*height,2.f);
+		}
+	}
+}
+
+static void resetHits(b3AlignedObjectArray<b3RayHit>& hits, int numRays)
+{
+	hits.resize(numRays);
+	for (int i=0;i<numRays;i++)
+	{
+		memset(&hits[i],0,sizeof(b3RayHit));
+		hits[i].m_hitFraction = 1.f;
+		hits[i].m_hitBody = -1;
+		hits[i].m_hitResult1 = -1;
+		hits[i].m_hitResult2 = -1;
+	}
+}
+
+static void castHostRays(b3GpuRaycast& raycaster, const RayScene& scene, const b3AlignedObjectArray<b3RayInfo>& rays, b3AlignedObjectArray<b3RayHit>& hits)
+{
+	resetHits(hits,rays.size());
+	raycaster.castRaysHost(rays,hits,scene.m_np->getNumRigidBodies(),scene.m_np->getBodiesCpu(),
+		scene.m_np->getNumCollidablesGpu(),scene.m_np->getCollidablesCpu(),scene.m_np->getInternalData());
+}
+
+static bool raySphere(const b3Vector3& from, const b3Vector3& to, const b3Vector3& center, float radius, float& hitFraction)
+{
+	b3Vector3 dir = to-from;
+	b3Vector3 rel = from-center;
+	float a = dir.dot(dir);
+	float b = rel.dot(dir);
+	float c = rel.dot(rel)-radius*radius;
+	float d = b*b-a*c;
+	if (d<=0.f)
+		return false;
+	float t = (-b-b3Sqrt(d))/a;
+	if (t<0.f || t>=hitFraction)
+		return false;
+	hitFraction = t;
+	return true;
+}
+
+///slab test in the local space of the box
+static bool rayBox(const b3Vector3& from, const b3Vector3& to, const b3Transform& tr, const b3Vector3& halfExtents, float& hitFraction)
+{
+	b3Transform world2Local = tr.inverse();
+	b3Vector3 localFrom = world2Local(from);
+	b3Vector3 localDir = world2Local(to)-localFrom;
+	float enter = 0.f;
+	float exit = hitFraction;
+	for (int k=0;k<3;k++)
+	{
+		if (b3Fabs(localDir[k])<1e-12f)
+		{
+			if (b3Fabs(localFrom[k])>halfExtents[k])
+				return false;
+			continue;
+		}
+		float t0 = (-halfExtents[k]-localFrom[k])/localDir[k];
+		float t1 = (halfExtents[k]-localFrom[k])/localDir[k];
+		enter = b3Max(enter,b3Min(t0,t1));
+		exit = b3Min(exit,b3Max(t0,t1));
+		if (enter>exit)
+			return false;
+	}
+	if (enter>=hitFraction)
+		return false;
+	hitFraction = enter;
+	return true;
+}
+
+static bool rayTriangle(const b3Vector3& from, const b3Vector3& to, const b3Vector3& v0, const b3Vector3& v1, const b3Vector3& v2, float& hitFraction)
+{
+	b3Vector3 dir = to-from;
+	b3Vector3 normal = (v1-v0).cross(v2-v0);
+	float denom = normal.dot(dir);
+	if (denom==0.f)
+		return false;
+	float t = normal.dot(v0-from)/denom;
+	if (t<0.f || t>=hitFraction)
+		return false;
+	b3Vector3 p = from+dir*t;
+	//p is inside when it is left of the three edges around the normal, for either side of the triangle
+	float d0 = (v1-v0).cross(p-v0).dot(normal);
+	float d1 = (v2-v1).cross(p-v1).dot(normal);
+	float d2 = (v0-v2).cross(p-v2).dot(normal);
+	if (d0<0.f || d1<0.f || d2<0.f)
+		return false;
+	hitFraction = t;
+	return true;
+}
+
+///tests the ray against every body, and every triangle and child of the meshes and compounds, returns the closest body or -1
+static int castRayBruteForce(const RayScene& scene, const b3RayInfo& ray, float& hitFraction)
+{
+	hitFraction = 1.f;
+	int hitBody = -1;
+	const b3RigidBodyCL* bodies = scene.m_np->getBodiesCpu();
+	for (int b=0;b<scene.m_np->getNumRigidBodies();b++)
+	{
+		b3Transform tr;
+		tr.setOrigin(bodies[b].m_pos);
+		tr.setRotation(bodies[b].m_quat);
+		bool hit = false;
+		switch (scene.m_bodyShapes[b])
+		{
+		case RAY_SHAPE_SPHERE:
+			hit = raySphere(ray.m_from,ray.m_to,bodies[b].m_pos,scene.m_bodySizes[b].x,hitFraction);
+			break;
+		case RAY_SHAPE_BOX:
+			hit = rayBox(ray.m_from,ray.m_to,tr,scene.m_bodySizes[b],hitFraction);
+			break;
+		case RAY_SHAPE_MESH:
+			{
+				for (int i=0;i<scene.m_meshIndices.size();i+=3)
+				{
+					b3Vector3 v0 = tr(scene.m_meshVertices[scene.m_meshIndices[i]]);
+					b3Vector3 v1 = tr(scene.m_meshVertices[scene.m_meshIndices[i+1]]);
+					b3Vector3 v2 = tr(scene.m_meshVertices[scene.m_meshIndices[i+2]]);
+					if (rayTriangle(ray.m_from,ray.m_to,v0,v1,v2,hitFraction))
+						hit = true;
+				}
+				break;
+			}
+		case RAY_SHAPE_COMPOUND:
+			{
+				for (int i=0;i<scene.m_childTransforms.size();i++)
+				{
+					if (rayBox(ray.m_from,ray.m_to,tr*scene.m_childTransforms[i],scene.m_childHalfExtents,hitFraction))
+						hit = true;
+				}
+				break;
+			}
+		}
+		if (hit)
+			hitBody = b;
+	}
+	return hitBody;
+}
+
+///compares the hits with the brute-force reference, numHits counts the hits of each RayShapeType
+static bool isSameAsBruteForce(const RayScene& scene, const b3AlignedObjectArray<b3RayInfo>& rays, const b3AlignedObjectArray<b3RayHit>& hits,
+	int numHits[NUM_RAY_SHAPE_TYPES])
+{
+	for (int k=0;k<NUM_RAY_SHAPE_TYPES;k++)
+		numHits[k] = 0;
+	for (int i=0;i<rays.size();i++)
+	{
+		float hitFraction;
+		int hitBody = castRayBruteForce(scene,rays[i],hitFraction);
+		if (hits[i].m_hitBody!=hitBody)
+			return false;
+		if (hitBody<0)
+			continue;
+		if (b3Fabs(hits[i].m_hitFraction-hitFraction)>1e-4f)
+			return false;
+		//the normal faces the ray
+		if (hits[i].m_hitNormal.dot(rays[i].m_to-rays[i].m_from)>0.f)
+			return false;
+		numHits[scene.m_bodyShapes[hitBody]]++;
+	}
+	return true;
+}
+
+static bool isSameHits(const b3AlignedObjectArray<b3RayHit>& hitsA, const b3AlignedObjectArray<b3RayHit>& hitsB)
+{
+	return hitsA.size()==hitsB.size() && memcmp(&hitsA[0],&hitsB[0],sizeof(b3RayHit)*hitsA.size())==0;
+}
+
+inline void bvhTest()
+{
+	TEST_INIT;
+
+	RayScene scene;
+	createConvexScene(scene);
+	b3AlignedObjectArray<b3RayInfo> rays;
+	createRandomRays(rays,2000,b3MakeVector3(10.5f,3.f,10.5f),25.f);
+
+	b3GpuRaycast raycaster(g_context,g_device,g_queue);
+	raycaster.setRayPacketWidth(1);
+	b3AlignedObjectArray<b3RayHit> hits;
+	castHostRays(raycaster,scene,rays,hits);
+	int numHits[NUM_RAY_SHAPE_TYPES];
+	TEST_ASSERT(isSameAsBruteForce(scene,rays,hits,numHits));
+	TEST_ASSERT(numHits[RAY_SHAPE_SPHERE]>0 && numHits[RAY_SHAPE_BOX]>0);
+
+	//the kernel of castRays tests every body
+	b3AlignedObjectArray<b3RayHit> gpuHits;
+	resetHits(gpuHits,rays.size());
+	raycaster.castRays(rays,gpuHits,scene.m_np->getNumRigidBodies(),scene.m_np->getBodiesCpu(),
+		scene.m_np->getNumCollidablesGpu(),scene.m_np->getCollidablesCpu(),scene.m_np->getInternalData());
+	bool isSameAsGpu = true;
+	for (int i=0;i<rays.size();i++)
+	{
+		if (gpuHits[i].m_hitBody!=hits[i].m_hitBody)
+			isSameAsGpu = false;
+		else if (hits[i].m_hitBody>=0 && b3Fabs(gpuHits[i].m_hitFraction-hits[i].m_hitFraction)>1e-3f)
+			isSameAsGpu = false;
+	}
+	TEST_ASSERT(isSameAsGpu);
+
+	//rays that miss the tree leave the hits alone
+	b3AlignedObjectArray<b3RayInfo> missRays;
+	createRandomRays(missRays,100,b3MakeVector3(200,0,0),10.f);
+	castHostRays(raycaster,scene,missRays,hits);
+	int numMisses = 0;
+	for (int i=0;i<missRays.size();i++)
+		numMisses += hits[i].m_hitBody<0 && hits[i].m_hitFraction==1.f;
+	TEST_ASSERT(numMisses==missRays.size());
+
+	TEST_REPORT("bvh");
+}
+
+inline void rayPacketTest()
+{
+	TEST_INIT;
+
+	RayScene scene;
+	createConvexScene(scene);
+	b3AlignedObjectArray<b3RayInfo> coherentRays,randomRays;
+	createCoherentRays(coherentRays,60,b3MakeVector3(-3,3,-3),24.f,10.f);
+	createRandomRays(randomRays,1000,b3MakeVector3(10.5f,3.f,10.5f),25.f);
+	b3AlignedObjectArray<b3RayInfo>* rays[2] = {&coherentRays,&randomRays};
+
+	b3GpuRaycast raycaster(g_context,g_device,g_queue);
+	raycaster.setRayPacketWidth(1);
+	TEST_ASSERT(raycaster.getRayPacketWidth()==1);
+	raycaster.setRayPacketWidth(8);
+	TEST_ASSERT(raycaster.getRayPacketWidth()==8 || raycaster.getRayPacketWidth()==4);
+
+	for (int r=0;r<2;r++)
+	{
+		b3AlignedObjectArray<b3RayHit> singleHits,hits;
+		raycaster.setThreadSupport(0);
+		raycaster.setRayPacketWidth(1);
+		castHostRays(raycaster,scene,*rays[r],singleHits);
+		int numHits[NUM_RAY_SHAPE_TYPES];
+		TEST_ASSERT(isSameAsBruteForce(scene,*rays[r],singleHits,numHits));
+
+		//the lanes of a packet run the same body tests as a single ray, the hits are bitwise the same
+		int widths[2] = {4,8};
+		for (int w=0;w<2;w++)
+		{
+			for (int useThreads=0;useThreads<2;useThreads++)
+			{
+				raycaster.setRayPacketWidth(widths[w]);
+				raycaster.setThreadSupport(useThreads? g_threadSupport : 0);
+				castHostRays(raycaster,scene,*rays[r],hits);
+				TEST_ASSERT(isSameHits(hits,singleHits));
+			}
+		}
+		raycaster.setThreadSupport(0);
+	}
+
+	TEST_REPORT("rayPacket");
+}
+
+inline void trimeshTest()
+{
+	TEST_INIT;
+
+	RayScene scene;
+	createMeshScene(scene);
+	b3AlignedObjectArray<b3RayInfo> coherentRays,randomRays;
+	createCoherentRays(coherentRays,40,b3MakeVector3(-12,0,-12),20.f,8.f);
+	createRandomRays(randomRays,1000,b3MakeVector3(0,0,0),30.f);
+	b3AlignedObjectArray<b3RayInfo>* rays[2] = {&coherentRays,&randomRays};
+
+	b3GpuRaycast raycaster(g_context,g_device,g_queue);
+	for (int r=0;r<2;r++)
+	{
+		for (int useThreads=0;useThreads<2;useThreads++)
+		{
+			raycaster.setThreadSupport(useThreads? g_threadSupport : 0);
+			b3AlignedObjectArray<b3RayHit> hits;
+			castHostRays(raycaster,scene,*rays[r],hits);
+			int numHits[NUM_RAY_SHAPE_TYPES];
+			TEST_ASSERT(isSameAsBruteForce(scene,*rays[r],hits,numHits));
+			TEST_ASSERT(numHits[RAY_SHAPE_MESH]>0);
+		}
+	}
+	raycaster.setThreadSupport(0);
+
+	TEST_REPORT("trimesh");
+}
+
+inline void compoundTest()
+{
+	TEST_INIT;
+
+	RayScene scene;
+	createCompoundScene(scene);
+	b3AlignedObjectArray<b3RayInfo> coherentRays,randomRays;
+	createCoherentRays(coherentRays,50,b3MakeVector3(-3,2,-3),28.f,12.f);
+	createRandomRays(randomRays,1000,b3MakeVector3(12.5f,2.5f,12.5f),30.f);
+	b3AlignedObjectArray<b3RayInfo>* rays[2] = {&coherentRays,&randomRays};
+
+	b3GpuRaycast raycaster(g_context,g_device,g_queue);
+	for (int r=0;r<2;r++)
+	{
+		for (int useThreads=0;useThreads<2;useThreads++)
+		{
+			raycaster.setThreadSupport(useThreads? g_threadSupport : 0);
+			b3AlignedObjectArray<b3RayHit> hits;
+			castHostRays(raycaster,scene,*rays[r],hits);
+			int numHits[NUM_RAY_SHAPE_TYPES];
+			TEST_ASSERT(isSameAsBruteForce(scene,*rays[r],hits,numHits));
+			TEST_ASSERT(numHits[RAY_SHAPE_COMPOUND]>0);
+		}
+	}
+	raycaster.setThreadSupport(0);
+
+	TEST_REPORT("compound");
+}
+
+
+
+int main(int argc, char** argv)
+{
+	int preferredDeviceIndex = -1;
+	int preferredPlatformIndex = -1;
+
+	b3CommandLineArgs args(argc, argv);
+	args.GetCmdLineArgument("deviceId", preferredDeviceIndex);
+	args.GetCmdLineArgument("platformId", preferredPlatformIndex);
+
+	//b3GpuRaycast and b3GpuNarrowPhase build their kernels, even for the host raycasts
+	initCL(preferredDeviceIndex,preferredPlatformIndex);
+	if (g_queue)
+	{
+		g_threadSupport = createThreadSupport(4);
+
+		bvhTest();
+		rayPacketTest();
+		trimeshTest();
+		compoundTest();
+
+		delete g_threadSupport;
+		exitCL();
+	} else
+	{
+		printf("No OpenCL device found, skipping the OpenCL tests\n");
+	}
+
+	printf("%d tests passed, %d tests failed\n",g_nPassed, g_nFailed);
+	return g_nFailed;
+}
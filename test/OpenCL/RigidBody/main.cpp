@@ -0,0 +1,615 @@
+/*
+Copyright (c) 2013 Advanced Micro Devices, Inc.
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Bullet3OpenCL/Initialize/b3OpenCLUtils.h"
+#include "Bullet3OpenCL/ParallelPrimitives/b3OpenCLArray.h"
+#include "Bullet3OpenCL/RigidBody/b3GpuBatchingPgsSolver.h"
+#include "Bullet3OpenCL/RigidBody/b3Config.h"
+#include "Bullet3OpenCL/RigidBody/b3Solver.h"
+#include "Bullet3OpenCL/RigidBody/b3GpuGenericConstraint.h"
+#include "Bullet3Dynamics/ConstraintSolver/b3Generic6DofConstraint.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3Contact4.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
+#include "Bullet3Common/b3Quaternion.h"
+#include "Bullet3Common/b3CommandLineArgs.h"
+#include "Bullet3Common/b3MinMax.h"
+
+#ifdef _WIN32
+#include "b3Win32ThreadSupport.h"
+#else
+#include "b3PosixThreadSupport.h"
+#endif
+
+//switches of the batching solver, see b3GpuBatchingPgsSolver.cpp
+extern bool b3GpuBatchContacts;
+extern bool b3GpuSolveConstraint;
+extern bool b3ReuseCpuBatches;
+
+int g_nPassed = 0;
+int g_nFailed = 0;
+bool g_testFailed = 0;
+
+#define TEST_INIT g_testFailed = 0;
+#define TEST_ASSERT(x) if( !(x) ){g_testFailed = 1;}
+#define TEST_REPORT(testName) printf("[%s] %s\n",(g_testFailed)?"X":"O", testName); if(g_testFailed) g_nFailed++; else g_nPassed++;
+
+cl_context g_context=0;
+cl_device_id g_device=0;
+cl_command_queue g_queue =0;
+b3ThreadSupportInterface* g_threadSupport = 0;
+
+void initCL(int preferredDeviceIndex, int preferredPlatformIndex)
+{
+	int ciErrNum = 0;
+	cl_device_type deviceType = CL_DEVICE_TYPE_ALL;
+
+	g_context = b3OpenCLUtils::createContextFromType(deviceType, &ciErrNum, 0,0,preferredDeviceIndex, preferredPlatformIndex);
+	int numDev = g_context? b3OpenCLUtils::getNumDevices(g_context) : 0;
+	if (numDev>0)
+	{
+		g_device= b3OpenCLUtils::getDevice(g_context,0);
+		g_queue = clCreateCommandQueue(g_context, g_device, 0, &ciErrNum);
+		oclCHECKERROR(ciErrNum, CL_SUCCESS);
+		b3OpenCLUtils::printDeviceInfo(g_device);
+	}
+}
+
+void exitCL()
+{
+	clReleaseCommandQueue(g_queue);
+	clReleaseContext(g_context);
+}
+
+static b3ThreadSupportInterface* createThreadSupport(int numThreads)
+{
+#ifdef _WIN32
+	b3Win32ThreadSupport::Win32ThreadConstructionInfo threadConstructionInfo("solver",b3ThreadTaskFunc,b3ThreadTaskLocalStoreFunc,numThreads);
+	return new b3Win32ThreadSupport(threadConstructionInfo);
+#else
+	b3PosixThreadSupport::ThreadConstructionInfo threadConstructionInfo("solver",b3ThreadTaskFunc,b3ThreadTaskLocalStoreFunc,numThreads);
+	return new b3PosixThreadSupport(threadConstructionInfo);
+#endif
+}
+
+struct SolverScene
+{
+	b3AlignedObjectArray<b3RigidBodyCL>	m_bodies;
+	b3AlignedObjectArray<b3InertiaCL>	m_inertias;
+	b3AlignedObjectArray<b3Contact4>	m_contacts;
+};
+
+///columns of unit boxes (half extents 1) on the static ground body 0, each box touches the one below with a 4-point manifold
+static void createBoxStackScene(SolverScene& scene, int numColumns, int height)
+{
+	int numBodies = 1+numColumns*height;
+	scene.m_bodies.resize(numBodies);
+	scene.m_inertias.resize(numBodies);
+	scene.m_contacts.resize(0);
+	memset(&scene.m_bodies[0],0,sizeof(b3RigidBodyCL)*numBodies);
+	memset(&scene.m_inertias[0],0,sizeof(b3InertiaCL)*numBodies);
+	for (int i=0;i<numBodies;i++)
+	{
+		scene.m_bodies[i].m_quat = b3Quaternion(0,0,0,1);
+		scene.m_inertias[i].m_invInertiaWorld.setValue(0,0,0,0,0,0,0,0,0);
+		scene.m_inertias[i].m_initInvInertia.setValue(0,0,0,0,0,0,0,0,0);
+	}
+	for (int c=0;c<numColumns;c++)
+	{
+		for (int h=0;h<height;h++)
+		{
+			int i = 1+c*height+h;
+			b3RigidBodyCL& body = scene.m_bodies[i];
+			body.m_pos = b3MakeVector3((c%8)*3.f,1.f+2.f*h,(c/8)*3.f);
+			body.m_invMass = 1.f;
+			body.m_collidableIdx = 1;
+			body.m_linVel = b3MakeVector3(0.01f*(c%5),-0.2f-0.01f*h,0.03f*(h%3));
+			body.m_angVel = b3MakeVector3(0.1f*(h%2),0,0.05f*(c%3));
+			scene.m_inertias[i].m_invInertiaWorld.setValue(1.5f,0,0,0,1.5f,0,0,0,1.5f);
+			scene.m_inertias[i].m_initInvInertia = scene.m_inertias[i].m_invInertiaWorld;
+
+			b3Contact4 contact;
+			memset(&contact,0,sizeof(b3Contact4));
+			int below = h==0? 0 : i-1;
+			contact.m_bodyAPtrAndSignBit = i;
+			contact.m_bodyBPtrAndSignBit = below==0? -below : below;
+			contact.m_childIndexA = -1;
+			contact.m_childIndexB = -1;
+			contact.m_worldNormalOnB = b3MakeVector3(0,1,0);
+			contact.m_worldNormalOnB.w = 4;
+			int k=0;
+			for (int dx=-1;dx<=1;dx+=2)
+			{
+				for (int dz=-1;dz<=1;dz+=2)
+				{
+					contact.m_worldPosB[k] = body.m_pos+b3MakeVector3((float)dx,-1.f,(float)dz);
+					contact.m_worldPosB[k].w = -0.01f;
+					k++;
+				}
+			}
+			contact.setFrictionCoeff(0.7f);
+			contact.setRestituitionCoeff(0.f);
+			scene.m_contacts.push_back(contact);
+		}
+	}
+}
+
+///one solveContacts call on a copy of the scene, the static ground is body 0
+static void solveScene(b3GpuBatchingPgsSolver* solver, const SolverScene& scene, b3AlignedObjectArray<b3RigidBodyCL>& bodiesOut)
+{
+	b3OpenCLArray<b3RigidBodyCL> bodiesGPU(g_context,g_queue);
+	b3OpenCLArray<b3InertiaCL> inertiasGPU(g_context,g_queue);
+	b3OpenCLArray<b3Contact4> contactsGPU(g_context,g_queue);
+	bodiesGPU.copyFromHost(scene.m_bodies);
+	inertiasGPU.copyFromHost(scene.m_inertias);
+	contactsGPU.copyFromHost(scene.m_contacts);
+
+	b3Config config;
+	solver->solveContacts(scene.m_bodies.size(),bodiesGPU.getBufferCL(),inertiasGPU.getBufferCL(),
+		scene.m_contacts.size(),contactsGPU.getBufferCL(),config,0);
+	bodiesGPU.copyToHost(bodiesOut);
+}
+
+static bool isSameBodies(const b3AlignedObjectArray<b3RigidBodyCL>& bodiesA, const b3AlignedObjectArray<b3RigidBodyCL>& bodiesB)
+{
+	return bodiesA.size()==bodiesB.size() && memcmp(&bodiesA[0],&bodiesB[0],sizeof(b3RigidBodyCL)*bodiesA.size())==0;
+}
+
+
+inline void threadedHostSolveTest()
+{
+	TEST_INIT;
+
+	SolverScene scene;
+	createBoxStackScene(scene,32,8);
+
+	bool batchContacts = b3GpuBatchContacts;
+	bool solveConstraint = b3GpuSolveConstraint;
+	b3GpuBatchContacts = false;
+	b3GpuSolveConstraint = false;
+
+	b3AlignedObjectArray<b3RigidBodyCL> serialBodies,threadedBodies;
+	b3GpuBatchingPgsSolver* solver = new b3GpuBatchingPgsSolver(g_context,g_device,g_queue,scene.m_contacts.size());
+	solveScene(solver,scene,serialBodies);
+	//the cells of a cell batch share no body and each cell is solved by one thread, so the result is the same
+	solver->setThreadSupport(g_threadSupport);
+	solveScene(solver,scene,threadedBodies);
+	TEST_ASSERT(isSameBodies(threadedBodies,serialBodies));
+	solver->setThreadSupport(0);
+	delete solver;
+
+	b3GpuBatchContacts = batchContacts;
+	b3GpuSolveConstraint = solveConstraint;
+
+	TEST_REPORT("threadedHostSolve");
+}
+
+inline void adaptiveCellSplitTest()
+{
+	TEST_INIT;
+
+	//two tall columns in one x and z cell, the fixed split folds their height into B3_SOLVER_N_SPLIT_Y cells
+	SolverScene scene;
+	createBoxStackScene(scene,2,64);
+
+	b3AlignedObjectArray<b3RigidBodyCL> bodies;
+	b3GpuBatchingPgsSolver* solver = new b3GpuBatchingPgsSolver(g_context,g_device,g_queue,scene.m_contacts.size());
+	solver->setCollectCellStatistics(true);
+
+	solver->setAdaptiveCellSplit(false);
+	solveScene(solver,scene,bodies);
+	b3BatchingCellStatistics fixedStats = solver->getCellStatistics();
+	TEST_ASSERT(fixedStats.m_nSplit.x==B3_SOLVER_N_SPLIT_X && fixedStats.m_nSplit.y==B3_SOLVER_N_SPLIT_Y && fixedStats.m_nSplit.z==B3_SOLVER_N_SPLIT_Z);
+
+	solver->setAdaptiveCellSplit(true);
+	solveScene(solver,scene,bodies);
+	const b3BatchingCellStatistics& stats = solver->getCellStatistics();
+	TEST_ASSERT(stats.m_nSplit.x*stats.m_nSplit.y*stats.m_nSplit.z==B3_SOLVER_N_CELLS);
+	TEST_ASSERT(stats.m_nSplit.y>B3_SOLVER_N_SPLIT_Y);
+	TEST_ASSERT(stats.m_numContacts==scene.m_contacts.size());
+	TEST_ASSERT(stats.m_numNonEmptyCells>fixedStats.m_numNonEmptyCells);
+	TEST_ASSERT(stats.m_maxCellContacts<fixedStats.m_maxCellContacts);
+
+	delete solver;
+
+	TEST_REPORT("adaptiveCellSplit");
+}
+
+///exposes the exact host batching of the cells
+class BatchingTestSolver : public b3GpuBatchingPgsSolver
+{
+public:
+	BatchingTestSolver(int pairCapacity)
+		:b3GpuBatchingPgsSolver(g_context,g_device,g_queue,pairCapacity)
+	{
+	}
+	///the static body is 0, the batches are not limited in size
+	int	batchCells(b3AlignedObjectArray<b3Contact4>& contacts, const b3AlignedObjectArray<unsigned int>& numConstraints,
+		const b3AlignedObjectArray<unsigned int>& offsets, int numBodies)
+	{
+		return batchCellsExact(&contacts[0],&numConstraints[0],&offsets[0],numBodies,numBodies+1,0);
+	}
+};
+
+static bool hasPair(const b3Contact4* contacts, int numContacts, int bodyA, int bodyB)
+{
+	for (int i=0;i<numContacts;i++)
+	{
+		if (contacts[i].m_bodyAPtrAndSignBit==bodyA && contacts[i].m_bodyBPtrAndSignBit==bodyB)
+			return true;
+	}
+	return false;
+}
+
+///random contact pairs in a few cells, body 0 and negative body indices are static
+static void createCellContacts(int numBodies, b3AlignedObjectArray<b3Contact4>& contacts,
+	b3AlignedObjectArray<unsigned int>& numConstraints, b3AlignedObjectArray<unsigned int>& offsets)
+{
+	srand(1);
+	int cells[4] = {0,5,17,100};
+	int cellContacts[4] = {200,37,1,90};
+	contacts.resize(0);
+	numConstraints.resize(0);
+	numConstraints.resize(B3_SOLVER_N_CELLS,0);
+	offsets.resize(B3_SOLVER_N_CELLS);
+	for (int c=0;c<4;c++)
+		numConstraints[cells[c]] = cellContacts[c];
+	for (int cell=0;cell<B3_SOLVER_N_CELLS;cell++)
+	{
+		offsets[cell] = contacts.size();
+		while (contacts.size()<int(offsets[cell]+numConstraints[cell]))
+		{
+			b3Contact4 contact;
+			memset(&contact,0,sizeof(b3Contact4));
+			int bodyA = 1+rand()%(numBodies-1);
+			int bodyB = 1+rand()%(numBodies-1);
+			if (rand()%4==0)
+				bodyB = 0;
+			else if (rand()%8==0)
+				bodyB = -bodyB;
+			//each pair once, a pair is in one cell and has one batch
+			if (bodyA==bodyB || (contacts.size() && hasPair(&contacts[0],contacts.size(),bodyA,bodyB)))
+				continue;
+			contact.m_bodyAPtrAndSignBit = bodyA;
+			contact.m_bodyBPtrAndSignBit = bodyB;
+			contact.m_childIndexA = -1;
+			contact.m_childIndexB = -1;
+			contact.m_batchIdx = -1;
+			contacts.push_back(contact);
+		}
+	}
+}
+
+///the contacts of each cell are sorted by batch, the batches are numbered without gaps and no batch uses a dynamic body twice
+static bool isValidCellBatching(const b3AlignedObjectArray<b3Contact4>& contacts, const b3AlignedObjectArray<unsigned int>& numConstraints,
+	const b3AlignedObjectArray<unsigned int>& offsets, int numBodies, int maxNumBatches)
+{
+	b3AlignedObjectArray<int> bodyBatches;
+	for (int cell=0;cell<B3_SOLVER_N_CELLS;cell++)
+	{
+		bodyBatches.resize(0);
+		bodyBatches.resize(numBodies,-1);
+		int batchIdx = 0;
+		for (unsigned int i=offsets[cell];i<offsets[cell]+numConstraints[cell];i++)
+		{
+			const b3Contact4& contact = contacts[i];
+			bool isFirst = i==offsets[cell];
+			if (contact.m_batchIdx!=batchIdx && (isFirst || contact.m_batchIdx!=batchIdx+1))
+				return false;
+			batchIdx = contact.m_batchIdx;
+			if (batchIdx>=maxNumBatches)
+				return false;
+			int bodies[2] = {contact.m_bodyAPtrAndSignBit,contact.m_bodyBPtrAndSignBit};
+			for (int j=0;j<2;j++)
+			{
+				if (bodies[j]<=0)
+					continue;
+				if (bodyBatches[bodies[j]]==batchIdx)
+					return false;
+				bodyBatches[bodies[j]] = batchIdx;
+			}
+		}
+	}
+	return true;
+}
+
+static bool isSameCellPairs(const b3AlignedObjectArray<b3Contact4>& contactsA, const b3AlignedObjectArray<b3Contact4>& contactsB,
+	const b3AlignedObjectArray<unsigned int>& numConstraints, const b3AlignedObjectArray<unsigned int>& offsets)
+{
+	for (int cell=0;cell<B3_SOLVER_N_CELLS;cell++)
+	{
+		const b3Contact4* cellContactsA = &contactsA[0]+offsets[cell];
+		const b3Contact4* cellContactsB = &contactsB[0]+offsets[cell];
+		for (unsigned int i=0;i<numConstraints[cell];i++)
+		{
+			if (!hasPair(cellContactsB,numConstraints[cell],cellContactsA[i].m_bodyAPtrAndSignBit,cellContactsA[i].m_bodyBPtrAndSignBit))
+				return false;
+		}
+	}
+	return true;
+}
+
+inline void exactBatchingTest()
+{
+	TEST_INIT;
+
+	int numBodies = 64;
+	b3AlignedObjectArray<b3Contact4> contacts;
+	b3AlignedObjectArray<unsigned int> numConstraints,offsets;
+	createCellContacts(numBodies,contacts,numConstraints,offsets);
+
+	bool reuseBatches = b3ReuseCpuBatches;
+	b3ReuseCpuBatches = false;
+
+	BatchingTestSolver* solver = new BatchingTestSolver(contacts.size());
+	b3AlignedObjectArray<b3Contact4> serialContacts = contacts;
+	int maxNumBatches = solver->batchCells(serialContacts,numConstraints,offsets,numBodies);
+	TEST_ASSERT(maxNumBatches>1);
+	TEST_ASSERT(isValidCellBatching(serialContacts,numConstraints,offsets,numBodies,maxNumBatches));
+	TEST_ASSERT(isSameCellPairs(contacts,serialContacts,numConstraints,offsets));
+
+	//each cell is batched by one task
+	b3AlignedObjectArray<b3Contact4> threadedContacts = contacts;
+	solver->setThreadSupport(g_threadSupport);
+	TEST_ASSERT(solver->batchCells(threadedContacts,numConstraints,offsets,numBodies)==maxNumBatches);
+	TEST_ASSERT(memcmp(&threadedContacts[0],&serialContacts[0],sizeof(b3Contact4)*contacts.size())==0);
+	solver->setThreadSupport(0);
+	delete solver;
+
+	b3ReuseCpuBatches = reuseBatches;
+
+	TEST_REPORT("exactBatching");
+}
+
+static int getPairBatch(const b3Contact4* contacts, int numContacts, int bodyA, int bodyB)
+{
+	for (int i=0;i<numContacts;i++)
+	{
+		if (contacts[i].m_bodyAPtrAndSignBit==bodyA && contacts[i].m_bodyBPtrAndSignBit==bodyB)
+			return contacts[i].m_batchIdx;
+	}
+	return -1;
+}
+
+inline void batchReuseTest()
+{
+	TEST_INIT;
+
+	int numBodies = 64;
+	b3AlignedObjectArray<b3Contact4> contacts;
+	b3AlignedObjectArray<unsigned int> numConstraints,offsets;
+	createCellContacts(numBodies,contacts,numConstraints,offsets);
+
+	bool reuseBatches = b3ReuseCpuBatches;
+	b3ReuseCpuBatches = true;
+	BatchingTestSolver* solver = new BatchingTestSolver(contacts.size());
+	solver->setThreadSupport(g_threadSupport);
+
+	b3AlignedObjectArray<b3Contact4> firstContacts = contacts;
+	int maxNumBatches = solver->batchCells(firstContacts,numConstraints,offsets,numBodies);
+	TEST_ASSERT(isValidCellBatching(firstContacts,numConstraints,offsets,numBodies,maxNumBatches));
+
+	//the next frame finds the same pairs in another order, each pair keeps its batch
+	b3AlignedObjectArray<b3Contact4> nextContacts;
+	nextContacts.resize(contacts.size());
+	for (int cell=0;cell<B3_SOLVER_N_CELLS;cell++)
+	{
+		for (unsigned int i=0;i<numConstraints[cell];i++)
+			nextContacts[offsets[cell]+i] = contacts[offsets[cell]+numConstraints[cell]-1-i];
+	}
+	TEST_ASSERT(solver->batchCells(nextContacts,numConstraints,offsets,numBodies)==maxNumBatches);
+	TEST_ASSERT(isValidCellBatching(nextContacts,numConstraints,offsets,numBodies,maxNumBatches));
+	TEST_ASSERT(isSameCellPairs(contacts,nextContacts,numConstraints,offsets));
+	for (int cell=0;cell<B3_SOLVER_N_CELLS;cell++)
+	{
+		const b3Contact4* cellContacts = &nextContacts[0]+offsets[cell];
+		const b3Contact4* firstCellContacts = &firstContacts[0]+offsets[cell];
+		for (unsigned int i=0;i<numConstraints[cell];i++)
+		{
+			int batchIdx = getPairBatch(firstCellContacts,numConstraints[cell],cellContacts[i].m_bodyAPtrAndSignBit,cellContacts[i].m_bodyBPtrAndSignBit);
+			TEST_ASSERT(cellContacts[i].m_batchIdx==batchIdx);
+		}
+	}
+
+	//a new pair of two busy bodies replaces the first pair of cell 0, the batches stay valid
+	nextContacts = contacts;
+	nextContacts[offsets[0]].m_bodyAPtrAndSignBit = contacts[offsets[0]+1].m_bodyAPtrAndSignBit;
+	nextContacts[offsets[0]].m_bodyBPtrAndSignBit = contacts[offsets[0]+2].m_bodyAPtrAndSignBit;
+	maxNumBatches = solver->batchCells(nextContacts,numConstraints,offsets,numBodies);
+	TEST_ASSERT(isValidCellBatching(nextContacts,numConstraints,offsets,numBodies,maxNumBatches));
+
+	solver->setThreadSupport(0);
+	delete solver;
+	b3ReuseCpuBatches = reuseBatches;
+
+	TEST_REPORT("batchReuse");
+}
+///the rows of a constraint, filled by the host path of b3GpuGenericConstraint::getInfo2
+struct Generic6DofRows
+{
+	enum {ROW_SKIP=4};
+	float m_J1linearAxis[6*ROW_SKIP];
+	float m_J1angularAxis[6*ROW_SKIP];
+	float m_J2angularAxis[6*ROW_SKIP];
+	float m_constraintError[6*ROW_SKIP];
+	float m_cfm[6*ROW_SKIP];
+	float m_lowerLimit[6*ROW_SKIP];
+	float m_upperLimit[6*ROW_SKIP];
+};
+
+static void getGeneric6DofRows(b3GpuGenericConstraint& constraint, const b3RigidBodyCL* bodies, float fps, float erp, Generic6DofRows& rows)
+{
+	memset(&rows,0,sizeof(Generic6DofRows));
+	for (int i=0;i<6*Generic6DofRows::ROW_SKIP;i++)
+	{
+		rows.m_lowerLimit[i] = -B3_INFINITY;
+		rows.m_upperLimit[i] = B3_INFINITY;
+	}
+	b3GpuConstraintInfo2 info2;
+	memset(&info2,0,sizeof(info2));
+	info2.fps = fps;
+	info2.erp = erp;
+	info2.m_J1linearAxis = rows.m_J1linearAxis;
+	info2.m_J1angularAxis = rows.m_J1angularAxis;
+	info2.m_J2angularAxis = rows.m_J2angularAxis;
+	info2.rowskip = Generic6DofRows::ROW_SKIP;
+	info2.m_constraintError = rows.m_constraintError;
+	info2.cfm = rows.m_cfm;
+	info2.m_lowerLimit = rows.m_lowerLimit;
+	info2.m_upperLimit = rows.m_upperLimit;
+	constraint.getInfo2(&info2,bodies);
+}
+
+static bool isSameRowVector(const float* row, const b3Vector3& v, float tolerance)
+{
+	return b3Fabs(row[0]-v.x)<tolerance && b3Fabs(row[1]-v.y)<tolerance && b3Fabs(row[2]-v.z)<tolerance;
+}
+
+static bool isEmptyRow(const Generic6DofRows& rows, int row)
+{
+	int srow = row*Generic6DofRows::ROW_SKIP;
+	for (int i=0;i<3;i++)
+	{
+		if (rows.m_J1linearAxis[srow+i]!=0.f || rows.m_J1angularAxis[srow+i]!=0.f || rows.m_J2angularAxis[srow+i]!=0.f)
+			return false;
+	}
+	return rows.m_constraintError[srow]==0.f;
+}
+
+inline void generic6DofTest()
+{
+	TEST_INIT;
+
+	//frame B is turned 0.3 around the x axis of frame A, a little around the others, and moved along all axes
+	b3RigidBodyCL bodies[2];
+	memset(bodies,0,sizeof(bodies));
+	bodies[0].m_pos = b3MakeVector3(1,2,3);
+	bodies[0].m_quat = b3Quaternion(b3MakeVector3(0,1,1).normalized(),0.4f);
+	bodies[0].m_invMass = 1.f;
+	b3Quaternion frameInA(b3MakeVector3(1,0,1).normalized(),0.2f);
+	b3Quaternion frameInB(b3MakeVector3(0,0,1),-0.3f);
+	b3Vector3 pivotInA = b3MakeVector3(0.5f,0,0);
+	b3Vector3 pivotInB = b3MakeVector3(-0.5f,0,0);
+	b3Quaternion relativeTurn = b3Quaternion(b3MakeVector3(1,0,0),0.3f)*b3Quaternion(b3MakeVector3(0,1,0),0.04f)*b3Quaternion(b3MakeVector3(0,0,1),-0.03f);
+	b3Quaternion frameWorldA = bodies[0].m_quat*frameInA;
+	bodies[1].m_quat = frameWorldA*relativeTurn*frameInB.inverse();
+	b3Vector3 originA = bodies[0].m_pos+b3QuatRotate(bodies[0].m_quat,pivotInA);
+	bodies[1].m_pos = originA+b3QuatRotate(frameWorldA,b3MakeVector3(0.2f,-0.05f,0.03f))-b3QuatRotate(bodies[1].m_quat,pivotInB);
+	bodies[1].m_invMass = 1.f;
+
+	//the Dynamics 6dof constraint computes the same axes, angles and offsets on the host
+	b3Transform transformInA(frameInA,pivotInA);
+	b3Transform transformInB(frameInB,pivotInB);
+	b3Generic6DofConstraint reference(0,1,transformInA,transformInB,true,bodies);
+	reference.calculateTransforms(bodies);
+
+	b3GpuGenericConstraint constraint;
+	memset(&constraint,0,sizeof(constraint));
+	constraint.m_constraintType = B3_GPU_GENERIC_6DOF_CONSTRAINT_TYPE;
+	constraint.m_rbA = 0;
+	constraint.m_rbB = 1;
+	constraint.m_pivotInA = pivotInA;
+	constraint.m_pivotInB = pivotInB;
+	constraint.m_frameInA = frameInA;
+	constraint.m_frameInB = frameInB;
+	constraint.m_relTargetAB.setValue(0,0,0,1);
+	constraint.m_breakingImpulseThreshold = 1e30f;
+	unsigned int numRows = 0;
+	constraint.getInfo1(&numRows,bodies);
+	TEST_ASSERT(numRows==6);
+
+	float fps = 60.f;
+	float erp = 0.2f;
+	float k = fps*erp;
+	int s = Generic6DofRows::ROW_SKIP;
+	Generic6DofRows rows;
+
+	//all axes locked
+	getGeneric6DofRows(constraint,bodies,fps,erp,rows);
+	b3Matrix3x3 basisA(frameWorldA);
+	for (int i=0;i<3;i++)
+	{
+		TEST_ASSERT(isSameRowVector(&rows.m_J1linearAxis[i*s],basisA.getColumn(i),1e-5f));
+		TEST_ASSERT(b3Fabs(rows.m_constraintError[i*s]-k*reference.getRelativePivotPosition(i))<1e-4f);
+		TEST_ASSERT(isSameRowVector(&rows.m_J1angularAxis[(3+i)*s],reference.getAxis(i),1e-5f));
+		TEST_ASSERT(isSameRowVector(&rows.m_J2angularAxis[(3+i)*s],-reference.getAxis(i),1e-5f));
+		TEST_ASSERT(b3Fabs(rows.m_constraintError[(3+i)*s]+k*reference.getAngle(i))<1e-4f);
+		TEST_ASSERT(rows.m_lowerLimit[(3+i)*s]==-B3_INFINITY && rows.m_upperLimit[(3+i)*s]==B3_INFINITY);
+	}
+	//the Euler angles of the 6dof constraint measure frame A against frame B
+	TEST_ASSERT(b3Fabs(reference.getAngle(0)+0.3f)<0.01f);
+
+	//hinge: the x angle is free within its limits, so its row is empty
+	constraint.m_angularLowerLimit.setValue(-1.f,0,0);
+	constraint.m_angularUpperLimit.setValue(1.f,0,0);
+	getGeneric6DofRows(constraint,bodies,fps,erp,rows);
+	TEST_ASSERT(isEmptyRow(rows,3));
+	TEST_ASSERT(!isEmptyRow(rows,4) && !isEmptyRow(rows,5));
+
+	//past the lower limit the row only pushes the angle back
+	constraint.m_angularLowerLimit.setValue(-0.1f,0,0);
+	getGeneric6DofRows(constraint,bodies,fps,erp,rows);
+	TEST_ASSERT(b3Fabs(rows.m_constraintError[3*s]+k*(reference.getAngle(0)+0.1f))<1e-4f);
+	TEST_ASSERT(rows.m_lowerLimit[3*s]==0.f && rows.m_upperLimit[3*s]==B3_INFINITY);
+
+	//slider: the x offset is free within its limits, a free axis has no row either
+	constraint.m_angularLowerLimit.setValue(0,0,0);
+	constraint.m_angularUpperLimit.setValue(0,0,0);
+	constraint.m_linearLowerLimit.setValue(-1.f,1.f,0);
+	constraint.m_linearUpperLimit.setValue(1.f,-1.f,0);
+	getGeneric6DofRows(constraint,bodies,fps,erp,rows);
+	TEST_ASSERT(isEmptyRow(rows,0) && isEmptyRow(rows,1));
+	TEST_ASSERT(b3Fabs(rows.m_constraintError[2*s]-k*reference.getRelativePivotPosition(2))<1e-4f);
+
+	TEST_REPORT("generic6Dof");
+}
+
+
+
+int main(int argc, char** argv)
+{
+	int preferredDeviceIndex = -1;
+	int preferredPlatformIndex = -1;
+
+	b3CommandLineArgs args(argc, argv);
+	args.GetCmdLineArgument("deviceId", preferredDeviceIndex);
+	args.GetCmdLineArgument("platformId", preferredPlatformIndex);
+
+	//host only
+	generic6DofTest();
+
+	initCL(preferredDeviceIndex,preferredPlatformIndex);
+	if (g_queue)
+	{
+		g_threadSupport = createThreadSupport(4);
+
+		threadedHostSolveTest();
+		adaptiveCellSplitTest();
+		exactBatchingTest();
+		batchReuseTest();
+
+		delete g_threadSupport;
+		exitCL();
+	} else
+	{
+		printf("No OpenCL device found, skipping the OpenCL tests\n");
+	}
+
+	printf("%d tests passed, %d tests failed\n",g_nPassed, g_nFailed);
+	return g_nFailed;
+}
@@ -0,0 +1,50 @@
+function createProject(vendor)	
+	hasCL = findOpenCL(vendor)
+	
+	if (hasCL) then
+
+		project ("Test_OpenCL_RigidBody_" .. vendor)
+
+		initOpenCL(vendor)
+
+		language "C++"
+				
+		kind "ConsoleApp"
+		targetdir "../../../bin"
+		includedirs {".","../../../src","../../../btgui/MultiThreading"}
+		
+		links {
+			"Bullet3OpenCL_" .. vendor,
+			"Bullet3Dynamics",
+			"Bullet3Collision",
+			"Bullet3Geometry",
+			"Bullet3Common",
+		}
+		
+		files {
+			"main.cpp",
+		}
+
+		if os.is("Windows") then
+			files {
+				"../../../btgui/MultiThreading/b3Win32ThreadSupport.cpp",
+				"../../../btgui/MultiThreading/b3Win32ThreadSupport.h"
+			}
+		end
+
+		if os.is("Linux") or os.is("MacOSX") then
+			files {
+				"../../../btgui/MultiThreading/b3PosixThreadSupport.cpp",
+				"../../../btgui/MultiThreading/b3PosixThreadSupport.h"
+			}
+			links {"pthread"}
+		end
+		
+	end
+end
+
+createProject("clew")
+createProject("AMD")
+createProject("Intel")
+createProject("NVIDIA")
+createProject("Apple")
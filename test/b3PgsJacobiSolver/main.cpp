@@ -0,0 +1,887 @@
+/*
+Copyright (c) 2012 Advanced Micro Devices, Inc.
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Bullet3Common/b3Vector3.h"
+#include "Bullet3Common/b3Quaternion.h"
+#include "Bullet3Common/b3AlignedObjectArray.h"
+#include "Bullet3Common/b3ThreadSupportInterface.h"
+#include "Bullet3Dynamics/ConstraintSolver/b3PgsJacobiSolver.h"
+#include "Bullet3Dynamics/ConstraintSolver/b3ContactSolverInfo.h"
+#include "Bullet3Dynamics/ConstraintSolver/b3Point2PointConstraint.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3RigidBodyCL.h"
+#include "Bullet3Collision/NarrowPhaseCollision/b3Contact4.h"
+
+#ifdef _WIN32
+#include "b3Win32ThreadSupport.h"
+#else
+#include "b3PosixThreadSupport.h"
+#endif
+
+int g_nPassed = 0;
+int g_nFailed = 0;
+bool g_testFailed = 0;
+
+#define TEST_INIT g_testFailed = 0;
+#define TEST_ASSERT(x) if( !(x) ){g_testFailed = 1;}
+#define TEST_REPORT(testName) printf("[%s] %s\n",(g_testFailed)?"X":"O", testName); if(g_testFailed) g_nFailed++; else g_nPassed++;
+
+b3ThreadSupportInterface* g_threadSupport = 0;
+
+static b3ThreadSupportInterface* createThreadSupport(int numThreads)
+{
+#ifdef _WIN32
+	b3Win32ThreadSupport::Win32ThreadConstructionInfo threadConstructionInfo("solver",b3ThreadTaskFunc,b3ThreadTaskLocalStoreFunc,numThreads);
+	return new b3Win32ThreadSupport(threadConstructionInfo);
+#else
+	b3PosixThreadSupport::ThreadConstructionInfo threadConstructionInfo("solver",b3ThreadTaskFunc,b3ThreadTaskLocalStoreFunc,numThreads);
+	return new b3PosixThreadSupport(threadConstructionInfo);
+#endif
+}
+
+struct SolverScene
+{
+	b3AlignedObjectArray<b3RigidBodyCL>	m_bodies;
+	b3AlignedObjectArray<b3InertiaCL>	m_inertias;
+	b3AlignedObjectArray<b3Contact4>	m_contacts;
+};
+
+///columns of unit boxes (half extents 1) on a static ground body 0, each box touches the one below with a 4-point manifold
+static void createBoxStackScene(SolverScene& scene, int numColumns, int height, float penetration, float friction)
+{
+	int numBodies = 1+numColumns*height;
+	scene.m_bodies.resize(numBodies);
+	scene.m_inertias.resize(numBodies);
+	scene.m_contacts.resize(0);
+	memset(&scene.m_bodies[0],0,sizeof(b3RigidBodyCL)*numBodies);
+	memset(&scene.m_inertias[0],0,sizeof(b3InertiaCL)*numBodies);
+	for (int i=0;i<numBodies;i++)
+	{
+		scene.m_bodies[i].m_quat = b3Quaternion(0,0,0,1);
+		scene.m_inertias[i].m_invInertiaWorld.setValue(0,0,0,0,0,0,0,0,0);
+	}
+	for (int c=0;c<numColumns;c++)
+	{
+		for (int h=0;h<height;h++)
+		{
+			int i = 1+c*height+h;
+			b3RigidBodyCL& body = scene.m_bodies[i];
+			body.m_pos = b3MakeVector3(c*3.f,1.f+2.f*h,0);
+			body.m_invMass = 1.f;
+			//some sideways and spinning motion, so the friction rows have work to do
+			body.m_linVel = b3MakeVector3(0.01f*(c%5),-0.2f-0.01f*h,0.03f*(h%3));
+			body.m_angVel = b3MakeVector3(0.1f*(h%2),0,0.05f*(c%3));
+			scene.m_inertias[i].m_invInertiaWorld.setValue(1.5f,0,0,0,1.5f,0,0,0,1.5f);
+
+			b3Contact4 contact;
+			memset(&contact,0,sizeof(b3Contact4));
+			int below = h==0? 0 : i-1;
+			contact.m_bodyAPtrAndSignBit = i;
+			contact.m_bodyBPtrAndSignBit = below==0? -below : below;
+			contact.m_worldNormalOnB = b3MakeVector3(0,1,0);
+			contact.m_worldNormalOnB.w = 4;
+			int k=0;
+			for (int dx=-1;dx<=1;dx+=2)
+			{
+				for (int dz=-1;dz<=1;dz+=2)
+				{
+					contact.m_worldPosB[k] = b3MakeVector3(c*3.f+dx,2.f*h,(float)dz);
+					contact.m_worldPosB[k].w = penetration;
+					k++;
+				}
+			}
+			contact.setFrictionCoeff(friction);
+			scene.m_contacts.push_back(contact);
+		}
+	}
+}
+
+static b3ContactSolverInfo getTestSolverInfo(int numIterations)
+{
+	b3ContactSolverInfo info;
+	info.m_numIterations = numIterations;
+	info.m_solverMode |= B3_SOLVER_USE_2_FRICTION_DIRECTIONS;
+	return info;
+}
+
+///solves one step of a copy of the scene, the body velocities and positions are in bodiesOut
+static void solveScene(b3PgsJacobiSolver& solver, const SolverScene& scene, b3TypedConstraint** constraints, int numConstraints,
+	const b3ContactSolverInfo& info, b3AlignedObjectArray<b3RigidBodyCL>& bodiesOut)
+{
+	bodiesOut = scene.m_bodies;
+	b3AlignedObjectArray<b3InertiaCL> inertias = scene.m_inertias;
+	b3AlignedObjectArray<b3Contact4> contacts = scene.m_contacts;
+	solver.solveGroup(&bodiesOut[0],&inertias[0],bodiesOut.size(),contacts.size()? &contacts[0] : 0,contacts.size(),constraints,numConstraints,info);
+}
+
+static float getMaxVelocityDifference(const b3AlignedObjectArray<b3RigidBodyCL>& bodiesA, const b3AlignedObjectArray<b3RigidBodyCL>& bodiesB)
+{
+	float maxDiff = 0.f;
+	for (int i=0;i<bodiesA.size();i++)
+	{
+		maxDiff = b3Max(maxDiff,(bodiesA[i].m_linVel-bodiesB[i].m_linVel).length());
+		maxDiff = b3Max(maxDiff,(bodiesA[i].m_angVel-bodiesB[i].m_angVel).length());
+	}
+	return maxDiff;
+}
+
+static bool isSameBodies(const b3AlignedObjectArray<b3RigidBodyCL>& bodiesA, const b3AlignedObjectArray<b3RigidBodyCL>& bodiesB)
+{
+	return bodiesA.size()==bodiesB.size() && memcmp(&bodiesA[0],&bodiesB[0],sizeof(b3RigidBodyCL)*bodiesA.size())==0;
+}
+
+
+
+inline void coloredIterationTest()
+{
+	TEST_INIT;
+
+	//a single column is one island, so the threads solve colored batches.
+	//Without friction the velocities of the converged solve are unique, whatever the row order
+	SolverScene scene;
+	createBoxStackScene(scene,1,8,-0.01f,0.f);
+	b3ContactSolverInfo info = getTestSolverInfo(1000);
+
+	b3AlignedObjectArray<b3RigidBodyCL> serialBodies,threadedBodies,repeatedBodies;
+	b3PgsJacobiSolver serialSolver(true);
+	solveScene(serialSolver,scene,0,0,info,serialBodies);
+
+	b3PgsJacobiSolver solver(true);
+	solver.setThreadSupport(g_threadSupport);
+	solveScene(solver,scene,0,0,info,threadedBodies);
+	TEST_ASSERT(solver.getNumIslands()==1);
+	TEST_ASSERT(getMaxVelocityDifference(threadedBodies,serialBodies)<1e-4f);
+	//the coloring does not depend on the thread timing
+	solveScene(solver,scene,0,0,info,repeatedBodies);
+	TEST_ASSERT(isSameBodies(threadedBodies,repeatedBodies));
+	solver.setThreadSupport(0);
+
+	TEST_REPORT("coloredIteration");
+}
+
+inline void islandTest()
+{
+	TEST_INIT;
+
+	//each column is an island, the static ground joins none of them
+	int numColumns = 8;
+	int height = 4;
+	SolverScene scene;
+	createBoxStackScene(scene,numColumns,height,-0.01f,0.f);
+	//a body without contacts is in no island
+	int freeBody = scene.m_bodies.size();
+	scene.m_bodies.push_back(scene.m_bodies[1]);
+	scene.m_inertias.push_back(scene.m_inertias[1]);
+	b3ContactSolverInfo info = getTestSolverInfo(300);
+
+	b3AlignedObjectArray<b3RigidBodyCL> serialBodies,threadedBodies;
+	b3PgsJacobiSolver serialSolver(true);
+	solveScene(serialSolver,scene,0,0,info,serialBodies);
+
+	b3PgsJacobiSolver solver(true);
+	solver.setThreadSupport(g_threadSupport);
+	solveScene(solver,scene,0,0,info,threadedBodies);
+	TEST_ASSERT(solver.getNumIslands()==numColumns);
+	const b3AlignedObjectArray<int>& islandIds = solver.getBodyIslandIds();
+	TEST_ASSERT(islandIds.size()==scene.m_bodies.size());
+	if (islandIds.size()==scene.m_bodies.size())
+	{
+		TEST_ASSERT(islandIds[0]==-1);
+		TEST_ASSERT(islandIds[freeBody]==-1);
+		for (int c=0;c<numColumns;c++)
+		{
+			int islandId = islandIds[1+c*height];
+			TEST_ASSERT(islandId>=0 && islandId<numColumns);
+			for (int h=1;h<height;h++)
+				TEST_ASSERT(islandIds[1+c*height+h]==islandId);
+			for (int other=0;other<c;other++)
+				TEST_ASSERT(islandIds[1+other*height]!=islandId);
+		}
+	}
+	TEST_ASSERT(getMaxVelocityDifference(threadedBodies,serialBodies)<1e-4f);
+	solver.setThreadSupport(0);
+
+	TEST_REPORT("island");
+}
+
+///exposes the row block width, the solver picks the widest the cpu supports
+class RowBlockTestSolver : public b3PgsJacobiSolver
+{
+public:
+	RowBlockTestSolver()
+		:b3PgsJacobiSolver(true)
+	{
+	}
+	void	setRowBlockWidth(int width)
+	{
+		m_rowBlocks.setWidth(width);
+	}
+	int		getRowBlockWidth() const
+	{
+		return m_rowBlocks.getWidth();
+	}
+};
+
+inline void rowBlockTest()
+{
+	TEST_INIT;
+
+	SolverScene scene;
+	createBoxStackScene(scene,3,8,-0.01f,0.f);
+	b3ContactSolverInfo info = getTestSolverInfo(1000);
+
+	b3AlignedObjectArray<b3RigidBodyCL> serialBodies,blockBodies;
+	b3PgsJacobiSolver serialSolver(true);
+	solveScene(serialSolver,scene,0,0,info,serialBodies);
+
+	info.m_solverMode |= B3_SOLVER_SIMD_ROW_BLOCKS;
+	int widths[2] = {4,8};
+	for (int i=0;i<2;i++)
+	{
+		for (int useThreads=0;useThreads<2;useThreads++)
+		{
+			RowBlockTestSolver solver;
+			solver.setRowBlockWidth(widths[i]);
+			//8 lanes need AVX2 at runtime
+			TEST_ASSERT(solver.getRowBlockWidth()==b3Min(widths[i],b3SolverRowBlocks::getSimdWidth()));
+			solver.setThreadSupport(useThreads? g_threadSupport : 0);
+			solveScene(solver,scene,0,0,info,blockBodies);
+			TEST_ASSERT(getMaxVelocityDifference(blockBodies,serialBodies)<1e-4f);
+			solver.setThreadSupport(0);
+		}
+	}
+
+	TEST_REPORT("rowBlock");
+}
+
+inline void residualEarlyExitTest()
+{
+	TEST_INIT;
+
+	SolverScene scene;
+	createBoxStackScene(scene,4,4,-0.01f,0.f);
+	int maxNumIterations = 1000;
+	b3ContactSolverInfo info = getTestSolverInfo(maxNumIterations);
+
+	b3AlignedObjectArray<b3RigidBodyCL> fullBodies,bodies;
+	b3PgsJacobiSolver fullSolver(true);
+	solveScene(fullSolver,scene,0,0,info,fullBodies);
+	TEST_ASSERT(!fullSolver.getIterationStats().m_converged);
+	TEST_ASSERT(fullSolver.getIterationStats().m_numIterations==maxNumIterations);
+
+	info.m_residualThreshold = 1e-6f;
+	info.m_minNumIterations = 4;
+	for (int useThreads=0;useThreads<2;useThreads++)
+	{
+		b3PgsJacobiSolver solver(true);
+		solver.setThreadSupport(useThreads? g_threadSupport : 0);
+		solveScene(solver,scene,0,0,info,bodies);
+		const b3SolverIterationStats& stats = solver.getIterationStats();
+		TEST_ASSERT(stats.m_converged);
+		TEST_ASSERT(stats.m_numIterations>=info.m_minNumIterations && stats.m_numIterations<maxNumIterations);
+		TEST_ASSERT(stats.m_residuals.size()==stats.m_numIterations);
+		if (stats.m_residuals.size()==stats.m_numIterations && stats.m_numIterations>0)
+		{
+			TEST_ASSERT(stats.m_residuals[stats.m_numIterations-1].m_maxDeltaImpulse<info.m_residualThreshold);
+			//the iterations before the last one were above the threshold
+			if (stats.m_numIterations>info.m_minNumIterations)
+				TEST_ASSERT(stats.m_residuals[stats.m_numIterations-2].m_maxDeltaImpulse>=info.m_residualThreshold);
+		}
+		//the remaining iterations would barely change the velocities
+		TEST_ASSERT(getMaxVelocityDifference(bodies,fullBodies)<1e-4f);
+		solver.setThreadSupport(0);
+	}
+
+	TEST_REPORT("residualEarlyExit");
+}
+
+///largest approaching or separating normal velocity at the points of the manifolds
+static float getMaxNormalVelocity(const SolverScene& scene, const b3AlignedObjectArray<b3RigidBodyCL>& bodies)
+{
+	float maxVel = 0.f;
+	for (int i=0;i<scene.m_contacts.size();i++)
+	{
+		const b3Contact4& contact = scene.m_contacts[i];
+		const b3RigidBodyCL& bodyA = bodies[contact.getBodyA()];
+		const b3RigidBodyCL& bodyB = bodies[contact.getBodyB()];
+		b3Vector3 normal = contact.m_worldNormalOnB;
+		normal.w = 0.f;
+		for (int k=0;k<contact.getNPoints();k++)
+		{
+			b3Vector3 point = contact.m_worldPosB[k];
+			b3Vector3 velA = bodyA.m_linVel+bodyA.m_angVel.cross(point-bodyA.m_pos);
+			b3Vector3 velB = bodyB.m_linVel+bodyB.m_angVel.cross(point-bodyB.m_pos);
+			maxVel = b3Max(maxVel,b3Fabs((velA-velB).dot(normal)));
+		}
+	}
+	return maxVel;
+}
+
+inline void blockContactNormalsTest()
+{
+	TEST_INIT;
+
+	//a spinning box falling onto the ground, its 4 normal rows are coupled through its rotation
+	SolverScene scene;
+	createBoxStackScene(scene,1,1,0.f,0.f);
+	scene.m_bodies[1].m_angVel = b3MakeVector3(0.3f,0,-0.2f);
+
+	b3AlignedObjectArray<b3RigidBodyCL> pgsBodies,blockBodies;
+	b3ContactSolverInfo info = getTestSolverInfo(1000);
+	b3PgsJacobiSolver pgsSolver(true);
+	solveScene(pgsSolver,scene,0,0,info,pgsBodies);
+	TEST_ASSERT(getMaxNormalVelocity(scene,pgsBodies)<1e-4f);
+
+	//a single block iteration stops the box, like many point by point iterations
+	info.m_numIterations = 1;
+	b3PgsJacobiSolver solver(true);
+	solveScene(solver,scene,0,0,info,blockBodies);
+	float pgsNormalVelocity = getMaxNormalVelocity(scene,blockBodies);
+	info.m_solverMode |= B3_SOLVER_BLOCK_CONTACT_NORMALS;
+	solveScene(solver,scene,0,0,info,blockBodies);
+	//the 4 points of a face make a singular block, which is solved up to a small regularization
+	TEST_ASSERT(pgsNormalVelocity>1e-1f);
+	TEST_ASSERT(getMaxNormalVelocity(scene,blockBodies)<1e-3f);
+	TEST_ASSERT(getMaxVelocityDifference(blockBodies,pgsBodies)<1e-3f);
+
+	TEST_REPORT("blockContactNormals");
+}
+
+inline void jacobiTest()
+{
+	TEST_INIT;
+
+	//without friction PGS and the split body Jacobi iterations converge to the same velocities
+	SolverScene scene;
+	createBoxStackScene(scene,3,8,-0.01f,0.f);
+	b3AlignedObjectArray<b3RigidBodyCL> pgsBodies,serialBodies,bodies;
+	b3PgsJacobiSolver pgsSolver(true);
+	solveScene(pgsSolver,scene,0,0,getTestSolverInfo(1000),pgsBodies);
+
+	b3ContactSolverInfo info = getTestSolverInfo(1600);
+	b3PgsJacobiSolver serialSolver(false);
+	solveScene(serialSolver,scene,0,0,info,serialBodies);
+	TEST_ASSERT(getMaxVelocityDifference(serialBodies,pgsBodies)<1e-4f);
+
+	//the threads run the same Jacobi iterations as the serial solver
+	b3PgsJacobiSolver solver(false);
+	solver.setThreadSupport(g_threadSupport);
+	solveScene(solver,scene,0,0,info,bodies);
+	TEST_ASSERT(isSameBodies(bodies,serialBodies));
+
+	//NNCG gets there in far fewer iterations than plain Jacobi
+	info = getTestSolverInfo(400);
+	b3ContactSolverInfo nncgInfo = info;
+	nncgInfo.m_solverMode |= B3_SOLVER_JACOBI_NNCG;
+	solveScene(serialSolver,scene,0,0,info,serialBodies);
+	TEST_ASSERT(getMaxVelocityDifference(serialBodies,pgsBodies)>1e-3f);
+	solveScene(serialSolver,scene,0,0,nncgInfo,serialBodies);
+	TEST_ASSERT(getMaxVelocityDifference(serialBodies,pgsBodies)<1e-4f);
+	//the threaded NNCG beta is summed over the same row chunks as the serial one, so the bodies match bitwise
+	solveScene(solver,scene,0,0,nncgInfo,bodies);
+	TEST_ASSERT(isSameBodies(bodies,serialBodies));
+	solver.setThreadSupport(0);
+
+	TEST_REPORT("jacobi");
+}
+
+///keeps a copy of the solver bodies and rows built by the setup
+class SetupTestSolver : public b3PgsJacobiSolver
+{
+public:
+	b3AlignedObjectArray<b3SolverBody>	m_setupBodies;
+	b3ConstraintArray	m_setupRows[4];
+
+	SetupTestSolver()
+		:b3PgsJacobiSolver(true)
+	{
+	}
+
+	virtual b3Scalar solveGroupCacheFriendlySetup(b3RigidBodyCL* bodies, b3InertiaCL* inertias,int numBodies,b3Contact4* manifoldPtr, int numManifolds,b3TypedConstraint** constraints,int numConstraints,const b3ContactSolverInfo& infoGlobal)
+	{
+		b3Scalar result = b3PgsJacobiSolver::solveGroupCacheFriendlySetup(bodies,inertias,numBodies,manifoldPtr,numManifolds,constraints,numConstraints,infoGlobal);
+		m_setupBodies = m_tmpSolverBodyPool;
+		m_setupRows[0] = m_tmpSolverNonContactConstraintPool;
+		m_setupRows[1] = m_tmpSolverContactConstraintPool;
+		m_setupRows[2] = m_tmpSolverContactFrictionConstraintPool;
+		m_setupRows[3] = m_tmpSolverContactRollingFrictionConstraintPool;
+		return result;
+	}
+};
+
+static bool isSameVector(const b3Vector3& a, const b3Vector3& b)
+{
+	return a.x==b.x && a.y==b.y && a.z==b.z;
+}
+
+static bool isSameRows(const b3ConstraintArray& rowsA, const b3ConstraintArray& rowsB)
+{
+	if (rowsA.size()!=rowsB.size())
+		return false;
+	for (int i=0;i<rowsA.size();i++)
+	{
+		const b3SolverConstraint& a = rowsA[i];
+		const b3SolverConstraint& b = rowsB[i];
+		if (!isSameVector(a.m_relpos1CrossNormal,b.m_relpos1CrossNormal) || !isSameVector(a.m_contactNormal,b.m_contactNormal) ||
+			!isSameVector(a.m_relpos2CrossNormal,b.m_relpos2CrossNormal) || !isSameVector(a.m_angularComponentA,b.m_angularComponentA) ||
+			!isSameVector(a.m_angularComponentB,b.m_angularComponentB))
+			return false;
+		if (a.m_appliedImpulse!=b.m_appliedImpulse || a.m_friction!=b.m_friction || a.m_jacDiagABInv!=b.m_jacDiagABInv ||
+			a.m_rhs!=b.m_rhs || a.m_cfm!=b.m_cfm || a.m_lowerLimit!=b.m_lowerLimit || a.m_upperLimit!=b.m_upperLimit ||
+			a.m_rhsPenetration!=b.m_rhsPenetration || a.m_frictionIndex!=b.m_frictionIndex ||
+			a.m_solverBodyIdA!=b.m_solverBodyIdA || a.m_solverBodyIdB!=b.m_solverBodyIdB)
+			return false;
+	}
+	return true;
+}
+
+inline void parallelSetupTest()
+{
+	TEST_INIT;
+
+	//stacks with friction, each box is also jointed to the box next to it in the following column
+	int numColumns = 8;
+	int height = 4;
+	SolverScene scene;
+	createBoxStackScene(scene,numColumns,height,-0.01f,0.7f);
+	b3AlignedObjectArray<b3Point2PointConstraint*> joints;
+	b3AlignedObjectArray<b3TypedConstraint*> constraints;
+	for (int c=0;c+1<numColumns;c++)
+	{
+		for (int h=0;h<height;h++)
+		{
+			int i = 1+c*height+h;
+			joints.push_back(new b3Point2PointConstraint(i,i+height,b3MakeVector3(1.5f,0,0),b3MakeVector3(-1.5f,0,0)));
+			constraints.push_back(joints[joints.size()-1]);
+		}
+	}
+	b3ContactSolverInfo info = getTestSolverInfo(10);
+
+	SetupTestSolver serialSolver;
+	b3AlignedObjectArray<b3RigidBodyCL> bodies;
+	solveScene(serialSolver,scene,&constraints[0],constraints.size(),info,bodies);
+
+	SetupTestSolver solver;
+	solver.setThreadSupport(g_threadSupport);
+	solveScene(solver,scene,&constraints[0],constraints.size(),info,bodies);
+	solver.setThreadSupport(0);
+
+	//the threads fill the same rows in the same place as the serial setup
+	TEST_ASSERT(serialSolver.m_setupRows[0].size()==joints.size()*3);
+	TEST_ASSERT(serialSolver.m_setupRows[1].size()==scene.m_contacts.size()*4);
+	TEST_ASSERT(serialSolver.m_setupRows[2].size()==scene.m_contacts.size()*8);
+	for (int p=0;p<4;p++)
+		TEST_ASSERT(isSameRows(solver.m_setupRows[p],serialSolver.m_setupRows[p]));
+	TEST_ASSERT(solver.m_setupBodies.size()==serialSolver.m_setupBodies.size());
+	for (int i=0;i<solver.m_setupBodies.size() && i<serialSolver.m_setupBodies.size();i++)
+	{
+		const b3SolverBody& a = solver.m_setupBodies[i];
+		const b3SolverBody& b = serialSolver.m_setupBodies[i];
+		TEST_ASSERT(a.m_originalBodyIndex==b.m_originalBodyIndex);
+		TEST_ASSERT(isSameVector(a.m_linearVelocity,b.m_linearVelocity) && isSameVector(a.m_angularVelocity,b.m_angularVelocity));
+		TEST_ASSERT(isSameVector(a.m_deltaLinearVelocity,b.m_deltaLinearVelocity) && isSameVector(a.m_deltaAngularVelocity,b.m_deltaAngularVelocity));
+	}
+
+	for (int i=0;i<joints.size();i++)
+		delete joints[i];
+
+	TEST_REPORT("parallelSetup");
+}
+
+///velocity of the pivot of the joint on body A relative to its pivot on body B, zero for a satisfied joint
+static b3Vector3 getJointVelocityError(const b3AlignedObjectArray<b3RigidBodyCL>& bodies, const b3Point2PointConstraint& joint)
+{
+	const b3RigidBodyCL& bodyA = bodies[joint.getRigidBodyA()];
+	const b3RigidBodyCL& bodyB = bodies[joint.getRigidBodyB()];
+	b3Vector3 relPosA = b3QuatRotate(bodyA.m_quat,joint.getPivotInA());
+	b3Vector3 relPosB = b3QuatRotate(bodyB.m_quat,joint.getPivotInB());
+	return bodyA.m_linVel+bodyA.m_angVel.cross(relPosA)-bodyB.m_linVel-bodyB.m_angVel.cross(relPosB);
+}
+
+inline void jacobiJointTest()
+{
+	TEST_INIT;
+
+	//boxes resting on the ground, the boxes of each row are chained by point to point joints between their sides
+	int numColumns = 4;
+	SolverScene scene;
+	createBoxStackScene(scene,numColumns,1,0.f,0.f);
+	b3AlignedObjectArray<b3Point2PointConstraint*> joints;
+	b3AlignedObjectArray<b3TypedConstraint*> constraints;
+	for (int c=0;c+1<numColumns;c++)
+	{
+		joints.push_back(new b3Point2PointConstraint(1+c,2+c,b3MakeVector3(1.5f,0,0),b3MakeVector3(-1.5f,0,0)));
+		constraints.push_back(joints[joints.size()-1]);
+	}
+	b3ContactSolverInfo info = getTestSolverInfo(1000);
+
+	b3AlignedObjectArray<b3RigidBodyCL> pgsBodies,serialBodies,threadedBodies;
+	b3PgsJacobiSolver pgsSolver(true);
+	solveScene(pgsSolver,scene,&constraints[0],constraints.size(),info,pgsBodies);
+	b3PgsJacobiSolver serialSolver(false);
+	solveScene(serialSolver,scene,&constraints[0],constraints.size(),info,serialBodies);
+	b3PgsJacobiSolver solver(false);
+	solver.setThreadSupport(g_threadSupport);
+	solveScene(solver,scene,&constraints[0],constraints.size(),info,threadedBodies);
+	solver.setThreadSupport(0);
+
+	for (int i=0;i<joints.size();i++)
+	{
+		TEST_ASSERT(getJointVelocityError(pgsBodies,*joints[i]).length()<1e-4f);
+		TEST_ASSERT(getJointVelocityError(serialBodies,*joints[i]).length()<1e-4f);
+	}
+	//the boxes do not sink into the ground
+	TEST_ASSERT(getMaxNormalVelocity(scene,serialBodies)<1e-4f);
+	TEST_ASSERT(getMaxVelocityDifference(serialBodies,pgsBodies)<1e-3f);
+	TEST_ASSERT(isSameBodies(threadedBodies,serialBodies));
+
+	for (int i=0;i<joints.size();i++)
+		delete joints[i];
+
+	TEST_REPORT("jacobiJoint");
+}
+
+///exposes the joint row cache of the solver
+class JointCacheTestSolver : public b3PgsJacobiSolver
+{
+public:
+	JointCacheTestSolver()
+		:b3PgsJacobiSolver(true)
+	{
+	}
+
+	bool isCached(int jointIndex, const b3TypedConstraint* joint) const
+	{
+		return jointIndex<m_jointRowCache.size() && m_jointRowCache[jointIndex].m_constraint==joint;
+	}
+
+	const b3Quaternion& getCachedOrientationA(int jointIndex) const
+	{
+		return m_jointRowCache[jointIndex].m_orientationA;
+	}
+
+	const b3Quaternion& getCachedOrientationB(int jointIndex) const
+	{
+		return m_jointRowCache[jointIndex].m_orientationB;
+	}
+
+	b3Scalar getCachedGlobalDamping(int jointIndex) const
+	{
+		return m_jointRowCache[jointIndex].m_globalDamping;
+	}
+};
+
+static bool isSameQuaternion(const b3Quaternion& a, const b3Quaternion& b)
+{
+	return a.getX()==b.getX() && a.getY()==b.getY() && a.getZ()==b.getZ() && a.getW()==b.getW();
+}
+
+inline void jointCacheTest()
+{
+	TEST_INIT;
+
+	//the chained boxes of the Jacobi joint test, solved by PGS
+	int numColumns = 4;
+	SolverScene scene;
+	createBoxStackScene(scene,numColumns,1,0.f,0.7f);
+	b3AlignedObjectArray<b3Point2PointConstraint*> joints;
+	b3AlignedObjectArray<b3TypedConstraint*> constraints;
+	for (int c=0;c+1<numColumns;c++)
+	{
+		joints.push_back(new b3Point2PointConstraint(1+c,2+c,b3MakeVector3(1.5f,0,0),b3MakeVector3(-1.5f,0,0)));
+		constraints.push_back(joints[joints.size()-1]);
+	}
+	b3ContactSolverInfo uncachedInfo = getTestSolverInfo(100);
+	b3ContactSolverInfo info = uncachedInfo;
+	info.m_jointCacheAngularThreshold = 0.1f;
+
+	b3AlignedObjectArray<b3RigidBodyCL> bodies,uncachedBodies;
+	JointCacheTestSolver solver;
+	b3PgsJacobiSolver uncachedSolver(true);
+	solveScene(solver,scene,&constraints[0],constraints.size(),info,bodies);
+	for (int i=0;i<joints.size();i++)
+	{
+		TEST_ASSERT(solver.isCached(i,joints[i]));
+		TEST_ASSERT(isSameQuaternion(solver.getCachedOrientationA(i),scene.m_bodies[joints[i]->getRigidBodyA()].m_quat));
+	}
+
+	//box 2 turns below the threshold, joints 0 and 1 keep the rows built before the turn
+	b3Quaternion initialOrientation = scene.m_bodies[2].m_quat;
+	scene.m_bodies[2].m_quat = b3Quaternion(b3MakeVector3(0,0,1),0.02f)*initialOrientation;
+	scene.m_bodies[2].m_pos += b3MakeVector3(0.01f,0,0);
+	solveScene(solver,scene,&constraints[0],constraints.size(),info,bodies);
+	solveScene(uncachedSolver,scene,&constraints[0],constraints.size(),uncachedInfo,uncachedBodies);
+	TEST_ASSERT(isSameQuaternion(solver.getCachedOrientationB(0),initialOrientation));
+	TEST_ASSERT(isSameQuaternion(solver.getCachedOrientationA(1),initialOrientation));
+	//the reused rows move the position error to first order, the velocities stay close to the rebuilt ones
+	TEST_ASSERT(getMaxVelocityDifference(bodies,uncachedBodies)<5e-3f);
+
+	//past the threshold the rows of joints 0 and 1 are built again, joint 2 still reuses its rows
+	scene.m_bodies[2].m_quat = b3Quaternion(b3MakeVector3(0,0,1),0.3f)*initialOrientation;
+	solveScene(solver,scene,&constraints[0],constraints.size(),info,bodies);
+	solveScene(uncachedSolver,scene,&constraints[0],constraints.size(),uncachedInfo,uncachedBodies);
+	TEST_ASSERT(isSameQuaternion(solver.getCachedOrientationB(0),scene.m_bodies[2].m_quat));
+	TEST_ASSERT(isSameQuaternion(solver.getCachedOrientationA(1),scene.m_bodies[2].m_quat));
+	TEST_ASSERT(isSameQuaternion(solver.getCachedOrientationA(2),scene.m_bodies[3].m_quat));
+	TEST_ASSERT(getMaxVelocityDifference(bodies,uncachedBodies)<1e-5f);
+
+	//a different damping builds all rows again, although no body moved
+	info.m_damping = uncachedInfo.m_damping = 0.5f;
+	solveScene(solver,scene,&constraints[0],constraints.size(),info,bodies);
+	solveScene(uncachedSolver,scene,&constraints[0],constraints.size(),uncachedInfo,uncachedBodies);
+	for (int i=0;i<joints.size();i++)
+		TEST_ASSERT(solver.getCachedGlobalDamping(i)==info.m_damping);
+	TEST_ASSERT(getMaxVelocityDifference(bodies,uncachedBodies)<1e-5f);
+
+	for (int i=0;i<joints.size();i++)
+		delete joints[i];
+
+	TEST_REPORT("jointCache");
+}
+
+static int g_numAllocations = 0;
+
+static void* countingAlloc(size_t size)
+{
+	g_numAllocations++;
+	return malloc(size);
+}
+
+static void countingFree(void* ptr)
+{
+	free(ptr);
+}
+
+inline void noAllocationTest()
+{
+	TEST_INIT;
+
+	int numColumns = 8;
+	int height = 4;
+	SolverScene scene;
+	createBoxStackScene(scene,numColumns,height,-0.01f,0.7f);
+	b3AlignedObjectArray<b3Point2PointConstraint*> joints;
+	b3AlignedObjectArray<b3TypedConstraint*> constraints;
+	for (int c=0;c+1<numColumns;c++)
+	{
+		joints.push_back(new b3Point2PointConstraint(1+c*height,1+(c+1)*height,b3MakeVector3(1.5f,0,0),b3MakeVector3(-1.5f,0,0)));
+		constraints.push_back(joints[joints.size()-1]);
+	}
+
+	//serial and threaded PGS, threaded Jacobi and NNCG, with the split impulse
+	for (int mode=0;mode<4;mode++)
+	{
+		b3ContactSolverInfo info = getTestSolverInfo(10);
+		info.m_splitImpulse = true;
+		if (mode==3)
+			info.m_solverMode |= B3_SOLVER_JACOBI_NNCG;
+		b3PgsJacobiSolver solver(mode<2);
+		solver.setThreadSupport(mode? g_threadSupport : 0);
+
+		//the first step sizes the pools and the scratch of the solver, the next one only reuses them
+		int numAllocations = 0;
+		for (int step=0;step<2;step++)
+		{
+			b3AlignedObjectArray<b3RigidBodyCL> bodies = scene.m_bodies;
+			b3AlignedObjectArray<b3InertiaCL> inertias = scene.m_inertias;
+			b3AlignedObjectArray<b3Contact4> contacts = scene.m_contacts;
+			g_numAllocations = 0;
+			b3AlignedAllocSetCustom(countingAlloc,countingFree);
+			solver.solveGroup(&bodies[0],&inertias[0],bodies.size(),&contacts[0],contacts.size(),&constraints[0],constraints.size(),info);
+			b3AlignedAllocSetCustom(0,0);
+			numAllocations = g_numAllocations;
+			if (step==0)
+				TEST_ASSERT(numAllocations>0);
+		}
+		TEST_ASSERT(numAllocations==0);
+		solver.setThreadSupport(0);
+	}
+
+	for (int i=0;i<joints.size();i++)
+		delete joints[i];
+
+	TEST_REPORT("noAllocation");
+}
+
+
+inline void hotRowTest()
+{
+	TEST_INIT;
+
+	//the hot row keeps the scalars in the w components, the Jacobian vectors stay as they are
+	TEST_ASSERT(sizeof(b3SolverConstraintHot)==96);
+	b3SolverConstraint row;
+	memset(&row,0,sizeof(b3SolverConstraint));
+	row.m_contactNormal = b3MakeVector3(0,1,0);
+	row.m_relpos1CrossNormal = b3MakeVector3(1,2,3);
+	row.m_relpos2CrossNormal = b3MakeVector3(-3,-2,-1);
+	row.m_angularComponentA = b3MakeVector3(0.5f,0.25f,0.125f);
+	row.m_angularComponentB = b3MakeVector3(-0.5f,-0.25f,-0.125f);
+	row.m_jacDiagABInv = 0.75f;
+	row.m_rhs = 2.5f;
+	row.m_cfm = 0.01f;
+	row.m_lowerLimit = -4.f;
+	row.m_upperLimit = 8.f;
+	row.m_friction = 0.6f;
+	row.m_appliedImpulse = 1.25f;
+	row.m_solverBodyIdA = 3;
+	row.m_solverBodyIdB = 5;
+	row.m_frictionIndex = 7;
+	row.m_overrideNumSolverIterations = 11;
+
+	b3SolverConstraintHot hot;
+	hot.pack(row,false);
+	TEST_ASSERT(hot.getJacDiagABInv()==row.m_jacDiagABInv);
+	TEST_ASSERT(hot.getRhs()==row.m_rhs);
+	TEST_ASSERT(hot.getCfm()==row.m_cfm);
+	TEST_ASSERT(hot.getLowerLimit()==row.m_lowerLimit);
+	TEST_ASSERT(hot.getUpperLimit()==row.m_upperLimit);
+	TEST_ASSERT(hot.m_appliedImpulse==row.m_appliedImpulse);
+	TEST_ASSERT(hot.m_solverBodyIdA==3 && hot.m_solverBodyIdB==5);
+	TEST_ASSERT(hot.m_overrideNumSolverIterations==11);
+	TEST_ASSERT(b3SolverRowXyz(hot.m_relpos1CrossNormal)==row.m_relpos1CrossNormal);
+	TEST_ASSERT(b3SolverRowXyz(hot.m_angularComponentB)==row.m_angularComponentB);
+	TEST_ASSERT(b3SolverRowXyz(hot.m_relpos2CrossNormal).dot(hot.m_relpos2CrossNormal)==row.m_relpos2CrossNormal.dot(row.m_relpos2CrossNormal));
+	hot.pack(row,true);
+	TEST_ASSERT(hot.getFriction()==row.m_friction);
+	TEST_ASSERT(hot.m_frictionIndex==7);
+
+	//the SIMD resolvers solve the same rows as the scalar ones, with friction and joints
+	int numColumns = 4;
+	int height = 4;
+	SolverScene scene;
+	createBoxStackScene(scene,numColumns,height,-0.01f,0.7f);
+	b3AlignedObjectArray<b3Point2PointConstraint*> joints;
+	b3AlignedObjectArray<b3TypedConstraint*> constraints;
+	for (int c=0;c+1<numColumns;c++)
+	{
+		joints.push_back(new b3Point2PointConstraint(1+c*height,1+(c+1)*height,b3MakeVector3(1.5f,0,0),b3MakeVector3(-1.5f,0,0)));
+		constraints.push_back(joints[joints.size()-1]);
+	}
+
+	//PGS only, the Jacobi iterations average the velocities between the contact and friction rows on the SIMD path
+	b3ContactSolverInfo simdInfo = getTestSolverInfo(100);
+	b3ContactSolverInfo scalarInfo = simdInfo;
+	scalarInfo.m_solverMode &= ~B3_SOLVER_SIMD;
+	TEST_ASSERT(simdInfo.m_solverMode & B3_SOLVER_SIMD);
+
+	b3AlignedObjectArray<b3RigidBodyCL> simdBodies,scalarBodies;
+	b3PgsJacobiSolver simdSolver(true);
+	solveScene(simdSolver,scene,&constraints[0],constraints.size(),simdInfo,simdBodies);
+	b3PgsJacobiSolver scalarSolver(true);
+	solveScene(scalarSolver,scene,&constraints[0],constraints.size(),scalarInfo,scalarBodies);
+	TEST_ASSERT(getMaxVelocityDifference(simdBodies,scalarBodies)<1e-5f);
+
+	for (int i=0;i<joints.size();i++)
+		delete joints[i];
+
+	TEST_REPORT("hotRow");
+}
+
+
+static float getMaxPositionDifference(const b3AlignedObjectArray<b3RigidBodyCL>& bodiesA, const b3AlignedObjectArray<b3RigidBodyCL>& bodiesB)
+{
+	float maxDiff = 0.f;
+	for (int i=0;i<bodiesA.size();i++)
+	{
+		maxDiff = b3Max(maxDiff,(bodiesA[i].m_pos-bodiesB[i].m_pos).length());
+		b3Quaternion dq = bodiesA[i].m_quat-bodiesB[i].m_quat;
+		maxDiff = b3Max(maxDiff,dq.length());
+	}
+	return maxDiff;
+}
+
+inline void splitImpulseTest()
+{
+	TEST_INIT;
+
+	//deeper than m_splitImpulsePenetrationThreshold, so the contacts get push rows
+	SolverScene scene;
+	createBoxStackScene(scene,4,4,-0.1f,0.5f);
+	int maxNumIterations = 1000;
+	b3ContactSolverInfo info = getTestSolverInfo(maxNumIterations);
+	info.m_splitImpulse = true;
+
+	b3AlignedObjectArray<b3RigidBodyCL> serialBodies,noSplitBodies,bodies;
+	b3PgsJacobiSolver serialSolver(true);
+	solveScene(serialSolver,scene,0,0,info,serialBodies);
+	const b3SolverIterationStats& serialStats = serialSolver.getSplitImpulseIterationStats();
+	TEST_ASSERT(serialStats.m_numIterations==maxNumIterations && !serialStats.m_converged);
+	TEST_ASSERT(serialStats.m_residuals.size() && serialStats.m_residuals[0].m_numRows>0);
+
+	//the push only moves the positions, the velocities don't carry the penetration recovery
+	b3ContactSolverInfo noSplitInfo = info;
+	noSplitInfo.m_splitImpulse = false;
+	b3PgsJacobiSolver noSplitSolver(true);
+	solveScene(noSplitSolver,scene,0,0,noSplitInfo,noSplitBodies);
+	TEST_ASSERT(getMaxPositionDifference(serialBodies,noSplitBodies)>1e-3f);
+	TEST_ASSERT(noSplitSolver.getSplitImpulseIterationStats().m_numIterations==0);
+
+	//the colored batches solve the same push rows in another order
+	b3PgsJacobiSolver threadedSolver(true);
+	threadedSolver.setThreadSupport(g_threadSupport);
+	solveScene(threadedSolver,scene,0,0,info,bodies);
+	TEST_ASSERT(threadedSolver.getSplitImpulseIterationStats().m_numIterations==maxNumIterations);
+	TEST_ASSERT(getMaxPositionDifference(bodies,serialBodies)<1e-4f);
+	TEST_ASSERT(getMaxVelocityDifference(bodies,serialBodies)<1e-4f);
+	threadedSolver.setThreadSupport(0);
+
+	info.m_splitImpulseResidualThreshold = 1e-6f;
+	info.m_minNumIterations = 4;
+	for (int useThreads=0;useThreads<2;useThreads++)
+	{
+		b3PgsJacobiSolver solver(true);
+		solver.setThreadSupport(useThreads? g_threadSupport : 0);
+		solveScene(solver,scene,0,0,info,bodies);
+		const b3SolverIterationStats& stats = solver.getSplitImpulseIterationStats();
+		TEST_ASSERT(stats.m_converged);
+		TEST_ASSERT(stats.m_numIterations>=info.m_minNumIterations && stats.m_numIterations<maxNumIterations);
+		TEST_ASSERT(stats.m_residuals.size()==stats.m_numIterations);
+		if (stats.m_residuals.size()==stats.m_numIterations && stats.m_numIterations>0)
+			TEST_ASSERT(stats.m_residuals[stats.m_numIterations-1].m_maxDeltaImpulse<info.m_splitImpulseResidualThreshold);
+		TEST_ASSERT(getMaxPositionDifference(bodies,serialBodies)<1e-4f);
+		solver.setThreadSupport(0);
+	}
+
+	TEST_REPORT("splitImpulse");
+}
+
+
+
+int main(int argc, char** argv)
+{
+	g_threadSupport = createThreadSupport(4);
+
+	coloredIterationTest();
+	islandTest();
+	rowBlockTest();
+	residualEarlyExitTest();
+	blockContactNormalsTest();
+	jacobiTest();
+	parallelSetupTest();
+	jacobiJointTest();
+	jointCacheTest();
+	noAllocationTest();
+	hotRowTest();
+	splitImpulseTest();
+
+	delete g_threadSupport;
+
+	printf("%d tests passed, %d tests failed\n",g_nPassed, g_nFailed);
+	return g_nFailed;
+}
@@ -0,0 +1,38 @@
+
+
+project ("Test_b3PgsJacobiSolver")
+
+	language "C++"
+			
+	kind "ConsoleApp"
+	targetdir "../../bin"
+	includedirs {"../../src", "../../btgui/MultiThreading"}
+	
+	links {"Bullet3Dynamics", "Bullet3Collision", "Bullet3Common"}		
+	
+	files {
+		"main.cpp",
+	}
+
+	if os.is("Windows") then
+		files {
+                "../../btgui/MultiThreading/b3Win32ThreadSupport.cpp",  
+                "../../btgui/MultiThreading/b3Win32ThreadSupport.h" 
+		}
+	end
+
+	if os.is("Linux") then 
+		files {
+                "../../btgui/MultiThreading/b3PosixThreadSupport.cpp",  
+                "../../btgui/MultiThreading/b3PosixThreadSupport.h"    
+        	}
+		links {"pthread"}
+	end
+
+	if os.is("MacOSX") then
+		files {
+                "../../btgui/MultiThreading/b3PosixThreadSupport.cpp",
+                "../../btgui/MultiThreading/b3PosixThreadSupport.h"    
+                }
+		links {"pthread"}
+	end